@@ -0,0 +1,66 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFAudioSink.h : Audio output interface of the native ASF components.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFDecoder.h"
+
+//Audio sinks
+#define ASF_AUDIO_SINK_WAVEOUT      1   // waveOut device (Windows)
+#define ASF_AUDIO_SINK_FILE         2   // PCM WAVE file
+#define ASF_AUDIO_SINK_NULL         3   // Discards the data, measures the timing
+
+//Buffers that can be queued on a sink at the same time
+#define ASF_AUDIO_SINK_DEFAULT_BUFFERS  4
+#define ASF_AUDIO_SINK_MAX_BUFFERS      16
+
+//Audio per buffer, 100 ms
+#define ASF_AUDIO_SINK_DEFAULT_BUFFER_DURATION  1000000
+
+
+//Receives the buffers back from a sink
+
+class IASFAudioSinkCallback
+{
+public:
+
+    virtual ~IASFAudioSinkCallback() {}
+
+    //The sink is done with the data of buffer iBuffer. Called on the
+    //sink's own thread, or on the submitting thread from inside Submit.
+    virtual void OnBufferDone(DWORD iBuffer) = 0;
+};
+
+
+//Audio output for PCM data. Buffers are identified by an index below
+//the buffer count passed to Open; the sink reads the data in place
+//until it hands the buffer back, in the order the buffers were
+//submitted. Instances are destroyed with delete.
+
+class IASFAudioSink
+{
+public:
+
+    virtual ~IASFAudioSink() {}
+
+    virtual HRESULT Open(const ASF_MEDIA_FORMAT& format, DWORD cBuffers, IASFAudioSinkCallback* pCallback) = 0;
+
+    //Queues a buffer behind the ones already submitted
+    virtual HRESULT Submit(DWORD iBuffer, const BYTE* pData, DWORD cbData) = 0;
+
+    //Stops the output; every queued buffer comes back through the
+    //callback, possibly after Reset returns
+    virtual HRESULT Reset() = 0;
+
+    virtual HRESULT Close() = 0;
+};
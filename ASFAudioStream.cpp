@@ -0,0 +1,641 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFAudioStream.cpp : CASFAudioStream class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "ASFAudioStream.h"
+
+//Polls of the sink before a waiting writer sleeps
+#define ASF_AUDIO_STREAM_SPIN_COUNT     64
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFAudioStream
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFAudioStream::CASFAudioStream()
+:   m_pSink (NULL),
+    m_nAvgBytesPerSec (0),
+    m_cbBuffer (0),
+    m_cBuffers (0),
+    m_iNextSubmit (0),
+    m_iNextDone (0),
+    m_cInFlight (0),
+    m_cbInFlight (0),
+    m_fEndOfStream (FALSE),
+    m_fStopping (FALSE),
+    m_fPumping (FALSE),
+    m_cbWritten (0),
+    m_llFirstWrite (0)
+{
+    memset(m_Buffers, 0, sizeof(m_Buffers));
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFAudioStream
+//  Description: Destructor. The owner of the sink calls Shutdown
+//               before it deletes the sink.
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFAudioStream::~CASFAudioStream()
+{
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Initialize
+//
+// Allocates the ring and opens the sink for one PCM format. A sink
+// from an earlier Initialize is closed first.
+//
+// pSink: Sink that receives the buffers. The caller keeps ownership.
+// format: PCM format of the decoder output
+// cbCapacity: Size of the ring in bytes
+// cBuffers: Buffers queued on the sink at a time, 0 for the default
+// hnsBufferDuration: Audio per buffer, 0 for the default
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFAudioStream::Initialize(
+    IASFAudioSink* pSink,
+    const ASF_MEDIA_FORMAT& format,
+    DWORD cbCapacity,
+    DWORD cBuffers,
+    MFTIME hnsBufferDuration
+    )
+{
+    if (!pSink || (format.nBlockAlign == 0) || (format.nSamplesPerSec == 0))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (cBuffers == 0)
+    {
+        cBuffers = ASF_AUDIO_SINK_DEFAULT_BUFFERS;
+    }
+
+    if (hnsBufferDuration <= 0)
+    {
+        hnsBufferDuration = ASF_AUDIO_SINK_DEFAULT_BUFFER_DURATION;
+    }
+
+    if ((cBuffers > ASF_AUDIO_SINK_MAX_BUFFERS) || (hnsBufferDuration > 10000000))
+    {
+        return E_INVALIDARG;
+    }
+
+    HRESULT hr = Shutdown();
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    m_nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+
+    //Whole blocks, at least one
+    DWORD cBlocks = (DWORD)(((ULONGLONG)format.nSamplesPerSec * hnsBufferDuration + 9999999) / 10000000);
+
+    m_cbBuffer = ((cBlocks > 0) ? cBlocks : 1) * format.nBlockAlign;
+    m_cBuffers = cBuffers;
+
+    hr = m_Ring.Initialize((cbCapacity > m_cbBuffer) ? cbCapacity : m_cbBuffer, format.nBlockAlign);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    hr = pSink->Open(format, cBuffers, this);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    m_pSink = pSink;
+
+    return Reset();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Shutdown
+//
+// Stops the output and closes the sink. A sink that holds no buffers
+// is not reset first: that would drop output it already took, such as
+// the data of a file sink.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFAudioStream::Shutdown()
+{
+    HRESULT hr = IsPlaying() ? Reset() : S_OK;
+
+    if (m_pSink)
+    {
+        HRESULT hrClose = m_pSink->Close();
+
+        if (SUCCEEDED(hr))
+        {
+            hr = hrClose;
+        }
+
+        m_pSink = NULL;
+    }
+
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Reset
+//
+// Stops the sink, waits until it has handed back every buffer and
+// empties the ring. Called by the writer thread.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFAudioStream::Reset()
+{
+    HRESULT hr = StopSink();
+
+    CASFAutoLock lock(m_Lock);
+
+    if (SUCCEEDED(hr))
+    {
+        m_Ring.Reset();
+
+        memset(m_Buffers, 0, sizeof(m_Buffers));
+
+        m_iNextSubmit = 0;
+        m_iNextDone = 0;
+        m_cbInFlight = 0;
+
+        m_fEndOfStream = FALSE;
+
+        m_cbWritten = 0;
+        m_llFirstWrite = 0;
+
+        memset(&m_Stats, 0, sizeof(m_Stats));
+    }
+
+    m_fStopping = FALSE;
+
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: BeginWrite
+//
+// Returns contiguous free space in the ring, for the decoder to write
+// into. While the ring is full and the sink holds buffers, waits for
+// the sink to hand one back.
+//
+// Returns S_FALSE, with no pointer, if there is no contiguous space of
+// that size; the writer then uses Write.
+//
+// cbMin: Number of bytes the writer needs in one piece
+// ppData: Receives a pointer into the ring
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFAudioStream::BeginWrite(DWORD cbMin, BYTE** ppData)
+{
+    if (!ppData)
+    {
+        return E_POINTER;
+    }
+
+    if (!m_pSink)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    DWORD cbContiguous = 0;
+
+    (void)WaitForSpace(cbMin);
+
+    return m_Ring.BeginWrite(cbMin, ppData, &cbContiguous);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: CommitWrite
+//
+// Publishes data written at the pointer from BeginWrite and submits
+// the buffers it completes.
+//
+// cbData: Number of bytes written, a partial block at the end is dropped
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFAudioStream::CommitWrite(DWORD cbData)
+{
+    cbData -= cbData % m_Ring.GetBlockAlign();
+
+    HRESULT hr = m_Ring.CommitWrite(cbData);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    OnWritten(cbData);
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Write
+//
+// Copies data into the ring and submits the buffers it completes.
+// Waits for the sink while the ring is full.
+//
+// Returns S_FALSE if the ring could not take all of the data; the
+// rest is dropped and counted.
+//
+// pData: PCM data
+// cbData: Size of the data in bytes, partial blocks are dropped
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFAudioStream::Write(const BYTE* pData, DWORD cbData)
+{
+    if (!pData && (cbData > 0))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (!m_pSink)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    DWORD nBlockAlign = m_Ring.GetBlockAlign();
+    DWORD cbCopied = 0;
+
+    while (cbData - cbCopied >= nBlockAlign)
+    {
+        DWORD cbLeft = cbData - cbCopied;
+
+        (void)WaitForSpace((cbLeft < m_cbBuffer) ? cbLeft : m_cbBuffer);
+
+        DWORD cbChunk = m_Ring.GetWritable();
+
+        if (cbChunk > cbLeft)
+        {
+            cbChunk = cbLeft;
+        }
+
+        cbChunk -= cbChunk % nBlockAlign;
+
+        if (cbChunk == 0)
+        {
+            break;
+        }
+
+        HRESULT hr = m_Ring.Write(pData + cbCopied, cbChunk);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        OnWritten(cbChunk);
+
+        cbCopied += cbChunk;
+    }
+
+    if (cbCopied < cbData)
+    {
+        CASFAutoLock lock(m_Lock);
+
+        m_Stats.cbDropped += cbData - cbCopied;
+
+        return S_FALSE;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: EndOfStream
+//
+// Marks the end of the decoded data, so the last, partial buffer goes
+// out too.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFAudioStream::EndOfStream()
+{
+    CASFAutoLock lock(m_Lock);
+
+    m_fEndOfStream = TRUE;
+
+    return Pump();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Replay
+//
+// Sends the data written since Reset to the sink once more, stopping
+// the output first if it is still playing. Possible while the data has
+// not been overwritten, that is while everything written since Reset
+// fits in the ring. Called by the writer thread.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFAudioStream::Replay()
+{
+    if (!m_pSink)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    if ((m_cbWritten == 0) || (m_cbWritten > m_Ring.GetCapacity()))
+    {
+        return MF_E_INVALIDREQUEST;
+    }
+
+    HRESULT hr = StopSink();
+
+    CASFAutoLock lock(m_Lock);
+
+    m_fStopping = FALSE;
+
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    hr = m_Ring.Rewind((DWORD)m_cbWritten);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    m_iNextSubmit = 0;
+    m_iNextDone = 0;
+    m_cbInFlight = 0;
+
+    m_fEndOfStream = TRUE;
+
+    return Pump();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: IsPlaying
+//
+// Returns TRUE while the sink holds buffers.
+/////////////////////////////////////////////////////////////////////
+
+BOOL CASFAudioStream::IsPlaying() const
+{
+    return ASFLoadAcquire((volatile LONG*)&m_cInFlight) > 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetStats
+//
+// Returns the statistics since Reset.
+/////////////////////////////////////////////////////////////////////
+
+void CASFAudioStream::GetStats(ASF_AUDIO_STREAM_STATS* pStats)
+{
+    if (!pStats)
+    {
+        return;
+    }
+
+    CASFAutoLock lock(m_Lock);
+
+    *pStats = m_Stats;
+    pStats->cbDropped += m_Ring.GetDroppedBytes();
+}
+
+// ----- IASFAudioSinkCallback Methods -----------------------------------------------
+
+/////////////////////////////////////////////////////////////////////
+// Name: OnBufferDone
+//
+// Frees the span of a buffer the sink handed back and submits the
+// next one. Spans are freed in submit order.
+/////////////////////////////////////////////////////////////////////
+
+void CASFAudioStream::OnBufferDone(DWORD iBuffer)
+{
+    CASFAutoLock lock(m_Lock);
+
+    if ((iBuffer >= m_cBuffers) || (m_cInFlight == 0))
+    {
+        return;
+    }
+
+    m_Buffers[iBuffer].fDone = TRUE;
+
+    while ((m_cInFlight > 0) && m_Buffers[m_iNextDone].fDone)
+    {
+        BUFFER* pBuffer = &m_Buffers[m_iNextDone];
+
+        (void)m_Ring.CommitRead(pBuffer->cbData);
+
+        m_cbInFlight -= pBuffer->cbData;
+
+        pBuffer->cbData = 0;
+        pBuffer->fDone = FALSE;
+
+        m_iNextDone = (m_iNextDone + 1) % m_cBuffers;
+
+        ASFStoreRelease(&m_cInFlight, m_cInFlight - 1);
+    }
+
+    (void)Pump();
+}
+
+// ----- Private Methods -----------------------------------------------
+
+/////////////////////////////////////////////////////////////////////
+// Name: StopSink
+//
+// Resets the sink and waits until it has handed back every buffer.
+// Leaves m_fStopping set, so the buffers handed back do not submit new
+// ones; the caller clears it.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFAudioStream::StopSink()
+{
+    HRESULT hr = S_OK;
+
+    {
+        CASFAutoLock lock(m_Lock);
+
+        m_fStopping = TRUE;
+    }
+
+    if (m_pSink)
+    {
+        hr = m_pSink->Reset();
+    }
+
+    //The sink may hand the buffers back on its own thread, which takes
+    //the lock, so wait without holding it
+    DWORD cSpins = 0;
+
+    while (SUCCEEDED(hr) && (ASFLoadAcquire(&m_cInFlight) > 0))
+    {
+        if (++cSpins < ASF_AUDIO_STREAM_SPIN_COUNT)
+        {
+            CASFThread::YieldThread();
+        }
+        else
+        {
+            CASFThread::SleepThread(1);
+        }
+    }
+
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Pump
+//
+// Submits the data in the ring that the sink does not hold yet, while
+// the sink has room for more buffers. Data short of a whole buffer is
+// held back until more arrives, unless it ends at the wrap-around
+// point of the ring or the stream has ended. Called with the lock held.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFAudioStream::Pump()
+{
+    //A sink that hands buffers back from inside Submit calls back in
+    //here; the loop on the stack picks up the freed room
+    if (m_fPumping || m_fStopping || !m_pSink)
+    {
+        return S_OK;
+    }
+
+    m_fPumping = TRUE;
+
+    HRESULT hr = S_OK;
+
+    while ((DWORD)m_cInFlight < m_cBuffers)
+    {
+        const BYTE* pData = NULL;
+        DWORD cbData = 0;
+
+        if (m_Ring.GetReadRegion(m_cbInFlight, &pData, &cbData) != S_OK)
+        {
+            break;
+        }
+
+        DWORD cbPending = m_Ring.GetReadable() - m_cbInFlight;
+
+        if (cbData > m_cbBuffer)
+        {
+            cbData = m_cbBuffer;
+        }
+
+        if ((cbData < m_cbBuffer) && (cbData == cbPending) && !m_fEndOfStream)
+        {
+            break;
+        }
+
+        DWORD iBuffer = m_iNextSubmit;
+
+        m_Buffers[iBuffer].cbData = cbData;
+        m_Buffers[iBuffer].fDone = FALSE;
+
+        m_iNextSubmit = (iBuffer + 1) % m_cBuffers;
+        m_cbInFlight += cbData;
+        ASFStoreRelease(&m_cInFlight, m_cInFlight + 1);
+
+        if ((m_Stats.cBuffers == 0) && (m_llFirstWrite != 0))
+        {
+            m_Stats.hnsFirstBufferLatency = CASFThread::GetTimestamp() - m_llFirstWrite;
+        }
+
+        m_Stats.cBuffers++;
+        m_Stats.cbSubmitted += cbData;
+
+        if ((DWORD)m_cInFlight > m_Stats.cMaxInFlight)
+        {
+            m_Stats.cMaxInFlight = (DWORD)m_cInFlight;
+        }
+
+        hr = m_pSink->Submit(iBuffer, pData, cbData);
+
+        if (FAILED(hr))
+        {
+            //The sink did not take the buffer, so it is the last one out
+            m_Buffers[iBuffer].cbData = 0;
+            m_iNextSubmit = iBuffer;
+            m_cbInFlight -= cbData;
+            ASFStoreRelease(&m_cInFlight, m_cInFlight - 1);
+
+            m_Stats.cBuffers--;
+            m_Stats.cbSubmitted -= cbData;
+            break;
+        }
+    }
+
+    m_fPumping = FALSE;
+
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: WaitForSpace
+//
+// Waits until the ring has cbData free bytes, as long as the sink
+// holds buffers that will free space. Returns S_FALSE if the space is
+// not there.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFAudioStream::WaitForSpace(DWORD cbData)
+{
+    DWORD cSpins = 0;
+
+    while (m_Ring.GetWritable() < cbData)
+    {
+        if (!IsPlaying())
+        {
+            return S_FALSE;
+        }
+
+        if (cSpins == 0)
+        {
+            CASFAutoLock lock(m_Lock);
+
+            m_Stats.cWriterWaits++;
+        }
+
+        if (++cSpins < ASF_AUDIO_STREAM_SPIN_COUNT)
+        {
+            CASFThread::YieldThread();
+        }
+        else
+        {
+            CASFThread::SleepThread(1);
+        }
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: OnWritten
+//
+// Accounts for data the writer added and submits what it completes.
+/////////////////////////////////////////////////////////////////////
+
+void CASFAudioStream::OnWritten(DWORD cbData)
+{
+    CASFAutoLock lock(m_Lock);
+
+    if (m_llFirstWrite == 0)
+    {
+        m_llFirstWrite = CASFThread::GetTimestamp();
+    }
+
+    m_cbWritten += cbData;
+    m_fEndOfStream = FALSE;
+
+    (void)Pump();
+}
@@ -0,0 +1,130 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFAudioStream.h : CASFAudioStream class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFAudioSink.h"
+#include "ASFPcmRing.h"
+#include "ASFThread.h"
+
+struct ASF_AUDIO_STREAM_STATS
+{
+    QWORD   cBuffers;               // Buffers submitted to the sink
+    QWORD   cbSubmitted;
+    QWORD   cbDropped;              // Data the full ring could not take
+    QWORD   cWriterWaits;           // Writes that waited for the sink
+    DWORD   cMaxInFlight;
+    MFTIME  hnsFirstBufferLatency;  // First write to first submitted buffer
+};
+
+
+//Streams decoded PCM audio to a sink through a fixed set of rotating
+//buffers.
+//
+//The decoder writes into a CASFPcmRing. As soon as a buffer's worth
+//of data is in the ring it is submitted to the sink, without a copy:
+//the buffers are spans of the ring. Up to cBuffers spans are queued on
+//the sink at a time; each one the sink hands back frees its span and
+//lets the next one go out. Output starts after the first buffer and
+//runs while the rest is decoded.
+//
+//The writer is one thread. The sink may hand buffers back on another
+//thread, which then submits the next ones, so the submit side is
+//serialized by a lock; the writer only takes it to submit.
+
+class CASFAudioStream : public IASFAudioSinkCallback
+{
+public:
+
+    CASFAudioStream();
+    ~CASFAudioStream();
+
+    HRESULT Initialize(
+        IASFAudioSink* pSink,
+        const ASF_MEDIA_FORMAT& format,
+        DWORD cbCapacity,
+        DWORD cBuffers,
+        MFTIME hnsBufferDuration
+        );
+
+    //Resets the stream and closes the sink. The caller deletes the sink.
+    HRESULT Shutdown();
+
+    //Stops the output and empties the ring
+    HRESULT Reset();
+
+    //Writer
+    HRESULT BeginWrite(DWORD cbMin, BYTE** ppData);
+
+    HRESULT CommitWrite(DWORD cbData);
+
+    HRESULT Write(const BYTE* pData, DWORD cbData);
+
+    //Submits the data that does not fill a whole buffer
+    HRESULT EndOfStream();
+
+    //Plays everything written since Reset again, if the ring still holds it
+    HRESULT Replay();
+
+    BOOL IsPlaying() const;
+
+    void GetStats(ASF_AUDIO_STREAM_STATS* pStats);
+
+    // IASFAudioSinkCallback methods
+    void OnBufferDone(DWORD iBuffer);
+
+private:
+
+    //Not copyable
+    CASFAudioStream(const CASFAudioStream&);
+    CASFAudioStream& operator=(const CASFAudioStream&);
+
+    struct BUFFER
+    {
+        DWORD   cbData;
+        BOOL    fDone;
+    };
+
+    HRESULT StopSink();
+
+    HRESULT Pump();
+
+    HRESULT WaitForSpace(DWORD cbData);
+
+    void OnWritten(DWORD cbData);
+
+    CASFLock        m_Lock;
+
+    CASFPcmRing     m_Ring;
+
+    IASFAudioSink*  m_pSink;
+
+    DWORD           m_nAvgBytesPerSec;
+    DWORD           m_cbBuffer;             // Size of a full buffer, whole blocks
+    DWORD           m_cBuffers;
+
+    BUFFER          m_Buffers[ASF_AUDIO_SINK_MAX_BUFFERS];
+    DWORD           m_iNextSubmit;
+    DWORD           m_iNextDone;
+    volatile LONG   m_cInFlight;            // Buffers the sink holds
+    DWORD           m_cbInFlight;           // Readable data the sink holds
+
+    BOOL            m_fEndOfStream;
+    BOOL            m_fStopping;            // Reset is waiting for the sink
+    BOOL            m_fPumping;             // Pump is on the stack
+
+    QWORD           m_cbWritten;            // Since Reset, for Replay
+    LONGLONG        m_llFirstWrite;
+
+    ASF_AUDIO_STREAM_STATS  m_Stats;
+};
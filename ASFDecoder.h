@@ -0,0 +1,99 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFDecoder.h : Decoder interface shared by all decoder backends.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFFormat.h"
+
+//Decoder backends
+#define ASF_DECODER_BACKEND_AUTO    0   // MFT for compressed streams, raw otherwise
+#define ASF_DECODER_BACKEND_MFT     1   // Media Foundation decoder MFT (Windows)
+#define ASF_DECODER_BACKEND_RAW     2   // Uncompressed PCM audio and RGB video
+#define ASF_DECODER_BACKEND_NULL    3   // Consumes samples without decoding
+
+
+//Format of the decoded output. Audio is PCM, video is RGB32.
+
+struct ASF_MEDIA_FORMAT
+{
+    GUID    guidMajorType;      // ASF_Audio_Media or ASF_Video_Media
+
+    //Audio
+    WORD    nChannels;
+    DWORD   nSamplesPerSec;
+    WORD    nBlockAlign;
+    WORD    wBitsPerSample;
+
+    //Video
+    DWORD   dwWidth;
+    DWORD   dwHeight;
+    LONG    lStride;            // Bytes per row, negative for bottom-up rows
+
+    DWORD   cbMaxOutput;        // Largest output of one decode call, 0 if none
+};
+
+
+//One compressed sample. pContext optionally carries the framework
+//sample the data came from, for backends of the same framework that
+//can consume it without wrapping the data again.
+
+struct ASF_DECODER_INPUT
+{
+    const BYTE* pData;
+    DWORD       cbData;
+    MFTIME      hnsTime;
+    MFTIME      hnsDuration;
+    BOOL        fKeyFrame;
+    BOOL        fDiscontinuity;
+    void*       pContext;
+};
+
+
+//Receives decoded output. The decoder asks the sink for memory and
+//decodes straight into it, so the sink decides where the data lands.
+
+class IASFDecoderSink
+{
+public:
+
+    virtual ~IASFDecoderSink() {}
+
+    //Returns at least cbMaxOutput writable bytes for the next output
+    virtual HRESULT GetOutputBuffer(DWORD cbMaxOutput, BYTE** ppBuffer) = 0;
+
+    //Reports that cbData bytes were written to the last buffer returned
+    virtual HRESULT OnOutput(const BYTE* pData, DWORD cbData, MFTIME hnsTime) = 0;
+};
+
+
+//Decoder instance, independent of the framework that implements it.
+//Instances are owned by one user at a time and destroyed with delete.
+
+class IASFDecoder
+{
+public:
+
+    virtual ~IASFDecoder() {}
+
+    virtual HRESULT Start() = 0;
+
+    virtual HRESULT Stop() = 0;
+
+    //Drops any data buffered from an earlier stream
+    virtual HRESULT Flush() = 0;
+
+    virtual HRESULT GetOutputFormat(ASF_MEDIA_FORMAT* pFormat) = 0;
+
+    //Decodes one sample; each output goes to pSink as it is produced
+    virtual HRESULT Decode(const ASF_DECODER_INPUT& input, IASFDecoderSink* pSink) = 0;
+};
@@ -0,0 +1,273 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFDecoderPool.cpp : CASFDecoderPool class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include "ASFDecoderPool.h"
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFDecoderPool
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFDecoderPool::CASFDecoderPool()
+:   m_cEntries (0),
+    m_cMaxDecoders (ASF_DECODER_POOL_DEFAULT_SIZE),
+    m_qwSequence (0)
+{
+    memset(m_Entries, 0, sizeof(m_Entries));
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFDecoderPool
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFDecoderPool::~CASFDecoderPool()
+{
+    Clear();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: SetMaxSize
+//
+// Sets the number of idle decoders the pool keeps. Extra decoders are
+// destroyed right away, least recently used first. 0 disables pooling.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFDecoderPool::SetMaxSize(DWORD cMaxDecoders)
+{
+    if (cMaxDecoders > ASF_DECODER_POOL_MAX_SIZE)
+    {
+        return E_INVALIDARG;
+    }
+
+    m_cMaxDecoders = cMaxDecoders;
+
+    Trim(m_cMaxDecoders);
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Checkout
+//
+// Takes a decoder configured for the key out of the pool and flushes
+// it. The caller owns the decoder until it returns it with Checkin.
+//
+// key: Input the decoder must be configured for
+// ppDecoder: Receives the decoder, or NULL on a miss
+//
+// Returns S_OK on a hit and S_FALSE on a miss.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFDecoderPool::Checkout(const ASF_DECODER_KEY& key, IASFDecoder** ppDecoder)
+{
+    if (!ppDecoder)
+    {
+        return E_POINTER;
+    }
+
+    *ppDecoder = NULL;
+
+    //Most recently returned first
+    for (;;)
+    {
+        DWORD iBest = m_cEntries;
+
+        for (DWORD i = 0; i < m_cEntries; i++)
+        {
+            if (Matches(m_Entries[i], key) &&
+                ((iBest == m_cEntries) || (m_Entries[i].qwLastUsed > m_Entries[iBest].qwLastUsed)))
+            {
+                iBest = i;
+            }
+        }
+
+        if (iBest == m_cEntries)
+        {
+            break;
+        }
+
+        IASFDecoder* pDecoder = m_Entries[iBest].pDecoder;
+
+        Remove(iBest, FALSE);
+
+        //A decoder that cannot be flushed is not reused
+        if (FAILED(pDecoder->Flush()))
+        {
+            delete pDecoder;
+            m_Stats.cEvictions++;
+            continue;
+        }
+
+        m_Stats.cHits++;
+        *ppDecoder = pDecoder;
+        return S_OK;
+    }
+
+    m_Stats.cMisses++;
+    return S_FALSE;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Checkin
+//
+// Returns a decoder to the pool, which takes ownership of it. If the
+// pool is full, the least recently used decoder is destroyed.
+//
+// key: Input the decoder is configured for. The format is copied.
+// pDecoder: Decoder to keep
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFDecoderPool::Checkin(const ASF_DECODER_KEY& key, IASFDecoder* pDecoder)
+{
+    if (!pDecoder || (!key.pFormat && (key.cbFormat > 0)))
+    {
+        return E_INVALIDARG;
+    }
+
+    BYTE* pFormat = NULL;
+
+    if (m_cMaxDecoders == 0)
+    {
+        delete pDecoder;
+        m_Stats.cEvictions++;
+        return S_OK;
+    }
+
+    if (key.cbFormat > 0)
+    {
+        pFormat = new (std::nothrow) BYTE[key.cbFormat];
+
+        if (!pFormat)
+        {
+            delete pDecoder;
+            return E_OUTOFMEMORY;
+        }
+
+        memcpy(pFormat, key.pFormat, key.cbFormat);
+    }
+
+    Trim(m_cMaxDecoders - 1);
+
+    POOL_ENTRY& entry = m_Entries[m_cEntries++];
+
+    entry.dwBackend = key.dwBackend;
+    entry.guidMajorType = key.guidMajorType;
+    entry.guidSubtype = key.guidSubtype;
+    entry.pFormat = pFormat;
+    entry.cbFormat = key.cbFormat;
+    entry.pDecoder = pDecoder;
+    entry.qwLastUsed = ++m_qwSequence;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Clear
+//
+// Destroys all idle decoders. Call before shutting down the framework
+// the decoders come from.
+/////////////////////////////////////////////////////////////////////
+
+void CASFDecoderPool::Clear()
+{
+    while (m_cEntries > 0)
+    {
+        Remove(m_cEntries - 1, TRUE);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetStats
+//
+// Returns the hit, miss and eviction counters.
+/////////////////////////////////////////////////////////////////////
+
+void CASFDecoderPool::GetStats(ASF_DECODER_POOL_STATS* pStats) const
+{
+    if (pStats)
+    {
+        *pStats = m_Stats;
+        pStats->cIdle = m_cEntries;
+    }
+}
+
+void CASFDecoderPool::ResetStats()
+{
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+// ----- Protected Methods -----------------------------------------------
+
+BOOL CASFDecoderPool::Matches(const POOL_ENTRY& entry, const ASF_DECODER_KEY& key)
+{
+    return (entry.dwBackend == key.dwBackend) &&
+           (entry.guidMajorType == key.guidMajorType) &&
+           (entry.guidSubtype == key.guidSubtype) &&
+           (entry.cbFormat == key.cbFormat) &&
+           ((key.cbFormat == 0) || (memcmp(entry.pFormat, key.pFormat, key.cbFormat) == 0));
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Remove
+//
+// Removes an entry, destroying its decoder if fDestroy is TRUE. The
+// last entry takes its place.
+/////////////////////////////////////////////////////////////////////
+
+void CASFDecoderPool::Remove(DWORD iEntry, BOOL fDestroy)
+{
+    POOL_ENTRY& entry = m_Entries[iEntry];
+
+    if (fDestroy)
+    {
+        delete entry.pDecoder;
+    }
+
+    delete [] entry.pFormat;
+
+    entry = m_Entries[--m_cEntries];
+
+    memset(&m_Entries[m_cEntries], 0, sizeof(POOL_ENTRY));
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Trim
+//
+// Destroys least recently used decoders until at most cMaxDecoders
+// are left.
+/////////////////////////////////////////////////////////////////////
+
+void CASFDecoderPool::Trim(DWORD cMaxDecoders)
+{
+    while (m_cEntries > cMaxDecoders)
+    {
+        DWORD iOldest = 0;
+
+        for (DWORD i = 1; i < m_cEntries; i++)
+        {
+            if (m_Entries[i].qwLastUsed < m_Entries[iOldest].qwLastUsed)
+            {
+                iOldest = i;
+            }
+        }
+
+        Remove(iOldest, TRUE);
+        m_Stats.cEvictions++;
+    }
+}
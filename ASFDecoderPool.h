@@ -0,0 +1,95 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFDecoderPool.h : CASFDecoderPool class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFDecoder.h"
+
+#define ASF_DECODER_POOL_DEFAULT_SIZE   4
+#define ASF_DECODER_POOL_MAX_SIZE       16
+
+//Identifies the backend and input a decoder was configured for.
+//pFormat is a complete description of the input format, compared byte
+//for byte.
+
+struct ASF_DECODER_KEY
+{
+    DWORD       dwBackend;      // ASF_DECODER_BACKEND_*
+    GUID        guidMajorType;
+    GUID        guidSubtype;
+    const BYTE* pFormat;
+    DWORD       cbFormat;
+};
+
+
+struct ASF_DECODER_POOL_STATS
+{
+    QWORD   cHits;
+    QWORD   cMisses;
+    QWORD   cEvictions;
+    DWORD   cIdle;          // Decoders in the pool now
+};
+
+
+//Keeps configured decoders that are not in use, so that selecting a
+//stream with the same input format again skips creating and
+//configuring a new one. When the pool is full, the least recently
+//returned decoder is destroyed. The pool is not thread safe.
+
+class CASFDecoderPool
+{
+public:
+
+    CASFDecoderPool();
+    ~CASFDecoderPool();
+
+    HRESULT SetMaxSize(DWORD cMaxDecoders);
+
+    HRESULT Checkout(const ASF_DECODER_KEY& key, IASFDecoder** ppDecoder);
+
+    HRESULT Checkin(const ASF_DECODER_KEY& key, IASFDecoder* pDecoder);
+
+    void Clear();
+
+    void GetStats(ASF_DECODER_POOL_STATS* pStats) const;
+
+    void ResetStats();
+
+protected:
+
+    struct POOL_ENTRY
+    {
+        DWORD           dwBackend;
+        GUID            guidMajorType;
+        GUID            guidSubtype;
+        BYTE*           pFormat;
+        DWORD           cbFormat;
+        IASFDecoder*    pDecoder;
+        QWORD           qwLastUsed;     // Checkin sequence number
+    };
+
+    static BOOL Matches(const POOL_ENTRY& entry, const ASF_DECODER_KEY& key);
+
+    void Remove(DWORD iEntry, BOOL fDestroy);
+
+    void Trim(DWORD cMaxDecoders);
+
+protected:
+
+    POOL_ENTRY  m_Entries[ASF_DECODER_POOL_MAX_SIZE];
+    DWORD       m_cEntries;
+    DWORD       m_cMaxDecoders;
+    QWORD       m_qwSequence;
+
+    ASF_DECODER_POOL_STATS  m_Stats;
+};
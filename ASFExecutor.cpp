@@ -0,0 +1,320 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFExecutor.cpp : CASFExecutor class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include <string.h>
+#include "ASFExecutor.h"
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFExecutor
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFExecutor::CASFExecutor()
+:   m_WorkEvent (FALSE),
+    m_cThreads (0),
+    m_fShutdown (TRUE),
+    m_ppQueue (NULL),
+    m_cCapacity (0),
+    m_iHead (0),
+    m_cQueued (0)
+{
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFExecutor
+//  Description: Destructor. Runs the queued items and stops the threads.
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFExecutor::~CASFExecutor()
+{
+    Shutdown();
+
+    delete [] m_ppQueue;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Start
+//
+// Starts the worker threads. An executor that was shut down can be
+// started again.
+//
+// cThreads: Number of threads, 0 for one per processor
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFExecutor::Start(DWORD cThreads)
+{
+    if (m_cThreads > 0)
+    {
+        return MF_E_INVALIDREQUEST;
+    }
+
+    if (cThreads == 0)
+    {
+        cThreads = CASFThread::GetProcessorCount();
+    }
+
+    if (cThreads > ASF_EXECUTOR_MAX_THREADS)
+    {
+        cThreads = ASF_EXECUTOR_MAX_THREADS;
+    }
+
+    HRESULT hr = S_OK;
+
+    {
+        CASFAutoLock lock(m_Lock);
+
+        if (!m_ppQueue)
+        {
+            hr = GrowQueue();
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+        }
+
+        m_fShutdown = FALSE;
+    }
+
+    for (DWORD i = 0; i < cThreads; i++)
+    {
+        hr = m_Threads[i].Start(WorkerProc, this);
+        if (FAILED(hr))
+        {
+            break;
+        }
+
+        m_cThreads++;
+    }
+
+    if (FAILED(hr))
+    {
+        Shutdown();
+        return hr;
+    }
+
+    m_Stats.cThreads = m_cThreads;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Shutdown
+//
+// Stops accepting work, lets the threads run what is queued and waits
+// for them. Items that submit themselves again from now on get
+// MF_E_SHUTDOWN and must complete without the executor.
+/////////////////////////////////////////////////////////////////////
+
+void CASFExecutor::Shutdown()
+{
+    {
+        CASFAutoLock lock(m_Lock);
+        m_fShutdown = TRUE;
+    }
+
+    //Each thread that stops wakes the next one
+    m_WorkEvent.Set();
+
+    for (DWORD i = 0; i < m_cThreads; i++)
+    {
+        m_Threads[i].Join();
+    }
+
+    m_cThreads = 0;
+    m_Stats.cThreads = 0;
+
+    //Stale wake-ups must not carry over to a restart
+    m_WorkEvent.Reset();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Submit
+//
+// Queues an item behind the ones already queued.
+//
+// pItem: Item to run. The caller keeps it alive until Run is called.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFExecutor::Submit(IASFWorkItem* pItem)
+{
+    if (!pItem)
+    {
+        return E_POINTER;
+    }
+
+    {
+        CASFAutoLock lock(m_Lock);
+
+        if (m_fShutdown)
+        {
+            return MF_E_SHUTDOWN;
+        }
+
+        if (m_cQueued == m_cCapacity)
+        {
+            HRESULT hr = GrowQueue();
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+        }
+
+        m_ppQueue[(m_iHead + m_cQueued) % m_cCapacity] = pItem;
+        m_cQueued++;
+
+        m_Stats.cSubmitted++;
+
+        if (m_cQueued > m_Stats.cMaxQueued)
+        {
+            m_Stats.cMaxQueued = m_cQueued;
+        }
+    }
+
+    m_WorkEvent.Set();
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetStats
+//
+// Returns the counters since the executor was created.
+/////////////////////////////////////////////////////////////////////
+
+void CASFExecutor::GetStats(ASF_EXECUTOR_STATS* pStats)
+{
+    CASFAutoLock lock(m_Lock);
+
+    *pStats = m_Stats;
+    pStats->cQueued = m_cQueued;
+}
+
+// ----- Private Methods -----------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Name: WorkerProc
+// Desc: Entry point of the worker threads.
+//
+// Note: This is a static method. Runs items until the executor is shut
+//       down and the queue is empty.
+//-----------------------------------------------------------------------------
+
+void CASFExecutor::WorkerProc(void* pContext)
+{
+    CASFExecutor* pThis = (CASFExecutor*)pContext;
+
+    for (;;)
+    {
+        IASFWorkItem* pItem = pThis->GetNextItem();
+
+        if (pItem)
+        {
+            pItem->Run();
+            continue;
+        }
+
+        {
+            CASFAutoLock lock(pThis->m_Lock);
+
+            if (pThis->m_fShutdown && (pThis->m_cQueued == 0))
+            {
+                break;
+            }
+        }
+
+        (void)pThis->m_WorkEvent.Wait(ASF_WAIT_INFINITE);
+    }
+
+    pThis->m_WorkEvent.Set();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetNextItem
+//
+// Takes the oldest item off the queue, or returns NULL. The event can
+// hold only one wake-up, so a thread that leaves items behind wakes
+// another thread for them.
+/////////////////////////////////////////////////////////////////////
+
+IASFWorkItem* CASFExecutor::GetNextItem()
+{
+    IASFWorkItem* pItem = NULL;
+    BOOL fMore = FALSE;
+
+    {
+        CASFAutoLock lock(m_Lock);
+
+        if (m_cQueued == 0)
+        {
+            return NULL;
+        }
+
+        pItem = m_ppQueue[m_iHead];
+
+        m_iHead = (m_iHead + 1) % m_cCapacity;
+        m_cQueued--;
+
+        m_Stats.cRun++;
+
+        fMore = (m_cQueued > 0);
+    }
+
+    if (fMore)
+    {
+        m_WorkEvent.Set();
+    }
+
+    return pItem;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GrowQueue
+//
+// Doubles the queue, keeping the queued items in order. Called with
+// the lock held.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFExecutor::GrowQueue()
+{
+    DWORD cCapacity = (m_cCapacity == 0) ? ASF_EXECUTOR_QUEUE_SIZE : m_cCapacity * 2;
+
+    if (cCapacity <= m_cCapacity)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    IASFWorkItem** ppQueue = new (std::nothrow) IASFWorkItem*[cCapacity];
+
+    if (!ppQueue)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    for (DWORD i = 0; i < m_cQueued; i++)
+    {
+        ppQueue[i] = m_ppQueue[(m_iHead + i) % m_cCapacity];
+    }
+
+    delete [] m_ppQueue;
+
+    m_ppQueue = ppQueue;
+    m_cCapacity = cCapacity;
+    m_iHead = 0;
+
+    return S_OK;
+}
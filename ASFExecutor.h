@@ -0,0 +1,97 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFExecutor.h : CASFExecutor class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFThread.h"
+
+//Upper bound on the number of executor threads
+#define ASF_EXECUTOR_MAX_THREADS        64
+
+//Initial size of the work queue; it grows as needed
+#define ASF_EXECUTOR_QUEUE_SIZE         64
+
+
+//Unit of work run by CASFExecutor on one of its threads. The executor
+//does not reference the item after Run returns, so an item that is
+//not done can submit itself again from Run.
+
+class IASFWorkItem
+{
+public:
+
+    virtual ~IASFWorkItem() {}
+
+    virtual void Run() = 0;
+};
+
+
+struct ASF_EXECUTOR_STATS
+{
+    DWORD   cThreads;
+    QWORD   cSubmitted;
+    QWORD   cRun;
+    DWORD   cQueued;
+    DWORD   cMaxQueued;
+};
+
+
+//Fixed set of worker threads that run work items in submission order.
+//Any number of items can be queued; long jobs are expected to run in
+//slices and submit themselves again, so queued jobs take turns on the
+//threads.
+
+class CASFExecutor
+{
+public:
+
+    CASFExecutor();
+    ~CASFExecutor();
+
+    HRESULT Start(DWORD cThreads);
+
+    //Runs the items already queued, then stops the threads. Submit
+    //fails from the start of the call.
+    void Shutdown();
+
+    HRESULT Submit(IASFWorkItem* pItem);
+
+    void GetStats(ASF_EXECUTOR_STATS* pStats);
+
+private:
+
+    //Not copyable
+    CASFExecutor(const CASFExecutor&);
+    CASFExecutor& operator=(const CASFExecutor&);
+
+    static void WorkerProc(void* pContext);
+
+    IASFWorkItem* GetNextItem();
+
+    HRESULT GrowQueue();
+
+    CASFLock        m_Lock;
+    CASFEvent       m_WorkEvent;        // Auto-reset, set for each queued item
+
+    CASFThread      m_Threads[ASF_EXECUTOR_MAX_THREADS];
+    DWORD           m_cThreads;
+    BOOL            m_fShutdown;        // Not running, Submit fails
+
+    //Circular queue
+    IASFWorkItem**  m_ppQueue;
+    DWORD           m_cCapacity;
+    DWORD           m_iHead;
+    DWORD           m_cQueued;
+
+    ASF_EXECUTOR_STATS  m_Stats;
+};
@@ -0,0 +1,215 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFFormat.h : ASF object identifiers, layout constants and
+//               little-endian field readers.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string.h>
+#include "ASFTypes.h"
+
+//Object sizes
+#define ASF_OBJECT_HEADER_SIZE          24      // Object ID + Object Size
+#define ASF_HEADER_OBJECT_SIZE          30      // Header Object without its children
+#define ASF_DATA_OBJECT_HEADER_SIZE     50      // Data Object up to the first data packet
+#define ASF_FILE_PROPERTIES_SIZE        104
+#define ASF_STREAM_PROPERTIES_MIN_SIZE  78
+#define ASF_HEADER_EXTENSION_MIN_SIZE   46
+#define ASF_EXT_STREAM_PROPERTIES_MIN_SIZE 88
+
+//Stream numbers are 7 bits wide, 0 is not a valid stream number
+#define ASF_MAX_STREAMS                 128
+
+//File Properties Object flags
+#define ASF_FILE_FLAG_BROADCAST         0x00000001
+#define ASF_FILE_FLAG_SEEKABLE          0x00000002
+
+//Index objects
+#define ASF_SIMPLE_INDEX_HEADER_SIZE    56      // Up to the first index entry
+#define ASF_SIMPLE_INDEX_ENTRY_SIZE     6       // Packet number + packet count
+#define ASF_INDEX_HEADER_SIZE           34      // Up to the first index specifier
+#define ASF_INDEX_SPECIFIER_SIZE        4       // Stream number + index type
+#define ASF_INDEX_INVALID_OFFSET        0xFFFFFFFF
+
+//Index Object index types
+#define ASF_INDEX_NEAREST_PAST_DATA_PACKET  1
+#define ASF_INDEX_NEAREST_PAST_MEDIA_OBJECT 2
+#define ASF_INDEX_NEAREST_PAST_CLEANPOINT   3
+
+//Data packet: error correction flags (first byte, if its top bit is set)
+#define ASF_EC_PRESENT                  0x80
+#define ASF_EC_LENGTH_TYPE_MASK         0x60    // Must be 00
+#define ASF_EC_DATA_LENGTH_MASK         0x0F
+
+//Data packet: length type flags
+#define ASF_PACKET_MULTIPLE_PAYLOADS    0x01
+#define ASF_SEQUENCE_TYPE_SHIFT         1
+#define ASF_PADDING_LENGTH_TYPE_SHIFT   3
+#define ASF_PACKET_LENGTH_TYPE_SHIFT    5
+
+//Data packet: property flags
+#define ASF_REPLICATED_LENGTH_TYPE_SHIFT    0
+#define ASF_OFFSET_LENGTH_TYPE_SHIFT        2
+#define ASF_OBJECT_NUMBER_LENGTH_TYPE_SHIFT 4
+#define ASF_STREAM_NUMBER_LENGTH_TYPE_SHIFT 6
+
+//Data packet: payload flags (multiple payloads only)
+#define ASF_PAYLOAD_COUNT_MASK          0x3F
+#define ASF_PAYLOAD_LENGTH_TYPE_SHIFT   6
+
+//Payload stream number byte
+#define ASF_PAYLOAD_KEY_FRAME           0x80
+#define ASF_PAYLOAD_STREAM_NUMBER_MASK  0x7F
+
+//A replicated data length of 1 marks compressed payload data; the
+//replicated byte is then the presentation time delta
+#define ASF_COMPRESSED_REPLICATED_LENGTH 1
+
+//Replicated data: media object size + presentation time
+#define ASF_REPLICATED_DATA_MIN_SIZE    8
+
+//2-bit length type field: 0 = absent, 1 = BYTE, 2 = WORD, 3 = DWORD
+#define ASF_LENGTH_TYPE(bFlags, shift)  (((bFlags) >> (shift)) & 0x03)
+
+//Top-level objects
+static const GUID ASF_Header_Object =
+    { 0x75B22630, 0x668E, 0x11CF, { 0xA6, 0xD9, 0x00, 0xAA, 0x00, 0x62, 0xCE, 0x6C } };
+static const GUID ASF_Data_Object =
+    { 0x75B22636, 0x668E, 0x11CF, { 0xA6, 0xD9, 0x00, 0xAA, 0x00, 0x62, 0xCE, 0x6C } };
+static const GUID ASF_Simple_Index_Object =
+    { 0x33000890, 0xE5B1, 0x11CF, { 0x89, 0xF4, 0x00, 0xA0, 0xC9, 0x03, 0x49, 0xCB } };
+static const GUID ASF_Index_Object =
+    { 0xD6E229D3, 0x35DA, 0x11D1, { 0x90, 0x34, 0x00, 0xA0, 0xC9, 0x03, 0x49, 0xBE } };
+
+//Header Object children
+static const GUID ASF_File_Properties_Object =
+    { 0x8CABDCA1, 0xA947, 0x11CF, { 0x8E, 0xE4, 0x00, 0xC0, 0x0C, 0x20, 0x53, 0x65 } };
+static const GUID ASF_Stream_Properties_Object =
+    { 0xB7DC0791, 0xA9B7, 0x11CF, { 0x8E, 0xE6, 0x00, 0xC0, 0x0C, 0x20, 0x53, 0x65 } };
+static const GUID ASF_Header_Extension_Object =
+    { 0x5FBF03B5, 0xA92E, 0x11CF, { 0x8E, 0xE3, 0x00, 0xC0, 0x0C, 0x20, 0x53, 0x65 } };
+
+//Header Extension Object children
+static const GUID ASF_Extended_Stream_Properties_Object =
+    { 0x14E6A5CB, 0xC672, 0x4332, { 0x83, 0x99, 0xA9, 0x69, 0x52, 0x06, 0x5B, 0x5A } };
+
+//Stream types
+static const GUID ASF_Audio_Media =
+    { 0xF8699E40, 0x5B4D, 0x11CF, { 0xA8, 0xFD, 0x00, 0x80, 0x5F, 0x5C, 0x44, 0x2B } };
+static const GUID ASF_Video_Media =
+    { 0xBC19EFC0, 0x5B4D, 0x11CF, { 0xA8, 0xFD, 0x00, 0x80, 0x5F, 0x5C, 0x44, 0x2B } };
+static const GUID ASF_Command_Media =
+    { 0x59DACFC0, 0x59E6, 0x11D0, { 0xA3, 0xAC, 0x00, 0xA0, 0xC9, 0x03, 0x48, 0xF6 } };
+
+
+//////////////////////////////////////////////////////////////////////////
+//  Little-endian field readers. The callers check bounds; the readers
+//  only take care of alignment and byte order.
+/////////////////////////////////////////////////////////////////////////
+
+inline WORD ASFReadWord(const BYTE* p)
+{
+    return (WORD)(p[0] | (p[1] << 8));
+}
+
+inline DWORD ASFReadDWord(const BYTE* p)
+{
+    return (DWORD)p[0] | ((DWORD)p[1] << 8) | ((DWORD)p[2] << 16) | ((DWORD)p[3] << 24);
+}
+
+inline QWORD ASFReadQWord(const BYTE* p)
+{
+    return (QWORD)ASFReadDWord(p) | ((QWORD)ASFReadDWord(p + 4) << 32);
+}
+
+inline GUID ASFReadGUID(const BYTE* p)
+{
+    GUID guid;
+
+    guid.Data1 = ASFReadDWord(p);
+    guid.Data2 = ASFReadWord(p + 4);
+    guid.Data3 = ASFReadWord(p + 6);
+    memcpy(guid.Data4, p + 8, sizeof(guid.Data4));
+
+    return guid;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Little-endian field writers, for the files the parser saves next to
+//  or about media files.
+/////////////////////////////////////////////////////////////////////////
+
+inline void ASFWriteWord(BYTE* p, WORD w)
+{
+    p[0] = (BYTE)w;
+    p[1] = (BYTE)(w >> 8);
+}
+
+inline void ASFWriteDWord(BYTE* p, DWORD dw)
+{
+    ASFWriteWord(p, (WORD)dw);
+    ASFWriteWord(p + 2, (WORD)(dw >> 16));
+}
+
+inline void ASFWriteQWord(BYTE* p, QWORD qw)
+{
+    ASFWriteDWord(p, (DWORD)qw);
+    ASFWriteDWord(p + 4, (DWORD)(qw >> 32));
+}
+
+inline void ASFWriteGUID(BYTE* p, const GUID& guid)
+{
+    ASFWriteDWord(p, guid.Data1);
+    ASFWriteWord(p + 4, guid.Data2);
+    ASFWriteWord(p + 6, guid.Data3);
+    memcpy(p + 8, guid.Data4, sizeof(guid.Data4));
+}
+
+//Size in bytes of a field with the given 2-bit length type
+inline DWORD ASFLengthTypeSize(DWORD dwLengthType)
+{
+    return (dwLengthType == 3) ? 4 : dwLengthType;
+}
+
+//Whole packets of a Data Object whose packets start cbDataOffset bytes
+//into a file of cbFile bytes. The Data Object size is not trusted past
+//the end of the file; 0 if the packet size or data offset is unknown.
+inline QWORD ASFGetPacketCount(QWORD cbFile, QWORD cbDataOffset, QWORD cbDataLength, DWORD cbPacketSize)
+{
+    if ((cbPacketSize == 0) || (cbDataOffset == 0) || (cbDataOffset > cbFile))
+    {
+        return 0;
+    }
+
+    QWORD cbAvailable = cbFile - cbDataOffset;
+
+    return ((cbDataLength < cbAvailable) ? cbDataLength : cbAvailable) / cbPacketSize;
+}
+
+//Reads a field with the given 2-bit length type; absent fields read as 0
+inline DWORD ASFReadLengthType(const BYTE* p, DWORD dwLengthType)
+{
+    switch (dwLengthType)
+    {
+    case 1:
+        return p[0];
+
+    case 2:
+        return ASFReadWord(p);
+
+    case 3:
+        return ASFReadDWord(p);
+
+    default:
+        return 0;
+    }
+}
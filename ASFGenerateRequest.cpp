@@ -0,0 +1,296 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFGenerateRequest.cpp : CASFGenerateRequest class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include <string.h>
+#include "ASFGenerateRequest.h"
+
+/////////////////////////////////////////////////////////////////////
+// Name: CreateInstance
+//
+// Creates a request for a reader. The reader and the executor must
+// outlive the request.
+//
+// pReader: Opened reader, used by no other generation
+// pExecutor: Started executor that runs the request
+// pCompletion: Receives the result. May be NULL.
+// ppRequest: Receives the request with one reference
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFGenerateRequest::CreateInstance(
+    CASFReader* pReader,
+    CASFExecutor* pExecutor,
+    IASFGenerateCallback* pCompletion,
+    CASFGenerateRequest** ppRequest
+    )
+{
+    if (!pReader || !pExecutor || !ppRequest)
+    {
+        return E_POINTER;
+    }
+
+    CASFGenerateRequest* pRequest = new (std::nothrow) CASFGenerateRequest(pReader, pExecutor, pCompletion);
+
+    if (!pRequest)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    *ppRequest = pRequest;
+
+    return S_OK;
+}
+
+// ----- Public Methods -----------------------------------------------
+
+/////////////////////////////////////////////////////////////////////
+// Name: Start
+//
+// Queues the first slice. The seek runs on the executor as well, so
+// Start does not touch the file.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFGenerateRequest::Start(
+    WORD wStreamNumber,
+    MFTIME hnsStartTime,
+    MFTIME hnsDuration,
+    DWORD dwFlags,
+    IASFReaderCallback* pCallback
+    )
+{
+    if (m_fQueued)
+    {
+        return MF_E_INVALIDREQUEST;
+    }
+
+    m_wStreamNumber = wStreamNumber;
+    m_hnsStartTime = hnsStartTime;
+    m_hnsDuration = hnsDuration;
+    m_dwFlags = dwFlags;
+    m_pCallback = pCallback;
+
+    //The executor holds a reference while a slice is queued or running
+    AddRef();
+
+    m_fQueued = TRUE;
+
+    HRESULT hr = m_pExecutor->Submit(this);
+
+    if (FAILED(hr))
+    {
+        m_fQueued = FALSE;
+        Release();
+    }
+
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Cancel
+//
+// Asks the request to stop. It completes with E_ABORT after the read
+// in progress, unless it completes first.
+/////////////////////////////////////////////////////////////////////
+
+void CASFGenerateRequest::Cancel()
+{
+    ASFStoreRelease(&m_fCancel, TRUE);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Wait
+//
+// Waits for the request to complete and returns its result.
+//
+// dwMilliseconds: Timeout, or ASF_WAIT_INFINITE
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFGenerateRequest::Wait(DWORD dwMilliseconds)
+{
+    if (!m_fQueued)
+    {
+        return MF_E_INVALIDREQUEST;
+    }
+
+    if (!m_DoneEvent.Wait(dwMilliseconds))
+    {
+        return E_PENDING;
+    }
+
+    CASFAutoLock lock(m_Lock);
+
+    return m_hrStatus;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: IsComplete
+//
+// Returns TRUE once the result is set.
+/////////////////////////////////////////////////////////////////////
+
+BOOL CASFGenerateRequest::IsComplete()
+{
+    CASFAutoLock lock(m_Lock);
+
+    return m_fComplete;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetProgress
+//
+// Returns the progress as of the last completed slice.
+/////////////////////////////////////////////////////////////////////
+
+void CASFGenerateRequest::GetProgress(ASF_GENERATE_PROGRESS* pProgress)
+{
+    CASFAutoLock lock(m_Lock);
+
+    *pProgress = m_Progress;
+}
+
+ULONG CASFGenerateRequest::AddRef()
+{
+    return ASFInterlockedIncrement(&m_nRefCount);
+}
+
+ULONG CASFGenerateRequest::Release()
+{
+    ULONG uCount = ASFInterlockedDecrement(&m_nRefCount);
+    if (uCount == 0)
+    {
+        delete this;
+    }
+    return uCount;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Run
+//
+// Runs one slice on an executor thread: the seek first, then one read
+// per slice. A request that is not done queues itself again, keeping
+// the executor's reference; otherwise it completes and releases it.
+/////////////////////////////////////////////////////////////////////
+
+void CASFGenerateRequest::Run()
+{
+    HRESULT hr = S_OK;
+    BOOL fComplete = FALSE;
+
+    if (ASFLoadAcquire(&m_fCancel))
+    {
+        hr = E_ABORT;
+    }
+    else if (!m_fGenerating)
+    {
+        hr = m_pReader->BeginGenerate(m_wStreamNumber, m_hnsStartTime, m_hnsDuration, m_dwFlags, m_pCallback);
+
+        m_fGenerating = SUCCEEDED(hr);
+    }
+    else
+    {
+        hr = m_pReader->GenerateNext(&fComplete);
+    }
+
+    if (m_fGenerating)
+    {
+        CASFAutoLock lock(m_Lock);
+        m_pReader->GetGenerateProgress(&m_Progress);
+    }
+
+    if (SUCCEEDED(hr) && !fComplete)
+    {
+        hr = m_pExecutor->Submit(this);
+        if (SUCCEEDED(hr))
+        {
+            return;
+        }
+    }
+
+    Complete(hr);
+
+    Release();
+}
+
+// ----- Private Methods -----------------------------------------------
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFGenerateRequest
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFGenerateRequest::CASFGenerateRequest(
+    CASFReader* pReader,
+    CASFExecutor* pExecutor,
+    IASFGenerateCallback* pCompletion
+    )
+:   m_nRefCount (1),
+    m_pReader (pReader),
+    m_pExecutor (pExecutor),
+    m_pCompletion (pCompletion),
+    m_wStreamNumber (0),
+    m_hnsStartTime (0),
+    m_hnsDuration (0),
+    m_dwFlags (0),
+    m_pCallback (NULL),
+    m_fQueued (FALSE),
+    m_fGenerating (FALSE),
+    m_DoneEvent (TRUE),
+    m_fCancel (FALSE),
+    m_fComplete (FALSE),
+    m_hrStatus (E_PENDING)
+{
+    memset(&m_Progress, 0, sizeof(m_Progress));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFGenerateRequest
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFGenerateRequest::~CASFGenerateRequest()
+{
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Complete
+//
+// Ends the generation on the reader, stores the result and tells the
+// caller: first the completion callback, then the waiters.
+//
+// hrStatus: Result of the request
+/////////////////////////////////////////////////////////////////////
+
+void CASFGenerateRequest::Complete(HRESULT hrStatus)
+{
+    if (m_fGenerating)
+    {
+        m_pReader->EndGenerate();
+        m_fGenerating = FALSE;
+    }
+
+    {
+        CASFAutoLock lock(m_Lock);
+
+        m_hrStatus = hrStatus;
+        m_fComplete = TRUE;
+    }
+
+    if (m_pCompletion)
+    {
+        m_pCompletion->OnGenerateComplete(this, hrStatus);
+    }
+
+    m_DoneEvent.Set();
+}
@@ -0,0 +1,121 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFGenerateRequest.h : CASFGenerateRequest class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFReader.h"
+#include "ASFExecutor.h"
+
+class CASFGenerateRequest;
+
+//Receives the result of a CASFGenerateRequest
+
+class IASFGenerateCallback
+{
+public:
+
+    virtual ~IASFGenerateCallback() {}
+
+    //Called once, on an executor thread. E_ABORT means the request was
+    //canceled. The request must not be waited on from here.
+    virtual void OnGenerateComplete(CASFGenerateRequest* pRequest, HRESULT hrStatus) = 0;
+};
+
+
+//CASFReader::GenerateSamples run on a CASFExecutor instead of the
+//calling thread.
+//
+//The request runs in slices of one read of the reader; after each one
+//it goes to the back of the executor queue, so any number of requests
+//share a fixed set of threads and a canceled request stops within one
+//read. The samples go to the reader callback on the executor threads.
+//
+//The caller holds a reference and can poll the progress, cancel, wait
+//for the result like a future, or get it through a callback. Each
+//request needs a reader of its own while it runs.
+
+class CASFGenerateRequest : public IASFWorkItem
+{
+public:
+
+    static HRESULT CreateInstance(
+        CASFReader* pReader,
+        CASFExecutor* pExecutor,
+        IASFGenerateCallback* pCompletion,
+        CASFGenerateRequest** ppRequest
+        );
+
+    //Queues the generation; the parameters are those of
+    //CASFReader::GenerateSamples. The completion callback is only
+    //called if Start succeeds.
+    HRESULT Start(
+        WORD wStreamNumber,
+        MFTIME hnsStartTime,
+        MFTIME hnsDuration,
+        DWORD dwFlags,
+        IASFReaderCallback* pCallback
+        );
+
+    void Cancel();
+
+    //Returns the result, or E_PENDING if the request is not complete
+    //within dwMilliseconds
+    HRESULT Wait(DWORD dwMilliseconds);
+
+    BOOL IsComplete();
+
+    void GetProgress(ASF_GENERATE_PROGRESS* pProgress);
+
+    ULONG AddRef();
+
+    ULONG Release();
+
+    // IASFWorkItem methods
+    void Run();
+
+private:
+
+    CASFGenerateRequest(CASFReader* pReader, CASFExecutor* pExecutor, IASFGenerateCallback* pCompletion);
+    ~CASFGenerateRequest();
+
+    //Not copyable
+    CASFGenerateRequest(const CASFGenerateRequest&);
+    CASFGenerateRequest& operator=(const CASFGenerateRequest&);
+
+    void Complete(HRESULT hrStatus);
+
+    volatile LONG           m_nRefCount;
+
+    CASFReader*             m_pReader;
+    CASFExecutor*           m_pExecutor;
+    IASFGenerateCallback*   m_pCompletion;
+
+    //Parameters of Start
+    WORD                    m_wStreamNumber;
+    MFTIME                  m_hnsStartTime;
+    MFTIME                  m_hnsDuration;
+    DWORD                   m_dwFlags;
+    IASFReaderCallback*     m_pCallback;
+
+    //Executor side
+    BOOL                    m_fQueued;          // Start succeeded
+    BOOL                    m_fGenerating;      // BeginGenerate succeeded
+
+    //Shared with the caller
+    CASFLock                m_Lock;
+    CASFEvent               m_DoneEvent;        // Manual-reset, set after the completion callback
+    volatile LONG           m_fCancel;
+    BOOL                    m_fComplete;
+    HRESULT                 m_hrStatus;
+    ASF_GENERATE_PROGRESS   m_Progress;
+};
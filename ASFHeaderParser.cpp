@@ -0,0 +1,652 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFHeaderParser.cpp : CASFHeaderParser class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "ASFHeaderParser.h"
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFHeaderParser
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFHeaderParser::CASFHeaderParser()
+{
+    Reset();
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: Reset
+//  Description: Forgets the previously parsed header
+//
+/////////////////////////////////////////////////////////////////////////
+
+void CASFHeaderParser::Reset()
+{
+    m_fParsed = FALSE;
+    m_fHasFileProperties = FALSE;
+
+    m_cbHeader = 0;
+    m_cbDataOffset = 0;
+    m_cbDataLength = 0;
+    m_cTotalDataPackets = 0;
+
+    m_FileProperties = FILE_PROPERTIES_OBJECT();
+    m_FileProperties.guidFileID = GUID_NULL;
+    m_FileProperties.ftCreationTime.dwLowDateTime = 0;
+    m_FileProperties.ftCreationTime.dwHighDateTime = 0;
+
+    m_cStreams = 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetHeaderSize
+//
+// Validates the ASF Header Object and returns its total size.
+//
+// pData:     Pointer to the start of the file.
+// cbData:    Number of valid bytes at pData, at least ASF_HEADER_OBJECT_SIZE.
+// pcbHeader: Receives the size of the Header Object in bytes.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFHeaderParser::GetHeaderSize(const BYTE* pData, QWORD cbData, QWORD* pcbHeader)
+{
+    if (!pData || !pcbHeader)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (cbData < ASF_HEADER_OBJECT_SIZE)
+    {
+        return MF_E_ASF_PARSINGINCOMPLETE;
+    }
+
+    if (ASFReadGUID(pData) != ASF_Header_Object)
+    {
+        return MF_E_INVALID_FILE_FORMAT;
+    }
+
+    QWORD cbHeader = ASFReadQWord(pData + 16);
+
+    if (cbHeader < ASF_HEADER_OBJECT_SIZE)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    *pcbHeader = cbHeader;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetFileID
+//
+// Returns the File ID of the File Properties Object without parsing
+// the other header objects; only the object headers before it are
+// read.
+//
+// pData:       Pointer to the start of the file (the Header Object).
+// cbData:      Number of valid bytes at pData.
+// pguidFileID: Receives the File ID.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFHeaderParser::GetFileID(const BYTE* pData, QWORD cbData, GUID* pguidFileID)
+{
+    if (!pguidFileID)
+    {
+        return E_INVALIDARG;
+    }
+
+    QWORD cbHeader = 0;
+
+    HRESULT hr = GetHeaderSize(pData, cbData, &cbHeader);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (cbHeader > cbData)
+    {
+        return MF_E_ASF_PARSINGINCOMPLETE;
+    }
+
+    DWORD cObjects = ASFReadDWord(pData + 24);
+
+    const BYTE* pObject = pData + ASF_HEADER_OBJECT_SIZE;
+    QWORD cbRemaining = cbHeader - ASF_HEADER_OBJECT_SIZE;
+
+    for (DWORD index = 0; (index < cObjects) && (cbRemaining >= ASF_OBJECT_HEADER_SIZE); index++)
+    {
+        QWORD cbObject = ASFReadQWord(pObject + 16);
+
+        if ((cbObject < ASF_OBJECT_HEADER_SIZE) || (cbObject > cbRemaining))
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        if (ASFReadGUID(pObject) == ASF_File_Properties_Object)
+        {
+            if (cbObject < ASF_FILE_PROPERTIES_SIZE)
+            {
+                return MF_E_ASF_INVALIDDATA;
+            }
+
+            *pguidFileID = ASFReadGUID(pObject + 24);
+            return S_OK;
+        }
+
+        pObject += cbObject;
+        cbRemaining -= cbObject;
+    }
+
+    return MF_E_ASF_INVALIDDATA;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Parse
+//
+// Walks the objects of the ASF Header Object in place. Nothing is
+// copied out of the span; stream information keeps pointers into it,
+// so the span must stay valid while the parser is in use.
+//
+// pData:  Pointer to the start of the file (the Header Object).
+// cbData: Number of valid bytes at pData. If the span also covers the
+//         Data Object header, the data offsets are filled in as well.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFHeaderParser::Parse(const BYTE* pData, QWORD cbData)
+{
+    Reset();
+
+    QWORD cbHeader = 0;
+
+    HRESULT hr = GetHeaderSize(pData, cbData, &cbHeader);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (cbHeader > cbData)
+    {
+        return MF_E_ASF_PARSINGINCOMPLETE;
+    }
+
+    DWORD cObjects = ASFReadDWord(pData + 24);
+
+    const BYTE* pObject = pData + ASF_HEADER_OBJECT_SIZE;
+    QWORD cbRemaining = cbHeader - ASF_HEADER_OBJECT_SIZE;
+
+    for (DWORD index = 0; (index < cObjects) && (cbRemaining >= ASF_OBJECT_HEADER_SIZE); index++)
+    {
+        GUID  guidObject = ASFReadGUID(pObject);
+        QWORD cbObject = ASFReadQWord(pObject + 16);
+
+        if ((cbObject < ASF_OBJECT_HEADER_SIZE) || (cbObject > cbRemaining))
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        if (guidObject == ASF_File_Properties_Object)
+        {
+            hr = ParseFileProperties(pObject, cbObject);
+        }
+        else if (guidObject == ASF_Stream_Properties_Object)
+        {
+            hr = ParseStreamProperties(pObject, cbObject);
+        }
+        else if (guidObject == ASF_Header_Extension_Object)
+        {
+            hr = ParseHeaderExtension(pObject, cbObject);
+        }
+
+        //Other objects (metadata, codec list, ...) are skipped
+
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        pObject += cbObject;
+        cbRemaining -= cbObject;
+    }
+
+    if (!m_fHasFileProperties)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    m_cbHeader = cbHeader;
+
+    //The Data Object immediately follows the Header Object
+    if (cbData - cbHeader >= ASF_DATA_OBJECT_HEADER_SIZE)
+    {
+        hr = ParseDataObjectHeader(pData + cbHeader, cbData - cbHeader);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+    }
+
+    m_fParsed = TRUE;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetFileProperties
+//
+// Fills the caller's FILE_PROPERTIES_OBJECT from the parsed header.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFHeaderParser::GetFileProperties(FILE_PROPERTIES_OBJECT* pFileInfo) const
+{
+    if (!pFileInfo)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (!m_fParsed)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    *pFileInfo = m_FileProperties;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetStream
+//
+// Returns the stream information at the specified index, in the
+// order the streams appear in the header.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFHeaderParser::GetStream(DWORD dwIndex, const ASF_STREAM_PROPERTIES** ppStream) const
+{
+    if (!ppStream)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (dwIndex >= m_cStreams)
+    {
+        return MF_E_INVALIDINDEX;
+    }
+
+    *ppStream = &m_Streams[dwIndex];
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetVideoStreams
+//
+// Lists the video stream numbers in header order, the order in which
+// Simple Index Objects apply to them. Returns the number of streams.
+//
+// pwStreamNumbers: Receives the stream numbers; room for
+//                  ASF_MAX_STREAMS entries.
+/////////////////////////////////////////////////////////////////////
+
+DWORD CASFHeaderParser::GetVideoStreams(WORD* pwStreamNumbers) const
+{
+    DWORD cVideoStreams = 0;
+
+    for (DWORD i = 0; i < m_cStreams; i++)
+    {
+        if (m_Streams[i].guidStreamType == ASF_Video_Media)
+        {
+            pwStreamNumbers[cVideoStreams++] = m_Streams[i].wStreamNumber;
+        }
+    }
+
+    return cVideoStreams;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetStreamByNumber
+//
+// Returns the stream information for the specified stream number.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFHeaderParser::GetStreamByNumber(WORD wStreamNumber, const ASF_STREAM_PROPERTIES** ppStream) const
+{
+    if (!ppStream)
+    {
+        return E_INVALIDARG;
+    }
+
+    for (DWORD index = 0; index < m_cStreams; index++)
+    {
+        if (m_Streams[index].wStreamNumber == wStreamNumber)
+        {
+            *ppStream = &m_Streams[index];
+            return S_OK;
+        }
+    }
+
+    return MF_E_INVALIDSTREAMNUMBER;
+}
+
+// ----- Private Methods -----------------------------------------------
+
+/////////////////////////////////////////////////////////////////////
+// Name: ParseFileProperties
+//
+// Reads the File Properties Object directly into FILE_PROPERTIES_OBJECT.
+// Durations are converted the same way the presentation descriptor
+// reports them: preroll in hns, presentation duration without preroll.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFHeaderParser::ParseFileProperties(const BYTE* pObject, QWORD cbObject)
+{
+    if (cbObject < ASF_FILE_PROPERTIES_SIZE)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    QWORD ftCreationTime = ASFReadQWord(pObject + 48);
+    QWORD cPackets = ASFReadQWord(pObject + 56);
+
+    m_FileProperties.guidFileID = ASFReadGUID(pObject + 24);
+    m_FileProperties.ftCreationTime.dwLowDateTime = (DWORD)ftCreationTime;
+    m_FileProperties.ftCreationTime.dwHighDateTime = (DWORD)(ftCreationTime >> 32);
+    m_FileProperties.cPackets = (UINT32)cPackets;
+    m_FileProperties.hnsPlayDuration = ASFReadQWord(pObject + 64);
+    m_FileProperties.hnsSendDuration = ASFReadQWord(pObject + 72);
+    m_FileProperties.hnspreroll = ASFReadQWord(pObject + 80) * 10000;     // Pre-roll is in msec
+    m_FileProperties.flags = ASFReadDWord(pObject + 88);
+    m_FileProperties.cbMinPacketSize = ASFReadDWord(pObject + 92);
+    m_FileProperties.cbMaxPacketSize = ASFReadDWord(pObject + 96);
+    m_FileProperties.MaxBitRate = ASFReadDWord(pObject + 100);
+
+    if (m_FileProperties.hnsPlayDuration > m_FileProperties.hnspreroll)
+    {
+        m_FileProperties.hnsPresentationDuration =
+            m_FileProperties.hnsPlayDuration - m_FileProperties.hnspreroll;
+    }
+    else
+    {
+        m_FileProperties.hnsPresentationDuration = 0;
+    }
+
+    m_cTotalDataPackets = cPackets;
+    m_fHasFileProperties = TRUE;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ParseStreamProperties
+//
+// Records one Stream Properties Object. The type-specific and error
+// correction data are referenced in place.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFHeaderParser::ParseStreamProperties(const BYTE* pObject, QWORD cbObject)
+{
+    if (cbObject < ASF_STREAM_PROPERTIES_MIN_SIZE)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    DWORD cbTypeSpecificData = ASFReadDWord(pObject + 64);
+    DWORD cbErrorCorrectionData = ASFReadDWord(pObject + 68);
+    WORD  wFlags = ASFReadWord(pObject + 72);
+
+    if ((QWORD)cbTypeSpecificData + cbErrorCorrectionData > cbObject - ASF_STREAM_PROPERTIES_MIN_SIZE)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    WORD wStreamNumber = (WORD)(wFlags & 0x7F);
+
+    if (wStreamNumber == 0)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    ASF_STREAM_PROPERTIES* pStream = FindOrAddStream(wStreamNumber);
+    if (!pStream)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    pStream->guidStreamType = ASFReadGUID(pObject + 24);
+    pStream->guidErrorCorrectionType = ASFReadGUID(pObject + 40);
+    pStream->hnsTimeOffset = ASFReadQWord(pObject + 56);
+    pStream->fEncrypted = (wFlags & 0x8000) ? TRUE : FALSE;
+    pStream->pTypeSpecificData = pObject + ASF_STREAM_PROPERTIES_MIN_SIZE;
+    pStream->cbTypeSpecificData = cbTypeSpecificData;
+    pStream->pErrorCorrectionData = pStream->pTypeSpecificData + cbTypeSpecificData;
+    pStream->cbErrorCorrectionData = cbErrorCorrectionData;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ParseHeaderExtension
+//
+// Walks the objects nested in the Header Extension Object.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFHeaderParser::ParseHeaderExtension(const BYTE* pObject, QWORD cbObject)
+{
+    if (cbObject < ASF_HEADER_EXTENSION_MIN_SIZE)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    HRESULT hr = S_OK;
+
+    QWORD cbRemaining = ASFReadDWord(pObject + 42);
+
+    if (cbRemaining > cbObject - ASF_HEADER_EXTENSION_MIN_SIZE)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    const BYTE* pChild = pObject + ASF_HEADER_EXTENSION_MIN_SIZE;
+
+    while (cbRemaining >= ASF_OBJECT_HEADER_SIZE)
+    {
+        GUID  guidObject = ASFReadGUID(pChild);
+        QWORD cbChild = ASFReadQWord(pChild + 16);
+
+        if ((cbChild < ASF_OBJECT_HEADER_SIZE) || (cbChild > cbRemaining))
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        if (guidObject == ASF_Extended_Stream_Properties_Object)
+        {
+            hr = ParseExtendedStreamProperties(pChild, cbChild);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+        }
+
+        pChild += cbChild;
+        cbRemaining -= cbChild;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ParseExtendedStreamProperties
+//
+// Reads the bitrate, object size and frame duration of a stream, and
+// the Stream Properties Object that may be embedded at the end.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFHeaderParser::ParseExtendedStreamProperties(const BYTE* pObject, QWORD cbObject)
+{
+    if (cbObject < ASF_EXT_STREAM_PROPERTIES_MIN_SIZE)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    WORD wStreamNumber = (WORD)(ASFReadWord(pObject + 72) & 0x7F);
+
+    if (wStreamNumber == 0)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    ASF_STREAM_PROPERTIES* pStream = FindOrAddStream(wStreamNumber);
+    if (!pStream)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    pStream->dwDataBitrate = ASFReadDWord(pObject + 40);
+    pStream->cbMaxObjectSize = ASFReadDWord(pObject + 64);
+    pStream->hnsAvgTimePerFrame = ASFReadQWord(pObject + 76);
+
+    WORD cStreamNames = ASFReadWord(pObject + 84);
+    WORD cPayloadExtensionSystems = ASFReadWord(pObject + 86);
+
+    const BYTE* p = pObject + ASF_EXT_STREAM_PROPERTIES_MIN_SIZE;
+    QWORD cbRemaining = cbObject - ASF_EXT_STREAM_PROPERTIES_MIN_SIZE;
+
+    //Skip Stream Names: Language ID Index (WORD), Name Length (WORD), Name
+    for (WORD index = 0; index < cStreamNames; index++)
+    {
+        if (cbRemaining < 4)
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        QWORD cbName = 4 + (QWORD)ASFReadWord(p + 2);
+
+        if (cbName > cbRemaining)
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        p += cbName;
+        cbRemaining -= cbName;
+    }
+
+    //Skip Payload Extension Systems: ID (GUID), Data Size (WORD), Info Length (DWORD), Info
+    for (WORD index = 0; index < cPayloadExtensionSystems; index++)
+    {
+        if (cbRemaining < 22)
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        QWORD cbSystem = 22 + (QWORD)ASFReadDWord(p + 18);
+
+        if (cbSystem > cbRemaining)
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        p += cbSystem;
+        cbRemaining -= cbSystem;
+    }
+
+    //Optional Stream Properties Object
+    if (cbRemaining >= ASF_STREAM_PROPERTIES_MIN_SIZE &&
+        ASFReadGUID(p) == ASF_Stream_Properties_Object)
+    {
+        QWORD cbChild = ASFReadQWord(p + 16);
+
+        if ((cbChild < ASF_STREAM_PROPERTIES_MIN_SIZE) || (cbChild > cbRemaining))
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        return ParseStreamProperties(p, cbChild);
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ParseDataObjectHeader
+//
+// Gets the bounds of the packet data from the Data Object header.
+//
+// pObject:     Pointer to the start of the Data Object.
+// cbAvailable: Number of valid bytes at pObject.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFHeaderParser::ParseDataObjectHeader(const BYTE* pObject, QWORD cbAvailable)
+{
+    if (cbAvailable < ASF_DATA_OBJECT_HEADER_SIZE)
+    {
+        return MF_E_ASF_PARSINGINCOMPLETE;
+    }
+
+    if (ASFReadGUID(pObject) != ASF_Data_Object)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    QWORD cbDataObject = ASFReadQWord(pObject + 16);
+    QWORD cPackets = ASFReadQWord(pObject + 40);
+
+    m_cbDataOffset = m_cbHeader + ASF_DATA_OBJECT_HEADER_SIZE;
+
+    if (cPackets != 0)
+    {
+        m_cTotalDataPackets = cPackets;
+    }
+
+    if (cbDataObject >= ASF_DATA_OBJECT_HEADER_SIZE &&
+        !(m_FileProperties.flags & ASF_FILE_FLAG_BROADCAST))
+    {
+        m_cbDataLength = cbDataObject - ASF_DATA_OBJECT_HEADER_SIZE;
+    }
+    else if (m_FileProperties.cbMinPacketSize == m_FileProperties.cbMaxPacketSize)
+    {
+        //The object size is not valid while the file is being written
+        m_cbDataLength = m_cTotalDataPackets * m_FileProperties.cbMinPacketSize;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: FindOrAddStream
+//
+// Returns the entry for a stream number, adding it if necessary.
+/////////////////////////////////////////////////////////////////////
+
+ASF_STREAM_PROPERTIES* CASFHeaderParser::FindOrAddStream(WORD wStreamNumber)
+{
+    for (DWORD index = 0; index < m_cStreams; index++)
+    {
+        if (m_Streams[index].wStreamNumber == wStreamNumber)
+        {
+            return &m_Streams[index];
+        }
+    }
+
+    if (m_cStreams >= ASF_MAX_STREAMS)
+    {
+        return NULL;
+    }
+
+    ASF_STREAM_PROPERTIES* pStream = &m_Streams[m_cStreams++];
+
+    memset(pStream, 0, sizeof(ASF_STREAM_PROPERTIES));
+    pStream->wStreamNumber = wStreamNumber;
+
+    return pStream;
+}
@@ -0,0 +1,121 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFHeaderParser.h : CASFHeaderParser class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFFormat.h"
+
+//Stream information collected from the Stream Properties Object and,
+//when present, the Extended Stream Properties Object of the stream.
+//The data pointers reference the span passed to CASFHeaderParser::Parse.
+
+struct ASF_STREAM_PROPERTIES
+{
+    WORD        wStreamNumber;
+    GUID        guidStreamType;
+    GUID        guidErrorCorrectionType;
+    QWORD       hnsTimeOffset;
+    BOOL        fEncrypted;
+
+    const BYTE* pTypeSpecificData;
+    DWORD       cbTypeSpecificData;
+    const BYTE* pErrorCorrectionData;
+    DWORD       cbErrorCorrectionData;
+
+    //Extended Stream Properties Object, zero if the object is missing
+    DWORD       dwDataBitrate;
+    DWORD       cbMaxObjectSize;
+    QWORD       hnsAvgTimePerFrame;
+};
+
+
+class CASFHeaderParser
+{
+public:
+
+    CASFHeaderParser();
+
+    static HRESULT GetHeaderSize(const BYTE* pData, QWORD cbData, QWORD* pcbHeader);
+
+    static HRESULT GetFileID(const BYTE* pData, QWORD cbData, GUID* pguidFileID);
+
+    HRESULT Parse(const BYTE* pData, QWORD cbData);
+
+    void Reset();
+
+    HRESULT GetFileProperties(FILE_PROPERTIES_OBJECT* pFileInfo) const;
+
+    DWORD GetStreamCount() const
+    {
+        return m_cStreams;
+    }
+
+    HRESULT GetStream(DWORD dwIndex, const ASF_STREAM_PROPERTIES** ppStream) const;
+
+    HRESULT GetStreamByNumber(WORD wStreamNumber, const ASF_STREAM_PROPERTIES** ppStream) const;
+
+    DWORD GetVideoStreams(WORD* pwStreamNumbers) const;
+
+    QWORD GetHeaderSize() const
+    {
+        return m_cbHeader;
+    }
+
+    //Offset from the start of the file to the first data packet.
+    //Zero if the span did not include the Data Object header.
+    QWORD GetDataOffset() const
+    {
+        return m_cbDataOffset;
+    }
+
+    //Length of the packet data that follows the Data Object header.
+    QWORD GetDataLength() const
+    {
+        return m_cbDataLength;
+    }
+
+    QWORD GetTotalDataPackets() const
+    {
+        return m_cTotalDataPackets;
+    }
+
+protected:
+
+    HRESULT ParseFileProperties(const BYTE* pObject, QWORD cbObject);
+
+    HRESULT ParseStreamProperties(const BYTE* pObject, QWORD cbObject);
+
+    HRESULT ParseHeaderExtension(const BYTE* pObject, QWORD cbObject);
+
+    HRESULT ParseExtendedStreamProperties(const BYTE* pObject, QWORD cbObject);
+
+    HRESULT ParseDataObjectHeader(const BYTE* pObject, QWORD cbAvailable);
+
+    ASF_STREAM_PROPERTIES* FindOrAddStream(WORD wStreamNumber);
+
+protected:
+
+    BOOL    m_fParsed;
+    BOOL    m_fHasFileProperties;
+
+    QWORD   m_cbHeader;
+    QWORD   m_cbDataOffset;
+    QWORD   m_cbDataLength;
+    QWORD   m_cTotalDataPackets;
+
+    FILE_PROPERTIES_OBJECT  m_FileProperties;
+
+    //Fixed table, so parsing does not allocate
+    DWORD                   m_cStreams;
+    ASF_STREAM_PROPERTIES   m_Streams[ASF_MAX_STREAMS];
+};
@@ -0,0 +1,583 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFIndexBuilder.cpp : CASFIndexBuilder class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include <stdio.h>
+#include "ASFIndexBuilder.h"
+
+static FILE* OpenSidecar(const ASF_PATH_CHAR* sSidecarName, BOOL fWrite);
+
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFIndexBuilder
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFIndexBuilder::CASFIndexBuilder()
+{
+    memset(m_Streams, 0, sizeof(m_Streams));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFIndexBuilder
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFIndexBuilder::~CASFIndexBuilder()
+{
+    Reset();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Build
+//
+// Walks the packets once and records, for every stream, the packet in
+// which a key frame starts, at most one entry per
+// ASF_INDEX_BUILDER_INTERVAL. Corrupt packets are skipped. The entries
+// replace the indexes of the streams in pIndex.
+//
+// pPackets: First data packet
+// cPackets: Number of packets
+// cbPacketSize: Fixed packet size
+// dwPreroll: Preroll in milliseconds, removed from the entry times
+// pIndex: Receives the stream indexes
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFIndexBuilder::Build(
+    const BYTE* pPackets,
+    QWORD cPackets,
+    DWORD cbPacketSize,
+    DWORD dwPreroll,
+    CASFIndexReader* pIndex
+    )
+{
+    if ((!pPackets && (cPackets > 0)) || !pIndex)
+    {
+        return E_POINTER;
+    }
+
+    ASF_PAYLOAD_INFO payload;
+
+    Reset();
+
+    HRESULT hr = m_PacketParser.Initialize(cbPacketSize);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    for (QWORD iPacket = 0; iPacket < cPackets; iPacket++)
+    {
+        QWORD cbOffset = iPacket * cbPacketSize;
+
+        if (FAILED(m_PacketParser.ParsePacket(pPackets + cbOffset, cbPacketSize, NULL)))
+        {
+            continue;
+        }
+
+        while (m_PacketParser.GetNextPayload(&payload) == S_OK)
+        {
+            if (!payload.fKeyFrame || (!payload.fCompressed && (payload.dwOffsetIntoMediaObject != 0)))
+            {
+                continue;
+            }
+
+            DWORD dwTime = (payload.dwPresentationTime > dwPreroll) ? payload.dwPresentationTime - dwPreroll : 0;
+
+            hr = AddEntry(payload.bStreamNumber, dwTime, cbOffset);
+            if (FAILED(hr))
+            {
+                goto done;
+            }
+        }
+    }
+
+    for (WORD wStreamNumber = 1; wStreamNumber < ASF_MAX_STREAMS; wStreamNumber++)
+    {
+        const BUILD_STREAM& stream = m_Streams[wStreamNumber];
+
+        if (stream.cEntries == 0)
+        {
+            continue;
+        }
+
+        hr = pIndex->SetStreamIndex(
+            wStreamNumber,
+            ASF_INDEX_NEAREST_PAST_CLEANPOINT,
+            stream.pdwTimes,
+            stream.pcbOffsets,
+            stream.cEntries
+            );
+
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+    }
+
+done:
+    Reset();
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: LoadOrBuild
+//
+// Loads the index sidecar of a file into pIndex. If there is none, or
+// it was written for another version of the file, the index is built
+// from the packets and saved as the new sidecar.
+//
+// Returns S_FALSE if the index was built but the sidecar could not be
+// written, for example next to a file on read-only media; the index
+// in pIndex is usable either way.
+//
+// sSidecarName: Path name of the sidecar, or NULL to only build
+// guidFileID: File ID of the file
+// cbDataLength: Size of the data object of the file
+// pPackets, cPackets, cbPacketSize, dwPreroll: As for Build
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFIndexBuilder::LoadOrBuild(
+    const ASF_PATH_CHAR* sSidecarName,
+    const GUID& guidFileID,
+    QWORD cbDataLength,
+    const BYTE* pPackets,
+    QWORD cPackets,
+    DWORD cbPacketSize,
+    DWORD dwPreroll,
+    CASFIndexReader* pIndex
+    )
+{
+    HRESULT hr = S_OK;
+
+    if (sSidecarName)
+    {
+        hr = LoadSidecar(sSidecarName, guidFileID, cbDataLength, pIndex);
+
+        if ((hr != MF_E_NOT_FOUND) && (hr != MF_E_INVALID_FILE_FORMAT))
+        {
+            return hr;
+        }
+    }
+
+    hr = Build(pPackets, cPackets, cbPacketSize, dwPreroll, pIndex);
+    if (FAILED(hr) || !sSidecarName)
+    {
+        return hr;
+    }
+
+    return SUCCEEDED(SaveSidecar(sSidecarName, guidFileID, cbDataLength, *pIndex)) ? S_OK : S_FALSE;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetSidecarName
+//
+// Allocates the path name of the index sidecar of a file: the file
+// name followed by ASF_INDEX_SIDECAR_EXTENSION. The caller releases
+// it with delete [].
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFIndexBuilder::GetSidecarName(const ASF_PATH_CHAR* sFileName, ASF_PATH_CHAR** ppsSidecarName)
+{
+    if (!sFileName || !ppsSidecarName)
+    {
+        return E_POINTER;
+    }
+
+    size_t cchFileName = 0;
+
+    while (sFileName[cchFileName] != 0)
+    {
+        cchFileName++;
+    }
+
+    //The extension with its terminator
+    const size_t cchExtension = sizeof(ASF_INDEX_SIDECAR_EXTENSION) / sizeof(ASF_PATH_CHAR);
+
+    ASF_PATH_CHAR* sSidecarName = new (std::nothrow) ASF_PATH_CHAR[cchFileName + cchExtension];
+
+    if (!sSidecarName)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    memcpy(sSidecarName, sFileName, cchFileName * sizeof(ASF_PATH_CHAR));
+    memcpy(sSidecarName + cchFileName, ASF_INDEX_SIDECAR_EXTENSION, cchExtension * sizeof(ASF_PATH_CHAR));
+
+    *ppsSidecarName = sSidecarName;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: SaveSidecar
+//
+// Writes the stream indexes to a sidecar file:
+//
+//   Header:  DWORD magic, WORD version, WORD stream count,
+//            GUID File ID, QWORD data object size
+//   Streams: WORD stream number, WORD index type, DWORD entry count,
+//            then the entry times (DWORD) and the offsets (QWORD)
+//
+// All values are little-endian, like the ASF objects. The sidecar is
+// assembled in memory and written at once.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFIndexBuilder::SaveSidecar(
+    const ASF_PATH_CHAR* sSidecarName,
+    const GUID& guidFileID,
+    QWORD cbDataLength,
+    const CASFIndexReader& index
+    )
+{
+    if (!sSidecarName)
+    {
+        return E_INVALIDARG;
+    }
+
+    const ASF_STREAM_INDEX* pStreamIndex = NULL;
+
+    BYTE* pSidecar = NULL;
+    BYTE* p = NULL;
+    FILE* pFile = NULL;
+
+    WORD cStreams = 0;
+    QWORD cbSidecar = ASF_INDEX_SIDECAR_HEADER_SIZE;
+
+    HRESULT hr = S_OK;
+
+    for (WORD w = 1; w < ASF_MAX_STREAMS; w++)
+    {
+        if (SUCCEEDED(index.GetStreamIndex(w, &pStreamIndex)))
+        {
+            cStreams++;
+            cbSidecar += ASF_INDEX_SIDECAR_STREAM_SIZE + (QWORD)pStreamIndex->cEntries * ASF_INDEX_SIDECAR_ENTRY_SIZE;
+        }
+    }
+
+    if (cStreams == 0)
+    {
+        return MF_E_ASF_NOINDEX;
+    }
+
+    if (cbSidecar > MAXDWORD)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    pSidecar = new (std::nothrow) BYTE[(size_t)cbSidecar];
+
+    if (!pSidecar)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    ASFWriteDWord(pSidecar, ASF_INDEX_SIDECAR_MAGIC);
+    ASFWriteWord(pSidecar + 4, ASF_INDEX_SIDECAR_VERSION);
+    ASFWriteWord(pSidecar + 6, cStreams);
+    ASFWriteGUID(pSidecar + 8, guidFileID);
+    ASFWriteQWord(pSidecar + 24, cbDataLength);
+
+    p = pSidecar + ASF_INDEX_SIDECAR_HEADER_SIZE;
+
+    for (WORD w = 1; w < ASF_MAX_STREAMS; w++)
+    {
+        if (FAILED(index.GetStreamIndex(w, &pStreamIndex)))
+        {
+            continue;
+        }
+
+        ASFWriteWord(p, w);
+        ASFWriteWord(p + 2, pStreamIndex->wIndexType);
+        ASFWriteDWord(p + 4, pStreamIndex->cEntries);
+        p += ASF_INDEX_SIDECAR_STREAM_SIZE;
+
+        for (DWORD i = 0; i < pStreamIndex->cEntries; i++, p += 4)
+        {
+            ASFWriteDWord(p, pStreamIndex->pdwTimes[i]);
+        }
+
+        for (DWORD i = 0; i < pStreamIndex->cEntries; i++, p += 8)
+        {
+            ASFWriteQWord(p, pStreamIndex->pcbOffsets[i]);
+        }
+    }
+
+    pFile = OpenSidecar(sSidecarName, TRUE);
+
+    if (!pFile)
+    {
+        hr = E_ACCESSDENIED;
+        goto done;
+    }
+
+    if (fwrite(pSidecar, (size_t)cbSidecar, 1, pFile) != 1)
+    {
+        hr = E_FAIL;
+    }
+
+    if (fclose(pFile) != 0)
+    {
+        hr = E_FAIL;
+    }
+
+done:
+    delete [] pSidecar;
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: LoadSidecar
+//
+// Reads a sidecar written by SaveSidecar into pIndex. Fails with
+// MF_E_NOT_FOUND if the sidecar is missing, and with
+// MF_E_INVALID_FILE_FORMAT if it belongs to another file or is damaged;
+// pIndex is left unchanged in either case.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFIndexBuilder::LoadSidecar(
+    const ASF_PATH_CHAR* sSidecarName,
+    const GUID& guidFileID,
+    QWORD cbDataLength,
+    CASFIndexReader* pIndex
+    )
+{
+    if (!sSidecarName || !pIndex)
+    {
+        return E_INVALIDARG;
+    }
+
+    CASFIndexReader loaded;
+
+    BYTE* pSidecar = NULL;
+    DWORD* pdwTimes = NULL;
+    QWORD* pcbOffsets = NULL;
+
+    const BYTE* p = NULL;
+    long cbSidecar = 0;
+    DWORD cbLeft = 0;
+    WORD cStreams = 0;
+
+    HRESULT hr = S_OK;
+
+    FILE* pFile = OpenSidecar(sSidecarName, FALSE);
+
+    if (!pFile)
+    {
+        return MF_E_NOT_FOUND;
+    }
+
+    if ((fseek(pFile, 0, SEEK_END) != 0) ||
+        ((cbSidecar = ftell(pFile)) < ASF_INDEX_SIDECAR_HEADER_SIZE) ||
+        (fseek(pFile, 0, SEEK_SET) != 0))
+    {
+        hr = MF_E_INVALID_FILE_FORMAT;
+        goto done;
+    }
+
+    pSidecar = new (std::nothrow) BYTE[cbSidecar];
+
+    if (!pSidecar)
+    {
+        hr = E_OUTOFMEMORY;
+        goto done;
+    }
+
+    if (fread(pSidecar, cbSidecar, 1, pFile) != 1)
+    {
+        hr = MF_E_INVALID_FILE_FORMAT;
+        goto done;
+    }
+
+    if ((ASFReadDWord(pSidecar) != ASF_INDEX_SIDECAR_MAGIC) ||
+        (ASFReadWord(pSidecar + 4) != ASF_INDEX_SIDECAR_VERSION) ||
+        (ASFReadGUID(pSidecar + 8) != guidFileID) ||
+        (ASFReadQWord(pSidecar + 24) != cbDataLength))
+    {
+        hr = MF_E_INVALID_FILE_FORMAT;
+        goto done;
+    }
+
+    cStreams = ASFReadWord(pSidecar + 6);
+
+    p = pSidecar + ASF_INDEX_SIDECAR_HEADER_SIZE;
+    cbLeft = (DWORD)cbSidecar - ASF_INDEX_SIDECAR_HEADER_SIZE;
+
+    for (WORD s = 0; s < cStreams; s++)
+    {
+        if (cbLeft < ASF_INDEX_SIDECAR_STREAM_SIZE)
+        {
+            hr = MF_E_INVALID_FILE_FORMAT;
+            goto done;
+        }
+
+        WORD wStreamNumber = ASFReadWord(p);
+        WORD wIndexType = ASFReadWord(p + 2);
+        DWORD cEntries = ASFReadDWord(p + 4);
+
+        p += ASF_INDEX_SIDECAR_STREAM_SIZE;
+        cbLeft -= ASF_INDEX_SIDECAR_STREAM_SIZE;
+
+        if ((wStreamNumber == 0) || (wStreamNumber >= ASF_MAX_STREAMS) ||
+            ((QWORD)cEntries * ASF_INDEX_SIDECAR_ENTRY_SIZE > cbLeft))
+        {
+            hr = MF_E_INVALID_FILE_FORMAT;
+            goto done;
+        }
+
+        pdwTimes = new (std::nothrow) DWORD[cEntries + 1];
+        pcbOffsets = new (std::nothrow) QWORD[cEntries + 1];
+
+        if (!pdwTimes || !pcbOffsets)
+        {
+            hr = E_OUTOFMEMORY;
+            goto done;
+        }
+
+        for (DWORD i = 0; i < cEntries; i++, p += 4)
+        {
+            pdwTimes[i] = ASFReadDWord(p);
+        }
+
+        for (DWORD i = 0; i < cEntries; i++, p += 8)
+        {
+            pcbOffsets[i] = ASFReadQWord(p);
+        }
+
+        cbLeft -= cEntries * ASF_INDEX_SIDECAR_ENTRY_SIZE;
+
+        hr = loaded.SetStreamIndex(wStreamNumber, wIndexType, pdwTimes, pcbOffsets, cEntries);
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+
+        delete [] pdwTimes;
+        delete [] pcbOffsets;
+        pdwTimes = NULL;
+        pcbOffsets = NULL;
+    }
+
+    //Copy the streams over only once the whole sidecar is valid
+    hr = pIndex->CopyFrom(loaded);
+
+done:
+    delete [] pdwTimes;
+    delete [] pcbOffsets;
+    delete [] pSidecar;
+    fclose(pFile);
+    return hr;
+}
+
+// ----- Protected Methods -----------------------------------------------
+
+/////////////////////////////////////////////////////////////////////
+// Name: AddEntry
+//
+// Appends an entry to a stream unless it is within
+// ASF_INDEX_BUILDER_INTERVAL of the previous one. Time-ordered input
+// is assumed; entries going back in time are dropped.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFIndexBuilder::AddEntry(BYTE bStreamNumber, DWORD dwTime, QWORD cbOffset)
+{
+    if (bStreamNumber >= ASF_MAX_STREAMS)
+    {
+        return S_OK;
+    }
+
+    BUILD_STREAM& stream = m_Streams[bStreamNumber];
+
+    if ((stream.cEntries > 0) &&
+        (dwTime < stream.pdwTimes[stream.cEntries - 1] + ASF_INDEX_BUILDER_INTERVAL))
+    {
+        return S_OK;
+    }
+
+    if (stream.cEntries == stream.cCapacity)
+    {
+        if (stream.cCapacity > 0x7FFFFFFF)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        DWORD cCapacity = (stream.cCapacity < 64) ? 64 : stream.cCapacity * 2;
+
+        DWORD* pdwTimes = new (std::nothrow) DWORD[cCapacity];
+        QWORD* pcbOffsets = new (std::nothrow) QWORD[cCapacity];
+
+        if (!pdwTimes || !pcbOffsets)
+        {
+            delete [] pdwTimes;
+            delete [] pcbOffsets;
+            return E_OUTOFMEMORY;
+        }
+
+        if (stream.cEntries > 0)
+        {
+            memcpy(pdwTimes, stream.pdwTimes, stream.cEntries * sizeof(DWORD));
+            memcpy(pcbOffsets, stream.pcbOffsets, stream.cEntries * sizeof(QWORD));
+        }
+
+        delete [] stream.pdwTimes;
+        delete [] stream.pcbOffsets;
+
+        stream.pdwTimes = pdwTimes;
+        stream.pcbOffsets = pcbOffsets;
+        stream.cCapacity = cCapacity;
+    }
+
+    stream.pdwTimes[stream.cEntries] = dwTime;
+    stream.pcbOffsets[stream.cEntries] = cbOffset;
+    stream.cEntries++;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Reset
+//
+// Releases the entries collected so far.
+/////////////////////////////////////////////////////////////////////
+
+void CASFIndexBuilder::Reset()
+{
+    for (DWORD i = 0; i < ASF_MAX_STREAMS; i++)
+    {
+        delete [] m_Streams[i].pdwTimes;
+        delete [] m_Streams[i].pcbOffsets;
+    }
+
+    memset(m_Streams, 0, sizeof(m_Streams));
+}
+
+// ----- Helpers -----------------------------------------------
+
+static FILE* OpenSidecar(const ASF_PATH_CHAR* sSidecarName, BOOL fWrite)
+{
+#ifdef _WIN32
+    FILE* pFile = NULL;
+
+    if (_wfopen_s(&pFile, sSidecarName, fWrite ? L"wb" : L"rb") != 0)
+    {
+        return NULL;
+    }
+
+    return pFile;
+#else
+    return fopen(sSidecarName, fWrite ? "wb" : "rb");
+#endif
+}
@@ -0,0 +1,99 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFIndexBuilder.h : CASFIndexBuilder class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFPacketParser.h"
+#include "ASFIndexReader.h"
+
+#define ASF_INDEX_BUILDER_INTERVAL      1000        // Milliseconds between built entries
+
+//Index sidecar file, stored next to the media file
+#ifdef _WIN32
+#define ASF_INDEX_SIDECAR_EXTENSION     L".asfidx"
+#else
+#define ASF_INDEX_SIDECAR_EXTENSION     ".asfidx"
+#endif
+#define ASF_INDEX_SIDECAR_MAGIC         0x58465341  // 'ASFX'
+#define ASF_INDEX_SIDECAR_VERSION       1
+#define ASF_INDEX_SIDECAR_HEADER_SIZE   32
+#define ASF_INDEX_SIDECAR_STREAM_SIZE   8
+#define ASF_INDEX_SIDECAR_ENTRY_SIZE    12
+
+
+//Builds a key frame index for files that have none, in one pass over
+//fixed-size packets, and saves or loads it as a sidecar file. The
+//sidecar records the File ID and the data object size of the file it
+//was built for and is only loaded for the same file.
+
+class CASFIndexBuilder
+{
+public:
+
+    CASFIndexBuilder();
+    ~CASFIndexBuilder();
+
+    HRESULT Build(
+        const BYTE* pPackets,
+        QWORD cPackets,
+        DWORD cbPacketSize,
+        DWORD dwPreroll,
+        CASFIndexReader* pIndex
+        );
+
+    HRESULT LoadOrBuild(
+        const ASF_PATH_CHAR* sSidecarName,
+        const GUID& guidFileID,
+        QWORD cbDataLength,
+        const BYTE* pPackets,
+        QWORD cPackets,
+        DWORD cbPacketSize,
+        DWORD dwPreroll,
+        CASFIndexReader* pIndex
+        );
+
+    static HRESULT GetSidecarName(const ASF_PATH_CHAR* sFileName, ASF_PATH_CHAR** ppsSidecarName);
+
+    static HRESULT SaveSidecar(
+        const ASF_PATH_CHAR* sSidecarName,
+        const GUID& guidFileID,
+        QWORD cbDataLength,
+        const CASFIndexReader& index
+        );
+
+    static HRESULT LoadSidecar(
+        const ASF_PATH_CHAR* sSidecarName,
+        const GUID& guidFileID,
+        QWORD cbDataLength,
+        CASFIndexReader* pIndex
+        );
+
+protected:
+
+    struct BUILD_STREAM
+    {
+        DWORD*  pdwTimes;
+        QWORD*  pcbOffsets;
+        DWORD   cEntries;
+        DWORD   cCapacity;
+    };
+
+    HRESULT AddEntry(BYTE bStreamNumber, DWORD dwTime, QWORD cbOffset);
+
+    void Reset();
+
+protected:
+
+    CASFPacketParser    m_PacketParser;
+    BUILD_STREAM        m_Streams[ASF_MAX_STREAMS];
+};
@@ -0,0 +1,645 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFIndexReader.cpp : CASFIndexReader class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include "ASFIndexReader.h"
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFIndexReader
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFIndexReader::CASFIndexReader()
+{
+    memset(m_Streams, 0, sizeof(m_Streams));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFIndexReader
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFIndexReader::~CASFIndexReader()
+{
+    Reset();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Parse
+//
+// Reads the index objects among the top-level objects that follow the
+// Data Object. Other objects are skipped. A stream indexed by more
+// than one object keeps the most precise index type; for equal types
+// the Index Object wins over a Simple Index Object.
+//
+// pData: First byte after the Data Object
+// cbData: Number of bytes to the end of the file
+// cbPacketSize: Fixed packet size, to convert Simple Index packet
+//               numbers to offsets. If 0, Simple Index Objects are ignored.
+// pwVideoStreams: Video stream numbers in header order. Simple Index
+//                 Objects do not name their stream; the n-th one
+//                 indexes the n-th video stream.
+// cVideoStreams: Number of entries in pwVideoStreams
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFIndexReader::Parse(
+    const BYTE* pData,
+    QWORD cbData,
+    DWORD cbPacketSize,
+    const WORD* pwVideoStreams,
+    DWORD cVideoStreams
+    )
+{
+    if (!pData && (cbData > 0))
+    {
+        return E_POINTER;
+    }
+
+    Reset();
+
+    HRESULT hr = S_OK;
+
+    DWORD cSimpleIndexes = 0;
+    QWORD cbPos = 0;
+
+    while (cbData - cbPos >= ASF_OBJECT_HEADER_SIZE)
+    {
+        const BYTE* pObject = pData + cbPos;
+
+        GUID guidObject = ASFReadGUID(pObject);
+        QWORD cbObject = ASFReadQWord(pObject + 16);
+
+        //Stop at the first object that does not fit, e.g. a truncated file
+        if ((cbObject < ASF_OBJECT_HEADER_SIZE) || (cbObject > cbData - cbPos))
+        {
+            break;
+        }
+
+        if (guidObject == ASF_Simple_Index_Object)
+        {
+            if ((cbPacketSize > 0) && (cSimpleIndexes < cVideoStreams))
+            {
+                hr = ParseSimpleIndex(pObject, cbObject, cbPacketSize, pwVideoStreams[cSimpleIndexes]);
+            }
+
+            cSimpleIndexes++;
+        }
+        else if (guidObject == ASF_Index_Object)
+        {
+            hr = ParseIndex(pObject, cbObject);
+        }
+
+        if (FAILED(hr))
+        {
+            Reset();
+            return hr;
+        }
+
+        cbPos += cbObject;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Reset
+//
+// Releases all stream indexes.
+/////////////////////////////////////////////////////////////////////
+
+void CASFIndexReader::Reset()
+{
+    for (DWORD i = 0; i < ASF_MAX_STREAMS; i++)
+    {
+        delete [] m_Streams[i].pdwTimes;
+        delete [] m_Streams[i].pcbOffsets;
+    }
+
+    memset(m_Streams, 0, sizeof(m_Streams));
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Lookup
+//
+// Finds the last index entry at or before dwTime by binary search.
+// Times before the first entry map to the first entry.
+//
+// wStreamNumber: Indexed stream
+// dwTime: Time in milliseconds, without the preroll
+// pcbOffset: Receives the offset of the entry, from the first data packet.
+// pcbNextOffset: Receives the offset of the following entry, or
+//                ASF_INDEX_NO_OFFSET. Can be NULL.
+// pdwEntryTime: Receives the time of the entry. Can be NULL.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFIndexReader::Lookup(
+    WORD wStreamNumber,
+    DWORD dwTime,
+    QWORD* pcbOffset,
+    QWORD* pcbNextOffset,
+    DWORD* pdwEntryTime
+    ) const
+{
+    if (!pcbOffset)
+    {
+        return E_POINTER;
+    }
+
+    if (!HasIndex(wStreamNumber))
+    {
+        return MF_E_ASF_NOINDEX;
+    }
+
+    const ASF_STREAM_INDEX& index = m_Streams[wStreamNumber];
+
+    //First entry later than dwTime
+    DWORD lo = 0;
+    DWORD hi = index.cEntries;
+
+    while (lo < hi)
+    {
+        DWORD mid = lo + (hi - lo) / 2;
+
+        if (index.pdwTimes[mid] <= dwTime)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    DWORD i = (lo > 0) ? lo - 1 : 0;
+
+    *pcbOffset = index.pcbOffsets[i];
+
+    if (pcbNextOffset)
+    {
+        *pcbNextOffset = (i + 1 < index.cEntries) ? index.pcbOffsets[i + 1] : ASF_INDEX_NO_OFFSET;
+    }
+
+    if (pdwEntryTime)
+    {
+        *pdwEntryTime = index.pdwTimes[i];
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: FindSeekPoint
+//
+// Looks up the seek point of a stream for a seek to hnsTime, the way
+// playback uses it. Returns MF_E_ASF_INVALIDDATA if the entry points
+// past the packets of the Data Object.
+//
+// wStreamNumber: Indexed stream
+// hnsTime: Seek time in 100-ns units, without the preroll
+// cbData: Size of the packets of the Data Object
+// cbPacketSize: Packet size to align the offset down to, or 0.
+// pcbOffset: Receives the offset of the entry, from the first data packet.
+// pcbNextOffset: Receives the offset of the following entry, or
+//                ASF_INDEX_NO_OFFSET. Can be NULL.
+// phnsEntryTime: Receives the time of the entry. Can be NULL.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFIndexReader::FindSeekPoint(
+    WORD wStreamNumber,
+    MFTIME hnsTime,
+    QWORD cbData,
+    DWORD cbPacketSize,
+    QWORD* pcbOffset,
+    QWORD* pcbNextOffset,
+    MFTIME* phnsEntryTime
+    ) const
+{
+    if (!pcbOffset)
+    {
+        return E_POINTER;
+    }
+
+    QWORD cbOffset = 0;
+    DWORD dwEntryTime = 0;
+    DWORD dwTime = 0;
+
+    if (hnsTime > 0)
+    {
+        dwTime = (hnsTime / 10000 < (MFTIME)MAXDWORD) ? (DWORD)(hnsTime / 10000) : MAXDWORD;
+    }
+
+    HRESULT hr = Lookup(wStreamNumber, dwTime, &cbOffset, pcbNextOffset, &dwEntryTime);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (cbOffset >= cbData)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    *pcbOffset = (cbPacketSize > 0) ? cbOffset - cbOffset % cbPacketSize : cbOffset;
+
+    if (phnsEntryTime)
+    {
+        *phnsEntryTime = (MFTIME)dwEntryTime * 10000;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetStreamIndex
+//
+// Returns the index of a stream. Valid until the next Parse or Reset.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFIndexReader::GetStreamIndex(WORD wStreamNumber, const ASF_STREAM_INDEX** ppIndex) const
+{
+    if (!ppIndex)
+    {
+        return E_POINTER;
+    }
+
+    if (!HasIndex(wStreamNumber))
+    {
+        return MF_E_ASF_NOINDEX;
+    }
+
+    *ppIndex = &m_Streams[wStreamNumber];
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: SetStreamIndex
+//
+// Replaces the index of a stream with a copy of the given entries, for
+// indexes that do not come from the file. Entries that repeat the
+// previous offset are dropped, as when parsing.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFIndexReader::SetStreamIndex(
+    WORD wStreamNumber,
+    WORD wIndexType,
+    const DWORD* pdwTimes,
+    const QWORD* pcbOffsets,
+    DWORD cEntries
+    )
+{
+    if ((wStreamNumber >= ASF_MAX_STREAMS) || ((!pdwTimes || !pcbOffsets) && (cEntries > 0)))
+    {
+        return E_INVALIDARG;
+    }
+
+    DWORD* pdwNewTimes = new (std::nothrow) DWORD[cEntries + 1];
+    QWORD* pcbNewOffsets = new (std::nothrow) QWORD[cEntries + 1];
+
+    if (!pdwNewTimes || !pcbNewOffsets)
+    {
+        delete [] pdwNewTimes;
+        delete [] pcbNewOffsets;
+        return E_OUTOFMEMORY;
+    }
+
+    DWORD cStored = 0;
+
+    for (DWORD i = 0; i < cEntries; i++)
+    {
+        if ((cStored > 0) &&
+            ((pcbOffsets[i] == pcbNewOffsets[cStored - 1]) || (pdwTimes[i] <= pdwNewTimes[cStored - 1])))
+        {
+            continue;
+        }
+
+        pdwNewTimes[cStored] = pdwTimes[i];
+        pcbNewOffsets[cStored] = pcbOffsets[i];
+        cStored++;
+    }
+
+    //Replace unconditionally
+    delete [] m_Streams[wStreamNumber].pdwTimes;
+    delete [] m_Streams[wStreamNumber].pcbOffsets;
+    memset(&m_Streams[wStreamNumber], 0, sizeof(ASF_STREAM_INDEX));
+
+    return StoreStreamIndex(wStreamNumber, wIndexType, pdwNewTimes, pcbNewOffsets, cStored);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: CopyFrom
+//
+// Replaces the indexes of the streams that index has an index for
+// with copies of them. Other streams keep their index.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFIndexReader::CopyFrom(const CASFIndexReader& index)
+{
+    if (&index == this)
+    {
+        return S_OK;
+    }
+
+    for (WORD w = 1; w < ASF_MAX_STREAMS; w++)
+    {
+        const ASF_STREAM_INDEX& stream = index.m_Streams[w];
+
+        if (stream.cEntries == 0)
+        {
+            continue;
+        }
+
+        HRESULT hr = SetStreamIndex(w, stream.wIndexType, stream.pdwTimes, stream.pcbOffsets, stream.cEntries);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+    }
+
+    return S_OK;
+}
+
+// ----- Protected Methods -----------------------------------------------
+
+/////////////////////////////////////////////////////////////////////
+// Name: ParseSimpleIndex
+//
+// Reads a Simple Index Object. Entry n is the packet of the nearest
+// past key frame at n * interval.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFIndexReader::ParseSimpleIndex(
+    const BYTE* pObject,
+    QWORD cbObject,
+    DWORD cbPacketSize,
+    WORD wStreamNumber
+    )
+{
+    if (cbObject < ASF_SIMPLE_INDEX_HEADER_SIZE)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    //An Index Object entry for the stream is at least as precise
+    if (m_Streams[wStreamNumber].wIndexType >= ASF_INDEX_NEAREST_PAST_CLEANPOINT)
+    {
+        return S_OK;
+    }
+
+    QWORD hnsInterval = ASFReadQWord(pObject + 40);
+    DWORD cEntries = ASFReadDWord(pObject + 52);
+
+    if ((hnsInterval == 0) ||
+        ((QWORD)cEntries * ASF_SIMPLE_INDEX_ENTRY_SIZE > cbObject - ASF_SIMPLE_INDEX_HEADER_SIZE))
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    DWORD* pdwTimes = new (std::nothrow) DWORD[cEntries + 1];
+    QWORD* pcbOffsets = new (std::nothrow) QWORD[cEntries + 1];
+
+    if (!pdwTimes || !pcbOffsets)
+    {
+        delete [] pdwTimes;
+        delete [] pcbOffsets;
+        return E_OUTOFMEMORY;
+    }
+
+    const BYTE* pEntry = pObject + ASF_SIMPLE_INDEX_HEADER_SIZE;
+    DWORD cStored = 0;
+
+    for (DWORD i = 0; i < cEntries; i++, pEntry += ASF_SIMPLE_INDEX_ENTRY_SIZE)
+    {
+        QWORD cbOffset = (QWORD)ASFReadDWord(pEntry) * cbPacketSize;
+
+        if ((cStored > 0) && (pcbOffsets[cStored - 1] == cbOffset))
+        {
+            continue;
+        }
+
+        pdwTimes[cStored] = (DWORD)(((QWORD)i * hnsInterval) / 10000);
+        pcbOffsets[cStored] = cbOffset;
+        cStored++;
+    }
+
+    return StoreStreamIndex(wStreamNumber, ASF_INDEX_NEAREST_PAST_CLEANPOINT, pdwTimes, pcbOffsets, cStored);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ParseIndex
+//
+// Reads an Index Object: one index per index specifier, with the
+// entries spread over one or more index blocks.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFIndexReader::ParseIndex(const BYTE* pObject, QWORD cbObject)
+{
+    if (cbObject < ASF_INDEX_HEADER_SIZE)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    DWORD cSpecifiers = ASFReadWord(pObject + 28);
+    DWORD cBlocks = ASFReadDWord(pObject + 30);
+
+    if ((cSpecifiers == 0) ||
+        ((QWORD)cSpecifiers * ASF_INDEX_SPECIFIER_SIZE > cbObject - ASF_INDEX_HEADER_SIZE))
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    //Validate the blocks and count the entries
+    QWORD cbPos = ASF_INDEX_HEADER_SIZE + (QWORD)cSpecifiers * ASF_INDEX_SPECIFIER_SIZE;
+    QWORD cTotalEntries = 0;
+
+    for (DWORD b = 0; b < cBlocks; b++)
+    {
+        if (cbObject - cbPos < 4 + (QWORD)cSpecifiers * 8)
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        DWORD cEntries = ASFReadDWord(pObject + cbPos);
+        cbPos += 4 + (QWORD)cSpecifiers * 8;
+
+        if ((QWORD)cEntries * cSpecifiers * 4 > cbObject - cbPos)
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        cbPos += (QWORD)cEntries * cSpecifiers * 4;
+        cTotalEntries += cEntries;
+    }
+
+    if (cTotalEntries >= 0xFFFFFFFF)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    HRESULT hr = S_OK;
+
+    for (DWORD s = 0; SUCCEEDED(hr) && (s < cSpecifiers); s++)
+    {
+        const BYTE* pSpecifier = pObject + ASF_INDEX_HEADER_SIZE + s * ASF_INDEX_SPECIFIER_SIZE;
+
+        WORD wStreamNumber = ASFReadWord(pSpecifier);
+        WORD wIndexType = ASFReadWord(pSpecifier + 2);
+
+        if ((wStreamNumber == 0) || (wStreamNumber >= ASF_MAX_STREAMS) ||
+            (wIndexType < ASF_INDEX_NEAREST_PAST_DATA_PACKET) ||
+            (wIndexType > ASF_INDEX_NEAREST_PAST_CLEANPOINT))
+        {
+            continue;
+        }
+
+        //Keep the most precise index type of a stream
+        if (wIndexType < m_Streams[wStreamNumber].wIndexType)
+        {
+            continue;
+        }
+
+        DWORD* pdwTimes = new (std::nothrow) DWORD[(DWORD)cTotalEntries + 1];
+        QWORD* pcbOffsets = new (std::nothrow) QWORD[(DWORD)cTotalEntries + 1];
+
+        if (!pdwTimes || !pcbOffsets)
+        {
+            delete [] pdwTimes;
+            delete [] pcbOffsets;
+            return E_OUTOFMEMORY;
+        }
+
+        DWORD cStored = 0;
+
+        hr = ParseIndexSpecifier(pObject, s, (DWORD)cTotalEntries, pdwTimes, pcbOffsets, &cStored);
+
+        if (SUCCEEDED(hr))
+        {
+            hr = StoreStreamIndex(wStreamNumber, wIndexType, pdwTimes, pcbOffsets, cStored);
+        }
+        else
+        {
+            delete [] pdwTimes;
+            delete [] pcbOffsets;
+        }
+    }
+
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ParseIndexSpecifier
+//
+// Collects the entries of one index specifier from all index blocks.
+// Entry n covers n * interval; invalid entries are skipped. The
+// blocks must have been validated by ParseIndex.
+//
+// cEntries: Capacity of pdwTimes and pcbOffsets
+// pcStored: Receives the number of entries stored
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFIndexReader::ParseIndexSpecifier(
+    const BYTE* pObject,
+    DWORD dwSpecifier,
+    DWORD cEntries,
+    DWORD* pdwTimes,
+    QWORD* pcbOffsets,
+    DWORD* pcStored
+    )
+{
+    DWORD dwInterval = ASFReadDWord(pObject + 24);
+    DWORD cSpecifiers = ASFReadWord(pObject + 28);
+    DWORD cBlocks = ASFReadDWord(pObject + 30);
+
+    QWORD cbPos = ASF_INDEX_HEADER_SIZE + (QWORD)cSpecifiers * ASF_INDEX_SPECIFIER_SIZE;
+    QWORD iEntry = 0;
+    DWORD cStored = 0;
+
+    for (DWORD b = 0; b < cBlocks; b++)
+    {
+        DWORD cBlockEntries = ASFReadDWord(pObject + cbPos);
+        QWORD cbBlockPosition = ASFReadQWord(pObject + cbPos + 4 + (QWORD)dwSpecifier * 8);
+
+        const BYTE* pEntry = pObject + cbPos + 4 + (QWORD)cSpecifiers * 8 + dwSpecifier * 4;
+
+        for (DWORD i = 0; i < cBlockEntries; i++, iEntry++, pEntry += cSpecifiers * 4)
+        {
+            DWORD dwOffset = ASFReadDWord(pEntry);
+
+            if (dwOffset == ASF_INDEX_INVALID_OFFSET)
+            {
+                continue;
+            }
+
+            QWORD cbOffset = cbBlockPosition + dwOffset;
+            DWORD dwTime = (DWORD)(iEntry * dwInterval);
+
+            if ((cStored > 0) && (pcbOffsets[cStored - 1] == cbOffset))
+            {
+                continue;
+            }
+
+            if (cStored >= cEntries)
+            {
+                return MF_E_ASF_INVALIDDATA;
+            }
+
+            pdwTimes[cStored] = dwTime;
+            pcbOffsets[cStored] = cbOffset;
+            cStored++;
+        }
+
+        cbPos += 4 + (QWORD)cSpecifiers * 8 + (QWORD)cBlockEntries * cSpecifiers * 4;
+    }
+
+    *pcStored = cStored;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: StoreStreamIndex
+//
+// Takes ownership of the arrays and stores them as the index of the
+// stream, replacing an index of the same or a less precise type.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFIndexReader::StoreStreamIndex(
+    WORD wStreamNumber,
+    WORD wIndexType,
+    DWORD* pdwTimes,
+    QWORD* pcbOffsets,
+    DWORD cEntries
+    )
+{
+    ASF_STREAM_INDEX& index = m_Streams[wStreamNumber];
+
+    if ((cEntries == 0) || (wIndexType < index.wIndexType))
+    {
+        delete [] pdwTimes;
+        delete [] pcbOffsets;
+        return S_OK;
+    }
+
+    delete [] index.pdwTimes;
+    delete [] index.pcbOffsets;
+
+    index.wIndexType = wIndexType;
+    index.cEntries = cEntries;
+    index.pdwTimes = pdwTimes;
+    index.pcbOffsets = pcbOffsets;
+
+    return S_OK;
+}
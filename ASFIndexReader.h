@@ -0,0 +1,129 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFIndexReader.h : CASFIndexReader class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFFormat.h"
+
+//Returned as the next offset when the entry found is the last one
+#define ASF_INDEX_NO_OFFSET     ((QWORD)-1)
+
+//Index of one stream. Consecutive index entries that point to the same
+//offset are stored once, so the arrays hold one entry per distinct seek
+//point. Times are in milliseconds without the preroll and increase
+//strictly; offsets are relative to the first data packet.
+
+struct ASF_STREAM_INDEX
+{
+    WORD    wIndexType;     // ASF_INDEX_NEAREST_PAST_*, 0 if the stream has no index
+    DWORD   cEntries;
+    DWORD*  pdwTimes;       // Searched; kept apart from the offsets
+    QWORD*  pcbOffsets;
+};
+
+
+//Reads the Simple Index Objects and the Index Object that follow the
+//Data Object into compact per-stream arrays, and answers time-to-offset
+//queries by binary search. The index span is only read while parsing.
+
+class CASFIndexReader
+{
+public:
+
+    CASFIndexReader();
+    ~CASFIndexReader();
+
+    HRESULT Parse(
+        const BYTE* pData,
+        QWORD cbData,
+        DWORD cbPacketSize,
+        const WORD* pwVideoStreams,
+        DWORD cVideoStreams
+        );
+
+    void Reset();
+
+    BOOL HasIndex(WORD wStreamNumber) const
+    {
+        return (wStreamNumber < ASF_MAX_STREAMS) && (m_Streams[wStreamNumber].cEntries > 0);
+    }
+
+    BOOL IsEmpty() const
+    {
+        for (WORD w = 1; w < ASF_MAX_STREAMS; w++)
+        {
+            if (HasIndex(w))
+            {
+                return FALSE;
+            }
+        }
+        return TRUE;
+    }
+
+    HRESULT Lookup(
+        WORD wStreamNumber,
+        DWORD dwTime,
+        QWORD* pcbOffset,
+        QWORD* pcbNextOffset,
+        DWORD* pdwEntryTime
+        ) const;
+
+    HRESULT FindSeekPoint(
+        WORD wStreamNumber,
+        MFTIME hnsTime,
+        QWORD cbData,
+        DWORD cbPacketSize,
+        QWORD* pcbOffset,
+        QWORD* pcbNextOffset,
+        MFTIME* phnsEntryTime
+        ) const;
+
+    HRESULT GetStreamIndex(WORD wStreamNumber, const ASF_STREAM_INDEX** ppIndex) const;
+
+    HRESULT SetStreamIndex(
+        WORD wStreamNumber,
+        WORD wIndexType,
+        const DWORD* pdwTimes,
+        const QWORD* pcbOffsets,
+        DWORD cEntries
+        );
+
+    HRESULT CopyFrom(const CASFIndexReader& index);
+
+protected:
+
+    HRESULT ParseSimpleIndex(const BYTE* pObject, QWORD cbObject, DWORD cbPacketSize, WORD wStreamNumber);
+
+    HRESULT ParseIndex(const BYTE* pObject, QWORD cbObject);
+
+    HRESULT ParseIndexSpecifier(
+        const BYTE* pObject,
+        DWORD dwSpecifier,
+        DWORD cEntries,
+        DWORD* pdwTimes,
+        QWORD* pcbOffsets,
+        DWORD* pcStored
+        );
+
+    HRESULT StoreStreamIndex(
+        WORD wStreamNumber,
+        WORD wIndexType,
+        DWORD* pdwTimes,
+        QWORD* pcbOffsets,
+        DWORD cEntries
+        );
+
+protected:
+
+    ASF_STREAM_INDEX    m_Streams[ASF_MAX_STREAMS];     // Indexed by stream number
+};
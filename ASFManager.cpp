@@ -73,16 +73,34 @@ CASFManager::CASFManager(HRESULT* hr)
 :   m_nRefCount(1),
     m_CurrentStreamID (0),
     m_guidCurrentMediaType (GUID_NULL),
-    m_fileinfo(NULL),
     m_pDecoder (NULL),
     m_pContentInfo (NULL),
     m_pIndexer (NULL),
     m_pSplitter (NULL),
     m_pDataBuffer (NULL),
+    m_pObjectSample (NULL),
+    m_cbDataBufferStart (0),
+    m_cbDataBufferLength (0),
     m_pByteStream(NULL),
     m_cbDataOffset(0),
-    m_cbDataLength(0)
+    m_cbDataLength(0),
+    m_pHeaderData(NULL),
+    m_pHeaderSpan(NULL),
+    m_cbHeaderSpan(0),
+    m_sSidecarName (NULL),
+    m_guidBuiltFileID (GUID_NULL),
+    m_cbBuiltDataLength (0),
+    m_fMetadata (FALSE),
+    m_dwDecoderBackend (ASF_DECODER_BACKEND_AUTO),
+    m_cPipelineDepth (0),
+    m_fPipelineDemux (FALSE),
+    m_pKeyFrameBatch (NULL),
+    m_fKeyFramesOnly (FALSE),
+    m_fBatchSamples (FALSE),
+    m_hrSampleBatch (S_OK)
 {
+    ZeroMemory(&m_KeyFrameFilterStats, sizeof(m_KeyFrameFilterStats));
+
     //Initialize Media Foundation
     *hr = MFStartup(MF_VERSION);
 
@@ -101,6 +119,9 @@ CASFManager::~CASFManager()
     //Release memory
     Reset();
 
+    //The pooled decoder MFTs must be released before shutting down
+    m_DecoderPool.Clear();
+
    // Shutdown the Media Foundation platform
     (void)MFShutdown();
 
@@ -120,6 +141,8 @@ CASFManager::~CASFManager()
 HRESULT CASFManager::OpenASFFile(const WCHAR *sFileName)
 {
     IMFByteStream* pStream = NULL;
+    QWORD cbFile = 0;
+    BOOL fHasIndex = FALSE;
 
     // Open a byte stream for the file.
     HRESULT hr = MFCreateFile(
@@ -138,23 +161,85 @@ HRESULT CASFManager::OpenASFFile(const WCHAR *sFileName)
     //Reset the ASF components.
     Reset();
 
-    // Create the Media Foundation ASF objects.
+    // A file opened before has a cache record, valid while the size and
+    // the last write time of the file are unchanged.
+    if (m_MetadataCache.IsOpen())
+    {
+        m_fMetadata = SUCCEEDED(m_MetadataCache.Lookup(sFileName, &m_Metadata));
+    }
+
+    // Map the file so that the header and packets can be parsed in place.
+    // If the file cannot be mapped (for example, a very large file in a
+    // 32-bit process), everything is read through the byte stream instead.
+    (void)m_MappedFile.Open(sFileName);
+
+    // Create the Media Foundation ASF objects. With a cache record the
+    // header objects are not walked natively.
     hr = CreateASFContentInfo(pStream, &m_pContentInfo);
     if (FAILED(hr))
     {
         goto done;
     }
 
+    // The manager keeps its own copy of the file attributes.
+    if (m_fMetadata)
+    {
+        m_fileinfo = m_Metadata.fileInfo;
+    }
+    else
+    {
+        hr = m_HeaderParser.GetFileProperties(&m_fileinfo);
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+    }
+
     hr = CreateASFSplitter(pStream, &m_pSplitter);
     if (FAILED(hr))
     {
         goto done;
     }
 
-    hr = CreateASFIndexer(pStream, m_pContentInfo, &m_pIndexer);
-    if (FAILED(hr))
+    // A file that had no index objects when it was cached still has none.
+    if (!m_fMetadata || (m_Metadata.cbIndexLength > 0))
     {
-        goto done;
+        // A damaged index only costs the fast seeks.
+        (void)LoadIndex(pStream, m_fMetadata ? m_Metadata.cbIndexOffset : m_cbDataOffset + m_cbDataLength);
+
+        hr = CreateASFIndexer(pStream, m_pContentInfo, &m_pIndexer);
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+    }
+
+    fHasIndex = (m_pIndexer || !m_IndexReader.IsEmpty());
+
+    if (!m_fMetadata && m_MetadataCache.IsOpen())
+    {
+        if (m_MappedFile.IsMapped())
+        {
+            cbFile = m_MappedFile.GetSize();
+        }
+        else
+        {
+            hr = pStream->GetLength(&cbFile);
+            if (FAILED(hr))
+            {
+                goto done;
+            }
+        }
+
+        // A file that cannot be cached opens as before.
+        (void)StoreMetadata(sFileName, cbFile, fHasIndex);
+    }
+
+    // Files without an index are indexed on the first seek that needs
+    // an index; the index is kept in a sidecar file for later opens.
+    if (!fHasIndex)
+    {
+        (void)CASFIndexBuilder::GetSidecarName(sFileName, &m_sSidecarName);
     }
 
 done:
@@ -172,6 +257,13 @@ done:
 // Reads the ASF Header Object from a byte stream and returns a
 // pointer to the ASF content information object.
 //
+// The header is parsed natively, straight out of the header span, to
+// get the file properties and the data object bounds. A file with a
+// cache record skips that walk; only its header size and File ID are
+// read and checked against the record. The same span is then handed to the
+// content information object through a buffer view, so the header is
+// never copied into a media buffer.
+//
 // pStream:       Pointer to the byte stream. The byte stream's
 //                current read position must be 0 that indicates the start of the
 //                ASF Header Object.
@@ -187,39 +279,69 @@ HRESULT CASFManager::CreateASFContentInfo (IMFByteStream *pContentByteStream,
         return E_INVALIDARG;
     }
 
-    QWORD cbHeader = 0;
+    const BYTE* pHeader = NULL;
+    QWORD cbSpan = 0, cbHeader = 0;
 
     IMFASFContentInfo *pContentInfo = NULL;
     IMFMediaBuffer *pBuffer = NULL;
 
-    // Create the ASF content information object.
-    HRESULT hr = MFCreateASFContentInfo(&pContentInfo);
-
+    // Get the Header Object, followed by the Data Object header.
+    HRESULT hr = GetHeaderSpan(pContentByteStream, &pHeader, &cbSpan);
     if (FAILED(hr))
     {
         goto done;
     }
 
-    // Read the first 30 bytes to find the total header size.
-    hr = ReadDataIntoBuffer(
-        pContentByteStream, 0, MIN_ASF_HEADER_SIZE, &pBuffer);
+    m_pHeaderSpan = pHeader;
+    m_cbHeaderSpan = cbSpan;
 
-    if (FAILED(hr))
+    // A record is only used for the file it was stored for: the File ID
+    // must match and the data offset must follow the Header Object.
+    if (m_fMetadata)
     {
-        goto done;
+        GUID guidFileID = GUID_NULL;
+
+        hr = CASFHeaderParser::GetHeaderSize(pHeader, cbSpan, &cbHeader);
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+
+        if (FAILED(CASFHeaderParser::GetFileID(pHeader, cbSpan, &guidFileID)) ||
+            (guidFileID != m_Metadata.fileInfo.guidFileID) ||
+            (m_Metadata.cbDataOffset != cbHeader + ASF_DATA_OBJECT_HEADER_SIZE))
+        {
+            m_fMetadata = FALSE;
+        }
     }
 
+    // Walk the header objects in place.
+    if (!m_fMetadata)
+    {
+        hr = ParseHeaderSpan();
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+
+        cbHeader = m_HeaderParser.GetHeaderSize();
+    }
 
-    hr = pContentInfo->GetHeaderSize(pBuffer, &cbHeader);
-    if (FAILED(hr))
+    if (cbHeader > MAXDWORD)
     {
+        hr = MF_E_ASF_INVALIDDATA;
         goto done;
     }
 
-    SafeRelease(&pBuffer);
+    // Create the ASF content information object.
+    hr = MFCreateASFContentInfo(&pContentInfo);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
 
-    //Read the header into a buffer
-    hr = ReadDataIntoBuffer(pContentByteStream, 0, (DWORD)cbHeader, &pBuffer);
+    // Wrap the header span; this does not copy the header.
+    hr = CMediaBufferView::CreateInstance((BYTE*)pHeader, (DWORD)cbHeader, (DWORD)cbHeader, &pBuffer);
     if (FAILED(hr))
     {
         goto done;
@@ -242,6 +364,127 @@ done:
     return hr;
 }
 
+/////////////////////////////////////////////////////////////////////
+// Name: GetHeaderSpan
+//
+// Returns a span that starts with the ASF Header Object and, when the
+// file is long enough, includes the Data Object header.
+//
+// If the file is mapped, the span points into the mapping. Otherwise
+// the header size is read from the first bytes of the stream and the
+// header is read once into memory owned by the ASF manager.
+//
+// pContentByteStream: Pointer to the byte stream.
+// ppHeader: Receives a pointer to the start of the span.
+// pcbSpan:  Receives the size of the span in bytes.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFManager::GetHeaderSpan(IMFByteStream *pContentByteStream,
+                                   const BYTE **ppHeader,
+                                   QWORD *pcbSpan)
+{
+    QWORD cbHeader = 0, cbSpan = 0;
+    DWORD cbRead = 0;
+
+    BYTE rgbMinHeader[MIN_ASF_HEADER_SIZE];
+
+    HRESULT hr = S_OK;
+
+    if (m_MappedFile.IsMapped())
+    {
+        hr = CASFHeaderParser::GetHeaderSize(m_MappedFile.GetData(), m_MappedFile.GetSize(), &cbHeader);
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+
+        cbSpan = min(cbHeader + ASF_DATA_OBJECT_HEADER_SIZE, m_MappedFile.GetSize());
+
+        *ppHeader = m_MappedFile.GetData();
+        *pcbSpan = cbSpan;
+        goto done;
+    }
+
+    // Read the first bytes to find the total header size.
+    hr = pContentByteStream->SetCurrentPosition(0);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = pContentByteStream->Read(rgbMinHeader, sizeof(rgbMinHeader), &cbRead);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = CASFHeaderParser::GetHeaderSize(rgbMinHeader, cbRead, &cbHeader);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    cbSpan = cbHeader + ASF_DATA_OBJECT_HEADER_SIZE;
+
+    if (cbSpan > MAXDWORD)
+    {
+        hr = MF_E_ASF_INVALIDDATA;
+        goto done;
+    }
+
+    delete [] m_pHeaderData;
+
+    m_pHeaderData = new (std::nothrow) BYTE[(size_t)cbSpan];
+
+    if (!m_pHeaderData)
+    {
+        hr = E_OUTOFMEMORY;
+        goto done;
+    }
+
+    //Read the header and the Data Object header in one go
+    hr = pContentByteStream->SetCurrentPosition(0);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = pContentByteStream->Read(m_pHeaderData, (ULONG)cbSpan, &cbRead);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    *ppHeader = m_pHeaderData;
+    *pcbSpan = cbRead;
+
+done:
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ParseHeaderSpan
+//
+// Walks the header objects in the header span, unless they were walked
+// already. A file opened from its cache record is only walked when the
+// properties of a stream are needed.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFManager::ParseHeaderSpan()
+{
+    if (m_HeaderParser.GetDataOffset() != 0)
+    {
+        return S_OK;
+    }
+
+    if (!m_pHeaderSpan)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    return m_HeaderParser.Parse(m_pHeaderSpan, m_cbHeaderSpan);
+}
+
 
 /////////////////////////////////////////////////////////////////////
 // Name: CreateASFSplitter
@@ -266,38 +509,45 @@ HRESULT CASFManager::CreateASFSplitter (IMFByteStream *pContentByteStream,
     }
 
     IMFASFSplitter *pSplitter = NULL;
-    IMFPresentationDescriptor* pPD = NULL;
 
-    UINT64 cbDataOffset = 0, cbDataLength = 0;
+    // The data object bounds come from the cache record or the natively
+    // parsed header.
+    UINT64 cbDataOffset = m_fMetadata ? m_Metadata.cbDataOffset : m_HeaderParser.GetDataOffset();
+    UINT64 cbDataLength = m_fMetadata ? m_Metadata.cbDataLength : m_HeaderParser.GetDataLength();
 
-    HRESULT hr = MFCreateASFSplitter(&pSplitter);
-    if (FAILED(hr))
+    if (cbDataOffset == 0)
     {
-        goto done;
+        return MF_E_ASF_PARSINGINCOMPLETE;
     }
 
-    hr = pSplitter->Initialize(m_pContentInfo);
+    // Reads of the data object are sized in whole packets.
+    HRESULT hr = m_ReadPlanner.Initialize(m_fileinfo.cbMinPacketSize, m_fileinfo.cbMaxPacketSize);
     if (FAILED(hr))
     {
-        goto done;
+        return hr;
     }
 
-    //Generate the presentation descriptor
-    hr =  m_pContentInfo->GeneratePresentationDescriptor(&pPD);
-    if (FAILED(hr))
+    // The native demux needs fixed-size packets.
+    if ((m_fileinfo.cbMinPacketSize == m_fileinfo.cbMaxPacketSize) && (m_fileinfo.cbMaxPacketSize > 0))
     {
-        goto done;
+        hr = m_PacketParser.Initialize(m_fileinfo.cbMaxPacketSize);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+    }
+    else
+    {
+        m_PacketParser = CASFPacketParser();
     }
 
-    //Get the offset to the start of the Data Object
-    hr = pPD->GetUINT64(MF_PD_ASF_DATA_START_OFFSET, &cbDataOffset);
+    hr = MFCreateASFSplitter(&pSplitter);
     if (FAILED(hr))
     {
         goto done;
     }
 
-    //Get the length of the Data Object
-    hr = pPD->GetUINT64(MF_PD_ASF_DATA_LENGTH, &cbDataLength);
+    hr = pSplitter->Initialize(m_pContentInfo);
     if (FAILED(hr))
     {
         goto done;
@@ -315,7 +565,6 @@ HRESULT CASFManager::CreateASFSplitter (IMFByteStream *pContentByteStream,
 
 done:
     SafeRelease(&pSplitter);
-    SafeRelease(&pPD);
     return hr;
 }
 
@@ -354,10 +603,18 @@ HRESULT CASFManager::EnumerateStreams (WORD** ppwStreamNumbers,
     *pcTotalStreams =0;
 
     DWORD cStreams;
-    WORD* pwStreamNumbers;  // Array of stream numbers.
-    GUID* pguidMajorType;   // Array of major types.
+    WORD* pwStreamNumbers = NULL;  // Array of stream numbers.
+    GUID* pguidMajorType = NULL;   // Array of major types.
 
-    HRESULT hr =  m_pContentInfo->GetProfile(&pProfile);
+    HRESULT hr = S_OK;
+
+    // The streams of a cached file are known without the profile.
+    if (m_fMetadata)
+    {
+        return GetMetadataStreams(ppwStreamNumbers, ppguidMajorType, pcTotalStreams);
+    }
+
+    hr =  m_pContentInfo->GetProfile(&pProfile);
     if (FAILED(hr))
     {
         goto done;
@@ -480,10 +737,12 @@ done:
 /////////////////////////////////////////////////////////////////////
 // Name: SetupStreamDecoder
 //
-// Loads the appropriate decoder for stream. The decoder is implemented as
-// a Media Foundation Transform (MFT). The class CDecoder provides a wrapper for
-// the MFT. The CASFManager::GenerateSamples feeds compressed samples to
-// the decoder. The MFT decodes the samples and sends them to the CMediaController
+// Loads the appropriate decoder for stream. The decoder backend is chosen
+// with SetDecoderBackend: by default compressed streams are decoded by a
+// Media Foundation Transform (MFT) and uncompressed streams by the raw
+// decoder. The class CDecoder provides a wrapper for the backend. The
+// CASFManager::GenerateSamples feeds compressed samples to the decoder.
+// The decoder decodes the samples and sends them to the CMediaController
 // object, which plays 10 seconds of uncompressed audio samples or displays the
 // key frame for the video stream
 //
@@ -511,14 +770,9 @@ HRESULT CASFManager::SetupStreamDecoder (WORD wStreamNumber,
     IMFMediaType* pMediaType = NULL;
     IMFASFStreamConfig *pStream = NULL;
 
-    GUID    guidMajorType = GUID_NULL;
-    GUID    guidSubType = GUID_NULL;
-    GUID    guidDecoderCategory = GUID_NULL;
-
-    BOOL fIsCompressed = TRUE;
+    const ASF_STREAM_PROPERTIES* pStreamProps = NULL;
 
-    CLSID *pDecoderCLSIDs = NULL;   // Pointer to an array of CLISDs.
-    UINT32 cDecoderCLSIDs = 0;   // Size of the array.
+    GUID    guidMajorType = GUID_NULL;
 
     //Get the profile object that stores stream information
     HRESULT hr =  m_pContentInfo->GetProfile(&pProfile);
@@ -548,97 +802,50 @@ HRESULT CASFManager::SetupStreamDecoder (WORD wStreamNumber,
         goto done;
     }
 
-    //Get the sub media type
-    hr = pMediaType->GetGUID(MF_MT_SUBTYPE, &guidSubType);
-    if (FAILED(hr))
+    if ((guidMajorType != MFMediaType_Video) && (guidMajorType != MFMediaType_Audio))
     {
+        hr = MF_E_INVALIDMEDIATYPE;
         goto done;
     }
 
-    //find out if the media type is compressed
-    hr = pMediaType->IsCompressedFormat(&fIsCompressed);
+    //The raw and null decoders read the format from the stream properties
+    hr = ParseHeaderSpan();
     if (FAILED(hr))
     {
         goto done;
     }
 
-    if (fIsCompressed)
+    hr = m_HeaderParser.GetStreamByNumber(wStreamNumber, &pStreamProps);
+    if (FAILED(hr))
     {
-        //get decoder category
-        if (guidMajorType == MFMediaType_Video)
-        {
-            guidDecoderCategory = MFT_CATEGORY_VIDEO_DECODER;
-        }
-        else if (guidMajorType == MFMediaType_Audio)
-        {
-            guidDecoderCategory = MFT_CATEGORY_AUDIO_DECODER;
-        }
-        else
-        {
-            hr = MF_E_INVALIDMEDIATYPE;
-            goto done;
-        }
-
-        // Look for a decoder.
-        MFT_REGISTER_TYPE_INFO tinfo;
-        tinfo.guidMajorType = guidMajorType;
-        tinfo.guidSubtype = guidSubType;
-
-        hr = MFTEnum(
-            guidDecoderCategory,
-            0,                  // Reserved
-            &tinfo,             // Input type to match. (Encoded type.)
-            NULL,               // Output type to match. (Don't care.)
-            NULL,               // Attributes to match. (None.)
-            &pDecoderCLSIDs,    // Receives a pointer to an array of CLSIDs.
-            &cDecoderCLSIDs     // Receives the size of the array.
-            );
+        goto done;
+    }
 
+    // If the CDecoder instance does not exist, create one.
+    if (!m_pDecoder)
+    {
+        hr = CDecoder::CreateInstance(&m_pDecoder);
         if (FAILED(hr))
         {
             goto done;
         }
-        else if (cDecoderCLSIDs == 0)
-        {
-            // MFTEnum can return zero matches.
-
-            hr = MF_E_TOPO_CODEC_NOT_FOUND;
-            goto done;
-        }
-        else
-        {
-            // If the CDecoder instance does not exist, create one.
-
-            if (!m_pDecoder)
-            {
-                hr = CDecoder::CreateInstance(&m_pDecoder);
-                if (FAILED(hr))
-                {
-                    goto done;
-                }
-            }
-
-            // Load the first MFT in the array for the current media type
-            hr = m_pDecoder->Initialize(pDecoderCLSIDs[0], pMediaType);
-            if (FAILED(hr))
-            {
-                goto done;
-            }
-        }
-
-        *pguidCurrentMediaType = guidMajorType;
     }
-    else
+
+    // Load a decoder for the current media type. Decoders of streams
+    // selected earlier are kept in the pool, so switching back to a
+    // stream reuses its configured decoder.
+    hr = m_pDecoder->Initialize(pMediaType, pStreamProps, m_dwDecoderBackend, &m_DecoderPool);
+    if (FAILED(hr))
     {
-        // Not compressed. Don't need a decoder.
-        hr = MF_E_INVALIDREQUEST;
+        goto done;
     }
 
+    *pguidCurrentMediaType = guidMajorType;
+
 done:
     SafeRelease(&pProfile);
     SafeRelease(&pMediaType);
     SafeRelease(&pStream);
-    CoTaskMemFree(pDecoderCLSIDs);
     return hr;
 }
 
@@ -659,7 +866,20 @@ HRESULT CASFManager::GetSeekPosition (MFTIME* hnsSeekTime,
                                       QWORD *pcbDataOffset,
                                       MFTIME* phnsApproxSeekTime)
 {
-    HRESULT hr = E_FAIL;
+    //A file without index objects is indexed once, on the first seek of
+    //a stream it has no index for
+    if (m_sSidecarName && !m_IndexReader.HasIndex(m_CurrentStreamID))
+    {
+        (void)LoadOrBuildIndexSidecar();
+    }
+
+    //Streams of either type that are indexed in the file are looked up in
+    //the index read when the file was opened
+    HRESULT hr = GetSeekPositionFromIndex(*hnsSeekTime, pcbDataOffset, phnsApproxSeekTime);
+    if (SUCCEEDED(hr))
+    {
+        return hr;
+    }
 
     //if the media type is audio, or doesn't have an indexed data
     //calculate the offset manually
@@ -680,7 +900,9 @@ HRESULT CASFManager::GetSeekPosition (MFTIME* hnsSeekTime,
 // Name: GetSeekPositionManually
 //
 // Gets the offset for audio media types or ones that do not have ASF Index Objects defined.
-//Offset is calculated as fraction with respect to time
+//For mapped files with fixed-size packets the offset is the exact packet
+//found by GetSeekPositionExact. Otherwise it is calculated as fraction
+//with respect to time.
 //
 // hnsSeekTime: Presentation time in hns.
 //
@@ -700,22 +922,28 @@ HRESULT CASFManager::GetSeekPositionManually(MFTIME hnsSeekTime,
         return hr;
     }
 
+    hr = GetSeekPositionExact(hnsSeekTime, (dwFlags & MFASF_SPLITTER_REVERSE) ? TRUE : FALSE, cbDataOffset);
+    if (SUCCEEDED(hr))
+    {
+        return hr;
+    }
+
     //Get average packet size
-    UINT32 averagepacketsize = ( m_fileinfo->cbMaxPacketSize+ m_fileinfo->cbMinPacketSize)/2;
+    UINT32 averagepacketsize = ( m_fileinfo.cbMaxPacketSize+ m_fileinfo.cbMinPacketSize)/2;
 
     double fraction = 0;
 
     if (dwFlags & MFASF_SPLITTER_REVERSE)
     {
-        fraction = ((double) (m_fileinfo->hnsPresentationDuration) - (double) (hnsSeekTime))/(double) (m_fileinfo->hnsPresentationDuration);
+        fraction = ((double) (m_fileinfo.hnsPresentationDuration) - (double) (hnsSeekTime))/(double) (m_fileinfo.hnsPresentationDuration);
     }
     else
     {
-        fraction = (double)(hnsSeekTime)/(double) (m_fileinfo->hnsPresentationDuration);
+        fraction = (double)(hnsSeekTime)/(double) (m_fileinfo.hnsPresentationDuration);
     }
 
     //calculate the number of packets passed
-    int seeked_packets = (int)( m_fileinfo->cPackets * fraction);
+    QWORD seeked_packets = (fraction > 0) ? (QWORD)(m_fileinfo.cPackets * fraction) : 0;
 
     //get the offset
     *cbDataOffset = (QWORD)averagepacketsize * seeked_packets;
@@ -723,57 +951,466 @@ HRESULT CASFManager::GetSeekPositionManually(MFTIME hnsSeekTime,
     return S_OK;
 }
 
+/////////////////////////////////////////////////////////////////////
+// Name: GetSeekPositionExact
+//
+// Gets the offset of the packet in which the sample of the current
+// stream that is presented at the seek time starts. The seek engine
+// searches the packet send times in the mapped data object, reading
+// O(log n) packet headers.
+//
+// hnsSeekTime: Presentation time in hns, without the preroll.
+// bReverse: If TRUE, the offset is counted back from the end of the
+//           data object and ends after the last packet sent at or
+//           before the seek time.
+// pcbDataOffset: Receives the offset in bytes.
+/////////////////////////////////////////////////////////////////////
 
-HRESULT CASFManager::GetSeekPositionWithIndexer (
-                        MFTIME hnsSeekTime,
-                        QWORD *cbDataOffset,
-                        MFTIME* hnsApproxSeekTime)
+HRESULT CASFManager::GetSeekPositionExact(MFTIME hnsSeekTime, BOOL bReverse, QWORD *pcbDataOffset)
 {
-    if (! m_pIndexer)
+    if (!m_MappedFile.IsMapped() ||
+        (m_PacketParser.GetPacketSize() == 0) ||
+        (m_cbDataOffset == 0) ||
+        (m_cbDataOffset > m_MappedFile.GetSize()))
     {
-        return MF_E_ASF_NOINDEX;
+        return MF_E_INVALIDREQUEST;
     }
 
-    BOOL  bReverse = FALSE;
-    DWORD dwFlags = 0;
+    DWORD cbPacketSize = m_PacketParser.GetPacketSize();
 
-    HRESULT hr = m_pSplitter->GetFlags(&dwFlags);
+    QWORD iPacket = 0;
+    QWORD iSendBoundary = 0;
+
+    HRESULT hr = m_SeekEngine.Initialize(
+                    m_MappedFile.GetData() + m_cbDataOffset,
+                    ASFGetPacketCount(m_MappedFile.GetSize(), m_cbDataOffset, m_cbDataLength, cbPacketSize),
+                    cbPacketSize,
+                    m_fileinfo.hnspreroll / 10000
+                    );
     if (FAILED(hr))
     {
         return hr;
     }
 
-    if (dwFlags & MFASF_SPLITTER_REVERSE)
+    hr = m_SeekEngine.FindPacketAtTime(hnsSeekTime, m_CurrentStreamID, &iPacket, &iSendBoundary);
+    if (FAILED(hr))
     {
-        bReverse = TRUE;
+        return hr;
     }
 
-    hr = ::GetSeekPositionWithIndexer(
-        m_pIndexer,
-        m_CurrentStreamID,
-        hnsSeekTime,
-        bReverse,
-        cbDataOffset,
-        hnsApproxSeekTime
-        );
+    if (bReverse)
+    {
+        *pcbDataOffset = m_cbDataLength - iSendBoundary * cbPacketSize;
+    }
+    else
+    {
+        *pcbDataOffset = iPacket * cbPacketSize;
+    }
 
-    return hr;
+    return S_OK;
 }
 
+
 /////////////////////////////////////////////////////////////////////
-// Name: GetTestDuration
+// Name: GetSeekPositionFromIndex
 //
-//For audio stream, this method retrieves the duration of the test sample.
+// Gets the offset of the index entry at or before the seek time from
+// the natively read index. Index times do not include the preroll.
 //
-// hnsSeekTime: Presentation time in hns.
-// hnsTestDuration: Presentation time in hns that represents the end time.
+// hnsSeekTime: Presentation time in hns, without the preroll.
+// pcbDataOffset: Receives the offset in bytes. In reverse, the offset
+//                is counted back from the end of the data object and
+//                ends at the next index entry.
+// phnsApproxSeekTime: Receives the time of the index entry.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFManager::GetSeekPositionFromIndex(
+                        MFTIME hnsSeekTime,
+                        QWORD *pcbDataOffset,
+                        MFTIME* phnsApproxSeekTime)
+{
+    if (!m_IndexReader.HasIndex(m_CurrentStreamID))
+    {
+        return MF_E_ASF_NOINDEX;
+    }
+
+    DWORD dwFlags = 0;
+    QWORD cbOffset = 0, cbNextOffset = 0;
+
+    HRESULT hr = m_pSplitter->GetFlags(&dwFlags);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    hr = m_IndexReader.FindSeekPoint(
+        m_CurrentStreamID,
+        hnsSeekTime,
+        m_cbDataLength,
+        0,
+        &cbOffset,
+        &cbNextOffset,
+        phnsApproxSeekTime
+        );
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (dwFlags & MFASF_SPLITTER_REVERSE)
+    {
+        *pcbDataOffset = (cbNextOffset < m_cbDataLength) ? m_cbDataLength - cbNextOffset : 0;
+    }
+    else
+    {
+        *pcbDataOffset = cbOffset;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: LoadIndex
+//
+// Reads the Simple Index Objects and the Index Object that follow the
+// Data Object. Mapped files are parsed in place; otherwise the objects
+// are read once through the byte stream into a temporary buffer.
+//
+// pContentByteStream: Pointer to the byte stream of the file.
+// cbIndexOffset:      End of the Data Object, from the cache record
+//                     or the parsed header
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFManager::LoadIndex(IMFByteStream *pContentByteStream, QWORD cbIndexOffset)
+{
+    WORD rgwVideoStreams[ASF_MAX_STREAMS];
+    DWORD cVideoStreams = 0;
+
+    const BYTE* pIndexData = NULL;
+    BYTE* pIndexCopy = NULL;
+
+    QWORD cbFile = 0, cbIndex = 0;
+    ULONG cbRead = 0;
+
+    HRESULT hr = S_OK;
+
+    m_IndexReader.Reset();
+
+    if (m_cbDataOffset == 0)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    // Simple Index Objects apply to the video streams in header order.
+    if (m_fMetadata)
+    {
+        for (DWORD i = 0; i < m_Metadata.cStreams; i++)
+        {
+            if (m_Metadata.streams[i].guidStreamType == ASF_Video_Media)
+            {
+                rgwVideoStreams[cVideoStreams++] = m_Metadata.streams[i].wStreamNumber;
+            }
+        }
+    }
+    else
+    {
+        cVideoStreams = m_HeaderParser.GetVideoStreams(rgwVideoStreams);
+    }
+
+    if (m_MappedFile.IsMapped())
+    {
+        cbFile = m_MappedFile.GetSize();
+    }
+    else
+    {
+        hr = pContentByteStream->GetLength(&cbFile);
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+    }
+
+    if (cbIndexOffset >= cbFile)
+    {
+        // No objects after the data object.
+        goto done;
+    }
+
+    cbIndex = cbFile - cbIndexOffset;
+
+    if (m_MappedFile.IsMapped())
+    {
+        hr = m_MappedFile.GetView(cbIndexOffset, cbIndex, &pIndexData);
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+    }
+    else
+    {
+        if (cbIndex > MAXDWORD)
+        {
+            hr = MF_E_ASF_INVALIDDATA;
+            goto done;
+        }
+
+        pIndexCopy = new (std::nothrow) BYTE[(size_t)cbIndex];
+
+        if (!pIndexCopy)
+        {
+            hr = E_OUTOFMEMORY;
+            goto done;
+        }
+
+        hr = pContentByteStream->SetCurrentPosition(cbIndexOffset);
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+
+        hr = pContentByteStream->Read(pIndexCopy, (ULONG)cbIndex, &cbRead);
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+
+        pIndexData = pIndexCopy;
+        cbIndex = cbRead;
+    }
+
+    hr = m_IndexReader.Parse(
+        pIndexData,
+        cbIndex,
+        m_PacketParser.GetPacketSize(),
+        rgwVideoStreams,
+        cVideoStreams
+        );
+
+done:
+    delete [] pIndexCopy;
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: LoadOrBuildIndexSidecar
+//
+// Loads the index sidecar of the open file. If there is none, or it
+// was written for another version of the file, a key frame index is
+// built in one pass over the mapped packets and saved as the new
+// sidecar. Building requires fixed-size packets.
+//
+// The index last built or loaded is kept in memory for later opens of
+// the same file, so it is not built again where the sidecar cannot be
+// written. Called at most once per open.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFManager::LoadOrBuildIndexSidecar()
+{
+    CASFIndexBuilder builder;
+    HRESULT hr = S_OK;
+
+    WCHAR* sSidecarName = m_sSidecarName;
+    m_sSidecarName = NULL;
+
+    if (!m_BuiltIndex.IsEmpty() &&
+        (m_guidBuiltFileID == m_fileinfo.guidFileID) &&
+        (m_cbBuiltDataLength == m_cbDataLength))
+    {
+        hr = m_IndexReader.CopyFrom(m_BuiltIndex);
+        goto done;
+    }
+
+    m_BuiltIndex.Reset();
+
+    if (!m_MappedFile.IsMapped() ||
+        (m_PacketParser.GetPacketSize() == 0) ||
+        (m_cbDataOffset == 0) ||
+        (m_cbDataOffset > m_MappedFile.GetSize()))
+    {
+        // Without the packets in memory only a saved index can be used.
+        hr = CASFIndexBuilder::LoadSidecar(sSidecarName, m_fileinfo.guidFileID, m_cbDataLength, &m_BuiltIndex);
+    }
+    else
+    {
+        DWORD cbPacketSize = m_PacketParser.GetPacketSize();
+        QWORD cPackets = ASFGetPacketCount(m_MappedFile.GetSize(), m_cbDataOffset, m_cbDataLength, cbPacketSize);
+
+        // The index is usable even if the sidecar cannot be written.
+        hr = builder.LoadOrBuild(
+            sSidecarName,
+            m_fileinfo.guidFileID,
+            m_cbDataLength,
+            m_MappedFile.GetData() + m_cbDataOffset,
+            cPackets,
+            cbPacketSize,
+            (DWORD)(m_fileinfo.hnspreroll / 10000),
+            &m_BuiltIndex
+            );
+    }
+
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    m_guidBuiltFileID = m_fileinfo.guidFileID;
+    m_cbBuiltDataLength = m_cbDataLength;
+
+    hr = m_IndexReader.CopyFrom(m_BuiltIndex);
+
+done:
+    delete [] sSidecarName;
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: StoreMetadata
+//
+// Collects the metadata of the open file and stores it in the cache.
+// The major types come from the profile, as EnumerateStreams returns
+// them.
+//
+// sFileName: Path name of the file
+// cbFile:    Size of the file
+// fHasIndex: The index objects were loaded, natively or by the indexer
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFManager::StoreMetadata(const WCHAR *sFileName, QWORD cbFile, BOOL fHasIndex)
+{
+    WORD* pwStreamNumbers = NULL;
+    GUID* pguidMajorType = NULL;
+    DWORD cStreams = 0;
+
+    HRESULT hr = CASFMetadataCache::GetHeaderMetadata(m_HeaderParser, cbFile, &m_Metadata);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    // Objects after the data object that are not index objects do not
+    // need to be searched again.
+    if (!fHasIndex)
+    {
+        m_Metadata.cbIndexLength = 0;
+    }
+
+    hr = EnumerateStreams(&pwStreamNumbers, &pguidMajorType, &cStreams);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    for (DWORD i = 0; i < cStreams; i++)
+    {
+        for (DWORD j = 0; j < m_Metadata.cStreams; j++)
+        {
+            if (m_Metadata.streams[j].wStreamNumber == pwStreamNumbers[i])
+            {
+                m_Metadata.streams[j].guidMajorType = pguidMajorType[i];
+            }
+        }
+    }
+
+    m_fMetadata = TRUE;
+
+    hr = m_MetadataCache.Store(sFileName, m_Metadata);
+
+done:
+    delete [] pwStreamNumbers;
+    delete [] pguidMajorType;
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetMetadataStreams
+//
+// EnumerateStreams for a file with metadata. Streams the profile did
+// not list when the metadata was collected are left out.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFManager::GetMetadataStreams(WORD** ppwStreamNumbers,
+                                        GUID** ppguidMajorType,
+                                        DWORD* pcTotalStreams)
+{
+    DWORD cStreams = 0;
+
+    WORD* pwStreamNumbers = new (std::nothrow) WORD[ASF_MAX_STREAMS];
+    GUID* pguidMajorType = new (std::nothrow) GUID[ASF_MAX_STREAMS];
+
+    if (!pwStreamNumbers || !pguidMajorType)
+    {
+        delete [] pwStreamNumbers;
+        delete [] pguidMajorType;
+        return E_OUTOFMEMORY;
+    }
+
+    for (DWORD i = 0; i < m_Metadata.cStreams; i++)
+    {
+        if (m_Metadata.streams[i].guidMajorType != GUID_NULL)
+        {
+            pwStreamNumbers[cStreams] = m_Metadata.streams[i].wStreamNumber;
+            pguidMajorType[cStreams] = m_Metadata.streams[i].guidMajorType;
+            cStreams++;
+        }
+    }
+
+    *ppwStreamNumbers = pwStreamNumbers;
+    *ppguidMajorType = pguidMajorType;
+    *pcTotalStreams = cStreams;
+
+    return S_OK;
+}
+
+HRESULT CASFManager::GetSeekPositionWithIndexer (
+                        MFTIME hnsSeekTime,
+                        QWORD *cbDataOffset,
+                        MFTIME* hnsApproxSeekTime)
+{
+    if (! m_pIndexer)
+    {
+        return MF_E_ASF_NOINDEX;
+    }
+
+    BOOL  bReverse = FALSE;
+    DWORD dwFlags = 0;
+
+    HRESULT hr = m_pSplitter->GetFlags(&dwFlags);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (dwFlags & MFASF_SPLITTER_REVERSE)
+    {
+        bReverse = TRUE;
+    }
+
+    hr = ::GetSeekPositionWithIndexer(
+        m_pIndexer,
+        m_CurrentStreamID,
+        hnsSeekTime,
+        bReverse,
+        cbDataOffset,
+        hnsApproxSeekTime
+        );
+
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetTestDuration
+//
+//For audio stream, this method retrieves the duration of the test sample.
+//
+// hnsSeekTime: Presentation time in hns.
+// hnsTestDuration: Presentation time in hns that represents the end time.
 // dwFlags: Specifies splitter configuration, generate samples in reverse
 //          or generate samples for protected content.
 /////////////////////////////////////////////////////////////////////
 
 void CASFManager::GetTestDuration(const MFTIME& hnsSeekTime, BOOL bReverse, MFTIME* phnsTestDuration)
 {
-    MFTIME hnsMaxSeekableTime = m_fileinfo->hnsPlayDuration - m_fileinfo->hnspreroll;
+    MFTIME hnsMaxSeekableTime = m_fileinfo.hnsPlayDuration - m_fileinfo.hnspreroll;
 
     if (bReverse)
     {
@@ -814,7 +1451,8 @@ void CASFManager::GetTestDuration(const MFTIME& hnsSeekTime, BOOL bReverse, MFTI
 // pSampleInfo: Pointer to SAMPLE_INFO structure that stores sample
 //          information.
 // FuncPtrToDisplaySampleInfo: Callback defined by the caller that
-//          will display the sample information
+//          will display the sample information. Not used, and may be
+//          NULL, if SetSampleBatching set a batch callback.
 /////////////////////////////////////////////////////////////////////
 
 HRESULT CASFManager::GenerateSamples(
@@ -830,7 +1468,8 @@ HRESULT CASFManager::GenerateSamples(
     }
 
     QWORD   cbStartOffset = 0;
-    DWORD   cbReadLen = 0;
+    QWORD   cbDataOffset = 0;
+    QWORD   cbReadLen = 0;
     MFTIME  hnsApproxTime =0;
     MFTIME  hnsTestSampleDuration =0;
     BOOL    bReverse = FALSE;
@@ -881,170 +1520,810 @@ HRESULT CASFManager::GenerateSamples(
         }
     }
 
-    cbReadLen = (DWORD)(m_cbDataLength - cbStartOffset);
+    cbReadLen = m_cbDataLength - cbStartOffset;
+
+    // Every call starts a new scan from the seek position.
+    m_ReadPlanner.ResetStats();
+    m_ReadPlanner.OnSeek();
+
+    ZeroMemory(&m_KeyFrameFilterStats, sizeof(m_KeyFrameFilterStats));
+
+    m_SampleBatcher.Reset();
+    m_hrSampleBatch = S_OK;
 
+    // Note: cbStartOffset is relative to the start of the data object.
+    // GenerateSamplesLoop expects the offset relative to the start of the file.
     if (bReverse)
     {
         // Reverse playback: Read from the offset back to zero.
+        cbDataOffset = m_cbDataLength + m_cbDataOffset - cbStartOffset;
+    }
+    else
+    {
+        // Forward playback: Read from the offset to the end.
+        cbDataOffset = m_cbDataOffset + cbStartOffset;
+    }
 
-        hr = GenerateSamplesLoop(
+    if (m_cPipelineDepth > 0)
+    {
+        hr = GenerateSamplesPipelined(
             hnsSeekTime,
             hnsTestSampleDuration,
             bReverse,
-            (DWORD)(m_cbDataLength + m_cbDataOffset - cbStartOffset), //DWORD cbDataOffset
-            cbReadLen,              //DWORD cbDataLen
+            cbDataOffset,
+            cbReadLen,
             pSampleInfo,
             FuncPtrToDisplaySampleInfo
             );
-
     }
     else
     {
-        // Forward playback: Read from the offset to the end.
-
         hr = GenerateSamplesLoop(
             hnsSeekTime,
             hnsTestSampleDuration,
             bReverse,
-            (DWORD)(m_cbDataOffset + cbStartOffset), //DWORD cbDataOffset,
-            cbReadLen,                              //DWORD cbDataLen
+            cbDataOffset,
+            cbReadLen,
             pSampleInfo,
             FuncPtrToDisplaySampleInfo
             );
     }
 
-    // Note: cbStartOffset is relative to the start of the data object.
-    // GenerateSamplesLoop expects the offset relative to the start of the file.
+    // Hand over the last, partial block.
+    if (m_fBatchSamples && (m_hrSampleBatch == S_OK))
+    {
+        m_hrSampleBatch = m_SampleBatcher.Flush();
+    }
+
+    if (SUCCEEDED(hr) && FAILED(m_hrSampleBatch))
+    {
+        hr = m_hrSampleBatch;
+    }
+
+done:
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GenerateKeyFrames
+//
+// Decodes the key frame for each of a sorted list of target times in
+// one forward pass over the data object. For each target, the first
+// key frame at or after the target time is decoded, the same frame
+// GenerateSamples picks for a forward seek. Targets that share a key
+// frame get the same frame, decoded once.
+//
+// The splitter is flushed and the decoder started once for the whole
+// batch; the read planner keeps growing its reads across targets.
+// When the next target is further ahead than the key frame just found,
+// the demux jumps forward to it instead of reading the packets in
+// between.
+//
+// Frames are delivered as soon as they are decoded: the callback gets
+// the index of the target and the sample information, while the
+// frame is the current bitmap of the media controller.
+//
+// phnsTargetTimes: Presentation times in hns, without preroll, sorted
+//                  in ascending order.
+// cTargetTimes: Number of target times.
+// pSampleInfo: Pointer to SAMPLE_INFO structure that stores sample
+//          information.
+// FuncPtrToDeliverKeyFrame: Callback defined by the caller that
+//          receives each frame
+//
+// Returns S_FALSE if the data object ended before a key frame was
+// found for every target.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFManager::GenerateKeyFrames(
+    const MFTIME* phnsTargetTimes,
+    DWORD cTargetTimes,
+    SAMPLE_INFO* pSampleInfo,
+    void (*FuncPtrToDeliverKeyFrame)(DWORD, SAMPLE_INFO*)
+    )
+{
+    if (!phnsTargetTimes || (cTargetTimes == 0) || !pSampleInfo || !FuncPtrToDeliverKeyFrame)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (!m_pSplitter)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    if (!m_pDecoder || (m_guidCurrentMediaType != MFMediaType_Video))
+    {
+        return MF_E_INVALIDREQUEST;
+    }
+
+    for (DWORD i = 1; i < cTargetTimes; i++)
+    {
+        if (phnsTargetTimes[i] < phnsTargetTimes[i - 1])
+        {
+            return E_INVALIDARG;
+        }
+    }
+
+    QWORD   cbStartOffset = 0;
+    MFTIME  hnsSeekTime = phnsTargetTimes[0];
+    MFTIME  hnsApproxTime = 0;
+
+    KEY_FRAME_BATCH batch = { phnsTargetTimes, cTargetTimes, 0, 0, 0, FuncPtrToDeliverKeyFrame };
+
+    // Flush the splitter once for the whole batch.
+    HRESULT hr = m_pSplitter->Flush();
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = m_pSplitter->SetFlags(0);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = GetSeekPosition(&hnsSeekTime, &cbStartOffset, &hnsApproxTime);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    if (m_pDecoder->GetDecoderStatus() != STREAMING)
+    {
+        hr = m_pDecoder->StartDecoding();
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+    }
+
+    m_ReadPlanner.ResetStats();
+    m_ReadPlanner.OnSeek();
+
+    ZeroMemory(&m_KeyFrameFilterStats, sizeof(m_KeyFrameFilterStats));
+
+    m_pKeyFrameBatch = &batch;
+
+    if (m_cPipelineDepth > 0)
+    {
+        hr = GenerateSamplesPipelined(
+            hnsSeekTime,
+            0,
+            FALSE,
+            m_cbDataOffset + cbStartOffset,
+            m_cbDataLength - cbStartOffset,
+            pSampleInfo,
+            NULL
+            );
+    }
+    else
+    {
+        hr = GenerateSamplesLoop(
+            hnsSeekTime,
+            0,
+            FALSE,
+            m_cbDataOffset + cbStartOffset,
+            m_cbDataLength - cbStartOffset,
+            pSampleInfo,
+            NULL
+            );
+    }
+
+    m_pKeyFrameBatch = NULL;
+
+    //All frames have been decoded. Inform the decoder.
+    (void)m_pDecoder->StopDecoding();
+
+    if (SUCCEEDED(hr) && (batch.iDecodeTarget < cTargetTimes))
+    {
+        hr = S_FALSE;
+    }
+
+done:
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GenerateSamplesLoop
+//
+//Reads chunks of media data and parses the ASF Data Object starting at
+//the specified offset. The read planner sizes the chunks in whole
+//packets, starting small and growing while the scan continues. If the
+//file is mapped, the chunks are ranges of one buffer view over the
+//mapping; otherwise they are read from the byte stream.
+//Forward scans of mapped files are demuxed by the native packet parser;
+//reverse scans and unmapped files go through the splitter.
+//Collects 5seconds audio samples and sends to the MFT to decode.
+//Gets the first key frame for the video stream and sends to the MFT
+//
+// hnsSeekTime: Presentation time in hns.
+// hnsTestSampleDuration: Presentation time at which the parsing should end.
+// bReverse: Specifies if the splitter configured to parse in reverse.
+// cbDataOffset: Offset relative to the start of the data object.
+// cbDataLen: Length of data to parse
+// pSampleInfo: Pointer to SAMPLE_INFO structure that stores sample
+//          information.
+// FuncPtrToDisplaySampleInfo: Callback defined by the caller that
+//          will display the sample information
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFManager::GenerateSamplesLoop(
+    const MFTIME& hnsSeekTime,
+    const MFTIME& hnsTestSampleDuration,
+    BOOL  bReverse,
+    QWORD cbDataOffset,
+    QWORD cbDataLen,
+    SAMPLE_INFO* pSampleInfo,
+    void (*FuncPtrToDisplaySampleInfo)(SAMPLE_INFO*)
+    )
+{
+    HRESULT hr = S_OK;
+    DWORD   cbRead = 0;
+    DWORD   cbBufferOffset = 0;
+    DWORD   cbBufferLength = 0;
+    DWORD   dwStatusFlags = 0;
+    WORD    wStreamNumber =  0;
+    BOOL    fComplete = FALSE;
+
+    IMFSample *pSample = NULL;
+    IMFMediaBuffer *pBuffer = NULL;
+
+    const BYTE *pPackets = NULL;
+
+    // Forward scans of mapped files with fixed-size packets are demuxed
+    // natively; the read planner keeps every chunk packet-aligned.
+    BOOL fNativeDemux = (!bReverse &&
+                         m_MappedFile.IsMapped() &&
+                         (m_PacketParser.GetPacketSize() > 0) &&
+                         (m_ReadPlanner.GetPacketSize() == m_PacketParser.GetPacketSize()));
+
+    SafeRelease(&m_pObjectSample);
+    m_ObjectAssembler.Reset();
+
+    while (!fComplete && (cbDataLen > 0))
+    {
+        cbRead = m_ReadPlanner.GetNextReadSize(cbDataLen);
+
+        if (fNativeDemux)
+        {
+            hr = m_MappedFile.GetView(cbDataOffset, cbRead, &pPackets);
+            if (FAILED(hr))
+            {
+                goto done;
+            }
+
+            hr = DemuxPacketsNative(
+                pPackets,
+                cbRead,
+                hnsSeekTime,
+                hnsTestSampleDuration,
+                bReverse,
+                &fComplete,
+                pSampleInfo,
+                FuncPtrToDisplaySampleInfo
+                );
+
+            if (FAILED(hr))
+            {
+                goto done;
+            }
+
+            m_ReadPlanner.OnReadComplete(cbRead);
+
+            cbDataOffset += cbRead;
+            cbDataLen -= cbRead;
+
+            SkipToNextKeyFrameTarget(&cbDataOffset, &cbDataLen);
+
+            continue;
+        }
+
+        if (bReverse)
+        {
+            // Reverse playback: Read data chunks going backward from cbDataOffset.
+            hr = GetDataChunk(cbDataOffset - cbRead, cbRead, bReverse, &pBuffer, &cbBufferOffset, &cbBufferLength);
+            if (FAILED(hr))
+            {
+                goto done;
+            }
+
+            cbDataOffset -= cbRead;
+            cbDataLen -= cbRead;
+        }
+        else
+        {
+            // Forward playback: Read data chunks going forward from cbDataOffset.
+            hr = GetDataChunk(cbDataOffset, cbRead, bReverse, &pBuffer, &cbBufferOffset, &cbBufferLength);
+            if (FAILED(hr))
+            {
+                goto done;
+            }
+
+            cbDataOffset += cbRead;
+            cbDataLen -= cbRead;
+        }
+
+        // Push data on the splitter
+        hr =  m_pSplitter->ParseData(pBuffer, cbBufferOffset, cbBufferLength);
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+
+        m_ReadPlanner.OnReadComplete(cbBufferLength);
+
+        // Start getting samples from the splitter as long as it returns ASF_STATUSFLAGS_INCOMPLETE
+        do
+        {
+            hr = m_pSplitter->GetNextSample(&dwStatusFlags, &wStreamNumber, &pSample);
+            if (FAILED(hr))
+            {
+                goto done;
+            }
+
+            if (pSample)
+            {
+                DeliverSample(pSample, wStreamNumber, hnsSeekTime, hnsTestSampleDuration, bReverse, &fComplete, pSampleInfo, FuncPtrToDisplaySampleInfo);
+
+                if (fComplete)
+                {
+                    break;
+                }
+            }
+
+            SafeRelease(&pSample);
+
+        } while (dwStatusFlags & ASF_STATUSFLAGS_INCOMPLETE);
+
+        SafeRelease(&pBuffer);
+
+        if (!bReverse && !fComplete && (m_pKeyFrameBatch != NULL) && (m_pKeyFrameBatch->cbSkipTo > cbDataOffset))
+        {
+            // The packets up to the next target are skipped; drop the
+            // partial data the splitter holds.
+            hr = m_pSplitter->Flush();
+            if (FAILED(hr))
+            {
+                goto done;
+            }
+
+            SkipToNextKeyFrameTarget(&cbDataOffset, &cbDataLen);
+        }
+    }
+
+done:
+    SafeRelease(&pBuffer);
+    SafeRelease(&pSample);
+    SafeRelease(&m_pObjectSample);
+    m_ObjectAssembler.Reset();
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GenerateSamplesPipelined
+//
+// Runs GenerateSamplesLoop on a demux thread that reads and splits the
+// data object, while the calling thread decodes. The compressed samples
+// pass through a lock-free single-producer/single-consumer ring; while
+// the ring is full the demux thread waits, so reading never runs more
+// than the ring size ahead of the decoder. Once the decoder has all the
+// samples it needs, the ring is stopped and the demux thread ends.
+//
+// The decoder and the display callback stay on the calling thread,
+// which created the decoder and owns the window the callback updates.
+//
+// The parameters are those of GenerateSamplesLoop.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFManager::GenerateSamplesPipelined(
+    const MFTIME& hnsSeekTime,
+    const MFTIME& hnsTestSampleDuration,
+    BOOL  bReverse,
+    QWORD cbDataOffset,
+    QWORD cbDataLen,
+    SAMPLE_INFO* pSampleInfo,
+    void (*FuncPtrToDisplaySampleInfo)(SAMPLE_INFO*)
+    )
+{
+    BOOL fComplete = FALSE;
+
+    ASF_SAMPLE_RING_ENTRY entry;
+    CASFThread thread;
+
+    DEMUX_THREAD_PARAMS params = { this, hnsSeekTime, hnsTestSampleDuration, bReverse, cbDataOffset, cbDataLen, S_OK };
+
+    HRESULT hr = m_SampleRing.Initialize(m_cPipelineDepth);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    m_fPipelineDemux = TRUE;
+
+    hr = thread.Start(DemuxThreadProc, &params);
+    if (FAILED(hr))
+    {
+        m_fPipelineDemux = FALSE;
+        return hr;
+    }
+
+    // Decode until the demux thread closes the ring. Samples that are
+    // still queued after the decoder is done are only released.
+    while (m_SampleRing.Pop(&entry) == S_OK)
+    {
+        IMFSample* pSample = (IMFSample*)entry.pSample;
+
+        if (!fComplete)
+        {
+            SendSampleToDecoder(pSample, entry.wStreamNumber, hnsSeekTime, hnsTestSampleDuration, bReverse, &fComplete, pSampleInfo, FuncPtrToDisplaySampleInfo);
+
+            if (fComplete)
+            {
+                m_SampleRing.Stop();
+            }
+        }
+
+        SafeRelease(&pSample);
+    }
+
+    thread.Join();
+
+    m_fPipelineDemux = FALSE;
+
+    return params.hr;
+}
+
+//-----------------------------------------------------------------------------
+// Name: DemuxThreadProc
+// Desc: Entry point of the demux thread of GenerateSamplesPipelined.
+//
+// Note: This is a static method. The samples go to the ring through
+//       DeliverSample; the ring is closed when the loop returns.
+//-----------------------------------------------------------------------------
+
+void CASFManager::DemuxThreadProc(void* pContext)
+{
+    DEMUX_THREAD_PARAMS* pParams = (DEMUX_THREAD_PARAMS*)pContext;
+
+    CASFManager* pThis = pParams->pThis;
+
+    pParams->hr = pThis->GenerateSamplesLoop(
+        pParams->hnsSeekTime,
+        pParams->hnsTestSampleDuration,
+        pParams->bReverse,
+        pParams->cbDataOffset,
+        pParams->cbDataLen,
+        NULL,
+        NULL
+        );
+
+    pThis->m_SampleRing.Close();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ScanSamples
+//
+// Builds the sample timelines of all streams by parsing the whole
+// data object on worker threads. Requires a mapped file with fixed-size
+// packets, where packet boundaries are known without parsing.
+// Use GetScannedSamples to read the results.
+//
+// cThreads: Number of threads, 0 for one per processor
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFManager::ScanSamples(DWORD cThreads)
+{
+    if (m_cbDataOffset == 0)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    if (!m_MappedFile.IsMapped() ||
+        (m_PacketParser.GetPacketSize() == 0) ||
+        (m_cbDataOffset > m_MappedFile.GetSize()))
+    {
+        return MF_E_INVALIDREQUEST;
+    }
+
+    DWORD cbPacketSize = m_PacketParser.GetPacketSize();
+
+    return m_Scanner.Scan(
+        m_MappedFile.GetData() + m_cbDataOffset,
+        ASFGetPacketCount(m_MappedFile.GetSize(), m_cbDataOffset, m_cbDataLength, cbPacketSize),
+        cbPacketSize,
+        m_cbDataOffset,
+        cThreads
+        );
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: DeliverSample
+//
+// Hands a compressed sample of the selected stream on, the same way for
+// the splitter and the native demux. In pipelined mode the sample is
+// queued for the decode thread; otherwise it is decoded right away.
+//
+// pSample: Compressed sample
+// wStreamNumber: Stream the sample belongs to
+// pbComplete: Set to TRUE when no more samples are needed.
+/////////////////////////////////////////////////////////////////////
+
+void CASFManager::DeliverSample(
+    IMFSample* pSample,
+    WORD wStreamNumber,
+    const MFTIME& hnsSeekTime,
+    const MFTIME& hnsTestSampleDuration,
+    BOOL bReverse,
+    BOOL* pbComplete,
+    SAMPLE_INFO* pSampleInfo,
+    void (*FuncPtrToDisplaySampleInfo)(SAMPLE_INFO*)
+    )
+{
+    DWORD cbSample = 0;
+
+    (void)pSample->GetTotalLength(&cbSample);
+
+    // The splitter builds samples for every object; in key frame mode
+    // the others are dropped here. The native demux drops them earlier.
+    if ((m_fKeyFramesOnly || m_pKeyFrameBatch) &&
+        !MFGetAttributeUINT32(pSample, MFSampleExtension_CleanPoint, FALSE))
+    {
+        m_KeyFrameFilterStats.cbSkipped += cbSample;
+        m_KeyFrameFilterStats.cObjectsSkipped++;
+        return;
+    }
+
+    m_KeyFrameFilterStats.cbDelivered += cbSample;
+    m_KeyFrameFilterStats.cObjectsDelivered++;
+
+    // In a key frame batch, only the key frames that serve a target go on.
+    if (m_pKeyFrameBatch && !SelectKeyFrameForBatch(pSample, pbComplete))
+    {
+        return;
+    }
+
+    if (m_fPipelineDemux)
+    {
+        // The ring holds a reference until the decode thread takes the sample.
+        ASF_SAMPLE_RING_ENTRY entry = { pSample, wStreamNumber };
+
+        pSample->AddRef();
+
+        // Waits while the ring is full. S_FALSE means the decode
+        // thread has all the samples it needs.
+        if (m_SampleRing.Push(entry) != S_OK)
+        {
+            pSample->Release();
+            *pbComplete = TRUE;
+        }
+
+        return;
+    }
+
+    SendSampleToDecoder(pSample, wStreamNumber, hnsSeekTime, hnsTestSampleDuration, bReverse, pbComplete, pSampleInfo, FuncPtrToDisplaySampleInfo);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: SendSampleToDecoder
+//
+// Sends a compressed sample of the selected stream to the decoder.
+//
+// pSample: Compressed sample
+// wStreamNumber: Stream the sample belongs to
+// pbComplete: Set to TRUE when no more samples are needed.
+/////////////////////////////////////////////////////////////////////
+
+void CASFManager::SendSampleToDecoder(
+    IMFSample* pSample,
+    WORD wStreamNumber,
+    const MFTIME& hnsSeekTime,
+    const MFTIME& hnsTestSampleDuration,
+    BOOL bReverse,
+    BOOL* pbComplete,
+    SAMPLE_INFO* pSampleInfo,
+    void (*FuncPtrToDisplaySampleInfo)(SAMPLE_INFO*)
+    )
+{
+    // Get sample information
+    pSampleInfo->wStreamNumber = wStreamNumber;
+
+    //if decoder is initialized, collect test data
+    if (m_pDecoder)
+    {
+        if (m_guidCurrentMediaType == MFMediaType_Audio)
+        {
+            // Send audio data to the decoder.
+            (void)SendAudioSampleToDecoder(pSample, hnsTestSampleDuration, bReverse, pbComplete, pSampleInfo, FuncPtrToDisplaySampleInfo);
+        }
+        else if ((m_guidCurrentMediaType == MFMediaType_Video) && m_pKeyFrameBatch)
+        {
+            // Decode a key frame of a batch.
+            (void)SendBatchKeyFrameToDecoder(pSample, pSampleInfo);
+        }
+        else if (m_guidCurrentMediaType == MFMediaType_Video)
+        {
+            // Send video data to the decoder.
+            (void)SendKeyFrameToDecoder(pSample, hnsSeekTime, bReverse, pbComplete, pSampleInfo, FuncPtrToDisplaySampleInfo);
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: DemuxPacketsNative
+//
+// Parses a packet-aligned range of the mapped data object with the
+// native packet parser and delivers the media objects of the selected
+// stream. A media object is delivered as one sample with a buffer view
+// per payload, so the payload data is not copied. Objects that span
+// reads are carried over in m_pObjectSample.
+//
+// pPackets: First byte of the first packet
+// cbPackets: Size of the range, a whole number of packets
+// pbComplete: Set to TRUE when no more samples are needed.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFManager::DemuxPacketsNative(
+    const BYTE* pPackets,
+    DWORD cbPackets,
+    const MFTIME& hnsSeekTime,
+    const MFTIME& hnsTestSampleDuration,
+    BOOL bReverse,
+    BOOL* pbComplete,
+    SAMPLE_INFO* pSampleInfo,
+    void (*FuncPtrToDisplaySampleInfo)(SAMPLE_INFO*)
+    )
+{
+    HRESULT hr = S_OK;
+
+    ASF_PAYLOAD_INFO payload;
+    IMFSample* pSample = NULL;
+
+    DWORD cbPacketSize = m_PacketParser.GetPacketSize();
+
+    for (DWORD cbPos = 0; (cbPos + cbPacketSize <= cbPackets) && !(*pbComplete); cbPos += cbPacketSize)
+    {
+        hr = m_PacketParser.ParsePacket(pPackets + cbPos, cbPacketSize, NULL);
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+
+        while (!(*pbComplete))
+        {
+            hr = m_PacketParser.GetNextPayload(&payload);
+            if (hr != S_OK)
+            {
+                break;
+            }
+
+            if (payload.bStreamNumber != m_CurrentStreamID)
+            {
+                continue;
+            }
+
+            // In key frame mode, payloads of other objects are dropped on
+            // their header: no sample, buffer view or copy is made.
+            if (!payload.fKeyFrame && (m_fKeyFramesOnly || m_pKeyFrameBatch))
+            {
+                CASFObjectAssembler::SkipPayload(payload, &m_KeyFrameFilterStats);
+                continue;
+            }
+
+            hr = AddPayloadToObject(payload, &pSample);
+            if (FAILED(hr))
+            {
+                goto done;
+            }
+
+            if (pSample)
+            {
+                DeliverSample(pSample, m_CurrentStreamID, hnsSeekTime, hnsTestSampleDuration, bReverse, pbComplete, pSampleInfo, FuncPtrToDisplaySampleInfo);
+
+                SafeRelease(&pSample);
+            }
+        }
+
+        if (FAILED(hr))
+        {
+            goto done;
+        }
 
+        hr = S_OK;
+    }
 
 done:
+    SafeRelease(&pSample);
     return hr;
 }
 
 /////////////////////////////////////////////////////////////////////
-// Name: GenerateSamplesLoop
+// Name: AddPayloadToObject
 //
-//Reads 1024 * 4 byte chunks of media data from a byte stream and
-//parses the ASF Data Object starting at the specified offset.
-//Collects 5seconds audio samples and sends to the MFT to decode.
-//Gets the first key frame for the video stream and sends to the MFT
+// Appends a payload to the media object being assembled, as
+// CASFObjectAssembler tracks it, and returns the object as a sample
+// once it is complete. Fragments of objects whose start was not seen
+// (e.g. right after a seek) are dropped.
 //
-// hnsSeekTime: Presentation time in hns.
-// hnsTestSampleDuration: Presentation time at which the parsing should end.
-// bReverse: Specifies if the splitter configured to parse in reverse.
-// cbDataOffset: Offset relative to the start of the data object.
-// cbDataLen: Length of data to parse
-// pSampleInfo: Pointer to SAMPLE_INFO structure that stores sample
-//          information.
-// FuncPtrToDisplaySampleInfo: Callback defined by the caller that
-//          will display the sample information
+// payload: Payload of the selected stream
+// ppSample: Receives the completed sample, or NULL.
 /////////////////////////////////////////////////////////////////////
 
-HRESULT CASFManager::GenerateSamplesLoop(
-    const MFTIME& hnsSeekTime,
-    const MFTIME& hnsTestSampleDuration,
-    BOOL  bReverse,
-    DWORD cbDataOffset,
-    DWORD cbDataLen,
-    SAMPLE_INFO* pSampleInfo,
-    void (*FuncPtrToDisplaySampleInfo)(SAMPLE_INFO*)
-    )
+HRESULT CASFManager::AddPayloadToObject(const ASF_PAYLOAD_INFO& payload, IMFSample** ppSample)
 {
-    const DWORD READ_SIZE = 1024 * 4;
-
-    HRESULT hr = S_OK;
-    DWORD   cbRead = 0;
-    DWORD   dwStatusFlags = 0;
-    WORD    wStreamNumber =  0;
-    BOOL    fComplete = FALSE;
-
-    IMFSample *pSample = NULL;
-    IMFMediaBuffer *pBuffer = NULL;
+    BOOL fStart = FALSE, fComplete = FALSE;
+    IMFMediaBuffer* pBuffer = NULL;
 
-    MFTIME hnsCurrentSampleTime = 0;
+    *ppSample = NULL;
 
-    while (!fComplete && (cbDataLen > 0))
+    HRESULT hr = m_ObjectAssembler.AddPayload(payload, &fStart, &fComplete);
+    if (hr != S_OK)
     {
-        cbRead = min(READ_SIZE, cbDataLen);
+        // A fragment of an object we cannot complete, or one that runs
+        // past the end of its object, is dropped with the object
+        SafeRelease(&m_pObjectSample);
+        hr = S_OK;
+        goto done;
+    }
 
-        if (bReverse)
-        {
-            // Reverse playback: Read data chunks going backward from cbDataOffset.
-            hr = ReadDataIntoBuffer(m_pByteStream, cbDataOffset - cbRead, cbRead, &pBuffer);
-            if (FAILED(hr))
-            {
-                goto done;
-            }
+    if (fStart)
+    {
+        SafeRelease(&m_pObjectSample);
 
-            cbDataOffset -= cbRead;
-            cbDataLen -= cbRead;
-        }
-        else
+        hr = MFCreateSample(&m_pObjectSample);
+        if (FAILED(hr))
         {
-            // Forward playback: Read data chunks going forward from cbDataOffset.
-            hr = ReadDataIntoBuffer(m_pByteStream, cbDataOffset, cbRead, &pBuffer);
-            if (FAILED(hr))
-            {
-                goto done;
-            }
-
-            cbDataOffset += cbRead;
-            cbDataLen -= cbRead;
+            goto done;
         }
 
-        // Push data on the splitter
-        hr =  m_pSplitter->ParseData(pBuffer, 0, 0);
+        hr = m_pObjectSample->SetSampleTime((MFTIME)payload.dwPresentationTime * 10000);
         if (FAILED(hr))
         {
             goto done;
         }
 
-        // Start getting samples from the splitter as long as it returns ASF_STATUSFLAGS_INCOMPLETE
-        do
+        if (payload.fKeyFrame)
         {
-            hr = m_pSplitter->GetNextSample(&dwStatusFlags, &wStreamNumber, &pSample);
+            hr = m_pObjectSample->SetUINT32(MFSampleExtension_CleanPoint, TRUE);
             if (FAILED(hr))
             {
                 goto done;
             }
+        }
+    }
+    else if (!m_pObjectSample)
+    {
+        // The object was dropped by a seek
+        m_ObjectAssembler.Reset();
+        goto done;
+    }
 
-            if (pSample)
-            {
-                // Get sample information
-                pSampleInfo->wStreamNumber = wStreamNumber;
-
-                //if decoder is initialized, collect test data
-                if (m_pDecoder)
-                {
-                    if (m_guidCurrentMediaType == MFMediaType_Audio)
-                    {
-                        // Send audio data to the decoder.
-                        (void)SendAudioSampleToDecoder(pSample, hnsTestSampleDuration, bReverse, &fComplete, pSampleInfo, FuncPtrToDisplaySampleInfo);
-                    }
-                    else if (m_guidCurrentMediaType == MFMediaType_Video)
-                    {
-                        // Send video data to the decoder.
-                        (void)SendKeyFrameToDecoder(pSample, hnsSeekTime, bReverse, &fComplete, pSampleInfo, FuncPtrToDisplaySampleInfo);
-
-                    }
-
-                    if (fComplete)
-                    {
-                        break;
-                    }
-                }
-            }
-
-            SafeRelease(&pSample);
+    hr = CMediaBufferView::CreateInstance((BYTE*)payload.pData, payload.cbData, payload.cbData, &pBuffer);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
 
-        } while (dwStatusFlags & ASF_STATUSFLAGS_INCOMPLETE);
+    hr = m_pObjectSample->AddBuffer(pBuffer);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
 
-        SafeRelease(&pBuffer);
+    if (fComplete)
+    {
+        *ppSample = m_pObjectSample;
+        m_pObjectSample = NULL;
     }
 
 done:
+    if (FAILED(hr))
+    {
+        SafeRelease(&m_pObjectSample);
+        m_ObjectAssembler.Reset();
+    }
     SafeRelease(&pBuffer);
-    SafeRelease(&pSample);
     return hr;
 }
 
@@ -1073,6 +2352,7 @@ HRESULT CASFManager::SendAudioSampleToDecoder(
 
     MFTIME hnsCurrentSampleTime = 0;
     BOOL   bShouldDecode = FALSE;
+    BOOL   bStop = FALSE;
 
     // Get the time stamp on the sample.
     HRESULT hr = pSample->GetSampleTime(&hnsCurrentSampleTime);
@@ -1109,11 +2389,8 @@ HRESULT CASFManager::SendAudioSampleToDecoder(
             goto done;
         }
 
-        //Get sample information
-        (void)GetSampleInfo(pSample, pSampleInfo);
-
-        //Send it to callback to display
-        FuncPtrToDisplaySampleInfo(pSampleInfo);
+        //Send the sample information to the caller
+        bStop = ReportSampleInfo(pSample, pSampleInfo, FuncPtrToDisplaySampleInfo);
     }
     else
     {
@@ -1125,7 +2402,7 @@ HRESULT CASFManager::SendAudioSampleToDecoder(
         }
     }
 
-    *pbComplete = !bShouldDecode;
+    *pbComplete = !bShouldDecode || bStop;
 
 done:
     return hr;
@@ -1168,9 +2445,9 @@ HRESULT CASFManager::SendKeyFrameToDecoder(
         goto done;
     }
 
-    if ((UINT64)hnsCurrentSampleTime > m_fileinfo->hnspreroll)
+    if ((UINT64)hnsCurrentSampleTime > m_fileinfo.hnspreroll)
     {
-        hnsCurrentSampleTime -= m_fileinfo->hnspreroll;
+        hnsCurrentSampleTime -= m_fileinfo.hnspreroll;
     }
 
     // Check if the key-frame attribute is set on the sample
@@ -1224,12 +2501,10 @@ HRESULT CASFManager::SendKeyFrameToDecoder(
 
         *fDecodedKeyFrame = TRUE;
 
-        //Get sample information
-        (void)GetSampleInfo(pSample, pSampleInfo);
+        //Send the sample information to the caller
         pSampleInfo->fSeekedKeyFrame = *fDecodedKeyFrame;
 
-        //Send it to callback to display
-        FuncPtrToDisplaySampleInfo(pSampleInfo);
+        (void)ReportSampleInfo(pSample, pSampleInfo, FuncPtrToDisplaySampleInfo);
 
         hr =  m_pDecoder->StopDecoding();
     }
@@ -1238,6 +2513,116 @@ done:
     return hr;
 }
 
+/////////////////////////////////////////////////////////////////////
+// Name: GetDataChunk
+//
+// Returns a buffer and the range within it that holds the requested
+// chunk of the file.
+//
+// If the file is mapped, the chunk is a range of a buffer view over the
+// mapped data object. The view is created once and reused for every
+// chunk, so there is no allocation, seek or copy per chunk. A new view
+// is only created when the data object is larger than MAX_VIEW_SIZE
+// and the chunk leaves the current window; in that case the window is
+// laid out in the direction of traversal.
+//
+// Otherwise the chunk is read from the byte stream into a new buffer.
+//
+// cbOffset: Offset of the chunk from the start of the file
+// cbToRead: Size of the chunk in bytes
+// bReverse: Specifies if the data object is traversed backwards.
+// ppBuffer: Receives a pointer to the buffer.
+// pcbBufferOffset: Receives the offset of the chunk within the buffer.
+// pcbLength: Receives the number of valid bytes in the chunk.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFManager::GetDataChunk(
+    QWORD cbOffset,
+    DWORD cbToRead,
+    BOOL bReverse,
+    IMFMediaBuffer **ppBuffer,
+    DWORD *pcbBufferOffset,
+    DWORD *pcbLength
+    )
+{
+    const QWORD MAX_VIEW_SIZE = 0x40000000;
+
+    HRESULT hr = S_OK;
+
+    if (!m_MappedFile.IsMapped())
+    {
+        hr = ReadDataIntoBuffer(m_pByteStream, cbOffset, cbToRead, ppBuffer);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        *pcbBufferOffset = 0;
+
+        return (*ppBuffer)->GetCurrentLength(pcbLength);
+    }
+
+    QWORD cbChunkStart = min(cbOffset, m_MappedFile.GetSize());
+    QWORD cbChunkEnd = min(cbChunkStart + cbToRead, m_MappedFile.GetSize());
+
+    if (!m_pDataBuffer ||
+        (cbChunkStart < m_cbDataBufferStart) ||
+        (cbChunkEnd > m_cbDataBufferStart + m_cbDataBufferLength))
+    {
+        QWORD cbDataStart = m_cbDataOffset;
+        QWORD cbDataEnd = min(m_cbDataOffset + m_cbDataLength, m_MappedFile.GetSize());
+
+        QWORD cbWindowStart = cbDataStart;
+        QWORD cbWindowEnd = cbDataEnd;
+
+        if (cbDataEnd - cbDataStart > MAX_VIEW_SIZE)
+        {
+            if (bReverse)
+            {
+                cbWindowEnd = cbChunkEnd;
+                cbWindowStart = max(cbDataStart, cbChunkEnd - min(cbChunkEnd, MAX_VIEW_SIZE));
+            }
+            else
+            {
+                cbWindowStart = cbChunkStart;
+                cbWindowEnd = min(cbDataEnd, cbChunkStart + MAX_VIEW_SIZE);
+            }
+        }
+
+        // The window always covers the chunk itself.
+        cbWindowStart = min(cbWindowStart, cbChunkStart);
+        cbWindowEnd = max(cbWindowEnd, cbChunkEnd);
+
+        // Samples that the splitter already delivered keep the old view alive.
+        SafeRelease(&m_pDataBuffer);
+        m_cbDataBufferStart = 0;
+        m_cbDataBufferLength = 0;
+
+        hr = CMediaBufferView::CreateInstance(
+            (BYTE*)m_MappedFile.GetData() + cbWindowStart,
+            (DWORD)(cbWindowEnd - cbWindowStart),
+            (DWORD)(cbWindowEnd - cbWindowStart),
+            &m_pDataBuffer
+            );
+
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        m_cbDataBufferStart = cbWindowStart;
+        m_cbDataBufferLength = cbWindowEnd - cbWindowStart;
+    }
+
+    *pcbBufferOffset = (DWORD)(cbChunkStart - m_cbDataBufferStart);
+    *pcbLength = (DWORD)(cbChunkEnd - cbChunkStart);
+
+    *ppBuffer = m_pDataBuffer;
+    (*ppBuffer)->AddRef();
+
+    return S_OK;
+}
+
 /////////////////////////////////////////////////////////////////////
 // Name: ReadDataIntoBuffer
 //
@@ -1252,7 +2637,7 @@ done:
 
 HRESULT CASFManager::ReadDataIntoBuffer(
     IMFByteStream *pStream,     // Pointer to the byte stream.
-    DWORD cbOffset,             // Offset at which to start reading
+    QWORD cbOffset,             // Offset at which to start reading
     DWORD cbToRead,             // Number of bytes to read
     IMFMediaBuffer **ppBuffer   // Receives a pointer to the buffer.
     )
@@ -1319,53 +2704,186 @@ done:
 }
 
 //////////////////////////////////////////////////////////////////////////
-//  Name: SetFilePropertiesObject
-//  Description: Retrieves ASF File Object information through attributes on
-//  the presentation descriptor that is generated from Content Info
+//  Name: GetFileProperties
+//  Description: Copies the ASF File Object information that was parsed
+//  natively when the file was opened
 //
 /////////////////////////////////////////////////////////////////////////
 
-HRESULT CASFManager::SetFilePropertiesObject(FILE_PROPERTIES_OBJECT* fileinfo)
+HRESULT CASFManager::GetFileProperties(FILE_PROPERTIES_OBJECT* fileinfo) const
 {
+    if (!fileinfo)
+    {
+        return E_POINTER;
+    }
+
     if (! m_pContentInfo)
     {
         return MF_E_NOT_INITIALIZED;
     }
 
-    IMFPresentationDescriptor *pPD = NULL;
+    *fileinfo = m_fileinfo;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: SelectKeyFrameForBatch
+//
+// Demux side of GenerateKeyFrames. Returns TRUE for a key frame at or
+// after the next target time, and moves on to the first target after
+// it. If that target lies further ahead, its seek position is stored
+// so the demux loop can jump there.
+//
+// pSample: Compressed sample of the selected stream
+// pbComplete: Set to TRUE once every target has a key frame.
+/////////////////////////////////////////////////////////////////////
+
+BOOL CASFManager::SelectKeyFrameForBatch(IMFSample* pSample, BOOL* pbComplete)
+{
+    KEY_FRAME_BATCH* pBatch = m_pKeyFrameBatch;
+
+    MFTIME hnsTime = 0;
+    MFTIME hnsNextTarget = 0;
+    MFTIME hnsApproxTime = 0;
+    QWORD  cbNextOffset = 0;
+
+    if (pBatch->iDemuxTarget >= pBatch->cTargets)
+    {
+        *pbComplete = TRUE;
+        return FALSE;
+    }
+
+    if (!MFGetAttributeUINT32(pSample, MFSampleExtension_CleanPoint, FALSE) ||
+        FAILED(pSample->GetSampleTime(&hnsTime)))
+    {
+        return FALSE;
+    }
+
+    if ((UINT64)hnsTime > m_fileinfo.hnspreroll)
+    {
+        hnsTime -= m_fileinfo.hnspreroll;
+    }
+
+    if (hnsTime < pBatch->phnsTargetTimes[pBatch->iDemuxTarget])
+    {
+        return FALSE;
+    }
+
+    // Every target up to this key frame is served by it.
+    while ((pBatch->iDemuxTarget < pBatch->cTargets) &&
+           (pBatch->phnsTargetTimes[pBatch->iDemuxTarget] <= hnsTime))
+    {
+        pBatch->iDemuxTarget++;
+    }
+
+    if (pBatch->iDemuxTarget >= pBatch->cTargets)
+    {
+        *pbComplete = TRUE;
+    }
+    else
+    {
+        hnsNextTarget = pBatch->phnsTargetTimes[pBatch->iDemuxTarget];
+
+        if (SUCCEEDED(GetSeekPosition(&hnsNextTarget, &cbNextOffset, &hnsApproxTime)))
+        {
+            pBatch->cbSkipTo = m_cbDataOffset + cbNextOffset;
+        }
+    }
+
+    return TRUE;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: SkipToNextKeyFrameTarget
+//
+// Moves the read position of the demux loop forward to the seek
+// position of the next target of a key frame batch. Does nothing if
+// the position has been read already.
+//
+// pcbDataOffset: [In/out] Next file offset to read
+// pcbDataLen: [In/out] Bytes left to read
+/////////////////////////////////////////////////////////////////////
+
+void CASFManager::SkipToNextKeyFrameTarget(QWORD* pcbDataOffset, QWORD* pcbDataLen)
+{
+    if (!m_pKeyFrameBatch || (m_pKeyFrameBatch->cbSkipTo <= *pcbDataOffset))
+    {
+        return;
+    }
+
+    QWORD cbSkip = min(m_pKeyFrameBatch->cbSkipTo - *pcbDataOffset, *pcbDataLen);
+
+    *pcbDataOffset += cbSkip;
+    *pcbDataLen -= cbSkip;
+
+    m_pKeyFrameBatch->cbSkipTo = 0;
+
+    // A media object cut by the jump cannot be completed.
+    SafeRelease(&m_pObjectSample);
+    m_ObjectAssembler.Reset();
+
+    m_ReadPlanner.OnSeek();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: SendBatchKeyFrameToDecoder
+//
+// Decode side of GenerateKeyFrames. Decodes a key frame selected by
+// SelectKeyFrameForBatch and delivers it for every target it serves.
+// The decoder is flushed first, so each key frame is decoded on its
+// own, the way a fresh seek would decode it.
+//
+// pSample: Compressed key frame
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFManager::SendBatchKeyFrameToDecoder(IMFSample* pSample, SAMPLE_INFO* pSampleInfo)
+{
+    KEY_FRAME_BATCH* pBatch = m_pKeyFrameBatch;
+
+    MFTIME hnsTime = 0;
+
+    HRESULT hr = pSample->GetSampleTime(&hnsTime);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
 
-    UINT32 cbBlobSize = 0;
+    if ((UINT64)hnsTime > m_fileinfo.hnspreroll)
+    {
+        hnsTime -= m_fileinfo.hnspreroll;
+    }
 
-    HRESULT hr =  m_pContentInfo->GeneratePresentationDescriptor(&pPD);
+    hr = m_pDecoder->Flush();
     if (FAILED(hr))
     {
         goto done;
     }
 
-    //get File ID
-    hr = pPD->GetGUID(MF_PD_ASF_FILEPROPERTIES_FILE_ID, &fileinfo->guidFileID);
+    hr = pSample->SetUINT32(MFSampleExtension_Discontinuity, TRUE);
     if (FAILED(hr))
     {
         goto done;
     }
 
-    // get Creation Time
-    (void)pPD->GetBlob(MF_PD_ASF_FILEPROPERTIES_CREATION_TIME, (BYTE *)&fileinfo->ftCreationTime, sizeof(FILETIME), &cbBlobSize);
+    hr = m_pDecoder->ProcessVideo(pSample);
+    if (hr != S_OK)
+    {
+        // No frame; the targets wait for the next key frame.
+        goto done;
+    }
 
-    fileinfo->cPackets = MFGetAttributeUINT32(pPD, MF_PD_ASF_FILEPROPERTIES_PACKETS, 0);
-    fileinfo->hnsPlayDuration = MFGetAttributeUINT64(pPD, MF_PD_ASF_FILEPROPERTIES_PLAY_DURATION, 0);
-    fileinfo->hnsPresentationDuration = MFGetAttributeUINT64(pPD, MF_PD_DURATION, 0);
-    fileinfo->hnsSendDuration = MFGetAttributeUINT64(pPD, MF_PD_ASF_FILEPROPERTIES_SEND_DURATION, 0);
-    fileinfo->hnspreroll = MFGetAttributeUINT64(pPD, MF_PD_ASF_FILEPROPERTIES_PREROLL, 0) * 10000;      // Pre-roll is in msec
-    fileinfo->flags = MFGetAttributeUINT32(pPD, MF_PD_ASF_FILEPROPERTIES_FLAGS, 0);
-    fileinfo->cbMaxPacketSize = MFGetAttributeUINT32(pPD, MF_PD_ASF_FILEPROPERTIES_MAX_PACKET_SIZE, 0);
-    fileinfo->cbMinPacketSize = MFGetAttributeUINT32(pPD, MF_PD_ASF_FILEPROPERTIES_MIN_PACKET_SIZE, 0);
-    fileinfo->MaxBitRate = MFGetAttributeUINT32(pPD, MF_PD_ASF_FILEPROPERTIES_MAX_BITRATE, 0);
+    (void)GetSampleInfo(pSample, pSampleInfo);
+    pSampleInfo->fSeekedKeyFrame = TRUE;
 
-    m_fileinfo = fileinfo;
+    while ((pBatch->iDecodeTarget < pBatch->cTargets) &&
+           (pBatch->phnsTargetTimes[pBatch->iDecodeTarget] <= hnsTime))
+    {
+        pBatch->FuncPtrToDeliverKeyFrame(pBatch->iDecodeTarget, pSampleInfo);
+        pBatch->iDecodeTarget++;
+    }
 
 done:
-    SafeRelease(&pPD);
     return hr;
 }
 
@@ -1412,6 +2930,58 @@ done:
     return hr;
 }
 
+/////////////////////////////////////////////////////////////////////
+// Name: ReportSampleInfo
+//
+// Passes the information of a decoded sample to the display callback,
+// or adds it to the current block if batching is on. The time in a
+// block is without the preroll.
+//
+// pSample: Sample sent to the decoder
+// pSampleInfo: Pointer to the SAMPLE_INFO structure that receives the
+//          information
+// FuncPtrToDisplaySampleInfo: Callback that displays the information
+//
+// Returns TRUE if the batch callback ended or failed the generation.
+/////////////////////////////////////////////////////////////////////
+
+BOOL CASFManager::ReportSampleInfo(
+    IMFSample* pSample,
+    SAMPLE_INFO* pSampleInfo,
+    void (*FuncPtrToDisplaySampleInfo)(SAMPLE_INFO*)
+    )
+{
+    (void)GetSampleInfo(pSample, pSampleInfo);
+
+    if (!m_fBatchSamples)
+    {
+        FuncPtrToDisplaySampleInfo(pSampleInfo);
+        return FALSE;
+    }
+
+    if (m_hrSampleBatch != S_OK)
+    {
+        return TRUE;
+    }
+
+    MFTIME hnsTime = pSampleInfo->hnsSampleTime;
+
+    hnsTime = ((UINT64)hnsTime > m_fileinfo.hnspreroll) ? hnsTime - (MFTIME)m_fileinfo.hnspreroll : 0;
+
+    BOOL fKeyFrame = pSampleInfo->fSeekedKeyFrame || MFGetAttributeUINT32(pSample, MFSampleExtension_CleanPoint, FALSE);
+
+    m_hrSampleBatch = m_SampleBatcher.Add(
+        m_CurrentStreamID,
+        hnsTime,
+        pSampleInfo->cbTotalLength,
+        pSampleInfo->cBufferCount,
+        fKeyFrame,
+        pSampleInfo->fSeekedKeyFrame
+        );
+
+    return (m_hrSampleBatch != S_OK);
+}
+
 //////////////////////////////////////////////////////////////////////////
 //  Name: Reset
 //  Description: Releases the existing ASF objects for the current file
@@ -1422,6 +2992,10 @@ void CASFManager::Reset()
 {
     SafeRelease(&m_pContentInfo);
     SafeRelease(&m_pDataBuffer);
+    m_cbDataBufferStart = 0;
+    m_cbDataBufferLength = 0;
+    SafeRelease(&m_pObjectSample);
+    m_ObjectAssembler.Reset();
     SafeRelease(&m_pIndexer);
     SafeRelease(&m_pSplitter);
 
@@ -1435,11 +3009,25 @@ void CASFManager::Reset()
         SafeRelease(&m_pDecoder);
     }
 
-    if( m_fileinfo)
-    {
-        m_fileinfo = NULL;
-    }
+    m_fileinfo = FILE_PROPERTIES_OBJECT();
+
+    m_Scanner.Reset();
+    m_IndexReader.Reset();
+    m_fMetadata = FALSE;
+
+    //m_BuiltIndex is kept for the next open of the same file
+    delete [] m_sSidecarName;
+    m_sSidecarName = NULL;
+
+    //The ASF objects above may reference the header span, release it last
+    m_HeaderParser.Reset();
+    m_MappedFile.Close();
+
+    delete [] m_pHeaderData;
+    m_pHeaderData = NULL;
 
+    m_pHeaderSpan = NULL;
+    m_cbHeaderSpan = 0;
 }
 
 
@@ -13,35 +13,6 @@
 
 #pragma once
 
-struct FILE_PROPERTIES_OBJECT
-{
-    GUID guidFileID;
-    FILETIME ftCreationTime;
-    UINT32 MaxBitRate;
-    UINT32 cbMaxPacketSize;
-    UINT32 cbMinPacketSize;
-    UINT32 cPackets;
-    UINT64 hnsPlayDuration;
-    UINT64 hnsSendDuration;
-    UINT32 flags;
-    UINT64 hnspreroll;
-    UINT64 hnsPresentationDuration;
-
-    FILE_PROPERTIES_OBJECT()
-        :
-    MaxBitRate(0),
-    cbMaxPacketSize(0),
-    cbMinPacketSize(0),
-    cPackets(0),
-    hnsPlayDuration(0),
-    hnsSendDuration(0),
-    hnspreroll(0),
-    hnsPresentationDuration(0),
-    flags(0)
-    {}
-};
-
-
 struct SAMPLE_INFO
 {
     UINT32 fSeekedKeyFrame;
@@ -89,7 +60,105 @@ public:
         MFTIME* hnsApproxSeekTime
         );
 
-    HRESULT SetFilePropertiesObject(FILE_PROPERTIES_OBJECT* fileinfo);
+    HRESULT GetFileProperties(FILE_PROPERTIES_OBJECT* fileinfo) const;
+
+    HRESULT ScanSamples(DWORD cThreads);
+
+    HRESULT GetScannedSamples(
+        WORD wStreamNumber,
+        const ASF_SAMPLE_DESCRIPTOR** ppSamples,
+        DWORD* pcSamples
+        ) const
+    {
+        return m_Scanner.GetSamples(wStreamNumber, ppSamples, pcSamples);
+    }
+
+    void GetReadStats(READ_PLANNER_STATS* pStats) const
+    {
+        m_ReadPlanner.GetStats(pStats);
+    }
+
+    HRESULT SetDecoderPoolSize(DWORD cMaxDecoders)
+    {
+        return m_DecoderPool.SetMaxSize(cMaxDecoders);
+    }
+
+    void GetDecoderPoolStats(ASF_DECODER_POOL_STATS* pStats) const
+    {
+        m_DecoderPool.GetStats(pStats);
+    }
+
+    //ASF_DECODER_BACKEND_*, used from the next stream selection on
+    HRESULT SetDecoderBackend(DWORD dwBackend)
+    {
+        if (dwBackend > ASF_DECODER_BACKEND_NULL)
+        {
+            return E_INVALIDARG;
+        }
+
+        m_dwDecoderBackend = dwBackend;
+
+        return S_OK;
+    }
+
+    //Number of compressed samples queued between the demux thread and
+    //the decoder in GenerateSamples, 0 to demux and decode on the
+    //calling thread
+    HRESULT SetPipelineDepth(DWORD cSamples)
+    {
+        if (cSamples > ASF_SAMPLE_RING_MAX_SIZE)
+        {
+            return E_INVALIDARG;
+        }
+
+        m_cPipelineDepth = cSamples;
+
+        return S_OK;
+    }
+
+    //Ring counters of the last pipelined GenerateSamples call
+    void GetPipelineStats(ASF_SAMPLE_RING_STATS* pStats) const
+    {
+        m_SampleRing.GetStats(pStats);
+    }
+
+    //Delivers only key frames of the selected stream from GenerateSamples.
+    //GenerateKeyFrames always does.
+    void SetKeyFramesOnly(BOOL fKeyFramesOnly)
+    {
+        m_fKeyFramesOnly = fKeyFramesOnly;
+    }
+
+    void GetKeyFrameFilterStats(KEY_FRAME_FILTER_STATS* pStats) const
+    {
+        *pStats = m_KeyFrameFilterStats;
+    }
+
+    //Keeps the header metadata of opened files in sCacheName, so that
+    //reopening a file skips the index search and the stream enumeration.
+    //Used from the next OpenASFFile call on.
+    HRESULT OpenMetadataCache(const WCHAR* sCacheName)
+    {
+        return m_MetadataCache.Open(sCacheName);
+    }
+
+    //Hands the sample information of GenerateSamples to pCallback in
+    //blocks of cBatchSize samples instead of calling the display
+    //callback per sample. NULL goes back to per-sample delivery.
+    HRESULT SetSampleBatching(DWORD cBatchSize, IASFSampleBatchCallback* pCallback)
+    {
+        if (!pCallback)
+        {
+            m_fBatchSamples = FALSE;
+            return S_OK;
+        }
+
+        HRESULT hr = m_SampleBatcher.Initialize(cBatchSize, pCallback);
+
+        m_fBatchSamples = SUCCEEDED(hr);
+
+        return hr;
+    }
 
     HRESULT GenerateSamples(
         MFTIME hnsSeekTime,
@@ -98,6 +167,13 @@ public:
         void (*FuncPtrToDisplaySampleInfo)(SAMPLE_INFO*)
         );
 
+    HRESULT GenerateKeyFrames(
+        const MFTIME* phnsTargetTimes,
+        DWORD cTargetTimes,
+        SAMPLE_INFO *pSampleInfo,
+        void (*FuncPtrToDeliverKeyFrame)(DWORD, SAMPLE_INFO*)
+        );
+
     // IUnknown methods
     STDMETHODIMP QueryInterface(REFIID riid, void** ppv)
     {
@@ -138,11 +214,24 @@ protected:
 
     HRESULT CreateASFContentInfo(IMFByteStream *pContentByteStream, IMFASFContentInfo **ppContentInfo);
 
+    HRESULT GetHeaderSpan(IMFByteStream *pContentByteStream, const BYTE **ppHeader, QWORD *pcbSpan);
+
+    HRESULT ParseHeaderSpan();
+
     HRESULT CreateASFSplitter(IMFByteStream *pContentByteStream, IMFASFSplitter **ppSplitter);
 
+    HRESULT GetDataChunk(
+        QWORD cbOffset,
+        DWORD cbToRead,
+        BOOL bReverse,
+        IMFMediaBuffer **ppBuffer,
+        DWORD *pcbBufferOffset,
+        DWORD *pcbLength
+        );
+
     HRESULT ReadDataIntoBuffer(
         IMFByteStream *pStream,
-        DWORD cbOffset,
+        QWORD cbOffset,
         DWORD cbToRead,
         IMFMediaBuffer **ppBuffer
         );
@@ -151,12 +240,31 @@ protected:
 
     HRESULT GetSeekPositionManually(MFTIME hnsSeekTime, QWORD *cbDataOffset);
 
+    HRESULT GetSeekPositionExact(MFTIME hnsSeekTime, BOOL bReverse, QWORD *pcbDataOffset);
+
     HRESULT GetSeekPositionWithIndexer(
         MFTIME hnsSeekTime,
         QWORD *cbDataOffset,
         MFTIME* hnsApproxSeekTime
         );
 
+    HRESULT LoadIndex(IMFByteStream *pContentByteStream, QWORD cbIndexOffset);
+
+    HRESULT LoadOrBuildIndexSidecar();
+
+    HRESULT StoreMetadata(const WCHAR *sFileName, QWORD cbFile, BOOL fHasIndex);
+
+    HRESULT GetMetadataStreams(
+        WORD** ppwStreamNumbers,
+        GUID** ppguidMajorType,
+        DWORD* pcTotalStreams);
+
+    HRESULT GetSeekPositionFromIndex(
+        MFTIME hnsSeekTime,
+        QWORD *pcbDataOffset,
+        MFTIME* phnsApproxSeekTime
+        );
+
     void GetTestDuration(
         const MFTIME& hnsSeekTime,
         BOOL bReverse,
@@ -179,20 +287,104 @@ protected:
         SAMPLE_INFO* pSampleInfo,
         void (*FuncPtrToDisplaySampleInfo)(SAMPLE_INFO*));
 
+    HRESULT SendBatchKeyFrameToDecoder(IMFSample* pSample, SAMPLE_INFO* pSampleInfo);
+
+    BOOL SelectKeyFrameForBatch(IMFSample* pSample, BOOL* pbComplete);
+
+    void SkipToNextKeyFrameTarget(QWORD* pcbDataOffset, QWORD* pcbDataLen);
+
     HRESULT GetSampleInfo(IMFSample *pSample, SAMPLE_INFO *pSampleInfo);
 
+    BOOL ReportSampleInfo(
+        IMFSample* pSample,
+        SAMPLE_INFO* pSampleInfo,
+        void (*FuncPtrToDisplaySampleInfo)(SAMPLE_INFO*)
+        );
+
     void Reset();
 
+    void DeliverSample(
+        IMFSample* pSample,
+        WORD wStreamNumber,
+        const MFTIME& hnsSeekTime,
+        const MFTIME& hnsTestSampleDuration,
+        BOOL bReverse,
+        BOOL* pbComplete,
+        SAMPLE_INFO* pSampleInfo,
+        void (*FuncPtrToDisplaySampleInfo)(SAMPLE_INFO*)
+        );
+
+    HRESULT DemuxPacketsNative(
+        const BYTE* pPackets,
+        DWORD cbPackets,
+        const MFTIME& hnsSeekTime,
+        const MFTIME& hnsTestSampleDuration,
+        BOOL bReverse,
+        BOOL* pbComplete,
+        SAMPLE_INFO* pSampleInfo,
+        void (*FuncPtrToDisplaySampleInfo)(SAMPLE_INFO*)
+        );
+
+    void SendSampleToDecoder(
+        IMFSample* pSample,
+        WORD wStreamNumber,
+        const MFTIME& hnsSeekTime,
+        const MFTIME& hnsTestSampleDuration,
+        BOOL bReverse,
+        BOOL* pbComplete,
+        SAMPLE_INFO* pSampleInfo,
+        void (*FuncPtrToDisplaySampleInfo)(SAMPLE_INFO*)
+        );
+
+    HRESULT AddPayloadToObject(const ASF_PAYLOAD_INFO& payload, IMFSample** ppSample);
+
     HRESULT GenerateSamplesLoop(
         const MFTIME& hnsSeekTime,
         const MFTIME& hnsTestSampleDuration,
         BOOL  bReverse,
-        DWORD cbDataOffset,
-        DWORD cbDataLen,
+        QWORD cbDataOffset,
+        QWORD cbDataLen,
         SAMPLE_INFO* pSampleInfo,
         void (*FuncPtrToDisplaySampleInfo)(SAMPLE_INFO*)
         );
 
+    HRESULT GenerateSamplesPipelined(
+        const MFTIME& hnsSeekTime,
+        const MFTIME& hnsTestSampleDuration,
+        BOOL  bReverse,
+        QWORD cbDataOffset,
+        QWORD cbDataLen,
+        SAMPLE_INFO* pSampleInfo,
+        void (*FuncPtrToDisplaySampleInfo)(SAMPLE_INFO*)
+        );
+
+    //Arguments of GenerateSamplesLoop on the demux thread
+    struct DEMUX_THREAD_PARAMS
+    {
+        CASFManager*    pThis;
+        MFTIME          hnsSeekTime;
+        MFTIME          hnsTestSampleDuration;
+        BOOL            bReverse;
+        QWORD           cbDataOffset;
+        QWORD           cbDataLen;
+        HRESULT         hr;             // Result of the loop
+    };
+
+    static void DemuxThreadProc(void* pContext);
+
+    //State of a GenerateKeyFrames call. The demux and decode sides
+    //each have their own target index, so they can run on different
+    //threads.
+    struct KEY_FRAME_BATCH
+    {
+        const MFTIME*   phnsTargetTimes;
+        DWORD           cTargets;
+        DWORD           iDemuxTarget;   // First target without a selected key frame
+        DWORD           iDecodeTarget;  // First target without a delivered frame
+        QWORD           cbSkipTo;       // File offset the demux can jump to, 0 if none
+        void (*FuncPtrToDeliverKeyFrame)(DWORD, SAMPLE_INFO*);
+    };
+
 protected:
     long    m_nRefCount;    // Reference count
 
@@ -202,14 +394,16 @@ protected:
 
     CDecoder* m_pDecoder;
 
-    //File info
-    FILE_PROPERTIES_OBJECT* m_fileinfo;
+    //File info, copied from the header parser when the file is opened
+    FILE_PROPERTIES_OBJECT  m_fileinfo;
 
     //Media Foundation ASF components
     IMFASFContentInfo*  m_pContentInfo;
     IMFASFSplitter*     m_pSplitter;
     IMFASFIndexer*      m_pIndexer;
-    IMFMediaBuffer*     m_pDataBuffer;
+    IMFMediaBuffer*     m_pDataBuffer;        // View over the mapped data object
+    QWORD               m_cbDataBufferStart;  // File offset of the view
+    QWORD               m_cbDataBufferLength; // Size of the view in bytes
 
 
     // TEST!
@@ -217,4 +411,50 @@ protected:
     UINT64              m_cbDataOffset;
     UINT64              m_cbDataLength;
 
+    //Native header parsing
+    CMappedFile         m_MappedFile;       // Whole-file mapping, if the file could be mapped
+    CASFHeaderParser    m_HeaderParser;     // Parsed Header Object, references the header span
+    BYTE*               m_pHeaderData;      // Header copy when the file is not mapped
+    const BYTE*         m_pHeaderSpan;      // Header and Data Object header, mapped or copied
+    QWORD               m_cbHeaderSpan;
+
+    CReadPlanner        m_ReadPlanner;      // Packet-aligned read sizes for the demux loop
+
+    //Native demux
+    CASFPacketParser    m_PacketParser;     // Initialized for files with fixed-size packets
+    IMFSample*          m_pObjectSample;    // Media object being assembled
+    CASFObjectAssembler m_ObjectAssembler;
+
+    CASFParallelScanner m_Scanner;          // Sample timelines from ScanSamples
+    CASFSeekEngine      m_SeekEngine;       // Exact seeks for fixed-size packets
+    CASFIndexReader     m_IndexReader;      // Index objects, read once per file
+
+    //Index built for a file without index objects
+    WCHAR*              m_sSidecarName;     // Set until the first seek that needs the index
+    CASFIndexReader     m_BuiltIndex;       // Last index built or loaded, kept across opens
+    GUID                m_guidBuiltFileID;
+    QWORD               m_cbBuiltDataLength;
+
+    CASFMetadataCache   m_MetadataCache;    // Header metadata of files opened before
+    ASF_FILE_METADATA   m_Metadata;         // Of the open file, if m_fMetadata
+    BOOL                m_fMetadata;
+
+    CASFDecoderPool     m_DecoderPool;      // Configured decoders kept across streams and files
+    DWORD               m_dwDecoderBackend; // ASF_DECODER_BACKEND_* for SetupStreamDecoder
+
+    //Pipelined GenerateSamples
+    CASFSampleRing      m_SampleRing;       // Compressed samples from the demux thread to the decoder
+    DWORD               m_cPipelineDepth;   // Ring size, 0 if pipelining is off
+    BOOL                m_fPipelineDemux;   // GenerateSamplesLoop runs on the demux thread
+
+    KEY_FRAME_BATCH*    m_pKeyFrameBatch;   // Set during GenerateKeyFrames
+
+    BOOL                    m_fKeyFramesOnly;       // Drop non-key objects in the demux
+    KEY_FRAME_FILTER_STATS  m_KeyFrameFilterStats;  // Written by the demux side
+
+    //Batched sample information, filled on the decode side
+    CASFSampleBatcher   m_SampleBatcher;
+    BOOL                m_fBatchSamples;    // SetSampleBatching succeeded
+    HRESULT             m_hrSampleBatch;    // First failure of the batch callback
+
 };
\ No newline at end of file
@@ -0,0 +1,646 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFMetadataCache.cpp : CASFMetadataCache class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include <stdio.h>
+#include "ASFMetadataCache.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <sys/stat.h>
+#endif
+
+//Suffix of the file a new cache is written to before it replaces the old one
+#ifdef _WIN32
+static const ASF_PATH_CHAR s_szTempSuffix[] = L".tmp";
+#else
+static const ASF_PATH_CHAR s_szTempSuffix[] = ".tmp";
+#endif
+
+static size_t GetPathLength(const ASF_PATH_CHAR* sPath);
+static FILE* OpenCacheFile(const ASF_PATH_CHAR* sCacheName);
+static BOOL ReplaceCacheFile(const ASF_PATH_CHAR* sTempName, const ASF_PATH_CHAR* sCacheName);
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFMetadataCache
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFMetadataCache::CASFMetadataCache()
+:   m_sCacheName (NULL),
+    m_cRecords (0)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFMetadataCache
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFMetadataCache::~CASFMetadataCache()
+{
+    Close();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Open
+//
+// Maps the cache file. A cache file that is missing, or that is not
+// a valid cache, is treated as empty and replaced by the next Store.
+//
+// sCacheName: Path name of the cache file
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFMetadataCache::Open(const ASF_PATH_CHAR* sCacheName)
+{
+    if (!sCacheName)
+    {
+        return E_INVALIDARG;
+    }
+
+    Close();
+
+    size_t cchName = GetPathLength(sCacheName);
+
+    m_sCacheName = new (std::nothrow) ASF_PATH_CHAR[cchName + 1];
+    if (!m_sCacheName)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    memcpy(m_sCacheName, sCacheName, (cchName + 1) * sizeof(ASF_PATH_CHAR));
+
+    if (FAILED(m_MappedFile.Open(sCacheName)))
+    {
+        return S_OK;
+    }
+
+    const BYTE* pCache = m_MappedFile.GetData();
+    QWORD cbCache = m_MappedFile.GetSize();
+
+    if ((cbCache < ASF_METADATA_CACHE_HEADER_SIZE) ||
+        (ASFReadDWord(pCache) != ASF_METADATA_CACHE_MAGIC) ||
+        (ASFReadWord(pCache + 4) != ASF_METADATA_CACHE_VERSION))
+    {
+        m_MappedFile.Close();
+        return S_OK;
+    }
+
+    //Only the records that lie within the file count
+    DWORD cRecords = ASFReadDWord(pCache + 8);
+    QWORD cbRecords = ASF_METADATA_CACHE_HEADER_SIZE;
+
+    while ((m_cRecords < cRecords) && (cbCache - cbRecords >= ASF_METADATA_CACHE_RECORD_SIZE))
+    {
+        DWORD cbRecord = GetRecordSize(pCache + cbRecords);
+
+        if ((cbRecord == 0) || (cbCache - cbRecords < cbRecord))
+        {
+            break;
+        }
+
+        cbRecords += cbRecord;
+        m_cRecords++;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Close
+//
+// Unmaps the cache file.
+/////////////////////////////////////////////////////////////////////
+
+void CASFMetadataCache::Close()
+{
+    m_MappedFile.Close();
+
+    delete [] m_sCacheName;
+    m_sCacheName = NULL;
+
+    m_cRecords = 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Lookup
+//
+// Returns the record of a file if its size and last write time are
+// unchanged. Only the record is read; the media file is not opened.
+//
+// sFileName: Path name of the media file, as passed to Store
+// pMetadata: Receives the cached information
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFMetadataCache::Lookup(const ASF_PATH_CHAR* sFileName, ASF_FILE_METADATA* pMetadata) const
+{
+    if (!sFileName || !pMetadata)
+    {
+        return E_POINTER;
+    }
+
+    QWORD cbFile = 0, qwWriteTime = 0;
+
+    HRESULT hr = GetFileStamp(sFileName, &cbFile, &qwWriteTime);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    const BYTE* pRecord = FindRecord(HashPath(sFileName));
+
+    if (!pRecord ||
+        (ASFReadQWord(pRecord + 8) != cbFile) ||
+        (ASFReadQWord(pRecord + 16) != qwWriteTime))
+    {
+        return MF_E_NOT_FOUND;
+    }
+
+    ReadRecord(pRecord, pMetadata);
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Store
+//
+// Adds or replaces the record of a file, stamped with the current size
+// and last write time of the file. The new record goes first; the
+// oldest records are dropped beyond ASF_METADATA_CACHE_MAX_RECORDS.
+//
+// sFileName: Path name of the media file
+// metadata:  Information to cache
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFMetadataCache::Store(const ASF_PATH_CHAR* sFileName, const ASF_FILE_METADATA& metadata)
+{
+    if (!sFileName)
+    {
+        return E_POINTER;
+    }
+
+    if (!m_sCacheName)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    if (metadata.cStreams > ASF_MAX_STREAMS)
+    {
+        return E_INVALIDARG;
+    }
+
+    QWORD cbFile = 0, qwWriteTime = 0;
+    QWORD qwPathHash = HashPath(sFileName);
+
+    BYTE* pCache = NULL;
+    BYTE* p = NULL;
+    ASF_PATH_CHAR* sTempName = NULL;
+    FILE* pFile = NULL;
+
+    DWORD cRecords = 1;
+    size_t cbCache = 0;
+    size_t cchName = 0;
+
+    const BYTE* pOld = NULL;
+
+    HRESULT hr = GetFileStamp(sFileName, &cbFile, &qwWriteTime);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    //The new record plus every old one, which bounds what is kept
+    cbCache = ASF_METADATA_CACHE_HEADER_SIZE +
+        ASF_METADATA_CACHE_RECORD_SIZE + metadata.cStreams * ASF_METADATA_CACHE_STREAM_SIZE;
+
+    //An empty or missing cache has no mapping to copy records from
+    if ((m_cRecords > 0) && m_MappedFile.IsMapped())
+    {
+        pOld = m_MappedFile.GetData() + ASF_METADATA_CACHE_HEADER_SIZE;
+        cbCache += (size_t)m_MappedFile.GetSize();
+    }
+
+    pCache = new (std::nothrow) BYTE[cbCache];
+    if (!pCache)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    p = pCache + ASF_METADATA_CACHE_HEADER_SIZE;
+
+    WriteRecord(p, qwPathHash, cbFile, qwWriteTime, metadata);
+    p += GetRecordSize(p);
+
+    for (DWORD i = 0; pOld && (i < m_cRecords); i++)
+    {
+        DWORD cbRecord = GetRecordSize(pOld);
+
+        if ((ASFReadQWord(pOld) != qwPathHash) && (cRecords < ASF_METADATA_CACHE_MAX_RECORDS))
+        {
+            memcpy(p, pOld, cbRecord);
+            p += cbRecord;
+            cRecords++;
+        }
+
+        pOld += cbRecord;
+    }
+
+    ASFWriteDWord(pCache, ASF_METADATA_CACHE_MAGIC);
+    ASFWriteWord(pCache + 4, ASF_METADATA_CACHE_VERSION);
+    ASFWriteWord(pCache + 6, 0);
+    ASFWriteDWord(pCache + 8, cRecords);
+    ASFWriteDWord(pCache + 12, 0);
+
+    cbCache = p - pCache;
+
+    //Write the new cache next to the old one
+    cchName = GetPathLength(m_sCacheName);
+
+    sTempName = new (std::nothrow) ASF_PATH_CHAR[cchName + sizeof(s_szTempSuffix) / sizeof(ASF_PATH_CHAR)];
+    if (!sTempName)
+    {
+        hr = E_OUTOFMEMORY;
+        goto done;
+    }
+
+    memcpy(sTempName, m_sCacheName, cchName * sizeof(ASF_PATH_CHAR));
+    memcpy(sTempName + cchName, s_szTempSuffix, sizeof(s_szTempSuffix));
+
+    pFile = OpenCacheFile(sTempName);
+    if (!pFile)
+    {
+        hr = E_ACCESSDENIED;
+        goto done;
+    }
+
+    if (fwrite(pCache, cbCache, 1, pFile) != 1)
+    {
+        hr = E_FAIL;
+    }
+
+    if (fclose(pFile) != 0)
+    {
+        hr = E_FAIL;
+    }
+
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    //The old cache cannot be replaced while it is mapped
+    m_MappedFile.Close();
+    m_cRecords = 0;
+
+    if (!ReplaceCacheFile(sTempName, m_sCacheName))
+    {
+        hr = E_ACCESSDENIED;
+    }
+
+    //Map whichever cache is in place now
+    {
+        ASF_PATH_CHAR* sCacheName = m_sCacheName;
+        m_sCacheName = NULL;
+
+        HRESULT hrOpen = Open(sCacheName);
+        delete [] sCacheName;
+
+        if (SUCCEEDED(hr))
+        {
+            hr = hrOpen;
+        }
+    }
+
+done:
+    delete [] sTempName;
+    delete [] pCache;
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetHeaderMetadata
+//
+// Collects the metadata of a file from its parsed header. The Media
+// Foundation major types are left as GUID_NULL.
+//
+// header:    Parser that has parsed the header and the Data Object
+//            header
+// cbFile:    Size of the file
+// pMetadata: Receives the metadata
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFMetadataCache::GetHeaderMetadata(
+    const CASFHeaderParser& header,
+    QWORD cbFile,
+    ASF_FILE_METADATA* pMetadata
+    )
+{
+    if (!pMetadata)
+    {
+        return E_POINTER;
+    }
+
+    if (header.GetDataOffset() == 0)
+    {
+        return MF_E_ASF_PARSINGINCOMPLETE;
+    }
+
+    HRESULT hr = header.GetFileProperties(&pMetadata->fileInfo);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    pMetadata->cbDataOffset = header.GetDataOffset();
+    pMetadata->cbDataLength = header.GetDataLength();
+
+    pMetadata->cbIndexOffset = pMetadata->cbDataOffset + pMetadata->cbDataLength;
+    pMetadata->cbIndexLength = (cbFile > pMetadata->cbIndexOffset) ? cbFile - pMetadata->cbIndexOffset : 0;
+
+    pMetadata->cStreams = 0;
+
+    for (DWORD i = 0; i < header.GetStreamCount(); i++)
+    {
+        const ASF_STREAM_PROPERTIES* pStream = NULL;
+
+        hr = header.GetStream(i, &pStream);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        ASF_CACHED_STREAM& stream = pMetadata->streams[pMetadata->cStreams++];
+
+        stream.wStreamNumber = pStream->wStreamNumber;
+        stream.guidStreamType = pStream->guidStreamType;
+        stream.guidMajorType = GUID_NULL;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetFileStamp
+//
+// Returns the size and the last write time of a file.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFMetadataCache::GetFileStamp(const ASF_PATH_CHAR* sFileName, QWORD* pcbFile, QWORD* pqwWriteTime)
+{
+    if (!sFileName || !pcbFile || !pqwWriteTime)
+    {
+        return E_POINTER;
+    }
+
+#ifdef _WIN32
+
+    WIN32_FILE_ATTRIBUTE_DATA data;
+
+    if (!GetFileAttributesExW(sFileName, GetFileExInfoStandard, &data))
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    *pcbFile = ((QWORD)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    *pqwWriteTime = ((QWORD)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+
+#else
+
+    struct stat st;
+
+    if (stat(sFileName, &st) != 0)
+    {
+        return HRESULT_FROM_WIN32(errno);
+    }
+
+#ifdef __APPLE__
+    const struct timespec& tsWrite = st.st_mtimespec;
+#else
+    const struct timespec& tsWrite = st.st_mtim;
+#endif
+
+    *pcbFile = (QWORD)st.st_size;
+    *pqwWriteTime = (QWORD)tsWrite.tv_sec * 10000000 + (QWORD)tsWrite.tv_nsec / 100;
+
+#endif
+
+    return S_OK;
+}
+
+// ----- Private Methods -----------------------------------------------
+
+/////////////////////////////////////////////////////////////////////
+// Name: HashPath
+//
+// 64-bit FNV-1a hash of the path name, by character.
+/////////////////////////////////////////////////////////////////////
+
+QWORD CASFMetadataCache::HashPath(const ASF_PATH_CHAR* sFileName)
+{
+    QWORD qwHash = 0xCBF29CE484222325ULL;
+
+    for (const ASF_PATH_CHAR* p = sFileName; *p; p++)
+    {
+        qwHash ^= (QWORD)*p;
+        qwHash *= 0x100000001B3ULL;
+    }
+
+    return qwHash;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetRecordSize
+//
+// Returns the size of a record from its stream count, or zero if the
+// count is not valid. The fixed part must be readable.
+/////////////////////////////////////////////////////////////////////
+
+DWORD CASFMetadataCache::GetRecordSize(const BYTE* pRecord)
+{
+    WORD cStreams = ASFReadWord(pRecord + 132);
+
+    if (cStreams > ASF_MAX_STREAMS)
+    {
+        return 0;
+    }
+
+    return ASF_METADATA_CACHE_RECORD_SIZE + cStreams * ASF_METADATA_CACHE_STREAM_SIZE;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: FindRecord
+//
+// Returns the record stored for a path, or NULL.
+/////////////////////////////////////////////////////////////////////
+
+const BYTE* CASFMetadataCache::FindRecord(QWORD qwPathHash) const
+{
+    if (m_cRecords == 0)
+    {
+        return NULL;
+    }
+
+    const BYTE* p = m_MappedFile.GetData() + ASF_METADATA_CACHE_HEADER_SIZE;
+
+    for (DWORD i = 0; i < m_cRecords; i++)
+    {
+        if (ASFReadQWord(p) == qwPathHash)
+        {
+            return p;
+        }
+
+        p += GetRecordSize(p);
+    }
+
+    return NULL;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: WriteRecord
+//
+// Writes a record:
+//   0  Path hash, file size and last write time (QWORDs)
+//  24  File Properties Object fields, in the order of the object
+// 100  Data offset and length (QWORDs)
+// 116  Index offset and length (QWORDs)
+// 132  Stream count (WORD), reserved (WORD)
+// 136  Per stream: number (WORD), stream type and major type (GUIDs)
+/////////////////////////////////////////////////////////////////////
+
+void CASFMetadataCache::WriteRecord(
+    BYTE* p,
+    QWORD qwPathHash,
+    QWORD cbFile,
+    QWORD qwWriteTime,
+    const ASF_FILE_METADATA& metadata
+    )
+{
+    const FILE_PROPERTIES_OBJECT& fileInfo = metadata.fileInfo;
+
+    ASFWriteQWord(p, qwPathHash);
+    ASFWriteQWord(p + 8, cbFile);
+    ASFWriteQWord(p + 16, qwWriteTime);
+
+    ASFWriteGUID(p + 24, fileInfo.guidFileID);
+    ASFWriteDWord(p + 40, fileInfo.ftCreationTime.dwLowDateTime);
+    ASFWriteDWord(p + 44, fileInfo.ftCreationTime.dwHighDateTime);
+    ASFWriteDWord(p + 48, fileInfo.MaxBitRate);
+    ASFWriteDWord(p + 52, fileInfo.cbMaxPacketSize);
+    ASFWriteDWord(p + 56, fileInfo.cbMinPacketSize);
+    ASFWriteDWord(p + 60, fileInfo.cPackets);
+    ASFWriteQWord(p + 64, fileInfo.hnsPlayDuration);
+    ASFWriteQWord(p + 72, fileInfo.hnsSendDuration);
+    ASFWriteDWord(p + 80, fileInfo.flags);
+    ASFWriteQWord(p + 84, fileInfo.hnspreroll);
+    ASFWriteQWord(p + 92, fileInfo.hnsPresentationDuration);
+
+    ASFWriteQWord(p + 100, metadata.cbDataOffset);
+    ASFWriteQWord(p + 108, metadata.cbDataLength);
+    ASFWriteQWord(p + 116, metadata.cbIndexOffset);
+    ASFWriteQWord(p + 124, metadata.cbIndexLength);
+
+    ASFWriteWord(p + 132, (WORD)metadata.cStreams);
+    ASFWriteWord(p + 134, 0);
+
+    p += ASF_METADATA_CACHE_RECORD_SIZE;
+
+    for (DWORD i = 0; i < metadata.cStreams; i++, p += ASF_METADATA_CACHE_STREAM_SIZE)
+    {
+        ASFWriteWord(p, metadata.streams[i].wStreamNumber);
+        ASFWriteGUID(p + 2, metadata.streams[i].guidStreamType);
+        ASFWriteGUID(p + 18, metadata.streams[i].guidMajorType);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ReadRecord
+//
+// Reads a record written by WriteRecord. The record was checked to lie
+// within the mapping when the cache was opened.
+/////////////////////////////////////////////////////////////////////
+
+void CASFMetadataCache::ReadRecord(const BYTE* p, ASF_FILE_METADATA* pMetadata)
+{
+    FILE_PROPERTIES_OBJECT& fileInfo = pMetadata->fileInfo;
+
+    fileInfo.guidFileID = ASFReadGUID(p + 24);
+    fileInfo.ftCreationTime.dwLowDateTime = ASFReadDWord(p + 40);
+    fileInfo.ftCreationTime.dwHighDateTime = ASFReadDWord(p + 44);
+    fileInfo.MaxBitRate = ASFReadDWord(p + 48);
+    fileInfo.cbMaxPacketSize = ASFReadDWord(p + 52);
+    fileInfo.cbMinPacketSize = ASFReadDWord(p + 56);
+    fileInfo.cPackets = ASFReadDWord(p + 60);
+    fileInfo.hnsPlayDuration = ASFReadQWord(p + 64);
+    fileInfo.hnsSendDuration = ASFReadQWord(p + 72);
+    fileInfo.flags = ASFReadDWord(p + 80);
+    fileInfo.hnspreroll = ASFReadQWord(p + 84);
+    fileInfo.hnsPresentationDuration = ASFReadQWord(p + 92);
+
+    pMetadata->cbDataOffset = ASFReadQWord(p + 100);
+    pMetadata->cbDataLength = ASFReadQWord(p + 108);
+    pMetadata->cbIndexOffset = ASFReadQWord(p + 116);
+    pMetadata->cbIndexLength = ASFReadQWord(p + 124);
+
+    pMetadata->cStreams = ASFReadWord(p + 132);
+
+    p += ASF_METADATA_CACHE_RECORD_SIZE;
+
+    for (DWORD i = 0; i < pMetadata->cStreams; i++, p += ASF_METADATA_CACHE_STREAM_SIZE)
+    {
+        pMetadata->streams[i].wStreamNumber = ASFReadWord(p);
+        pMetadata->streams[i].guidStreamType = ASFReadGUID(p + 2);
+        pMetadata->streams[i].guidMajorType = ASFReadGUID(p + 18);
+    }
+}
+
+// ----- Helpers -----------------------------------------------
+
+static size_t GetPathLength(const ASF_PATH_CHAR* sPath)
+{
+    size_t cch = 0;
+
+    while (sPath[cch])
+    {
+        cch++;
+    }
+
+    return cch;
+}
+
+static FILE* OpenCacheFile(const ASF_PATH_CHAR* sCacheName)
+{
+#ifdef _WIN32
+    FILE* pFile = NULL;
+
+    if (_wfopen_s(&pFile, sCacheName, L"wb") != 0)
+    {
+        return NULL;
+    }
+
+    return pFile;
+#else
+    return fopen(sCacheName, "wb");
+#endif
+}
+
+static BOOL ReplaceCacheFile(const ASF_PATH_CHAR* sTempName, const ASF_PATH_CHAR* sCacheName)
+{
+#ifdef _WIN32
+    return MoveFileExW(sTempName, sCacheName, MOVEFILE_REPLACE_EXISTING) ? TRUE : FALSE;
+#else
+    return (rename(sTempName, sCacheName) == 0) ? TRUE : FALSE;
+#endif
+}
@@ -0,0 +1,122 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFMetadataCache.h : CASFMetadataCache class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+#include "ASFHeaderParser.h"
+
+#define ASF_METADATA_CACHE_MAGIC        0x4D465341  // 'ASFM'
+#define ASF_METADATA_CACHE_VERSION      2
+#define ASF_METADATA_CACHE_HEADER_SIZE  16
+#define ASF_METADATA_CACHE_RECORD_SIZE  136         // Up to the stream list
+#define ASF_METADATA_CACHE_STREAM_SIZE  34
+
+//Records kept; storing one more drops the least recently stored
+#define ASF_METADATA_CACHE_MAX_RECORDS  256
+
+//A stream of a cached file
+struct ASF_CACHED_STREAM
+{
+    WORD    wStreamNumber;
+    GUID    guidStreamType;     // From the Stream Properties Object
+    GUID    guidMajorType;      // Media Foundation major type, GUID_NULL if not known
+};
+
+//What opening a file needs from its header and index objects
+struct ASF_FILE_METADATA
+{
+    FILE_PROPERTIES_OBJECT  fileInfo;
+
+    QWORD   cbDataOffset;           // First data packet
+    QWORD   cbDataLength;
+
+    QWORD   cbIndexOffset;          // Objects after the Data Object
+    QWORD   cbIndexLength;          // Zero if the file has no usable index objects
+
+    DWORD   cStreams;
+    ASF_CACHED_STREAM   streams[ASF_MAX_STREAMS];   // In header order
+};
+
+
+//Cache of the header information of files that were opened before, so
+//reopening a file does not parse its header and look for its index
+//again.
+//
+//The cache is one small file of records, mapped for lookups. A record
+//is found by the path of the media file and is only valid while the
+//size and the last write time of the file are those it was stored
+//with; callers also check the File ID of the file's header against the
+//record before using it. Store rewrites the whole cache to a temporary file and renames
+//it over the old one, so a reader never sees a partial cache.
+
+class CASFMetadataCache
+{
+public:
+
+    CASFMetadataCache();
+    ~CASFMetadataCache();
+
+    //A missing cache file is an empty cache; it is created by Store
+    HRESULT Open(const ASF_PATH_CHAR* sCacheName);
+
+    void Close();
+
+    BOOL IsOpen() const
+    {
+        return (m_sCacheName != NULL);
+    }
+
+    //MF_E_NOT_FOUND if the file has no valid record
+    HRESULT Lookup(const ASF_PATH_CHAR* sFileName, ASF_FILE_METADATA* pMetadata) const;
+
+    HRESULT Store(const ASF_PATH_CHAR* sFileName, const ASF_FILE_METADATA& metadata);
+
+    //Fills everything but the major types from a parsed header. The
+    //index objects are taken to run to the end of the file.
+    static HRESULT GetHeaderMetadata(
+        const CASFHeaderParser& header,
+        QWORD cbFile,
+        ASF_FILE_METADATA* pMetadata
+        );
+
+    //Size and last write time (100-ns units) that records are checked
+    //against
+    static HRESULT GetFileStamp(const ASF_PATH_CHAR* sFileName, QWORD* pcbFile, QWORD* pqwWriteTime);
+
+private:
+
+    //Not copyable
+    CASFMetadataCache(const CASFMetadataCache&);
+    CASFMetadataCache& operator=(const CASFMetadataCache&);
+
+    static QWORD HashPath(const ASF_PATH_CHAR* sFileName);
+
+    static DWORD GetRecordSize(const BYTE* pRecord);
+
+    const BYTE* FindRecord(QWORD qwPathHash) const;
+
+    static void WriteRecord(
+        BYTE* p,
+        QWORD qwPathHash,
+        QWORD cbFile,
+        QWORD qwWriteTime,
+        const ASF_FILE_METADATA& metadata
+        );
+
+    static void ReadRecord(const BYTE* p, ASF_FILE_METADATA* pMetadata);
+
+    CMappedFile     m_MappedFile;       // Not mapped while the cache is empty
+    ASF_PATH_CHAR*  m_sCacheName;
+    DWORD           m_cRecords;         // Valid records in the mapping
+};
@@ -0,0 +1,119 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFNullAudioSink.cpp : CASFNullAudioSink class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "ASFNullAudioSink.h"
+#include "ASFThread.h"
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFNullAudioSink
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFNullAudioSink::CASFNullAudioSink()
+:   m_pCallback (NULL),
+    m_nAvgBytesPerSec (0),
+    m_llOpen (0),
+    m_llPlayEnd (0)
+{
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Open
+//
+// Starts the clock and clears the statistics.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFNullAudioSink::Open(const ASF_MEDIA_FORMAT& format, DWORD cBuffers, IASFAudioSinkCallback* pCallback)
+{
+    if (!pCallback || (cBuffers == 0) || (format.nSamplesPerSec == 0) || (format.nBlockAlign == 0))
+    {
+        return E_INVALIDARG;
+    }
+
+    m_pCallback = pCallback;
+    m_nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+
+    return Reset();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Submit
+//
+// Plays the buffer on the virtual clock and hands it back.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFNullAudioSink::Submit(DWORD iBuffer, const BYTE* pData, DWORD cbData)
+{
+    if (!pData && (cbData > 0))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (!m_pCallback)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    LONGLONG llNow = CASFThread::GetTimestamp();
+
+    if (m_Stats.cBuffers == 0)
+    {
+        m_Stats.hnsFirstBuffer = llNow - m_llOpen;
+        m_llPlayEnd = llNow;
+    }
+    else if (llNow > m_llPlayEnd)
+    {
+        m_Stats.cUnderruns++;
+        m_Stats.hnsUnderrun += llNow - m_llPlayEnd;
+        m_llPlayEnd = llNow;
+    }
+
+    MFTIME hnsBuffer = (MFTIME)((ULONGLONG)cbData * 10000000 / m_nAvgBytesPerSec);
+
+    m_llPlayEnd += hnsBuffer;
+
+    m_Stats.cBuffers++;
+    m_Stats.cbData += cbData;
+    m_Stats.hnsAudio += hnsBuffer;
+
+    m_pCallback->OnBufferDone(iBuffer);
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Reset
+//
+// Restarts the clock. No buffers are held.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFNullAudioSink::Reset()
+{
+    memset(&m_Stats, 0, sizeof(m_Stats));
+
+    m_llOpen = CASFThread::GetTimestamp();
+    m_llPlayEnd = m_llOpen;
+
+    return S_OK;
+}
+
+HRESULT CASFNullAudioSink::Close()
+{
+    m_pCallback = NULL;
+
+    return S_OK;
+}
@@ -0,0 +1,65 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFNullAudioSink.h : CASFNullAudioSink class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFAudioSink.h"
+
+struct ASF_NULL_AUDIO_SINK_STATS
+{
+    QWORD   cBuffers;
+    QWORD   cbData;
+    MFTIME  hnsAudio;           // Duration of the submitted audio
+    MFTIME  hnsFirstBuffer;     // Open or Reset to the first buffer
+    QWORD   cUnderruns;         // Buffers that arrived after the audio ran out
+    MFTIME  hnsUnderrun;        // Total silence caused by underruns
+};
+
+
+//Sink that hands every buffer back at once and only keeps time. It
+//plays the audio against a virtual clock: a buffer that arrives after
+//the buffers before it would have finished playing is an underrun.
+//Used to measure the decode-to-output path where there is no audio
+//device.
+
+class CASFNullAudioSink : public IASFAudioSink
+{
+public:
+
+    CASFNullAudioSink();
+
+    // IASFAudioSink methods
+    HRESULT Open(const ASF_MEDIA_FORMAT& format, DWORD cBuffers, IASFAudioSinkCallback* pCallback);
+
+    HRESULT Submit(DWORD iBuffer, const BYTE* pData, DWORD cbData);
+
+    HRESULT Reset();
+
+    HRESULT Close();
+
+    void GetStats(ASF_NULL_AUDIO_SINK_STATS* pStats) const
+    {
+        *pStats = m_Stats;
+    }
+
+private:
+
+    IASFAudioSinkCallback*  m_pCallback;
+
+    DWORD       m_nAvgBytesPerSec;
+
+    LONGLONG    m_llOpen;
+    LONGLONG    m_llPlayEnd;    // Virtual time the submitted audio runs out
+
+    ASF_NULL_AUDIO_SINK_STATS   m_Stats;
+};
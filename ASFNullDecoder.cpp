@@ -0,0 +1,67 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFNullDecoder.cpp : CASFNullDecoder class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "ASFNullDecoder.h"
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFNullDecoder
+//  Description: Constructor
+//
+//  guidMajorType: ASF stream type of the samples
+/////////////////////////////////////////////////////////////////////////
+
+CASFNullDecoder::CASFNullDecoder(const GUID& guidMajorType)
+:   m_guidMajorType (guidMajorType)
+{
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetOutputFormat
+//
+// The null decoder has no output; only the major type is set.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFNullDecoder::GetOutputFormat(ASF_MEDIA_FORMAT* pFormat)
+{
+    if (!pFormat)
+    {
+        return E_POINTER;
+    }
+
+    memset(pFormat, 0, sizeof(ASF_MEDIA_FORMAT));
+    pFormat->guidMajorType = m_guidMajorType;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Decode
+//
+// Counts the sample. The data is not touched.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFNullDecoder::Decode(const ASF_DECODER_INPUT& input, IASFDecoderSink* pSink)
+{
+    (void)pSink;
+
+    m_Stats.cSamples++;
+    m_Stats.cbInput += input.cbData;
+
+    if (input.fKeyFrame)
+    {
+        m_Stats.cKeyFrames++;
+    }
+
+    return S_OK;
+}
@@ -0,0 +1,69 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFNullDecoder.h : CASFNullDecoder class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFDecoder.h"
+
+struct ASF_NULL_DECODER_STATS
+{
+    QWORD   cSamples;
+    QWORD   cKeyFrames;
+    QWORD   cbInput;
+};
+
+
+//Decoder that accepts every sample and produces no output. Used to
+//measure the demux on its own, and where no real decoder exists.
+
+class CASFNullDecoder : public IASFDecoder
+{
+public:
+
+    CASFNullDecoder(const GUID& guidMajorType);
+
+    // IASFDecoder methods
+    HRESULT Start()
+    {
+        return S_OK;
+    }
+
+    HRESULT Stop()
+    {
+        return S_OK;
+    }
+
+    HRESULT Flush()
+    {
+        return S_OK;
+    }
+
+    HRESULT GetOutputFormat(ASF_MEDIA_FORMAT* pFormat);
+
+    HRESULT Decode(const ASF_DECODER_INPUT& input, IASFDecoderSink* pSink);
+
+    void GetStats(ASF_NULL_DECODER_STATS* pStats) const
+    {
+        *pStats = m_Stats;
+    }
+
+    void ResetStats()
+    {
+        memset(&m_Stats, 0, sizeof(m_Stats));
+    }
+
+private:
+
+    GUID                    m_guidMajorType;
+    ASF_NULL_DECODER_STATS  m_Stats;
+};
@@ -0,0 +1,91 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFObjectAssembler.cpp : CASFObjectAssembler class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "ASFObjectAssembler.h"
+
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFObjectAssembler
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFObjectAssembler::CASFObjectAssembler()
+:   m_fPending (FALSE),
+    m_dwObjectNumber (0),
+    m_cbObjectSize (0),
+    m_cbReceived (0),
+    m_cbPayloadOffset (0)
+{
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: AddPayload
+//
+// Adds the next payload of the stream. Returns S_FALSE for a fragment
+// of an object that cannot be completed, which the caller drops, and
+// MF_E_ASF_INVALIDDATA for a payload that runs past the end of its
+// object; either ends the object being assembled.
+//
+// payload: Payload of the stream
+// pfStart: Set to TRUE if the payload starts an object. The object
+//          being assembled, if any, is dropped.
+// pfComplete: Set to TRUE if the payload completes its object.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFObjectAssembler::AddPayload(const ASF_PAYLOAD_INFO& payload, BOOL* pfStart, BOOL* pfComplete)
+{
+    *pfStart = FALSE;
+    *pfComplete = FALSE;
+
+    if (IsObjectStart(payload))
+    {
+        m_dwObjectNumber = payload.dwMediaObjectNumber;
+        m_cbObjectSize = payload.fCompressed ? payload.cbData : payload.cbMediaObjectSize;
+        m_cbReceived = 0;
+        m_fPending = TRUE;
+
+        // Objects without a size in the replicated data are single payloads
+        if (payload.cbData > m_cbObjectSize)
+        {
+            m_cbObjectSize = payload.cbData;
+        }
+
+        *pfStart = TRUE;
+    }
+    else if (!m_fPending ||
+             (payload.dwMediaObjectNumber != m_dwObjectNumber) ||
+             (payload.dwOffsetIntoMediaObject != m_cbReceived))
+    {
+        m_fPending = FALSE;
+        return S_FALSE;
+    }
+
+    if (payload.cbData > m_cbObjectSize - m_cbReceived)
+    {
+        m_fPending = FALSE;
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    m_cbPayloadOffset = m_cbReceived;
+    m_cbReceived += payload.cbData;
+
+    if (m_cbReceived == m_cbObjectSize)
+    {
+        m_fPending = FALSE;
+        *pfComplete = TRUE;
+    }
+
+    return S_OK;
+}
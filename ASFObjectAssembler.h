@@ -0,0 +1,94 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFObjectAssembler.h : CASFObjectAssembler class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFPacketParser.h"
+
+//Selected-stream data of the last GenerateSamples or GenerateKeyFrames
+//call, split into what the key frame filter dropped and what it let
+//through to the decoder.
+struct KEY_FRAME_FILTER_STATS
+{
+    QWORD cbSkipped;
+    QWORD cbDelivered;
+    QWORD cObjectsSkipped;
+    QWORD cObjectsDelivered;
+};
+
+
+//Follows the payloads of one stream as they are put together into
+//media objects, one object at a time. It decides which payloads start
+//an object, which continue it and which are fragments of an object
+//whose start was not seen (e.g. right after a seek); where the payload
+//data goes is up to the caller.
+//
+//A compressed payload, or a payload at least as large as the object
+//size in its replicated data, is an object on its own.
+
+class CASFObjectAssembler
+{
+public:
+
+    CASFObjectAssembler();
+
+    static BOOL IsObjectStart(const ASF_PAYLOAD_INFO& payload)
+    {
+        return payload.fCompressed || (payload.dwOffsetIntoMediaObject == 0);
+    }
+
+    //Counts a payload that a key frame filter drops on its header, so
+    //it never reaches the assembler
+    static void SkipPayload(const ASF_PAYLOAD_INFO& payload, KEY_FRAME_FILTER_STATS* pStats)
+    {
+        pStats->cbSkipped += payload.cbData;
+
+        if (IsObjectStart(payload))
+        {
+            pStats->cObjectsSkipped++;
+        }
+    }
+
+    HRESULT AddPayload(const ASF_PAYLOAD_INFO& payload, BOOL* pfStart, BOOL* pfComplete);
+
+    //Drops the object being assembled
+    void Reset()
+    {
+        m_fPending = FALSE;
+    }
+
+    BOOL IsPending() const
+    {
+        return m_fPending;
+    }
+
+    //Size of the object of the last payload added
+    DWORD GetObjectSize() const
+    {
+        return m_cbObjectSize;
+    }
+
+    //Offset in its object of the last payload added
+    DWORD GetPayloadOffset() const
+    {
+        return m_cbPayloadOffset;
+    }
+
+private:
+
+    BOOL    m_fPending;             // An object is started and not complete
+    DWORD   m_dwObjectNumber;
+    DWORD   m_cbObjectSize;
+    DWORD   m_cbReceived;
+    DWORD   m_cbPayloadOffset;
+};
@@ -0,0 +1,501 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFPacketParser.cpp : CASFPacketParser class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "ASFPacketParser.h"
+
+//Dispatch tables, one entry per flag combination
+#define ASF_ENTRIES_4(M, i)     M(i), M((i) + 1), M((i) + 2), M((i) + 3)
+#define ASF_ENTRIES_16(M, i)    ASF_ENTRIES_4(M, i), ASF_ENTRIES_4(M, (i) + 4), ASF_ENTRIES_4(M, (i) + 8), ASF_ENTRIES_4(M, (i) + 12)
+#define ASF_ENTRIES_64(M, i)    ASF_ENTRIES_16(M, i), ASF_ENTRIES_16(M, (i) + 16), ASF_ENTRIES_16(M, (i) + 32), ASF_ENTRIES_16(M, (i) + 48)
+
+#define ASF_PACKET_ENTRY(i)     &CASFPacketParser::ParsePacketHeaderT< CASFStaticFlags<(i)> >
+#define ASF_PAYLOAD_ENTRY(i)    &CASFPacketParser::ParsePayloadHeaderT< CASFStaticFlags<(i)> >
+
+const CASFPacketParser::PFN_PARSE_PACKET CASFPacketParser::s_rgpfnParsePacket[ASF_PACKET_FLAGS_COUNT] =
+{
+    ASF_ENTRIES_64(ASF_PACKET_ENTRY, 0),
+    ASF_ENTRIES_64(ASF_PACKET_ENTRY, 64)
+};
+
+const CASFPacketParser::PFN_PARSE_PAYLOAD CASFPacketParser::s_rgpfnParsePayload[ASF_PAYLOAD_FLAGS_COUNT] =
+{
+    ASF_ENTRIES_64(ASF_PAYLOAD_ENTRY, 0),
+    ASF_ENTRIES_64(ASF_PAYLOAD_ENTRY, 64),
+    ASF_ENTRIES_64(ASF_PAYLOAD_ENTRY, 128),
+    ASF_ENTRIES_64(ASF_PAYLOAD_ENTRY, 192)
+};
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFPacketParser
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFPacketParser::CASFPacketParser()
+:   m_cbPacketSize (0),
+    m_fSpecialized (TRUE),
+    m_dwPacketFlags (0),
+    m_pfnParsePacket (NULL),
+    m_dwPayloadFlags (0),
+    m_pfnParsePayload (NULL),
+    m_pPacket (NULL),
+    m_pCurrent (NULL),
+    m_pEnd (NULL),
+    m_dwPayloadFlagsRuntime (0),
+    m_cPayloadsLeft (0),
+    m_pSubPayloadEnd (NULL),
+    m_bPresentationTimeDelta (0)
+{
+    memset(&m_SubPayload, 0, sizeof(m_SubPayload));
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Initialize
+//
+// Sets the packet size used when a packet does not carry an explicit
+// packet length.
+//
+// cbPacketSize: Fixed packet size from the File Properties Object
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFPacketParser::Initialize(DWORD cbPacketSize)
+{
+    if (cbPacketSize == 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    m_cbPacketSize = cbPacketSize;
+    m_pPacket = NULL;
+    m_pCurrent = NULL;
+    m_pEnd = NULL;
+    m_cPayloadsLeft = 0;
+    m_pSubPayloadEnd = NULL;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: UseSpecializedPaths
+//
+// Selects the parsing code. The generic path reads the length types
+// from every packet and payload; it produces the same results and is
+// kept as the reference for the specialized paths.
+/////////////////////////////////////////////////////////////////////
+
+void CASFPacketParser::UseSpecializedPaths(BOOL fSpecialized)
+{
+    m_fSpecialized = fSpecialized;
+
+    m_pfnParsePacket = NULL;
+    m_pfnParsePayload = NULL;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ParsePacket
+//
+// Parses the error correction data and the payload parsing
+// information of a data packet and prepares GetNextPayload.
+//
+// pPacket:  Pointer to the first byte of the packet
+// cbPacket: Number of valid bytes at pPacket
+// pInfo:    Receives the packet header fields. Can be NULL.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFPacketParser::ParsePacket(const BYTE* pPacket, DWORD cbPacket, ASF_PACKET_INFO* pInfo)
+{
+    if (!pPacket)
+    {
+        return E_POINTER;
+    }
+
+    if (m_cbPacketSize == 0)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    m_cPayloadsLeft = 0;
+    m_pSubPayloadEnd = NULL;
+    m_pPacket = pPacket;
+    m_pCurrent = pPacket;
+
+    DWORD cbErrorCorrection = 0;
+
+    if (cbPacket < 1)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    //Error correction data
+    if (pPacket[0] & ASF_EC_PRESENT)
+    {
+        if (pPacket[0] & ASF_EC_LENGTH_TYPE_MASK)
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        cbErrorCorrection = 1 + (pPacket[0] & ASF_EC_DATA_LENGTH_MASK);
+    }
+
+    //Length type flags and property flags
+    if (cbPacket < cbErrorCorrection + 2)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    DWORD dwPacketFlags = pPacket[cbErrorCorrection] & ASF_PACKET_FLAGS_MASK;
+
+    if (!m_pfnParsePacket || (dwPacketFlags != m_dwPacketFlags))
+    {
+        m_dwPacketFlags = dwPacketFlags;
+        m_pfnParsePacket = m_fSpecialized ?
+            s_rgpfnParsePacket[dwPacketFlags] :
+            &CASFPacketParser::ParsePacketHeaderT<CASFRuntimeFlags>;
+    }
+
+    HRESULT hr = (this->*m_pfnParsePacket)(pPacket, cbPacket, cbErrorCorrection, pInfo);
+    if (FAILED(hr))
+    {
+        m_cPayloadsLeft = 0;
+        return hr;
+    }
+
+    if (!m_pfnParsePayload || (m_dwPayloadFlagsRuntime != m_dwPayloadFlags))
+    {
+        m_dwPayloadFlags = m_dwPayloadFlagsRuntime;
+        m_pfnParsePayload = m_fSpecialized ?
+            s_rgpfnParsePayload[m_dwPayloadFlagsRuntime] :
+            &CASFPacketParser::ParsePayloadHeaderT<CASFRuntimeFlags>;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetNextPayload
+//
+// Returns the next payload of the packet passed to ParsePacket.
+// Returns S_FALSE when the packet has no more payloads.
+//
+// pPayload: Receives the payload descriptor.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFPacketParser::GetNextPayload(ASF_PAYLOAD_INFO* pPayload)
+{
+    if (!pPayload)
+    {
+        return E_POINTER;
+    }
+
+    //Finish expanding a compressed payload first
+    if (m_pSubPayloadEnd)
+    {
+        HRESULT hr = GetNextSubPayload(pPayload);
+        if (hr != S_FALSE)
+        {
+            return hr;
+        }
+    }
+
+    if (m_cPayloadsLeft == 0)
+    {
+        return S_FALSE;
+    }
+
+    HRESULT hr = (this->*m_pfnParsePayload)(pPayload);
+    if (FAILED(hr))
+    {
+        m_cPayloadsLeft = 0;
+        return hr;
+    }
+
+    m_cPayloadsLeft--;
+
+    if (pPayload->fCompressed)
+    {
+        hr = GetNextSubPayload(pPayload);
+
+        //An empty compressed payload yields no media objects
+        if (hr == S_FALSE)
+        {
+            return GetNextPayload(pPayload);
+        }
+    }
+
+    return hr;
+}
+
+// ----- Protected Methods -----------------------------------------------
+
+/////////////////////////////////////////////////////////////////////
+// Name: ParsePacketHeaderT
+//
+// Parses the payload parsing information that follows the error
+// correction data. TFlags supplies the length type flags byte.
+/////////////////////////////////////////////////////////////////////
+
+template <class TFlags>
+HRESULT CASFPacketParser::ParsePacketHeaderT(
+    const BYTE* pPacket,
+    DWORD cbPacket,
+    DWORD cbErrorCorrection,
+    ASF_PACKET_INFO* pInfo
+    )
+{
+    const BYTE* p = pPacket + cbErrorCorrection;
+
+    const DWORD dwFlags = TFlags::Get(p[0] & ASF_PACKET_FLAGS_MASK);
+
+    const DWORD dwPacketLengthType = ASF_LENGTH_TYPE(dwFlags, ASF_PACKET_LENGTH_TYPE_SHIFT);
+    const DWORD dwSequenceType = ASF_LENGTH_TYPE(dwFlags, ASF_SEQUENCE_TYPE_SHIFT);
+    const DWORD dwPaddingLengthType = ASF_LENGTH_TYPE(dwFlags, ASF_PADDING_LENGTH_TYPE_SHIFT);
+    const BOOL fMultiplePayloads = (dwFlags & ASF_PACKET_MULTIPLE_PAYLOADS) ? TRUE : FALSE;
+
+    const DWORD cbFields =
+        2 +     // Length type flags + property flags
+        ASFLengthTypeSize(dwPacketLengthType) +
+        ASFLengthTypeSize(dwSequenceType) +
+        ASFLengthTypeSize(dwPaddingLengthType) +
+        6 +     // Send time + duration
+        (fMultiplePayloads ? 1 : 0);
+
+    if (cbPacket - cbErrorCorrection < cbFields)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    BYTE bLengthTypeFlags = p[0];
+    BYTE bPropertyFlags = p[1];
+    p += 2;
+
+    DWORD cbPacketLength = ASFReadLengthType(p, dwPacketLengthType);
+    p += ASFLengthTypeSize(dwPacketLengthType);
+
+    DWORD dwSequence = ASFReadLengthType(p, dwSequenceType);
+    p += ASFLengthTypeSize(dwSequenceType);
+
+    DWORD cbPadding = ASFReadLengthType(p, dwPaddingLengthType);
+    p += ASFLengthTypeSize(dwPaddingLengthType);
+
+    DWORD dwSendTime = ASFReadDWord(p);
+    WORD wDuration = ASFReadWord(p + 4);
+    p += 6;
+
+    DWORD dwPayloadFlags = bPropertyFlags & ASF_PAYLOAD_FLAGS_MASK;
+
+    if (fMultiplePayloads)
+    {
+        DWORD dwPayloadLengthType = ASF_LENGTH_TYPE(p[0], ASF_PAYLOAD_LENGTH_TYPE_SHIFT);
+
+        m_cPayloadsLeft = p[0] & ASF_PAYLOAD_COUNT_MASK;
+        p++;
+
+        //Zero is reserved for single payloads
+        if ((m_cPayloadsLeft > 0) && (dwPayloadLengthType == 0))
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        dwPayloadFlags |= dwPayloadLengthType << ASF_PAYLOAD_FLAGS_LENGTH_TYPE_SHIFT;
+    }
+    else
+    {
+        m_cPayloadsLeft = 1;
+    }
+
+    if (dwPacketLengthType == 0)
+    {
+        cbPacketLength = m_cbPacketSize;
+    }
+
+    //The payloads end where the padding starts
+    if ((cbPacketLength > cbPacket) ||
+        (cbPadding > cbPacketLength) ||
+        (pPacket + cbPacketLength - cbPadding < p))
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    m_pCurrent = p;
+    m_pEnd = pPacket + cbPacketLength - cbPadding;
+    m_dwPayloadFlagsRuntime = dwPayloadFlags;
+
+    if (pInfo)
+    {
+        pInfo->cbErrorCorrection = cbErrorCorrection;
+        pInfo->bLengthTypeFlags = bLengthTypeFlags;
+        pInfo->bPropertyFlags = bPropertyFlags;
+        pInfo->cbPacketLength = cbPacketLength;
+        pInfo->dwSequence = dwSequence;
+        pInfo->cbPadding = cbPadding;
+        pInfo->dwSendTime = dwSendTime;
+        pInfo->wDuration = wDuration;
+        pInfo->fMultiplePayloads = fMultiplePayloads;
+        pInfo->cPayloads = m_cPayloadsLeft;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ParsePayloadHeaderT
+//
+// Parses the payload at m_pCurrent and advances past its data. For a
+// compressed payload, sets up the sub-payload expansion instead of
+// returning the data. TFlags supplies the payload flags index.
+/////////////////////////////////////////////////////////////////////
+
+template <class TFlags>
+HRESULT CASFPacketParser::ParsePayloadHeaderT(ASF_PAYLOAD_INFO* pPayload)
+{
+    const BYTE* p = m_pCurrent;
+
+    const DWORD dwFlags = TFlags::Get(m_dwPayloadFlagsRuntime);
+
+    const DWORD dwObjectNumberType = ASF_LENGTH_TYPE(dwFlags, ASF_OBJECT_NUMBER_LENGTH_TYPE_SHIFT);
+    const DWORD dwOffsetType = ASF_LENGTH_TYPE(dwFlags, ASF_OFFSET_LENGTH_TYPE_SHIFT);
+    const DWORD dwReplicatedType = ASF_LENGTH_TYPE(dwFlags, ASF_REPLICATED_LENGTH_TYPE_SHIFT);
+    const DWORD dwPayloadLengthType = ASF_LENGTH_TYPE(dwFlags, ASF_PAYLOAD_FLAGS_LENGTH_TYPE_SHIFT);
+
+    const DWORD cbFields =
+        1 +     // Stream number
+        ASFLengthTypeSize(dwObjectNumberType) +
+        ASFLengthTypeSize(dwOffsetType) +
+        ASFLengthTypeSize(dwReplicatedType);
+
+    const DWORD cbLengthField = ASFLengthTypeSize(dwPayloadLengthType);
+
+    if ((DWORD)(m_pEnd - p) < cbFields)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    pPayload->bStreamNumber = p[0] & ASF_PAYLOAD_STREAM_NUMBER_MASK;
+    pPayload->fKeyFrame = (p[0] & ASF_PAYLOAD_KEY_FRAME) ? TRUE : FALSE;
+    p++;
+
+    pPayload->dwMediaObjectNumber = ASFReadLengthType(p, dwObjectNumberType);
+    p += ASFLengthTypeSize(dwObjectNumberType);
+
+    DWORD dwOffsetOrTime = ASFReadLengthType(p, dwOffsetType);
+    p += ASFLengthTypeSize(dwOffsetType);
+
+    DWORD cbReplicated = ASFReadLengthType(p, dwReplicatedType);
+    p += ASFLengthTypeSize(dwReplicatedType);
+
+    //Replicated data and, for multiple payloads, the payload length
+    if (((DWORD)(m_pEnd - p) < cbLengthField) ||
+        ((DWORD)(m_pEnd - p) - cbLengthField < cbReplicated))
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    pPayload->pReplicatedData = p;
+    pPayload->cbReplicatedData = cbReplicated;
+    p += cbReplicated;
+
+    DWORD cbData = 0;
+
+    if (dwPayloadLengthType != 0)
+    {
+        cbData = ASFReadLengthType(p, dwPayloadLengthType);
+        p += cbLengthField;
+
+        if ((DWORD)(m_pEnd - p) < cbData)
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+    }
+    else
+    {
+        //Single payload: the rest of the packet
+        cbData = (DWORD)(m_pEnd - p);
+    }
+
+    pPayload->pData = p;
+    pPayload->cbData = cbData;
+    m_pCurrent = p + cbData;
+
+    if (cbReplicated == ASF_COMPRESSED_REPLICATED_LENGTH)
+    {
+        //The offset field holds the presentation time of the first sub-payload
+        pPayload->fCompressed = TRUE;
+        pPayload->dwOffsetIntoMediaObject = 0;
+        pPayload->cbMediaObjectSize = 0;
+        pPayload->dwPresentationTime = dwOffsetOrTime;
+
+        m_SubPayload = *pPayload;
+        m_bPresentationTimeDelta = pPayload->pReplicatedData[0];
+        m_pSubPayloadEnd = p + cbData;
+    }
+    else
+    {
+        pPayload->fCompressed = FALSE;
+        pPayload->dwOffsetIntoMediaObject = dwOffsetOrTime;
+
+        if (cbReplicated >= ASF_REPLICATED_DATA_MIN_SIZE)
+        {
+            pPayload->cbMediaObjectSize = ASFReadDWord(pPayload->pReplicatedData);
+            pPayload->dwPresentationTime = ASFReadDWord(pPayload->pReplicatedData + 4);
+        }
+        else
+        {
+            pPayload->cbMediaObjectSize = 0;
+            pPayload->dwPresentationTime = 0;
+        }
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetNextSubPayload
+//
+// Returns the next sub-payload of the pending compressed payload, or
+// S_FALSE when it is exhausted. Each sub-payload is a one-byte length
+// followed by a whole media object.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFPacketParser::GetNextSubPayload(ASF_PAYLOAD_INFO* pPayload)
+{
+    const BYTE* p = m_SubPayload.pData;
+
+    if (p >= m_pSubPayloadEnd)
+    {
+        m_pSubPayloadEnd = NULL;
+        return S_FALSE;
+    }
+
+    DWORD cbSubPayload = p[0];
+    p++;
+
+    if ((DWORD)(m_pSubPayloadEnd - p) < cbSubPayload)
+    {
+        m_pSubPayloadEnd = NULL;
+        m_cPayloadsLeft = 0;
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    *pPayload = m_SubPayload;
+    pPayload->pData = p;
+    pPayload->cbData = cbSubPayload;
+    pPayload->cbMediaObjectSize = cbSubPayload;
+
+    //Advance the template to the next media object
+    m_SubPayload.pData = p + cbSubPayload;
+    m_SubPayload.dwMediaObjectNumber++;
+    m_SubPayload.dwPresentationTime += m_bPresentationTimeDelta;
+
+    return S_OK;
+}
@@ -0,0 +1,174 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFPacketParser.h : CASFPacketParser class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFFormat.h"
+
+//Fields of the data packet header (error correction data and payload
+//parsing information).
+
+struct ASF_PACKET_INFO
+{
+    DWORD   cbErrorCorrection;  // Error correction data, including the flags byte
+    BYTE    bLengthTypeFlags;
+    BYTE    bPropertyFlags;
+    DWORD   cbPacketLength;     // Explicit packet length, or the fixed packet size
+    DWORD   dwSequence;
+    DWORD   cbPadding;
+    DWORD   dwSendTime;         // Milliseconds
+    WORD    wDuration;          // Milliseconds
+    BOOL    fMultiplePayloads;
+    DWORD   cPayloads;          // Payloads in the packet, before sub-payloads are expanded
+};
+
+//One payload of a data packet. A compressed payload is reported as one
+//descriptor per sub-payload; each sub-payload is a whole media object.
+//The data pointers reference the packet passed to ParsePacket.
+
+struct ASF_PAYLOAD_INFO
+{
+    BYTE        bStreamNumber;
+    BOOL        fKeyFrame;
+    BOOL        fCompressed;            // Sub-payload of a compressed payload
+    DWORD       dwMediaObjectNumber;
+    DWORD       dwOffsetIntoMediaObject;
+    DWORD       cbMediaObjectSize;      // Zero if the replicated data does not carry it
+    DWORD       dwPresentationTime;     // Milliseconds, includes the preroll
+
+    const BYTE* pReplicatedData;
+    DWORD       cbReplicatedData;
+
+    const BYTE* pData;
+    DWORD       cbData;
+};
+
+
+//The length-type flags of a file rarely change from packet to packet.
+//The header and payload parsers are templates on how they obtain the
+//flags: CASFRuntimeFlags reads them from the packet (generic path),
+//CASFStaticFlags fixes them at compile time so the field sizes, offsets
+//and bounds checks fold into constants (specialized paths).
+
+struct CASFRuntimeFlags
+{
+    static DWORD Get(DWORD dwFlags)
+    {
+        return dwFlags;
+    }
+};
+
+template <DWORD dwFixedFlags>
+struct CASFStaticFlags
+{
+    static DWORD Get(DWORD)
+    {
+        return dwFixedFlags;
+    }
+};
+
+//Index of the packet header specializations: the length type flags
+//byte without the error correction bit.
+#define ASF_PACKET_FLAGS_COUNT      128
+#define ASF_PACKET_FLAGS_MASK       0x7F
+
+//Index of the payload specializations: the replicated data, offset and
+//media object number length types from the property flags (bits 0-5),
+//plus the payload length type (bits 6-7, zero for single payloads).
+#define ASF_PAYLOAD_FLAGS_COUNT     256
+#define ASF_PAYLOAD_FLAGS_MASK      0x3F
+#define ASF_PAYLOAD_FLAGS_LENGTH_TYPE_SHIFT 6
+
+
+//Parses ASF data packets in place. ParsePacket reads the packet
+//header; GetNextPayload then walks the payloads one at a time, so a
+//packet of any payload count is parsed without allocating or copying.
+//
+//By default both steps run through code specialized for the flag
+//combination of the packet. The specialization is looked up in a
+//dispatch table when a combination is first seen and kept until the
+//flags change.
+
+class CASFPacketParser
+{
+public:
+
+    typedef HRESULT (CASFPacketParser::*PFN_PARSE_PACKET)(const BYTE*, DWORD, DWORD, ASF_PACKET_INFO*);
+    typedef HRESULT (CASFPacketParser::*PFN_PARSE_PAYLOAD)(ASF_PAYLOAD_INFO*);
+
+    CASFPacketParser();
+
+    HRESULT Initialize(DWORD cbPacketSize);
+
+    //Selects the specialized (default) or the generic parsing code
+    void UseSpecializedPaths(BOOL fSpecialized);
+
+    HRESULT ParsePacket(const BYTE* pPacket, DWORD cbPacket, ASF_PACKET_INFO* pInfo);
+
+    HRESULT GetNextPayload(ASF_PAYLOAD_INFO* pPayload);
+
+    DWORD GetPacketSize() const
+    {
+        return m_cbPacketSize;
+    }
+
+    //Offset from the start of the packet of the next byte to parse: the
+    //next payload header, unless a compressed payload is being expanded.
+    //Lets callers that load a packet piecemeal check what was parsed.
+    DWORD GetParseOffset() const
+    {
+        return m_pPacket ? (DWORD)(m_pCurrent - m_pPacket) : 0;
+    }
+
+    //Payloads whose headers have not been parsed yet
+    DWORD GetPayloadsLeft() const
+    {
+        return m_cPayloadsLeft;
+    }
+
+protected:
+
+    template <class TFlags>
+    HRESULT ParsePacketHeaderT(const BYTE* pPacket, DWORD cbPacket, DWORD cbErrorCorrection, ASF_PACKET_INFO* pInfo);
+
+    template <class TFlags>
+    HRESULT ParsePayloadHeaderT(ASF_PAYLOAD_INFO* pPayload);
+
+    HRESULT GetNextSubPayload(ASF_PAYLOAD_INFO* pPayload);
+
+    static const PFN_PARSE_PACKET   s_rgpfnParsePacket[ASF_PACKET_FLAGS_COUNT];
+    static const PFN_PARSE_PAYLOAD  s_rgpfnParsePayload[ASF_PAYLOAD_FLAGS_COUNT];
+
+protected:
+
+    DWORD       m_cbPacketSize;         // Fixed packet size from the File Properties Object
+    BOOL        m_fSpecialized;
+
+    //Specializations picked for the most recent flags
+    DWORD               m_dwPacketFlags;
+    PFN_PARSE_PACKET    m_pfnParsePacket;
+    DWORD               m_dwPayloadFlags;
+    PFN_PARSE_PAYLOAD   m_pfnParsePayload;
+
+    //Packet being parsed
+    const BYTE* m_pPacket;
+    const BYTE* m_pCurrent;             // Next unparsed byte
+    const BYTE* m_pEnd;                 // End of the payload data, before the padding
+    DWORD       m_dwPayloadFlagsRuntime; // Payload flags index of the packet
+    DWORD       m_cPayloadsLeft;
+
+    //Compressed payload being expanded
+    const BYTE* m_pSubPayloadEnd;       // NULL if no compressed payload is pending
+    ASF_PAYLOAD_INFO m_SubPayload;      // Template for the next sub-payload
+    BYTE        m_bPresentationTimeDelta;
+};
@@ -0,0 +1,362 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFParallelScanner.cpp : CASFParallelScanner class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include "ASFParallelScanner.h"
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFParallelScanner
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFParallelScanner::CASFParallelScanner()
+:   m_pPackets (NULL),
+    m_cbPacketSize (0),
+    m_cbFirstPacketOffset (0),
+    m_cPackets (0),
+    m_cCorruptPackets (0)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFParallelScanner
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFParallelScanner::~CASFParallelScanner()
+{
+    Reset();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Scan
+//
+// Parses all packets and collects the media objects of every stream.
+//
+// pPackets: First byte of the first data packet
+// cPackets: Number of packets at pPackets
+// cbPacketSize: Fixed packet size from the File Properties Object
+// cbFirstPacketOffset: File offset of the first packet, used for the
+//                      packet offsets in the descriptors
+// cThreads: Number of worker threads, 0 for one per processor
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFParallelScanner::Scan(
+    const BYTE* pPackets,
+    QWORD cPackets,
+    DWORD cbPacketSize,
+    QWORD cbFirstPacketOffset,
+    DWORD cThreads
+    )
+{
+    if (!pPackets || (cbPacketSize == 0))
+    {
+        return E_INVALIDARG;
+    }
+
+    Reset();
+
+    m_pPackets = pPackets;
+    m_cbPacketSize = cbPacketSize;
+    m_cbFirstPacketOffset = cbFirstPacketOffset;
+    m_cPackets = cPackets;
+
+    if (cPackets == 0)
+    {
+        return S_OK;
+    }
+
+    if (cThreads == 0)
+    {
+        cThreads = CASFThread::GetProcessorCount();
+    }
+
+    if (cThreads > ASF_SCAN_MAX_THREADS)
+    {
+        cThreads = ASF_SCAN_MAX_THREADS;
+    }
+
+    DWORD cRanges = cThreads * ASF_SCAN_RANGES_PER_THREAD;
+
+    if (cRanges > cPackets)
+    {
+        cRanges = (DWORD)cPackets;
+    }
+
+    if (cThreads > cRanges)
+    {
+        cThreads = cRanges;
+    }
+
+    HRESULT hr = S_OK;
+
+    SCAN_RANGE* pRanges = new (std::nothrow) SCAN_RANGE[cRanges];
+    SCAN_WORKER* pWorkers = new (std::nothrow) SCAN_WORKER[cThreads];
+    CASFThread* pThreads = new (std::nothrow) CASFThread[cThreads];
+
+    QWORD cPacketsPerRange = cPackets / cRanges;
+    QWORD cExtra = cPackets % cRanges;
+
+    if (!pRanges || !pWorkers || !pThreads)
+    {
+        hr = E_OUTOFMEMORY;
+        goto done;
+    }
+
+    //Equal packet counts; the first ranges take the remainder
+    for (DWORD i = 0; i < cRanges; i++)
+    {
+        pRanges[i].iFirstPacket = i * cPacketsPerRange + ((i < cExtra) ? i : cExtra);
+        pRanges[i].cPackets = cPacketsPerRange + ((i < cExtra) ? 1 : 0);
+        pRanges[i].cCorruptPackets = 0;
+        pRanges[i].hr = S_OK;
+    }
+
+    //Workers 1..cThreads-1 run on their own threads
+    for (DWORD t = 1; t < cThreads; t++)
+    {
+        pWorkers[t].pScanner = this;
+        pWorkers[t].pRanges = pRanges;
+        pWorkers[t].cRanges = cRanges;
+        pWorkers[t].iFirstRange = t;
+        pWorkers[t].cStride = cThreads;
+
+        if (FAILED(pThreads[t].Start(ScanWorkerProc, &pWorkers[t])))
+        {
+            break;
+        }
+    }
+
+    //The calling thread is worker 0, and also takes the ranges of any
+    //worker whose thread could not be started.
+    for (DWORD i = 0; i < cRanges; i++)
+    {
+        DWORD t = i % cThreads;
+
+        if ((t == 0) || !pThreads[t].IsRunning())
+        {
+            ScanRange(&pRanges[i]);
+        }
+    }
+
+    for (DWORD t = 1; t < cThreads; t++)
+    {
+        pThreads[t].Join();
+    }
+
+    hr = MergeRanges(pRanges, cRanges);
+
+done:
+    delete [] pThreads;
+    delete [] pWorkers;
+    delete [] pRanges;
+
+    if (FAILED(hr))
+    {
+        Reset();
+    }
+
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Reset
+//
+// Releases the results of the previous scan.
+/////////////////////////////////////////////////////////////////////
+
+void CASFParallelScanner::Reset()
+{
+    for (DWORD i = 0; i < ASF_MAX_STREAMS; i++)
+    {
+        m_Streams[i].Clear();
+    }
+
+    m_pPackets = NULL;
+    m_cbPacketSize = 0;
+    m_cbFirstPacketOffset = 0;
+    m_cPackets = 0;
+    m_cCorruptPackets = 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetSamples
+//
+// Returns the media objects of a stream in file order. The array is
+// owned by the scanner and valid until the next Scan or Reset.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFParallelScanner::GetSamples(
+    WORD wStreamNumber,
+    const ASF_SAMPLE_DESCRIPTOR** ppSamples,
+    DWORD* pcSamples
+    ) const
+{
+    if (!ppSamples || !pcSamples)
+    {
+        return E_POINTER;
+    }
+
+    if (wStreamNumber >= ASF_MAX_STREAMS)
+    {
+        return MF_E_INVALIDSTREAMNUMBER;
+    }
+
+    *ppSamples = m_Streams[wStreamNumber].GetData();
+    *pcSamples = m_Streams[wStreamNumber].GetCount();
+
+    return S_OK;
+}
+
+// ----- Protected Methods -----------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Name: ScanWorkerProc
+// Desc: Thread procedure of a scan worker.
+//
+// Note: This is a static method. It calls through to ScanRange.
+//-----------------------------------------------------------------------------
+
+void CASFParallelScanner::ScanWorkerProc(void* pContext)
+{
+    SCAN_WORKER* pWorker = (SCAN_WORKER*)pContext;
+
+    for (DWORD i = pWorker->iFirstRange; i < pWorker->cRanges; i += pWorker->cStride)
+    {
+        pWorker->pScanner->ScanRange(&pWorker->pRanges[i]);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ScanRange
+//
+// Parses the packets of one range with a private packet parser and
+// records every media object that starts in the range. Fragments of
+// objects that started in an earlier range are skipped; that range
+// already recorded them. Packets that fail to parse are counted and
+// skipped.
+/////////////////////////////////////////////////////////////////////
+
+void CASFParallelScanner::ScanRange(SCAN_RANGE* pRange) const
+{
+    CASFPacketParser parser;
+    ASF_PAYLOAD_INFO payload;
+    ASF_SAMPLE_DESCRIPTOR sample;
+
+    HRESULT hr = parser.Initialize(m_cbPacketSize);
+
+    for (QWORD iPacket = 0; SUCCEEDED(hr) && (iPacket < pRange->cPackets); iPacket++)
+    {
+        QWORD cbPacket = (pRange->iFirstPacket + iPacket) * m_cbPacketSize;
+
+        if (FAILED(parser.ParsePacket(m_pPackets + cbPacket, m_cbPacketSize, NULL)))
+        {
+            pRange->cCorruptPackets++;
+            continue;
+        }
+
+        for (;;)
+        {
+            HRESULT hrPayload = parser.GetNextPayload(&payload);
+
+            if (hrPayload == S_FALSE)
+            {
+                break;
+            }
+
+            if (FAILED(hrPayload))
+            {
+                pRange->cCorruptPackets++;
+                break;
+            }
+
+            if (!payload.fCompressed && (payload.dwOffsetIntoMediaObject != 0))
+            {
+                continue;
+            }
+
+            sample.cbPacketOffset = m_cbFirstPacketOffset + cbPacket;
+            sample.dwPresentationTime = payload.dwPresentationTime;
+            sample.cbMediaObjectSize = payload.cbMediaObjectSize;
+            sample.dwMediaObjectNumber = payload.dwMediaObjectNumber;
+            sample.bStreamNumber = payload.bStreamNumber;
+            sample.fKeyFrame = payload.fKeyFrame ? 1 : 0;
+
+            hr = pRange->samples.Append(sample);
+            if (FAILED(hr))
+            {
+                break;
+            }
+        }
+    }
+
+    pRange->hr = hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: MergeRanges
+//
+// Distributes the descriptors of all ranges to the per-stream lists,
+// range by range, so every stream stays in file order.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFParallelScanner::MergeRanges(SCAN_RANGE* pRanges, DWORD cRanges)
+{
+    DWORD rgcSamples[ASF_MAX_STREAMS] = { 0 };
+
+    HRESULT hr = S_OK;
+
+    //Size the stream lists up front
+    for (DWORD i = 0; i < cRanges; i++)
+    {
+        if (FAILED(pRanges[i].hr))
+        {
+            return pRanges[i].hr;
+        }
+
+        m_cCorruptPackets += pRanges[i].cCorruptPackets;
+
+        for (DWORD j = 0; j < pRanges[i].samples.GetCount(); j++)
+        {
+            rgcSamples[pRanges[i].samples[j].bStreamNumber]++;
+        }
+    }
+
+    for (DWORD s = 0; s < ASF_MAX_STREAMS; s++)
+    {
+        hr = m_Streams[s].Reserve(rgcSamples[s]);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+    }
+
+    for (DWORD i = 0; i < cRanges; i++)
+    {
+        for (DWORD j = 0; j < pRanges[i].samples.GetCount(); j++)
+        {
+            const ASF_SAMPLE_DESCRIPTOR& sample = pRanges[i].samples[j];
+
+            //Cannot fail, the lists were reserved above
+            (void)m_Streams[sample.bStreamNumber].Append(sample);
+        }
+
+        //Release each range as soon as it is merged
+        pRanges[i].samples.Clear();
+    }
+
+    return hr;
+}
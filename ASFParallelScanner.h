@@ -0,0 +1,106 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFParallelScanner.h : CASFParallelScanner class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFPacketParser.h"
+#include "ASFSampleList.h"
+#include "ASFThread.h"
+
+//Ranges per thread; more ranges than threads evens out the load when
+//the packet density varies over the file.
+#define ASF_SCAN_RANGES_PER_THREAD      4
+
+//Upper bound on the number of scan threads
+#define ASF_SCAN_MAX_THREADS            64
+
+
+//Builds the sample timelines of a Data Object with fixed-size packets.
+//Packet boundaries are pure arithmetic, so the packets are split into
+//packet-aligned ranges that are parsed on worker threads. Each range
+//records the media objects that start in it; the ranges are then merged
+//per stream in file order.
+
+class CASFParallelScanner
+{
+public:
+
+    CASFParallelScanner();
+    ~CASFParallelScanner();
+
+    HRESULT Scan(
+        const BYTE* pPackets,
+        QWORD cPackets,
+        DWORD cbPacketSize,
+        QWORD cbFirstPacketOffset,
+        DWORD cThreads
+        );
+
+    void Reset();
+
+    HRESULT GetSamples(
+        WORD wStreamNumber,
+        const ASF_SAMPLE_DESCRIPTOR** ppSamples,
+        DWORD* pcSamples
+        ) const;
+
+    QWORD GetPacketCount() const
+    {
+        return m_cPackets;
+    }
+
+    //Packets that could not be parsed and were skipped
+    QWORD GetCorruptPacketCount() const
+    {
+        return m_cCorruptPackets;
+    }
+
+protected:
+
+    struct SCAN_RANGE
+    {
+        QWORD           iFirstPacket;
+        QWORD           cPackets;
+        QWORD           cCorruptPackets;
+        HRESULT         hr;
+        CASFSampleList  samples;    // All streams, in file order
+    };
+
+    //Worker t scans ranges t, t + cStride, t + 2 * cStride, ...
+    struct SCAN_WORKER
+    {
+        const CASFParallelScanner*  pScanner;
+        SCAN_RANGE*                 pRanges;
+        DWORD                       cRanges;
+        DWORD                       iFirstRange;
+        DWORD                       cStride;
+    };
+
+    static void ScanWorkerProc(void* pContext);
+
+    void ScanRange(SCAN_RANGE* pRange) const;
+
+    HRESULT MergeRanges(SCAN_RANGE* pRanges, DWORD cRanges);
+
+protected:
+
+    //Scan parameters
+    const BYTE*     m_pPackets;
+    DWORD           m_cbPacketSize;
+    QWORD           m_cbFirstPacketOffset;
+
+    //Results
+    QWORD           m_cPackets;
+    QWORD           m_cCorruptPackets;
+    CASFSampleList  m_Streams[ASF_MAX_STREAMS];     // Indexed by stream number
+};
@@ -0,0 +1,399 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFPcmRing.cpp : CASFPcmRing class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include <string.h>
+#include "ASFPcmRing.h"
+#include "ASFThread.h"
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFPcmRing
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFPcmRing::CASFPcmRing()
+:   m_pData (NULL),
+    m_cbCapacity (0),
+    m_nBlockAlign (1)
+{
+    Reset();
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFPcmRing
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFPcmRing::~CASFPcmRing()
+{
+    delete [] m_pData;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Initialize
+//
+// Allocates the ring for one output format. The memory is kept when
+// a later format needs the same size.
+//
+// cbCapacity: Number of bytes the ring holds, rounded up to a block
+// nBlockAlign: Block alignment of the PCM format
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFPcmRing::Initialize(DWORD cbCapacity, DWORD nBlockAlign)
+{
+    if ((cbCapacity == 0) || (nBlockAlign == 0) || (cbCapacity > ASF_PCM_RING_MAX_SIZE))
+    {
+        return E_INVALIDARG;
+    }
+
+    //Round up to whole blocks and add the block that is kept free
+    DWORD cbRing = ((cbCapacity + nBlockAlign - 1) / nBlockAlign + 1) * nBlockAlign;
+
+    if (!m_pData || (cbRing != m_cbCapacity))
+    {
+        BYTE* pData = new (std::nothrow) BYTE[cbRing];
+
+        if (!pData)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        delete [] m_pData;
+
+        m_pData = pData;
+        m_cbCapacity = cbRing;
+    }
+
+    m_nBlockAlign = nBlockAlign;
+
+    Reset();
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Reset
+//
+// Empties the ring. The memory is kept.
+/////////////////////////////////////////////////////////////////////
+
+void CASFPcmRing::Reset()
+{
+    m_iWrite = 0;
+    m_iRead = 0;
+    m_cbDropped = 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Rewind
+//
+// Restores the ring to the state after cbData bytes were written to
+// an empty ring, so data that was consumed can be read once more. The
+// caller knows that the data has not been overwritten since.
+//
+// cbData: Number of bytes from the start of the memory, whole blocks
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFPcmRing::Rewind(DWORD cbData)
+{
+    if (!m_pData)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    if ((cbData % m_nBlockAlign != 0) || (cbData > m_cbCapacity - m_nBlockAlign))
+    {
+        return E_INVALIDARG;
+    }
+
+    m_iRead = 0;
+    m_iWrite = cbData;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: BeginWrite
+//
+// Returns the contiguous free space at the write position. Called by
+// the writer only.
+//
+// Returns S_FALSE, with no pointer, if fewer than cbMin contiguous
+// bytes are free; the writer then decodes elsewhere and uses Write.
+//
+// cbMin: Number of bytes the writer needs in one piece
+// ppData: Receives a pointer to the free space
+// pcbContiguous: Receives the size of the free space, whole blocks
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFPcmRing::BeginWrite(DWORD cbMin, BYTE** ppData, DWORD* pcbContiguous)
+{
+    if (!ppData || !pcbContiguous)
+    {
+        return E_POINTER;
+    }
+
+    *ppData = NULL;
+    *pcbContiguous = 0;
+
+    if (!m_pData)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    DWORD iWrite = (DWORD)m_iWrite;
+    DWORD cbFree = GetWritable();
+    DWORD cbContiguous = (m_cbCapacity - iWrite < cbFree) ? (m_cbCapacity - iWrite) : cbFree;
+
+    if ((cbContiguous == 0) || (cbContiguous < cbMin))
+    {
+        return S_FALSE;
+    }
+
+    *ppData = m_pData + iWrite;
+    *pcbContiguous = cbContiguous;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: CommitWrite
+//
+// Publishes data written at the pointer from BeginWrite. Called by
+// the writer only.
+//
+// cbData: Number of bytes written, whole blocks
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFPcmRing::CommitWrite(DWORD cbData)
+{
+    if (!m_pData)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    DWORD iWrite = (DWORD)m_iWrite;
+
+    if ((cbData % m_nBlockAlign != 0) ||
+        (cbData > GetWritable()) ||
+        (cbData > m_cbCapacity - iWrite))
+    {
+        return E_INVALIDARG;
+    }
+
+    iWrite += cbData;
+
+    if (iWrite == m_cbCapacity)
+    {
+        iWrite = 0;
+    }
+
+    //The data is visible to the reader once it sees the new position
+    ASFStoreRelease(&m_iWrite, iWrite);
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Write
+//
+// Copies data into the ring, across the wrap-around point if needed.
+// Called by the writer only.
+//
+// Returns S_FALSE if the ring could not take all of the data; the
+// rest is dropped and counted.
+//
+// pData: PCM data
+// cbData: Size of the data in bytes, partial blocks are dropped
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFPcmRing::Write(const BYTE* pData, DWORD cbData)
+{
+    if (!pData && (cbData > 0))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (!m_pData)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    DWORD cbCopy = GetWritable();
+
+    if (cbData < cbCopy)
+    {
+        cbCopy = cbData;
+    }
+
+    cbCopy -= cbCopy % m_nBlockAlign;
+
+    DWORD cbCopied = 0;
+
+    while (cbCopied < cbCopy)
+    {
+        DWORD iWrite = (DWORD)m_iWrite;
+        DWORD cbChunk = cbCopy - cbCopied;
+
+        if (cbChunk > m_cbCapacity - iWrite)
+        {
+            cbChunk = m_cbCapacity - iWrite;
+        }
+
+        memcpy(m_pData + iWrite, pData + cbCopied, cbChunk);
+
+        HRESULT hr = CommitWrite(cbChunk);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        cbCopied += cbChunk;
+    }
+
+    if (cbCopied < cbData)
+    {
+        m_cbDropped += cbData - cbCopied;
+        return S_FALSE;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetWritable
+//
+// Returns the number of free bytes, whole blocks.
+/////////////////////////////////////////////////////////////////////
+
+DWORD CASFPcmRing::GetWritable() const
+{
+    if (!m_pData)
+    {
+        return 0;
+    }
+
+    return m_cbCapacity - m_nBlockAlign - GetReadable();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetReadRegion
+//
+// Returns contiguous data without consuming it. Called by the reader
+// only.
+//
+// Returns S_FALSE, with no pointer, if there is no data at the offset.
+//
+// cbOffset: Number of readable bytes to skip, whole blocks. A reader
+//           that has data in flight passes the size of that data.
+// ppData: Receives a pointer to the data
+// pcbContiguous: Receives the size of the data up to the wrap-around
+//                point or the write position
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFPcmRing::GetReadRegion(DWORD cbOffset, const BYTE** ppData, DWORD* pcbContiguous) const
+{
+    if (!ppData || !pcbContiguous)
+    {
+        return E_POINTER;
+    }
+
+    *ppData = NULL;
+    *pcbContiguous = 0;
+
+    if (!m_pData)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    DWORD cbReadable = GetReadable();
+
+    if (cbOffset >= cbReadable)
+    {
+        return S_FALSE;
+    }
+
+    DWORD iRead = (DWORD)m_iRead + cbOffset;
+
+    if (iRead >= m_cbCapacity)
+    {
+        iRead -= m_cbCapacity;
+    }
+
+    *ppData = m_pData + iRead;
+    *pcbContiguous = cbReadable - cbOffset;
+
+    if (*pcbContiguous > m_cbCapacity - iRead)
+    {
+        *pcbContiguous = m_cbCapacity - iRead;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: CommitRead
+//
+// Frees data the reader is done with. Called by the reader only.
+//
+// cbData: Number of bytes consumed, whole blocks
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFPcmRing::CommitRead(DWORD cbData)
+{
+    if (!m_pData)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    if ((cbData % m_nBlockAlign != 0) || (cbData > GetReadable()))
+    {
+        return E_INVALIDARG;
+    }
+
+    DWORD iRead = (DWORD)m_iRead + cbData;
+
+    if (iRead >= m_cbCapacity)
+    {
+        iRead -= m_cbCapacity;
+    }
+
+    //The writer may reuse the space once it sees the new position
+    ASFStoreRelease(&m_iRead, iRead);
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetReadable
+//
+// Returns the number of bytes written and not yet consumed.
+/////////////////////////////////////////////////////////////////////
+
+DWORD CASFPcmRing::GetReadable() const
+{
+    if (!m_pData)
+    {
+        return 0;
+    }
+
+    //Each side sees its own position as it is and the other's through
+    //an acquiring load
+    DWORD iWrite = ASFLoadAcquire((volatile LONG*)&m_iWrite);
+    DWORD iRead = ASFLoadAcquire((volatile LONG*)&m_iRead);
+
+    return (iWrite >= iRead) ? (iWrite - iRead) : (m_cbCapacity - iRead + iWrite);
+}
@@ -0,0 +1,96 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFPcmRing.h : CASFPcmRing class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFTypes.h"
+
+//Largest ring the audio output allocates, 64 MB
+#define ASF_PCM_RING_MAX_SIZE   0x04000000
+
+//Fixed-capacity byte ring for decoded PCM audio, for exactly one
+//writer thread and one reader thread.
+//
+//The memory is allocated once, when the output format is known, and
+//is handed out in place on both sides: the writer asks for contiguous
+//free space, decodes into it and commits what it wrote; the reader
+//asks for contiguous data, plays it from where it lies and commits
+//what it consumed. Nothing is copied unless the writer has to fall
+//back to Write near the wrap-around point.
+//
+//Positions stay block aligned. One block is kept free so a full ring
+//can be told from an empty one.
+
+class CASFPcmRing
+{
+public:
+
+    CASFPcmRing();
+    ~CASFPcmRing();
+
+    HRESULT Initialize(DWORD cbCapacity, DWORD nBlockAlign);
+
+    //Empties the ring. Neither thread may be using it.
+    void Reset();
+
+    //Makes the first cbData bytes of the memory readable again, for data
+    //written after Reset without wrapping. Neither thread may be using it.
+    HRESULT Rewind(DWORD cbData);
+
+    //Writer
+    HRESULT BeginWrite(DWORD cbMin, BYTE** ppData, DWORD* pcbContiguous);
+
+    HRESULT CommitWrite(DWORD cbData);
+
+    HRESULT Write(const BYTE* pData, DWORD cbData);
+
+    DWORD GetWritable() const;
+
+    //Reader
+    HRESULT GetReadRegion(DWORD cbOffset, const BYTE** ppData, DWORD* pcbContiguous) const;
+
+    HRESULT CommitRead(DWORD cbData);
+
+    DWORD GetReadable() const;
+
+    DWORD GetCapacity() const
+    {
+        return (m_cbCapacity > 0) ? m_cbCapacity - m_nBlockAlign : 0;
+    }
+
+    DWORD GetBlockAlign() const
+    {
+        return m_nBlockAlign;
+    }
+
+    //Bytes that Write could not store because the ring was full
+    QWORD GetDroppedBytes() const
+    {
+        return m_cbDropped;
+    }
+
+private:
+
+    //Not copyable
+    CASFPcmRing(const CASFPcmRing&);
+    CASFPcmRing& operator=(const CASFPcmRing&);
+
+    BYTE*           m_pData;
+    DWORD           m_cbCapacity;       // Size of m_pData, a multiple of m_nBlockAlign
+    DWORD           m_nBlockAlign;
+
+    volatile LONG   m_iWrite;           // Offset in m_pData, written by the writer
+    volatile LONG   m_iRead;            // Offset in m_pData, written by the reader
+
+    QWORD           m_cbDropped;
+};
@@ -0,0 +1,300 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFRawDecoder.cpp : CASFRawDecoder class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include "ASFRawDecoder.h"
+
+///////////////////////////////////////////////////////////////////////
+//  Name: CreateInstance
+//  Description:  Creates a decoder for an uncompressed stream.
+//
+//  stream: Properties of the stream
+//  ppDecoder: Receives the decoder. The caller deletes it or hands it
+//             to a decoder pool.
+/////////////////////////////////////////////////////////////////////////
+
+HRESULT CASFRawDecoder::CreateInstance(const ASF_STREAM_PROPERTIES& stream, CASFRawDecoder** ppDecoder)
+{
+    if (!ppDecoder)
+    {
+        return E_POINTER;
+    }
+
+    CASFRawDecoder* pDecoder = new (std::nothrow) CASFRawDecoder();
+
+    if (!pDecoder)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    HRESULT hr = ReadFormat(stream, &pDecoder->m_Format, &pDecoder->m_wBitCount, &pDecoder->m_fBottomUp);
+
+    if (FAILED(hr))
+    {
+        delete pDecoder;
+        return hr;
+    }
+
+    if (pDecoder->m_Format.guidMajorType == ASF_Video_Media)
+    {
+        pDecoder->m_cbInputStride = ((pDecoder->m_Format.dwWidth * pDecoder->m_wBitCount + 31) / 32) * 4;
+    }
+
+    *ppDecoder = pDecoder;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: IsSupported
+//
+// Returns TRUE if the stream is PCM audio or uncompressed RGB video.
+/////////////////////////////////////////////////////////////////////
+
+BOOL CASFRawDecoder::IsSupported(const ASF_STREAM_PROPERTIES& stream)
+{
+    ASF_MEDIA_FORMAT format;
+    WORD wBitCount = 0;
+    BOOL fBottomUp = FALSE;
+
+    return SUCCEEDED(ReadFormat(stream, &format, &wBitCount, &fBottomUp));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFRawDecoder
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFRawDecoder::CASFRawDecoder()
+:   m_wBitCount (0),
+    m_fBottomUp (FALSE),
+    m_cbInputStride (0)
+{
+    memset(&m_Format, 0, sizeof(m_Format));
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetOutputFormat
+//
+// Returns the format of the decoded output.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFRawDecoder::GetOutputFormat(ASF_MEDIA_FORMAT* pFormat)
+{
+    if (!pFormat)
+    {
+        return E_POINTER;
+    }
+
+    *pFormat = m_Format;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Decode
+//
+// Audio samples are copied to the output as they are; partial audio
+// blocks at the end of a sample are dropped. A video sample must hold
+// a whole frame.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFRawDecoder::Decode(const ASF_DECODER_INPUT& input, IASFDecoderSink* pSink)
+{
+    if (!pSink || (!input.pData && (input.cbData > 0)))
+    {
+        return E_INVALIDARG;
+    }
+
+    BYTE* pOutput = NULL;
+    DWORD cbOutput = 0;
+
+    if (m_Format.guidMajorType == ASF_Audio_Media)
+    {
+        cbOutput = input.cbData - (input.cbData % m_Format.nBlockAlign);
+    }
+    else
+    {
+        if ((QWORD)input.cbData < (QWORD)m_cbInputStride * m_Format.dwHeight)
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        cbOutput = m_Format.cbMaxOutput;
+    }
+
+    if (cbOutput == 0)
+    {
+        return S_OK;
+    }
+
+    HRESULT hr = pSink->GetOutputBuffer(cbOutput, &pOutput);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (m_Format.guidMajorType == ASF_Audio_Media)
+    {
+        memcpy(pOutput, input.pData, cbOutput);
+    }
+    else
+    {
+        ConvertFrame(input.pData, pOutput);
+    }
+
+    return pSink->OnOutput(pOutput, cbOutput, input.hnsTime);
+}
+
+// ----- Private Methods -----------------------------------------------
+
+/////////////////////////////////////////////////////////////////////
+// Name: ReadFormat
+//
+// Reads the WAVEFORMATEX of an audio stream or the BITMAPINFOHEADER of
+// a video stream from the type-specific data. Fails with
+// MF_E_INVALIDMEDIATYPE for compressed formats.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFRawDecoder::ReadFormat(
+    const ASF_STREAM_PROPERTIES& stream,
+    ASF_MEDIA_FORMAT* pFormat,
+    WORD* pwBitCount,
+    BOOL* pfBottomUp
+    )
+{
+    const BYTE* pData = stream.pTypeSpecificData;
+    DWORD cbData = stream.cbTypeSpecificData;
+
+    memset(pFormat, 0, sizeof(ASF_MEDIA_FORMAT));
+
+    pFormat->guidMajorType = stream.guidStreamType;
+
+    if (stream.guidStreamType == ASF_Audio_Media)
+    {
+        if (!pData || (cbData < ASF_WAVEFORMATEX_SIZE))
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        if (ASFReadWord(pData) != ASF_WAVE_FORMAT_PCM)
+        {
+            return MF_E_INVALIDMEDIATYPE;
+        }
+
+        pFormat->nChannels = ASFReadWord(pData + 2);
+        pFormat->nSamplesPerSec = ASFReadDWord(pData + 4);
+        pFormat->nBlockAlign = ASFReadWord(pData + 12);
+        pFormat->wBitsPerSample = ASFReadWord(pData + 14);
+
+        if ((pFormat->nChannels == 0) || (pFormat->nBlockAlign == 0))
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        //One second of audio; samples are usually far shorter
+        QWORD cbSecond = (QWORD)pFormat->nSamplesPerSec * pFormat->nBlockAlign;
+
+        if (cbSecond > MAXDWORD)
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        pFormat->cbMaxOutput = (DWORD)cbSecond;
+
+        *pwBitCount = pFormat->wBitsPerSample;
+        *pfBottomUp = FALSE;
+
+        return S_OK;
+    }
+
+    if (stream.guidStreamType == ASF_Video_Media)
+    {
+        if (!pData || (cbData < ASF_VIDEO_FORMAT_DATA_OFFSET + ASF_BITMAPINFOHEADER_SIZE))
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        const BYTE* pHeader = pData + ASF_VIDEO_FORMAT_DATA_OFFSET;
+
+        LONG lWidth = (LONG)ASFReadDWord(pHeader + 4);
+        LONG lHeight = (LONG)ASFReadDWord(pHeader + 8);
+        WORD wBitCount = ASFReadWord(pHeader + 14);
+        DWORD dwCompression = ASFReadDWord(pHeader + 16);
+
+        if ((dwCompression != ASF_BI_RGB) || ((wBitCount != 24) && (wBitCount != 32)))
+        {
+            return MF_E_INVALIDMEDIATYPE;
+        }
+
+        if ((lWidth <= 0) || (lWidth > 0x8000) || (lHeight == 0) || (lHeight > 0x8000) || (lHeight < -0x8000))
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        pFormat->dwWidth = (DWORD)lWidth;
+        pFormat->dwHeight = (DWORD)((lHeight < 0) ? -lHeight : lHeight);
+
+        //A 0x8000 x 0x8000 frame is 4 GB, which a DWORD cannot hold
+        QWORD cbFrame = (QWORD)pFormat->dwWidth * 4 * pFormat->dwHeight;
+
+        if (cbFrame > MAXDWORD)
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        pFormat->lStride = (LONG)(pFormat->dwWidth * 4);
+        pFormat->cbMaxOutput = (DWORD)cbFrame;
+
+        *pwBitCount = wBitCount;
+        *pfBottomUp = (lHeight > 0);
+
+        return S_OK;
+    }
+
+    return MF_E_INVALIDMEDIATYPE;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ConvertFrame
+//
+// Converts a DIB frame to top-down RGB32.
+/////////////////////////////////////////////////////////////////////
+
+void CASFRawDecoder::ConvertFrame(const BYTE* pSource, BYTE* pDest) const
+{
+    DWORD cbOutputStride = m_Format.dwWidth * 4;
+
+    for (DWORD y = 0; y < m_Format.dwHeight; y++)
+    {
+        DWORD iSourceRow = m_fBottomUp ? (m_Format.dwHeight - 1 - y) : y;
+
+        const BYTE* pSourceRow = pSource + (QWORD)iSourceRow * m_cbInputStride;
+        BYTE* pDestRow = pDest + (QWORD)y * cbOutputStride;
+
+        if (m_wBitCount == 32)
+        {
+            memcpy(pDestRow, pSourceRow, cbOutputStride);
+            continue;
+        }
+
+        for (DWORD x = 0; x < m_Format.dwWidth; x++)
+        {
+            pDestRow[x * 4] = pSourceRow[x * 3];
+            pDestRow[x * 4 + 1] = pSourceRow[x * 3 + 1];
+            pDestRow[x * 4 + 2] = pSourceRow[x * 3 + 2];
+            pDestRow[x * 4 + 3] = 0xFF;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFRawDecoder.h : CASFRawDecoder class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFDecoder.h"
+#include "ASFHeaderParser.h"
+
+#define ASF_WAVE_FORMAT_PCM         1
+#define ASF_WAVEFORMATEX_SIZE       16      // Without cbSize
+#define ASF_VIDEO_FORMAT_DATA_OFFSET 11     // Encoded width, height, flags, format data size
+#define ASF_BITMAPINFOHEADER_SIZE   40
+#define ASF_BI_RGB                  0
+
+//Portable decoder for uncompressed streams: PCM audio is passed
+//through, 24-bit and 32-bit RGB video is converted to top-down RGB32.
+//The stream format comes from the ASF Stream Properties Object.
+
+class CASFRawDecoder : public IASFDecoder
+{
+public:
+
+    static HRESULT CreateInstance(const ASF_STREAM_PROPERTIES& stream, CASFRawDecoder** ppDecoder);
+
+    static BOOL IsSupported(const ASF_STREAM_PROPERTIES& stream);
+
+    // IASFDecoder methods
+    HRESULT Start()
+    {
+        return S_OK;
+    }
+
+    HRESULT Stop()
+    {
+        return S_OK;
+    }
+
+    HRESULT Flush()
+    {
+        return S_OK;
+    }
+
+    HRESULT GetOutputFormat(ASF_MEDIA_FORMAT* pFormat);
+
+    HRESULT Decode(const ASF_DECODER_INPUT& input, IASFDecoderSink* pSink);
+
+private:
+
+    CASFRawDecoder();
+
+    static HRESULT ReadFormat(
+        const ASF_STREAM_PROPERTIES& stream,
+        ASF_MEDIA_FORMAT* pFormat,
+        WORD* pwBitCount,
+        BOOL* pfBottomUp
+        );
+
+    void ConvertFrame(const BYTE* pSource, BYTE* pDest) const;
+
+    ASF_MEDIA_FORMAT    m_Format;
+    WORD                m_wBitCount;        // Video input bits per pixel
+    BOOL                m_fBottomUp;        // Video input rows are stored bottom-up
+    DWORD               m_cbInputStride;    // Video input bytes per row
+};
@@ -0,0 +1,999 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFReader.cpp : CASFReader class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include <string.h>
+#include "ASFReader.h"
+#include "ASFIndexBuilder.h"
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFReader
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFReader::CASFReader()
+:   m_pDecoder (NULL),
+    m_pDecoderSink (NULL),
+    m_fGenerating (FALSE),
+    m_cbGenerateOffset (0),
+    m_cbGenerateRemaining (0),
+    m_cbGenerateTotal (0),
+    m_wStreamNumber (0),
+    m_dwFlags (0),
+    m_hnsEndTime (0),
+    m_pCallback (NULL),
+    m_fDiscontinuity (FALSE),
+    m_fEnded (FALSE),
+    m_pView (NULL),
+    m_cbView (0),
+    m_cbViewFileOffset (0),
+    m_cbViewPos (0),
+    m_fPacketOpen (FALSE),
+    m_cbPacketOffset (0),
+    m_pObjectBuffer (NULL),
+    m_pAllocator (NULL),
+    m_pObjectData (NULL),
+    m_cbObjectCapacity (0)
+{
+    memset(&m_Object, 0, sizeof(m_Object));
+    memset(&m_KeyFrameFilterStats, 0, sizeof(m_KeyFrameFilterStats));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFReader
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFReader::~CASFReader()
+{
+    Close();
+
+    delete [] m_pObjectData;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Open
+//
+// Maps a file, parses the Header Object in place and reads the index
+// objects that follow the Data Object. A file without usable index
+// objects can still be seeked exactly; LoadOrBuildIndex adds an index.
+//
+// sFileName: Path name of the file
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFReader::Open(const ASF_PATH_CHAR* sFileName)
+{
+    if (!sFileName)
+    {
+        return E_POINTER;
+    }
+
+    Close();
+
+    HRESULT hr = m_MappedFile.Open(sFileName);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    // The span includes the Data Object header that follows the header.
+    hr = m_HeaderParser.Parse(m_MappedFile.GetData(), m_MappedFile.GetSize());
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    if ((m_HeaderParser.GetDataOffset() == 0) ||
+        (m_HeaderParser.GetDataOffset() > m_MappedFile.GetSize()))
+    {
+        hr = MF_E_ASF_PARSINGINCOMPLETE;
+        goto done;
+    }
+
+    hr = m_HeaderParser.GetFileProperties(&m_FileInfo);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    // Packet boundaries are computed, not parsed, so the native demux
+    // needs fixed-size packets.
+    if ((m_FileInfo.cbMinPacketSize != m_FileInfo.cbMaxPacketSize) || (m_FileInfo.cbMaxPacketSize == 0))
+    {
+        hr = MF_E_INVALID_FILE_FORMAT;
+        goto done;
+    }
+
+    hr = m_PacketParser.Initialize(m_FileInfo.cbMaxPacketSize);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = m_ReadPlanner.Initialize(m_FileInfo.cbMinPacketSize, m_FileInfo.cbMaxPacketSize);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = m_SeekEngine.Initialize(
+        m_MappedFile.GetData() + m_HeaderParser.GetDataOffset(),
+        GetPacketCount(),
+        m_PacketParser.GetPacketSize(),
+        m_FileInfo.hnspreroll / 10000
+        );
+
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    // A damaged index only costs the fast seeks.
+    (void)LoadIndex();
+
+done:
+    if (FAILED(hr))
+    {
+        Close();
+    }
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Close
+//
+// Releases the file and everything parsed from it. The reassembly
+// buffer is kept for the next file.
+/////////////////////////////////////////////////////////////////////
+
+void CASFReader::Close()
+{
+    m_Scanner.Reset();
+
+    for (DWORD i = 0; i < ASF_MAX_STREAMS; i++)
+    {
+        m_Timelines[i].Reset();
+    }
+
+    m_IndexReader.Reset();
+    m_HeaderParser.Reset();
+    m_MappedFile.Close();
+
+    m_FileInfo = FILE_PROPERTIES_OBJECT();
+    m_PacketParser = CASFPacketParser();
+    m_SeekEngine = CASFSeekEngine();
+
+    EndGenerate();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: LoadOrBuildIndex
+//
+// Loads the index sidecar of the file. If there is none, or it was
+// written for another version of the file, a key frame index is built
+// in one pass over the mapped packets and saved as the new sidecar.
+// Files with index objects keep them. Returns S_FALSE if the sidecar
+// could not be written; the index is kept in memory either way.
+//
+// sSidecarName: Path name of the sidecar, or NULL to build the index
+//               without loading or saving a sidecar.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFReader::LoadOrBuildIndex(const ASF_PATH_CHAR* sSidecarName)
+{
+    if (!m_MappedFile.IsMapped())
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    if (!m_IndexReader.IsEmpty())
+    {
+        return S_OK;
+    }
+
+    CASFIndexBuilder builder;
+
+    return builder.LoadOrBuild(
+        sSidecarName,
+        m_FileInfo.guidFileID,
+        m_HeaderParser.GetDataLength(),
+        m_MappedFile.GetData() + m_HeaderParser.GetDataOffset(),
+        GetPacketCount(),
+        m_PacketParser.GetPacketSize(),
+        (DWORD)(m_FileInfo.hnspreroll / 10000),
+        &m_IndexReader
+        );
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Seek
+//
+// Gets the offset of the packet to start reading at for a stream and
+// a presentation time. Indexed streams are looked up in the index;
+// the others are found with the exact packet search.
+//
+// wStreamNumber: Stream to seek
+// hnsTime: Presentation time in hns, without the preroll.
+// pcbDataOffset: Receives the offset from the start of the first data
+//                packet, a whole number of packets.
+// phnsApproxTime: Receives the time of the index entry, or hnsTime if
+//                 the packet search was used. May be NULL.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFReader::Seek(
+    WORD wStreamNumber,
+    MFTIME hnsTime,
+    QWORD* pcbDataOffset,
+    MFTIME* phnsApproxTime
+    )
+{
+    if (!pcbDataOffset)
+    {
+        return E_POINTER;
+    }
+
+    if (!m_MappedFile.IsMapped())
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    DWORD cbPacketSize = m_PacketParser.GetPacketSize();
+    QWORD cbData = GetPacketCount() * cbPacketSize;
+    QWORD iPacket = 0;
+
+    if (m_IndexReader.HasIndex(wStreamNumber) &&
+        SUCCEEDED(m_IndexReader.FindSeekPoint(wStreamNumber, hnsTime, cbData, cbPacketSize, pcbDataOffset, NULL, phnsApproxTime)))
+    {
+        return S_OK;
+    }
+
+    HRESULT hr = m_SeekEngine.FindPacketAtTime(hnsTime, wStreamNumber, &iPacket, NULL);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    *pcbDataOffset = iPacket * cbPacketSize;
+
+    if (phnsApproxTime)
+    {
+        *phnsApproxTime = (hnsTime > 0) ? hnsTime : 0;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GenerateSamples
+//
+// Seeks a stream and hands out its media objects in file order, from
+// the seek position until an object is presented at or after the end
+// time or the Data Object ends. The samples go to the decoder set
+// with SetDecoder, if any, and then to the callback.
+//
+// The parameters are those of BeginGenerate.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFReader::GenerateSamples(
+    WORD wStreamNumber,
+    MFTIME hnsStartTime,
+    MFTIME hnsDuration,
+    DWORD dwFlags,
+    IASFReaderCallback* pCallback
+    )
+{
+    BOOL fComplete = FALSE;
+
+    HRESULT hr = BeginGenerate(wStreamNumber, hnsStartTime, hnsDuration, dwFlags, pCallback);
+
+    while (SUCCEEDED(hr) && !fComplete)
+    {
+        hr = GenerateNext(&fComplete);
+    }
+
+    EndGenerate();
+
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: BeginGenerate
+//
+// Seeks a stream and prepares a generation. The samples are then
+// pushed by GenerateNext, one read at a time, or pulled one at a time
+// by ReadSample. A reader runs one generation at a time.
+//
+// wStreamNumber: Stream to read
+// hnsStartTime: Seek time in hns, without the preroll.
+// hnsDuration: Time to read after the start time, 0 to read to the end
+// dwFlags: ASF_READER_* flags
+// pCallback: Receives the samples pushed by GenerateNext. May be NULL
+//            if a decoder is set or the samples are pulled.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFReader::BeginGenerate(
+    WORD wStreamNumber,
+    MFTIME hnsStartTime,
+    MFTIME hnsDuration,
+    DWORD dwFlags,
+    IASFReaderCallback* pCallback
+    )
+{
+    if (!m_MappedFile.IsMapped())
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    if (m_fGenerating)
+    {
+        return MF_E_INVALIDREQUEST;
+    }
+
+    const ASF_STREAM_PROPERTIES* pStream = NULL;
+
+    HRESULT hr = m_HeaderParser.GetStreamByNumber(wStreamNumber, &pStream);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    QWORD cbStartOffset = 0;
+
+    hr = Seek(wStreamNumber, hnsStartTime, &cbStartOffset, NULL);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    m_cbGenerateOffset = m_HeaderParser.GetDataOffset() + cbStartOffset;
+    m_cbGenerateRemaining = GetPacketCount() * m_PacketParser.GetPacketSize() - cbStartOffset;
+    m_cbGenerateTotal = m_cbGenerateRemaining;
+
+    m_wStreamNumber = wStreamNumber;
+    m_dwFlags = dwFlags;
+    m_hnsEndTime = (hnsDuration > 0) ? hnsStartTime + hnsDuration : 0x7FFFFFFFFFFFFFFFLL;
+    m_pCallback = pCallback;
+    m_fDiscontinuity = TRUE;
+    m_fEnded = FALSE;
+    m_fGenerating = TRUE;
+
+    m_pView = NULL;
+    m_cbView = 0;
+    m_cbViewPos = 0;
+    m_fPacketOpen = FALSE;
+    m_ObjectAssembler.Reset();
+
+    m_Object.hnsTime = 0;
+
+    // Every call starts a new scan from the seek position.
+    m_ReadPlanner.ResetStats();
+    m_ReadPlanner.OnSeek();
+
+    memset(&m_KeyFrameFilterStats, 0, sizeof(m_KeyFrameFilterStats));
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GenerateNext
+//
+// Pushes the samples of the next read of the generation to the
+// decoder and the callback.
+//
+// pfComplete: Set to TRUE when the generation is done.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFReader::GenerateNext(BOOL* pfComplete)
+{
+    if (!pfComplete)
+    {
+        return E_POINTER;
+    }
+
+    if (!m_fGenerating)
+    {
+        return MF_E_INVALIDREQUEST;
+    }
+
+    if (!m_pCallback && !(m_pDecoder && m_pDecoderSink))
+    {
+        return E_INVALIDARG;
+    }
+
+    *pfComplete = FALSE;
+
+    HRESULT hr = S_OK;
+
+    if (!m_pView)
+    {
+        hr = ReadNextView();
+        if (hr != S_OK)
+        {
+            *pfComplete = TRUE;
+            return SUCCEEDED(hr) ? S_OK : hr;
+        }
+    }
+
+    while (!(*pfComplete))
+    {
+        hr = ParseNextObject();
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        if (hr == S_FALSE)
+        {
+            // The read is used up
+            break;
+        }
+
+        hr = DeliverObject(pfComplete);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+    }
+
+    if (m_fEnded || (!m_pView && (m_cbGenerateRemaining == 0)))
+    {
+        *pfComplete = TRUE;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ReadSample
+//
+// Pulls the next sample of the generation. Reads are only made when
+// the packets already read hold no further sample. The data of the
+// sample stays valid while the file is open if it lies in the
+// mapping; otherwise until the assembly memory is reused, see
+// SetObjectAllocator. The decoder and the callback are not used.
+//
+// pSample: Receives the sample
+//
+// Returns S_FALSE, with no sample, at the end of the generation.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFReader::ReadSample(ASF_READER_SAMPLE* pSample)
+{
+    if (!pSample)
+    {
+        return E_POINTER;
+    }
+
+    if (!m_fGenerating)
+    {
+        return MF_E_INVALIDREQUEST;
+    }
+
+    for (;;)
+    {
+        HRESULT hr = ParseNextObject();
+
+        if (hr == S_OK)
+        {
+            *pSample = m_Object;
+            return S_OK;
+        }
+
+        if (FAILED(hr) || m_fEnded)
+        {
+            return hr;
+        }
+
+        hr = ReadNextView();
+        if (hr != S_OK)
+        {
+            return hr;
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: EndGenerate
+//
+// Ends the generation, finished or not. The statistics are kept.
+/////////////////////////////////////////////////////////////////////
+
+void CASFReader::EndGenerate()
+{
+    m_pCallback = NULL;
+    m_pView = NULL;
+    m_fPacketOpen = FALSE;
+    m_ObjectAssembler.Reset();
+    m_fGenerating = FALSE;
+    m_cbGenerateRemaining = 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetGenerateProgress
+//
+// Returns the progress of the current or last generation. Called on
+// the thread that runs it.
+/////////////////////////////////////////////////////////////////////
+
+void CASFReader::GetGenerateProgress(ASF_GENERATE_PROGRESS* pProgress) const
+{
+    pProgress->cSamples = m_KeyFrameFilterStats.cObjectsDelivered;
+    pProgress->cbDelivered = m_KeyFrameFilterStats.cbDelivered;
+    pProgress->cbRead = m_cbGenerateTotal - m_cbGenerateRemaining;
+    pProgress->cbTotal = m_cbGenerateTotal;
+    pProgress->hnsLastTime = m_Object.hnsTime;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ScanSamples
+//
+// Builds the sample timelines of every stream on worker threads.
+//
+// cThreads: Number of scan threads, 0 for one per processor
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFReader::ScanSamples(DWORD cThreads)
+{
+    if (!m_MappedFile.IsMapped())
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    return m_Scanner.Scan(
+        m_MappedFile.GetData() + m_HeaderParser.GetDataOffset(),
+        GetPacketCount(),
+        m_PacketParser.GetPacketSize(),
+        m_HeaderParser.GetDataOffset(),
+        cThreads
+        );
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: BuildTimelines
+//
+// Builds the sample timelines of every stream on worker threads and
+// packs each one into a CASFTimeline, for random access by index or
+// time without seeking and parsing again.
+//
+// cThreads: Number of scan threads, 0 for one per processor
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFReader::BuildTimelines(DWORD cThreads)
+{
+    for (DWORD i = 0; i < ASF_MAX_STREAMS; i++)
+    {
+        m_Timelines[i].Reset();
+    }
+
+    HRESULT hr = ScanSamples(cThreads);
+
+    for (WORD wStream = 1; SUCCEEDED(hr) && (wStream < ASF_MAX_STREAMS); wStream++)
+    {
+        const ASF_SAMPLE_DESCRIPTOR* pSamples = NULL;
+        DWORD cSamples = 0;
+
+        hr = m_Scanner.GetSamples(wStream, &pSamples, &cSamples);
+
+        if (SUCCEEDED(hr) && (cSamples > 0))
+        {
+            hr = m_Timelines[wStream].Build(
+                pSamples,
+                cSamples,
+                m_HeaderParser.GetDataOffset(),
+                m_PacketParser.GetPacketSize(),
+                m_FileInfo.hnspreroll
+                );
+        }
+    }
+
+    // The descriptors take three times the memory of the timelines
+    m_Scanner.Reset();
+
+    if (FAILED(hr))
+    {
+        for (DWORD i = 0; i < ASF_MAX_STREAMS; i++)
+        {
+            m_Timelines[i].Reset();
+        }
+    }
+
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetTimeline
+//
+// Returns the timeline of a stream. A stream without samples, or a
+// reader without timelines, has an empty one.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFReader::GetTimeline(WORD wStreamNumber, const CASFTimeline** ppTimeline) const
+{
+    if (!ppTimeline)
+    {
+        return E_POINTER;
+    }
+
+    if (wStreamNumber >= ASF_MAX_STREAMS)
+    {
+        return MF_E_INVALIDSTREAMNUMBER;
+    }
+
+    *ppTimeline = &m_Timelines[wStreamNumber];
+
+    return S_OK;
+}
+
+// ----- Private Methods -----------------------------------------------
+
+/////////////////////////////////////////////////////////////////////
+// Name: LoadIndex
+//
+// Reads the Simple Index Objects and the Index Object that follow the
+// Data Object, in place.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFReader::LoadIndex()
+{
+    WORD rgwVideoStreams[ASF_MAX_STREAMS];
+    const BYTE* pIndexData = NULL;
+
+    QWORD cbIndexOffset = m_HeaderParser.GetDataOffset() + m_HeaderParser.GetDataLength();
+
+    m_IndexReader.Reset();
+
+    if (cbIndexOffset >= m_MappedFile.GetSize())
+    {
+        // No objects after the data object.
+        return S_OK;
+    }
+
+    DWORD cVideoStreams = m_HeaderParser.GetVideoStreams(rgwVideoStreams);
+    QWORD cbIndex = m_MappedFile.GetSize() - cbIndexOffset;
+
+    HRESULT hr = m_MappedFile.GetView(cbIndexOffset, cbIndex, &pIndexData);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    return m_IndexReader.Parse(
+        pIndexData,
+        cbIndex,
+        m_PacketParser.GetPacketSize(),
+        rgwVideoStreams,
+        cVideoStreams
+        );
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ReadNextView
+//
+// Maps the next packet-aligned read of the generation, sized by the
+// read planner.
+//
+// Returns S_FALSE, and ends the generation, if the Data Object is
+// used up.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFReader::ReadNextView()
+{
+    if (m_cbGenerateRemaining == 0)
+    {
+        m_fEnded = TRUE;
+        return S_FALSE;
+    }
+
+    DWORD cbRead = m_ReadPlanner.GetNextReadSize(m_cbGenerateRemaining);
+
+    HRESULT hr = m_MappedFile.GetView(m_cbGenerateOffset, cbRead, &m_pView);
+    if (FAILED(hr))
+    {
+        m_pView = NULL;
+        return hr;
+    }
+
+    m_cbView = cbRead;
+    m_cbViewFileOffset = m_cbGenerateOffset;
+    m_cbViewPos = 0;
+
+    m_cbGenerateOffset += cbRead;
+    m_cbGenerateRemaining -= cbRead;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ParseNextObject
+//
+// Parses the current read from where the last call stopped until a
+// media object of the selected stream is complete in m_Object. The
+// packet parser keeps its place between calls, so parsing stops after
+// any payload.
+//
+// Returns S_FALSE when the read is used up, or the generation ended
+// on an object at or after the end time.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFReader::ParseNextObject()
+{
+    HRESULT hr = S_OK;
+
+    ASF_PAYLOAD_INFO payload;
+
+    DWORD cbPacketSize = m_PacketParser.GetPacketSize();
+    BOOL fKeyFramesOnly = ((m_dwFlags & ASF_READER_KEY_FRAMES_ONLY) != 0);
+
+    if (m_fEnded)
+    {
+        return S_FALSE;
+    }
+
+    for (;;)
+    {
+        if (m_fPacketOpen)
+        {
+            hr = m_PacketParser.GetNextPayload(&payload);
+
+            if (hr == S_OK)
+            {
+                if (payload.bStreamNumber != m_wStreamNumber)
+                {
+                    continue;
+                }
+
+                // In key frame mode, payloads of other objects are dropped on
+                // their header, without a copy.
+                if (!payload.fKeyFrame && fKeyFramesOnly)
+                {
+                    CASFObjectAssembler::SkipPayload(payload, &m_KeyFrameFilterStats);
+                    continue;
+                }
+
+                BOOL fReady = FALSE;
+
+                hr = AddPayloadToObject(payload, &fReady);
+                if (FAILED(hr))
+                {
+                    return hr;
+                }
+
+                if (!fReady)
+                {
+                    continue;
+                }
+
+                if (m_Object.hnsTime >= m_hnsEndTime)
+                {
+                    m_fEnded = TRUE;
+                    return S_FALSE;
+                }
+
+                m_KeyFrameFilterStats.cbDelivered += m_Object.cbData;
+                m_KeyFrameFilterStats.cObjectsDelivered++;
+
+                return S_OK;
+            }
+
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+
+            m_fPacketOpen = FALSE;
+        }
+
+        if (!m_pView)
+        {
+            return S_FALSE;
+        }
+
+        if (m_cbViewPos + cbPacketSize > m_cbView)
+        {
+            m_ReadPlanner.OnReadComplete(m_cbView);
+            m_pView = NULL;
+            return S_FALSE;
+        }
+
+        hr = m_PacketParser.ParsePacket(m_pView + m_cbViewPos, cbPacketSize, NULL);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        m_cbPacketOffset = m_cbViewFileOffset + m_cbViewPos;
+        m_cbViewPos += cbPacketSize;
+        m_fPacketOpen = TRUE;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: AddPayloadToObject
+//
+// Appends a payload to the media object being assembled, where
+// CASFObjectAssembler places it. An object in a single payload is used
+// in place; the others are assembled in memory from the object
+// allocator, or from the reader. Fragments of objects whose start was
+// not seen (e.g. right after a seek) are dropped.
+//
+// payload: Payload of the selected stream
+// pfReady: Set to TRUE when m_Object holds a complete object.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFReader::AddPayloadToObject(const ASF_PAYLOAD_INFO& payload, BOOL* pfReady)
+{
+    BOOL fStart = FALSE, fComplete = FALSE;
+
+    *pfReady = FALSE;
+
+    HRESULT hr = m_ObjectAssembler.AddPayload(payload, &fStart, &fComplete);
+    if (hr != S_OK)
+    {
+        // S_FALSE drops a fragment of an object we cannot complete
+        return SUCCEEDED(hr) ? S_OK : hr;
+    }
+
+    if (fStart)
+    {
+        MFTIME hnsTime = (MFTIME)payload.dwPresentationTime * 10000 - (MFTIME)m_FileInfo.hnspreroll;
+
+        m_Object.wStreamNumber = payload.bStreamNumber;
+        m_Object.dwMediaObjectNumber = payload.dwMediaObjectNumber;
+        m_Object.hnsTime = (hnsTime > 0) ? hnsTime : 0;
+        m_Object.fKeyFrame = payload.fKeyFrame;
+        m_Object.cbPacketOffset = m_cbPacketOffset;
+
+        // An object in a single payload is used in place
+        if (fComplete)
+        {
+            m_Object.pData = payload.pData;
+            m_Object.cbData = payload.cbData;
+
+            *pfReady = TRUE;
+            return S_OK;
+        }
+
+        if (m_ObjectAssembler.GetObjectSize() > ASF_READER_MAX_OBJECT_SIZE)
+        {
+            m_ObjectAssembler.Reset();
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        hr = GetObjectBuffer(m_ObjectAssembler.GetObjectSize(), &m_pObjectBuffer);
+        if (FAILED(hr))
+        {
+            m_ObjectAssembler.Reset();
+            return hr;
+        }
+    }
+
+    memcpy(m_pObjectBuffer + m_ObjectAssembler.GetPayloadOffset(), payload.pData, payload.cbData);
+
+    if (fComplete)
+    {
+        m_Object.pData = m_pObjectBuffer;
+        m_Object.cbData = m_ObjectAssembler.GetObjectSize();
+
+        *pfReady = TRUE;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetObjectBuffer
+//
+// Returns memory to assemble an object in: from the object allocator
+// if one is set, otherwise the reader's own buffer, which grows to the
+// largest object and is reused for every object.
+//
+// cbObject: Size of the object in bytes
+// ppBuffer: Receives the memory
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFReader::GetObjectBuffer(DWORD cbObject, BYTE** ppBuffer)
+{
+    if (m_pAllocator)
+    {
+        return m_pAllocator->GetObjectBuffer(cbObject, ppBuffer);
+    }
+
+    if (cbObject > m_cbObjectCapacity)
+    {
+        BYTE* pData = new (std::nothrow) BYTE[cbObject];
+
+        if (!pData)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        delete [] m_pObjectData;
+
+        m_pObjectData = pData;
+        m_cbObjectCapacity = cbObject;
+    }
+
+    *ppBuffer = m_pObjectData;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: DeliverObject
+//
+// Pushes the object in m_Object to the decoder and the callback.
+//
+// pbComplete: Set to TRUE if the callback ends the generation.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFReader::DeliverObject(BOOL* pbComplete)
+{
+    HRESULT hr = S_OK;
+
+    if (m_pDecoder && m_pDecoderSink)
+    {
+        ASF_DECODER_INPUT input;
+
+        input.pData = m_Object.pData;
+        input.cbData = m_Object.cbData;
+        input.hnsTime = m_Object.hnsTime;
+        input.hnsDuration = 0;
+        input.fKeyFrame = m_Object.fKeyFrame;
+        input.fDiscontinuity = m_fDiscontinuity;
+        input.pContext = NULL;
+
+        m_fDiscontinuity = FALSE;
+
+        hr = m_pDecoder->Decode(input, m_pDecoderSink);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+    }
+
+    if (m_pCallback)
+    {
+        hr = m_pCallback->OnSample(m_Object);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        if (hr == S_FALSE)
+        {
+            *pbComplete = TRUE;
+        }
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetPacketCount
+//
+// Returns the number of whole packets of the Data Object that are in
+// the file. The data object size is not trusted beyond the file end.
+/////////////////////////////////////////////////////////////////////
+
+QWORD CASFReader::GetPacketCount() const
+{
+    return ASFGetPacketCount(
+        m_MappedFile.GetSize(),
+        m_HeaderParser.GetDataOffset(),
+        m_HeaderParser.GetDataLength(),
+        m_PacketParser.GetPacketSize()
+        );
+}
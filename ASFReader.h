@@ -0,0 +1,280 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFReader.h : CASFReader class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+#include "ASFHeaderParser.h"
+#include "ASFPacketParser.h"
+#include "ASFObjectAssembler.h"
+#include "ASFIndexReader.h"
+#include "ASFSeekEngine.h"
+#include "ASFParallelScanner.h"
+#include "ASFTimeline.h"
+#include "ASFDecoder.h"
+#include "ReadPlanner.h"
+
+//GenerateSamples flags
+#define ASF_READER_KEY_FRAMES_ONLY      0x00000001  // Drop non-key objects on their payload headers
+
+//Largest media object that is reassembled, 64 MB
+#define ASF_READER_MAX_OBJECT_SIZE      0x04000000
+
+//Progress of a generation
+struct ASF_GENERATE_PROGRESS
+{
+    QWORD   cSamples;           // Objects delivered
+    QWORD   cbDelivered;
+    QWORD   cbRead;             // Data read from the seek position on
+    QWORD   cbTotal;            // Data from the seek position to the end of the Data Object
+    MFTIME  hnsLastTime;        // Presentation time of the last object
+};
+
+//A complete media object of the selected stream. The data is valid
+//until the callback returns, or until the next ReadSample call.
+
+struct ASF_READER_SAMPLE
+{
+    WORD        wStreamNumber;
+    DWORD       dwMediaObjectNumber;
+    MFTIME      hnsTime;            // Presentation time without the preroll
+    BOOL        fKeyFrame;
+    QWORD       cbPacketOffset;     // File offset of the packet that starts the object
+    const BYTE* pData;
+    DWORD       cbData;
+};
+
+
+//Receives the samples of CASFReader::GenerateSamples
+
+class IASFReaderCallback
+{
+public:
+
+    virtual ~IASFReaderCallback() {}
+
+    //Returns S_FALSE to end the generation early, or a failure to abort it
+    virtual HRESULT OnSample(const ASF_READER_SAMPLE& sample) = 0;
+};
+
+
+//Provides the memory media objects in several payloads are assembled
+//in. Objects in one payload are handed out in the mapping instead.
+
+class IASFObjectAllocator
+{
+public:
+
+    virtual ~IASFObjectAllocator() {}
+
+    //Returns at least cbObject bytes that stay untouched by the reader
+    //once the object is handed out
+    virtual HRESULT GetObjectBuffer(DWORD cbObject, BYTE** ppBuffer) = 0;
+};
+
+
+//Headless access to an ASF file with the native components only: no
+//Media Foundation objects, windows, GDI+ or audio devices, so it builds
+//into the core library on every platform.
+//
+//The file is mapped and parsed in place. Seeks use the index objects
+//of the file, or an index sidecar, and fall back to the exact packet
+//search. GenerateSamples demuxes forward from a seek position in
+//packet-aligned reads planned by CReadPlanner and hands out whole media
+//objects; an object that fits in one payload is handed out where it
+//lies in the mapping, others are reassembled in one buffer that is
+//reused for the whole call. ReadSample pulls the same objects one at a
+//time instead, reading only when the packets read so far hold no
+//further object (see CASFSampleIterator). Requires fixed-size data
+//packets.
+
+class CASFReader
+{
+public:
+
+    CASFReader();
+    ~CASFReader();
+
+    HRESULT Open(const ASF_PATH_CHAR* sFileName);
+
+    void Close();
+
+    //Loads the index sidecar of a file without index objects, or builds
+    //the index and saves it as the sidecar. NULL builds it in memory.
+    HRESULT LoadOrBuildIndex(const ASF_PATH_CHAR* sSidecarName);
+
+    HRESULT GetFileProperties(FILE_PROPERTIES_OBJECT* pFileInfo) const
+    {
+        return m_HeaderParser.GetFileProperties(pFileInfo);
+    }
+
+    DWORD GetStreamCount() const
+    {
+        return m_HeaderParser.GetStreamCount();
+    }
+
+    HRESULT GetStream(DWORD dwIndex, const ASF_STREAM_PROPERTIES** ppStream) const
+    {
+        return m_HeaderParser.GetStream(dwIndex, ppStream);
+    }
+
+    HRESULT Seek(
+        WORD wStreamNumber,
+        MFTIME hnsTime,
+        QWORD* pcbDataOffset,
+        MFTIME* phnsApproxTime
+        );
+
+    //Decoded output goes to pSink; NULL detaches the decoder
+    void SetDecoder(IASFDecoder* pDecoder, IASFDecoderSink* pSink)
+    {
+        m_pDecoder = pDecoder;
+        m_pDecoderSink = pSink;
+    }
+
+    HRESULT GenerateSamples(
+        WORD wStreamNumber,
+        MFTIME hnsStartTime,
+        MFTIME hnsDuration,
+        DWORD dwFlags,
+        IASFReaderCallback* pCallback
+        );
+
+    //GenerateSamples in steps of one read, for callers that interleave
+    //several generations (see CASFGenerateRequest)
+    HRESULT BeginGenerate(
+        WORD wStreamNumber,
+        MFTIME hnsStartTime,
+        MFTIME hnsDuration,
+        DWORD dwFlags,
+        IASFReaderCallback* pCallback
+        );
+
+    HRESULT GenerateNext(BOOL* pfComplete);
+
+    //Pulls the next sample of the generation; S_FALSE at the end
+    HRESULT ReadSample(ASF_READER_SAMPLE* pSample);
+
+    void EndGenerate();
+
+    //Objects in several payloads are assembled in memory from pAllocator
+    //instead of the reader's buffer; NULL restores the buffer
+    void SetObjectAllocator(IASFObjectAllocator* pAllocator)
+    {
+        m_pAllocator = pAllocator;
+    }
+
+    void GetGenerateProgress(ASF_GENERATE_PROGRESS* pProgress) const;
+
+    HRESULT ScanSamples(DWORD cThreads);
+
+    HRESULT GetScannedSamples(
+        WORD wStreamNumber,
+        const ASF_SAMPLE_DESCRIPTOR** ppSamples,
+        DWORD* pcSamples
+        ) const
+    {
+        return m_Scanner.GetSamples(wStreamNumber, ppSamples, pcSamples);
+    }
+
+    //Scans the file and packs the samples of every stream into a
+    //timeline. The scan results are released afterwards.
+    HRESULT BuildTimelines(DWORD cThreads);
+
+    //Timeline of a stream from BuildTimelines, valid until the next
+    //call or Close
+    HRESULT GetTimeline(WORD wStreamNumber, const CASFTimeline** ppTimeline) const;
+
+    //Reads of the last GenerateSamples call
+    void GetReadStats(READ_PLANNER_STATS* pStats) const
+    {
+        m_ReadPlanner.GetStats(pStats);
+    }
+
+    void GetKeyFrameFilterStats(KEY_FRAME_FILTER_STATS* pStats) const
+    {
+        *pStats = m_KeyFrameFilterStats;
+    }
+
+    //Packet headers read by the last exact seek
+    DWORD GetSeekPacketReads() const
+    {
+        return m_SeekEngine.GetPacketReadCount();
+    }
+
+protected:
+
+    HRESULT LoadIndex();
+
+    HRESULT ReadNextView();
+
+    HRESULT ParseNextObject();
+
+    HRESULT AddPayloadToObject(const ASF_PAYLOAD_INFO& payload, BOOL* pfReady);
+
+    HRESULT GetObjectBuffer(DWORD cbObject, BYTE** ppBuffer);
+
+    HRESULT DeliverObject(BOOL* pbComplete);
+
+    QWORD GetPacketCount() const;
+
+private:
+
+    //Not copyable
+    CASFReader(const CASFReader&);
+    CASFReader& operator=(const CASFReader&);
+
+    CMappedFile         m_MappedFile;
+    CASFHeaderParser    m_HeaderParser;     // References the mapped header
+    FILE_PROPERTIES_OBJECT  m_FileInfo;
+
+    CASFPacketParser    m_PacketParser;
+    CASFIndexReader     m_IndexReader;
+    CASFSeekEngine      m_SeekEngine;
+    CASFParallelScanner m_Scanner;
+    CASFTimeline        m_Timelines[ASF_MAX_STREAMS];   // Indexed by stream number
+    CReadPlanner        m_ReadPlanner;
+
+    IASFDecoder*        m_pDecoder;         // Not owned
+    IASFDecoderSink*    m_pDecoderSink;
+
+    //Generation in progress
+    BOOL                m_fGenerating;
+    QWORD               m_cbGenerateOffset;     // File offset of the next read
+    QWORD               m_cbGenerateRemaining;
+    QWORD               m_cbGenerateTotal;
+    WORD                m_wStreamNumber;
+    DWORD               m_dwFlags;
+    MFTIME              m_hnsEndTime;       // Objects presented from here on end the call
+    IASFReaderCallback* m_pCallback;
+    BOOL                m_fDiscontinuity;   // Next decoder input follows a seek
+    BOOL                m_fEnded;           // End time or end of the Data Object reached
+
+    //Read being parsed
+    const BYTE*         m_pView;            // NULL once parsed to the end
+    DWORD               m_cbView;
+    QWORD               m_cbViewFileOffset;
+    DWORD               m_cbViewPos;        // Offset of the next packet in the view
+    BOOL                m_fPacketOpen;      // The packet parser has payloads left
+    QWORD               m_cbPacketOffset;   // File offset of the open packet
+
+    //Media object being assembled
+    ASF_READER_SAMPLE   m_Object;
+    CASFObjectAssembler m_ObjectAssembler;
+    BYTE*               m_pObjectBuffer;    // Where the object is assembled
+    IASFObjectAllocator* m_pAllocator;      // Not owned
+    BYTE*               m_pObjectData;      // Reassembly buffer, kept across calls
+    DWORD               m_cbObjectCapacity;
+
+    KEY_FRAME_FILTER_STATS  m_KeyFrameFilterStats;
+};
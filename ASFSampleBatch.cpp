@@ -0,0 +1,138 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFSampleBatch.cpp : CASFSampleBatcher class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include "ASFSampleBatch.h"
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFSampleBatcher
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFSampleBatcher::CASFSampleBatcher()
+:   m_pCallback (NULL),
+    m_pColumns (NULL),
+    m_phnsTimes (NULL),
+    m_pcbLengths (NULL),
+    m_pcBuffers (NULL),
+    m_pwStreamNumbers (NULL),
+    m_pfKeyFrames (NULL),
+    m_pfSeekedKeyFrames (NULL),
+    m_cBatchSize (0),
+    m_cSamples (0),
+    m_iFirstSample (0),
+    m_cBatches (0)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFSampleBatcher
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFSampleBatcher::~CASFSampleBatcher()
+{
+    delete [] m_pColumns;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Initialize
+//
+// Allocates the columns of a block. Samples not handed over yet are
+// dropped. The columns are laid out widest first, so each one stays
+// aligned for its type.
+//
+// cBatchSize: Samples per block, 0 for the default
+// pCallback: Receives the blocks
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSampleBatcher::Initialize(DWORD cBatchSize, IASFSampleBatchCallback* pCallback)
+{
+    if (!pCallback)
+    {
+        return E_POINTER;
+    }
+
+    if (cBatchSize == 0)
+    {
+        cBatchSize = ASF_SAMPLE_BATCH_DEFAULT_SIZE;
+    }
+
+    if (cBatchSize > ASF_SAMPLE_BATCH_MAX_SIZE)
+    {
+        return E_INVALIDARG;
+    }
+
+    DWORD cbColumns = cBatchSize * (sizeof(MFTIME) + 2 * sizeof(DWORD) + sizeof(WORD) + 2 * sizeof(BYTE));
+
+    // new[] of MFTIME keeps the block aligned for the widest column
+    MFTIME* pColumns = new (std::nothrow) MFTIME[(cbColumns + sizeof(MFTIME) - 1) / sizeof(MFTIME)];
+
+    if (!pColumns)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    delete [] m_pColumns;
+
+    m_pColumns = (BYTE*)pColumns;
+
+    m_phnsTimes = pColumns;
+    m_pcbLengths = (DWORD*)(m_phnsTimes + cBatchSize);
+    m_pcBuffers = m_pcbLengths + cBatchSize;
+    m_pwStreamNumbers = (WORD*)(m_pcBuffers + cBatchSize);
+    m_pfKeyFrames = (BYTE*)(m_pwStreamNumbers + cBatchSize);
+    m_pfSeekedKeyFrames = m_pfKeyFrames + cBatchSize;
+
+    m_pCallback = pCallback;
+    m_cBatchSize = cBatchSize;
+    m_cBatches = 0;
+
+    Reset();
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Flush
+//
+// Hands the current block to the callback and starts a new one.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSampleBatcher::Flush()
+{
+    if (m_cSamples == 0)
+    {
+        return S_OK;
+    }
+
+    ASF_SAMPLE_BATCH batch;
+
+    batch.cSamples = m_cSamples;
+    batch.iFirstSample = m_iFirstSample;
+    batch.phnsTimes = m_phnsTimes;
+    batch.pcbLengths = m_pcbLengths;
+    batch.pcBuffers = m_pcBuffers;
+    batch.pwStreamNumbers = m_pwStreamNumbers;
+    batch.pfKeyFrames = m_pfKeyFrames;
+    batch.pfSeekedKeyFrames = m_pfSeekedKeyFrames;
+
+    m_iFirstSample += m_cSamples;
+    m_cSamples = 0;
+    m_cBatches++;
+
+    return m_pCallback->OnSampleBatch(batch);
+}
@@ -0,0 +1,148 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFSampleBatch.h : CASFSampleBatcher class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFReader.h"
+
+//Samples per batch if the caller does not choose
+#define ASF_SAMPLE_BATCH_DEFAULT_SIZE   4096
+
+//Largest batch, 1M samples (about 20 MB of columns)
+#define ASF_SAMPLE_BATCH_MAX_SIZE       0x00100000
+
+//A block of samples in columns: entry i of every array describes the
+//same sample. The arrays are valid until the callback returns.
+
+struct ASF_SAMPLE_BATCH
+{
+    DWORD           cSamples;
+    QWORD           iFirstSample;       // Index of the first sample in the generation
+    const MFTIME*   phnsTimes;          // Presentation times without the preroll
+    const DWORD*    pcbLengths;
+    const DWORD*    pcBuffers;
+    const WORD*     pwStreamNumbers;
+    const BYTE*     pfKeyFrames;        // 0 or 1
+    const BYTE*     pfSeekedKeyFrames;  // 1 for the key frame decoded for a seek
+};
+
+
+//Receives the blocks of a CASFSampleBatcher
+
+class IASFSampleBatchCallback
+{
+public:
+
+    virtual ~IASFSampleBatchCallback() {}
+
+    //Returns S_FALSE to end the generation early, or a failure to abort it
+    virtual HRESULT OnSampleBatch(const ASF_SAMPLE_BATCH& batch) = 0;
+};
+
+
+//Collects sample information into fixed-size column blocks and hands
+//each block to the callback whole, so the per-sample cost is a few
+//stores and the callback cost is paid once per block.
+//
+//The columns are allocated once, by Initialize. The batcher is also a
+//reader callback: pass it to CASFReader::GenerateSamples and call
+//Flush when the generation returns.
+
+class CASFSampleBatcher : public IASFReaderCallback
+{
+public:
+
+    CASFSampleBatcher();
+    ~CASFSampleBatcher();
+
+    //cBatchSize: Samples per block, 0 for ASF_SAMPLE_BATCH_DEFAULT_SIZE
+    HRESULT Initialize(DWORD cBatchSize, IASFSampleBatchCallback* pCallback);
+
+    BOOL IsInitialized() const
+    {
+        return (m_pCallback != NULL);
+    }
+
+    //Adds a sample and hands the block over once it is full. Returns
+    //what the callback returned. Initialize must have succeeded.
+    HRESULT Add(
+        WORD wStreamNumber,
+        MFTIME hnsTime,
+        DWORD cbLength,
+        DWORD cBuffers,
+        BOOL fKeyFrame,
+        BOOL fSeekedKeyFrame
+        )
+    {
+        DWORD i = m_cSamples;
+
+        m_phnsTimes[i] = hnsTime;
+        m_pcbLengths[i] = cbLength;
+        m_pcBuffers[i] = cBuffers;
+        m_pwStreamNumbers[i] = wStreamNumber;
+        m_pfKeyFrames[i] = fKeyFrame ? 1 : 0;
+        m_pfSeekedKeyFrames[i] = fSeekedKeyFrame ? 1 : 0;
+
+        m_cSamples = i + 1;
+
+        return (m_cSamples == m_cBatchSize) ? Flush() : S_OK;
+    }
+
+    //Hands over the samples added since the last block, if any
+    HRESULT Flush();
+
+    //Drops the samples not handed over and restarts the sample index
+    void Reset()
+    {
+        m_cSamples = 0;
+        m_iFirstSample = 0;
+    }
+
+    DWORD GetBatchSize() const
+    {
+        return m_cBatchSize;
+    }
+
+    //Blocks handed over since Initialize
+    QWORD GetBatchCount() const
+    {
+        return m_cBatches;
+    }
+
+    // IASFReaderCallback methods
+    HRESULT OnSample(const ASF_READER_SAMPLE& sample)
+    {
+        return Add(sample.wStreamNumber, sample.hnsTime, sample.cbData, 1, sample.fKeyFrame, FALSE);
+    }
+
+private:
+
+    //Not copyable
+    CASFSampleBatcher(const CASFSampleBatcher&);
+    CASFSampleBatcher& operator=(const CASFSampleBatcher&);
+
+    IASFSampleBatchCallback*    m_pCallback;
+
+    BYTE*       m_pColumns;             // One allocation for all columns
+    MFTIME*     m_phnsTimes;
+    DWORD*      m_pcbLengths;
+    DWORD*      m_pcBuffers;
+    WORD*       m_pwStreamNumbers;
+    BYTE*       m_pfKeyFrames;
+    BYTE*       m_pfSeekedKeyFrames;
+
+    DWORD       m_cBatchSize;
+    DWORD       m_cSamples;             // Samples in the current block
+    QWORD       m_iFirstSample;
+    QWORD       m_cBatches;
+};
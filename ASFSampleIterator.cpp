@@ -0,0 +1,279 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFSampleIterator.cpp : CASFSampleIterator class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include <string.h>
+#include "ASFSampleIterator.h"
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFSample
+//  Description: Constructor. The handle starts empty.
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFSample::CASFSample()
+:   m_fValid (FALSE),
+    m_pOwner (NULL),
+    m_iSlot (0)
+{
+    memset(&m_Info, 0, sizeof(m_Info));
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Release
+//
+// Gives the slot of the sample back to the iterator and empties the
+// handle.
+/////////////////////////////////////////////////////////////////////
+
+void CASFSample::Release()
+{
+    if (m_pOwner)
+    {
+        m_pOwner->ReleaseSlot(m_iSlot);
+        m_pOwner = NULL;
+    }
+
+    m_fValid = FALSE;
+    m_Info.pData = NULL;
+    m_Info.cbData = 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: MoveTo
+//
+// Hands the sample, and its slot, to another handle.
+//
+// pTarget: Receives the sample
+/////////////////////////////////////////////////////////////////////
+
+void CASFSample::MoveTo(CASFSample* pTarget)
+{
+    if (pTarget == this)
+    {
+        return;
+    }
+
+    pTarget->Release();
+
+    pTarget->m_Info = m_Info;
+    pTarget->m_fValid = m_fValid;
+    pTarget->m_pOwner = m_pOwner;
+    pTarget->m_iSlot = m_iSlot;
+
+    m_pOwner = NULL;
+
+    Release();
+}
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFSampleIterator
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFSampleIterator::CASFSampleIterator()
+:   m_pReader (NULL),
+    m_cSlots (0),
+    m_iAssembly (ASF_SAMPLE_ITERATOR_MAX_HELD)
+{
+    memset(m_Slots, 0, sizeof(m_Slots));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFSampleIterator
+//  Description: Destructor. No handle may hold a slot any more.
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFSampleIterator::~CASFSampleIterator()
+{
+    End();
+
+    for (DWORD i = 0; i < m_cSlots; i++)
+    {
+        delete [] m_Slots[i].pData;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Begin
+//
+// Seeks the reader and makes the iterator its object allocator.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSampleIterator::Begin(
+    CASFReader* pReader,
+    WORD wStreamNumber,
+    MFTIME hnsStartTime,
+    MFTIME hnsDuration,
+    DWORD dwFlags
+    )
+{
+    if (!pReader)
+    {
+        return E_POINTER;
+    }
+
+    if (m_pReader)
+    {
+        return MF_E_INVALIDREQUEST;
+    }
+
+    pReader->SetObjectAllocator(this);
+
+    HRESULT hr = pReader->BeginGenerate(wStreamNumber, hnsStartTime, hnsDuration, dwFlags, NULL);
+
+    if (FAILED(hr))
+    {
+        pReader->SetObjectAllocator(NULL);
+        return hr;
+    }
+
+    m_pReader = pReader;
+    m_iAssembly = ASF_SAMPLE_ITERATOR_MAX_HELD;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Next
+//
+// Pulls the next sample. An assembled sample takes over the slot it
+// was assembled in.
+//
+// pSample: Handle that receives the sample
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSampleIterator::Next(CASFSample* pSample)
+{
+    if (!pSample)
+    {
+        return E_POINTER;
+    }
+
+    // Done first, so a handle reused in a loop frees its slot for the
+    // next object.
+    pSample->Release();
+
+    if (!m_pReader)
+    {
+        return MF_E_INVALIDREQUEST;
+    }
+
+    ASF_READER_SAMPLE info;
+
+    HRESULT hr = m_pReader->ReadSample(&info);
+    if (hr != S_OK)
+    {
+        return hr;
+    }
+
+    pSample->m_Info = info;
+    pSample->m_fValid = TRUE;
+
+    if ((m_iAssembly < m_cSlots) && (info.pData == m_Slots[m_iAssembly].pData))
+    {
+        ASFStoreRelease(&m_Slots[m_iAssembly].fHeld, TRUE);
+
+        pSample->m_pOwner = this;
+        pSample->m_iSlot = m_iAssembly;
+
+        m_iAssembly = ASF_SAMPLE_ITERATOR_MAX_HELD;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: End
+//
+// Ends the generation on the reader and detaches from it.
+/////////////////////////////////////////////////////////////////////
+
+void CASFSampleIterator::End()
+{
+    if (m_pReader)
+    {
+        m_pReader->EndGenerate();
+        m_pReader->SetObjectAllocator(NULL);
+        m_pReader = NULL;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetObjectBuffer
+//
+// Returns a slot that no handle holds for the reader to assemble an
+// object in: the smallest one that is large enough, otherwise a free
+// slot grown to the size, otherwise a new slot.
+//
+// cbObject: Size of the object in bytes
+// ppBuffer: Receives the memory of the slot
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSampleIterator::GetObjectBuffer(DWORD cbObject, BYTE** ppBuffer)
+{
+    DWORD iFit = m_cSlots;
+    DWORD iFree = m_cSlots;
+
+    for (DWORD i = 0; i < m_cSlots; i++)
+    {
+        if (ASFLoadAcquire(&m_Slots[i].fHeld))
+        {
+            continue;
+        }
+
+        iFree = i;
+
+        if ((m_Slots[i].cbCapacity >= cbObject) &&
+            ((iFit == m_cSlots) || (m_Slots[i].cbCapacity < m_Slots[iFit].cbCapacity)))
+        {
+            iFit = i;
+        }
+    }
+
+    if (iFit == m_cSlots)
+    {
+        if (iFree == m_cSlots)
+        {
+            if (m_cSlots == ASF_SAMPLE_ITERATOR_MAX_HELD)
+            {
+                return E_OUTOFMEMORY;
+            }
+
+            iFree = m_cSlots++;
+        }
+
+        BYTE* pData = new (std::nothrow) BYTE[cbObject];
+
+        if (!pData)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        delete [] m_Slots[iFree].pData;
+
+        m_Slots[iFree].pData = pData;
+        m_Slots[iFree].cbCapacity = cbObject;
+
+        iFit = iFree;
+    }
+
+    m_iAssembly = iFit;
+
+    *ppBuffer = m_Slots[iFit].pData;
+
+    return S_OK;
+}
@@ -0,0 +1,172 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFSampleIterator.h : CASFSampleIterator class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFReader.h"
+
+//Most assembled samples that can be held at once
+#define ASF_SAMPLE_ITERATOR_MAX_HELD    64
+
+class CASFSampleIterator;
+
+//Handle to a sample pulled from a CASFSampleIterator. The data stays
+//valid until the handle is released, reused by Next, or destroyed.
+//
+//Handles are not copyable; MoveTo hands the sample to another handle,
+//e.g. one in a queue for a worker thread, without touching the data.
+//Any thread can release a handle, but the iterator must outlive it.
+
+class CASFSample
+{
+public:
+
+    CASFSample();
+
+    ~CASFSample()
+    {
+        Release();
+    }
+
+    void Release();
+
+    //Moves the sample to pTarget, releasing what pTarget held. This
+    //handle is empty afterwards.
+    void MoveTo(CASFSample* pTarget);
+
+    BOOL IsEmpty() const
+    {
+        return !m_fValid;
+    }
+
+    const ASF_READER_SAMPLE& GetInfo() const
+    {
+        return m_Info;
+    }
+
+    WORD GetStreamNumber() const
+    {
+        return m_Info.wStreamNumber;
+    }
+
+    //Presentation time without the preroll
+    MFTIME GetTime() const
+    {
+        return m_Info.hnsTime;
+    }
+
+    BOOL IsKeyFrame() const
+    {
+        return m_Info.fKeyFrame;
+    }
+
+    const BYTE* GetData() const
+    {
+        return m_Info.pData;
+    }
+
+    DWORD GetSize() const
+    {
+        return m_Info.cbData;
+    }
+
+private:
+
+    friend class CASFSampleIterator;
+
+    //Not copyable
+    CASFSample(const CASFSample&);
+    CASFSample& operator=(const CASFSample&);
+
+    ASF_READER_SAMPLE       m_Info;
+    BOOL                    m_fValid;
+    CASFSampleIterator*     m_pOwner;       // Owner of the slot, NULL for data in the mapping
+    DWORD                   m_iSlot;
+};
+
+
+//Pull-based alternative to IASFReaderCallback: the caller asks for the
+//samples of a stream one at a time and stops whenever it likes.
+//
+//    CASFSample sample;
+//
+//    hr = iterator.Begin(&reader, wStream, hnsStart, 0, 0);
+//
+//    while (SUCCEEDED(hr) && (iterator.Next(&sample) == S_OK))
+//    {
+//        ...
+//    }
+//
+//    iterator.End();
+//
+//The file is only read when the packets read so far hold no further
+//sample. Samples in one payload point into the mapping; the others are
+//assembled in slots that the iterator keeps for reuse, so once the
+//slots are warm no sample allocates memory. Reusing one handle for
+//every Next recycles its slot; holding more handles uses more slots,
+//up to ASF_SAMPLE_ITERATOR_MAX_HELD.
+
+class CASFSampleIterator : public IASFObjectAllocator
+{
+public:
+
+    CASFSampleIterator();
+    ~CASFSampleIterator();
+
+    //Starts a generation on pReader; the parameters are those of
+    //CASFReader::BeginGenerate. The reader is used by the iterator
+    //alone until End.
+    HRESULT Begin(
+        CASFReader* pReader,
+        WORD wStreamNumber,
+        MFTIME hnsStartTime,
+        MFTIME hnsDuration,
+        DWORD dwFlags
+        );
+
+    //Releases pSample, then pulls the next sample into it. Returns
+    //S_FALSE, with an empty handle, at the end.
+    HRESULT Next(CASFSample* pSample);
+
+    //Ends the generation, finished or not. Held samples stay valid.
+    void End();
+
+    // IASFObjectAllocator methods
+    HRESULT GetObjectBuffer(DWORD cbObject, BYTE** ppBuffer);
+
+private:
+
+    friend class CASFSample;
+
+    struct SAMPLE_SLOT
+    {
+        BYTE*           pData;
+        DWORD           cbCapacity;
+        volatile LONG   fHeld;          // A handle references the slot
+    };
+
+    //Not copyable
+    CASFSampleIterator(const CASFSampleIterator&);
+    CASFSampleIterator& operator=(const CASFSampleIterator&);
+
+    void ReleaseSlot(DWORD iSlot)
+    {
+        ASFStoreRelease(&m_Slots[iSlot].fHeld, FALSE);
+    }
+
+    CASFReader*     m_pReader;
+
+    SAMPLE_SLOT     m_Slots[ASF_SAMPLE_ITERATOR_MAX_HELD];
+    DWORD           m_cSlots;           // Slots used so far
+    DWORD           m_iAssembly;        // Slot given to the reader last, or ASF_SAMPLE_ITERATOR_MAX_HELD
+};
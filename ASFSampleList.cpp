@@ -0,0 +1,89 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFSampleList.cpp : CASFSampleList class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include <string.h>
+#include "ASFSampleList.h"
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFSampleList
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFSampleList::CASFSampleList()
+:   m_pSamples (NULL),
+    m_cSamples (0),
+    m_cCapacity (0)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFSampleList
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFSampleList::~CASFSampleList()
+{
+    Clear();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Reserve
+//
+// Makes room for at least cCapacity descriptors.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSampleList::Reserve(DWORD cCapacity)
+{
+    if (cCapacity <= m_cCapacity)
+    {
+        return S_OK;
+    }
+
+    ASF_SAMPLE_DESCRIPTOR* pSamples = new (std::nothrow) ASF_SAMPLE_DESCRIPTOR[cCapacity];
+
+    if (!pSamples)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    if (m_cSamples > 0)
+    {
+        memcpy(pSamples, m_pSamples, m_cSamples * sizeof(ASF_SAMPLE_DESCRIPTOR));
+    }
+
+    delete [] m_pSamples;
+
+    m_pSamples = pSamples;
+    m_cCapacity = cCapacity;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Clear
+//
+// Releases the descriptors.
+/////////////////////////////////////////////////////////////////////
+
+void CASFSampleList::Clear()
+{
+    delete [] m_pSamples;
+
+    m_pSamples = NULL;
+    m_cSamples = 0;
+    m_cCapacity = 0;
+}
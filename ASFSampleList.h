@@ -0,0 +1,91 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFSampleList.h : CASFSampleList class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFTypes.h"
+
+//A media object found by a scan of the Data Object. The object starts
+//in the packet at cbPacketOffset; it may continue in later packets.
+
+struct ASF_SAMPLE_DESCRIPTOR
+{
+    QWORD   cbPacketOffset;         // File offset of the packet that starts the object
+    DWORD   dwPresentationTime;     // Milliseconds, includes the preroll
+    DWORD   cbMediaObjectSize;
+    DWORD   dwMediaObjectNumber;
+    BYTE    bStreamNumber;
+    BYTE    fKeyFrame;
+};
+
+
+//Growable array of sample descriptors. Appending reports allocation
+//failures as E_OUTOFMEMORY instead of throwing.
+
+class CASFSampleList
+{
+public:
+
+    CASFSampleList();
+    ~CASFSampleList();
+
+    HRESULT Reserve(DWORD cCapacity);
+
+    HRESULT Append(const ASF_SAMPLE_DESCRIPTOR& sample)
+    {
+        if (m_cSamples == m_cCapacity)
+        {
+            if (m_cCapacity > 0x7FFFFFFF)
+            {
+                return E_OUTOFMEMORY;
+            }
+
+            HRESULT hr = Reserve((m_cCapacity < 64) ? 64 : m_cCapacity * 2);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+        }
+
+        m_pSamples[m_cSamples++] = sample;
+
+        return S_OK;
+    }
+
+    void Clear();
+
+    DWORD GetCount() const
+    {
+        return m_cSamples;
+    }
+
+    const ASF_SAMPLE_DESCRIPTOR* GetData() const
+    {
+        return m_pSamples;
+    }
+
+    const ASF_SAMPLE_DESCRIPTOR& operator[](DWORD dwIndex) const
+    {
+        return m_pSamples[dwIndex];
+    }
+
+private:
+
+    //Not copyable
+    CASFSampleList(const CASFSampleList&);
+    CASFSampleList& operator=(const CASFSampleList&);
+
+    ASF_SAMPLE_DESCRIPTOR*  m_pSamples;
+    DWORD                   m_cSamples;
+    DWORD                   m_cCapacity;
+};
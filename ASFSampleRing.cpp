@@ -0,0 +1,302 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFSampleRing.cpp : CASFSampleRing class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include "ASFSampleRing.h"
+#include "ASFThread.h"
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFSampleRing
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFSampleRing::CASFSampleRing()
+:   m_pEntries (NULL),
+    m_dwMask (0)
+{
+    Reset();
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFSampleRing
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFSampleRing::~CASFSampleRing()
+{
+    delete [] m_pEntries;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Initialize
+//
+// Allocates the ring. The capacity is rounded up to a power of 2.
+//
+// cEntries: Number of samples the ring holds, 0 for the default
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSampleRing::Initialize(DWORD cEntries)
+{
+    if (cEntries == 0)
+    {
+        cEntries = ASF_SAMPLE_RING_DEFAULT_SIZE;
+    }
+
+    if (cEntries > ASF_SAMPLE_RING_MAX_SIZE)
+    {
+        return E_INVALIDARG;
+    }
+
+    DWORD cCapacity = 1;
+
+    while (cCapacity < cEntries)
+    {
+        cCapacity <<= 1;
+    }
+
+    if (!m_pEntries || (cCapacity != m_dwMask + 1))
+    {
+        ASF_SAMPLE_RING_ENTRY* pEntries = new (std::nothrow) ASF_SAMPLE_RING_ENTRY[cCapacity];
+
+        if (!pEntries)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        delete [] m_pEntries;
+
+        m_pEntries = pEntries;
+        m_dwMask = cCapacity - 1;
+    }
+
+    Reset();
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Reset
+//
+// Empties the ring and clears the statistics. Entries still in the
+// ring are dropped; the owner releases them first with TryPop.
+/////////////////////////////////////////////////////////////////////
+
+void CASFSampleRing::Reset()
+{
+    m_iWrite = 0;
+    m_iReadCached = 0;
+    m_cPushed = 0;
+    m_cProducerWaits = 0;
+    m_cMaxOccupancy = 0;
+
+    m_iRead = 0;
+    m_iWriteCached = 0;
+    m_cConsumerWaits = 0;
+
+    m_fClosed = FALSE;
+    m_fStopped = FALSE;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Push
+//
+// Appends an entry, waiting while the ring is full. Called by the
+// producer only.
+//
+// Returns S_FALSE, without queuing the entry, if the consumer has
+// stopped the ring.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSampleRing::Push(const ASF_SAMPLE_RING_ENTRY& entry)
+{
+    if (!m_pEntries)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    DWORD iWrite = (DWORD)m_iWrite;
+    DWORD cSpins = 0;
+
+    //The cached read index is refreshed only when the ring looks full
+    while (iWrite - m_iReadCached > m_dwMask)
+    {
+        if (ASFLoadAcquire(&m_fStopped))
+        {
+            return S_FALSE;
+        }
+
+        m_iReadCached = ASFLoadAcquire(&m_iRead);
+
+        if (iWrite - m_iReadCached <= m_dwMask)
+        {
+            break;
+        }
+
+        if (cSpins == 0)
+        {
+            m_cProducerWaits++;
+        }
+
+        if (++cSpins >= ASF_SAMPLE_RING_SPIN_COUNT)
+        {
+            CASFThread::YieldThread();
+        }
+    }
+
+    if (ASFLoadAcquire(&m_fStopped))
+    {
+        return S_FALSE;
+    }
+
+    m_pEntries[iWrite & m_dwMask] = entry;
+
+    //Publish the entry
+    ASFStoreRelease(&m_iWrite, iWrite + 1);
+
+    m_cPushed++;
+
+    if (iWrite + 1 - m_iReadCached > m_cMaxOccupancy)
+    {
+        m_cMaxOccupancy = iWrite + 1 - m_iReadCached;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Close
+//
+// Marks the end of the stream. Called by the producer after the last
+// Push.
+/////////////////////////////////////////////////////////////////////
+
+void CASFSampleRing::Close()
+{
+    ASFStoreRelease(&m_fClosed, TRUE);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Pop
+//
+// Removes the oldest entry, waiting while the ring is empty. Called by
+// the consumer only.
+//
+// Returns S_FALSE when the producer has closed the ring and every
+// entry has been removed.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSampleRing::Pop(ASF_SAMPLE_RING_ENTRY* pEntry)
+{
+    if (!pEntry)
+    {
+        return E_POINTER;
+    }
+
+    if (!m_pEntries)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    DWORD cSpins = 0;
+
+    while (!TryPop(pEntry))
+    {
+        //Entries pushed before Close are visible once Close is seen,
+        //so look once more before giving up
+        if (ASFLoadAcquire(&m_fClosed))
+        {
+            return TryPop(pEntry) ? S_OK : S_FALSE;
+        }
+
+        if (cSpins == 0)
+        {
+            m_cConsumerWaits++;
+        }
+
+        if (++cSpins >= ASF_SAMPLE_RING_SPIN_COUNT)
+        {
+            CASFThread::YieldThread();
+        }
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: TryPop
+//
+// Removes the oldest entry if there is one. Called by the consumer
+// only.
+/////////////////////////////////////////////////////////////////////
+
+BOOL CASFSampleRing::TryPop(ASF_SAMPLE_RING_ENTRY* pEntry)
+{
+    if (!m_pEntries)
+    {
+        return FALSE;
+    }
+
+    DWORD iRead = (DWORD)m_iRead;
+
+    //The cached write index is refreshed only when the ring looks empty
+    if (iRead == m_iWriteCached)
+    {
+        m_iWriteCached = ASFLoadAcquire(&m_iWrite);
+
+        if (iRead == m_iWriteCached)
+        {
+            return FALSE;
+        }
+    }
+
+    *pEntry = m_pEntries[iRead & m_dwMask];
+
+    //Free the slot
+    ASFStoreRelease(&m_iRead, iRead + 1);
+
+    return TRUE;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Stop
+//
+// Tells the producer that no more entries are wanted. Called by the
+// consumer; entries already queued stay in the ring.
+/////////////////////////////////////////////////////////////////////
+
+void CASFSampleRing::Stop()
+{
+    ASFStoreRelease(&m_fStopped, TRUE);
+}
+
+BOOL CASFSampleRing::IsStopped() const
+{
+    return (BOOL)ASFLoadAcquire(const_cast<volatile LONG*>(&m_fStopped));
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetStats
+//
+// Returns the counters of the last run.
+/////////////////////////////////////////////////////////////////////
+
+void CASFSampleRing::GetStats(ASF_SAMPLE_RING_STATS* pStats) const
+{
+    pStats->cPushed = m_cPushed;
+    pStats->cProducerWaits = m_cProducerWaits;
+    pStats->cConsumerWaits = m_cConsumerWaits;
+    pStats->cMaxOccupancy = m_cMaxOccupancy;
+}
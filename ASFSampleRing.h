@@ -0,0 +1,115 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFSampleRing.h : CASFSampleRing class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFTypes.h"
+
+#define ASF_SAMPLE_RING_DEFAULT_SIZE    64
+#define ASF_SAMPLE_RING_MAX_SIZE        4096
+
+//Polls of the other side's index before a waiting thread yields
+#define ASF_SAMPLE_RING_SPIN_COUNT      64
+
+#define ASF_CACHE_LINE_SIZE             64
+
+//Compressed sample handed from the demux thread to the decode thread.
+//The ring does not interpret pSample; the owner of the ring does.
+
+struct ASF_SAMPLE_RING_ENTRY
+{
+    void*   pSample;
+    WORD    wStreamNumber;
+};
+
+
+struct ASF_SAMPLE_RING_STATS
+{
+    QWORD   cPushed;
+    QWORD   cProducerWaits;     // Pushes that found the ring full
+    QWORD   cConsumerWaits;     // Pops that found the ring empty
+    DWORD   cMaxOccupancy;
+};
+
+
+//Bounded lock-free ring for exactly one producer thread and one
+//consumer thread. Each index is written by one side only, so no
+//locks or compare-exchange loops are needed: the producer publishes
+//an entry by advancing the write index, the consumer frees a slot by
+//advancing the read index. A full ring makes the producer wait, which
+//throttles the demux to the decode rate.
+//
+//The consumer can stop the producer early with Stop; the producer
+//ends the stream with Close.
+
+class CASFSampleRing
+{
+public:
+
+    CASFSampleRing();
+    ~CASFSampleRing();
+
+    HRESULT Initialize(DWORD cEntries);
+
+    //Empties the ring. Neither thread may be using it.
+    void Reset();
+
+    //Producer
+    HRESULT Push(const ASF_SAMPLE_RING_ENTRY& entry);
+
+    void Close();
+
+    //Consumer
+    HRESULT Pop(ASF_SAMPLE_RING_ENTRY* pEntry);
+
+    BOOL TryPop(ASF_SAMPLE_RING_ENTRY* pEntry);
+
+    void Stop();
+
+    BOOL IsStopped() const;
+
+    DWORD GetCapacity() const
+    {
+        return m_dwMask + 1;
+    }
+
+    //Valid once both threads are done with the ring
+    void GetStats(ASF_SAMPLE_RING_STATS* pStats) const;
+
+private:
+
+    //Not copyable
+    CASFSampleRing(const CASFSampleRing&);
+    CASFSampleRing& operator=(const CASFSampleRing&);
+
+    ASF_SAMPLE_RING_ENTRY*  m_pEntries;
+    DWORD                   m_dwMask;           // Capacity - 1, capacity is a power of 2
+
+    //Producer side, on its own cache line
+    BYTE            m_PadProducer[ASF_CACHE_LINE_SIZE];
+    volatile LONG   m_iWrite;                   // Free-running, written by the producer
+    DWORD           m_iReadCached;              // Producer's last view of m_iRead
+    QWORD           m_cPushed;
+    QWORD           m_cProducerWaits;
+    DWORD           m_cMaxOccupancy;
+
+    //Consumer side
+    BYTE            m_PadConsumer[ASF_CACHE_LINE_SIZE];
+    volatile LONG   m_iRead;                    // Free-running, written by the consumer
+    DWORD           m_iWriteCached;             // Consumer's last view of m_iWrite
+    QWORD           m_cConsumerWaits;
+
+    BYTE            m_PadFlags[ASF_CACHE_LINE_SIZE];
+    volatile LONG   m_fClosed;
+    volatile LONG   m_fStopped;
+};
@@ -0,0 +1,372 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFSeekEngine.cpp : CASFSeekEngine class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "ASFSeekEngine.h"
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFSeekEngine
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFSeekEngine::CASFSeekEngine()
+:   m_pPackets (NULL),
+    m_cPackets (0),
+    m_cbPacketSize (0),
+    m_msPreroll (0),
+    m_msWindow (ASF_SEEK_MAX_OBJECT_SPACING),
+    m_cPacketReads (0),
+    m_fCapped (FALSE)
+{
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Initialize
+//
+// pPackets: First byte of the first data packet
+// cPackets: Number of packets at pPackets
+// cbPacketSize: Fixed packet size from the File Properties Object
+// msPreroll: Preroll from the File Properties Object, in milliseconds
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSeekEngine::Initialize(const BYTE* pPackets, QWORD cPackets, DWORD cbPacketSize, QWORD msPreroll)
+{
+    if (!pPackets || (cbPacketSize == 0))
+    {
+        return E_INVALIDARG;
+    }
+
+    m_pPackets = pPackets;
+    m_cPackets = cPackets;
+    m_cbPacketSize = cbPacketSize;
+    m_msPreroll = msPreroll;
+    m_cPacketReads = 0;
+    m_fCapped = FALSE;
+
+    m_msWindow = (msPreroll < MAXDWORD - ASF_SEEK_MAX_OBJECT_SPACING) ?
+                    (DWORD)msPreroll + ASF_SEEK_MAX_OBJECT_SPACING : MAXDWORD;
+
+    return m_Parser.Initialize(cbPacketSize);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: FindPacket
+//
+// Finds the packet in which the media object of a stream that is
+// presented at dwPresentationTime starts: the last object of the
+// stream whose presentation time is not after dwPresentationTime.
+// If the stream has no such object, that is the first packet that
+// holds the start of an object of the stream, if any.
+//
+// dwPresentationTime: Target time in milliseconds, including the preroll
+// wStreamNumber: Stream to seek
+// piPacket: Receives the index of the packet
+// piSendBoundary: Receives the index of the first packet sent after
+//                 the target time. Can be NULL.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSeekEngine::FindPacket(
+    DWORD dwPresentationTime,
+    WORD wStreamNumber,
+    QWORD* piPacket,
+    QWORD* piSendBoundary
+    )
+{
+    if (!piPacket)
+    {
+        return E_POINTER;
+    }
+
+    QWORD iSendBoundary = 0;
+
+    HRESULT hr = FindSendBoundary(dwPresentationTime, &iSendBoundary);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    DWORD cReads = m_cPacketReads;
+
+    hr = FindObjectStart(dwPresentationTime, wStreamNumber, iSendBoundary, piPacket);
+
+    m_cPacketReads += cReads;
+
+    if (SUCCEEDED(hr) && piSendBoundary)
+    {
+        *piSendBoundary = iSendBoundary;
+    }
+
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: FindPacketAtTime
+//
+// FindPacket for a seek time as playback gives it, without the
+// preroll.
+//
+// hnsTime: Seek time in 100-ns units. Negative times seek to 0.
+// wStreamNumber: Stream to seek
+// piPacket: Receives the index of the packet
+// piSendBoundary: Receives the index of the first packet sent after
+//                 the target time. Can be NULL.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSeekEngine::FindPacketAtTime(
+    MFTIME hnsTime,
+    WORD wStreamNumber,
+    QWORD* piPacket,
+    QWORD* piSendBoundary
+    )
+{
+    // Payload presentation times are in milliseconds and include the preroll.
+    QWORD msTime = (hnsTime > 0) ? (QWORD)(hnsTime / 10000) : 0;
+    DWORD dwTarget = MAXDWORD;
+
+    if ((msTime < MAXDWORD) && (m_msPreroll < MAXDWORD - msTime))
+    {
+        dwTarget = (DWORD)(msTime + m_msPreroll);
+    }
+
+    return FindPacket(dwTarget, wStreamNumber, piPacket, piSendBoundary);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: FindSendBoundary
+//
+// Returns the index of the first packet whose send time is after
+// dwTime, or the packet count if there is none.
+//
+// The search keeps send(lo) <= dwTime < send(hi). Each step guesses
+// the boundary by interpolating between the two send times; when a
+// guess did not at least halve the interval, the next step bisects.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSeekEngine::FindSendBoundary(DWORD dwTime, QWORD* piPacket)
+{
+    if (!piPacket)
+    {
+        return E_POINTER;
+    }
+
+    if (!m_pPackets)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    m_cPacketReads = 0;
+
+    if (m_cPackets == 0)
+    {
+        *piPacket = 0;
+        return S_OK;
+    }
+
+    QWORD lo = 0;
+    QWORD hi = m_cPackets - 1;
+    DWORD dwSendLo = 0;
+    DWORD dwSendHi = 0;
+
+    HRESULT hr = ReadSendTime(lo, &dwSendLo);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (dwSendLo > dwTime)
+    {
+        *piPacket = 0;
+        return S_OK;
+    }
+
+    hr = ReadSendTime(hi, &dwSendHi);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (dwSendHi <= dwTime)
+    {
+        *piPacket = m_cPackets;
+        return S_OK;
+    }
+
+    BOOL fBisect = FALSE;
+
+    while (hi - lo > 1)
+    {
+        QWORD cInterval = hi - lo;
+        QWORD mid = 0;
+
+        if (fBisect)
+        {
+            mid = lo + cInterval / 2;
+        }
+        else
+        {
+            //dwSendLo <= dwTime < dwSendHi, so the fraction is in [0, 1)
+            double fraction = (double)(dwTime - dwSendLo) / (double)(dwSendHi - dwSendLo);
+
+            mid = lo + 1 + (QWORD)(fraction * (double)(cInterval - 1));
+
+            if (mid >= hi)
+            {
+                mid = hi - 1;
+            }
+        }
+
+        DWORD dwSendMid = 0;
+
+        hr = ReadSendTime(mid, &dwSendMid);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        if (dwSendMid <= dwTime)
+        {
+            lo = mid;
+            dwSendLo = dwSendMid;
+        }
+        else
+        {
+            hi = mid;
+            dwSendHi = dwSendMid;
+        }
+
+        fBisect = ((hi - lo) * 2 > cInterval);
+    }
+
+    *piPacket = hi;
+
+    return S_OK;
+}
+
+// ----- Protected Methods -----------------------------------------------
+
+/////////////////////////////////////////////////////////////////////
+// Name: ReadSendTime
+//
+// Parses the header of one packet and returns its send time.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSeekEngine::ReadSendTime(QWORD iPacket, DWORD* pdwSendTime)
+{
+    ASF_PACKET_INFO info;
+
+    m_cPacketReads++;
+
+    HRESULT hr = m_Parser.ParsePacket(m_pPackets + iPacket * m_cbPacketSize, m_cbPacketSize, &info);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    *pdwSendTime = info.dwSendTime;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: FindObjectStart
+//
+// Walks back from the send boundary to the packet holding the start
+// of the last object of the stream presented at or before
+// dwPresentationTime. Objects of a stream are stored in presentation
+// order, so the first match found walking back is the one.
+//
+// The walk ends at the first packet sent before the search window;
+// it and the packets sent earlier only hold objects presented too
+// long before the target. m_cPacketReads counts the packet headers
+// read up to there.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSeekEngine::FindObjectStart(
+    DWORD dwPresentationTime,
+    WORD wStreamNumber,
+    QWORD iSendBoundary,
+    QWORD* piPacket
+    )
+{
+    ASF_PACKET_INFO info;
+    ASF_PAYLOAD_INFO payload;
+
+    QWORD iFirstStart = m_cPackets;     // Earliest object start seen after the target
+    QWORD iWalkEnd = 0;                 // Last packet read
+    DWORD dwWindowStart = (dwPresentationTime > m_msWindow) ? dwPresentationTime - m_msWindow : 0;
+
+    m_cPacketReads = 0;
+    m_fCapped = FALSE;
+
+    for (QWORD i = iSendBoundary; i > 0; i--)
+    {
+        QWORD iPacket = i - 1;
+
+        iWalkEnd = iPacket;
+        m_cPacketReads++;
+
+        HRESULT hr = m_Parser.ParsePacket(m_pPackets + iPacket * m_cbPacketSize, m_cbPacketSize, &info);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        if (info.dwSendTime < dwWindowStart)
+        {
+            m_fCapped = TRUE;
+            break;
+        }
+
+        while ((hr = m_Parser.GetNextPayload(&payload)) == S_OK)
+        {
+            if ((payload.bStreamNumber != wStreamNumber) ||
+                (!payload.fCompressed && (payload.dwOffsetIntoMediaObject != 0)))
+            {
+                continue;
+            }
+
+            if (payload.dwPresentationTime <= dwPresentationTime)
+            {
+                *piPacket = iPacket;
+                return S_OK;
+            }
+
+            iFirstStart = iPacket;
+        }
+
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+    }
+
+    //Every object of the stream in the window is later than the target;
+    //the stream starts after it, or has no object close enough before.
+    if (iFirstStart < m_cPackets)
+    {
+        *piPacket = iFirstStart;
+        return S_OK;
+    }
+
+    if (iSendBoundary < m_cPackets)
+    {
+        *piPacket = iSendBoundary;
+    }
+    else
+    {
+        *piPacket = m_fCapped ? iWalkEnd : 0;
+    }
+
+    return S_OK;
+}
@@ -0,0 +1,100 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFSeekEngine.h : CASFSeekEngine class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFPacketParser.h"
+
+//Finds packets by presentation time in a Data Object with fixed-size
+//packets, by reading packet headers only where needed.
+//
+//Packet send times never decrease, and no payload is presented before
+//its packet is sent. So every media object presented at or before a
+//time T starts in a packet sent at or before T. FindPacket first
+//locates the first packet sent after T with an interpolation search on
+//the send times, which falls back to bisection whenever an
+//interpolation step does not halve the interval, so it needs
+//O(log n) packet header reads at most. It then walks back from that
+//boundary to the packet in which the object that covers T starts.
+//
+//The walk back is bounded by time. A payload is sent at most the
+//preroll before it is presented, and consecutive objects of a stream
+//are assumed to be at most ASF_SEEK_MAX_OBJECT_SPACING apart. So the
+//walk stops at the first packet sent before T minus both; a sparse
+//stream with no object in that window seeks to the send boundary
+//instead of reading back to the first packet.
+
+//Longest gap between objects of a stream that the walk back covers, in
+//milliseconds
+#define ASF_SEEK_MAX_OBJECT_SPACING     10000
+
+class CASFSeekEngine
+{
+public:
+
+    CASFSeekEngine();
+
+    HRESULT Initialize(const BYTE* pPackets, QWORD cPackets, DWORD cbPacketSize, QWORD msPreroll);
+
+    HRESULT FindPacket(
+        DWORD dwPresentationTime,
+        WORD wStreamNumber,
+        QWORD* piPacket,
+        QWORD* piSendBoundary
+        );
+
+    HRESULT FindPacketAtTime(
+        MFTIME hnsTime,
+        WORD wStreamNumber,
+        QWORD* piPacket,
+        QWORD* piSendBoundary
+        );
+
+    HRESULT FindSendBoundary(DWORD dwTime, QWORD* piPacket);
+
+    //Packet headers read by the last search
+    DWORD GetPacketReadCount() const
+    {
+        return m_cPacketReads;
+    }
+
+    //TRUE if the walk back of the last search stopped at the time bound
+    //before it found the object
+    BOOL IsSearchCapped() const
+    {
+        return m_fCapped;
+    }
+
+protected:
+
+    HRESULT ReadSendTime(QWORD iPacket, DWORD* pdwSendTime);
+
+    HRESULT FindObjectStart(
+        DWORD dwPresentationTime,
+        WORD wStreamNumber,
+        QWORD iSendBoundary,
+        QWORD* piPacket
+        );
+
+protected:
+
+    const BYTE*         m_pPackets;
+    QWORD               m_cPackets;
+    DWORD               m_cbPacketSize;
+    QWORD               m_msPreroll;
+    DWORD               m_msWindow;         // Bound of the walk back before the target
+
+    CASFPacketParser    m_Parser;
+    DWORD               m_cPacketReads;
+    BOOL                m_fCapped;
+};
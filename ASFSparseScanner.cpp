@@ -0,0 +1,633 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFSparseScanner.cpp : CASFSparseScanner class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include <string.h>
+#include "ASFSparseScanner.h"
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFSparseScanner
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFSparseScanner::CASFSparseScanner()
+:   m_pHeader (NULL),
+    m_pPacket (NULL),
+    m_cbPrefix (0),
+    m_dwBucketMs (ASF_SPARSE_BUCKET_MS)
+{
+    m_FileInfo = FILE_PROPERTIES_OBJECT();
+    memset(m_Profiles, 0, sizeof(m_Profiles));
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFSparseScanner
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFSparseScanner::~CASFSparseScanner()
+{
+    Reset();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Scan
+//
+// Reads the header and the packet and payload headers of a file and
+// builds the timelines and bitrate profiles of its streams. The file
+// is closed when the call returns. The I/O counters are kept if the
+// scan fails.
+//
+// sFileName:  Path name of the file
+// cbPrefix:   Bytes read at the start of each packet, 0 for the default
+// dwBucketMs: Bitrate bucket duration, 0 for the default
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSparseScanner::Scan(const ASF_PATH_CHAR* sFileName, DWORD cbPrefix, DWORD dwBucketMs)
+{
+    if (!sFileName)
+    {
+        return E_INVALIDARG;
+    }
+
+    Reset();
+
+    BYTE* pBatch = NULL;
+    DWORD cbPacket = 0;
+    DWORD cbStride = 0;         // Bytes of each packet in the batch buffer
+    QWORD cbData = 0;
+    QWORD cPackets = 0;
+
+    m_cbPrefix = (cbPrefix == 0) ? ASF_SPARSE_PREFIX_SIZE : cbPrefix;
+    if (m_cbPrefix < ASF_SPARSE_MIN_PREFIX_SIZE)
+    {
+        m_cbPrefix = ASF_SPARSE_MIN_PREFIX_SIZE;
+    }
+
+    m_dwBucketMs = (dwBucketMs == 0) ? ASF_SPARSE_BUCKET_MS : dwBucketMs;
+
+    HRESULT hr = m_File.Open(sFileName);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    m_Stats.cbFile = m_File.GetSize();
+
+    hr = ReadHeader();
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = m_HeaderParser.GetFileProperties(&m_FileInfo);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    if ((m_FileInfo.cbMinPacketSize != m_FileInfo.cbMaxPacketSize) || (m_FileInfo.cbMaxPacketSize == 0))
+    {
+        hr = MF_E_INVALID_FILE_FORMAT;
+        goto done;
+    }
+
+    cbPacket = m_FileInfo.cbMaxPacketSize;
+
+    hr = m_PacketParser.Initialize(cbPacket);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    //Small packets are read whole, large ones by their prefixes
+    cbStride = ((cbPacket < ASF_SPARSE_MIN_STRIDE) || (m_cbPrefix >= cbPacket)) ? cbPacket : m_cbPrefix;
+
+    m_pPacket = new (std::nothrow) BYTE[cbPacket];
+    pBatch = new (std::nothrow) BYTE[(size_t)cbStride * ASF_SPARSE_BATCH_PACKETS];
+
+    if (!m_pPacket || !pBatch)
+    {
+        hr = E_OUTOFMEMORY;
+        goto done;
+    }
+
+    //Packets within both the Data Object and the file
+    if (m_HeaderParser.GetDataOffset() < m_File.GetSize())
+    {
+        cbData = m_File.GetSize() - m_HeaderParser.GetDataOffset();
+    }
+
+    if (m_HeaderParser.GetDataLength() < cbData)
+    {
+        cbData = m_HeaderParser.GetDataLength();
+    }
+
+    cPackets = cbData / cbPacket;
+
+    for (QWORD iFirstPacket = 0; iFirstPacket < cPackets; iFirstPacket += ASF_SPARSE_BATCH_PACKETS)
+    {
+        DWORD cBatch = (cPackets - iFirstPacket < ASF_SPARSE_BATCH_PACKETS) ?
+            (DWORD)(cPackets - iFirstPacket) : ASF_SPARSE_BATCH_PACKETS;
+
+        QWORD cbBatchOffset = m_HeaderParser.GetDataOffset() + iFirstPacket * cbPacket;
+
+        if (cbStride == cbPacket)
+        {
+            hr = ReadExact(cbBatchOffset, pBatch, cBatch * cbPacket);
+        }
+        else
+        {
+            for (DWORD i = 0; SUCCEEDED(hr) && (i < cBatch); i++)
+            {
+                hr = ReadExact(cbBatchOffset + (QWORD)i * cbPacket, pBatch + i * cbStride, cbStride);
+            }
+        }
+
+        for (DWORD i = 0; SUCCEEDED(hr) && (i < cBatch); i++)
+        {
+            hr = ScanPacket(iFirstPacket + i, pBatch + i * cbStride, cbStride);
+        }
+
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+    }
+
+    hr = BuildTimelines();
+
+done:
+    m_Stats.cReads = m_File.GetReadCount();
+    m_Stats.cbRead = m_File.GetBytesRead();
+
+    m_File.Close();
+
+    delete [] pBatch;
+
+    if (FAILED(hr))
+    {
+        ASF_SPARSE_SCAN_STATS stats = m_Stats;
+        Reset();
+        m_Stats = stats;
+    }
+
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Reset
+//
+// Releases the results of the last scan.
+/////////////////////////////////////////////////////////////////////
+
+void CASFSparseScanner::Reset()
+{
+    m_File.Close();
+    m_HeaderParser.Reset();
+
+    delete [] m_pHeader;
+    m_pHeader = NULL;
+
+    delete [] m_pPacket;
+    m_pPacket = NULL;
+
+    for (DWORD i = 0; i < ASF_MAX_STREAMS; i++)
+    {
+        m_Samples[i].Clear();
+        m_Timelines[i].Reset();
+
+        delete [] m_Profiles[i].pcbBuckets;
+    }
+
+    m_FileInfo = FILE_PROPERTIES_OBJECT();
+    memset(m_Profiles, 0, sizeof(m_Profiles));
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetTimeline
+//
+// Returns the timeline of a stream. A stream without samples has an
+// empty one.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSparseScanner::GetTimeline(WORD wStreamNumber, const CASFTimeline** ppTimeline) const
+{
+    if (!ppTimeline)
+    {
+        return E_POINTER;
+    }
+
+    if (wStreamNumber >= ASF_MAX_STREAMS)
+    {
+        return MF_E_INVALIDSTREAMNUMBER;
+    }
+
+    *ppTimeline = &m_Timelines[wStreamNumber];
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetBitrateProfile
+//
+// Returns the payload bytes of a stream per bucket of send time. The
+// array is owned by the scanner and valid until the next Scan or
+// Reset; a stream without payloads has no buckets.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSparseScanner::GetBitrateProfile(WORD wStreamNumber, const QWORD** ppcbBuckets, DWORD* pcBuckets) const
+{
+    if (!ppcbBuckets || !pcBuckets)
+    {
+        return E_POINTER;
+    }
+
+    if (wStreamNumber >= ASF_MAX_STREAMS)
+    {
+        return MF_E_INVALIDSTREAMNUMBER;
+    }
+
+    *ppcbBuckets = m_Profiles[wStreamNumber].pcbBuckets;
+    *pcBuckets = m_Profiles[wStreamNumber].cBuckets;
+
+    return S_OK;
+}
+
+// ----- Private Methods -----------------------------------------------
+
+/////////////////////////////////////////////////////////////////////
+// Name: ReadHeader
+//
+// Reads the Header Object and the Data Object header in one read,
+// once the size of the Header Object is known, and parses them.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSparseScanner::ReadHeader()
+{
+    BYTE rgbHeaderObject[ASF_HEADER_OBJECT_SIZE];
+    QWORD cbHeader = 0;
+
+    HRESULT hr = ReadExact(0, rgbHeaderObject, sizeof(rgbHeaderObject));
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    hr = CASFHeaderParser::GetHeaderSize(rgbHeaderObject, sizeof(rgbHeaderObject), &cbHeader);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if ((m_File.GetSize() < ASF_DATA_OBJECT_HEADER_SIZE) ||
+        (cbHeader > m_File.GetSize() - ASF_DATA_OBJECT_HEADER_SIZE))
+    {
+        return MF_E_ASF_PARSINGINCOMPLETE;
+    }
+
+    if (cbHeader > (DWORD)-1 - ASF_DATA_OBJECT_HEADER_SIZE)
+    {
+        return MF_E_ASF_INVALIDDATA;
+    }
+
+    DWORD cbRead = (DWORD)cbHeader + ASF_DATA_OBJECT_HEADER_SIZE;
+
+    m_pHeader = new (std::nothrow) BYTE[cbRead];
+    if (!m_pHeader)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    hr = ReadExact(0, m_pHeader, cbRead);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    hr = m_HeaderParser.Parse(m_pHeader, cbRead);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (m_HeaderParser.GetDataOffset() == 0)
+    {
+        return MF_E_INVALID_FILE_FORMAT;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ReadExact
+//
+// Reads a range that must lie within the file.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSparseScanner::ReadExact(QWORD cbOffset, BYTE* pBuffer, DWORD cbToRead)
+{
+    DWORD cbRead = 0;
+
+    HRESULT hr = m_File.ReadAt(cbOffset, pBuffer, cbToRead, &cbRead);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    return (cbRead == cbToRead) ? S_OK : MF_E_ASF_PARSINGINCOMPLETE;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ScanPacket
+//
+// Parses the payload headers of a packet of which only the first
+// bytes may have been read.
+//
+// The packet is parsed from a buffer of the full packet size that
+// holds every piece read so far at its offset; the other bytes are
+// left over from earlier packets. Before each payload header the
+// scanner reads ASF_SPARSE_HEADER_READ_SIZE bytes from it unless they
+// are in the range read last. Once the header is parsed, the bytes it
+// spans are checked against that range: a header that reaches past it
+// was parsed partly from stale bytes, so the bytes it claims are read
+// and the packet is parsed again, skipping the payloads already
+// recorded. If the header spans more than it did the first time, the
+// rest of the packet is read, which ends the retries.
+//
+// iPacket: Packet number from the start of the Data Object
+// pData:   First bytes of the packet
+// cbData:  Number of bytes at pData, up to the packet size
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSparseScanner::ScanPacket(QWORD iPacket, const BYTE* pData, DWORD cbData)
+{
+    const DWORD cbPacket = m_PacketParser.GetPacketSize();
+    const QWORD cbPacketOffset = m_HeaderParser.GetDataOffset() + iPacket * cbPacket;
+
+    const BYTE* pPacket = pData;
+
+    //Range read last, relative to the packet
+    DWORD cbLoadStart = 0;
+    DWORD cbLoadEnd = cbData;
+
+    DWORD cDone = 0;                // Payloads recorded by earlier parses
+    DWORD iRetried = (DWORD)-1;     // Payload whose header was read again
+
+    ASF_PACKET_INFO info;
+    ASF_PAYLOAD_INFO payload;
+
+    HRESULT hr = S_OK;
+
+    m_Stats.cPackets++;
+
+    if (cbData < cbPacket)
+    {
+        memcpy(m_pPacket, pData, cbData);
+        pPacket = m_pPacket;
+    }
+
+    for (;;)
+    {
+        if (FAILED(m_PacketParser.ParsePacket(pPacket, cbPacket, &info)))
+        {
+            m_Stats.cCorruptPackets++;
+            return S_OK;
+        }
+
+        DWORD iPayload = 0;
+        BOOL fParseAgain = FALSE;
+
+        for (;;)
+        {
+            DWORD cbNext = m_PacketParser.GetParseOffset();
+
+            if ((iPayload >= cDone) && (m_PacketParser.GetPayloadsLeft() > 0))
+            {
+                DWORD cbEnd = (cbPacket - cbNext < ASF_SPARSE_HEADER_READ_SIZE) ?
+                    cbPacket : cbNext + ASF_SPARSE_HEADER_READ_SIZE;
+
+                if ((cbNext < cbLoadStart) || (cbEnd > cbLoadEnd))
+                {
+                    hr = ReadExact(cbPacketOffset + cbNext, m_pPacket + cbNext, cbEnd - cbNext);
+                    if (FAILED(hr))
+                    {
+                        return hr;
+                    }
+
+                    cbLoadStart = cbNext;
+                    cbLoadEnd = cbEnd;
+                    m_Stats.cHeaderReads++;
+                }
+            }
+
+            HRESULT hrPayload = m_PacketParser.GetNextPayload(&payload);
+
+            if (hrPayload == S_FALSE)
+            {
+                break;
+            }
+
+            //A sub-payload of the compressed payload parsed last leaves
+            //the parse offset where it was
+            BOOL fNewPayload = FAILED(hrPayload) || (m_PacketParser.GetParseOffset() != cbNext);
+
+            if (fNewPayload && (iPayload >= cDone))
+            {
+                //The header, or all of a compressed payload
+                DWORD cbEnd = cbPacket;
+
+                if (SUCCEEDED(hrPayload))
+                {
+                    cbEnd = payload.fCompressed ?
+                        m_PacketParser.GetParseOffset() :
+                        (DWORD)(payload.pData - pPacket);
+                }
+
+                if ((cbNext < cbLoadStart) || (cbEnd > cbLoadEnd))
+                {
+                    if (iRetried == iPayload)
+                    {
+                        cbEnd = cbPacket;
+                    }
+
+                    hr = ReadExact(cbPacketOffset + cbNext, m_pPacket + cbNext, cbEnd - cbNext);
+                    if (FAILED(hr))
+                    {
+                        return hr;
+                    }
+
+                    cbLoadStart = cbNext;
+                    cbLoadEnd = cbEnd;
+                    m_Stats.cHeaderReads++;
+
+                    iRetried = iPayload;
+                    cDone = iPayload;
+                    fParseAgain = TRUE;
+                    break;
+                }
+            }
+
+            if (FAILED(hrPayload))
+            {
+                m_Stats.cCorruptPackets++;
+                break;
+            }
+
+            if (fNewPayload)
+            {
+                iPayload++;
+            }
+
+            if (iPayload > cDone)
+            {
+                hr = AddPayload(payload, cbPacketOffset, info.dwSendTime);
+                if (FAILED(hr))
+                {
+                    return hr;
+                }
+            }
+        }
+
+        if (!fParseAgain)
+        {
+            break;
+        }
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: AddPayload
+//
+// Adds a payload to the bitrate profile of its stream and, if it
+// starts a media object, to the samples of the stream.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSparseScanner::AddPayload(const ASF_PAYLOAD_INFO& payload, QWORD cbPacketOffset, DWORD dwSendTime)
+{
+    m_Stats.cPayloads++;
+
+    HRESULT hr = AddToProfile(payload.bStreamNumber, dwSendTime, payload.cbData);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (!payload.fCompressed && (payload.dwOffsetIntoMediaObject != 0))
+    {
+        return S_OK;
+    }
+
+    ASF_SAMPLE_DESCRIPTOR sample;
+
+    sample.cbPacketOffset = cbPacketOffset;
+    sample.dwPresentationTime = payload.dwPresentationTime;
+    sample.cbMediaObjectSize = payload.cbMediaObjectSize;
+    sample.dwMediaObjectNumber = payload.dwMediaObjectNumber;
+    sample.bStreamNumber = payload.bStreamNumber;
+    sample.fKeyFrame = payload.fKeyFrame ? 1 : 0;
+
+    return m_Samples[payload.bStreamNumber].Append(sample);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: AddToProfile
+//
+// Adds payload bytes to the bucket of a send time, growing the
+// profile of the stream as needed.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSparseScanner::AddToProfile(BYTE bStreamNumber, DWORD dwSendTime, DWORD cbData)
+{
+    BITRATE_PROFILE& profile = m_Profiles[bStreamNumber];
+
+    DWORD iBucket = dwSendTime / m_dwBucketMs;
+
+    if (iBucket >= ASF_SPARSE_MAX_BUCKETS)
+    {
+        return S_OK;
+    }
+
+    if (iBucket >= profile.cCapacity)
+    {
+        DWORD cCapacity = (profile.cCapacity < 64) ? 64 : profile.cCapacity * 2;
+
+        if (cCapacity <= iBucket)
+        {
+            cCapacity = iBucket + 1;
+        }
+
+        QWORD* pcbBuckets = new (std::nothrow) QWORD[cCapacity];
+        if (!pcbBuckets)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        if (profile.cBuckets > 0)
+        {
+            memcpy(pcbBuckets, profile.pcbBuckets, profile.cBuckets * sizeof(QWORD));
+        }
+
+        delete [] profile.pcbBuckets;
+
+        profile.pcbBuckets = pcbBuckets;
+        profile.cCapacity = cCapacity;
+    }
+
+    if (iBucket >= profile.cBuckets)
+    {
+        memset(profile.pcbBuckets + profile.cBuckets, 0, (iBucket + 1 - profile.cBuckets) * sizeof(QWORD));
+        profile.cBuckets = iBucket + 1;
+    }
+
+    profile.pcbBuckets[iBucket] += cbData;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: BuildTimelines
+//
+// Packs the samples of every stream into its timeline and releases
+// the samples.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFSparseScanner::BuildTimelines()
+{
+    HRESULT hr = S_OK;
+
+    for (DWORD i = 0; SUCCEEDED(hr) && (i < ASF_MAX_STREAMS); i++)
+    {
+        if (m_Samples[i].GetCount() > 0)
+        {
+            hr = m_Timelines[i].Build(
+                m_Samples[i].GetData(),
+                m_Samples[i].GetCount(),
+                m_HeaderParser.GetDataOffset(),
+                m_PacketParser.GetPacketSize(),
+                m_FileInfo.hnspreroll
+                );
+        }
+
+        m_Samples[i].Clear();
+    }
+
+    return hr;
+}
@@ -0,0 +1,148 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFSparseScanner.h : CASFSparseScanner class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "PositionalFile.h"
+#include "ASFHeaderParser.h"
+#include "ASFPacketParser.h"
+#include "ASFTimeline.h"
+
+//Bytes read at the start of each packet by default. Holds the packet
+//header and, in most files, the first payload header.
+#define ASF_SPARSE_PREFIX_SIZE          64
+
+//Smallest prefix; the longest packet header is 37 bytes
+#define ASF_SPARSE_MIN_PREFIX_SIZE      64
+
+//Bytes read for a payload header past the prefix
+#define ASF_SPARSE_HEADER_READ_SIZE     64
+
+//Packets read in one batch
+#define ASF_SPARSE_BATCH_PACKETS        256
+
+//Packets smaller than this are read whole, a batch in one read: the
+//storage reads whole pages anyway, so prefixes would only add calls
+#define ASF_SPARSE_MIN_STRIDE           4096
+
+//Most bitrate buckets per stream; later send times are left out
+#define ASF_SPARSE_MAX_BUCKETS          0x100000
+
+//Default duration of a bitrate profile bucket
+#define ASF_SPARSE_BUCKET_MS            1000
+
+//I/O and results of the last scan
+struct ASF_SPARSE_SCAN_STATS
+{
+    QWORD   cbFile;
+    QWORD   cPackets;
+    QWORD   cCorruptPackets;
+    QWORD   cPayloads;          // Payloads, sub-payloads counted one by one
+    QWORD   cReads;             // All reads, the header included
+    QWORD   cbRead;
+    QWORD   cHeaderReads;       // Reads of payload headers past the packet prefix
+};
+
+
+//Scans the packet headers and payload headers of a file without reading
+//the payload data, for files too large to map or to read through.
+//
+//The file is read at explicit offsets: the header, then the first
+//bytes of every packet at the packet stride, a batch of packets at a
+//time. A payload header that is not within the bytes read so far is
+//read on its own, and the packet is parsed again. Compressed payloads
+//are read whole, since their sub-payload lengths lie between the
+//media objects. Packets smaller than ASF_SPARSE_MIN_STRIDE are read
+//whole, a batch in one read. Requires fixed-size data packets.
+//
+//The scan yields the same timelines as CASFReader::BuildTimelines and a
+//bitrate profile of every stream: payload bytes per bucket of send
+//time.
+
+class CASFSparseScanner
+{
+public:
+
+    CASFSparseScanner();
+    ~CASFSparseScanner();
+
+    //cbPrefix: bytes read per packet, 0 for ASF_SPARSE_PREFIX_SIZE
+    //dwBucketMs: bitrate bucket duration, 0 for ASF_SPARSE_BUCKET_MS
+    HRESULT Scan(const ASF_PATH_CHAR* sFileName, DWORD cbPrefix, DWORD dwBucketMs);
+
+    void Reset();
+
+    HRESULT GetFileProperties(FILE_PROPERTIES_OBJECT* pFileInfo) const
+    {
+        return m_HeaderParser.GetFileProperties(pFileInfo);
+    }
+
+    //Timeline of a stream, valid until the next Scan or Reset
+    HRESULT GetTimeline(WORD wStreamNumber, const CASFTimeline** ppTimeline) const;
+
+    //Payload bytes of a stream sent in each bucket of send time, bucket
+    //i covering [i, i + 1) * GetBucketDuration() ms. Send times include
+    //the preroll.
+    HRESULT GetBitrateProfile(WORD wStreamNumber, const QWORD** ppcbBuckets, DWORD* pcBuckets) const;
+
+    DWORD GetBucketDuration() const
+    {
+        return m_dwBucketMs;
+    }
+
+    void GetStats(ASF_SPARSE_SCAN_STATS* pStats) const
+    {
+        *pStats = m_Stats;
+    }
+
+private:
+
+    struct BITRATE_PROFILE
+    {
+        QWORD*  pcbBuckets;
+        DWORD   cBuckets;
+        DWORD   cCapacity;
+    };
+
+    //Not copyable
+    CASFSparseScanner(const CASFSparseScanner&);
+    CASFSparseScanner& operator=(const CASFSparseScanner&);
+
+    HRESULT ReadHeader();
+
+    HRESULT ReadExact(QWORD cbOffset, BYTE* pBuffer, DWORD cbToRead);
+
+    HRESULT ScanPacket(QWORD iPacket, const BYTE* pData, DWORD cbData);
+
+    HRESULT AddPayload(const ASF_PAYLOAD_INFO& payload, QWORD cbPacketOffset, DWORD dwSendTime);
+
+    HRESULT AddToProfile(BYTE bStreamNumber, DWORD dwSendTime, DWORD cbData);
+
+    HRESULT BuildTimelines();
+
+    CPositionalFile     m_File;
+    CASFHeaderParser    m_HeaderParser;     // References m_pHeader
+    CASFPacketParser    m_PacketParser;
+    FILE_PROPERTIES_OBJECT  m_FileInfo;
+
+    BYTE*               m_pHeader;          // Header Object and Data Object header
+    BYTE*               m_pPacket;          // Packet pieces read so far, at their offsets
+    DWORD               m_cbPrefix;
+    DWORD               m_dwBucketMs;
+
+    CASFSampleList      m_Samples[ASF_MAX_STREAMS];     // Released once the timelines are built
+    CASFTimeline        m_Timelines[ASF_MAX_STREAMS];
+    BITRATE_PROFILE     m_Profiles[ASF_MAX_STREAMS];
+
+    ASF_SPARSE_SCAN_STATS   m_Stats;
+};
@@ -0,0 +1,433 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFThread.cpp : CASFThread class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "ASFThread.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFThread
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFThread::CASFThread()
+:   m_fStarted (FALSE),
+    m_pfnThreadProc (NULL),
+    m_pContext (NULL)
+{
+#ifdef _WIN32
+    m_hThread = NULL;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFThread
+//  Description: Destructor. Waits for the thread to finish.
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFThread::~CASFThread()
+{
+    Join();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Start
+//
+// Starts a thread that calls pfnThreadProc(pContext).
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFThread::Start(PFN_THREAD_PROC pfnThreadProc, void* pContext)
+{
+    if (!pfnThreadProc)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (m_fStarted)
+    {
+        return MF_E_INVALIDREQUEST;
+    }
+
+    m_pfnThreadProc = pfnThreadProc;
+    m_pContext = pContext;
+
+#ifdef _WIN32
+    m_hThread = CreateThread(NULL, 0, ThreadProc, (void*)this, 0, NULL);
+
+    if (!m_hThread)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+#else
+    int err = pthread_create(&m_hThread, NULL, ThreadProc, (void*)this);
+
+    if (err != 0)
+    {
+        return HRESULT_FROM_WIN32(err);
+    }
+#endif
+
+    m_fStarted = TRUE;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Join
+//
+// Waits for the thread to finish. Does nothing if it was not started.
+/////////////////////////////////////////////////////////////////////
+
+void CASFThread::Join()
+{
+    if (!m_fStarted)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    WaitForSingleObject(m_hThread, INFINITE);
+    CloseHandle(m_hThread);
+    m_hThread = NULL;
+#else
+    pthread_join(m_hThread, NULL);
+#endif
+
+    m_fStarted = FALSE;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetProcessorCount
+//
+// Returns the number of logical processors, at least 1.
+/////////////////////////////////////////////////////////////////////
+
+DWORD CASFThread::GetProcessorCount()
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+
+    return (si.dwNumberOfProcessors > 0) ? si.dwNumberOfProcessors : 1;
+#else
+    long cProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (cProcessors > 0) ? (DWORD)cProcessors : 1;
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: YieldThread
+//
+// Lets another ready thread run. Used by waits that poll.
+/////////////////////////////////////////////////////////////////////
+
+void CASFThread::YieldThread()
+{
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: SleepThread
+//
+// Suspends the calling thread. Used by waits that can take longer
+// than a few time slices.
+/////////////////////////////////////////////////////////////////////
+
+void CASFThread::SleepThread(DWORD dwMilliseconds)
+{
+#ifdef _WIN32
+    Sleep(dwMilliseconds);
+#else
+    struct timespec ts;
+
+    ts.tv_sec = dwMilliseconds / 1000;
+    ts.tv_nsec = (long)(dwMilliseconds % 1000) * 1000000;
+
+    while ((nanosleep(&ts, &ts) != 0) && (errno == EINTR))
+    {
+    }
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetTimestamp
+//
+// Returns a monotonic timestamp in 100-nanosecond units.
+/////////////////////////////////////////////////////////////////////
+
+LONGLONG CASFThread::GetTimestamp()
+{
+#ifdef _WIN32
+    static LARGE_INTEGER liFrequency = { 0 };
+    LARGE_INTEGER liCounter;
+
+    if (liFrequency.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&liFrequency);
+    }
+
+    QueryPerformanceCounter(&liCounter);
+
+    return (LONGLONG)((double)liCounter.QuadPart * 10000000.0 / (double)liFrequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (LONGLONG)ts.tv_sec * 10000000 + ts.tv_nsec / 100;
+#endif
+}
+
+// ----- Private Methods -----------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Name: ThreadProc
+// Desc: Entry point of the thread.
+//
+// Note: This is a static method. It calls through to the stored procedure.
+//-----------------------------------------------------------------------------
+
+#ifdef _WIN32
+DWORD WINAPI CASFThread::ThreadProc(LPVOID lpParameter)
+#else
+void* CASFThread::ThreadProc(void* lpParameter)
+#endif
+{
+    CASFThread* pThis = (CASFThread*)lpParameter;
+
+    pThis->m_pfnThreadProc(pThis->m_pContext);
+
+    return 0;
+}
+
+
+// ----- CASFLock -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFLock
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFLock::CASFLock()
+{
+#ifdef _WIN32
+    InitializeCriticalSection(&m_cs);
+#else
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&m_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFLock
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFLock::~CASFLock()
+{
+#ifdef _WIN32
+    DeleteCriticalSection(&m_cs);
+#else
+    pthread_mutex_destroy(&m_mutex);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Lock
+//
+// Waits for the lock. The owner can lock again; each Lock needs an
+// Unlock.
+/////////////////////////////////////////////////////////////////////
+
+void CASFLock::Lock()
+{
+#ifdef _WIN32
+    EnterCriticalSection(&m_cs);
+#else
+    pthread_mutex_lock(&m_mutex);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Unlock
+//
+// Releases one Lock of the calling thread.
+/////////////////////////////////////////////////////////////////////
+
+void CASFLock::Unlock()
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&m_cs);
+#else
+    pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+
+// ----- CASFEvent -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFEvent
+//  Description: Constructor. The event starts out clear.
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFEvent::CASFEvent(BOOL fManualReset)
+{
+#ifdef _WIN32
+    m_hEvent = CreateEvent(NULL, fManualReset, FALSE, NULL);
+#else
+    m_fManualReset = fManualReset;
+    m_fSignaled = FALSE;
+
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_cond, NULL);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFEvent
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFEvent::~CASFEvent()
+{
+#ifdef _WIN32
+    if (m_hEvent)
+    {
+        CloseHandle(m_hEvent);
+    }
+#else
+    pthread_cond_destroy(&m_cond);
+    pthread_mutex_destroy(&m_mutex);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Set
+//
+// Sets the event and wakes the waiters.
+/////////////////////////////////////////////////////////////////////
+
+void CASFEvent::Set()
+{
+#ifdef _WIN32
+    SetEvent(m_hEvent);
+#else
+    pthread_mutex_lock(&m_mutex);
+
+    m_fSignaled = TRUE;
+
+    if (m_fManualReset)
+    {
+        pthread_cond_broadcast(&m_cond);
+    }
+    else
+    {
+        pthread_cond_signal(&m_cond);
+    }
+
+    pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Reset
+//
+// Clears the event.
+/////////////////////////////////////////////////////////////////////
+
+void CASFEvent::Reset()
+{
+#ifdef _WIN32
+    ResetEvent(m_hEvent);
+#else
+    pthread_mutex_lock(&m_mutex);
+    m_fSignaled = FALSE;
+    pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Wait
+//
+// Waits until the event is set. An auto-reset event is cleared again
+// for the thread that is released.
+//
+// dwMilliseconds: Timeout, or ASF_WAIT_INFINITE
+/////////////////////////////////////////////////////////////////////
+
+BOOL CASFEvent::Wait(DWORD dwMilliseconds)
+{
+#ifdef _WIN32
+    return (WaitForSingleObject(m_hEvent, dwMilliseconds) == WAIT_OBJECT_0);
+#else
+    struct timespec ts;
+
+    if (dwMilliseconds != ASF_WAIT_INFINITE)
+    {
+        clock_gettime(CLOCK_REALTIME, &ts);
+
+        ts.tv_sec += dwMilliseconds / 1000;
+        ts.tv_nsec += (long)(dwMilliseconds % 1000) * 1000000;
+
+        if (ts.tv_nsec >= 1000000000)
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+    }
+
+    pthread_mutex_lock(&m_mutex);
+
+    while (!m_fSignaled)
+    {
+        if (dwMilliseconds == ASF_WAIT_INFINITE)
+        {
+            pthread_cond_wait(&m_cond, &m_mutex);
+        }
+        else if (pthread_cond_timedwait(&m_cond, &m_mutex, &ts) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+
+    BOOL fSignaled = m_fSignaled;
+
+    if (fSignaled && !m_fManualReset)
+    {
+        m_fSignaled = FALSE;
+    }
+
+    pthread_mutex_unlock(&m_mutex);
+
+    return fSignaled;
+#endif
+}
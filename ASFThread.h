@@ -0,0 +1,209 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFThread.h : CASFThread class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFTypes.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+//Loads and stores with acquire/release ordering, for data shared by
+//two threads without a lock: writes made before a store are visible to
+//the thread that loads the stored value.
+
+inline DWORD ASFLoadAcquire(volatile LONG* pValue)
+{
+#ifdef _WIN32
+    return (DWORD)InterlockedCompareExchange(pValue, 0, 0);
+#else
+    return (DWORD)__atomic_load_n(pValue, __ATOMIC_ACQUIRE);
+#endif
+}
+
+inline void ASFStoreRelease(volatile LONG* pValue, DWORD dwValue)
+{
+#ifdef _WIN32
+    InterlockedExchange(pValue, (LONG)dwValue);
+#else
+    __atomic_store_n(pValue, (LONG)dwValue, __ATOMIC_RELEASE);
+#endif
+}
+
+//Reference counts of objects shared by several threads
+
+inline LONG ASFInterlockedIncrement(volatile LONG* pValue)
+{
+#ifdef _WIN32
+    return InterlockedIncrement(pValue);
+#else
+    return __atomic_add_fetch(pValue, 1, __ATOMIC_SEQ_CST);
+#endif
+}
+
+inline LONG ASFInterlockedDecrement(volatile LONG* pValue)
+{
+#ifdef _WIN32
+    return InterlockedDecrement(pValue);
+#else
+    return __atomic_sub_fetch(pValue, 1, __ATOMIC_SEQ_CST);
+#endif
+}
+
+//Timeout of a wait that does not time out
+#define ASF_WAIT_INFINITE       0xFFFFFFFF
+
+
+//Worker thread for the native ASF components: Win32 threads on
+//Windows, POSIX threads elsewhere.
+
+class CASFThread
+{
+public:
+
+    typedef void (*PFN_THREAD_PROC)(void* pContext);
+
+    CASFThread();
+    ~CASFThread();
+
+    HRESULT Start(PFN_THREAD_PROC pfnThreadProc, void* pContext);
+
+    void Join();
+
+    BOOL IsRunning() const
+    {
+        return m_fStarted;
+    }
+
+    static DWORD GetProcessorCount();
+
+    //Gives up the rest of the time slice of the calling thread
+    static void YieldThread();
+
+    //Suspends the calling thread for at least dwMilliseconds
+    static void SleepThread(DWORD dwMilliseconds);
+
+    //Monotonic timestamp in 100-nanosecond units
+    static LONGLONG GetTimestamp();
+
+private:
+
+    //Not copyable
+    CASFThread(const CASFThread&);
+    CASFThread& operator=(const CASFThread&);
+
+#ifdef _WIN32
+    static DWORD WINAPI ThreadProc(LPVOID lpParameter);
+
+    HANDLE          m_hThread;
+#else
+    static void* ThreadProc(void* lpParameter);
+
+    pthread_t       m_hThread;
+#endif
+
+    BOOL            m_fStarted;
+    PFN_THREAD_PROC m_pfnThreadProc;
+    void*           m_pContext;
+};
+
+
+//Recursive lock: a critical section on Windows, a POSIX mutex
+//elsewhere. The owner may take it again, so a callback that runs on
+//the locking thread can lock the same object.
+
+class CASFLock
+{
+public:
+
+    CASFLock();
+    ~CASFLock();
+
+    void Lock();
+
+    void Unlock();
+
+private:
+
+    //Not copyable
+    CASFLock(const CASFLock&);
+    CASFLock& operator=(const CASFLock&);
+
+#ifdef _WIN32
+    CRITICAL_SECTION    m_cs;
+#else
+    pthread_mutex_t     m_mutex;
+#endif
+};
+
+
+//Holds a CASFLock for the lifetime of the object
+
+class CASFAutoLock
+{
+public:
+
+    CASFAutoLock(CASFLock& lock)
+    :   m_Lock (lock)
+    {
+        m_Lock.Lock();
+    }
+
+    ~CASFAutoLock()
+    {
+        m_Lock.Unlock();
+    }
+
+private:
+
+    CASFAutoLock(const CASFAutoLock&);
+    CASFAutoLock& operator=(const CASFAutoLock&);
+
+    CASFLock&   m_Lock;
+};
+
+
+//Event a thread can block on: an event object on Windows, a condition
+//variable elsewhere. A manual-reset event stays set until Reset; an
+//auto-reset event releases one waiter and clears itself.
+
+class CASFEvent
+{
+public:
+
+    CASFEvent(BOOL fManualReset);
+    ~CASFEvent();
+
+    void Set();
+
+    void Reset();
+
+    //Returns FALSE if the event was not set within dwMilliseconds
+    BOOL Wait(DWORD dwMilliseconds);
+
+private:
+
+    //Not copyable
+    CASFEvent(const CASFEvent&);
+    CASFEvent& operator=(const CASFEvent&);
+
+#ifdef _WIN32
+    HANDLE              m_hEvent;
+#else
+    pthread_mutex_t     m_mutex;
+    pthread_cond_t      m_cond;
+    BOOL                m_fManualReset;
+    BOOL                m_fSignaled;
+#endif
+};
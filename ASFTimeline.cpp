@@ -0,0 +1,444 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFTimeline.cpp : CASFTimeline class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include "ASFTimeline.h"
+
+//Field masks and offsets of an entry
+#define TIME_MASK       ((1ULL << ASF_TIMELINE_TIME_BITS) - 1)
+#define TIME_BIAS       (1LL << (ASF_TIMELINE_TIME_BITS - 1))
+#define PACKET_SHIFT    ASF_TIMELINE_TIME_BITS
+#define PACKET_MASK     ((1ULL << ASF_TIMELINE_PACKET_BITS) - 1)
+#define SIZE_SHIFT      (ASF_TIMELINE_TIME_BITS + ASF_TIMELINE_PACKET_BITS)
+#define SIZE_MASK       ((1ULL << ASF_TIMELINE_SIZE_BITS) - 1)
+#define KEY_SHIFT       (SIZE_SHIFT + ASF_TIMELINE_SIZE_BITS)
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CASFTimeline
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFTimeline::CASFTimeline()
+:   m_pEntries (NULL),
+    m_cEntries (0),
+    m_pBlocks (NULL),
+    m_cBlocks (0),
+    m_pLargeSizes (NULL),
+    m_cLargeSizes (0),
+    m_cbFirstPacketOffset (0),
+    m_cbPacketSize (0),
+    m_hnsPreroll (0)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFTimeline
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFTimeline::~CASFTimeline()
+{
+    Reset();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Build
+//
+// Packs the samples of one stream, in file order. The first pass
+// lays out the blocks, the second fills them, so every array is
+// allocated once at its final size.
+//
+// pSamples: Samples of the stream from a scan of the Data Object
+// cSamples: Number of samples
+// cbFirstPacketOffset: File offset of the first data packet
+// cbPacketSize: Size of the data packets
+// hnsPreroll: Preroll of the file, in hns
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFTimeline::Build(
+    const ASF_SAMPLE_DESCRIPTOR* pSamples,
+    DWORD cSamples,
+    QWORD cbFirstPacketOffset,
+    DWORD cbPacketSize,
+    QWORD hnsPreroll
+    )
+{
+    if (!pSamples && (cSamples > 0))
+    {
+        return E_POINTER;
+    }
+
+    if (cbPacketSize == 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    Reset();
+
+    m_cbFirstPacketOffset = cbFirstPacketOffset;
+    m_cbPacketSize = cbPacketSize;
+    m_hnsPreroll = hnsPreroll;
+
+    TIMELINE_BLOCK block = TIMELINE_BLOCK();
+
+    DWORD cBlocks = 0;
+    DWORD cLargeSizes = 0;
+
+    for (DWORD i = 0; i < cSamples; i++)
+    {
+        if (pSamples[i].cbPacketOffset < cbFirstPacketOffset)
+        {
+            return MF_E_ASF_INVALIDDATA;
+        }
+
+        QWORD iPacket = (pSamples[i].cbPacketOffset - cbFirstPacketOffset) / cbPacketSize;
+
+        if ((cBlocks == 0) || !FitsBlock(block, i, pSamples[i].dwPresentationTime, iPacket))
+        {
+            block.iFirstPacket = iPacket;
+            block.iFirstEntry = i;
+            block.dwBaseTime = pSamples[i].dwPresentationTime;
+
+            cBlocks++;
+        }
+
+        if (pSamples[i].cbMediaObjectSize >= SIZE_MASK)
+        {
+            cLargeSizes++;
+        }
+    }
+
+    if (cSamples > 0)
+    {
+        m_pEntries = new (std::nothrow) QWORD[cSamples];
+        m_pBlocks = new (std::nothrow) TIMELINE_BLOCK[cBlocks];
+
+        if (!m_pEntries || !m_pBlocks)
+        {
+            Reset();
+            return E_OUTOFMEMORY;
+        }
+    }
+
+    if (cLargeSizes > 0)
+    {
+        m_pLargeSizes = new (std::nothrow) LARGE_SIZE[cLargeSizes];
+
+        if (!m_pLargeSizes)
+        {
+            Reset();
+            return E_OUTOFMEMORY;
+        }
+    }
+
+    DWORD dwMaxTime = 0;
+
+    for (DWORD i = 0; i < cSamples; i++)
+    {
+        const ASF_SAMPLE_DESCRIPTOR& sample = pSamples[i];
+
+        QWORD iPacket = (sample.cbPacketOffset - cbFirstPacketOffset) / cbPacketSize;
+
+        if ((m_cBlocks == 0) || !FitsBlock(m_pBlocks[m_cBlocks - 1], i, sample.dwPresentationTime, iPacket))
+        {
+            TIMELINE_BLOCK& next = m_pBlocks[m_cBlocks++];
+
+            next.iFirstPacket = iPacket;
+            next.iFirstEntry = i;
+            next.dwBaseTime = sample.dwPresentationTime;
+            next.dwMaxTime = dwMaxTime;
+            next.cKeyFrames = 0;
+        }
+
+        TIMELINE_BLOCK& current = m_pBlocks[m_cBlocks - 1];
+
+        QWORD cbSizeField = sample.cbMediaObjectSize;
+
+        if (cbSizeField >= SIZE_MASK)
+        {
+            m_pLargeSizes[m_cLargeSizes].iEntry = i;
+            m_pLargeSizes[m_cLargeSizes].cbSize = sample.cbMediaObjectSize;
+            m_cLargeSizes++;
+
+            cbSizeField = SIZE_MASK;
+        }
+
+        QWORD qwTime = (QWORD)((LONGLONG)sample.dwPresentationTime - (LONGLONG)current.dwBaseTime + TIME_BIAS);
+
+        m_pEntries[i] =
+            qwTime |
+            ((iPacket - current.iFirstPacket) << PACKET_SHIFT) |
+            (cbSizeField << SIZE_SHIFT) |
+            ((QWORD)(sample.fKeyFrame ? 1 : 0) << KEY_SHIFT);
+
+        if (sample.dwPresentationTime > dwMaxTime)
+        {
+            dwMaxTime = sample.dwPresentationTime;
+        }
+
+        current.dwMaxTime = dwMaxTime;
+
+        if (sample.fKeyFrame)
+        {
+            current.cKeyFrames++;
+        }
+    }
+
+    m_cEntries = cSamples;
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Reset
+//
+// Releases the table.
+/////////////////////////////////////////////////////////////////////
+
+void CASFTimeline::Reset()
+{
+    delete [] m_pEntries;
+    delete [] m_pBlocks;
+    delete [] m_pLargeSizes;
+
+    m_pEntries = NULL;
+    m_pBlocks = NULL;
+    m_pLargeSizes = NULL;
+
+    m_cEntries = 0;
+    m_cBlocks = 0;
+    m_cLargeSizes = 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetEntry
+//
+// Decodes the sample at an index.
+//
+// dwIndex: Index of the sample in file order
+// pEntry: Receives the sample
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFTimeline::GetEntry(DWORD dwIndex, ASF_TIMELINE_ENTRY* pEntry) const
+{
+    if (!pEntry)
+    {
+        return E_POINTER;
+    }
+
+    if (dwIndex >= m_cEntries)
+    {
+        return E_INVALIDARG;
+    }
+
+    DecodeEntry(m_pBlocks[FindBlock(dwIndex)], dwIndex, pEntry);
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: FindByTime
+//
+// The first block whose running maximum reaches the time holds the
+// first sample at or after it; the search scans on from there. Blocks
+// without key frames are skipped whole in key frame searches.
+//
+// hnsTime: Presentation time without the preroll
+// fKeyFrame: Only key frames qualify
+// pdwIndex: Receives the index of the sample
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFTimeline::FindByTime(MFTIME hnsTime, BOOL fKeyFrame, DWORD* pdwIndex) const
+{
+    if (!pdwIndex)
+    {
+        return E_POINTER;
+    }
+
+    *pdwIndex = m_cEntries;
+
+    // Smallest time in ms that is presented at or after hnsTime
+    QWORD qwTarget = 0;
+
+    if (hnsTime > 0)
+    {
+        qwTarget = ((QWORD)hnsTime + m_hnsPreroll + 9999) / 10000;
+    }
+
+    if (qwTarget > 0xFFFFFFFF)
+    {
+        return S_FALSE;
+    }
+
+    DWORD dwTarget = (DWORD)qwTarget;
+
+    DWORD iLow = 0;
+    DWORD iHigh = m_cBlocks;
+
+    while (iLow < iHigh)
+    {
+        DWORD iMid = iLow + (iHigh - iLow) / 2;
+
+        if (m_pBlocks[iMid].dwMaxTime < dwTarget)
+        {
+            iLow = iMid + 1;
+        }
+        else
+        {
+            iHigh = iMid;
+        }
+    }
+
+    for (DWORD iBlock = iLow; iBlock < m_cBlocks; iBlock++)
+    {
+        const TIMELINE_BLOCK& block = m_pBlocks[iBlock];
+
+        if (fKeyFrame && (block.cKeyFrames == 0))
+        {
+            continue;
+        }
+
+        DWORD iEnd = (iBlock + 1 < m_cBlocks) ? m_pBlocks[iBlock + 1].iFirstEntry : m_cEntries;
+
+        for (DWORD i = block.iFirstEntry; i < iEnd; i++)
+        {
+            if (fKeyFrame && !(m_pEntries[i] >> KEY_SHIFT))
+            {
+                continue;
+            }
+
+            if (GetEntryTime(block, i) >= dwTarget)
+            {
+                *pdwIndex = i;
+                return S_OK;
+            }
+        }
+    }
+
+    return S_FALSE;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetMemorySize
+//
+// Returns the size of the entries, block headers and large sizes.
+/////////////////////////////////////////////////////////////////////
+
+QWORD CASFTimeline::GetMemorySize() const
+{
+    return (QWORD)m_cEntries * sizeof(QWORD) +
+           (QWORD)m_cBlocks * sizeof(TIMELINE_BLOCK) +
+           (QWORD)m_cLargeSizes * sizeof(LARGE_SIZE);
+}
+
+// ----- Private Methods -----------------------------------------------
+
+/////////////////////////////////////////////////////////////////////
+// Name: FitsBlock
+//
+// Returns TRUE if a sample can be stored in a block.
+/////////////////////////////////////////////////////////////////////
+
+BOOL CASFTimeline::FitsBlock(const TIMELINE_BLOCK& block, DWORD iEntry, DWORD dwTime, QWORD iPacket) const
+{
+    LONGLONG llTime = (LONGLONG)dwTime - (LONGLONG)block.dwBaseTime;
+
+    return (iEntry - block.iFirstEntry < ASF_TIMELINE_BLOCK_SIZE) &&
+           (llTime >= -TIME_BIAS) && (llTime < TIME_BIAS) &&
+           (iPacket - block.iFirstPacket <= PACKET_MASK);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: FindBlock
+//
+// Returns the block that holds an entry.
+/////////////////////////////////////////////////////////////////////
+
+DWORD CASFTimeline::FindBlock(DWORD dwIndex) const
+{
+    DWORD iLow = 0;
+    DWORD iHigh = m_cBlocks;
+
+    // Last block that starts at or before the entry
+    while (iHigh - iLow > 1)
+    {
+        DWORD iMid = iLow + (iHigh - iLow) / 2;
+
+        if (m_pBlocks[iMid].iFirstEntry <= dwIndex)
+        {
+            iLow = iMid;
+        }
+        else
+        {
+            iHigh = iMid;
+        }
+    }
+
+    return iLow;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetEntryTime
+//
+// Returns the time of an entry in ms, with the preroll.
+/////////////////////////////////////////////////////////////////////
+
+DWORD CASFTimeline::GetEntryTime(const TIMELINE_BLOCK& block, DWORD dwIndex) const
+{
+    LONGLONG llDelta = (LONGLONG)(m_pEntries[dwIndex] & TIME_MASK) - TIME_BIAS;
+
+    return (DWORD)((LONGLONG)block.dwBaseTime + llDelta);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: DecodeEntry
+//
+// Unpacks an entry of a block.
+/////////////////////////////////////////////////////////////////////
+
+void CASFTimeline::DecodeEntry(const TIMELINE_BLOCK& block, DWORD dwIndex, ASF_TIMELINE_ENTRY* pEntry) const
+{
+    QWORD qwEntry = m_pEntries[dwIndex];
+
+    MFTIME hnsTime = (MFTIME)GetEntryTime(block, dwIndex) * 10000 - (MFTIME)m_hnsPreroll;
+
+    pEntry->hnsTime = (hnsTime > 0) ? hnsTime : 0;
+    pEntry->cbPacketOffset = m_cbFirstPacketOffset + (block.iFirstPacket + ((qwEntry >> PACKET_SHIFT) & PACKET_MASK)) * m_cbPacketSize;
+    pEntry->cbSize = (DWORD)((qwEntry >> SIZE_SHIFT) & SIZE_MASK);
+    pEntry->fKeyFrame = (BOOL)(qwEntry >> KEY_SHIFT);
+
+    if (pEntry->cbSize == SIZE_MASK)
+    {
+        DWORD iLow = 0;
+        DWORD iHigh = m_cLargeSizes;
+
+        while (iLow < iHigh)
+        {
+            DWORD iMid = iLow + (iHigh - iLow) / 2;
+
+            if (m_pLargeSizes[iMid].iEntry < dwIndex)
+            {
+                iLow = iMid + 1;
+            }
+            else
+            {
+                iHigh = iMid;
+            }
+        }
+
+        pEntry->cbSize = m_pLargeSizes[iLow].cbSize;
+    }
+}
@@ -0,0 +1,119 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFTimeline.h : CASFTimeline class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFSampleList.h"
+
+//Most entries per block
+#define ASF_TIMELINE_BLOCK_SIZE         64
+
+//Entry fields, packed into 64 bits
+#define ASF_TIMELINE_TIME_BITS          22      // Signed ms from the block base time
+#define ASF_TIMELINE_PACKET_BITS        20      // Packets after the first packet of the block
+#define ASF_TIMELINE_SIZE_BITS          21      // All ones: see the large size table
+
+//A sample of a timeline, decoded
+struct ASF_TIMELINE_ENTRY
+{
+    MFTIME  hnsTime;            // Presentation time without the preroll
+    QWORD   cbPacketOffset;     // File offset of the packet that starts the object
+    DWORD   cbSize;
+    BOOL    fKeyFrame;
+};
+
+
+//Sample table of one stream over the whole file, packed for memory and
+//cache use: 8 bytes per sample plus a 24-byte block header per
+//ASF_TIMELINE_BLOCK_SIZE samples.
+//
+//Each entry holds its time and packet relative to the base of its
+//block, its size and its key flag. A block ends early when an entry
+//does not fit; sizes too large for their field are kept in a side
+//table. Blocks also carry the running maximum of the times, so a time
+//search is a binary search over the blocks followed by a short scan,
+//even where times go backwards.
+
+class CASFTimeline
+{
+public:
+
+    CASFTimeline();
+    ~CASFTimeline();
+
+    HRESULT Build(
+        const ASF_SAMPLE_DESCRIPTOR* pSamples,
+        DWORD cSamples,
+        QWORD cbFirstPacketOffset,
+        DWORD cbPacketSize,
+        QWORD hnsPreroll
+        );
+
+    void Reset();
+
+    DWORD GetCount() const
+    {
+        return m_cEntries;
+    }
+
+    HRESULT GetEntry(DWORD dwIndex, ASF_TIMELINE_ENTRY* pEntry) const;
+
+    //First sample, in file order, presented at or after hnsTime, or the
+    //first key frame. S_FALSE if there is none.
+    HRESULT FindByTime(MFTIME hnsTime, BOOL fKeyFrame, DWORD* pdwIndex) const;
+
+    //Bytes allocated for the table
+    QWORD GetMemorySize() const;
+
+private:
+
+    struct TIMELINE_BLOCK
+    {
+        QWORD   iFirstPacket;
+        DWORD   iFirstEntry;
+        DWORD   dwBaseTime;         // Milliseconds, includes the preroll
+        DWORD   dwMaxTime;          // Largest time up to the end of the block
+        DWORD   cKeyFrames;
+    };
+
+    struct LARGE_SIZE
+    {
+        DWORD   iEntry;
+        DWORD   cbSize;
+    };
+
+    //Not copyable
+    CASFTimeline(const CASFTimeline&);
+    CASFTimeline& operator=(const CASFTimeline&);
+
+    BOOL FitsBlock(const TIMELINE_BLOCK& block, DWORD iEntry, DWORD dwTime, QWORD iPacket) const;
+
+    DWORD FindBlock(DWORD dwIndex) const;
+
+    void DecodeEntry(const TIMELINE_BLOCK& block, DWORD dwIndex, ASF_TIMELINE_ENTRY* pEntry) const;
+
+    DWORD GetEntryTime(const TIMELINE_BLOCK& block, DWORD dwIndex) const;
+
+    QWORD*          m_pEntries;
+    DWORD           m_cEntries;
+
+    TIMELINE_BLOCK* m_pBlocks;
+    DWORD           m_cBlocks;
+
+    LARGE_SIZE*     m_pLargeSizes;      // Sorted by entry
+    DWORD           m_cLargeSizes;
+
+    QWORD           m_cbFirstPacketOffset;
+    DWORD           m_cbPacketSize;
+    QWORD           m_hnsPreroll;
+};
@@ -0,0 +1,157 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFTypes.h : Portable base types shared by the native ASF components.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+//On Windows the native ASF components use the SDK types directly.
+//Everywhere else the subset they need is declared here so the same
+//sources compile without the Windows and Media Foundation headers.
+
+#ifdef _WIN32
+
+#include <windows.h>
+#include <mfapi.h>
+#include <mferror.h>
+
+typedef WCHAR ASF_PATH_CHAR;
+
+#else
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef int32_t     HRESULT;
+typedef int32_t     BOOL;
+typedef uint8_t     BYTE;
+typedef uint16_t    WORD;
+typedef uint32_t    DWORD;
+typedef uint64_t    QWORD;
+typedef int32_t     LONG;
+typedef uint32_t    ULONG;
+typedef uint32_t    UINT;
+typedef int32_t     INT32;
+typedef uint32_t    UINT32;
+typedef uint64_t    UINT64;
+typedef int64_t     LONGLONG;
+typedef uint64_t    ULONGLONG;
+typedef LONGLONG    MFTIME;
+typedef wchar_t     WCHAR;
+
+typedef char        ASF_PATH_CHAR;
+
+#ifndef TRUE
+#define TRUE    1
+#endif
+
+#ifndef FALSE
+#define FALSE   0
+#endif
+
+#define MAXDWORD    0xffffffff
+
+typedef struct _GUID
+{
+    DWORD   Data1;
+    WORD    Data2;
+    WORD    Data3;
+    BYTE    Data4[8];
+} GUID;
+
+typedef GUID CLSID;
+
+inline bool operator==(const GUID& guid1, const GUID& guid2)
+{
+    return memcmp(&guid1, &guid2, sizeof(GUID)) == 0;
+}
+
+inline bool operator!=(const GUID& guid1, const GUID& guid2)
+{
+    return !(guid1 == guid2);
+}
+
+static const GUID GUID_NULL = { 0, 0, 0, { 0, 0, 0, 0, 0, 0, 0, 0 } };
+
+typedef struct _FILETIME
+{
+    DWORD dwLowDateTime;
+    DWORD dwHighDateTime;
+} FILETIME;
+
+#define SUCCEEDED(hr)   (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)      (((HRESULT)(hr)) < 0)
+
+#define HRESULT_FROM_WIN32(x) \
+    ((HRESULT)(x) <= 0 ? ((HRESULT)(x)) : ((HRESULT)(((x) & 0x0000FFFF) | 0x80070000)))
+
+#define S_OK                            ((HRESULT)0x00000000)
+#define S_FALSE                         ((HRESULT)0x00000001)
+#define E_NOTIMPL                       ((HRESULT)0x80004001)
+#define E_PENDING                       ((HRESULT)0x8000000A)
+#define E_POINTER                       ((HRESULT)0x80004003)
+#define E_ABORT                         ((HRESULT)0x80004004)
+#define E_FAIL                          ((HRESULT)0x80004005)
+#define E_UNEXPECTED                    ((HRESULT)0x8000FFFF)
+#define E_ACCESSDENIED                  ((HRESULT)0x80070005)
+#define E_OUTOFMEMORY                   ((HRESULT)0x8007000E)
+#define E_INVALIDARG                    ((HRESULT)0x80070057)
+
+#define MF_E_BUFFERTOOSMALL             ((HRESULT)0xC00D36B1)
+#define MF_E_INVALIDREQUEST             ((HRESULT)0xC00D36B2)
+#define MF_E_INVALIDSTREAMNUMBER        ((HRESULT)0xC00D36B3)
+#define MF_E_INVALIDMEDIATYPE           ((HRESULT)0xC00D36B4)
+#define MF_E_NOT_INITIALIZED            ((HRESULT)0xC00D36B6)
+#define MF_E_INVALID_FILE_FORMAT        ((HRESULT)0xC00D36BE)
+#define MF_E_INVALIDINDEX               ((HRESULT)0xC00D36BF)
+#define MF_E_NOT_FOUND                  ((HRESULT)0xC00D36D5)
+#define MF_E_SHUTDOWN                   ((HRESULT)0xC00D3E85)
+#define MF_E_ASF_PARSINGINCOMPLETE      ((HRESULT)0xC00D4A38)
+#define MF_E_ASF_INVALIDDATA            ((HRESULT)0xC00D4A3A)
+#define MF_E_ASF_NOINDEX                ((HRESULT)0xC00D4A3C)
+#define MF_E_ASF_OUTOFRANGE             ((HRESULT)0xC00D4A3D)
+
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////
+//  FILE_PROPERTIES_OBJECT
+//  Global file attributes from the ASF File Properties Object.
+/////////////////////////////////////////////////////////////////////////
+
+struct FILE_PROPERTIES_OBJECT
+{
+    GUID guidFileID;
+    FILETIME ftCreationTime;
+    UINT32 MaxBitRate;
+    UINT32 cbMaxPacketSize;
+    UINT32 cbMinPacketSize;
+    UINT32 cPackets;
+    UINT64 hnsPlayDuration;
+    UINT64 hnsSendDuration;
+    UINT32 flags;
+    UINT64 hnspreroll;
+    UINT64 hnsPresentationDuration;
+
+    FILE_PROPERTIES_OBJECT()
+        :
+    MaxBitRate(0),
+    cbMaxPacketSize(0),
+    cbMinPacketSize(0),
+    cPackets(0),
+    hnsPlayDuration(0),
+    hnsSendDuration(0),
+    flags(0),
+    hnspreroll(0),
+    hnsPresentationDuration(0)
+    {}
+};
@@ -0,0 +1,251 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFWaveFileSink.cpp : CASFWaveFileSink class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include <errno.h>
+#include <string.h>
+#include "ASFWaveFileSink.h"
+
+#define ASF_WAVE_FORMAT_PCM     1
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: PutDword, PutWord
+//  Description: Store little-endian values in a header.
+//
+/////////////////////////////////////////////////////////////////////////
+
+static BYTE* PutDword(BYTE* p, DWORD dwValue)
+{
+    p[0] = (BYTE)dwValue;
+    p[1] = (BYTE)(dwValue >> 8);
+    p[2] = (BYTE)(dwValue >> 16);
+    p[3] = (BYTE)(dwValue >> 24);
+
+    return p + 4;
+}
+
+static BYTE* PutWord(BYTE* p, WORD wValue)
+{
+    p[0] = (BYTE)wValue;
+    p[1] = (BYTE)(wValue >> 8);
+
+    return p + 2;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: SeekFile
+//  Description: Sets the file position from the start of the file. The
+//               offset may be past 2 GB, where fseek takes a long that
+//               is 32 bits on Windows.
+//
+/////////////////////////////////////////////////////////////////////////
+
+static int SeekFile(FILE* pFile, QWORD cbOffset)
+{
+#ifdef _WIN32
+    return _fseeki64(pFile, (__int64)cbOffset, SEEK_SET);
+#else
+    return fseeko(pFile, (off_t)cbOffset, SEEK_SET);
+#endif
+}
+
+// ----- Public Methods -----------------------------------------------
+///////////////////////////////////////////////////////////////////////
+//  Name: CreateInstance
+//  Description:  Static class method to create a file sink. The file
+//                is created, or truncated, right away.
+//
+//  sFileName: Path name of the WAVE file
+//  ppSink: Receives the sink. The caller deletes it.
+/////////////////////////////////////////////////////////////////////////
+
+HRESULT CASFWaveFileSink::CreateInstance(const ASF_PATH_CHAR* sFileName, CASFWaveFileSink** ppSink)
+{
+    if (!sFileName || !ppSink)
+    {
+        return E_INVALIDARG;
+    }
+
+#ifdef _WIN32
+    FILE* pFile = _wfopen(sFileName, L"wb");
+#else
+    FILE* pFile = fopen(sFileName, "wb");
+#endif
+
+    if (!pFile)
+    {
+        return HRESULT_FROM_WIN32(errno);
+    }
+
+    *ppSink = new (std::nothrow) CASFWaveFileSink(pFile);
+
+    if (!*ppSink)
+    {
+        fclose(pFile);
+        return E_OUTOFMEMORY;
+    }
+
+    return S_OK;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CASFWaveFileSink
+//  Description: Destructor. Completes the header and closes the file.
+//
+/////////////////////////////////////////////////////////////////////////
+
+CASFWaveFileSink::~CASFWaveFileSink()
+{
+    (void)Close();
+
+    fclose(m_pFile);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Open
+//
+// Starts the file over with a header for the format.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFWaveFileSink::Open(const ASF_MEDIA_FORMAT& format, DWORD cBuffers, IASFAudioSinkCallback* pCallback)
+{
+    if (!pCallback || (cBuffers == 0) || (format.nBlockAlign == 0))
+    {
+        return E_INVALIDARG;
+    }
+
+    m_Format = format;
+    m_pCallback = pCallback;
+
+    return Reset();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Submit
+//
+// Appends the buffer to the file and hands it back.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFWaveFileSink::Submit(DWORD iBuffer, const BYTE* pData, DWORD cbData)
+{
+    if (!pData && (cbData > 0))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (!m_pCallback)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    //The data chunk size is a DWORD
+    if (cbData > MAXDWORD - ASF_WAVE_FILE_HEADER_SIZE - m_cbData)
+    {
+        return MF_E_BUFFERTOOSMALL;
+    }
+
+    if (fwrite(pData, 1, cbData, m_pFile) != cbData)
+    {
+        return HRESULT_FROM_WIN32(errno);
+    }
+
+    m_cbData += cbData;
+
+    m_pCallback->OnBufferDone(iBuffer);
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Reset
+//
+// Drops the audio written so far. No buffers are held.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFWaveFileSink::Reset()
+{
+    if (!m_pCallback)
+    {
+        return S_OK;
+    }
+
+    m_cbData = 0;
+
+    return WriteHeader();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Close
+//
+// Writes the final chunk sizes. The file stays open for another Open.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFWaveFileSink::Close()
+{
+    if (!m_pCallback)
+    {
+        return S_OK;
+    }
+
+    HRESULT hr = WriteHeader();
+
+    m_pCallback = NULL;
+
+    return hr;
+}
+
+// ----- Private Methods -----------------------------------------------
+
+CASFWaveFileSink::CASFWaveFileSink(FILE* pFile)
+:   m_pFile (pFile),
+    m_pCallback (NULL),
+    m_cbData (0)
+{
+    memset(&m_Format, 0, sizeof(m_Format));
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: WriteHeader
+//
+// Writes the header for the data written so far and leaves the file
+// position after the data.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CASFWaveFileSink::WriteHeader()
+{
+    BYTE Header[ASF_WAVE_FILE_HEADER_SIZE];
+    BYTE* p = Header;
+
+    memcpy(p, "RIFF", 4);
+    p = PutDword(p + 4, ASF_WAVE_FILE_HEADER_SIZE - 8 + m_cbData);
+    memcpy(p, "WAVEfmt ", 8);
+    p = PutDword(p + 8, 16);
+    p = PutWord(p, ASF_WAVE_FORMAT_PCM);
+    p = PutWord(p, m_Format.nChannels);
+    p = PutDword(p, m_Format.nSamplesPerSec);
+    p = PutDword(p, m_Format.nSamplesPerSec * m_Format.nBlockAlign);
+    p = PutWord(p, m_Format.nBlockAlign);
+    p = PutWord(p, m_Format.wBitsPerSample);
+    memcpy(p, "data", 4);
+    p = PutDword(p + 4, m_cbData);
+
+    if ((SeekFile(m_pFile, 0) != 0) ||
+        (fwrite(Header, 1, sizeof(Header), m_pFile) != sizeof(Header)) ||
+        (SeekFile(m_pFile, (QWORD)ASF_WAVE_FILE_HEADER_SIZE + m_cbData) != 0) ||
+        (fflush(m_pFile) != 0))
+    {
+        return HRESULT_FROM_WIN32(errno);
+    }
+
+    return S_OK;
+}
@@ -0,0 +1,61 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFWaveFileSink.h : CASFWaveFileSink class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdio.h>
+#include "ASFAudioSink.h"
+
+//Size of the RIFF, fmt and data chunk headers of a PCM WAVE file
+#define ASF_WAVE_FILE_HEADER_SIZE   44
+
+
+//Sink that writes the audio to a PCM WAVE file. Each buffer is written
+//when it is submitted and handed back right away. The chunk sizes in
+//the header are filled in on Close.
+
+class CASFWaveFileSink : public IASFAudioSink
+{
+public:
+
+    static HRESULT CreateInstance(const ASF_PATH_CHAR* sFileName, CASFWaveFileSink** ppSink);
+
+    ~CASFWaveFileSink();
+
+    // IASFAudioSink methods
+    HRESULT Open(const ASF_MEDIA_FORMAT& format, DWORD cBuffers, IASFAudioSinkCallback* pCallback);
+
+    HRESULT Submit(DWORD iBuffer, const BYTE* pData, DWORD cbData);
+
+    HRESULT Reset();
+
+    HRESULT Close();
+
+    //Bytes of audio in the file
+    DWORD GetDataSize() const
+    {
+        return m_cbData;
+    }
+
+private:
+
+    CASFWaveFileSink(FILE* pFile);
+
+    HRESULT WriteHeader();
+
+    FILE*                   m_pFile;
+    IASFAudioSinkCallback*  m_pCallback;
+
+    ASF_MEDIA_FORMAT        m_Format;
+    DWORD                   m_cbData;
+};
@@ -11,7 +11,7 @@
 //
 //////////////////////////////////////////////////////////////////////////
 
-
+#include <new>
 #include "MF_ASFParser.h"
 
 ///////////////////////////////////////////////////////////////////////
@@ -45,13 +45,22 @@ HRESULT CDecoder::CreateInstance(CDecoder **ppDecoder)
 
 CDecoder::CDecoder()
 : m_nRefCount (1),
-m_pMFT (NULL),
-m_dwInputID (0),
-m_dwOutputID (0),
+m_pBackend (NULL),
+m_dwBackend (ASF_DECODER_BACKEND_AUTO),
+m_pPool (NULL),
+m_guidMajorType (GUID_NULL),
+m_guidSubType (GUID_NULL),
+m_pFormat (NULL),
+m_cbFormat (0),
+m_pSinkBuffer (NULL),
+m_fSinkIsFrame (FALSE),
+m_pFrameData (NULL),
+m_fHasFrame (FALSE),
+m_pRingData (NULL),
 m_DecoderState (0),
 m_pMediaController (NULL)
 {
-
+    ZeroMemory(&m_OutputFormat, sizeof(m_OutputFormat));
 };
 
 // ----- Public Methods -----------------------------------------------
@@ -69,26 +78,42 @@ CDecoder::~CDecoder()
 /////////////////////////////////////////////////////////////////////
 // Name: Initialize
 //
-// Initializes the MFT with decoder object specified by the CLSID.
+// Loads a decoder backend for the stream. A decoder of the backend
+// configured for the same input format is taken from the pool if there
+// is one; otherwise a new one is created.
+//
+// With ASF_DECODER_BACKEND_AUTO, compressed streams use a decoder MFT
+// and uncompressed streams the raw decoder. If that backend cannot
+// handle the stream, for example because MFTEnum finds no decoder, the
+// null decoder is loaded instead, so the samples can still be parsed.
 //
-// pclsid: Path name of the file
 // pMediaType:  Pointer to the media type of the stream that the
-//              the MFT will decode.
+//              the decoder will decode.
+// pStream: Properties of the stream from the ASF header.
+// dwBackend: ASF_DECODER_BACKEND_* to use.
+// pPool: Pool to take decoders from and return them to. Can be NULL.
 /////////////////////////////////////////////////////////////////////
 
-HRESULT CDecoder::Initialize(CLSID clsid,
-                             IMFMediaType *pMediaType)
+HRESULT CDecoder::Initialize(IMFMediaType *pMediaType,
+                             const ASF_STREAM_PROPERTIES *pStream,
+                             DWORD dwBackend,
+                             CASFDecoderPool *pPool)
 {
 
-    if (!pMediaType || clsid == GUID_NULL)
+    if (!pMediaType || !pStream)
     {
         return E_INVALIDARG;
     }
 
     HRESULT hr = S_OK;
 
-    //Unload the existing MFT.
-    if (m_pMFT)
+    BOOL fIsCompressed = TRUE;
+
+    DWORD rgBackends[2] = { dwBackend, ASF_DECODER_BACKEND_NULL };
+    DWORD cBackends = 1;
+
+    //Unload the existing decoder.
+    if (m_pBackend)
     {
         hr = UnLoad();
         if (FAILED(hr))
@@ -97,8 +122,53 @@ HRESULT CDecoder::Initialize(CLSID clsid,
         }
     }
 
-    //Create the MFT decoder
-    hr = CoCreateInstance(clsid, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&m_pMFT));
+    m_pPool = pPool;
+
+    if (dwBackend == ASF_DECODER_BACKEND_AUTO)
+    {
+        hr = pMediaType->IsCompressedFormat(&fIsCompressed);
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+
+        rgBackends[0] = fIsCompressed ? ASF_DECODER_BACKEND_MFT : ASF_DECODER_BACKEND_RAW;
+        cBackends = 2;
+    }
+
+    hr = SetFormatKey(pMediaType);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    for (DWORD i = 0; i < cBackends; i++)
+    {
+        ASF_DECODER_KEY key = { rgBackends[i], m_guidMajorType, m_guidSubType, m_pFormat, m_cbFormat };
+
+        //The pool only holds decoders that this class returned to it
+        if (m_pPool && (m_pPool->Checkout(key, &m_pBackend) == S_OK))
+        {
+            hr = S_OK;
+        }
+        else
+        {
+            hr = CreateBackend(rgBackends[i], pMediaType, pStream);
+        }
+
+        if (SUCCEEDED(hr))
+        {
+            m_dwBackend = rgBackends[i];
+            break;
+        }
+    }
+
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = m_pBackend->GetOutputFormat(&m_OutputFormat);
     if (FAILED(hr))
     {
         goto done;
@@ -114,13 +184,12 @@ HRESULT CDecoder::Initialize(CLSID clsid,
         }
     }
 
-    hr =  ConfigureDecoder(pMediaType);
-
+    hr = OpenOutput();
 
 done:
     if (FAILED(hr))
     {
-        hr = UnLoad();
+        (void)UnLoad();
     }
     return hr;
 }
@@ -128,7 +197,7 @@ done:
 /////////////////////////////////////////////////////////////////////
 // Name: UnLoad
 //
-// Unloads the MFT.
+// Unloads the decoder. It goes back to the pool, if there is one.
 //
 /////////////////////////////////////////////////////////////////////
 
@@ -136,227 +205,178 @@ HRESULT CDecoder::UnLoad()
 {
     HRESULT hr = S_OK;
 
-    if (m_pMFT)
+    if (m_pBackend)
     {
         if (m_pMediaController)
         {
             hr = m_pMediaController->Reset();
         }
-        SafeRelease(&m_pMFT);
+
+        if (m_pPool)
+        {
+            ASF_DECODER_KEY key = { m_dwBackend, m_guidMajorType, m_guidSubType, m_pFormat, m_cbFormat };
+
+            (void)m_pPool->Checkin(key, m_pBackend);
+        }
+        else
+        {
+            delete m_pBackend;
+        }
+
+        m_pBackend = NULL;
     }
+
+    m_dwBackend = ASF_DECODER_BACKEND_AUTO;
+    m_DecoderState = 0;
+
+    ZeroMemory(&m_OutputFormat, sizeof(m_OutputFormat));
+
+    //Output sizes depend on the decoder
+    ReleaseSinkBuffer();
+    m_OutputBuffers.Clear();
+
+    CoTaskMemFree(m_pFormat);
+    m_pFormat = NULL;
+    m_cbFormat = 0;
+
     return hr;
 }
 
 /////////////////////////////////////////////////////////////////////
-// Name: ConfigureDecoder
-//
-// Configures the MFT with the currently loaded decoder.
+// Name: CreateBackend
 //
-// pMediaType:  Pointer to the media type of the stream that will the
-//              input type of the decoder.
+// Creates and configures a new decoder of the given backend.
 /////////////////////////////////////////////////////////////////////
 
-HRESULT CDecoder::ConfigureDecoder(IMFMediaType *pMediaType)
+HRESULT CDecoder::CreateBackend(DWORD dwBackend,
+                                IMFMediaType *pMediaType,
+                                const ASF_STREAM_PROPERTIES *pStream)
 {
-    if (!pMediaType)
-    {
-        return E_INVALIDARG;
-    }
+    HRESULT hr = S_OK;
 
-    if (! m_pMFT)
+    switch (dwBackend)
     {
-        return MF_E_NOT_INITIALIZED;
-    }
-
-    HRESULT hr = S_OK, hrRes = S_OK;
-
-    GUID guidMajorType = GUID_NULL, guidSubType = GUID_NULL;
-
-    IMFMediaType* pOutputType = NULL;
+    case ASF_DECODER_BACKEND_MFT:
+        {
+            CMFTDecoder* pMFTDecoder = NULL;
 
+            hr = CMFTDecoder::CreateInstance(pMediaType, &pMFTDecoder);
+            m_pBackend = pMFTDecoder;
+        }
+        break;
 
-    //Because this is a decoder transform, the number of input=output=1
-    //Get the input and output stream ids. This is different from the stream numbers
+    case ASF_DECODER_BACKEND_RAW:
+        {
+            CASFRawDecoder* pRawDecoder = NULL;
 
-    hr = m_pMFT->GetStreamIDs( 1, &m_dwInputID, 1, &m_dwOutputID );
+            hr = CASFRawDecoder::CreateInstance(*pStream, &pRawDecoder);
+            m_pBackend = pRawDecoder;
+        }
+        break;
 
-    //Set the input type to the one that is received
+    case ASF_DECODER_BACKEND_NULL:
+        m_pBackend = new (std::nothrow) CASFNullDecoder(pStream->guidStreamType);
 
-    if (SUCCEEDED(hr) || hr == E_NOTIMPL)
-    {
-        hr = m_pMFT->SetInputType( m_dwInputID, pMediaType, 0 );
-        if (FAILED(hr))
+        if (!m_pBackend)
         {
-            goto done;
+            hr = E_OUTOFMEMORY;
         }
-    }
+        break;
 
-    if (SUCCEEDED(hr))
-    {
-        //Loop through the available output type until we find:
-        //For audio media type: PCM audio
-        //For video media type: uncompressed RGB32
-        for ( DWORD dwTypeIndex = 0; (hrRes != MF_E_NO_MORE_TYPES) ; dwTypeIndex++ )
-        {
-            hrRes =  m_pMFT->GetOutputAvailableType(
-                                                m_dwOutputID,
-                                                dwTypeIndex,
-                                                &pOutputType);
-
-            if (pOutputType && SUCCEEDED(hrRes))
-            {
-                hr = pOutputType->GetMajorType( &guidMajorType );
-                if (FAILED(hr))
-                {
-                    goto done;
-                }
-
-                hr = pOutputType->GetGUID( MF_MT_SUBTYPE, &guidSubType );
-                if (FAILED(hr))
-                {
-                    goto done;
-                }
-
-                if ((guidMajorType == MFMediaType_Audio) && (guidSubType == MFAudioFormat_PCM))
-                {
-                    hr =  m_pMFT->SetOutputType(m_dwOutputID, pOutputType, 0);
-                    if (FAILED(hr))
-                    {
-                        goto done;
-                    }
-
-                    hr =  m_pMediaController->OpenAudioDevice(pOutputType);
-                    break;
-                }
-                else if ((guidMajorType == MFMediaType_Video) && (guidSubType == MFVideoFormat_RGB32))
-                {
-                    hr =  m_pMFT->SetOutputType(m_dwOutputID, pOutputType, 0);
-                    break;
-                }
-
-                SafeRelease(&pOutputType);
-            }
-            else
-            {
-                //Output type not found
-                hr = E_FAIL;
-                break;
-            }
-        }
+    default:
+        hr = E_INVALIDARG;
+        break;
     }
 
-done:
-    SafeRelease(&pOutputType);
     return hr;
 }
 
 /////////////////////////////////////////////////////////////////////
-// Name: ProcessAudio
-//
-// Passes the input sample through the decoder and sends the output samples
-// to the CMediaController class. This class adds the buffers of the
-// output sample to the audio test sample that it maintains. When ready, the
-// caller can play the test sample through methods on the CMediaController
-//class.
+// Name: SetFormatKey
 //
-// pSample: Pointer to a compressed sample that needs to be decoded
+// Serializes the media type; together with the major type and subtype
+// it identifies decoders that can be reused for the stream.
 /////////////////////////////////////////////////////////////////////
 
-HRESULT CDecoder::ProcessAudio(IMFSample *pSample)
+HRESULT CDecoder::SetFormatKey(IMFMediaType *pMediaType)
 {
-    if (!pSample)
-    {
-        return E_INVALIDARG;
-    }
-
-    if (! m_pMFT || ! m_pMediaController)
+    HRESULT hr = pMediaType->GetMajorType(&m_guidMajorType);
+    if (FAILED(hr))
     {
-        return MF_E_NOT_INITIALIZED;
+        return hr;
     }
 
-    DWORD dwStatus = 0;
-
-    IMFMediaBuffer* pBufferOut = NULL;
-    IMFSample* pSampleOut = NULL;
-
-    //get the size of the output buffer processed by the decoder.
-    //Again, there is only one output so the output stream id is 0.
-    MFT_OUTPUT_STREAM_INFO mftStreamInfo = { 0 };
-    MFT_OUTPUT_DATA_BUFFER mftOutputData = { 0 };
-
-    HRESULT hr = m_pMFT->GetOutputStreamInfo(m_dwOutputID, &mftStreamInfo);
+    hr = pMediaType->GetGUID(MF_MT_SUBTYPE, &m_guidSubType);
     if (FAILED(hr))
     {
-        goto done;
+        return hr;
     }
 
-    hr =  m_pMFT->ProcessInput(m_dwInputID, pSample, 0);
+    hr = MFGetAttributesAsBlobSize(pMediaType, &m_cbFormat);
     if (FAILED(hr))
     {
-        goto done;
+        return hr;
     }
 
-    //Request output samples from the decoder
-    while (SUCCEEDED(hr))
-    {
-        //create a buffer for the output sample
-        hr = MFCreateMemoryBuffer(mftStreamInfo.cbSize, &pBufferOut);
-        if (FAILED(hr))
-        {
-            goto done;
-        }
-
-        //Create the output sample
-        hr = MFCreateSample(&pSampleOut);
-        if (FAILED(hr))
-        {
-            goto done;
-        }
-
-        //Add the output buffer
-        hr = pSampleOut->AddBuffer(pBufferOut);
-        if (FAILED(hr))
-        {
-            goto done;
-        }
+    m_pFormat = (BYTE*)CoTaskMemAlloc(m_cbFormat);
 
-        //Set the output sample
-        mftOutputData.pSample = pSampleOut;
-
-        //Set the output id
-        mftOutputData.dwStreamID = m_dwOutputID;
+    if (!m_pFormat)
+    {
+        m_cbFormat = 0;
+        return E_OUTOFMEMORY;
+    }
 
-        //Generate the output sample
-        hr =  m_pMFT->ProcessOutput(0, 1, &mftOutputData, &dwStatus);
+    return MFGetAttributesAsBlob(pMediaType, m_pFormat, m_cbFormat);
+}
 
-        if (hr == MF_E_TRANSFORM_NEED_MORE_INPUT)
-        {
-            hr = S_OK;
-            break;
-        }
+/////////////////////////////////////////////////////////////////////
+// Name: OpenOutput
+//
+// Opens the audio device for PCM output. Needed again for a pooled
+// decoder, because the media controller is reset on UnLoad. The null
+// decoder has no output to play.
+/////////////////////////////////////////////////////////////////////
 
-        if (FAILED(hr))
-        {
-            goto done;
-        }
+HRESULT CDecoder::OpenOutput()
+{
+    if ((m_dwBackend == ASF_DECODER_BACKEND_NULL) ||
+        (m_OutputFormat.guidMajorType != ASF_Audio_Media))
+    {
+        return S_OK;
+    }
 
-        //Send it to the media controller so that it can collect the test sample
+    return m_pMediaController->OpenAudioDevice(m_OutputFormat);
+}
 
-        hr =  m_pMediaController->AddToAudioTestSample(mftOutputData.pSample);
-        if (FAILED(hr))
-        {
-            goto done;
-        }
+/////////////////////////////////////////////////////////////////////
+// Name: ProcessAudio
+//
+// Passes the input sample through the decoder and sends the output samples
+// to the CMediaController class. The decoder writes the PCM data into the
+// audio ring of the CMediaController, which queues it on the audio sink
+// as each buffer fills, so playback starts while decoding goes on. The
+// caller can play the test sample again through methods on the
+// CMediaController class.
+//
+// Output that does not fit in the ring in one piece goes to a recycled
+// buffer first, so decoding does not allocate.
+//
+// pSample: Pointer to a compressed sample that needs to be decoded
+/////////////////////////////////////////////////////////////////////
 
-        SafeRelease(&pBufferOut);
-        SafeRelease(&pSampleOut);
+HRESULT CDecoder::ProcessAudio(IMFSample *pSample)
+{
+    if (!pSample)
+    {
+        return E_INVALIDARG;
     }
 
-done:
-    SafeRelease(&pBufferOut);
-    SafeRelease(&pSampleOut);
+    if (! m_pBackend || ! m_pMediaController)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
 
-    return hr;
+    return DecodeSample(pSample);
 }
 
 /////////////////////////////////////////////////////////////////////
@@ -367,6 +387,14 @@ done:
 // When ready, the caller can display the bitmap through methods on
 // the CMediaController class.
 //
+// The first decoded frame is written straight into the frame buffer that
+// the media controller owns and creates the bitmap over, so the frame is
+// neither copied nor allocated again. Any further output of the same
+// input goes to a recycled scratch buffer and is not shown.
+//
+// Returns S_FALSE if the decoder needs more input before it can output
+// a frame.
+//
 // pSample: Pointer to a compressed sample that needs to be decoded
 /////////////////////////////////////////////////////////////////////
 
@@ -377,173 +405,262 @@ HRESULT CDecoder::ProcessVideo(IMFSample *pSample)
         return E_INVALIDARG;
     }
 
-    if (! m_pMFT || ! m_pMediaController)
+    if (! m_pBackend || ! m_pMediaController)
     {
         return MF_E_NOT_INITIALIZED;
     }
 
-    DWORD dwStatus = 0;
+    m_fHasFrame = FALSE;
+    m_pFrameData = NULL;
 
-    DWORD cbTotalLength = 0, cbCurrentLength = 0;
+    HRESULT hr = DecodeSample(pSample);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
 
-    BYTE *pData = NULL;
+    //The decoder needs more input before it can output a frame
+    if (!m_fHasFrame)
+    {
+        hr = S_FALSE;
+        goto done;
+    }
 
-    IMFMediaBuffer* pBufferOut = NULL;
-    IMFSample* pSampleOut = NULL;
-    IMFSample* pBitmapSample = NULL;
-    IMFMediaType* pMediaType = NULL;
+    //Send it to the media controller to create the bitmap
+    hr = m_pMediaController->CreateBitmapForKeyFrame(m_pFrameData, m_OutputFormat);
 
-    //Create a buffer for the transform output
-    MFT_OUTPUT_STREAM_INFO mftStreamInfo = { 0 };
-    MFT_OUTPUT_DATA_BUFFER mftOutputData = { 0 };
+done:
+    m_pFrameData = NULL;
+    return hr;
+}
 
-    //get the size of the output buffer processed by the decoder.
-    //Again, there is only one output so the output stream id is 0.
-    HRESULT hr = m_pMFT->GetOutputStreamInfo(0, &mftStreamInfo);
-    if (FAILED(hr))
+HRESULT CDecoder::StartDecoding(void)
+{
+    if(! m_pBackend)
     {
-        goto done;
+        return MF_E_NOT_INITIALIZED;
     }
 
-    //Request samples from the decoder
+    HRESULT hr =  m_pBackend->Start();
 
-    //Create the bitmap sample that the media controller will use to create the bitmap
-    hr = MFCreateSample(&pBitmapSample);
-    if (FAILED(hr))
+    if (SUCCEEDED(hr))
     {
-        goto done;
+         m_DecoderState = STREAMING;
     }
+    return hr;
 
-    //Send input to the decoder. There is only one input stream so the ID is 0.
-    hr =  m_pMFT->ProcessInput(m_dwInputID, pSample, 0);
-    if (FAILED(hr))
+}
+
+HRESULT CDecoder::StopDecoding(void)
+{
+    if(! m_pBackend)
     {
-        goto done;
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    HRESULT hr =  m_pBackend->Stop();
+
+    if (SUCCEEDED(hr))
+    {
+         m_DecoderState = NOT_STREAMING;
     }
 
-    //Request output samples from the decoder
-    while (SUCCEEDED(hr))
+    //The last audio buffer is not full; send it to the audio sink
+    if (SUCCEEDED(hr) && m_pMediaController && (m_OutputFormat.guidMajorType == ASF_Audio_Media))
     {
-        //create a buffer for the output sample
-        hr = MFCreateMemoryBuffer(mftStreamInfo.cbSize, &pBufferOut);
-        if (FAILED(hr))
-        {
-            goto done;
-        }
+        hr = m_pMediaController->EndAudioStream();
+    }
+    return hr;
 
-        //Create the output sample
-        hr = MFCreateSample(&pSampleOut);
-        if (FAILED(hr))
-        {
-            goto done;
-        }
+}
 
-        //Add the output buffer
-        hr = pSampleOut->AddBuffer(pBufferOut);
-        if (FAILED(hr))
-        {
-            goto done;
-        }
+/////////////////////////////////////////////////////////////////////
+// Name: Flush
+//
+// Drops the data the decoder holds from earlier samples, so the next
+// key frame is decoded on its own. The decoder keeps streaming.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CDecoder::Flush(void)
+{
+    if(! m_pBackend)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
 
-        //Set the output sample
-        mftOutputData.pSample = pSampleOut;
+    return m_pBackend->Flush();
+}
+
+// ----- IASFDecoderSink Methods -----------------------------------------------
 
-        mftOutputData.dwStreamID = m_dwOutputID;
+/////////////////////////////////////////////////////////////////////
+// Name: GetOutputBuffer
+//
+// Returns the memory that the backend decodes the next output into:
+// free space in the audio ring of the media controller for audio, the
+// frame buffer of the media controller for the first video frame, a
+// recycled scratch buffer otherwise. The buffers are memory buffers,
+// whose memory stays in place after Unlock.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CDecoder::GetOutputBuffer(DWORD cbMaxOutput, BYTE** ppBuffer)
+{
+    if (!ppBuffer)
+    {
+        return E_POINTER;
+    }
 
-        //Generate the output sample
-        hr =  m_pMFT->ProcessOutput(0, 1, &mftOutputData, &dwStatus);
+    ReleaseSinkBuffer();
 
-        if (hr == MF_E_TRANSFORM_NEED_MORE_INPUT)
+    BOOL fFrame = (m_OutputFormat.guidMajorType == ASF_Video_Media) && !m_fHasFrame;
+
+    HRESULT hr = S_OK;
+
+    if (m_OutputFormat.guidMajorType == ASF_Audio_Media)
+    {
+        //S_FALSE near the wrap-around point of the ring
+        hr = m_pMediaController->GetAudioWriteBuffer(cbMaxOutput, ppBuffer);
+        if (hr == S_OK)
         {
-            hr = S_OK;
-            goto done;
+            m_pRingData = *ppBuffer;
+            return S_OK;
         }
 
-        //Add the buffer to the bitmap sample
-        hr = pBitmapSample->AddBuffer(pBufferOut);
         if (FAILED(hr))
         {
-            goto done;
+            return hr;
         }
+    }
 
-        SafeRelease(&pBufferOut);
-        SafeRelease(&pSampleOut);
-    };
-
-    //Get all bitmap data in one buffer
-    hr = pBitmapSample->ConvertToContiguousBuffer(&pBufferOut);
-    if (FAILED(hr))
+    if (fFrame)
     {
-        goto done;
+        hr = m_pMediaController->GetFrameBuffer(cbMaxOutput, &m_pSinkBuffer);
     }
-
-    hr =  m_pMFT->GetOutputCurrentType(m_dwOutputID, &pMediaType);
-    if (FAILED(hr))
+    else
     {
-        goto done;
+        hr = m_OutputBuffers.Acquire(cbMaxOutput, &m_pSinkBuffer);
     }
 
-    //Get a pointer to the memory
-    hr = pBufferOut->Lock(&pData, &cbTotalLength, &cbCurrentLength);
     if (FAILED(hr))
     {
-        goto done;
+        return hr;
     }
 
-    //Send it to the media controller to create the bitmap
-    hr = m_pMediaController->CreateBitmapForKeyFrame(pData, pMediaType);
+    m_fSinkIsFrame = fFrame;
+
+    hr = m_pSinkBuffer->Lock(ppBuffer, NULL, NULL);
     if (FAILED(hr))
     {
-        goto done;
+        return hr;
     }
 
-    hr = pBufferOut->Unlock();
+    (void)m_pSinkBuffer->Unlock();
 
-    pData = NULL;
-
-done:
-
-    if (pData)
+    if (fFrame)
     {
-        pBufferOut->Unlock();
+        m_pFrameData = *ppBuffer;
     }
 
-    SafeRelease(&pBufferOut);
-    SafeRelease(&pSampleOut);
-    SafeRelease(&pMediaType);
-    return hr;
+    return S_OK;
 }
 
-HRESULT CDecoder::StartDecoding(void)
+/////////////////////////////////////////////////////////////////////
+// Name: OnOutput
+//
+// Adds decoded audio to the test sample: audio decoded into the ring
+// is committed where it lies, other audio is copied. A video frame is
+// already in the frame buffer, if it was decoded there.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CDecoder::OnOutput(const BYTE* pData, DWORD cbData, MFTIME hnsTime)
 {
-    if(! m_pMFT)
+    UNREFERENCED_PARAMETER(hnsTime);
+
+    if (m_OutputFormat.guidMajorType == ASF_Audio_Media)
     {
-        return MF_E_NOT_INITIALIZED;
-    }
+        if (m_pRingData && (pData == m_pRingData))
+        {
+            m_pRingData = NULL;
+            return m_pMediaController->CommitAudioWrite(cbData);
+        }
 
-    HRESULT hr =  m_pMFT->ProcessMessage(MFT_MESSAGE_NOTIFY_BEGIN_STREAMING, 0);
+        return m_pMediaController->AddToAudioTestSample(pData, cbData);
+    }
 
-    if (SUCCEEDED(hr))
+    if (m_pFrameData && (pData == m_pFrameData))
     {
-         m_DecoderState = STREAMING;
+        m_fHasFrame = TRUE;
     }
-    return hr;
 
+    return S_OK;
 }
 
-HRESULT CDecoder::StopDecoding(void)
+// ----- Private Methods -----------------------------------------------
+
+/////////////////////////////////////////////////////////////////////
+// Name: DecodeSample
+//
+// Describes a compressed sample to the backend and decodes it. The
+// sample goes along as the input context, so the MFT backend can take
+// it as it is.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CDecoder::DecodeSample(IMFSample *pSample)
 {
-    if(! m_pMFT)
+    ASF_DECODER_INPUT input = { 0 };
+
+    IMFMediaBuffer* pBuffer = NULL;
+
+    BYTE* pData = NULL;
+
+    //A sample with a single buffer is returned as it is, without a copy
+    HRESULT hr = pSample->ConvertToContiguousBuffer(&pBuffer);
+    if (FAILED(hr))
     {
-        return MF_E_NOT_INITIALIZED;
+        goto done;
     }
 
-    HRESULT hr =  m_pMFT->ProcessMessage(MFT_MESSAGE_NOTIFY_END_STREAMING, 0);
-
-    if (SUCCEEDED(hr))
+    hr = pBuffer->Lock(&pData, NULL, &input.cbData);
+    if (FAILED(hr))
     {
-         m_DecoderState = NOT_STREAMING;
+        goto done;
     }
+
+    input.pData = pData;
+    input.pContext = pSample;
+    input.fKeyFrame = MFGetAttributeUINT32(pSample, MFSampleExtension_CleanPoint, FALSE);
+    input.fDiscontinuity = MFGetAttributeUINT32(pSample, MFSampleExtension_Discontinuity, FALSE);
+
+    (void)pSample->GetSampleTime(&input.hnsTime);
+    (void)pSample->GetSampleDuration(&input.hnsDuration);
+
+    hr = m_pBackend->Decode(input, this);
+
+    (void)pBuffer->Unlock();
+
+done:
+    ReleaseSinkBuffer();
+    SafeRelease(&pBuffer);
     return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ReleaseSinkBuffer
+//
+// Releases the buffer of the last output. Scratch buffers are kept
+// for the next output; the frame buffer and the audio ring stay with
+// the media controller.
+/////////////////////////////////////////////////////////////////////
+
+void CDecoder::ReleaseSinkBuffer()
+{
+    m_pRingData = NULL;
+
+    if (m_pSinkBuffer && !m_fSinkIsFrame)
+    {
+        m_OutputBuffers.Recycle(m_pSinkBuffer);
+    }
 
+    SafeRelease(&m_pSinkBuffer);
+    m_fSinkIsFrame = FALSE;
 }
@@ -14,15 +14,21 @@
 #pragma once
 
 
-class CDecoder : public IUnknown
+//Feeds the samples of the selected stream to a decoder backend and
+//sends the decoded output to the media controller. The backend is an
+//IASFDecoder; CDecoder is the sink it decodes into.
+
+class CDecoder : public IUnknown, public IASFDecoderSink
 {
 public:
     static HRESULT CDecoder::CreateInstance(CDecoder **ppDecoder);
 
     CDecoder();
     ~CDecoder();
-    HRESULT Initialize(CLSID clsid,
-                               IMFMediaType *pMediaType);
+    HRESULT Initialize(IMFMediaType *pMediaType,
+                       const ASF_STREAM_PROPERTIES *pStream,
+                       DWORD dwBackend,
+                       CASFDecoderPool *pPool);
 
 
     HRESULT ProcessAudio(IMFSample *pSample);
@@ -33,11 +39,19 @@ public:
 
     HRESULT StopDecoding(void);
 
+    HRESULT Flush(void);
+
     DWORD GetDecoderStatus ()
     {
         return  m_DecoderState;
     }
 
+    //Backend in use, ASF_DECODER_BACKEND_NULL if none could decode the stream
+    DWORD GetDecoderBackend ()
+    {
+        return m_dwBackend;
+    }
+
     HRESULT GetMediaController (CMediaController** pMediaController)
     {
         if (!m_pMediaController)
@@ -52,7 +66,7 @@ public:
 
     void Reset (void)
     {
-        SafeRelease(& m_pMFT);
+        (void)UnLoad();
         SafeRelease(&m_pMediaController);
     }
 
@@ -67,6 +81,11 @@ public:
         return QISearch(this, qit, riid, ppv);
     }
 
+    // IASFDecoderSink methods
+    HRESULT GetOutputBuffer(DWORD cbMaxOutput, BYTE** ppBuffer);
+
+    HRESULT OnOutput(const BYTE* pData, DWORD cbData, MFTIME hnsTime);
+
     STDMETHODIMP_(ULONG) AddRef()
     {
         return InterlockedIncrement(&m_nRefCount);
@@ -88,18 +107,45 @@ public:
 private:
     long    m_nRefCount;
 
-    IMFTransform* m_pMFT; //Currently loaded decoder MFT
+    IASFDecoder* m_pBackend; //Decoder checked out of m_pPool, or created for this stream
 
-    DWORD m_DecoderState; //Current state of the decoder, Streaming, Not Streaming
+    DWORD m_dwBackend; //ASF_DECODER_BACKEND_* of m_pBackend
+
+    ASF_MEDIA_FORMAT m_OutputFormat; //Format of the backend output
+
+    CASFDecoderPool* m_pPool; //Pool that receives the decoder on UnLoad, can be NULL
+
+    GUID m_guidMajorType; //Pool key of the loaded decoder
+    GUID m_guidSubType;
+    BYTE* m_pFormat;
+    UINT32 m_cbFormat;
 
-    DWORD m_dwInputID; //Input stream ID for the decoder MFT.
+    CMediaBufferPool m_OutputBuffers; //Recycled output buffers
 
-    DWORD m_dwOutputID; //Output stream ID for the decoder MFT.
+    IMFMediaBuffer* m_pSinkBuffer; //Buffer handed to the backend for the current output
+
+    BOOL m_fSinkIsFrame; //m_pSinkBuffer is the frame buffer of the media controller
+
+    BYTE* m_pFrameData; //Frame buffer memory of the media controller, while decoding video
+
+    BOOL m_fHasFrame; //A frame was decoded into m_pFrameData
+
+    BYTE* m_pRingData; //Audio ring memory handed to the backend for the current output
+
+    DWORD m_DecoderState; //Current state of the decoder, Streaming, Not Streaming
 
     CMediaController* m_pMediaController; //Pointer to the class for handling decoded media data
 
-    HRESULT ConfigureDecoder( IMFMediaType *pMediaType); //Configures the decoder MFT to work with a particular stream type.
+    HRESULT SetFormatKey( IMFMediaType *pMediaType); //Stores the pool key of a stream type.
+
+    HRESULT CreateBackend(DWORD dwBackend, IMFMediaType *pMediaType, const ASF_STREAM_PROPERTIES *pStream); //Creates a new decoder of a backend.
+
+    HRESULT OpenOutput(); //Prepares the media controller for the decoder output type.
+
+    HRESULT DecodeSample(IMFSample *pSample); //Sends one compressed sample to the backend.
+
+    void ReleaseSinkBuffer(); //Returns the buffer of the last output to the recycled buffers.
 
-    HRESULT UnLoad(); //Resets the decoder MFT
+    HRESULT UnLoad(); //Returns the backend to the pool
 
 };
\ No newline at end of file
@@ -0,0 +1,596 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// MFTDecoder.cpp : CMFTDecoder class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include "MF_ASFParser.h"
+
+///////////////////////////////////////////////////////////////////////
+//  Name: CreateInstance
+//  Description:  Finds a decoder MFT for the media type, creates it and
+//                configures its input and output types.
+//
+//  pMediaType: Media type of the stream that the MFT will decode.
+//  ppDecoder: Receives the decoder. The caller deletes it or hands it
+//             to a decoder pool.
+/////////////////////////////////////////////////////////////////////////
+
+HRESULT CMFTDecoder::CreateInstance(IMFMediaType *pMediaType, CMFTDecoder **ppDecoder)
+{
+    if (!pMediaType || !ppDecoder)
+    {
+        return E_INVALIDARG;
+    }
+
+    CMFTDecoder *pDecoder = new (std::nothrow) CMFTDecoder();
+
+    if (!pDecoder)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    HRESULT hr = pDecoder->Load(pMediaType);
+
+    if (FAILED(hr))
+    {
+        delete pDecoder;
+        return hr;
+    }
+
+    *ppDecoder = pDecoder;
+
+    return S_OK;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: CMFTDecoder
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CMFTDecoder::CMFTDecoder()
+:   m_pMFT (NULL),
+    m_pOutputSample (NULL),
+    m_pOutputView (NULL),
+    m_dwInputID (0),
+    m_dwOutputID (0)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CMFTDecoder
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CMFTDecoder::~CMFTDecoder()
+{
+    SafeRelease(&m_pOutputSample);
+    SafeRelease(&m_pOutputView);
+    SafeRelease(&m_pMFT);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Start
+//
+// Notifies the MFT that streaming is about to start.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CMFTDecoder::Start()
+{
+    if (!m_pMFT)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    return m_pMFT->ProcessMessage(MFT_MESSAGE_NOTIFY_BEGIN_STREAMING, 0);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Stop
+//
+// Notifies the MFT that streaming has ended.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CMFTDecoder::Stop()
+{
+    if (!m_pMFT)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    return m_pMFT->ProcessMessage(MFT_MESSAGE_NOTIFY_END_STREAMING, 0);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Flush
+//
+// Discards the samples the MFT still holds from earlier input.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CMFTDecoder::Flush()
+{
+    if (!m_pMFT)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    return m_pMFT->ProcessMessage(MFT_MESSAGE_COMMAND_FLUSH, 0);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetOutputFormat
+//
+// Describes the output type that Configure selected.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CMFTDecoder::GetOutputFormat(ASF_MEDIA_FORMAT* pFormat)
+{
+    if (!pFormat)
+    {
+        return E_POINTER;
+    }
+
+    if (!m_pMFT)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    GUID guidMajorType = GUID_NULL;
+
+    UINT32 stride = 0;
+
+    IMFMediaType* pOutputType = NULL;
+
+    MFT_OUTPUT_STREAM_INFO mftStreamInfo = { 0 };
+
+    ZeroMemory(pFormat, sizeof(ASF_MEDIA_FORMAT));
+
+    HRESULT hr = m_pMFT->GetOutputCurrentType(m_dwOutputID, &pOutputType);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = pOutputType->GetMajorType(&guidMajorType);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = m_pMFT->GetOutputStreamInfo(m_dwOutputID, &mftStreamInfo);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    pFormat->cbMaxOutput = mftStreamInfo.cbSize;
+
+    if (guidMajorType == MFMediaType_Audio)
+    {
+        pFormat->guidMajorType = ASF_Audio_Media;
+        pFormat->nChannels = (WORD)MFGetAttributeUINT32(pOutputType, MF_MT_AUDIO_NUM_CHANNELS, 0);
+        pFormat->nSamplesPerSec = MFGetAttributeUINT32(pOutputType, MF_MT_AUDIO_SAMPLES_PER_SECOND, 0);
+        pFormat->nBlockAlign = (WORD)MFGetAttributeUINT32(pOutputType, MF_MT_AUDIO_BLOCK_ALIGNMENT, 0);
+        pFormat->wBitsPerSample = (WORD)MFGetAttributeUINT32(pOutputType, MF_MT_AUDIO_BITS_PER_SAMPLE, 0);
+    }
+    else
+    {
+        pFormat->guidMajorType = ASF_Video_Media;
+
+        UINT32 width = 0, height = 0;
+
+        hr = MFGetAttributeSize(pOutputType, MF_MT_FRAME_SIZE, &width, &height);
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+
+        pFormat->dwWidth = width;
+        pFormat->dwHeight = height;
+
+        //RGB32 is top-down with no padding unless the type says otherwise
+        if (FAILED(pOutputType->GetUINT32(MF_MT_DEFAULT_STRIDE, &stride)))
+        {
+            stride = width * 4;
+        }
+
+        pFormat->lStride = (LONG)stride;
+    }
+
+done:
+    SafeRelease(&pOutputType);
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Decode
+//
+// Sends one sample to the MFT and hands every output it produces to
+// the sink. The MFT writes each output into memory from the sink.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CMFTDecoder::Decode(const ASF_DECODER_INPUT& input, IASFDecoderSink* pSink)
+{
+    if (!pSink)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (!m_pMFT)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    DWORD dwStatus = 0;
+
+    BYTE* pOutput = NULL;
+    DWORD cbOutput = 0;
+
+    MFTIME hnsOutputTime = 0;
+
+    IMFSample* pInputSample = NULL;
+
+    MFT_OUTPUT_STREAM_INFO mftStreamInfo = { 0 };
+    MFT_OUTPUT_DATA_BUFFER mftOutputData = { 0 };
+
+    //get the size of the output buffer processed by the decoder.
+    HRESULT hr = m_pMFT->GetOutputStreamInfo(m_dwOutputID, &mftStreamInfo);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = CreateInputSample(input, &pInputSample);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = m_pMFT->ProcessInput(m_dwInputID, pInputSample, 0);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    //Request output samples from the decoder
+    while (SUCCEEDED(hr))
+    {
+        hr = pSink->GetOutputBuffer(mftStreamInfo.cbSize, &pOutput);
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+
+        //Attach the sink memory to the recycled output sample
+        hr = PrepareOutputSample(pOutput, mftStreamInfo.cbSize);
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+
+        mftOutputData.pSample = m_pOutputSample;
+        mftOutputData.dwStreamID = m_dwOutputID;
+
+        //Generate the output sample
+        hr = m_pMFT->ProcessOutput(0, 1, &mftOutputData, &dwStatus);
+
+        SafeRelease(&mftOutputData.pEvents);
+
+        if (hr == MF_E_TRANSFORM_NEED_MORE_INPUT)
+        {
+            hr = S_OK;
+            break;
+        }
+
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+
+        hr = m_pOutputView->GetCurrentLength(&cbOutput);
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+
+        if (FAILED(m_pOutputSample->GetSampleTime(&hnsOutputTime)))
+        {
+            hnsOutputTime = input.hnsTime;
+        }
+
+        hr = pSink->OnOutput(pOutput, cbOutput, hnsOutputTime);
+    }
+
+done:
+    SafeRelease(&pInputSample);
+    return hr;
+}
+
+// ----- Private Methods -----------------------------------------------
+
+/////////////////////////////////////////////////////////////////////
+// Name: Load
+//
+// Enumerates the decoders for the media type and loads the first one.
+//
+// pMediaType:  Pointer to the media type of the stream that the
+//              the MFT will decode.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CMFTDecoder::Load(IMFMediaType *pMediaType)
+{
+    GUID    guidMajorType = GUID_NULL;
+    GUID    guidSubType = GUID_NULL;
+    GUID    guidDecoderCategory = GUID_NULL;
+
+    CLSID *pDecoderCLSIDs = NULL;   // Pointer to an array of CLISDs.
+    UINT32 cDecoderCLSIDs = 0;   // Size of the array.
+
+    MFT_REGISTER_TYPE_INFO tinfo;
+
+    HRESULT hr = pMediaType->GetMajorType(&guidMajorType);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = pMediaType->GetGUID(MF_MT_SUBTYPE, &guidSubType);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    //get decoder category
+    if (guidMajorType == MFMediaType_Video)
+    {
+        guidDecoderCategory = MFT_CATEGORY_VIDEO_DECODER;
+    }
+    else if (guidMajorType == MFMediaType_Audio)
+    {
+        guidDecoderCategory = MFT_CATEGORY_AUDIO_DECODER;
+    }
+    else
+    {
+        hr = MF_E_INVALIDMEDIATYPE;
+        goto done;
+    }
+
+    // Look for a decoder.
+    tinfo.guidMajorType = guidMajorType;
+    tinfo.guidSubtype = guidSubType;
+
+    hr = MFTEnum(
+        guidDecoderCategory,
+        0,                  // Reserved
+        &tinfo,             // Input type to match. (Encoded type.)
+        NULL,               // Output type to match. (Don't care.)
+        NULL,               // Attributes to match. (None.)
+        &pDecoderCLSIDs,    // Receives a pointer to an array of CLSIDs.
+        &cDecoderCLSIDs     // Receives the size of the array.
+        );
+
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    if (cDecoderCLSIDs == 0)
+    {
+        // MFTEnum can return zero matches.
+        hr = MF_E_TOPO_CODEC_NOT_FOUND;
+        goto done;
+    }
+
+    // Create the first MFT in the array for the current media type
+    hr = CoCreateInstance(pDecoderCLSIDs[0], NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&m_pMFT));
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = Configure(pMediaType);
+
+done:
+    if (FAILED(hr))
+    {
+        SafeRelease(&m_pMFT);
+    }
+    CoTaskMemFree(pDecoderCLSIDs);
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Configure
+//
+// Configures the MFT with the currently loaded decoder.
+//
+// pMediaType:  Pointer to the media type of the stream that will the
+//              input type of the decoder.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CMFTDecoder::Configure(IMFMediaType *pMediaType)
+{
+    HRESULT hr = S_OK, hrRes = S_OK;
+
+    GUID guidMajorType = GUID_NULL, guidSubType = GUID_NULL;
+
+    IMFMediaType* pOutputType = NULL;
+
+
+    //Because this is a decoder transform, the number of input=output=1
+    //Get the input and output stream ids. This is different from the stream numbers
+
+    hr = m_pMFT->GetStreamIDs( 1, &m_dwInputID, 1, &m_dwOutputID );
+
+    //Set the input type to the one that is received
+
+    if (SUCCEEDED(hr) || hr == E_NOTIMPL)
+    {
+        hr = m_pMFT->SetInputType( m_dwInputID, pMediaType, 0 );
+        if (FAILED(hr))
+        {
+            goto done;
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        //Loop through the available output type until we find:
+        //For audio media type: PCM audio
+        //For video media type: uncompressed RGB32
+        for ( DWORD dwTypeIndex = 0; (hrRes != MF_E_NO_MORE_TYPES) ; dwTypeIndex++ )
+        {
+            hrRes =  m_pMFT->GetOutputAvailableType(
+                                                m_dwOutputID,
+                                                dwTypeIndex,
+                                                &pOutputType);
+
+            if (pOutputType && SUCCEEDED(hrRes))
+            {
+                hr = pOutputType->GetMajorType( &guidMajorType );
+                if (FAILED(hr))
+                {
+                    goto done;
+                }
+
+                hr = pOutputType->GetGUID( MF_MT_SUBTYPE, &guidSubType );
+                if (FAILED(hr))
+                {
+                    goto done;
+                }
+
+                if (((guidMajorType == MFMediaType_Audio) && (guidSubType == MFAudioFormat_PCM)) ||
+                    ((guidMajorType == MFMediaType_Video) && (guidSubType == MFVideoFormat_RGB32)))
+                {
+                    hr =  m_pMFT->SetOutputType(m_dwOutputID, pOutputType, 0);
+                    break;
+                }
+
+                SafeRelease(&pOutputType);
+            }
+            else
+            {
+                //Output type not found
+                hr = E_FAIL;
+                break;
+            }
+        }
+    }
+
+done:
+    SafeRelease(&pOutputType);
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: CreateInputSample
+//
+// Returns the Media Foundation sample that the input came from, or
+// wraps the input data in a sample without copying it.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CMFTDecoder::CreateInputSample(const ASF_DECODER_INPUT& input, IMFSample **ppSample)
+{
+    IMFSample* pSample = NULL;
+    IMFMediaBuffer* pBuffer = NULL;
+
+    HRESULT hr = S_OK;
+
+    if (input.pContext)
+    {
+        *ppSample = (IMFSample*)input.pContext;
+        (*ppSample)->AddRef();
+        return S_OK;
+    }
+
+    hr = CMediaBufferView::CreateInstance((BYTE*)input.pData, input.cbData, input.cbData, &pBuffer);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = MFCreateSample(&pSample);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = pSample->AddBuffer(pBuffer);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = pSample->SetSampleTime(input.hnsTime);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = pSample->SetSampleDuration(input.hnsDuration);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = pSample->SetUINT32(MFSampleExtension_CleanPoint, input.fKeyFrame);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    hr = pSample->SetUINT32(MFSampleExtension_Discontinuity, input.fDiscontinuity);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
+
+    *ppSample = pSample;
+    (*ppSample)->AddRef();
+
+done:
+    SafeRelease(&pBuffer);
+    SafeRelease(&pSample);
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: PrepareOutputSample
+//
+// Points the output sample at the memory for the next output. The
+// sample and its buffer view are created once and reused.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CMFTDecoder::PrepareOutputSample(BYTE *pBuffer, DWORD cbBuffer)
+{
+    HRESULT hr = S_OK;
+
+    if (!m_pOutputSample)
+    {
+        hr = CMediaBufferView::CreateInstance(pBuffer, cbBuffer, 0, &m_pOutputView);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        hr = MFCreateSample(&m_pOutputSample);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        return m_pOutputSample->AddBuffer(m_pOutputView);
+    }
+
+    return m_pOutputView->Attach(pBuffer, cbBuffer, 0);
+}
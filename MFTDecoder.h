@@ -0,0 +1,75 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// MFTDecoder.h : CMFTDecoder class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+//Decoder MFT configured to convert one input type to PCM audio or
+//RGB32 video. Instances can be kept in a CASFDecoderPool.
+//
+//Output is decoded straight into the memory that the sink provides,
+//through a buffer view held by an output sample that is reused.
+
+class CMFTDecoder : public IASFDecoder
+{
+public:
+
+    static HRESULT CreateInstance(IMFMediaType *pMediaType, CMFTDecoder **ppDecoder);
+
+    ~CMFTDecoder();
+
+    // IASFDecoder methods
+    HRESULT Start();
+
+    HRESULT Stop();
+
+    HRESULT Flush();
+
+    HRESULT GetOutputFormat(ASF_MEDIA_FORMAT* pFormat);
+
+    HRESULT Decode(const ASF_DECODER_INPUT& input, IASFDecoderSink* pSink);
+
+    IMFTransform* GetTransform() const
+    {
+        return m_pMFT;
+    }
+
+    DWORD GetInputID() const
+    {
+        return m_dwInputID;
+    }
+
+    DWORD GetOutputID() const
+    {
+        return m_dwOutputID;
+    }
+
+private:
+
+    CMFTDecoder();
+
+    HRESULT Load(IMFMediaType *pMediaType);
+
+    HRESULT Configure(IMFMediaType *pMediaType);
+
+    HRESULT CreateInputSample(const ASF_DECODER_INPUT& input, IMFSample **ppSample);
+
+    HRESULT PrepareOutputSample(BYTE *pBuffer, DWORD cbBuffer);
+
+    IMFTransform*   m_pMFT;
+
+    IMFSample*          m_pOutputSample;    // Output sample handed to the MFT, reused for every output
+    CMediaBufferView*   m_pOutputView;      // Buffer of m_pOutputSample, attached to the sink memory
+
+    DWORD   m_dwInputID;    // Input stream ID for the decoder MFT.
+    DWORD   m_dwOutputID;   // Output stream ID for the decoder MFT.
+};
@@ -49,7 +49,45 @@ template <class T> void SafeRelease(T **ppT)
     }
 }
 
+//Portable native ASF components
+#include "ASFTypes.h"
+#include "ASFFormat.h"
+#include "MappedFile.h"
+#include "PositionalFile.h"
+#include "ASFHeaderParser.h"
+#include "ReadPlanner.h"
+#include "ASFPacketParser.h"
+#include "ASFObjectAssembler.h"
+#include "ASFThread.h"
+#include "ASFSampleRing.h"
+#include "ASFPcmRing.h"
+#include "ASFSampleList.h"
+#include "ASFParallelScanner.h"
+#include "ASFTimeline.h"
+#include "ASFSparseScanner.h"
+#include "ASFSeekEngine.h"
+#include "ASFIndexReader.h"
+#include "ASFIndexBuilder.h"
+#include "ASFMetadataCache.h"
+#include "ASFDecoder.h"
+#include "ASFRawDecoder.h"
+#include "ASFNullDecoder.h"
+#include "ASFAudioSink.h"
+#include "ASFAudioStream.h"
+#include "ASFNullAudioSink.h"
+#include "ASFWaveFileSink.h"
+#include "ASFDecoderPool.h"
+#include "ASFReader.h"
+#include "ASFExecutor.h"
+#include "ASFGenerateRequest.h"
+#include "ASFSampleIterator.h"
+#include "ASFSampleBatch.h"
+
+#include "MediaBufferView.h"
+#include "MediaBufferPool.h"
+#include "WaveOutSink.h"
 #include "MediaController.h"
+#include "MFTDecoder.h"
 #include "Decoder.h"
 #include "ASFManager.h"
 
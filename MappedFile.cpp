@@ -0,0 +1,216 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// MappedFile.cpp : CMappedFile class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CMappedFile
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CMappedFile::CMappedFile()
+:   m_pData (NULL),
+    m_cbSize (0)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CMappedFile
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CMappedFile::~CMappedFile()
+{
+    Close();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Open
+//
+// Maps the whole file read-only. The file and mapping handles are
+// closed right away; the view keeps the mapping alive until Close.
+//
+// sFileName: Path name of the file
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CMappedFile::Open(const ASF_PATH_CHAR *sFileName)
+{
+    if (!sFileName)
+    {
+        return E_INVALIDARG;
+    }
+
+    Close();
+
+    HRESULT hr = S_OK;
+
+#ifdef _WIN32
+
+    HANDLE hMapping = NULL;
+    LARGE_INTEGER liSize;
+
+    HANDLE hFile = CreateFileW(
+        sFileName,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+        );
+
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    if (!GetFileSizeEx(hFile, &liSize))
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        goto done;
+    }
+
+    //A 32-bit process cannot map files larger than its address space
+    if ((liSize.QuadPart == 0) || ((ULONGLONG)liSize.QuadPart > (SIZE_T)-1))
+    {
+        hr = E_OUTOFMEMORY;
+        goto done;
+    }
+
+    hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!hMapping)
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        goto done;
+    }
+
+    m_pData = (const BYTE*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m_pData)
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        goto done;
+    }
+
+    m_cbSize = (QWORD)liSize.QuadPart;
+
+done:
+    if (hMapping)
+    {
+        CloseHandle(hMapping);
+    }
+    CloseHandle(hFile);
+
+#else
+
+    struct stat st;
+    void* pView = MAP_FAILED;
+
+    int fd = open(sFileName, O_RDONLY);
+    if (fd < 0)
+    {
+        return HRESULT_FROM_WIN32(errno);
+    }
+
+    if (fstat(fd, &st) != 0)
+    {
+        hr = HRESULT_FROM_WIN32(errno);
+        goto done;
+    }
+
+    if ((st.st_size <= 0) || ((QWORD)st.st_size > (QWORD)(size_t)-1))
+    {
+        hr = E_OUTOFMEMORY;
+        goto done;
+    }
+
+    pView = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (pView == MAP_FAILED)
+    {
+        hr = HRESULT_FROM_WIN32(errno);
+        goto done;
+    }
+
+    m_pData = (const BYTE*)pView;
+    m_cbSize = (QWORD)st.st_size;
+
+done:
+    close(fd);
+
+#endif
+
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Close
+//
+// Unmaps the file. Spans handed out earlier become invalid.
+/////////////////////////////////////////////////////////////////////
+
+void CMappedFile::Close()
+{
+    if (m_pData)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(m_pData);
+#else
+        munmap((void*)m_pData, (size_t)m_cbSize);
+#endif
+    }
+
+    m_pData = NULL;
+    m_cbSize = 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetView
+//
+// Returns a pointer into the mapping after checking the range.
+//
+// cbOffset: Offset from the start of the file
+// cbLength: Number of bytes the caller is going to access
+// ppData:   Receives a pointer to the first byte of the range
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CMappedFile::GetView(QWORD cbOffset, QWORD cbLength, const BYTE** ppData) const
+{
+    if (!ppData)
+    {
+        return E_POINTER;
+    }
+
+    if (!m_pData)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    if ((cbOffset > m_cbSize) || (cbLength > m_cbSize - cbOffset))
+    {
+        return E_INVALIDARG;
+    }
+
+    *ppData = m_pData + cbOffset;
+
+    return S_OK;
+}
@@ -0,0 +1,58 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// MappedFile.h : CMappedFile class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFTypes.h"
+
+//Read-only memory mapping of a whole file. The native parsers work on
+//spans handed out by this class so that header and packet data is never
+//copied into intermediate buffers.
+
+class CMappedFile
+{
+public:
+
+    CMappedFile();
+    ~CMappedFile();
+
+    HRESULT Open(const ASF_PATH_CHAR *sFileName);
+
+    void Close();
+
+    BOOL IsMapped() const
+    {
+        return (m_pData != NULL);
+    }
+
+    const BYTE* GetData() const
+    {
+        return m_pData;
+    }
+
+    QWORD GetSize() const
+    {
+        return m_cbSize;
+    }
+
+    HRESULT GetView(QWORD cbOffset, QWORD cbLength, const BYTE** ppData) const;
+
+private:
+
+    //Not copyable
+    CMappedFile(const CMappedFile&);
+    CMappedFile& operator=(const CMappedFile&);
+
+    const BYTE* m_pData;    // Start of the mapping
+    QWORD       m_cbSize;   // Size of the file in bytes
+};
@@ -0,0 +1,109 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// MediaBufferPool.cpp : CMediaBufferPool class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "MF_ASFParser.h"
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CMediaBufferPool
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CMediaBufferPool::CMediaBufferPool()
+:   m_cBuffers (0)
+{
+    ZeroMemory(m_pBuffers, sizeof(m_pBuffers));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CMediaBufferPool
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CMediaBufferPool::~CMediaBufferPool()
+{
+    Clear();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Acquire
+//
+// Returns an empty buffer of at least cbMinLength bytes. A recycled
+// buffer is used if one is large enough; smaller ones are dropped.
+//
+// cbMinLength: Required size in bytes
+// ppBuffer: Receives an AddRef'd pointer to the buffer.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CMediaBufferPool::Acquire(DWORD cbMinLength, IMFMediaBuffer **ppBuffer)
+{
+    if (!ppBuffer)
+    {
+        return E_POINTER;
+    }
+
+    DWORD cbMaxLength = 0;
+
+    while (m_cBuffers > 0)
+    {
+        IMFMediaBuffer *pBuffer = m_pBuffers[--m_cBuffers];
+        m_pBuffers[m_cBuffers] = NULL;
+
+        if (SUCCEEDED(pBuffer->GetMaxLength(&cbMaxLength)) && (cbMaxLength >= cbMinLength))
+        {
+            (void)pBuffer->SetCurrentLength(0);
+
+            // The reference of the free list goes to the caller.
+            *ppBuffer = pBuffer;
+            return S_OK;
+        }
+
+        pBuffer->Release();
+    }
+
+    return MFCreateMemoryBuffer(cbMinLength, ppBuffer);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Recycle
+//
+// Puts a buffer back on the free list. The caller keeps its own
+// reference and must not use the buffer afterwards.
+/////////////////////////////////////////////////////////////////////
+
+void CMediaBufferPool::Recycle(IMFMediaBuffer *pBuffer)
+{
+    if (!pBuffer || (m_cBuffers == MEDIA_BUFFER_POOL_SIZE))
+    {
+        return;
+    }
+
+    pBuffer->AddRef();
+    m_pBuffers[m_cBuffers++] = pBuffer;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Clear
+//
+// Releases the buffers on the free list.
+/////////////////////////////////////////////////////////////////////
+
+void CMediaBufferPool::Clear()
+{
+    while (m_cBuffers > 0)
+    {
+        SafeRelease(&m_pBuffers[--m_cBuffers]);
+    }
+}
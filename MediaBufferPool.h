@@ -0,0 +1,39 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// MediaBufferPool.h : CMediaBufferPool class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#define MEDIA_BUFFER_POOL_SIZE  4
+
+//Free list of memory buffers for decoder output. Buffers are created
+//on demand and recycled once the caller is done with them, so a
+//steady stream of same-sized outputs allocates nothing.
+
+class CMediaBufferPool
+{
+public:
+
+    CMediaBufferPool();
+    ~CMediaBufferPool();
+
+    HRESULT Acquire(DWORD cbMinLength, IMFMediaBuffer **ppBuffer);
+
+    void Recycle(IMFMediaBuffer *pBuffer);
+
+    void Clear();
+
+private:
+
+    IMFMediaBuffer* m_pBuffers[MEDIA_BUFFER_POOL_SIZE];
+    DWORD           m_cBuffers;
+};
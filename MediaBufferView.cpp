@@ -0,0 +1,176 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// MediaBufferView.cpp : CMediaBufferView class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include "MF_ASFParser.h"
+
+///////////////////////////////////////////////////////////////////////
+//  Name: CreateInstance
+//  Description:  Static class method to create a buffer view.
+//
+//  pData: Memory that the view exposes.
+//  cbMaxLength: Size of the memory in bytes.
+//  cbCurrentLength: Number of valid bytes.
+//  ppBuffer: Receives an AddRef's pointer to the buffer.
+//            The caller must release the pointer.
+/////////////////////////////////////////////////////////////////////////
+
+HRESULT CMediaBufferView::CreateInstance(
+    BYTE *pData,
+    DWORD cbMaxLength,
+    DWORD cbCurrentLength,
+    IMFMediaBuffer **ppBuffer
+    )
+{
+    if (!pData || !ppBuffer || cbCurrentLength > cbMaxLength)
+    {
+        return E_INVALIDARG;
+    }
+
+    CMediaBufferView *pView = new (std::nothrow) CMediaBufferView(pData, cbMaxLength, cbCurrentLength);
+
+    if (!pView)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    // The constructor sets the ref count to 1.
+    *ppBuffer = pView;
+
+    return S_OK;
+}
+
+///////////////////////////////////////////////////////////////////////
+//  Name: CreateInstance
+//  Description:  Creates a buffer view that the caller can re-attach.
+//
+//  ppView: Receives an AddRef's pointer to the view.
+//          The caller must release the pointer.
+/////////////////////////////////////////////////////////////////////////
+
+HRESULT CMediaBufferView::CreateInstance(
+    BYTE *pData,
+    DWORD cbMaxLength,
+    DWORD cbCurrentLength,
+    CMediaBufferView **ppView
+    )
+{
+    if (!pData || !ppView || cbCurrentLength > cbMaxLength)
+    {
+        return E_INVALIDARG;
+    }
+
+    *ppView = new (std::nothrow) CMediaBufferView(pData, cbMaxLength, cbCurrentLength);
+
+    return (*ppView) ? S_OK : E_OUTOFMEMORY;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: CMediaBufferView
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CMediaBufferView::CMediaBufferView(BYTE *pData, DWORD cbMaxLength, DWORD cbCurrentLength)
+:   m_nRefCount (1),
+    m_pData (pData),
+    m_cbMaxLength (cbMaxLength),
+    m_cbCurrentLength (cbCurrentLength)
+{
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Attach
+//
+// Replaces the memory that the view exposes. Samples that hold the
+// view see the new memory.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CMediaBufferView::Attach(BYTE *pData, DWORD cbMaxLength, DWORD cbCurrentLength)
+{
+    if (!pData || cbCurrentLength > cbMaxLength)
+    {
+        return E_INVALIDARG;
+    }
+
+    m_pData = pData;
+    m_cbMaxLength = cbMaxLength;
+    m_cbCurrentLength = cbCurrentLength;
+
+    return S_OK;
+}
+
+// ----- IMFMediaBuffer Methods -----------------------------------------------
+
+STDMETHODIMP CMediaBufferView::Lock(BYTE **ppbBuffer, DWORD *pcbMaxLength, DWORD *pcbCurrentLength)
+{
+    if (!ppbBuffer)
+    {
+        return E_POINTER;
+    }
+
+    *ppbBuffer = m_pData;
+
+    if (pcbMaxLength)
+    {
+        *pcbMaxLength = m_cbMaxLength;
+    }
+
+    if (pcbCurrentLength)
+    {
+        *pcbCurrentLength = m_cbCurrentLength;
+    }
+
+    return S_OK;
+}
+
+STDMETHODIMP CMediaBufferView::Unlock()
+{
+    return S_OK;
+}
+
+STDMETHODIMP CMediaBufferView::GetCurrentLength(DWORD *pcbCurrentLength)
+{
+    if (!pcbCurrentLength)
+    {
+        return E_POINTER;
+    }
+
+    *pcbCurrentLength = m_cbCurrentLength;
+
+    return S_OK;
+}
+
+STDMETHODIMP CMediaBufferView::SetCurrentLength(DWORD cbCurrentLength)
+{
+    if (cbCurrentLength > m_cbMaxLength)
+    {
+        return E_INVALIDARG;
+    }
+
+    m_cbCurrentLength = cbCurrentLength;
+
+    return S_OK;
+}
+
+STDMETHODIMP CMediaBufferView::GetMaxLength(DWORD *pcbMaxLength)
+{
+    if (!pcbMaxLength)
+    {
+        return E_POINTER;
+    }
+
+    *pcbMaxLength = m_cbMaxLength;
+
+    return S_OK;
+}
@@ -0,0 +1,91 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// MediaBufferView.h : CMediaBufferView class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+//IMFMediaBuffer over memory that the buffer does not own, such as a
+//span of a memory-mapped file. Creating a view neither allocates nor
+//copies the data; the owner of the memory must keep it valid for as
+//long as the view is referenced.
+
+class CMediaBufferView : public IMFMediaBuffer
+{
+public:
+
+    static HRESULT CreateInstance(
+        BYTE *pData,
+        DWORD cbMaxLength,
+        DWORD cbCurrentLength,
+        IMFMediaBuffer **ppBuffer
+        );
+
+    static HRESULT CreateInstance(
+        BYTE *pData,
+        DWORD cbMaxLength,
+        DWORD cbCurrentLength,
+        CMediaBufferView **ppView
+        );
+
+    //Points the view at other memory, so one view can serve a series
+    //of buffers
+    HRESULT Attach(BYTE *pData, DWORD cbMaxLength, DWORD cbCurrentLength);
+
+    // IUnknown methods
+    STDMETHODIMP QueryInterface(REFIID riid, void** ppv)
+    {
+        static const QITAB qit[] =
+        {
+            QITABENT(CMediaBufferView, IMFMediaBuffer),
+            { 0 }
+        };
+        return QISearch(this, qit, riid, ppv);
+    }
+
+    STDMETHODIMP_(ULONG) AddRef()
+    {
+        return InterlockedIncrement(&m_nRefCount);
+    }
+
+    STDMETHODIMP_(ULONG) Release()
+    {
+        ULONG uCount = InterlockedDecrement(&m_nRefCount);
+        if (uCount == 0)
+        {
+            delete this;
+        }
+        return uCount;
+    }
+
+    // IMFMediaBuffer methods
+    STDMETHODIMP Lock(BYTE **ppbBuffer, DWORD *pcbMaxLength, DWORD *pcbCurrentLength);
+
+    STDMETHODIMP Unlock();
+
+    STDMETHODIMP GetCurrentLength(DWORD *pcbCurrentLength);
+
+    STDMETHODIMP SetCurrentLength(DWORD cbCurrentLength);
+
+    STDMETHODIMP GetMaxLength(DWORD *pcbMaxLength);
+
+private:
+
+    CMediaBufferView(BYTE *pData, DWORD cbMaxLength, DWORD cbCurrentLength);
+
+    ~CMediaBufferView() {}
+
+    long    m_nRefCount;
+
+    BYTE*   m_pData;            // Memory owned by the caller
+    DWORD   m_cbMaxLength;
+    DWORD   m_cbCurrentLength;
+};
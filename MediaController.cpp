@@ -56,27 +56,19 @@ HRESULT CMediaController::CreateInstance(CMediaController **ppMediaController)
 CMediaController::CMediaController(HRESULT* hr)
 :
 m_nRefCount (1),
-m_gdiplusToken (0),
-m_pAudioTestSample (NULL),
 m_pBitmap (NULL),
-m_hWaveOut (NULL),
-m_fHasTestMedia (FALSE),
-m_fAudioDeviceBusy (FALSE)
+m_pFrameBuffer (NULL),
+m_pAudioSink (NULL),
+m_dwAudioSink (ASF_AUDIO_SINK_WAVEOUT),
+m_cAudioBuffers (ASF_AUDIO_SINK_DEFAULT_BUFFERS),
+m_hnsAudioBufferDuration (ASF_AUDIO_SINK_DEFAULT_BUFFER_DURATION),
+m_fHasTestMedia (FALSE)
 {
-    //Load the GDI+ platform, this will be used for displaying the bitmap
-    Gdiplus::Status status;
-    GdiplusStartupInput gdiplusStartupInput;
+    m_szAudioFile[0] = L'\0';
 
-    status = GdiplusStartup(&m_gdiplusToken, &gdiplusStartupInput, NULL);
-
-    if (status == Ok)
-    {
-        *hr = S_OK;
-    }
-    else
-    {
-        *hr = E_FAIL;
-    }
+    //GDI+, used for the key frame bitmap, is loaded once by the
+    //application
+    *hr = S_OK;
 };
 
 // ----- Public Methods -----------------------------------------------
@@ -91,11 +83,9 @@ CMediaController::~CMediaController()
     //Release resources
     Reset();
 
-    //Shutdown GDI+
-    if (m_gdiplusToken!=0)
-    {
-        GdiplusShutdown(m_gdiplusToken);
-    }
+    (void)CloseAudioDevice();
+
+    SafeRelease(&m_pFrameBuffer);
 }
 
 /////////////////////////////////////////////////////////////////////
@@ -103,37 +93,26 @@ CMediaController::~CMediaController()
 //
 // Creates a Bitmap object from pixel data
 //
-// pPixelData: Pixel data for the key frame.
-// pMediaType:  Pointer to the media type of the stream.
+// pPixelData: RGB32 pixel data for the key frame.
+// format:  Decoded format of the stream.
 /////////////////////////////////////////////////////////////////////
 
-HRESULT CMediaController::CreateBitmapForKeyFrame(BYTE* pPixelData, IMFMediaType* pMediaType)
+HRESULT CMediaController::CreateBitmapForKeyFrame(BYTE* pPixelData, const ASF_MEDIA_FORMAT& format)
 {
-    if(!pPixelData || !pMediaType)
+    if(!pPixelData || (format.dwWidth == 0) || (format.dwHeight == 0))
     {
         return E_INVALIDARG;
     }
 
-    INT32 stride = 0;
-
-    //Get the Frame size and stride through Media Type attributes
-
-    HRESULT hr = MFGetAttributeSize(pMediaType, MF_MT_FRAME_SIZE, &m_Width, &m_Height);
-    if (FAILED(hr))
-    {
-        goto done;
-    }
+    HRESULT hr = S_OK;
 
-    hr = pMediaType->GetUINT32(MF_MT_DEFAULT_STRIDE, (UINT32*)&stride);
-    if (FAILED(hr))
-    {
-        goto done;
-    }
+    m_Width = format.dwWidth;
+    m_Height = format.dwHeight;
 
     delete m_pBitmap;
 
     //Create the bitmap with the given size
-    m_pBitmap = ::new (std::nothrow) Bitmap(m_Width, m_Height, (INT32)stride, PixelFormat32bppRGB, pPixelData);
+    m_pBitmap = ::new (std::nothrow) Bitmap(m_Width, m_Height, (INT32)format.lStride, PixelFormat32bppRGB, pPixelData);
 
     if(!m_pBitmap)
     {
@@ -145,7 +124,6 @@ HRESULT CMediaController::CreateBitmapForKeyFrame(BYTE* pPixelData, IMFMediaType
         m_fHasTestMedia = TRUE;
     }
 
-done:
     return hr;
 }
 
@@ -205,56 +183,158 @@ HRESULT CMediaController::DrawKeyFrame(HWND hWnd)
 }
 
 
+/////////////////////////////////////////////////////////////////////
+// Name: GetAudioWriteBuffer
+//
+// Returns free space in the ring of the audio stream, so the decoder
+// can write PCM data into the test sample directly. Returns S_FALSE if
+// the ring has no contiguous space of that size; the decoder then
+// decodes into its own memory and calls AddToAudioTestSample.
+//
+// cbMax: Largest output the decoder can produce
+// ppData: Receives a pointer into the ring
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CMediaController::GetAudioWriteBuffer(DWORD cbMax, BYTE** ppData)
+{
+    if (!ppData)
+    {
+        return E_POINTER;
+    }
+
+    return m_AudioStream.BeginWrite(cbMax, ppData);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: CommitAudioWrite
+//
+// Adds PCM data that the decoder wrote at the pointer from
+// GetAudioWriteBuffer to the test sample. Every full buffer goes to
+// the audio sink right away.
+//
+// cbData: Size of the data in bytes
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CMediaController::CommitAudioWrite(DWORD cbData)
+{
+    HRESULT hr = m_AudioStream.CommitWrite(cbData);
+
+    if (SUCCEEDED(hr) && (cbData > 0))
+    {
+        m_fHasTestMedia = TRUE;
+    }
+
+    return hr;
+}
+
 /////////////////////////////////////////////////////////////////////
 // Name: AddToAudioTestSample
 //
-// Adds the audio sample buffers to a test sample that the class maintains.
+// Copies decoded PCM data to the test sample. Data that does not fit
+// in the ring is dropped, so the test sample keeps its first seconds.
 //
+// pData: PCM data
+// cbData: Size of the data in bytes
 /////////////////////////////////////////////////////////////////////
 
-HRESULT CMediaController::AddToAudioTestSample (IMFSample *pSample)
+HRESULT CMediaController::AddToAudioTestSample (const BYTE *pData, DWORD cbData)
 {
-    if(!pSample)
+    if(!pData && (cbData > 0))
     {
         return E_INVALIDARG;
     }
 
-    HRESULT hr = S_OK;
+    HRESULT hr = m_AudioStream.Write(pData, cbData);
 
-    IMFMediaBuffer* pBuffer = NULL;
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (cbData > 0)
+    {
+        m_fHasTestMedia = TRUE;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: EndAudioStream
+//
+// Sends the rest of the test sample, short of a full buffer, to the
+// audio sink. Called when the decoder stops.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CMediaController::EndAudioStream()
+{
+    if (!m_pAudioSink)
+    {
+        return S_OK;
+    }
+
+    return m_AudioStream.EndOfStream();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetFrameBuffer
+//
+// Returns the buffer that holds the pixel data of the key frame bitmap.
+// The decoder writes the frame into it directly. The buffer is reused
+// for every frame and only replaced when a larger frame needs it.
+//
+// cbFrame: Size of a decoded frame in bytes
+// ppBuffer: Receives an AddRef'd pointer to the buffer.
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CMediaController::GetFrameBuffer(DWORD cbFrame, IMFMediaBuffer** ppBuffer)
+{
+    if (!ppBuffer)
+    {
+        return E_POINTER;
+    }
 
-    if (! m_pAudioTestSample)
+    DWORD cbMax = 0;
+
+    HRESULT hr = S_OK;
+
+    if (m_pFrameBuffer)
     {
-        hr = MFCreateSample(&m_pAudioTestSample);
+        hr = m_pFrameBuffer->GetMaxLength(&cbMax);
         if (FAILED(hr))
         {
-            goto done;
+            return hr;
         }
     }
 
-    hr = pSample->ConvertToContiguousBuffer(&pBuffer);
-    if (FAILED(hr))
+    if (!m_pFrameBuffer || (cbMax < cbFrame))
     {
-        goto done;
-    }
+        //The bitmap references the pixel data of the old buffer
+        delete m_pBitmap;
+        m_pBitmap = NULL;
+        m_fHasTestMedia = FALSE;
 
-    hr =  m_pAudioTestSample->AddBuffer(pBuffer);
-    if (FAILED(hr))
-    {
-        goto done;
+        SafeRelease(&m_pFrameBuffer);
+
+        hr = MFCreateMemoryBuffer(cbFrame, &m_pFrameBuffer);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
     }
 
-    m_fHasTestMedia = TRUE;
+    *ppBuffer = m_pFrameBuffer;
+    (*ppBuffer)->AddRef();
 
-done:
-    SafeRelease(&pBuffer);
-    return hr;
+    return S_OK;
 }
 
 /////////////////////////////////////////////////////////////////////
 // Name: Reset
 //
-// Resets the audio test sample by removing all the buffers from it.
+// Resets the audio test sample: stops the audio sink, which plays
+// straight from the ring, and empties the ring. The ring memory is
+// kept for the next test sample.
 //
 /////////////////////////////////////////////////////////////////////
 
@@ -265,7 +345,7 @@ HRESULT CMediaController::Reset()
     delete m_pBitmap;
     m_pBitmap = NULL;
 
-    SafeRelease(&m_pAudioTestSample);
+    hr = m_AudioStream.Reset();
 
     if(SUCCEEDED(hr))
     {
@@ -276,248 +356,188 @@ HRESULT CMediaController::Reset()
 }
 
 /////////////////////////////////////////////////////////////////////
-// Name: CloseAudioDevice
+// Name: SetAudioSink
 //
-// Closes the default waveOut device, if open.
+// Selects the audio output that OpenAudioDevice opens next.
 //
+// dwSink: ASF_AUDIO_SINK_WAVEOUT, ASF_AUDIO_SINK_FILE or
+//         ASF_AUDIO_SINK_NULL
+// szFileName: WAVE file for ASF_AUDIO_SINK_FILE, ignored otherwise
 /////////////////////////////////////////////////////////////////////
 
-HRESULT CMediaController::CloseAudioDevice()
+HRESULT CMediaController::SetAudioSink(DWORD dwSink, const WCHAR* szFileName)
 {
-    if (m_hWaveOut != NULL)
+    switch (dwSink)
+    {
+    case ASF_AUDIO_SINK_WAVEOUT:
+    case ASF_AUDIO_SINK_NULL:
+        break;
+
+    case ASF_AUDIO_SINK_FILE:
+        if (!szFileName)
+        {
+            return E_INVALIDARG;
+        }
+        break;
+
+    default:
+        return E_INVALIDARG;
+    }
+
+    HRESULT hr = S_OK;
+
+    if (dwSink == ASF_AUDIO_SINK_FILE)
     {
-        if (waveOutClose(m_hWaveOut) !=  MMSYSERR_NOERROR)
+        hr = StringCchCopy(m_szAudioFile, MAX_PATH, szFileName);
+        if (FAILED(hr))
         {
-            return E_FAIL;
+            return hr;
         }
-        m_hWaveOut = NULL;
     }
 
+    m_dwAudioSink = dwSink;
+
     return S_OK;
 }
 
 /////////////////////////////////////////////////////////////////////
-// Name: OpenAudioDevice
+// Name: SetAudioBuffering
 //
-// Opens the default waveOut device.
+// Sets how the test sample is queued on the audio sink, from the next
+// OpenAudioDevice on. Playback starts once the first buffer is decoded.
 //
+// cBuffers: Buffers queued on the sink at a time, 0 for the default
+// hnsBufferDuration: Audio per buffer, 0 for the default
 /////////////////////////////////////////////////////////////////////
 
-HRESULT CMediaController::OpenAudioDevice(IMFMediaType* pMediaType)
+HRESULT CMediaController::SetAudioBuffering(DWORD cBuffers, MFTIME hnsBufferDuration)
 {
-    if (!pMediaType)
+    if ((cBuffers > ASF_AUDIO_SINK_MAX_BUFFERS) || (hnsBufferDuration < 0))
     {
         return E_INVALIDARG;
     }
 
-    WAVEFORMATEX*  pWavOutputFormat = NULL;
-    UINT32 cbWavOutputFormatSize = 0;
-
-    //Create the WAVEFORMATEX structure from the media type
-    HRESULT hr = MFCreateWaveFormatExFromMFMediaType(pMediaType, &pWavOutputFormat, &cbWavOutputFormatSize);
-    if (FAILED(hr))
-    {
-        goto done;
-    }
-
-    //Query if the format is supported
-    MMRESULT mmr = waveOutOpen(
-        NULL,
-        WAVE_MAPPER,        // select the device for me
-        pWavOutputFormat,   // format
-        0,
-        0,
-        WAVE_FORMAT_QUERY   // Query if the format is OK.
-        );
-
-    if (mmr == MMSYSERR_NOERROR)
-    {
-        hr = S_OK;
-    }
-    else
-    {
-        hr = MF_E_INVALIDMEDIATYPE;
-        goto done;
-    }
-
-    //if the format is supported, open the audio device
-    //make sure the device is not in use
-    hr = CloseAudioDevice();
-    if (FAILED(hr))
-    {
-        goto done;
-    }
+    m_cAudioBuffers = cBuffers;
+    m_hnsAudioBufferDuration = hnsBufferDuration;
 
-    // Create the thread that will handle messages from the waveOut device.
-    DWORD dwThreadId;
+    return S_OK;
+}
 
-    m_hThread = CreateThread( NULL, 0, WaveOutThreadProc, (void*)this, NULL, &dwThreadId );
+/////////////////////////////////////////////////////////////////////
+// Name: CloseAudioDevice
+//
+// Stops the audio stream and closes the audio sink, if open.
+//
+/////////////////////////////////////////////////////////////////////
 
-    if( NULL == m_hThread )
-    {
-        hr =( HRESULT_FROM_WIN32( GetLastError() ) );
-        goto done;
-    }
+HRESULT CMediaController::CloseAudioDevice()
+{
+    HRESULT hr = m_AudioStream.Shutdown();
 
-    // Open the device.
-    mmr = waveOutOpen(
-        &m_hWaveOut,            // receives the handle to the device
-        WAVE_MAPPER,            // select the device for me
-        pWavOutputFormat,                 // format
-        (DWORD)dwThreadId,      // thread ID to get waveOut messages
-        (DWORD_PTR)this,        // instance data
-        CALLBACK_THREAD
-        );
+    delete m_pAudioSink;
+    m_pAudioSink = NULL;
 
-    if (mmr != MMSYSERR_NOERROR)
-    {
-        hr = E_FAIL;
-    }
+    m_fHasTestMedia = FALSE;
 
-
-done:
-    CoTaskMemFree(pWavOutputFormat);
     return hr;
 }
 
 /////////////////////////////////////////////////////////////////////
-// Name: PlayAudio
+// Name: OpenAudioDevice
 //
-// Delivers an audio buffer to the waveOut device.
+// Opens the selected audio sink and sizes the audio ring for the test
+// sample in the output format: TEST_AUDIO_DURATION of audio plus one
+// decoder output, since the last output can run past the end.
 //
 /////////////////////////////////////////////////////////////////////
 
-HRESULT CMediaController::PlayAudio()
+HRESULT CMediaController::OpenAudioDevice(const ASF_MEDIA_FORMAT& format)
 {
-
-    if (! m_hWaveOut || ! m_pAudioTestSample)
+    if ((format.nChannels == 0) || (format.nBlockAlign == 0) || (format.nSamplesPerSec == 0))
     {
-        return E_FAIL;
-    }
-
-    //Check if the device is busy
-    if (m_fAudioDeviceBusy)
-    {
-        return E_ACCESSDENIED;
+        return E_INVALIDARG;
     }
 
-    MMRESULT mmt;
-
-    //WAVEHDR pWaveHeader;
-    IMFMediaBuffer* pAudioBuffer = NULL;
+    ULONGLONG cbRing = (ULONGLONG)format.nSamplesPerSec * format.nBlockAlign * TEST_AUDIO_DURATION / 10000000 + format.cbMaxOutput;
 
-    BYTE        *pData = NULL;
-    DWORD       cbData = 0;
-
-    //Get all the buffers in the test sample in one buffer
-    HRESULT hr =  m_pAudioTestSample->ConvertToContiguousBuffer(&pAudioBuffer);
-    if (FAILED(hr))
+    if (cbRing > ASF_PCM_RING_MAX_SIZE)
     {
-        goto done;
+        return MF_E_INVALIDMEDIATYPE;
     }
 
-    // Get a pointer to the buffer.
-    hr = pAudioBuffer->Lock( &pData, NULL, &cbData );
+    //make sure the sink is not in use
+    HRESULT hr = CloseAudioDevice();
     if (FAILED(hr))
     {
         goto done;
     }
 
-    // Prepare the header for playing.
-    m_WaveHeader.lpData = (LPSTR)pData;
-    m_WaveHeader.dwBufferLength = cbData;
-    m_WaveHeader.dwBytesRecorded = cbData;
-    m_WaveHeader.dwUser = (DWORD_PTR)pAudioBuffer; // Store the sample pointer as user data. This will be released in the MM_WOM_DONE handler
-    m_WaveHeader.dwLoops = 0;
-    m_WaveHeader.dwFlags = 0;
+    switch (m_dwAudioSink)
+    {
+    case ASF_AUDIO_SINK_WAVEOUT:
+        m_pAudioSink = new (std::nothrow) CWaveOutSink();
+        break;
 
-    mmt = waveOutPrepareHeader( m_hWaveOut, &m_WaveHeader, sizeof( WAVEHDR ) );
+    case ASF_AUDIO_SINK_FILE:
+        {
+            CASFWaveFileSink* pFileSink = NULL;
 
-    if (mmt == MMSYSERR_NOERROR)
-    {
-        // Send the sample to the waveOut device.
-        mmt = waveOutWrite( m_hWaveOut, &m_WaveHeader, sizeof( WAVEHDR ) );
+            hr = CASFWaveFileSink::CreateInstance(m_szAudioFile, &pFileSink);
+            m_pAudioSink = pFileSink;
+        }
+        break;
 
-        hr = S_OK;
+    case ASF_AUDIO_SINK_NULL:
+        m_pAudioSink = new (std::nothrow) CASFNullAudioSink();
+        break;
     }
 
-    if (mmt != MMSYSERR_NOERROR)
+    if (FAILED(hr))
     {
-        SafeRelease(&pAudioBuffer);
-        hr = E_FAIL;
+        goto done;
     }
-    else
-    {
-        hr = S_OK;
 
-        //Set the device to busy
-        m_fAudioDeviceBusy = TRUE;
+    if (!m_pAudioSink)
+    {
+        hr = E_OUTOFMEMORY;
+        goto done;
     }
 
+    //The stream opens the sink
+    hr = m_AudioStream.Initialize(
+        m_pAudioSink,
+        format,
+        (DWORD)cbRing,
+        m_cAudioBuffers,
+        m_hnsAudioBufferDuration
+        );
+
 done:
     if (FAILED(hr))
     {
-        pAudioBuffer->Unlock();
-        SafeRelease(&pAudioBuffer);
+        (void)m_AudioStream.Shutdown();
+
+        delete m_pAudioSink;
+        m_pAudioSink = NULL;
     }
     return hr;
 }
 
-//-----------------------------------------------------------------------------
-// Name: WaveOutThreadProc
-// Desc: ThreadProc for the worker thread that handles waveOut messages.
+/////////////////////////////////////////////////////////////////////
+// Name: PlayAudio
 //
-// Note: This is a static method. It calls through to a member function.
-//-----------------------------------------------------------------------------
-
-DWORD WINAPI CMediaController::WaveOutThreadProc( LPVOID lpParameter )
-{
-    CMediaController* pThis = ( CMediaController* )lpParameter;
-
-    // Redirect the processing to a non-static member function.
-
-    pThis->DoWaveOutThread();
-
-    return( 0 );
-}
-
-//-----------------------------------------------------------------------------
-// Name: DoWaveOutThread
-// Desc: Implements the ThreadProc (see WaveOutThreadProc)
-//-----------------------------------------------------------------------------
+// Plays the test sample again. It was played while it was decoded;
+// the ring still holds it.
+//
+/////////////////////////////////////////////////////////////////////
 
-void CMediaController::DoWaveOutThread()
+HRESULT CMediaController::PlayAudio()
 {
-    MSG         uMsg;
-
-    while( 0 != GetMessage( &uMsg, NULL, 0, 0 ) )
+    if (!m_pAudioSink)
     {
-        switch( uMsg.message )
-        {
-        case MM_WOM_DONE:  // waveOut has finished using an audio buffer.
-            {
-                WAVEHDR *pwh = (WAVEHDR*)uMsg.lParam;
-
-                // (1) Unprepare the wave header.
-                MMRESULT mmr = waveOutUnprepareHeader(m_hWaveOut, pwh, sizeof(WAVEHDR));
-
-                // (2) Release the buffer pointer.
-                IMFMediaBuffer *pBuffer= (IMFMediaBuffer*)pwh->dwUser;
-                pBuffer->Unlock();
-                pBuffer->Release();
-
-                // (3) Reset the WAVEHDR structure
-                ZeroMemory(pwh, sizeof(WAVEHDR));
-
-                // (4) Set the busy flag
-                m_fAudioDeviceBusy = FALSE;
-            }
-            break;
-
-        case MM_WOM_CLOSE:  // the waveOut device has closed.
-            // Tell the thread to quit:
-            PostQuitMessage( 0 );   // This causes GetMessage to return 0, so we exit the loop
-            break;
-        }
+        return E_FAIL;
     }
-}
\ No newline at end of file
+
+    //Returns E_ACCESSDENIED while the sink is still playing
+    return m_AudioStream.Replay();
+}
@@ -18,22 +18,28 @@ class CMediaController : public IUnknown
 {
 public:
     static HRESULT CMediaController::CreateInstance(CMediaController **ppMediaController);
-    // callback for waveOut functions
-    static DWORD WINAPI WaveOutThreadProc( LPVOID lpParameter );
 
     CMediaController(HRESULT* hr);
     ~CMediaController();
-    HRESULT CreateBitmapForKeyFrame(BYTE* pPixelData, IMFMediaType* pMediaType);
+    HRESULT GetFrameBuffer(DWORD cbFrame, IMFMediaBuffer** ppBuffer);
+    HRESULT CreateBitmapForKeyFrame(BYTE* pPixelData, const ASF_MEDIA_FORMAT& format);
     HRESULT DrawKeyFrame(HWND hWnd);
     HRESULT GetBitmapDimensions(UINT32 *pWidth, UINT32 *pHeight);
 
-    HRESULT AddToAudioTestSample ( IMFSample *pBuffer);
+    HRESULT GetAudioWriteBuffer(DWORD cbMax, BYTE** ppData);
+    HRESULT CommitAudioWrite(DWORD cbData);
+    HRESULT AddToAudioTestSample (const BYTE *pData, DWORD cbData);
+    HRESULT EndAudioStream();
     HRESULT Reset();
-    HRESULT OpenAudioDevice(IMFMediaType* pMediaType);
+    HRESULT SetAudioSink(DWORD dwSink, const WCHAR* szFileName);
+    HRESULT SetAudioBuffering(DWORD cBuffers, MFTIME hnsBufferDuration);
+    HRESULT OpenAudioDevice(const ASF_MEDIA_FORMAT& format);
     HRESULT CloseAudioDevice();
 
     HRESULT PlayAudio();
 
+    void GetAudioStats(ASF_AUDIO_STREAM_STATS* pStats){m_AudioStream.GetStats(pStats);};
+
     BOOL HasTestMedia(){return m_fHasTestMedia;};
 
 
@@ -69,24 +75,22 @@ public:
 
 private:
     long        m_nRefCount;
-    ULONG_PTR   m_gdiplusToken;
 
     Bitmap*     m_pBitmap;
-    IMFSample*  m_pAudioTestSample;
+    IMFMediaBuffer* m_pFrameBuffer;     // Pixel data of m_pBitmap, decoded in place
+    CASFAudioStream m_AudioStream;      // PCM data of the test sample, on its way to m_pAudioSink
+    IASFAudioSink*  m_pAudioSink;       // Output opened in OpenAudioDevice
+
+    DWORD       m_dwAudioSink;          // ASF_AUDIO_SINK_* to open
+    WCHAR       m_szAudioFile[MAX_PATH];// File of the ASF_AUDIO_SINK_FILE sink
+    DWORD       m_cAudioBuffers;
+    MFTIME      m_hnsAudioBufferDuration;
 
     UINT32      m_Width;
     UINT32      m_Height;
 
     HWND        m_hWnd;
-    HWAVEOUT    m_hWaveOut;         // handle to waveout device
-    HANDLE      m_hThread;          // handle to the thread.
 
     BOOL        m_fHasTestMedia;
 
-    BOOL        m_fAudioDeviceBusy;
-
-    WAVEHDR     m_WaveHeader;
-
-    void    DoWaveOutThread();
-
 };
\ No newline at end of file
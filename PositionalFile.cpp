@@ -0,0 +1,257 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// PositionalFile.cpp : CPositionalFile class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "PositionalFile.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CPositionalFile
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CPositionalFile::CPositionalFile()
+:
+#ifdef _WIN32
+    m_hFile (INVALID_HANDLE_VALUE),
+#else
+    m_fd (-1),
+#endif
+    m_cbSize (0),
+    m_cReads (0),
+    m_cbRead (0)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CPositionalFile
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CPositionalFile::~CPositionalFile()
+{
+    Close();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Open
+//
+// Opens the file for reading at random offsets and resets the read
+// counters.
+//
+// sFileName: Path name of the file
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CPositionalFile::Open(const ASF_PATH_CHAR *sFileName)
+{
+    if (!sFileName)
+    {
+        return E_INVALIDARG;
+    }
+
+    Close();
+
+    m_cReads = 0;
+    m_cbRead = 0;
+
+#ifdef _WIN32
+
+    LARGE_INTEGER liSize;
+
+    m_hFile = CreateFileW(
+        sFileName,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS,
+        NULL
+        );
+
+    if (m_hFile == INVALID_HANDLE_VALUE)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    if (!GetFileSizeEx(m_hFile, &liSize))
+    {
+        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+        Close();
+        return hr;
+    }
+
+    m_cbSize = (QWORD)liSize.QuadPart;
+
+#else
+
+    struct stat st;
+
+    m_fd = open(sFileName, O_RDONLY);
+    if (m_fd < 0)
+    {
+        return HRESULT_FROM_WIN32(errno);
+    }
+
+    if (fstat(m_fd, &st) != 0)
+    {
+        HRESULT hr = HRESULT_FROM_WIN32(errno);
+        Close();
+        return hr;
+    }
+
+    m_cbSize = (QWORD)st.st_size;
+
+#ifdef POSIX_FADV_RANDOM
+    // Read-ahead would fill the page cache with the skipped packet data
+    (void)posix_fadvise(m_fd, 0, 0, POSIX_FADV_RANDOM);
+#endif
+
+#endif
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Close
+//
+// Closes the file. The read counters are kept.
+/////////////////////////////////////////////////////////////////////
+
+void CPositionalFile::Close()
+{
+#ifdef _WIN32
+    if (m_hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_hFile);
+        m_hFile = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+        m_fd = -1;
+    }
+#endif
+
+    m_cbSize = 0;
+}
+
+BOOL CPositionalFile::IsOpen() const
+{
+#ifdef _WIN32
+    return (m_hFile != INVALID_HANDLE_VALUE);
+#else
+    return (m_fd >= 0);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ReadAt
+//
+// Reads a range of the file without moving a file pointer. Reads
+// past the end of the file are cut short; one that starts at or past
+// the end reads nothing and returns S_OK.
+//
+// cbOffset: Offset from the start of the file
+// pBuffer:  Receives the data
+// cbToRead: Number of bytes to read
+// pcbRead:  Receives the number of bytes read
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CPositionalFile::ReadAt(QWORD cbOffset, void* pBuffer, DWORD cbToRead, DWORD* pcbRead)
+{
+    if (!pBuffer || !pcbRead)
+    {
+        return E_POINTER;
+    }
+
+    *pcbRead = 0;
+
+    if (!IsOpen())
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    if (cbOffset >= m_cbSize)
+    {
+        return S_OK;
+    }
+
+    if (cbToRead > m_cbSize - cbOffset)
+    {
+        cbToRead = (DWORD)(m_cbSize - cbOffset);
+    }
+
+    DWORD cbDone = 0;
+
+    m_cReads++;
+
+    while (cbDone < cbToRead)
+    {
+        QWORD cbPosition = cbOffset + cbDone;
+
+#ifdef _WIN32
+
+        OVERLAPPED ov = { 0 };
+        DWORD cbChunk = 0;
+
+        ov.Offset = (DWORD)cbPosition;
+        ov.OffsetHigh = (DWORD)(cbPosition >> 32);
+
+        if (!ReadFile(m_hFile, (BYTE*)pBuffer + cbDone, cbToRead - cbDone, &cbChunk, &ov))
+        {
+            DWORD dwError = GetLastError();
+            if (dwError == ERROR_HANDLE_EOF)
+            {
+                break;
+            }
+            return HRESULT_FROM_WIN32(dwError);
+        }
+
+#else
+
+        ssize_t cbChunk = pread(m_fd, (BYTE*)pBuffer + cbDone, cbToRead - cbDone, (off_t)cbPosition);
+
+        if (cbChunk < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return HRESULT_FROM_WIN32(errno);
+        }
+
+#endif
+
+        //The file was truncated since it was opened
+        if (cbChunk == 0)
+        {
+            break;
+        }
+
+        cbDone += (DWORD)cbChunk;
+        m_cbRead += (DWORD)cbChunk;
+    }
+
+    *pcbRead = cbDone;
+
+    return S_OK;
+}
@@ -0,0 +1,70 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// PositionalFile.h : CPositionalFile class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFTypes.h"
+
+//Read-only file read at explicit offsets (ReadFile with an offset,
+//pread), for callers that touch a small part of a large file. Unlike
+//CMappedFile, nothing is read that was not asked for: the file is
+//opened for random access so the system does not read ahead, and every
+//read is counted.
+
+class CPositionalFile
+{
+public:
+
+    CPositionalFile();
+    ~CPositionalFile();
+
+    HRESULT Open(const ASF_PATH_CHAR *sFileName);
+
+    void Close();
+
+    BOOL IsOpen() const;
+
+    QWORD GetSize() const
+    {
+        return m_cbSize;
+    }
+
+    //Reads up to cbToRead bytes; fewer only at the end of the file
+    HRESULT ReadAt(QWORD cbOffset, void* pBuffer, DWORD cbToRead, DWORD* pcbRead);
+
+    QWORD GetReadCount() const
+    {
+        return m_cReads;
+    }
+
+    QWORD GetBytesRead() const
+    {
+        return m_cbRead;
+    }
+
+private:
+
+    //Not copyable
+    CPositionalFile(const CPositionalFile&);
+    CPositionalFile& operator=(const CPositionalFile&);
+
+#ifdef _WIN32
+    HANDLE  m_hFile;
+#else
+    int     m_fd;
+#endif
+    QWORD   m_cbSize;
+
+    QWORD   m_cReads;
+    QWORD   m_cbRead;
+};
@@ -0,0 +1,185 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ReadPlanner.cpp : CReadPlanner class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "ReadPlanner.h"
+#include "ASFThread.h"
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CReadPlanner
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CReadPlanner::CReadPlanner()
+:   m_cbPacketSize (1),
+    m_cbMinReadSize (READ_PLANNER_MIN_READ_SIZE),
+    m_cbMaxReadSize (READ_PLANNER_MAX_READ_SIZE),
+    m_cbReadSize (READ_PLANNER_MIN_READ_SIZE),
+    m_llReadStart (0)
+{
+    ResetStats();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Initialize
+//
+// Sets the read alignment from the packet sizes in the File
+// Properties Object. ASF files normally have fixed-size packets
+// (minimum == maximum); otherwise the reads are not aligned.
+//
+// cbMinPacketSize: Minimum data packet size in bytes
+// cbMaxPacketSize: Maximum data packet size in bytes
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CReadPlanner::Initialize(DWORD cbMinPacketSize, DWORD cbMaxPacketSize)
+{
+    if ((cbMinPacketSize == cbMaxPacketSize) && (cbMaxPacketSize > 0))
+    {
+        m_cbPacketSize = cbMaxPacketSize;
+    }
+    else
+    {
+        m_cbPacketSize = 1;
+    }
+
+    //Smallest whole number of packets that is at least the minimum read size
+    m_cbMinReadSize = (m_cbPacketSize < READ_PLANNER_MIN_READ_SIZE) ?
+        RoundToPackets(READ_PLANNER_MIN_READ_SIZE + m_cbPacketSize - 1) : m_cbPacketSize;
+
+    //Largest whole number of packets that fits in the maximum read size.
+    //Packets larger than that are read one at a time.
+    m_cbMaxReadSize = RoundToPackets(READ_PLANNER_MAX_READ_SIZE);
+
+    if (m_cbMinReadSize > m_cbMaxReadSize)
+    {
+        m_cbMinReadSize = m_cbMaxReadSize;
+    }
+
+    OnSeek();
+    ResetStats();
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: OnSeek
+//
+// Starts a new scan. The next read is the minimum read size.
+/////////////////////////////////////////////////////////////////////
+
+void CReadPlanner::OnSeek()
+{
+    m_cbReadSize = m_cbMinReadSize;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetNextReadSize
+//
+// Returns the size of the next read and starts timing it. The size
+// is a whole number of packets unless it is the tail of the scan.
+//
+// cbRemaining: Number of bytes left to read in the scan
+/////////////////////////////////////////////////////////////////////
+
+DWORD CReadPlanner::GetNextReadSize(QWORD cbRemaining)
+{
+    m_llReadStart = CASFThread::GetTimestamp();
+
+    if (cbRemaining < m_cbReadSize)
+    {
+        return (DWORD)cbRemaining;
+    }
+
+    return m_cbReadSize;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: OnReadComplete
+//
+// Updates the counters for the read that GetNextReadSize planned,
+// and grows the next read while the scan stays sequential.
+//
+// cbRead: Number of bytes the read delivered
+/////////////////////////////////////////////////////////////////////
+
+void CReadPlanner::OnReadComplete(DWORD cbRead)
+{
+    m_Stats.cReads++;
+    m_Stats.cbRead += cbRead;
+    m_Stats.cbLastRead = cbRead;
+    m_Stats.hnsElapsed += CASFThread::GetTimestamp() - m_llReadStart;
+
+    if (cbRead > m_Stats.cbLargestRead)
+    {
+        m_Stats.cbLargestRead = cbRead;
+    }
+
+    if (m_cbReadSize < m_cbMaxReadSize)
+    {
+        m_cbReadSize = (m_cbReadSize > m_cbMaxReadSize / 2) ? m_cbMaxReadSize : RoundToPackets(m_cbReadSize * 2);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: GetStats
+//
+// Returns the counters collected since the last ResetStats.
+/////////////////////////////////////////////////////////////////////
+
+void CReadPlanner::GetStats(READ_PLANNER_STATS* pStats) const
+{
+    if (!pStats)
+    {
+        return;
+    }
+
+    *pStats = m_Stats;
+
+    if (m_Stats.hnsElapsed > 0)
+    {
+        pStats->cbPerSecond = (QWORD)((double)m_Stats.cbRead * 10000000.0 / (double)m_Stats.hnsElapsed);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: ResetStats
+//
+// Clears the counters.
+/////////////////////////////////////////////////////////////////////
+
+void CReadPlanner::ResetStats()
+{
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+// ----- Protected Methods -----------------------------------------------
+
+/////////////////////////////////////////////////////////////////////
+// Name: RoundToPackets
+//
+// Rounds a size down to a whole number of packets, at least one.
+/////////////////////////////////////////////////////////////////////
+
+DWORD CReadPlanner::RoundToPackets(DWORD cbSize) const
+{
+    DWORD cPackets = cbSize / m_cbPacketSize;
+
+    if (cPackets == 0)
+    {
+        cPackets = 1;
+    }
+
+    return cPackets * m_cbPacketSize;
+}
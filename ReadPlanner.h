@@ -0,0 +1,79 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ReadPlanner.h : CReadPlanner class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ASFTypes.h"
+
+//Read sizes, before they are rounded to whole packets
+#define READ_PLANNER_MIN_READ_SIZE      (1024 * 4)          // First read after a seek
+#define READ_PLANNER_MAX_READ_SIZE      (1024 * 1024 * 4)   // Largest sequential read
+
+//Counters collected since the last call to CReadPlanner::ResetStats.
+
+struct READ_PLANNER_STATS
+{
+    QWORD       cReads;             // Reads completed
+    QWORD       cbRead;             // Bytes delivered by those reads
+    DWORD       cbLastRead;         // Size of the most recent read
+    DWORD       cbLargestRead;      // Size of the largest read
+    LONGLONG    hnsElapsed;         // Time spent in reads, in 100-nanosecond units
+    QWORD       cbPerSecond;        // cbRead / hnsElapsed, zero if nothing was timed
+};
+
+
+//Plans the chunks that the demux loop reads from the ASF Data Object.
+//Every read is a whole number of data packets, so packets never straddle
+//two reads. The read size starts small after a seek, so the first
+//samples arrive quickly, and doubles with every read of a sequential
+//scan up to READ_PLANNER_MAX_READ_SIZE, or one packet if the packets
+//are larger.
+
+class CReadPlanner
+{
+public:
+
+    CReadPlanner();
+
+    HRESULT Initialize(DWORD cbMinPacketSize, DWORD cbMaxPacketSize);
+
+    void OnSeek();
+
+    DWORD GetNextReadSize(QWORD cbRemaining);
+
+    void OnReadComplete(DWORD cbRead);
+
+    void GetStats(READ_PLANNER_STATS* pStats) const;
+
+    void ResetStats();
+
+    //Alignment of the reads; 1 if the file has variable-size packets
+    DWORD GetPacketSize() const
+    {
+        return m_cbPacketSize;
+    }
+
+protected:
+
+    DWORD RoundToPackets(DWORD cbSize) const;
+
+protected:
+
+    DWORD       m_cbPacketSize;     // Read alignment
+    DWORD       m_cbMinReadSize;    // Whole packets, used right after a seek
+    DWORD       m_cbMaxReadSize;    // Whole packets, upper bound while scanning
+    DWORD       m_cbReadSize;       // Size of the next full read
+
+    LONGLONG    m_llReadStart;      // Timestamp of the read in progress
+    READ_PLANNER_STATS m_Stats;
+};
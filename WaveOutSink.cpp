@@ -0,0 +1,294 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// WaveOutSink.cpp : CWaveOutSink class implementation.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "MF_ASFParser.h"
+
+// ----- Public Methods -----------------------------------------------
+//////////////////////////////////////////////////////////////////////////
+//  Name: CWaveOutSink
+//  Description: Constructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CWaveOutSink::CWaveOutSink()
+:
+m_hWaveOut (NULL),
+m_hThread (NULL),
+m_pCallback (NULL),
+m_cBuffers (0)
+{
+    ZeroMemory(m_WaveHeaders, sizeof(m_WaveHeaders));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: ~CWaveOutSink
+//  Description: Destructor
+//
+/////////////////////////////////////////////////////////////////////////
+
+CWaveOutSink::~CWaveOutSink()
+{
+    (void)Close();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Open
+//
+// Opens the default waveOut device for the PCM format, with a thread
+// that receives the device messages.
+//
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CWaveOutSink::Open(const ASF_MEDIA_FORMAT& format, DWORD cBuffers, IASFAudioSinkCallback* pCallback)
+{
+    if (!pCallback || (cBuffers == 0) || (cBuffers > ASF_AUDIO_SINK_MAX_BUFFERS) ||
+        (format.nChannels == 0) || (format.nBlockAlign == 0))
+    {
+        return E_INVALIDARG;
+    }
+
+    //The decoders deliver PCM
+    WAVEFORMATEX wfx = { 0 };
+
+    wfx.wFormatTag = WAVE_FORMAT_PCM;
+    wfx.nChannels = format.nChannels;
+    wfx.nSamplesPerSec = format.nSamplesPerSec;
+    wfx.nBlockAlign = format.nBlockAlign;
+    wfx.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+    wfx.wBitsPerSample = format.wBitsPerSample;
+
+    HRESULT hr = S_OK;
+
+    //Query if the format is supported
+    MMRESULT mmr = waveOutOpen(
+        NULL,
+        WAVE_MAPPER,        // select the device for me
+        &wfx,               // format
+        0,
+        0,
+        WAVE_FORMAT_QUERY   // Query if the format is OK.
+        );
+
+    if (mmr != MMSYSERR_NOERROR)
+    {
+        return MF_E_INVALIDMEDIATYPE;
+    }
+
+    //make sure the device is not in use
+    hr = Close();
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // Create the thread that will handle messages from the waveOut device.
+    DWORD dwThreadId;
+
+    m_hThread = CreateThread( NULL, 0, WaveOutThreadProc, (void*)this, NULL, &dwThreadId );
+
+    if( NULL == m_hThread )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    m_pCallback = pCallback;
+    m_cBuffers = cBuffers;
+
+    // Open the device.
+    mmr = waveOutOpen(
+        &m_hWaveOut,            // receives the handle to the device
+        WAVE_MAPPER,            // select the device for me
+        &wfx,                   // format
+        (DWORD)dwThreadId,      // thread ID to get waveOut messages
+        (DWORD_PTR)this,        // instance data
+        CALLBACK_THREAD
+        );
+
+    if (mmr != MMSYSERR_NOERROR)
+    {
+        m_hWaveOut = NULL;
+
+        //No MM_WOM_CLOSE will come, so end the thread here. Posting
+        //fails until the thread has created its message queue.
+        while (!PostThreadMessage(dwThreadId, WM_QUIT, 0, 0))
+        {
+            Sleep(1);
+        }
+        WaitForSingleObject(m_hThread, INFINITE);
+        CloseHandle(m_hThread);
+        m_hThread = NULL;
+
+        m_pCallback = NULL;
+        hr = E_FAIL;
+    }
+
+    return hr;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Submit
+//
+// Queues a buffer on the waveOut device. The device plays the data in
+// place; the buffer comes back in MM_WOM_DONE.
+//
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CWaveOutSink::Submit(DWORD iBuffer, const BYTE* pData, DWORD cbData)
+{
+    if (!pData || (iBuffer >= m_cBuffers))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (!m_hWaveOut)
+    {
+        return MF_E_NOT_INITIALIZED;
+    }
+
+    WAVEHDR* pwh = &m_WaveHeaders[iBuffer];
+
+    // Prepare the header for playing.
+    ZeroMemory(pwh, sizeof(WAVEHDR));
+
+    pwh->lpData = (LPSTR)pData;
+    pwh->dwBufferLength = cbData;
+    pwh->dwBytesRecorded = cbData;
+    pwh->dwUser = iBuffer;
+
+    MMRESULT mmt = waveOutPrepareHeader( m_hWaveOut, pwh, sizeof( WAVEHDR ) );
+
+    if (mmt == MMSYSERR_NOERROR)
+    {
+        // Send the buffer to the waveOut device.
+        mmt = waveOutWrite( m_hWaveOut, pwh, sizeof( WAVEHDR ) );
+
+        if (mmt != MMSYSERR_NOERROR)
+        {
+            (void)waveOutUnprepareHeader(m_hWaveOut, pwh, sizeof(WAVEHDR));
+        }
+    }
+
+    return (mmt == MMSYSERR_NOERROR) ? S_OK : E_FAIL;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Reset
+//
+// Stops playback. The device returns every queued buffer through
+// MM_WOM_DONE.
+//
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CWaveOutSink::Reset()
+{
+    if (m_hWaveOut && (waveOutReset(m_hWaveOut) != MMSYSERR_NOERROR))
+    {
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Name: Close
+//
+// Closes the waveOut device, if open, and waits for the message
+// thread to end. Every buffer must have come back.
+//
+/////////////////////////////////////////////////////////////////////
+
+HRESULT CWaveOutSink::Close()
+{
+    if (m_hWaveOut != NULL)
+    {
+        if (waveOutClose(m_hWaveOut) !=  MMSYSERR_NOERROR)
+        {
+            return E_FAIL;
+        }
+        m_hWaveOut = NULL;
+    }
+
+    //The thread quits on MM_WOM_CLOSE
+    if (m_hThread != NULL)
+    {
+        WaitForSingleObject(m_hThread, INFINITE);
+        CloseHandle(m_hThread);
+        m_hThread = NULL;
+    }
+
+    m_pCallback = NULL;
+
+    return S_OK;
+}
+
+//-----------------------------------------------------------------------------
+// Name: WaveOutThreadProc
+// Desc: ThreadProc for the worker thread that handles waveOut messages.
+//
+// Note: This is a static method. It calls through to a member function.
+//-----------------------------------------------------------------------------
+
+DWORD WINAPI CWaveOutSink::WaveOutThreadProc( LPVOID lpParameter )
+{
+    CWaveOutSink* pThis = ( CWaveOutSink* )lpParameter;
+
+    // Redirect the processing to a non-static member function.
+
+    pThis->DoWaveOutThread();
+
+    return( 0 );
+}
+
+// ----- Private Methods -----------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Name: DoWaveOutThread
+// Desc: Implements the ThreadProc (see WaveOutThreadProc)
+//-----------------------------------------------------------------------------
+
+void CWaveOutSink::DoWaveOutThread()
+{
+    MSG         uMsg;
+
+    while( 0 != GetMessage( &uMsg, NULL, 0, 0 ) )
+    {
+        switch( uMsg.message )
+        {
+        case MM_WOM_DONE:  // waveOut has finished using an audio buffer.
+            {
+                WAVEHDR *pwh = (WAVEHDR*)uMsg.lParam;
+
+                DWORD iBuffer = (DWORD)pwh->dwUser;
+
+                // (1) Unprepare the wave header.
+                (void)waveOutUnprepareHeader(m_hWaveOut, pwh, sizeof(WAVEHDR));
+
+                // (2) Reset the WAVEHDR structure
+                ZeroMemory(pwh, sizeof(WAVEHDR));
+
+                // (3) Hand the buffer back. The callback may submit the
+                //     next one from this thread.
+                if (m_pCallback)
+                {
+                    m_pCallback->OnBufferDone(iBuffer);
+                }
+            }
+            break;
+
+        case MM_WOM_CLOSE:  // the waveOut device has closed.
+            // Tell the thread to quit:
+            PostQuitMessage( 0 );   // This causes GetMessage to return 0, so we exit the loop
+            break;
+        }
+    }
+}
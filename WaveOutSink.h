@@ -0,0 +1,51 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// WaveOutSink.h : CWaveOutSink class declaration.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+//Audio sink that plays the buffers on the default waveOut device. The
+//device reports finished buffers to a worker thread, which hands them
+//back to the callback.
+
+class CWaveOutSink : public IASFAudioSink
+{
+public:
+
+    CWaveOutSink();
+    ~CWaveOutSink();
+
+    // callback for waveOut functions
+    static DWORD WINAPI WaveOutThreadProc( LPVOID lpParameter );
+
+    // IASFAudioSink methods
+    HRESULT Open(const ASF_MEDIA_FORMAT& format, DWORD cBuffers, IASFAudioSinkCallback* pCallback);
+
+    HRESULT Submit(DWORD iBuffer, const BYTE* pData, DWORD cbData);
+
+    HRESULT Reset();
+
+    HRESULT Close();
+
+private:
+
+    HWAVEOUT    m_hWaveOut;         // handle to waveout device
+    HANDLE      m_hThread;          // handle to the thread.
+
+    IASFAudioSinkCallback*  m_pCallback;
+
+    DWORD       m_cBuffers;
+
+    WAVEHDR     m_WaveHeaders[ASF_AUDIO_SINK_MAX_BUFFERS];
+
+    void    DoWaveOutThread();
+};
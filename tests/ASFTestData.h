@@ -0,0 +1,526 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ASFTestData.h : Checks and ASF object builders shared by the tests.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+#include "ASFFormat.h"
+
+//Number of failed checks; a test returns it from main
+static int g_cTestFailures = 0;
+
+#define ASF_TEST_CHECK(expr) \
+    do \
+    { \
+        if (!(expr)) \
+        { \
+            fprintf(stderr, "%s(%d): check failed: %s\n", __FILE__, __LINE__, #expr); \
+            g_cTestFailures++; \
+        } \
+    } while (0)
+
+#define ASF_TEST_RESULT() \
+    ((g_cTestFailures == 0) ? (printf("passed\n"), 0) : (printf("%d check(s) failed\n", g_cTestFailures), 1))
+
+
+//Little-endian byte buffer the test data is built in
+
+class CASFTestWriter
+{
+public:
+
+    void WriteByte(BYTE b)
+    {
+        m_Data.push_back(b);
+    }
+
+    void WriteWord(WORD w)
+    {
+        BYTE rgb[2];
+        ASFWriteWord(rgb, w);
+        WriteBytes(rgb, sizeof(rgb));
+    }
+
+    void WriteDWord(DWORD dw)
+    {
+        BYTE rgb[4];
+        ASFWriteDWord(rgb, dw);
+        WriteBytes(rgb, sizeof(rgb));
+    }
+
+    void WriteQWord(QWORD qw)
+    {
+        BYTE rgb[8];
+        ASFWriteQWord(rgb, qw);
+        WriteBytes(rgb, sizeof(rgb));
+    }
+
+    void WriteGUID(const GUID& guid)
+    {
+        BYTE rgb[16];
+        ASFWriteGUID(rgb, guid);
+        WriteBytes(rgb, sizeof(rgb));
+    }
+
+    //Field of a 2-bit length type: 0 writes nothing
+    void WriteLengthType(DWORD dwLengthType, DWORD dwValue)
+    {
+        switch (dwLengthType)
+        {
+        case 1:
+            WriteByte((BYTE)dwValue);
+            break;
+        case 2:
+            WriteWord((WORD)dwValue);
+            break;
+        case 3:
+            WriteDWord(dwValue);
+            break;
+        }
+    }
+
+    void WriteBytes(const BYTE* pData, size_t cbData)
+    {
+        m_Data.insert(m_Data.end(), pData, pData + cbData);
+    }
+
+    void WriteFill(BYTE b, size_t cbFill)
+    {
+        m_Data.insert(m_Data.end(), cbFill, b);
+    }
+
+    void Write(const CASFTestWriter& data)
+    {
+        m_Data.insert(m_Data.end(), data.m_Data.begin(), data.m_Data.end());
+    }
+
+    //Object with a 24-byte header in front of the body
+    void WriteObject(const GUID& guidObject, const CASFTestWriter& body)
+    {
+        WriteGUID(guidObject);
+        WriteQWord(ASF_OBJECT_HEADER_SIZE + body.GetSize());
+        Write(body);
+    }
+
+    void PatchWord(size_t cbOffset, WORD w)
+    {
+        ASFWriteWord(&m_Data[cbOffset], w);
+    }
+
+    void PatchDWord(size_t cbOffset, DWORD dw)
+    {
+        ASFWriteDWord(&m_Data[cbOffset], dw);
+    }
+
+    void PatchQWord(size_t cbOffset, QWORD qw)
+    {
+        ASFWriteQWord(&m_Data[cbOffset], qw);
+    }
+
+    void PatchLengthType(size_t cbOffset, DWORD dwLengthType, DWORD dwValue)
+    {
+        switch (dwLengthType)
+        {
+        case 1:
+            m_Data[cbOffset] = (BYTE)dwValue;
+            break;
+        case 2:
+            ASFWriteWord(&m_Data[cbOffset], (WORD)dwValue);
+            break;
+        case 3:
+            ASFWriteDWord(&m_Data[cbOffset], dwValue);
+            break;
+        }
+    }
+
+    const BYTE* GetData() const
+    {
+        return m_Data.empty() ? NULL : &m_Data[0];
+    }
+
+    BYTE* GetData()
+    {
+        return m_Data.empty() ? NULL : &m_Data[0];
+    }
+
+    size_t GetSize() const
+    {
+        return m_Data.size();
+    }
+
+    void Clear()
+    {
+        m_Data.clear();
+    }
+
+private:
+
+    std::vector<BYTE>   m_Data;
+};
+
+
+static const GUID ASF_TEST_FILE_ID =
+    { 0x11223344, 0x5566, 0x7788, { 1, 2, 3, 4, 5, 6, 7, 8 } };
+
+//File Properties Object of a file with fixed-size packets
+inline void WriteTestFileProperties(
+    CASFTestWriter& header,
+    DWORD cbPacket,
+    QWORD cPackets,
+    QWORD hnsPlayDuration,
+    QWORD msPreroll
+    )
+{
+    CASFTestWriter body;
+
+    body.WriteGUID(ASF_TEST_FILE_ID);
+    body.WriteQWord(0);                         // File Size
+    body.WriteQWord(0x01D0000000000000ULL);     // Creation Date
+    body.WriteQWord(cPackets);
+    body.WriteQWord(hnsPlayDuration);
+    body.WriteQWord(hnsPlayDuration);           // Send Duration
+    body.WriteQWord(msPreroll);
+    body.WriteDWord(ASF_FILE_FLAG_SEEKABLE);
+    body.WriteDWord(cbPacket);
+    body.WriteDWord(cbPacket);
+    body.WriteDWord(128000);                    // Maximum Bitrate
+
+    header.WriteObject(ASF_File_Properties_Object, body);
+}
+
+//Stream Properties Object with cbTypeSpecific bytes of type-specific
+//data and no error correction data
+inline void WriteTestStreamProperties(
+    CASFTestWriter& header,
+    WORD wStreamNumber,
+    const GUID& guidStreamType,
+    DWORD cbTypeSpecific
+    )
+{
+    CASFTestWriter body;
+
+    body.WriteGUID(guidStreamType);
+    body.WriteGUID(GUID_NULL);                  // Error Correction Type
+    body.WriteQWord(0);                         // Time Offset
+    body.WriteDWord(cbTypeSpecific);
+    body.WriteDWord(0);
+    body.WriteWord(wStreamNumber);
+    body.WriteDWord(0);                         // Reserved
+    body.WriteFill(0xA5, cbTypeSpecific);
+
+    header.WriteObject(ASF_Stream_Properties_Object, body);
+}
+
+//Header Object around the objects in children
+inline void WriteTestHeaderObject(CASFTestWriter& file, const CASFTestWriter& children, DWORD cObjects)
+{
+    file.WriteGUID(ASF_Header_Object);
+    file.WriteQWord(ASF_HEADER_OBJECT_SIZE + children.GetSize());
+    file.WriteDWord(cObjects);
+    file.WriteByte(1);                          // Reserved1
+    file.WriteByte(2);                          // Reserved2
+    file.Write(children);
+}
+
+inline void WriteTestDataObjectHeader(CASFTestWriter& file, DWORD cbPacket, QWORD cPackets)
+{
+    file.WriteGUID(ASF_Data_Object);
+    file.WriteQWord(ASF_DATA_OBJECT_HEADER_SIZE + cPackets * cbPacket);
+    file.WriteGUID(ASF_TEST_FILE_ID);
+    file.WriteQWord(cPackets);
+    file.WriteWord(0x0101);                     // Reserved
+}
+
+
+//Payload of a test packet. Replicated data of 8 bytes or more starts
+//with the media object size and the presentation time; a replicated
+//data length of 1 is the presentation time delta of a compressed
+//payload, and pData then holds the sub-payloads.
+struct ASF_TEST_PAYLOAD
+{
+    BYTE        bStreamNumber;          // With ASF_PAYLOAD_KEY_FRAME for key frames
+    DWORD       dwMediaObjectNumber;
+    DWORD       dwOffset;               // Presentation time if compressed
+    DWORD       cbReplicated;
+    DWORD       cbMediaObjectSize;
+    DWORD       dwPresentationTime;     // Presentation time delta if compressed
+    const BYTE* pData;
+    DWORD       cbData;
+};
+
+//Packet header fields of a test packet. The length types of the
+//fields come from the flags; field values are cut to their length
+//type.
+struct ASF_TEST_PACKET
+{
+    DWORD   cbErrorCorrectionData;      // Error correction data after the flags byte; 0 writes no error correction data
+    BYTE    bLengthTypeFlags;
+    BYTE    bPropertyFlags;
+    DWORD   dwPayloadLengthType;        // Multiple payloads only
+    DWORD   cbPacket;                   // Padded size, if the flags have a padding length
+    DWORD   dwSequence;
+    DWORD   dwSendTime;
+    WORD    wDuration;
+};
+
+//Data packet in the layout of the ASF specification. A packet without
+//a padding length field ends after its last payload; an explicit
+//packet length field holds the size of the packet.
+inline void WriteTestPacket(
+    CASFTestWriter& packet,
+    const ASF_TEST_PACKET& header,
+    const ASF_TEST_PAYLOAD* pPayloads,
+    DWORD cPayloads
+    )
+{
+    const BYTE bFlags = header.bLengthTypeFlags;
+    const BOOL fMultiplePayloads = (bFlags & ASF_PACKET_MULTIPLE_PAYLOADS) ? TRUE : FALSE;
+
+    const DWORD dwPacketLengthType = ASF_LENGTH_TYPE(bFlags, ASF_PACKET_LENGTH_TYPE_SHIFT);
+    const DWORD dwPaddingLengthType = ASF_LENGTH_TYPE(bFlags, ASF_PADDING_LENGTH_TYPE_SHIFT);
+
+    const DWORD dwObjectNumberType = ASF_LENGTH_TYPE(header.bPropertyFlags, ASF_OBJECT_NUMBER_LENGTH_TYPE_SHIFT);
+    const DWORD dwOffsetType = ASF_LENGTH_TYPE(header.bPropertyFlags, ASF_OFFSET_LENGTH_TYPE_SHIFT);
+    const DWORD dwReplicatedType = ASF_LENGTH_TYPE(header.bPropertyFlags, ASF_REPLICATED_LENGTH_TYPE_SHIFT);
+
+    const size_t cbStart = packet.GetSize();
+
+    if (header.cbErrorCorrectionData > 0)
+    {
+        packet.WriteByte((BYTE)(ASF_EC_PRESENT | header.cbErrorCorrectionData));
+        packet.WriteFill(0, header.cbErrorCorrectionData);
+    }
+
+    packet.WriteByte(bFlags);
+    packet.WriteByte(header.bPropertyFlags);
+
+    const size_t cbPacketLengthField = packet.GetSize();
+    packet.WriteLengthType(dwPacketLengthType, 0);
+    packet.WriteLengthType(ASF_LENGTH_TYPE(bFlags, ASF_SEQUENCE_TYPE_SHIFT), header.dwSequence);
+
+    const size_t cbPaddingField = packet.GetSize();
+    packet.WriteLengthType(dwPaddingLengthType, 0);
+
+    packet.WriteDWord(header.dwSendTime);
+    packet.WriteWord(header.wDuration);
+
+    if (fMultiplePayloads)
+    {
+        packet.WriteByte((BYTE)(cPayloads | (header.dwPayloadLengthType << ASF_PAYLOAD_LENGTH_TYPE_SHIFT)));
+    }
+
+    for (DWORD i = 0; i < cPayloads; i++)
+    {
+        const ASF_TEST_PAYLOAD& payload = pPayloads[i];
+
+        packet.WriteByte(payload.bStreamNumber);
+        packet.WriteLengthType(dwObjectNumberType, payload.dwMediaObjectNumber);
+        packet.WriteLengthType(dwOffsetType, payload.dwOffset);
+        packet.WriteLengthType(dwReplicatedType, payload.cbReplicated);
+
+        if (payload.cbReplicated == ASF_COMPRESSED_REPLICATED_LENGTH)
+        {
+            packet.WriteByte((BYTE)payload.dwPresentationTime);
+        }
+        else if (payload.cbReplicated >= ASF_REPLICATED_DATA_MIN_SIZE)
+        {
+            packet.WriteDWord(payload.cbMediaObjectSize);
+            packet.WriteDWord(payload.dwPresentationTime);
+            packet.WriteFill(0xEE, payload.cbReplicated - ASF_REPLICATED_DATA_MIN_SIZE);
+        }
+        else
+        {
+            packet.WriteFill(0xEE, payload.cbReplicated);
+        }
+
+        if (fMultiplePayloads)
+        {
+            packet.WriteLengthType(header.dwPayloadLengthType, payload.cbData);
+        }
+
+        packet.WriteBytes(payload.pData, payload.cbData);
+    }
+
+    if ((dwPaddingLengthType != 0) && (header.cbPacket > packet.GetSize() - cbStart))
+    {
+        DWORD cbPadding = (DWORD)(header.cbPacket - (packet.GetSize() - cbStart));
+
+        packet.PatchLengthType(cbPaddingField, dwPaddingLengthType, cbPadding);
+        packet.WriteFill(0, cbPadding);
+    }
+
+    packet.PatchLengthType(cbPacketLengthField, dwPacketLengthType, (DWORD)(packet.GetSize() - cbStart));
+}
+
+
+//Streams and timing of the files WriteTestMediaFile writes
+#define ASF_TEST_VIDEO_STREAM           1
+#define ASF_TEST_AUDIO_STREAM           2
+#define ASF_TEST_PREROLL                3000    // Milliseconds
+#define ASF_TEST_PACKET_MS              500     // Send time between packets
+#define ASF_TEST_KEY_FRAME_INTERVAL     4       // Video objects per key frame
+
+//Replicated data BYTE, offset DWORD, object number BYTE, stream number BYTE
+#define ASF_TEST_MEDIA_PROPERTY_FLAGS   0x5D
+
+//Byte i of a media object of the test files
+inline BYTE GetTestObjectByte(WORD wStreamNumber, DWORD dwMediaObjectNumber, DWORD i)
+{
+    return (BYTE)(wStreamNumber * 0x40 + dwMediaObjectNumber * 7 + i);
+}
+
+//Appends a media test packet. Packet i is sent at i * ASF_TEST_PACKET_MS
+//and holds half of video object i / 2 and all of audio object i. Video
+//object k is presented at 2k * ASF_TEST_PACKET_MS and is a key frame
+//if k is a multiple of ASF_TEST_KEY_FRAME_INTERVAL; audio object i is
+//presented at i * ASF_TEST_PACKET_MS and is always a key frame. Times
+//include ASF_TEST_PREROLL. The packet is padded to cbPacket.
+inline void WriteTestMediaPacket(
+    CASFTestWriter& data,
+    DWORD cbPacket,
+    DWORD iPacket,
+    DWORD cbVideoObject,
+    DWORD cbAudioObject
+    )
+{
+    const DWORD dwVideoObject = iPacket / 2;
+    const DWORD cbFirstHalf = cbVideoObject / 2;
+    const DWORD dwOffset = (iPacket % 2 == 0) ? 0 : cbFirstHalf;
+    const DWORD cbVideo = (iPacket % 2 == 0) ? cbFirstHalf : cbVideoObject - cbFirstHalf;
+
+    std::vector<BYTE> video(cbVideo + 1), audio(cbAudioObject + 1);
+
+    for (DWORD i = 0; i < cbVideo; i++)
+    {
+        video[i] = GetTestObjectByte(ASF_TEST_VIDEO_STREAM, dwVideoObject, dwOffset + i);
+    }
+
+    for (DWORD i = 0; i < cbAudioObject; i++)
+    {
+        audio[i] = GetTestObjectByte(ASF_TEST_AUDIO_STREAM, iPacket, i);
+    }
+
+    const BYTE bVideoKey = (dwVideoObject % ASF_TEST_KEY_FRAME_INTERVAL == 0) ? ASF_PAYLOAD_KEY_FRAME : 0;
+
+    ASF_TEST_PAYLOAD rgPayloads[] =
+    {
+        {
+            (BYTE)(bVideoKey | ASF_TEST_VIDEO_STREAM), dwVideoObject, dwOffset, 8, cbVideoObject,
+            ASF_TEST_PREROLL + 2 * dwVideoObject * ASF_TEST_PACKET_MS, &video[0], cbVideo
+        },
+        {
+            ASF_PAYLOAD_KEY_FRAME | ASF_TEST_AUDIO_STREAM, iPacket, 0, 8, cbAudioObject,
+            ASF_TEST_PREROLL + iPacket * ASF_TEST_PACKET_MS, &audio[0], cbAudioObject
+        },
+    };
+
+    //Padding DWORD, payload lengths WORD
+    ASF_TEST_PACKET header =
+    {
+        2, ASF_PACKET_MULTIPLE_PAYLOADS | (3 << ASF_PADDING_LENGTH_TYPE_SHIFT), ASF_TEST_MEDIA_PROPERTY_FLAGS, 2,
+        cbPacket, iPacket, iPacket * ASF_TEST_PACKET_MS, ASF_TEST_PACKET_MS
+    };
+
+    WriteTestPacket(data, header, rgPayloads, 2);
+}
+
+//Header Object with a video and an audio stream, Data Object header
+//and cPackets media test packets
+inline void WriteTestMediaFile(
+    CASFTestWriter& file,
+    DWORD cbPacket,
+    DWORD cPackets,
+    DWORD cbVideoObject,
+    DWORD cbAudioObject
+    )
+{
+    CASFTestWriter children;
+
+    WriteTestFileProperties(children, cbPacket, cPackets, (QWORD)cPackets * ASF_TEST_PACKET_MS * 10000, ASF_TEST_PREROLL);
+    WriteTestStreamProperties(children, ASF_TEST_VIDEO_STREAM, ASF_Video_Media, 40);
+    WriteTestStreamProperties(children, ASF_TEST_AUDIO_STREAM, ASF_Audio_Media, 18);
+
+    WriteTestHeaderObject(file, children, 3);
+    WriteTestDataObjectHeader(file, cbPacket, cPackets);
+
+    for (DWORD i = 0; i < cPackets; i++)
+    {
+        WriteTestMediaPacket(file, cbPacket, i, cbVideoObject, cbAudioObject);
+    }
+}
+
+
+//Files the tests write next to the test executable
+inline BOOL WriteTestFile(const ASF_PATH_CHAR* sFileName, const CASFTestWriter& data)
+{
+#ifdef _WIN32
+    FILE* pFile = NULL;
+    if (_wfopen_s(&pFile, sFileName, L"wb") != 0)
+    {
+        pFile = NULL;
+    }
+#else
+    FILE* pFile = fopen(sFileName, "wb");
+#endif
+
+    if (!pFile)
+    {
+        return FALSE;
+    }
+
+    BOOL fWritten = (data.GetSize() == 0) || (fwrite(data.GetData(), 1, data.GetSize(), pFile) == data.GetSize());
+
+    return (fclose(pFile) == 0) && fWritten;
+}
+
+inline BOOL ReadTestFile(const ASF_PATH_CHAR* sFileName, std::vector<BYTE>& data)
+{
+#ifdef _WIN32
+    FILE* pFile = NULL;
+    if (_wfopen_s(&pFile, sFileName, L"rb") != 0)
+    {
+        pFile = NULL;
+    }
+#else
+    FILE* pFile = fopen(sFileName, "rb");
+#endif
+
+    data.clear();
+
+    if (!pFile)
+    {
+        return FALSE;
+    }
+
+    BYTE Chunk[4096];
+    size_t cbChunk = 0;
+
+    while ((cbChunk = fread(Chunk, 1, sizeof(Chunk), pFile)) > 0)
+    {
+        data.insert(data.end(), Chunk, Chunk + cbChunk);
+    }
+
+    BOOL fRead = !ferror(pFile);
+
+    return (fclose(pFile) == 0) && fRead;
+}
+
+inline void DeleteTestFile(const ASF_PATH_CHAR* sFileName)
+{
+#ifdef _WIN32
+    (void)_wremove(sFileName);
+#else
+    (void)remove(sFileName);
+#endif
+}
@@ -0,0 +1,486 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// AudioStreamTest.cpp : CASFAudioStream tests with a test sink, the
+//                       null sink and the WAVE file sink.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "ASFAudioStream.h"
+#include "ASFNullAudioSink.h"
+#include "ASFWaveFileSink.h"
+#include "ASFTestData.h"
+
+//16-bit mono at 8 kHz: 16000 bytes per second, 1600 bytes per
+//100 ms buffer
+#define TEST_SAMPLE_RATE    8000
+#define TEST_BLOCK_ALIGN    2
+#define TEST_BYTES_PER_SEC  (TEST_SAMPLE_RATE * TEST_BLOCK_ALIGN)
+#define TEST_BUFFER_SIZE    1600
+#define TEST_RING_SIZE      8000
+#define TEST_BUFFERS        4
+
+#define TEST_CHUNK_SIZE     1000
+#define TEST_STREAM_SIZE    64000   // Many times the ring
+
+#ifdef _WIN32
+static const ASF_PATH_CHAR s_szWaveFile[] = L"AudioStreamTest.wav";
+static const ASF_PATH_CHAR s_szBadPath[] = L"AudioStreamTest.missing/AudioStreamTest.wav";
+#else
+static const ASF_PATH_CHAR s_szWaveFile[] = "AudioStreamTest.wav";
+static const ASF_PATH_CHAR s_szBadPath[] = "AudioStreamTest.missing/AudioStreamTest.wav";
+#endif
+
+static ASF_MEDIA_FORMAT GetTestFormat()
+{
+    ASF_MEDIA_FORMAT format;
+
+    memset(&format, 0, sizeof(format));
+    format.guidMajorType = ASF_Audio_Media;
+    format.nChannels = 1;
+    format.nSamplesPerSec = TEST_SAMPLE_RATE;
+    format.nBlockAlign = TEST_BLOCK_ALIGN;
+    format.wBitsPerSample = 16;
+
+    return format;
+}
+
+//Byte i of the test audio; the seed tells streams apart
+static void MakeTestAudio(DWORD cbData, BYTE bSeed, std::vector<BYTE>& data)
+{
+    data.resize(cbData);
+
+    for (DWORD i = 0; i < cbData; i++)
+    {
+        data[i] = (BYTE)(bSeed + i + i / 251);
+    }
+}
+
+//Records what is submitted. Hands every buffer back from inside
+//Submit, or holds them until HandBack, like a device that plays them.
+class CTestSink : public IASFAudioSink
+{
+public:
+
+    CTestSink()
+    :   m_pCallback(NULL),
+        m_fHold(FALSE),
+        m_cHeld(0),
+        m_iFirstHeld(0),
+        m_cOpen(0),
+        m_cClose(0),
+        m_cReset(0),
+        m_fBadBuffer(FALSE)
+    {
+    }
+
+    virtual HRESULT Open(const ASF_MEDIA_FORMAT& format, DWORD cBuffers, IASFAudioSinkCallback* pCallback)
+    {
+        if ((format.nBlockAlign != TEST_BLOCK_ALIGN) || (cBuffers > ASF_AUDIO_SINK_MAX_BUFFERS))
+        {
+            return E_INVALIDARG;
+        }
+
+        m_pCallback = pCallback;
+        m_cOpen++;
+        return S_OK;
+    }
+
+    virtual HRESULT Submit(DWORD iBuffer, const BYTE* pData, DWORD cbData)
+    {
+        BOOL fHold = FALSE;
+
+        {
+            CASFAutoLock lock(m_Lock);
+
+            if ((cbData == 0) || (cbData > TEST_BUFFER_SIZE) || (cbData % TEST_BLOCK_ALIGN != 0) ||
+                (m_cHeld == ASF_AUDIO_SINK_MAX_BUFFERS))
+            {
+                m_fBadBuffer = TRUE;
+            }
+
+            m_Data.insert(m_Data.end(), pData, pData + cbData);
+
+            fHold = m_fHold && (m_cHeld < ASF_AUDIO_SINK_MAX_BUFFERS);
+
+            if (fHold)
+            {
+                m_rgiHeld[(m_iFirstHeld + m_cHeld) % ASF_AUDIO_SINK_MAX_BUFFERS] = iBuffer;
+                m_cHeld++;
+            }
+        }
+
+        if (!fHold)
+        {
+            m_pCallback->OnBufferDone(iBuffer);
+        }
+
+        return S_OK;
+    }
+
+    virtual HRESULT Reset()
+    {
+        m_cReset++;
+        HandBack(ASF_AUDIO_SINK_MAX_BUFFERS);
+        return S_OK;
+    }
+
+    virtual HRESULT Close()
+    {
+        m_cClose++;
+        m_pCallback = NULL;
+        return S_OK;
+    }
+
+    //Hands back up to cBuffers of the held buffers, oldest first. The
+    //stream is called without the sink lock; it submits from inside.
+    void HandBack(DWORD cBuffers)
+    {
+        for (DWORD i = 0; i < cBuffers; i++)
+        {
+            DWORD iBuffer = 0;
+
+            {
+                CASFAutoLock lock(m_Lock);
+
+                if (m_cHeld == 0)
+                {
+                    return;
+                }
+
+                iBuffer = m_rgiHeld[m_iFirstHeld];
+                m_iFirstHeld = (m_iFirstHeld + 1) % ASF_AUDIO_SINK_MAX_BUFFERS;
+                m_cHeld--;
+            }
+
+            m_pCallback->OnBufferDone(iBuffer);
+        }
+    }
+
+    DWORD GetHeldCount()
+    {
+        CASFAutoLock lock(m_Lock);
+        return m_cHeld;
+    }
+
+    CASFLock                m_Lock;
+    IASFAudioSinkCallback*  m_pCallback;
+    BOOL                    m_fHold;
+
+    DWORD                   m_rgiHeld[ASF_AUDIO_SINK_MAX_BUFFERS];
+    DWORD                   m_cHeld;
+    DWORD                   m_iFirstHeld;
+
+    std::vector<BYTE>       m_Data;
+    DWORD                   m_cOpen;
+    DWORD                   m_cClose;
+    DWORD                   m_cReset;
+    BOOL                    m_fBadBuffer;
+};
+
+//Plays the buffers a CTestSink holds, one every millisecond
+struct TEST_PLAYER
+{
+    CTestSink*      pSink;
+    volatile LONG   fStop;
+};
+
+static void PlayerProc(void* pContext)
+{
+    TEST_PLAYER* pPlayer = (TEST_PLAYER*)pContext;
+
+    while (!ASFLoadAcquire(&pPlayer->fStop))
+    {
+        pPlayer->pSink->HandBack(1);
+        CASFThread::SleepThread(1);
+    }
+}
+
+//Counts the buffers a sink hands back
+class CTestSinkCallback : public IASFAudioSinkCallback
+{
+public:
+
+    CTestSinkCallback()
+    :   m_cDone(0)
+    {
+    }
+
+    virtual void OnBufferDone(DWORD iBuffer)
+    {
+        (void)iBuffer;
+        m_cDone++;
+    }
+
+    DWORD   m_cDone;
+};
+
+//A sink that plays on its own thread: the writer waits for it while
+//the ring is full, and every byte comes out once, in order
+static void TestPlayback()
+{
+    CTestSink sink;
+    CASFAudioStream stream;
+    ASF_AUDIO_STREAM_STATS stats;
+    std::vector<BYTE> audio;
+
+    TEST_PLAYER player = { &sink, FALSE };
+    CASFThread thread;
+
+    MakeTestAudio(TEST_STREAM_SIZE, 0, audio);
+
+    sink.m_fHold = TRUE;
+
+    ASF_TEST_CHECK(stream.Initialize(&sink, GetTestFormat(), TEST_RING_SIZE, TEST_BUFFERS, 0) == S_OK);
+    ASF_TEST_CHECK(sink.m_cOpen == 1);
+
+    //Output starts with the first whole buffer
+    ASF_TEST_CHECK(stream.Write(&audio[0], TEST_BUFFER_SIZE - TEST_BLOCK_ALIGN) == S_OK);
+    ASF_TEST_CHECK(!stream.IsPlaying());
+    ASF_TEST_CHECK(stream.Write(&audio[TEST_BUFFER_SIZE - TEST_BLOCK_ALIGN], TEST_BLOCK_ALIGN) == S_OK);
+    ASF_TEST_CHECK(stream.IsPlaying());
+    ASF_TEST_CHECK(sink.GetHeldCount() == 1);
+
+    ASF_TEST_CHECK(thread.Start(PlayerProc, &player) == S_OK);
+
+    for (DWORD cb = TEST_BUFFER_SIZE; cb < TEST_STREAM_SIZE; cb += TEST_CHUNK_SIZE)
+    {
+        DWORD cbChunk = (TEST_STREAM_SIZE - cb < TEST_CHUNK_SIZE) ? TEST_STREAM_SIZE - cb : TEST_CHUNK_SIZE;
+
+        ASF_TEST_CHECK(stream.Write(&audio[cb], cbChunk) == S_OK);
+    }
+
+    ASF_TEST_CHECK(stream.EndOfStream() == S_OK);
+
+    while (stream.IsPlaying())
+    {
+        CASFThread::SleepThread(1);
+    }
+
+    ASFStoreRelease(&player.fStop, TRUE);
+    thread.Join();
+
+    ASF_TEST_CHECK(!sink.m_fBadBuffer);
+    ASF_TEST_CHECK(sink.m_Data == audio);
+
+    stream.GetStats(&stats);
+    ASF_TEST_CHECK(stats.cbSubmitted == TEST_STREAM_SIZE);
+    ASF_TEST_CHECK(stats.cbDropped == 0);
+    ASF_TEST_CHECK(stats.cWriterWaits > 0);
+    ASF_TEST_CHECK(stats.cMaxInFlight == TEST_BUFFERS);
+    ASF_TEST_CHECK(stats.cBuffers >= TEST_STREAM_SIZE / TEST_BUFFER_SIZE);
+
+    ASF_TEST_CHECK(stream.Shutdown() == S_OK);
+    ASF_TEST_CHECK(sink.m_cClose == 1);
+}
+
+//Writes in place, Reset with buffers on the sink, Replay, Shutdown
+static void TestWriterCalls()
+{
+    CTestSink sink;
+    CASFAudioStream stream;
+    ASF_AUDIO_STREAM_STATS stats;
+    std::vector<BYTE> audio;
+    BYTE* pData = NULL;
+
+    MakeTestAudio(2 * TEST_RING_SIZE, 0x40, audio);
+
+    ASF_TEST_CHECK(stream.Write(&audio[0], TEST_BLOCK_ALIGN) == MF_E_NOT_INITIALIZED);
+    ASF_TEST_CHECK(stream.BeginWrite(TEST_BLOCK_ALIGN, &pData) == MF_E_NOT_INITIALIZED);
+
+    ASF_TEST_CHECK(stream.Initialize(NULL, GetTestFormat(), TEST_RING_SIZE, 0, 0) == E_INVALIDARG);
+    ASF_TEST_CHECK(stream.Initialize(&sink, GetTestFormat(), TEST_RING_SIZE, ASF_AUDIO_SINK_MAX_BUFFERS + 1, 0) == E_INVALIDARG);
+    ASF_TEST_CHECK(stream.Initialize(&sink, GetTestFormat(), TEST_RING_SIZE, 0, 10000001) == E_INVALIDARG);
+
+    ASF_MEDIA_FORMAT format = GetTestFormat();
+    format.nBlockAlign = 0;
+    ASF_TEST_CHECK(stream.Initialize(&sink, format, TEST_RING_SIZE, 0, 0) == E_INVALIDARG);
+
+    ASF_TEST_CHECK(stream.Initialize(&sink, GetTestFormat(), TEST_RING_SIZE, TEST_BUFFERS, 0) == S_OK);
+
+    //In place; a partial block at the end is not published
+    ASF_TEST_CHECK(stream.BeginWrite(TEST_CHUNK_SIZE, &pData) == S_OK);
+
+    if (pData)
+    {
+        memcpy(pData, &audio[0], TEST_CHUNK_SIZE);
+        ASF_TEST_CHECK(stream.CommitWrite(TEST_CHUNK_SIZE + 1) == S_OK);
+    }
+
+    //A partial block is dropped and counted
+    ASF_TEST_CHECK(stream.Write(&audio[TEST_CHUNK_SIZE], TEST_CHUNK_SIZE + 1) == S_FALSE);
+    ASF_TEST_CHECK(stream.EndOfStream() == S_OK);
+
+    ASF_TEST_CHECK(!sink.m_fBadBuffer);
+    ASF_TEST_CHECK(sink.m_Data.size() == 2 * TEST_CHUNK_SIZE);
+    ASF_TEST_CHECK(memcmp(&sink.m_Data[0], &audio[0], 2 * TEST_CHUNK_SIZE) == 0);
+
+    stream.GetStats(&stats);
+    ASF_TEST_CHECK(stats.cbDropped == 1);
+    ASF_TEST_CHECK(stats.cbSubmitted == 2 * TEST_CHUNK_SIZE);
+
+    //The same data once more, in the same order
+    ASF_TEST_CHECK(stream.Replay() == S_OK);
+    ASF_TEST_CHECK(sink.m_Data.size() == 4 * TEST_CHUNK_SIZE);
+    ASF_TEST_CHECK(memcmp(&sink.m_Data[2 * TEST_CHUNK_SIZE], &audio[0], 2 * TEST_CHUNK_SIZE) == 0);
+
+    //Reset while the sink holds buffers gets them all back
+    sink.m_fHold = TRUE;
+    sink.m_Data.clear();
+
+    ASF_TEST_CHECK(stream.Reset() == S_OK);
+    ASF_TEST_CHECK(stream.Replay() == MF_E_INVALIDREQUEST);
+
+    ASF_TEST_CHECK(stream.Write(&audio[0], TEST_BUFFERS * TEST_BUFFER_SIZE) == S_OK);
+    ASF_TEST_CHECK(sink.GetHeldCount() == TEST_BUFFERS);
+
+    DWORD cResets = sink.m_cReset;
+
+    ASF_TEST_CHECK(stream.Reset() == S_OK);
+    ASF_TEST_CHECK(sink.m_cReset == cResets + 1);
+    ASF_TEST_CHECK(sink.GetHeldCount() == 0);
+    ASF_TEST_CHECK(!stream.IsPlaying());
+
+    stream.GetStats(&stats);
+    ASF_TEST_CHECK(stats.cBuffers == 0);
+    ASF_TEST_CHECK(stats.cbSubmitted == 0);
+
+    //More than the ring holds can no longer be replayed
+    sink.m_fHold = FALSE;
+
+    ASF_TEST_CHECK(stream.Write(&audio[0], 2 * TEST_RING_SIZE) == S_OK);
+    ASF_TEST_CHECK(stream.Replay() == MF_E_INVALIDREQUEST);
+
+    ASF_TEST_CHECK(stream.Shutdown() == S_OK);
+    ASF_TEST_CHECK(sink.m_cClose == 1);
+    ASF_TEST_CHECK(stream.Write(&audio[0], TEST_BLOCK_ALIGN) == MF_E_NOT_INITIALIZED);
+}
+
+//The null sink plays against its clock: a burst is on time, a buffer
+//after a pause is an underrun
+static void TestNullSink()
+{
+    CASFNullAudioSink sink;
+    CASFAudioStream stream;
+    CTestSinkCallback callback;
+    ASF_NULL_AUDIO_SINK_STATS stats;
+    std::vector<BYTE> audio;
+
+    MakeTestAudio(TEST_BYTES_PER_SEC, 0, audio);
+
+    ASF_TEST_CHECK(sink.Submit(0, &audio[0], TEST_BLOCK_ALIGN) == MF_E_NOT_INITIALIZED);
+    ASF_TEST_CHECK(sink.Open(GetTestFormat(), TEST_BUFFERS, NULL) == E_INVALIDARG);
+
+    ASF_TEST_CHECK(stream.Initialize(&sink, GetTestFormat(), TEST_RING_SIZE, TEST_BUFFERS, 0) == S_OK);
+    ASF_TEST_CHECK(stream.Write(&audio[0], TEST_BYTES_PER_SEC) == S_OK);
+    ASF_TEST_CHECK(stream.EndOfStream() == S_OK);
+    ASF_TEST_CHECK(!stream.IsPlaying());
+
+    sink.GetStats(&stats);
+    ASF_TEST_CHECK(stats.cbData == TEST_BYTES_PER_SEC);
+    ASF_TEST_CHECK(stats.cBuffers >= TEST_BYTES_PER_SEC / TEST_BUFFER_SIZE);
+    ASF_TEST_CHECK(stats.hnsAudio == 10000000);
+    ASF_TEST_CHECK(stats.cUnderruns == 0);
+
+    ASF_TEST_CHECK(stream.Shutdown() == S_OK);
+
+    //10 ms of audio, then a pause of three times that
+    ASF_TEST_CHECK(sink.Open(GetTestFormat(), TEST_BUFFERS, &callback) == S_OK);
+    ASF_TEST_CHECK(sink.Submit(0, &audio[0], TEST_BYTES_PER_SEC / 100) == S_OK);
+
+    CASFThread::SleepThread(30);
+
+    ASF_TEST_CHECK(sink.Submit(1, &audio[0], TEST_BYTES_PER_SEC / 100) == S_OK);
+    ASF_TEST_CHECK(callback.m_cDone == 2);
+
+    sink.GetStats(&stats);
+    ASF_TEST_CHECK(stats.cBuffers == 2);
+    ASF_TEST_CHECK(stats.hnsAudio == 200000);
+    ASF_TEST_CHECK(stats.cUnderruns == 1);
+    ASF_TEST_CHECK(stats.hnsUnderrun > 0);
+
+    ASF_TEST_CHECK(sink.Close() == S_OK);
+}
+
+//The file holds a PCM WAVE header with the final sizes and the audio
+//written since the last Reset
+static void TestWaveFileSink()
+{
+    CASFWaveFileSink* pSink = NULL;
+    CASFAudioStream stream;
+    std::vector<BYTE> dropped, audio, file;
+
+    MakeTestAudio(5000, 0x80, dropped);
+    MakeTestAudio(3000, 0x20, audio);
+
+    ASF_TEST_CHECK(CASFWaveFileSink::CreateInstance(NULL, &pSink) == E_INVALIDARG);
+    ASF_TEST_CHECK(FAILED(CASFWaveFileSink::CreateInstance(s_szBadPath, &pSink)));
+
+    ASF_TEST_CHECK(CASFWaveFileSink::CreateInstance(s_szWaveFile, &pSink) == S_OK);
+
+    if (!pSink)
+    {
+        return;
+    }
+
+    ASF_TEST_CHECK(pSink->Submit(0, &audio[0], TEST_BLOCK_ALIGN) == MF_E_NOT_INITIALIZED);
+
+    ASF_TEST_CHECK(stream.Initialize(pSink, GetTestFormat(), TEST_RING_SIZE, TEST_BUFFERS, 0) == S_OK);
+
+    ASF_TEST_CHECK(stream.Write(&dropped[0], 5000) == S_OK);
+    ASF_TEST_CHECK(stream.EndOfStream() == S_OK);
+    ASF_TEST_CHECK(pSink->GetDataSize() == 5000);
+
+    ASF_TEST_CHECK(stream.Reset() == S_OK);
+    ASF_TEST_CHECK(pSink->GetDataSize() == 0);
+
+    ASF_TEST_CHECK(stream.Write(&audio[0], 3000) == S_OK);
+    ASF_TEST_CHECK(stream.EndOfStream() == S_OK);
+    ASF_TEST_CHECK(stream.Shutdown() == S_OK);
+    ASF_TEST_CHECK(pSink->GetDataSize() == 3000);
+
+    delete pSink;
+
+    ASF_TEST_CHECK(ReadTestFile(s_szWaveFile, file));
+    ASF_TEST_CHECK(file.size() >= ASF_WAVE_FILE_HEADER_SIZE + 3000);
+
+    if (file.size() >= ASF_WAVE_FILE_HEADER_SIZE + 3000)
+    {
+        const BYTE* p = &file[0];
+
+        ASF_TEST_CHECK(memcmp(p, "RIFF", 4) == 0);
+        ASF_TEST_CHECK(ASFReadDWord(p + 4) == ASF_WAVE_FILE_HEADER_SIZE - 8 + 3000);
+        ASF_TEST_CHECK(memcmp(p + 8, "WAVEfmt ", 8) == 0);
+        ASF_TEST_CHECK(ASFReadDWord(p + 16) == 16);
+        ASF_TEST_CHECK(ASFReadWord(p + 20) == 1);
+        ASF_TEST_CHECK(ASFReadWord(p + 22) == 1);
+        ASF_TEST_CHECK(ASFReadDWord(p + 24) == TEST_SAMPLE_RATE);
+        ASF_TEST_CHECK(ASFReadDWord(p + 28) == TEST_BYTES_PER_SEC);
+        ASF_TEST_CHECK(ASFReadWord(p + 32) == TEST_BLOCK_ALIGN);
+        ASF_TEST_CHECK(ASFReadWord(p + 34) == 16);
+        ASF_TEST_CHECK(memcmp(p + 36, "data", 4) == 0);
+        ASF_TEST_CHECK(ASFReadDWord(p + 40) == 3000);
+        ASF_TEST_CHECK(memcmp(p + ASF_WAVE_FILE_HEADER_SIZE, &audio[0], 3000) == 0);
+    }
+
+    DeleteTestFile(s_szWaveFile);
+}
+
+int main()
+{
+    TestPlayback();
+    TestWriterCalls();
+    TestNullSink();
+    TestWaveFileSink();
+
+    return ASF_TEST_RESULT();
+}
@@ -0,0 +1,265 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// DecoderPoolTest.cpp : CASFDecoderPool tests with null decoders.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "ASFDecoderPool.h"
+#include "ASFNullDecoder.h"
+#include "ASFTestData.h"
+
+//Null decoder that counts its instances and can fail its flush
+class CTestDecoder : public CASFNullDecoder
+{
+public:
+
+    CTestDecoder(BOOL fFailFlush = FALSE)
+    :   CASFNullDecoder(ASF_Audio_Media),
+        m_fFailFlush (fFailFlush),
+        m_cFlushes (0)
+    {
+        s_cInstances++;
+    }
+
+    ~CTestDecoder()
+    {
+        s_cInstances--;
+    }
+
+    HRESULT Flush()
+    {
+        m_cFlushes++;
+        return m_fFailFlush ? E_FAIL : S_OK;
+    }
+
+    DWORD GetFlushCount() const
+    {
+        return m_cFlushes;
+    }
+
+    static int  s_cInstances;
+
+private:
+
+    BOOL    m_fFailFlush;
+    DWORD   m_cFlushes;
+};
+
+int CTestDecoder::s_cInstances = 0;
+
+static const BYTE s_rgbFormatA[] = { 0x61, 0x01, 0x02, 0x00, 0x44, 0xAC, 0x00, 0x00 };
+static const BYTE s_rgbFormatB[] = { 0x61, 0x01, 0x02, 0x00, 0x44, 0xAC, 0x00, 0x01 };
+
+static ASF_DECODER_KEY MakeKey(const BYTE* pFormat, DWORD cbFormat)
+{
+    ASF_DECODER_KEY key = { ASF_DECODER_BACKEND_NULL, ASF_Audio_Media, GUID_NULL, pFormat, cbFormat };
+    return key;
+}
+
+static void CheckStats(const CASFDecoderPool& pool, QWORD cHits, QWORD cMisses, QWORD cEvictions, DWORD cIdle)
+{
+    ASF_DECODER_POOL_STATS stats;
+
+    pool.GetStats(&stats);
+
+    ASF_TEST_CHECK(stats.cHits == cHits);
+    ASF_TEST_CHECK(stats.cMisses == cMisses);
+    ASF_TEST_CHECK(stats.cEvictions == cEvictions);
+    ASF_TEST_CHECK(stats.cIdle == cIdle);
+}
+
+//Only a decoder configured for the same key comes back
+static void TestHitAndMiss()
+{
+    CASFDecoderPool pool;
+    IASFDecoder* pDecoder = NULL;
+
+    const ASF_DECODER_KEY keyA = MakeKey(s_rgbFormatA, sizeof(s_rgbFormatA));
+
+    ASF_TEST_CHECK(pool.Checkout(keyA, NULL) == E_POINTER);
+    ASF_TEST_CHECK(pool.Checkin(keyA, NULL) == E_INVALIDARG);
+
+    ASF_TEST_CHECK(pool.Checkout(keyA, &pDecoder) == S_FALSE);
+    ASF_TEST_CHECK(pDecoder == NULL);
+    CheckStats(pool, 0, 1, 0, 0);
+
+    CTestDecoder* pTest = new CTestDecoder();
+
+    ASF_TEST_CHECK(pool.Checkin(keyA, pTest) == S_OK);
+    CheckStats(pool, 0, 1, 0, 1);
+
+    //The key format is copied, so the caller's buffer can change
+    BYTE rgbFormat[sizeof(s_rgbFormatA)];
+
+    memcpy(rgbFormat, s_rgbFormatA, sizeof(rgbFormat));
+
+    //Formats that differ in the last byte or in the length
+    ASF_DECODER_KEY key = MakeKey(s_rgbFormatB, sizeof(s_rgbFormatB));
+
+    ASF_TEST_CHECK(pool.Checkout(key, &pDecoder) == S_FALSE);
+
+    key = MakeKey(rgbFormat, sizeof(rgbFormat) - 1);
+    ASF_TEST_CHECK(pool.Checkout(key, &pDecoder) == S_FALSE);
+
+    key = MakeKey(NULL, 0);
+    ASF_TEST_CHECK(pool.Checkout(key, &pDecoder) == S_FALSE);
+
+    //Other backend and other types
+    key = keyA;
+    key.dwBackend = ASF_DECODER_BACKEND_RAW;
+    ASF_TEST_CHECK(pool.Checkout(key, &pDecoder) == S_FALSE);
+
+    key = keyA;
+    key.guidMajorType = ASF_Video_Media;
+    ASF_TEST_CHECK(pool.Checkout(key, &pDecoder) == S_FALSE);
+
+    key = keyA;
+    key.guidSubtype = ASF_Audio_Media;
+    ASF_TEST_CHECK(pool.Checkout(key, &pDecoder) == S_FALSE);
+
+    CheckStats(pool, 0, 7, 0, 1);
+
+    //The same bytes at another address
+    key = MakeKey(rgbFormat, sizeof(rgbFormat));
+
+    ASF_TEST_CHECK(pool.Checkout(key, &pDecoder) == S_OK);
+    ASF_TEST_CHECK(pDecoder == pTest);
+    ASF_TEST_CHECK(pTest->GetFlushCount() == 1);
+    CheckStats(pool, 1, 7, 0, 0);
+
+    //Checked out decoders are gone from the pool
+    ASF_TEST_CHECK(pool.Checkout(keyA, &pDecoder) == S_FALSE);
+    CheckStats(pool, 1, 8, 0, 0);
+
+    delete pTest;
+
+    pool.ResetStats();
+    CheckStats(pool, 0, 0, 0, 0);
+    ASF_TEST_CHECK(CTestDecoder::s_cInstances == 0);
+}
+
+//The least recently returned decoder goes first
+static void TestEviction()
+{
+    CASFDecoderPool pool;
+    IASFDecoder* pDecoder = NULL;
+
+    BYTE rgbFormats[ASF_DECODER_POOL_MAX_SIZE + 1];
+    IASFDecoder* rgpDecoders[ASF_DECODER_POOL_MAX_SIZE + 1];
+
+    ASF_TEST_CHECK(pool.SetMaxSize(ASF_DECODER_POOL_MAX_SIZE + 1) == E_INVALIDARG);
+    ASF_TEST_CHECK(pool.SetMaxSize(3) == S_OK);
+
+    for (DWORD i = 0; i < 5; i++)
+    {
+        rgbFormats[i] = (BYTE)i;
+        rgpDecoders[i] = new CTestDecoder();
+
+        ASF_TEST_CHECK(pool.Checkin(MakeKey(&rgbFormats[i], 1), rgpDecoders[i]) == S_OK);
+    }
+
+    //Decoders 0 and 1 were destroyed to make room
+    CheckStats(pool, 0, 0, 2, 3);
+    ASF_TEST_CHECK(CTestDecoder::s_cInstances == 3);
+
+    ASF_TEST_CHECK(pool.Checkout(MakeKey(&rgbFormats[0], 1), &pDecoder) == S_FALSE);
+    ASF_TEST_CHECK(pool.Checkout(MakeKey(&rgbFormats[1], 1), &pDecoder) == S_FALSE);
+
+    //Using decoder 2 again makes decoder 3 the oldest
+    ASF_TEST_CHECK(pool.Checkout(MakeKey(&rgbFormats[2], 1), &pDecoder) == S_OK);
+    ASF_TEST_CHECK(pDecoder == rgpDecoders[2]);
+    ASF_TEST_CHECK(pool.Checkin(MakeKey(&rgbFormats[2], 1), pDecoder) == S_OK);
+
+    //Shrinking destroys the oldest right away
+    ASF_TEST_CHECK(pool.SetMaxSize(2) == S_OK);
+    CheckStats(pool, 1, 2, 3, 2);
+
+    ASF_TEST_CHECK(pool.Checkout(MakeKey(&rgbFormats[3], 1), &pDecoder) == S_FALSE);
+    ASF_TEST_CHECK(pool.Checkout(MakeKey(&rgbFormats[4], 1), &pDecoder) == S_OK);
+    ASF_TEST_CHECK(pDecoder == rgpDecoders[4]);
+    delete pDecoder;
+
+    //Of equal keys, the most recently returned comes out first
+    rgpDecoders[0] = new CTestDecoder();
+    rgpDecoders[1] = new CTestDecoder();
+
+    ASF_TEST_CHECK(pool.Checkin(MakeKey(&rgbFormats[0], 1), rgpDecoders[0]) == S_OK);
+    ASF_TEST_CHECK(pool.Checkin(MakeKey(&rgbFormats[0], 1), rgpDecoders[1]) == S_OK);
+
+    ASF_TEST_CHECK(pool.Checkout(MakeKey(&rgbFormats[0], 1), &pDecoder) == S_OK);
+    ASF_TEST_CHECK(pDecoder == rgpDecoders[1]);
+    delete pDecoder;
+
+    pool.Clear();
+    CheckStats(pool, 3, 3, 4, 0);
+    ASF_TEST_CHECK(CTestDecoder::s_cInstances == 0);
+}
+
+//A pool of size 0 destroys every decoder returned to it
+static void TestDisabled()
+{
+    CASFDecoderPool pool;
+    IASFDecoder* pDecoder = NULL;
+
+    const ASF_DECODER_KEY key = MakeKey(s_rgbFormatA, sizeof(s_rgbFormatA));
+
+    ASF_TEST_CHECK(pool.Checkin(key, new CTestDecoder()) == S_OK);
+    ASF_TEST_CHECK(pool.Checkin(key, new CTestDecoder()) == S_OK);
+
+    ASF_TEST_CHECK(pool.SetMaxSize(0) == S_OK);
+    CheckStats(pool, 0, 0, 2, 0);
+    ASF_TEST_CHECK(CTestDecoder::s_cInstances == 0);
+
+    ASF_TEST_CHECK(pool.Checkin(key, new CTestDecoder()) == S_OK);
+    CheckStats(pool, 0, 0, 3, 0);
+    ASF_TEST_CHECK(CTestDecoder::s_cInstances == 0);
+
+    ASF_TEST_CHECK(pool.Checkout(key, &pDecoder) == S_FALSE);
+    CheckStats(pool, 0, 1, 3, 0);
+}
+
+//A decoder that fails to flush is destroyed instead of handed out
+static void TestFailedFlush()
+{
+    CASFDecoderPool pool;
+    IASFDecoder* pDecoder = NULL;
+
+    const ASF_DECODER_KEY key = MakeKey(s_rgbFormatA, sizeof(s_rgbFormatA));
+
+    CTestDecoder* pGood = new CTestDecoder();
+
+    ASF_TEST_CHECK(pool.Checkin(key, pGood) == S_OK);
+    ASF_TEST_CHECK(pool.Checkin(key, new CTestDecoder(TRUE)) == S_OK);
+
+    //The failing decoder is the most recent; the older one is next
+    ASF_TEST_CHECK(pool.Checkout(key, &pDecoder) == S_OK);
+    ASF_TEST_CHECK(pDecoder == pGood);
+    CheckStats(pool, 1, 0, 1, 0);
+    ASF_TEST_CHECK(CTestDecoder::s_cInstances == 1);
+
+    delete pDecoder;
+
+    //With no other match it is a miss
+    ASF_TEST_CHECK(pool.Checkin(key, new CTestDecoder(TRUE)) == S_OK);
+    ASF_TEST_CHECK(pool.Checkout(key, &pDecoder) == S_FALSE);
+    ASF_TEST_CHECK(pDecoder == NULL);
+    CheckStats(pool, 1, 1, 2, 0);
+    ASF_TEST_CHECK(CTestDecoder::s_cInstances == 0);
+}
+
+int main()
+{
+    TestHitAndMiss();
+    TestEviction();
+    TestDisabled();
+    TestFailedFlush();
+
+    return ASF_TEST_RESULT();
+}
@@ -0,0 +1,396 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// DecoderTest.cpp : CASFRawDecoder and CASFNullDecoder tests.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "ASFRawDecoder.h"
+#include "ASFNullDecoder.h"
+#include "ASFReader.h"
+#include "ASFTestData.h"
+
+#define TEST_PACKET_SIZE    512
+#define TEST_PACKET_COUNT   40
+#define TEST_VIDEO_SIZE     300
+#define TEST_AUDIO_SIZE     60
+
+#ifdef _WIN32
+static const ASF_PATH_CHAR s_szMediaFile[] = L"DecoderTest.asf";
+#else
+static const ASF_PATH_CHAR s_szMediaFile[] = "DecoderTest.asf";
+#endif
+
+//Keeps the last output of a decoder
+class CTestSink : public IASFDecoderSink
+{
+public:
+
+    CTestSink()
+    :   m_cBuffers(0),
+        m_cOutputs(0),
+        m_hnsTime(0)
+    {
+    }
+
+    virtual HRESULT GetOutputBuffer(DWORD cbMaxOutput, BYTE** ppBuffer)
+    {
+        m_cBuffers++;
+        m_Buffer.assign(cbMaxOutput, 0xCD);
+        *ppBuffer = &m_Buffer[0];
+        return S_OK;
+    }
+
+    virtual HRESULT OnOutput(const BYTE* pData, DWORD cbData, MFTIME hnsTime)
+    {
+        m_cOutputs++;
+        m_Output.assign(pData, pData + cbData);
+        m_hnsTime = hnsTime;
+        return S_OK;
+    }
+
+    DWORD               m_cBuffers;
+    DWORD               m_cOutputs;
+    std::vector<BYTE>   m_Buffer;
+    std::vector<BYTE>   m_Output;
+    MFTIME              m_hnsTime;
+};
+
+static ASF_DECODER_INPUT MakeInput(const BYTE* pData, DWORD cbData, MFTIME hnsTime)
+{
+    ASF_DECODER_INPUT input;
+
+    memset(&input, 0, sizeof(input));
+    input.pData = pData;
+    input.cbData = cbData;
+    input.hnsTime = hnsTime;
+    input.fKeyFrame = TRUE;
+
+    return input;
+}
+
+//WAVEFORMATEX, without the extra data
+static void WriteWaveFormat(CASFTestWriter& data, WORD wFormatTag, DWORD nSamplesPerSec, WORD nBlockAlign)
+{
+    data.Clear();
+    data.WriteWord(wFormatTag);
+    data.WriteWord(2);
+    data.WriteDWord(nSamplesPerSec);
+    data.WriteDWord(nSamplesPerSec * nBlockAlign);
+    data.WriteWord(nBlockAlign);
+    data.WriteWord(16);
+    data.WriteWord(0);
+}
+
+//Encoded width and height, flags and format data size, then the
+//BITMAPINFOHEADER
+static void WriteVideoFormat(CASFTestWriter& data, LONG lWidth, LONG lHeight, WORD wBitCount, DWORD dwCompression)
+{
+    data.Clear();
+    data.WriteDWord((DWORD)lWidth);
+    data.WriteDWord((DWORD)lHeight);
+    data.WriteByte(2);
+    data.WriteWord(ASF_BITMAPINFOHEADER_SIZE);
+
+    data.WriteDWord(ASF_BITMAPINFOHEADER_SIZE);
+    data.WriteDWord((DWORD)lWidth);
+    data.WriteDWord((DWORD)lHeight);
+    data.WriteWord(1);
+    data.WriteWord(wBitCount);
+    data.WriteDWord(dwCompression);
+    data.WriteFill(0, 20);
+}
+
+static ASF_STREAM_PROPERTIES MakeStream(const GUID& guidStreamType, const CASFTestWriter& format)
+{
+    ASF_STREAM_PROPERTIES stream;
+
+    memset(&stream, 0, sizeof(stream));
+    stream.wStreamNumber = 1;
+    stream.guidStreamType = guidStreamType;
+    stream.pTypeSpecificData = format.GetData();
+    stream.cbTypeSpecificData = (DWORD)format.GetSize();
+
+    return stream;
+}
+
+//Whole audio blocks are passed through; a partial block is dropped
+static void TestPcm()
+{
+    CASFTestWriter format;
+    CASFRawDecoder* pDecoder = NULL;
+    ASF_MEDIA_FORMAT output;
+
+    WriteWaveFormat(format, ASF_WAVE_FORMAT_PCM, 44100, 4);
+    ASF_STREAM_PROPERTIES stream = MakeStream(ASF_Audio_Media, format);
+
+    ASF_TEST_CHECK(CASFRawDecoder::IsSupported(stream));
+    ASF_TEST_CHECK(CASFRawDecoder::CreateInstance(stream, &pDecoder) == S_OK);
+
+    if (!pDecoder)
+    {
+        return;
+    }
+
+    ASF_TEST_CHECK(pDecoder->GetOutputFormat(&output) == S_OK);
+    ASF_TEST_CHECK(output.guidMajorType == ASF_Audio_Media);
+    ASF_TEST_CHECK(output.nChannels == 2);
+    ASF_TEST_CHECK(output.nSamplesPerSec == 44100);
+    ASF_TEST_CHECK(output.nBlockAlign == 4);
+    ASF_TEST_CHECK(output.wBitsPerSample == 16);
+    ASF_TEST_CHECK(output.cbMaxOutput == 44100 * 4);
+
+    BYTE rgbSamples[10];
+    CTestSink sink;
+
+    for (DWORD i = 0; i < sizeof(rgbSamples); i++)
+    {
+        rgbSamples[i] = (BYTE)(i + 1);
+    }
+
+    ASF_TEST_CHECK(pDecoder->Decode(MakeInput(rgbSamples, sizeof(rgbSamples), 1234), &sink) == S_OK);
+    ASF_TEST_CHECK(sink.m_cOutputs == 1);
+    ASF_TEST_CHECK(sink.m_Output.size() == 8);
+    ASF_TEST_CHECK(memcmp(&sink.m_Output[0], rgbSamples, 8) == 0);
+    ASF_TEST_CHECK(sink.m_hnsTime == 1234);
+
+    //Less than a block: no output at all
+    ASF_TEST_CHECK(pDecoder->Decode(MakeInput(rgbSamples, 3, 0), &sink) == S_OK);
+    ASF_TEST_CHECK(sink.m_cBuffers == 1);
+    ASF_TEST_CHECK(sink.m_cOutputs == 1);
+
+    ASF_TEST_CHECK(pDecoder->Decode(MakeInput(rgbSamples, 4, 0), NULL) == E_INVALIDARG);
+    ASF_TEST_CHECK(pDecoder->Decode(MakeInput(NULL, 4, 0), &sink) == E_INVALIDARG);
+
+    delete pDecoder;
+    pDecoder = NULL;
+
+    //Compressed audio and formats that do not fit
+    WriteWaveFormat(format, 0x161, 44100, 4);
+    stream = MakeStream(ASF_Audio_Media, format);
+    ASF_TEST_CHECK(CASFRawDecoder::CreateInstance(stream, &pDecoder) == MF_E_INVALIDMEDIATYPE);
+
+    WriteWaveFormat(format, ASF_WAVE_FORMAT_PCM, 0x40000000, 8);
+    stream = MakeStream(ASF_Audio_Media, format);
+    ASF_TEST_CHECK(CASFRawDecoder::CreateInstance(stream, &pDecoder) == MF_E_ASF_INVALIDDATA);
+
+    WriteWaveFormat(format, ASF_WAVE_FORMAT_PCM, 44100, 0);
+    stream = MakeStream(ASF_Audio_Media, format);
+    ASF_TEST_CHECK(CASFRawDecoder::CreateInstance(stream, &pDecoder) == MF_E_ASF_INVALIDDATA);
+
+    stream.cbTypeSpecificData = ASF_WAVEFORMATEX_SIZE - 1;
+    ASF_TEST_CHECK(!CASFRawDecoder::IsSupported(stream));
+    ASF_TEST_CHECK(pDecoder == NULL);
+}
+
+//A bottom-up RGB24 frame with padded rows comes out top-down in RGB32
+static void TestRgb24BottomUp()
+{
+    const DWORD cWidth = 3;
+    const DWORD cHeight = 2;
+    const DWORD cbInputStride = 12;     // 9 bytes padded to a DWORD
+
+    CASFTestWriter format;
+    CASFRawDecoder* pDecoder = NULL;
+    ASF_MEDIA_FORMAT output;
+
+    WriteVideoFormat(format, cWidth, cHeight, 24, ASF_BI_RGB);
+    ASF_STREAM_PROPERTIES stream = MakeStream(ASF_Video_Media, format);
+
+    ASF_TEST_CHECK(CASFRawDecoder::CreateInstance(stream, &pDecoder) == S_OK);
+
+    if (!pDecoder)
+    {
+        return;
+    }
+
+    ASF_TEST_CHECK(pDecoder->GetOutputFormat(&output) == S_OK);
+    ASF_TEST_CHECK(output.guidMajorType == ASF_Video_Media);
+    ASF_TEST_CHECK(output.dwWidth == cWidth);
+    ASF_TEST_CHECK(output.dwHeight == cHeight);
+    ASF_TEST_CHECK(output.lStride == cWidth * 4);
+    ASF_TEST_CHECK(output.cbMaxOutput == cWidth * 4 * cHeight);
+
+    BYTE rgbFrame[cbInputStride * cHeight];
+    CTestSink sink;
+
+    for (DWORD i = 0; i < sizeof(rgbFrame); i++)
+    {
+        rgbFrame[i] = (BYTE)(0x10 + i);
+    }
+
+    ASF_TEST_CHECK(pDecoder->Decode(MakeInput(rgbFrame, sizeof(rgbFrame), 400000), &sink) == S_OK);
+    ASF_TEST_CHECK(sink.m_cOutputs == 1);
+    ASF_TEST_CHECK(sink.m_Output.size() == cWidth * 4 * cHeight);
+    ASF_TEST_CHECK(sink.m_hnsTime == 400000);
+
+    for (DWORD y = 0; (y < cHeight) && (sink.m_Output.size() == cWidth * 4 * cHeight); y++)
+    {
+        //The last stored row is the top one
+        const BYTE* pSource = rgbFrame + (cHeight - 1 - y) * cbInputStride;
+
+        for (DWORD x = 0; x < cWidth; x++)
+        {
+            const BYTE* pPixel = &sink.m_Output[(y * cWidth + x) * 4];
+
+            ASF_TEST_CHECK(pPixel[0] == pSource[x * 3]);
+            ASF_TEST_CHECK(pPixel[1] == pSource[x * 3 + 1]);
+            ASF_TEST_CHECK(pPixel[2] == pSource[x * 3 + 2]);
+            ASF_TEST_CHECK(pPixel[3] == 0xFF);
+        }
+    }
+
+    //A frame short of its last row padding
+    ASF_TEST_CHECK(pDecoder->Decode(MakeInput(rgbFrame, sizeof(rgbFrame) - 1, 0), &sink) == MF_E_ASF_INVALIDDATA);
+    ASF_TEST_CHECK(sink.m_cOutputs == 1);
+
+    delete pDecoder;
+    pDecoder = NULL;
+
+    //A top-down RGB32 frame is copied as it is
+    BYTE rgbFrame32[2 * 4 * 2];
+    CTestSink sink32;
+
+    for (DWORD i = 0; i < sizeof(rgbFrame32); i++)
+    {
+        rgbFrame32[i] = (BYTE)(0x80 + i);
+    }
+
+    WriteVideoFormat(format, 2, -2, 32, ASF_BI_RGB);
+    stream = MakeStream(ASF_Video_Media, format);
+
+    ASF_TEST_CHECK(CASFRawDecoder::CreateInstance(stream, &pDecoder) == S_OK);
+
+    if (pDecoder)
+    {
+        ASF_TEST_CHECK(pDecoder->Decode(MakeInput(rgbFrame32, sizeof(rgbFrame32), 0), &sink32) == S_OK);
+        ASF_TEST_CHECK(sink32.m_Output.size() == sizeof(rgbFrame32));
+        ASF_TEST_CHECK((sink32.m_Output.size() == sizeof(rgbFrame32)) && (memcmp(&sink32.m_Output[0], rgbFrame32, sizeof(rgbFrame32)) == 0));
+
+        delete pDecoder;
+        pDecoder = NULL;
+    }
+}
+
+//Frame sizes up to what a DWORD holds; other formats are not raw
+static void TestVideoFormats()
+{
+    CASFTestWriter format;
+    CASFRawDecoder* pDecoder = NULL;
+    ASF_MEDIA_FORMAT output;
+
+    WriteVideoFormat(format, 0x8000, 0x7FFF, 32, ASF_BI_RGB);
+    ASF_STREAM_PROPERTIES stream = MakeStream(ASF_Video_Media, format);
+
+    ASF_TEST_CHECK(CASFRawDecoder::CreateInstance(stream, &pDecoder) == S_OK);
+
+    if (pDecoder)
+    {
+        ASF_TEST_CHECK(pDecoder->GetOutputFormat(&output) == S_OK);
+        ASF_TEST_CHECK(output.cbMaxOutput == (DWORD)0x8000 * 4 * 0x7FFF);
+
+        delete pDecoder;
+        pDecoder = NULL;
+    }
+
+    //4 GB: the output size would wrap to 0
+    WriteVideoFormat(format, 0x8000, 0x8000, 24, ASF_BI_RGB);
+    stream = MakeStream(ASF_Video_Media, format);
+    ASF_TEST_CHECK(CASFRawDecoder::CreateInstance(stream, &pDecoder) == MF_E_ASF_INVALIDDATA);
+
+    WriteVideoFormat(format, 0x8000, -0x8000, 24, ASF_BI_RGB);
+    stream = MakeStream(ASF_Video_Media, format);
+    ASF_TEST_CHECK(CASFRawDecoder::CreateInstance(stream, &pDecoder) == MF_E_ASF_INVALIDDATA);
+
+    WriteVideoFormat(format, 0x8001, 1, 24, ASF_BI_RGB);
+    stream = MakeStream(ASF_Video_Media, format);
+    ASF_TEST_CHECK(CASFRawDecoder::CreateInstance(stream, &pDecoder) == MF_E_ASF_INVALIDDATA);
+
+    WriteVideoFormat(format, 16, 0, 24, ASF_BI_RGB);
+    stream = MakeStream(ASF_Video_Media, format);
+    ASF_TEST_CHECK(CASFRawDecoder::CreateInstance(stream, &pDecoder) == MF_E_ASF_INVALIDDATA);
+
+    //Compressed video and other bit depths
+    WriteVideoFormat(format, 16, 16, 24, 0x33564D57);
+    stream = MakeStream(ASF_Video_Media, format);
+    ASF_TEST_CHECK(CASFRawDecoder::CreateInstance(stream, &pDecoder) == MF_E_INVALIDMEDIATYPE);
+
+    WriteVideoFormat(format, 16, 16, 16, ASF_BI_RGB);
+    stream = MakeStream(ASF_Video_Media, format);
+    ASF_TEST_CHECK(!CASFRawDecoder::IsSupported(stream));
+
+    stream = MakeStream(ASF_Command_Media, format);
+    ASF_TEST_CHECK(CASFRawDecoder::CreateInstance(stream, &pDecoder) == MF_E_INVALIDMEDIATYPE);
+
+    ASF_TEST_CHECK(pDecoder == NULL);
+}
+
+//The reader demuxes into a null decoder, which counts the samples and
+//never asks the sink for memory
+static void TestDemuxOnly()
+{
+    CASFTestWriter file;
+    CASFReader reader;
+    CASFNullDecoder decoder(ASF_Video_Media);
+    CTestSink sink;
+    ASF_NULL_DECODER_STATS stats;
+    ASF_MEDIA_FORMAT output;
+
+    ASF_TEST_CHECK(decoder.GetOutputFormat(&output) == S_OK);
+    ASF_TEST_CHECK(output.guidMajorType == ASF_Video_Media);
+    ASF_TEST_CHECK(output.cbMaxOutput == 0);
+
+    WriteTestMediaFile(file, TEST_PACKET_SIZE, TEST_PACKET_COUNT, TEST_VIDEO_SIZE, TEST_AUDIO_SIZE);
+
+    if (!WriteTestFile(s_szMediaFile, file))
+    {
+        DeleteTestFile(s_szMediaFile);
+        printf("skipped: cannot write the test file\n");
+        return;
+    }
+
+    ASF_TEST_CHECK(reader.Open(s_szMediaFile) == S_OK);
+
+    reader.SetDecoder(&decoder, &sink);
+
+    ASF_TEST_CHECK(reader.GenerateSamples(ASF_TEST_VIDEO_STREAM, 0, 0, 0, NULL) == S_OK);
+
+    decoder.GetStats(&stats);
+    ASF_TEST_CHECK(stats.cSamples == TEST_PACKET_COUNT / 2);
+    ASF_TEST_CHECK(stats.cKeyFrames == TEST_PACKET_COUNT / 2 / ASF_TEST_KEY_FRAME_INTERVAL);
+    ASF_TEST_CHECK(stats.cbInput == (QWORD)TEST_PACKET_COUNT / 2 * TEST_VIDEO_SIZE);
+    ASF_TEST_CHECK(sink.m_cBuffers == 0);
+    ASF_TEST_CHECK(sink.m_cOutputs == 0);
+
+    decoder.ResetStats();
+
+    ASF_TEST_CHECK(reader.GenerateSamples(ASF_TEST_AUDIO_STREAM, 0, 0, 0, NULL) == S_OK);
+
+    decoder.GetStats(&stats);
+    ASF_TEST_CHECK(stats.cSamples == TEST_PACKET_COUNT);
+    ASF_TEST_CHECK(stats.cbInput == (QWORD)TEST_PACKET_COUNT * TEST_AUDIO_SIZE);
+
+    reader.SetDecoder(NULL, NULL);
+    reader.Close();
+
+    DeleteTestFile(s_szMediaFile);
+}
+
+int main()
+{
+    TestPcm();
+    TestRgb24BottomUp();
+    TestVideoFormats();
+    TestDemuxOnly();
+
+    return ASF_TEST_RESULT();
+}
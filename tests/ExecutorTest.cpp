@@ -0,0 +1,457 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ExecutorTest.cpp : CASFExecutor and CASFGenerateRequest tests.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include "ASFGenerateRequest.h"
+#include "ASFTestData.h"
+
+#define TEST_PACKET_SIZE    512
+#define TEST_PACKET_COUNT   40      // Several reads of the reader
+#define TEST_VIDEO_SIZE     300
+#define TEST_AUDIO_SIZE     60
+
+#define TEST_ITEMS          200     // More than the initial queue size
+#define TEST_WAIT_MS        50
+
+#ifdef _WIN32
+static const ASF_PATH_CHAR s_szMediaFile[] = L"ExecutorTest.asf";
+#else
+static const ASF_PATH_CHAR s_szMediaFile[] = "ExecutorTest.asf";
+#endif
+
+//Counts the items run and records their order
+class CTestItem : public IASFWorkItem
+{
+public:
+
+    CTestItem()
+    :   m_pOrder(NULL),
+        m_pcRun(NULL),
+        m_iItem(0)
+    {
+    }
+
+    virtual void Run()
+    {
+        LONG cRun = ASFInterlockedIncrement(m_pcRun);
+
+        if (m_pOrder)
+        {
+            m_pOrder[cRun - 1] = m_iItem;
+        }
+    }
+
+    DWORD*          m_pOrder;       // May be NULL
+    volatile LONG*  m_pcRun;
+    DWORD           m_iItem;
+};
+
+//Blocks an executor thread until the gate is opened
+class CGateItem : public IASFWorkItem
+{
+public:
+
+    CGateItem()
+    :   m_Entered(TRUE),
+        m_Gate(TRUE)
+    {
+    }
+
+    virtual void Run()
+    {
+        m_Entered.Set();
+        (void)m_Gate.Wait(ASF_WAIT_INFINITE);
+    }
+
+    CASFEvent   m_Entered;
+    CASFEvent   m_Gate;
+};
+
+//Submits itself again from Run until the executor refuses it
+class CRequeueItem : public IASFWorkItem
+{
+public:
+
+    CRequeueItem(CASFExecutor* pExecutor)
+    :   m_pExecutor(pExecutor),
+        m_cRun(0),
+        m_hrLast(S_OK),
+        m_Done(TRUE)
+    {
+    }
+
+    virtual void Run()
+    {
+        m_cRun++;
+        m_hrLast = m_pExecutor->Submit(this);
+
+        if (FAILED(m_hrLast))
+        {
+            m_Done.Set();
+        }
+    }
+
+    CASFExecutor*   m_pExecutor;
+    DWORD           m_cRun;
+    HRESULT         m_hrLast;
+    CASFEvent       m_Done;
+};
+
+//Counts the samples of a request and can cancel it on the first one
+class CTestCallback : public IASFReaderCallback
+{
+public:
+
+    CTestCallback()
+    :   m_pCancel(NULL),
+        m_cSamples(0)
+    {
+    }
+
+    virtual HRESULT OnSample(const ASF_READER_SAMPLE& sample)
+    {
+        (void)sample;
+
+        if (m_pCancel)
+        {
+            m_pCancel->Cancel();
+        }
+
+        m_cSamples++;
+        return S_OK;
+    }
+
+    CASFGenerateRequest*    m_pCancel;
+    DWORD                   m_cSamples;
+};
+
+//Counts the completion calls of a request
+class CTestCompletion : public IASFGenerateCallback
+{
+public:
+
+    CTestCompletion()
+    :   m_cCalls(0),
+        m_hrStatus(S_OK),
+        m_fCompleteInCallback(FALSE)
+    {
+    }
+
+    virtual void OnGenerateComplete(CASFGenerateRequest* pRequest, HRESULT hrStatus)
+    {
+        m_cCalls++;
+        m_hrStatus = hrStatus;
+        m_fCompleteInCallback = pRequest->IsComplete();
+    }
+
+    volatile LONG   m_cCalls;
+    HRESULT         m_hrStatus;
+    BOOL            m_fCompleteInCallback;
+};
+
+//Shuts an executor down on a thread of its own
+static void ShutdownProc(void* pContext)
+{
+    ((CASFExecutor*)pContext)->Shutdown();
+}
+
+//Items run in submission order on one thread; the queue grows
+static void TestExecutor()
+{
+    CASFExecutor executor;
+    ASF_EXECUTOR_STATS stats;
+
+    CTestItem rgItems[TEST_ITEMS];
+    DWORD rgdwOrder[TEST_ITEMS] = { 0 };
+    volatile LONG cRun = 0;
+
+    CGateItem gate;
+
+    ASF_TEST_CHECK(executor.Submit(&rgItems[0]) == MF_E_SHUTDOWN);
+    ASF_TEST_CHECK(executor.Start(1) == S_OK);
+    ASF_TEST_CHECK(executor.Start(1) == MF_E_INVALIDREQUEST);
+    ASF_TEST_CHECK(executor.Submit(NULL) == E_POINTER);
+
+    //Queue everything behind the gate
+    ASF_TEST_CHECK(executor.Submit(&gate) == S_OK);
+    ASF_TEST_CHECK(gate.m_Entered.Wait(ASF_WAIT_INFINITE));
+
+    for (DWORD i = 0; i < TEST_ITEMS; i++)
+    {
+        rgItems[i].m_pOrder = rgdwOrder;
+        rgItems[i].m_pcRun = &cRun;
+        rgItems[i].m_iItem = i;
+
+        ASF_TEST_CHECK(executor.Submit(&rgItems[i]) == S_OK);
+    }
+
+    executor.GetStats(&stats);
+    ASF_TEST_CHECK(stats.cThreads == 1);
+    ASF_TEST_CHECK(stats.cQueued == TEST_ITEMS);
+    ASF_TEST_CHECK(stats.cMaxQueued == TEST_ITEMS);
+
+    gate.m_Gate.Set();
+
+    //Shutdown runs the queued items first
+    executor.Shutdown();
+
+    ASF_TEST_CHECK(cRun == TEST_ITEMS);
+
+    for (DWORD i = 0; i < TEST_ITEMS; i++)
+    {
+        ASF_TEST_CHECK(rgdwOrder[i] == i);
+    }
+
+    executor.GetStats(&stats);
+    ASF_TEST_CHECK(stats.cThreads == 0);
+    ASF_TEST_CHECK(stats.cQueued == 0);
+    ASF_TEST_CHECK(stats.cSubmitted == TEST_ITEMS + 1);
+    ASF_TEST_CHECK(stats.cRun == TEST_ITEMS + 1);
+
+    ASF_TEST_CHECK(executor.Submit(&rgItems[0]) == MF_E_SHUTDOWN);
+
+    //A restarted executor runs items again, on several threads
+    cRun = 0;
+
+    ASF_TEST_CHECK(executor.Start(4) == S_OK);
+
+    for (DWORD i = 0; i < TEST_ITEMS; i++)
+    {
+        ASF_TEST_CHECK(executor.Submit(&rgItems[i]) == S_OK);
+    }
+
+    executor.Shutdown();
+
+    ASF_TEST_CHECK(cRun == TEST_ITEMS);
+}
+
+//An item that submits itself again is refused from the start of
+//Shutdown, so Shutdown returns
+static void TestRequeueDuringShutdown()
+{
+    CASFExecutor executor;
+    CRequeueItem item(&executor);
+
+    ASF_TEST_CHECK(executor.Start(2) == S_OK);
+    ASF_TEST_CHECK(executor.Submit(&item) == S_OK);
+
+    executor.Shutdown();
+
+    ASF_TEST_CHECK(item.m_Done.Wait(0));
+    ASF_TEST_CHECK(item.m_hrLast == MF_E_SHUTDOWN);
+    ASF_TEST_CHECK(item.m_cRun > 0);
+}
+
+//A request that runs to the end: one completion call, then the waiters.
+//The executor may still hold its reference when Wait returns.
+static void TestGenerateResult(CASFReader& reader, CASFExecutor& executor)
+{
+    CTestCallback callback;
+    CTestCompletion completion;
+    CASFGenerateRequest* pRequest = NULL;
+    ASF_GENERATE_PROGRESS progress;
+
+    ASF_TEST_CHECK(CASFGenerateRequest::CreateInstance(&reader, &executor, &completion, &pRequest) == S_OK);
+
+    if (!pRequest)
+    {
+        return;
+    }
+
+    ASF_TEST_CHECK(pRequest->Wait(0) == MF_E_INVALIDREQUEST);
+
+    ASF_TEST_CHECK(pRequest->Start(ASF_TEST_AUDIO_STREAM, 0, 0, 0, &callback) == S_OK);
+    ASF_TEST_CHECK(pRequest->Start(ASF_TEST_AUDIO_STREAM, 0, 0, 0, &callback) == MF_E_INVALIDREQUEST);
+
+    ASF_TEST_CHECK(pRequest->Wait(ASF_WAIT_INFINITE) == S_OK);
+    ASF_TEST_CHECK(pRequest->IsComplete());
+
+    ASF_TEST_CHECK(callback.m_cSamples == TEST_PACKET_COUNT);
+    ASF_TEST_CHECK(completion.m_cCalls == 1);
+    ASF_TEST_CHECK(completion.m_hrStatus == S_OK);
+    ASF_TEST_CHECK(completion.m_fCompleteInCallback);
+
+    pRequest->GetProgress(&progress);
+    ASF_TEST_CHECK(progress.cSamples == TEST_PACKET_COUNT);
+    ASF_TEST_CHECK(progress.cbRead == progress.cbTotal);
+
+    //The result stays available
+    ASF_TEST_CHECK(pRequest->Wait(0) == S_OK);
+
+    pRequest->Release();
+}
+
+//A request behind a busy thread times out, and when canceled before
+//it runs, completes with E_ABORT and no samples
+static void TestGenerateTimeout(CASFReader& reader)
+{
+    CASFExecutor executor;
+    CTestCallback callback;
+    CTestCompletion completion;
+    CASFGenerateRequest* pRequest = NULL;
+    CGateItem gate;
+
+    ASF_TEST_CHECK(executor.Start(1) == S_OK);
+    ASF_TEST_CHECK(CASFGenerateRequest::CreateInstance(&reader, &executor, &completion, &pRequest) == S_OK);
+
+    if (!pRequest)
+    {
+        return;
+    }
+
+    ASF_TEST_CHECK(executor.Submit(&gate) == S_OK);
+    ASF_TEST_CHECK(gate.m_Entered.Wait(ASF_WAIT_INFINITE));
+
+    ASF_TEST_CHECK(pRequest->Start(ASF_TEST_VIDEO_STREAM, 0, 0, 0, &callback) == S_OK);
+
+    ASF_TEST_CHECK(pRequest->Wait(TEST_WAIT_MS) == E_PENDING);
+    ASF_TEST_CHECK(!pRequest->IsComplete());
+    ASF_TEST_CHECK(completion.m_cCalls == 0);
+
+    pRequest->Cancel();
+    gate.m_Gate.Set();
+
+    ASF_TEST_CHECK(pRequest->Wait(ASF_WAIT_INFINITE) == E_ABORT);
+    ASF_TEST_CHECK(callback.m_cSamples == 0);
+    ASF_TEST_CHECK(completion.m_cCalls == 1);
+    ASF_TEST_CHECK(completion.m_hrStatus == E_ABORT);
+
+    pRequest->Release();
+}
+
+//A request canceled from its first sample stops after the read in
+//progress
+static void TestGenerateCancel(CASFReader& reader, CASFExecutor& executor)
+{
+    CTestCallback callback;
+    CTestCompletion completion;
+    CASFGenerateRequest* pRequest = NULL;
+
+    ASF_TEST_CHECK(CASFGenerateRequest::CreateInstance(&reader, &executor, &completion, &pRequest) == S_OK);
+
+    if (!pRequest)
+    {
+        return;
+    }
+
+    callback.m_pCancel = pRequest;
+
+    ASF_TEST_CHECK(pRequest->Start(ASF_TEST_AUDIO_STREAM, 0, 0, 0, &callback) == S_OK);
+    ASF_TEST_CHECK(pRequest->Wait(ASF_WAIT_INFINITE) == E_ABORT);
+
+    ASF_TEST_CHECK(callback.m_cSamples > 0);
+    ASF_TEST_CHECK(callback.m_cSamples < TEST_PACKET_COUNT);
+    ASF_TEST_CHECK(completion.m_cCalls == 1);
+    ASF_TEST_CHECK(completion.m_hrStatus == E_ABORT);
+
+    pRequest->Release();
+}
+
+//A request that queues itself again after Shutdown started gets
+//MF_E_SHUTDOWN from Submit and completes with it
+static void TestGenerateShutdown(CASFReader& reader)
+{
+    CASFExecutor executor;
+    CASFThread thread;
+    CTestCallback callback;
+    CTestCompletion completion;
+    CASFGenerateRequest* pRequest = NULL;
+    CGateItem gate;
+    CTestItem probe;
+    volatile LONG cRun = 0;
+
+    probe.m_pcRun = &cRun;
+
+    ASF_TEST_CHECK(executor.Start(1) == S_OK);
+    ASF_TEST_CHECK(CASFGenerateRequest::CreateInstance(&reader, &executor, &completion, &pRequest) == S_OK);
+
+    if (!pRequest)
+    {
+        return;
+    }
+
+    ASF_TEST_CHECK(executor.Submit(&gate) == S_OK);
+    ASF_TEST_CHECK(gate.m_Entered.Wait(ASF_WAIT_INFINITE));
+
+    ASF_TEST_CHECK(pRequest->Start(ASF_TEST_AUDIO_STREAM, 0, 0, 0, &callback) == S_OK);
+
+    //Shut down while the request is queued, and wait until Submit fails
+    ASF_TEST_CHECK(thread.Start(ShutdownProc, &executor) == S_OK);
+
+    while (executor.Submit(&probe) == S_OK)
+    {
+        CASFThread::YieldThread();
+    }
+
+    gate.m_Gate.Set();
+    thread.Join();
+
+    //The request ran its seek only
+    ASF_TEST_CHECK(pRequest->Wait(0) == MF_E_SHUTDOWN);
+    ASF_TEST_CHECK(callback.m_cSamples == 0);
+    ASF_TEST_CHECK(completion.m_cCalls == 1);
+    ASF_TEST_CHECK(completion.m_hrStatus == MF_E_SHUTDOWN);
+
+    pRequest->Release();
+
+    //Start on a stopped executor fails without a completion call
+    ASF_TEST_CHECK(CASFGenerateRequest::CreateInstance(&reader, &executor, &completion, &pRequest) == S_OK);
+
+    if (pRequest)
+    {
+        ASF_TEST_CHECK(pRequest->Start(ASF_TEST_AUDIO_STREAM, 0, 0, 0, &callback) == MF_E_SHUTDOWN);
+        ASF_TEST_CHECK(pRequest->Wait(0) == MF_E_INVALIDREQUEST);
+        ASF_TEST_CHECK(completion.m_cCalls == 1);
+        pRequest->Release();
+    }
+}
+
+int main()
+{
+    CASFTestWriter file;
+
+    TestExecutor();
+    TestRequeueDuringShutdown();
+
+    WriteTestMediaFile(file, TEST_PACKET_SIZE, TEST_PACKET_COUNT, TEST_VIDEO_SIZE, TEST_AUDIO_SIZE);
+
+    if (!WriteTestFile(s_szMediaFile, file))
+    {
+        DeleteTestFile(s_szMediaFile);
+        printf("skipped: cannot write the test file\n");
+        return ASF_TEST_RESULT();
+    }
+
+    {
+        CASFReader reader;
+        CASFExecutor executor;
+
+        ASF_TEST_CHECK(reader.Open(s_szMediaFile) == S_OK);
+        ASF_TEST_CHECK(executor.Start(2) == S_OK);
+
+        TestGenerateResult(reader, executor);
+        TestGenerateCancel(reader, executor);
+
+        executor.Shutdown();
+
+        TestGenerateTimeout(reader);
+
+        TestGenerateShutdown(reader);
+
+        reader.Close();
+    }
+
+    DeleteTestFile(s_szMediaFile);
+
+    return ASF_TEST_RESULT();
+}
@@ -0,0 +1,275 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// HeaderParserTest.cpp : CASFHeaderParser tests on hand-built headers.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "ASFHeaderParser.h"
+#include "ASFTestData.h"
+
+#define TEST_PACKET_SIZE    3200
+#define TEST_PACKETS        40
+
+static const GUID TEST_Unknown_Object =
+    { 0x7BF875CE, 0x468D, 0x11D1, { 0x8D, 0x82, 0x00, 0x60, 0x97, 0xC9, 0xA2, 0xB2 } };
+
+static const GUID TEST_Reserved_1 =
+    { 0xABD3D211, 0xA9BA, 0x11CF, { 0x8E, 0xE6, 0x00, 0xC0, 0x0C, 0x20, 0x53, 0x65 } };
+
+//Extended Stream Properties Object with one stream name, one payload
+//extension system and, if pEmbedded is set, an embedded Stream
+//Properties Object
+static void WriteExtendedStreamProperties(
+    CASFTestWriter& extension,
+    WORD wStreamNumber,
+    const CASFTestWriter* pEmbedded
+    )
+{
+    CASFTestWriter body;
+
+    body.WriteQWord(0);             // Start Time
+    body.WriteQWord(0);             // End Time
+    body.WriteDWord(96000);         // Data Bitrate
+    body.WriteDWord(5000);          // Buffer Size
+    body.WriteDWord(0);
+    body.WriteDWord(0);
+    body.WriteDWord(0);
+    body.WriteDWord(0);
+    body.WriteDWord(77777);         // Maximum Object Size
+    body.WriteDWord(0);             // Flags
+    body.WriteWord(wStreamNumber);
+    body.WriteWord(0);              // Stream Language ID Index
+    body.WriteQWord(333333);        // Average Time Per Frame
+    body.WriteWord(1);              // Stream Name Count
+    body.WriteWord(1);              // Payload Extension System Count
+
+    body.WriteWord(0);
+    body.WriteWord(3);
+    body.WriteFill('n', 3);
+
+    body.WriteGUID(GUID_NULL);
+    body.WriteWord(2);
+    body.WriteDWord(1);
+    body.WriteByte(9);
+
+    if (pEmbedded)
+    {
+        body.Write(*pEmbedded);
+    }
+
+    extension.WriteObject(ASF_Extended_Stream_Properties_Object, body);
+}
+
+static void WriteHeaderExtension(CASFTestWriter& header, const CASFTestWriter& children)
+{
+    CASFTestWriter body;
+
+    body.WriteGUID(TEST_Reserved_1);
+    body.WriteWord(6);
+    body.WriteDWord((DWORD)children.GetSize());
+    body.Write(children);
+
+    header.WriteObject(ASF_Header_Extension_Object, body);
+}
+
+//Header with two streams, a header extension that describes stream 1
+//and adds stream 3, and an unknown object, followed by the Data Object
+//header
+static void WriteValidFile(CASFTestWriter& file)
+{
+    CASFTestWriter children, extension, embedded, unknown;
+
+    WriteTestFileProperties(children, TEST_PACKET_SIZE, TEST_PACKETS, 50000000, 3000);
+    WriteTestStreamProperties(children, 1, ASF_Video_Media, 40);
+    WriteTestStreamProperties(children, 2, ASF_Audio_Media, 18);
+
+    unknown.WriteFill(0xEE, 100);
+    children.WriteObject(TEST_Unknown_Object, unknown);
+
+    WriteExtendedStreamProperties(extension, 1, NULL);
+    WriteTestStreamProperties(embedded, 3, ASF_Command_Media, 0);
+    WriteExtendedStreamProperties(extension, 3, &embedded);
+    WriteHeaderExtension(children, extension);
+
+    WriteTestHeaderObject(file, children, 5);
+    WriteTestDataObjectHeader(file, TEST_PACKET_SIZE, TEST_PACKETS);
+}
+
+static void TestValidHeader()
+{
+    CASFTestWriter file;
+    WriteValidFile(file);
+
+    CASFHeaderParser parser;
+    ASF_TEST_CHECK(parser.Parse(file.GetData(), file.GetSize()) == S_OK);
+
+    FILE_PROPERTIES_OBJECT fileInfo;
+    ASF_TEST_CHECK(parser.GetFileProperties(&fileInfo) == S_OK);
+    ASF_TEST_CHECK(fileInfo.guidFileID == ASF_TEST_FILE_ID);
+    ASF_TEST_CHECK(fileInfo.cPackets == TEST_PACKETS);
+    ASF_TEST_CHECK(fileInfo.cbMinPacketSize == TEST_PACKET_SIZE);
+    ASF_TEST_CHECK(fileInfo.cbMaxPacketSize == TEST_PACKET_SIZE);
+    ASF_TEST_CHECK(fileInfo.hnspreroll == 30000000);
+    ASF_TEST_CHECK(fileInfo.hnsPresentationDuration == 20000000);
+    ASF_TEST_CHECK(fileInfo.flags == ASF_FILE_FLAG_SEEKABLE);
+    ASF_TEST_CHECK(fileInfo.MaxBitRate == 128000);
+
+    GUID guidFileID = GUID_NULL;
+    ASF_TEST_CHECK(CASFHeaderParser::GetFileID(file.GetData(), file.GetSize(), &guidFileID) == S_OK);
+    ASF_TEST_CHECK(guidFileID == ASF_TEST_FILE_ID);
+
+    ASF_TEST_CHECK(parser.GetHeaderSize() + ASF_DATA_OBJECT_HEADER_SIZE == file.GetSize());
+    ASF_TEST_CHECK(parser.GetDataOffset() == file.GetSize());
+    ASF_TEST_CHECK(parser.GetDataLength() == (QWORD)TEST_PACKETS * TEST_PACKET_SIZE);
+    ASF_TEST_CHECK(parser.GetTotalDataPackets() == TEST_PACKETS);
+
+    //The unknown object adds no stream; the extension adds stream 3
+    ASF_TEST_CHECK(parser.GetStreamCount() == 3);
+
+    const ASF_STREAM_PROPERTIES* pStream = NULL;
+
+    ASF_TEST_CHECK(parser.GetStreamByNumber(1, &pStream) == S_OK);
+    ASF_TEST_CHECK(pStream->guidStreamType == ASF_Video_Media);
+    ASF_TEST_CHECK(pStream->cbTypeSpecificData == 40);
+    ASF_TEST_CHECK(pStream->pTypeSpecificData[0] == 0xA5);
+    ASF_TEST_CHECK(pStream->dwDataBitrate == 96000);
+    ASF_TEST_CHECK(pStream->cbMaxObjectSize == 77777);
+    ASF_TEST_CHECK(pStream->hnsAvgTimePerFrame == 333333);
+
+    ASF_TEST_CHECK(parser.GetStreamByNumber(2, &pStream) == S_OK);
+    ASF_TEST_CHECK(pStream->guidStreamType == ASF_Audio_Media);
+    ASF_TEST_CHECK(pStream->cbTypeSpecificData == 18);
+    ASF_TEST_CHECK(pStream->dwDataBitrate == 0);
+
+    ASF_TEST_CHECK(parser.GetStreamByNumber(3, &pStream) == S_OK);
+    ASF_TEST_CHECK(pStream->guidStreamType == ASF_Command_Media);
+    ASF_TEST_CHECK(pStream->cbMaxObjectSize == 77777);
+
+    ASF_TEST_CHECK(parser.GetStream(0, &pStream) == S_OK);
+    ASF_TEST_CHECK(pStream->wStreamNumber == 1);
+    ASF_TEST_CHECK(parser.GetStream(3, &pStream) == MF_E_INVALIDINDEX);
+    ASF_TEST_CHECK(parser.GetStreamByNumber(4, &pStream) == MF_E_INVALIDSTREAMNUMBER);
+
+    //Without the Data Object header the data bounds stay unknown
+    ASF_TEST_CHECK(parser.Parse(file.GetData(), parser.GetHeaderSize()) == S_OK);
+    ASF_TEST_CHECK(parser.GetDataOffset() == 0);
+    ASF_TEST_CHECK(parser.GetStreamCount() == 3);
+}
+
+static void TestTruncatedHeader()
+{
+    CASFTestWriter file;
+    WriteValidFile(file);
+
+    CASFHeaderParser parser;
+    QWORD cbHeader = 0;
+
+    ASF_TEST_CHECK(CASFHeaderParser::GetHeaderSize(file.GetData(), 10, &cbHeader) == MF_E_ASF_PARSINGINCOMPLETE);
+    ASF_TEST_CHECK(CASFHeaderParser::GetHeaderSize(file.GetData(), file.GetSize(), &cbHeader) == S_OK);
+
+    //The span ends inside the Header Object
+    ASF_TEST_CHECK(parser.Parse(file.GetData(), cbHeader - 1) == MF_E_ASF_PARSINGINCOMPLETE);
+    ASF_TEST_CHECK(parser.GetStreamCount() == 0);
+
+    //A File Properties Object too short for its fields
+    CASFTestWriter children, shortFile, fileProperties;
+
+    fileProperties.WriteFill(0, ASF_FILE_PROPERTIES_SIZE - ASF_OBJECT_HEADER_SIZE - 1);
+    children.WriteObject(ASF_File_Properties_Object, fileProperties);
+    WriteTestHeaderObject(shortFile, children, 1);
+
+    ASF_TEST_CHECK(parser.Parse(shortFile.GetData(), shortFile.GetSize()) == MF_E_ASF_INVALIDDATA);
+
+    GUID guidFileID = GUID_NULL;
+    ASF_TEST_CHECK(CASFHeaderParser::GetFileID(shortFile.GetData(), shortFile.GetSize(), &guidFileID) == MF_E_ASF_INVALIDDATA);
+    ASF_TEST_CHECK(CASFHeaderParser::GetFileID(file.GetData(), cbHeader - 1, &guidFileID) == MF_E_ASF_PARSINGINCOMPLETE);
+
+    //A Header Object that is not an ASF header at all
+    file.GetData()[0] ^= 0xFF;
+    ASF_TEST_CHECK(parser.Parse(file.GetData(), file.GetSize()) == MF_E_INVALID_FILE_FORMAT);
+}
+
+static void TestOversizedObject()
+{
+    CASFTestWriter children;
+
+    WriteTestFileProperties(children, TEST_PACKET_SIZE, TEST_PACKETS, 50000000, 3000);
+    WriteTestStreamProperties(children, 1, ASF_Video_Media, 40);
+
+    //The stream object claims more bytes than the Header Object holds
+    size_t cbStreamObject = ASF_FILE_PROPERTIES_SIZE;
+    children.PatchQWord(cbStreamObject + 16, children.GetSize() - cbStreamObject + 1);
+
+    CASFTestWriter file;
+    WriteTestHeaderObject(file, children, 2);
+
+    CASFHeaderParser parser;
+    ASF_TEST_CHECK(parser.Parse(file.GetData(), file.GetSize()) == MF_E_ASF_INVALIDDATA);
+
+    //Type-specific data that runs past the end of its object
+    CASFTestWriter children2, file2;
+
+    WriteTestFileProperties(children2, TEST_PACKET_SIZE, TEST_PACKETS, 50000000, 3000);
+    WriteTestStreamProperties(children2, 1, ASF_Video_Media, 40);
+    children2.GetData()[cbStreamObject + 64] = 41;
+    WriteTestHeaderObject(file2, children2, 2);
+
+    ASF_TEST_CHECK(parser.Parse(file2.GetData(), file2.GetSize()) == MF_E_ASF_INVALIDDATA);
+
+    //A child of the Header Extension larger than the extension data
+    CASFTestWriter children3, extension, file3;
+
+    WriteTestFileProperties(children3, TEST_PACKET_SIZE, TEST_PACKETS, 50000000, 3000);
+    WriteExtendedStreamProperties(extension, 1, NULL);
+    extension.PatchQWord(16, extension.GetSize() + 1);
+    WriteHeaderExtension(children3, extension);
+    WriteTestHeaderObject(file3, children3, 2);
+
+    ASF_TEST_CHECK(parser.Parse(file3.GetData(), file3.GetSize()) == MF_E_ASF_INVALIDDATA);
+}
+
+static void TestUnknownObjectsOnly()
+{
+    CASFTestWriter children, unknown, file;
+
+    unknown.WriteFill(0, 8);
+    children.WriteObject(TEST_Unknown_Object, unknown);
+    WriteTestFileProperties(children, TEST_PACKET_SIZE, TEST_PACKETS, 50000000, 3000);
+    children.WriteObject(TEST_Unknown_Object, unknown);
+    WriteTestHeaderObject(file, children, 3);
+
+    CASFHeaderParser parser;
+    ASF_TEST_CHECK(parser.Parse(file.GetData(), file.GetSize()) == S_OK);
+    ASF_TEST_CHECK(parser.GetStreamCount() == 0);
+
+    //The File ID is found past the unknown object
+    GUID guidFileID = GUID_NULL;
+    ASF_TEST_CHECK(CASFHeaderParser::GetFileID(file.GetData(), file.GetSize(), &guidFileID) == S_OK);
+    ASF_TEST_CHECK(guidFileID == ASF_TEST_FILE_ID);
+
+    //The File Properties Object is required
+    CASFTestWriter children2, file2;
+
+    children2.WriteObject(TEST_Unknown_Object, unknown);
+    WriteTestHeaderObject(file2, children2, 1);
+
+    ASF_TEST_CHECK(parser.Parse(file2.GetData(), file2.GetSize()) == MF_E_ASF_INVALIDDATA);
+    ASF_TEST_CHECK(CASFHeaderParser::GetFileID(file2.GetData(), file2.GetSize(), &guidFileID) == MF_E_ASF_INVALIDDATA);
+}
+
+int main()
+{
+    TestValidHeader();
+    TestTruncatedHeader();
+    TestOversizedObject();
+    TestUnknownObjectsOnly();
+
+    return ASF_TEST_RESULT();
+}
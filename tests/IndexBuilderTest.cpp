@@ -0,0 +1,339 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// IndexBuilderTest.cpp : CASFIndexBuilder build and sidecar tests.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "ASFIndexBuilder.h"
+#include "ASFTestData.h"
+
+#define TEST_PACKET_SIZE    256
+#define TEST_PACKET_COUNT   40
+#define TEST_VIDEO_SIZE     100
+#define TEST_AUDIO_SIZE     20
+
+//Video key frames are 4000 ms apart; audio objects are all key frames,
+//500 ms apart, so one in two is indexed
+#define TEST_VIDEO_ENTRIES  (TEST_PACKET_COUNT / 2 / ASF_TEST_KEY_FRAME_INTERVAL)
+#define TEST_AUDIO_ENTRIES  (TEST_PACKET_COUNT / 2)
+
+#ifdef _WIN32
+static const ASF_PATH_CHAR s_szMediaFile[] = L"IndexBuilderTest.asf";
+static const ASF_PATH_CHAR s_szSidecarFile[] = L"IndexBuilderTest.asf.asfidx";
+static const ASF_PATH_CHAR s_szUnwritableFile[] = L"IndexBuilderTest.missing/IndexBuilderTest.asfidx";
+#else
+static const ASF_PATH_CHAR s_szMediaFile[] = "IndexBuilderTest.asf";
+static const ASF_PATH_CHAR s_szSidecarFile[] = "IndexBuilderTest.asf.asfidx";
+static const ASF_PATH_CHAR s_szUnwritableFile[] = "IndexBuilderTest.missing/IndexBuilderTest.asfidx";
+#endif
+
+static const GUID TEST_OTHER_FILE_ID =
+    { 0x11223344, 0x5566, 0x7788, { 1, 2, 3, 4, 5, 6, 7, 9 } };
+
+static void CheckIndexesEqual(const CASFIndexReader& index, const CASFIndexReader& expected)
+{
+    for (WORD w = 1; w < ASF_MAX_STREAMS; w++)
+    {
+        const ASF_STREAM_INDEX* pIndex = NULL;
+        const ASF_STREAM_INDEX* pExpected = NULL;
+
+        HRESULT hr = index.GetStreamIndex(w, &pIndex);
+        HRESULT hrExpected = expected.GetStreamIndex(w, &pExpected);
+
+        ASF_TEST_CHECK(SUCCEEDED(hr) == SUCCEEDED(hrExpected));
+
+        if (FAILED(hr) || FAILED(hrExpected))
+        {
+            continue;
+        }
+
+        ASF_TEST_CHECK(pIndex->wIndexType == pExpected->wIndexType);
+        ASF_TEST_CHECK(pIndex->cEntries == pExpected->cEntries);
+
+        for (DWORD i = 0; (i < pIndex->cEntries) && (i < pExpected->cEntries); i++)
+        {
+            ASF_TEST_CHECK(pIndex->pdwTimes[i] == pExpected->pdwTimes[i]);
+            ASF_TEST_CHECK(pIndex->pcbOffsets[i] == pExpected->pcbOffsets[i]);
+        }
+    }
+}
+
+//One entry per video key frame and one per second of audio, at the
+//packets the objects start in
+static void TestBuild(const CASFTestWriter& packets, CASFIndexReader* pIndex)
+{
+    CASFIndexBuilder builder;
+    const ASF_STREAM_INDEX* pStreamIndex = NULL;
+
+    ASF_TEST_CHECK(builder.Build(packets.GetData(), TEST_PACKET_COUNT, TEST_PACKET_SIZE, ASF_TEST_PREROLL, pIndex) == S_OK);
+
+    ASF_TEST_CHECK(pIndex->GetStreamIndex(ASF_TEST_VIDEO_STREAM, &pStreamIndex) == S_OK);
+
+    if (pStreamIndex)
+    {
+        ASF_TEST_CHECK(pStreamIndex->wIndexType == ASF_INDEX_NEAREST_PAST_CLEANPOINT);
+        ASF_TEST_CHECK(pStreamIndex->cEntries == TEST_VIDEO_ENTRIES);
+
+        for (DWORD i = 0; (i < pStreamIndex->cEntries) && (i < TEST_VIDEO_ENTRIES); i++)
+        {
+            const DWORD iPacket = 2 * ASF_TEST_KEY_FRAME_INTERVAL * i;
+
+            ASF_TEST_CHECK(pStreamIndex->pdwTimes[i] == iPacket * ASF_TEST_PACKET_MS);
+            ASF_TEST_CHECK(pStreamIndex->pcbOffsets[i] == (QWORD)iPacket * TEST_PACKET_SIZE);
+        }
+    }
+
+    pStreamIndex = NULL;
+    ASF_TEST_CHECK(pIndex->GetStreamIndex(ASF_TEST_AUDIO_STREAM, &pStreamIndex) == S_OK);
+
+    if (pStreamIndex)
+    {
+        ASF_TEST_CHECK(pStreamIndex->cEntries == TEST_AUDIO_ENTRIES);
+
+        for (DWORD i = 0; (i < pStreamIndex->cEntries) && (i < TEST_AUDIO_ENTRIES); i++)
+        {
+            ASF_TEST_CHECK(pStreamIndex->pdwTimes[i] == 2 * i * ASF_TEST_PACKET_MS);
+            ASF_TEST_CHECK(pStreamIndex->pcbOffsets[i] == (QWORD)2 * i * TEST_PACKET_SIZE);
+        }
+    }
+
+    ASF_TEST_CHECK(!pIndex->HasIndex(3));
+
+    //Without packets there is nothing to index
+    CASFIndexReader empty;
+
+    ASF_TEST_CHECK(builder.Build(NULL, 0, TEST_PACKET_SIZE, ASF_TEST_PREROLL, &empty) == S_OK);
+    ASF_TEST_CHECK(empty.IsEmpty());
+    ASF_TEST_CHECK(builder.Build(NULL, 1, TEST_PACKET_SIZE, ASF_TEST_PREROLL, &empty) == E_POINTER);
+}
+
+static void TestSidecarName()
+{
+    ASF_PATH_CHAR* sSidecarName = NULL;
+
+    ASF_TEST_CHECK(CASFIndexBuilder::GetSidecarName(s_szMediaFile, &sSidecarName) == S_OK);
+    ASF_TEST_CHECK(sSidecarName && (memcmp(sSidecarName, s_szSidecarFile, sizeof(s_szSidecarFile)) == 0));
+
+    delete [] sSidecarName;
+    sSidecarName = NULL;
+
+    //Path names are not limited in length
+    const size_t cchLong = 1000;
+    ASF_PATH_CHAR* sLongName = new ASF_PATH_CHAR[cchLong + 1];
+
+    for (size_t i = 0; i < cchLong; i++)
+    {
+        sLongName[i] = (ASF_PATH_CHAR)'a';
+    }
+
+    sLongName[cchLong] = 0;
+
+    ASF_TEST_CHECK(CASFIndexBuilder::GetSidecarName(sLongName, &sSidecarName) == S_OK);
+
+    if (sSidecarName)
+    {
+        const size_t cchExtension = sizeof(ASF_INDEX_SIDECAR_EXTENSION) / sizeof(ASF_PATH_CHAR);
+
+        ASF_TEST_CHECK(memcmp(sSidecarName, sLongName, cchLong * sizeof(ASF_PATH_CHAR)) == 0);
+        ASF_TEST_CHECK(memcmp(sSidecarName + cchLong, ASF_INDEX_SIDECAR_EXTENSION, cchExtension * sizeof(ASF_PATH_CHAR)) == 0);
+    }
+
+    delete [] sSidecarName;
+    delete [] sLongName;
+}
+
+//The sidecar only loads for the File ID and data size it was saved for
+static void TestSidecarRoundTrip(const CASFIndexReader& built)
+{
+    const QWORD cbData = (QWORD)TEST_PACKET_COUNT * TEST_PACKET_SIZE;
+    const DWORD dwOther = 12345;
+
+    DeleteTestFile(s_szSidecarFile);
+
+    CASFIndexReader index;
+
+    ASF_TEST_CHECK(CASFIndexBuilder::LoadSidecar(s_szSidecarFile, ASF_TEST_FILE_ID, cbData, &index) == MF_E_NOT_FOUND);
+    ASF_TEST_CHECK(CASFIndexBuilder::SaveSidecar(s_szSidecarFile, ASF_TEST_FILE_ID, cbData, index) == MF_E_ASF_NOINDEX);
+
+    ASF_TEST_CHECK(CASFIndexBuilder::SaveSidecar(s_szSidecarFile, ASF_TEST_FILE_ID, cbData, built) == S_OK);
+
+    ASF_TEST_CHECK(CASFIndexBuilder::LoadSidecar(s_szSidecarFile, ASF_TEST_FILE_ID, cbData, &index) == S_OK);
+    CheckIndexesEqual(index, built);
+
+    //A sidecar of another file leaves the index as it was
+    CASFIndexReader other;
+    const QWORD cbOther = 0;
+
+    ASF_TEST_CHECK(other.SetStreamIndex(5, ASF_INDEX_NEAREST_PAST_DATA_PACKET, &dwOther, &cbOther, 1) == S_OK);
+
+    ASF_TEST_CHECK(CASFIndexBuilder::LoadSidecar(s_szSidecarFile, TEST_OTHER_FILE_ID, cbData, &other) == MF_E_INVALID_FILE_FORMAT);
+    ASF_TEST_CHECK(CASFIndexBuilder::LoadSidecar(s_szSidecarFile, ASF_TEST_FILE_ID, cbData + TEST_PACKET_SIZE, &other) == MF_E_INVALID_FILE_FORMAT);
+
+    ASF_TEST_CHECK(other.HasIndex(5));
+    ASF_TEST_CHECK(!other.HasIndex(ASF_TEST_VIDEO_STREAM));
+    ASF_TEST_CHECK(!other.HasIndex(ASF_TEST_AUDIO_STREAM));
+
+    DeleteTestFile(s_szSidecarFile);
+}
+
+//Sidecar header and one stream, in the documented layout
+static void WriteTestSidecar(CASFTestWriter& sidecar, QWORD cbData, DWORD cEntries, DWORD cWritten)
+{
+    sidecar.Clear();
+    sidecar.WriteDWord(ASF_INDEX_SIDECAR_MAGIC);
+    sidecar.WriteWord(ASF_INDEX_SIDECAR_VERSION);
+    sidecar.WriteWord(1);
+    sidecar.WriteGUID(ASF_TEST_FILE_ID);
+    sidecar.WriteQWord(cbData);
+
+    sidecar.WriteWord(ASF_TEST_VIDEO_STREAM);
+    sidecar.WriteWord(ASF_INDEX_NEAREST_PAST_CLEANPOINT);
+    sidecar.WriteDWord(cEntries);
+
+    for (DWORD i = 0; i < cWritten; i++)
+    {
+        sidecar.WriteDWord(i * 1000);
+    }
+
+    for (DWORD i = 0; i < cWritten; i++)
+    {
+        sidecar.WriteQWord((QWORD)i * TEST_PACKET_SIZE);
+    }
+}
+
+static void TestTruncatedSidecar()
+{
+    const QWORD cbData = (QWORD)TEST_PACKET_COUNT * TEST_PACKET_SIZE;
+
+    CASFTestWriter sidecar, truncated;
+    CASFIndexReader index;
+
+    QWORD cbOffset = 0;
+
+    //The layout SaveSidecar documents loads
+    WriteTestSidecar(sidecar, cbData, 3, 3);
+    ASF_TEST_CHECK(WriteTestFile(s_szSidecarFile, sidecar));
+
+    ASF_TEST_CHECK(CASFIndexBuilder::LoadSidecar(s_szSidecarFile, ASF_TEST_FILE_ID, cbData, &index) == S_OK);
+    ASF_TEST_CHECK(index.Lookup(ASF_TEST_VIDEO_STREAM, 2500, &cbOffset, NULL, NULL) == S_OK);
+    ASF_TEST_CHECK(cbOffset == 2 * TEST_PACKET_SIZE);
+
+    //Cut within the header, the stream record and the entries
+    const size_t rgcbCut[] =
+    {
+        0,
+        ASF_INDEX_SIDECAR_HEADER_SIZE - 1,
+        ASF_INDEX_SIDECAR_HEADER_SIZE,
+        ASF_INDEX_SIDECAR_HEADER_SIZE + ASF_INDEX_SIDECAR_STREAM_SIZE - 1,
+        sidecar.GetSize() - 1,
+    };
+
+    for (DWORD i = 0; i < sizeof(rgcbCut) / sizeof(rgcbCut[0]); i++)
+    {
+        CASFIndexReader empty;
+
+        truncated.Clear();
+        truncated.WriteBytes(sidecar.GetData(), rgcbCut[i]);
+
+        ASF_TEST_CHECK(WriteTestFile(s_szSidecarFile, truncated));
+        ASF_TEST_CHECK(CASFIndexBuilder::LoadSidecar(s_szSidecarFile, ASF_TEST_FILE_ID, cbData, &empty) == MF_E_INVALID_FILE_FORMAT);
+        ASF_TEST_CHECK(empty.IsEmpty());
+    }
+
+    //An entry count past the end of the file
+    WriteTestSidecar(sidecar, cbData, 4, 3);
+    ASF_TEST_CHECK(WriteTestFile(s_szSidecarFile, sidecar));
+    ASF_TEST_CHECK(CASFIndexBuilder::LoadSidecar(s_szSidecarFile, ASF_TEST_FILE_ID, cbData, &index) == MF_E_INVALID_FILE_FORMAT);
+
+    DeleteTestFile(s_szSidecarFile);
+}
+
+//Builds and saves once; later calls load the sidecar without reading
+//the packets
+static void TestLoadOrBuild(const CASFTestWriter& packets, const CASFIndexReader& built)
+{
+    const QWORD cbData = (QWORD)TEST_PACKET_COUNT * TEST_PACKET_SIZE;
+
+    CASFIndexBuilder builder;
+
+    DeleteTestFile(s_szSidecarFile);
+
+    {
+        CASFIndexReader index;
+
+        ASF_TEST_CHECK(builder.LoadOrBuild(
+            s_szSidecarFile, ASF_TEST_FILE_ID, cbData,
+            packets.GetData(), TEST_PACKET_COUNT, TEST_PACKET_SIZE, ASF_TEST_PREROLL,
+            &index
+            ) == S_OK);
+
+        CheckIndexesEqual(index, built);
+    }
+
+    {
+        CASFIndexReader index;
+
+        ASF_TEST_CHECK(builder.LoadOrBuild(
+            s_szSidecarFile, ASF_TEST_FILE_ID, cbData,
+            NULL, TEST_PACKET_COUNT, TEST_PACKET_SIZE, ASF_TEST_PREROLL,
+            &index
+            ) == S_OK);
+
+        CheckIndexesEqual(index, built);
+    }
+
+    //A sidecar that cannot be written still yields the index
+    {
+        CASFIndexReader index;
+
+        ASF_TEST_CHECK(builder.LoadOrBuild(
+            s_szUnwritableFile, ASF_TEST_FILE_ID, cbData,
+            packets.GetData(), TEST_PACKET_COUNT, TEST_PACKET_SIZE, ASF_TEST_PREROLL,
+            &index
+            ) == S_FALSE);
+
+        CheckIndexesEqual(index, built);
+    }
+
+    DeleteTestFile(s_szSidecarFile);
+}
+
+int main()
+{
+    CASFTestWriter packets;
+    CASFIndexReader built;
+
+    for (DWORD i = 0; i < TEST_PACKET_COUNT; i++)
+    {
+        WriteTestMediaPacket(packets, TEST_PACKET_SIZE, i, TEST_VIDEO_SIZE, TEST_AUDIO_SIZE);
+    }
+
+    ASF_TEST_CHECK(packets.GetSize() == (size_t)TEST_PACKET_COUNT * TEST_PACKET_SIZE);
+
+    TestBuild(packets, &built);
+    TestSidecarName();
+
+    CASFTestWriter probe;
+    probe.WriteDWord(0);
+
+    if (!WriteTestFile(s_szSidecarFile, probe))
+    {
+        printf("skipped: cannot write the test files\n");
+        return ASF_TEST_RESULT();
+    }
+
+    TestSidecarRoundTrip(built);
+    TestTruncatedSidecar();
+    TestLoadOrBuild(packets, built);
+
+    return ASF_TEST_RESULT();
+}
@@ -0,0 +1,154 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// IndexLookupBenchmark.cpp : Measures Index Object parsing and
+//                            CASFIndexReader lookups.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ASFIndexReader.h"
+#include "ASFThread.h"
+#include "ASFTestData.h"
+
+#define BENCH_ENTRIES_PER_ROUND     36000       // Ten hours at one entry per second
+#define BENCH_DEFAULT_ROUNDS        10
+#define BENCH_ENTRIES_PER_BLOCK     10000
+#define BENCH_PARSES                10
+#define BENCH_LOOKUPS               1000000
+
+#define BENCH_INTERVAL_MS           1000
+#define BENCH_PACKET_SIZE           8000
+#define BENCH_STREAM                1
+
+//One Index Object for a video and an audio stream. Every tenth video
+//entry has no seek point; the block positions step by 2 GB.
+static void MakeIndex(DWORD cEntries, CASFTestWriter& file)
+{
+    CASFTestWriter body;
+    DWORD cBlocks = (cEntries + BENCH_ENTRIES_PER_BLOCK - 1) / BENCH_ENTRIES_PER_BLOCK;
+
+    body.WriteDWord(BENCH_INTERVAL_MS);
+    body.WriteWord(2);
+    body.WriteDWord(cBlocks);
+
+    body.WriteWord(BENCH_STREAM);
+    body.WriteWord(ASF_INDEX_NEAREST_PAST_CLEANPOINT);
+    body.WriteWord(BENCH_STREAM + 1);
+    body.WriteWord(ASF_INDEX_NEAREST_PAST_DATA_PACKET);
+
+    for (DWORD b = 0; b < cBlocks; b++)
+    {
+        DWORD iFirst = b * BENCH_ENTRIES_PER_BLOCK;
+        DWORD cBlockEntries = (cEntries - iFirst < BENCH_ENTRIES_PER_BLOCK) ? cEntries - iFirst : BENCH_ENTRIES_PER_BLOCK;
+
+        body.WriteDWord(cBlockEntries);
+        body.WriteQWord((QWORD)b * 0x80000000);
+        body.WriteQWord((QWORD)b * 0x80000000);
+
+        for (DWORD i = 0; i < cBlockEntries; i++)
+        {
+            body.WriteDWord(((iFirst + i) % 10 == 9) ? ASF_INDEX_INVALID_OFFSET : i * 3 * BENCH_PACKET_SIZE);
+            body.WriteDWord(i * 3 * BENCH_PACKET_SIZE);
+        }
+    }
+
+    file.WriteObject(ASF_Index_Object, body);
+}
+
+//Usage: IndexLookupBenchmark [rounds]
+//Timings are only meaningful in an optimized build, for example with
+//-DCMAKE_BUILD_TYPE=Release.
+int main(int argc, char* argv[])
+{
+    DWORD cRounds = (argc > 1) ? (DWORD)atoi(argv[1]) : BENCH_DEFAULT_ROUNDS;
+
+    if (cRounds == 0)
+    {
+        cRounds = 1;
+    }
+
+    const DWORD cEntries = cRounds * BENCH_ENTRIES_PER_ROUND;
+
+    CASFTestWriter file;
+    CASFIndexReader index;
+
+    MakeIndex(cEntries, file);
+
+    printf("%u entries, %u bytes\n", cEntries, (DWORD)file.GetSize());
+
+    LONGLONG llStart = CASFThread::GetTimestamp();
+
+    for (DWORD i = 0; i < BENCH_PARSES; i++)
+    {
+        ASF_TEST_CHECK(index.Parse(file.GetData(), file.GetSize(), BENCH_PACKET_SIZE, NULL, 0) == S_OK);
+    }
+
+    double msParse = (double)(CASFThread::GetTimestamp() - llStart) / 10000.0 / BENCH_PARSES;
+
+    printf("parse                %8.2f ms, %10.0f entries/s\n",
+        msParse,
+        (msParse > 0) ? cEntries * 1000.0 / msParse : 0.0);
+
+    const ASF_STREAM_INDEX* pStreamIndex = NULL;
+
+    ASF_TEST_CHECK(index.GetStreamIndex(BENCH_STREAM, &pStreamIndex) == S_OK);
+    ASF_TEST_CHECK(pStreamIndex && (pStreamIndex->cEntries == cEntries - cEntries / 10));
+
+    //Lookups spread over the whole index, past its end included
+    const DWORD msDuration = cEntries * BENCH_INTERVAL_MS;
+    const QWORD cbData = (QWORD)(cEntries / BENCH_ENTRIES_PER_BLOCK + 1) * 0x80000000;
+
+    for (int iSeek = 0; iSeek < 2; iSeek++)
+    {
+        QWORD cbChecksum = 0;
+
+        llStart = CASFThread::GetTimestamp();
+
+        for (DWORD i = 0; i < BENCH_LOOKUPS; i++)
+        {
+            DWORD dwTime = (DWORD)((QWORD)msDuration * i / BENCH_LOOKUPS * 11 / 10);
+            QWORD cbOffset = 0;
+
+            if (iSeek)
+            {
+                if (index.FindSeekPoint(BENCH_STREAM, (MFTIME)dwTime * 10000, cbData, BENCH_PACKET_SIZE, &cbOffset, NULL, NULL) == S_OK)
+                {
+                    cbChecksum += cbOffset;
+                }
+            }
+            else if (index.Lookup(BENCH_STREAM, dwTime, &cbOffset, NULL, NULL) == S_OK)
+            {
+                cbChecksum += cbOffset;
+            }
+        }
+
+        double msLookup = (double)(CASFThread::GetTimestamp() - llStart) / 10000.0;
+
+        printf("%-20s %8.2f ms, %10.0f lookups/s (checksum %llu)\n",
+            iSeek ? "seek point" : "lookup",
+            msLookup,
+            (msLookup > 0) ? BENCH_LOOKUPS * 1000.0 / msLookup : 0.0,
+            (unsigned long long)cbChecksum);
+    }
+
+    //An entry without a seek point falls back to the one before it
+    QWORD cbOffset = 0;
+    DWORD dwEntryTime = 0;
+
+    ASF_TEST_CHECK(index.Lookup(BENCH_STREAM, 9 * BENCH_INTERVAL_MS, &cbOffset, NULL, &dwEntryTime) == S_OK);
+    ASF_TEST_CHECK(cbOffset == 8 * 3 * BENCH_PACKET_SIZE);
+    ASF_TEST_CHECK(dwEntryTime == 8 * BENCH_INTERVAL_MS);
+
+    ASF_TEST_CHECK(index.Lookup(BENCH_STREAM + 1, 9 * BENCH_INTERVAL_MS, &cbOffset, NULL, &dwEntryTime) == S_OK);
+    ASF_TEST_CHECK(cbOffset == 9 * 3 * BENCH_PACKET_SIZE);
+
+    return ASF_TEST_RESULT();
+}
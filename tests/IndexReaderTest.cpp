@@ -0,0 +1,339 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// IndexReaderTest.cpp : CASFIndexReader parsing and lookup tests.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "ASFIndexReader.h"
+#include "ASFTestData.h"
+
+#define TEST_PACKET_SIZE    1000
+#define TEST_INTERVAL_MS    1000
+
+#define TEST_VIDEO_STREAM   1
+#define TEST_AUDIO_STREAM   2
+#define TEST_SECOND_VIDEO   3
+
+static const WORD s_rgwVideoStreams[] = { TEST_VIDEO_STREAM, TEST_SECOND_VIDEO };
+
+//Simple Index Object with one entry per interval
+static void WriteSimpleIndex(CASFTestWriter& file, const DWORD* pdwPackets, DWORD cEntries)
+{
+    CASFTestWriter body;
+
+    body.WriteGUID(ASF_TEST_FILE_ID);
+    body.WriteQWord((QWORD)TEST_INTERVAL_MS * 10000);
+    body.WriteDWord(1);
+    body.WriteDWord(cEntries);
+
+    for (DWORD i = 0; i < cEntries; i++)
+    {
+        body.WriteDWord(pdwPackets[i]);
+        body.WriteWord(1);
+    }
+
+    file.WriteObject(ASF_Simple_Index_Object, body);
+}
+
+//Index Object with one specifier; the block holds offsets from its
+//block position
+struct TEST_INDEX_BLOCK
+{
+    QWORD           cbPosition;
+    const DWORD*    pdwOffsets;
+    DWORD           cEntries;
+};
+
+static void WriteIndex(
+    CASFTestWriter& file,
+    WORD wStreamNumber,
+    WORD wIndexType,
+    const TEST_INDEX_BLOCK* pBlocks,
+    DWORD cBlocks
+    )
+{
+    CASFTestWriter body;
+
+    body.WriteDWord(TEST_INTERVAL_MS);
+    body.WriteWord(1);
+    body.WriteDWord(cBlocks);
+
+    body.WriteWord(wStreamNumber);
+    body.WriteWord(wIndexType);
+
+    for (DWORD b = 0; b < cBlocks; b++)
+    {
+        body.WriteDWord(pBlocks[b].cEntries);
+        body.WriteQWord(pBlocks[b].cbPosition);
+
+        for (DWORD i = 0; i < pBlocks[b].cEntries; i++)
+        {
+            body.WriteDWord(pBlocks[b].pdwOffsets[i]);
+        }
+    }
+
+    file.WriteObject(ASF_Index_Object, body);
+}
+
+static void CheckLookup(
+    const CASFIndexReader& index,
+    WORD wStreamNumber,
+    DWORD dwTime,
+    QWORD cbExpected,
+    QWORD cbExpectedNext,
+    DWORD dwExpectedTime
+    )
+{
+    QWORD cbOffset = 0, cbNextOffset = 0;
+    DWORD dwEntryTime = 0;
+
+    ASF_TEST_CHECK(index.Lookup(wStreamNumber, dwTime, &cbOffset, &cbNextOffset, &dwEntryTime) == S_OK);
+    ASF_TEST_CHECK(cbOffset == cbExpected);
+    ASF_TEST_CHECK(cbNextOffset == cbExpectedNext);
+    ASF_TEST_CHECK(dwEntryTime == dwExpectedTime);
+}
+
+//Two blocks, the second past 4 GB. Entries without a seek point are
+//skipped and repeats of the last offset are stored once.
+static void TestIndexBlocks()
+{
+    const DWORD rgdwFirst[] = { ASF_INDEX_INVALID_OFFSET, 0, 0, 3000, ASF_INDEX_INVALID_OFFSET, 5000 };
+    const DWORD rgdwSecond[] = { 0, ASF_INDEX_INVALID_OFFSET, 2000 };
+
+    const TEST_INDEX_BLOCK rgBlocks[] =
+    {
+        { 0, rgdwFirst, 6 },
+        { 0x100000000ULL, rgdwSecond, 3 },
+    };
+
+    CASFTestWriter file;
+    CASFIndexReader index;
+    const ASF_STREAM_INDEX* pStreamIndex = NULL;
+
+    WriteIndex(file, TEST_AUDIO_STREAM, ASF_INDEX_NEAREST_PAST_DATA_PACKET, rgBlocks, 2);
+
+    ASF_TEST_CHECK(index.Parse(file.GetData(), file.GetSize(), TEST_PACKET_SIZE, NULL, 0) == S_OK);
+    ASF_TEST_CHECK(index.HasIndex(TEST_AUDIO_STREAM));
+    ASF_TEST_CHECK(!index.HasIndex(TEST_VIDEO_STREAM));
+
+    ASF_TEST_CHECK(index.GetStreamIndex(TEST_AUDIO_STREAM, &pStreamIndex) == S_OK);
+
+    if (pStreamIndex)
+    {
+        const DWORD rgdwTimes[] = { 1000, 3000, 5000, 6000, 8000 };
+        const QWORD rgcbOffsets[] = { 0, 3000, 5000, 0x100000000ULL, 0x100000000ULL + 2000 };
+
+        ASF_TEST_CHECK(pStreamIndex->wIndexType == ASF_INDEX_NEAREST_PAST_DATA_PACKET);
+        ASF_TEST_CHECK(pStreamIndex->cEntries == 5);
+
+        for (DWORD i = 0; (i < pStreamIndex->cEntries) && (i < 5); i++)
+        {
+            ASF_TEST_CHECK(pStreamIndex->pdwTimes[i] == rgdwTimes[i]);
+            ASF_TEST_CHECK(pStreamIndex->pcbOffsets[i] == rgcbOffsets[i]);
+        }
+    }
+
+    //Before the first entry, between entries, on an entry, after the last
+    CheckLookup(index, TEST_AUDIO_STREAM, 0, 0, 3000, 1000);
+    CheckLookup(index, TEST_AUDIO_STREAM, 2999, 0, 3000, 1000);
+    CheckLookup(index, TEST_AUDIO_STREAM, 3000, 3000, 5000, 3000);
+    CheckLookup(index, TEST_AUDIO_STREAM, 7999, 0x100000000ULL, 0x100000000ULL + 2000, 6000);
+    CheckLookup(index, TEST_AUDIO_STREAM, 0xFFFFFFFF, 0x100000000ULL + 2000, ASF_INDEX_NO_OFFSET, 8000);
+
+    QWORD cbOffset = 0;
+    ASF_TEST_CHECK(index.Lookup(TEST_VIDEO_STREAM, 0, &cbOffset, NULL, NULL) == MF_E_ASF_NOINDEX);
+    ASF_TEST_CHECK(index.Lookup(ASF_MAX_STREAMS, 0, &cbOffset, NULL, NULL) == MF_E_ASF_NOINDEX);
+    ASF_TEST_CHECK(index.Lookup(TEST_AUDIO_STREAM, 0, NULL, NULL, NULL) == E_POINTER);
+
+    //Seek points as playback asks for them
+    QWORD cbNextOffset = 0;
+    MFTIME hnsEntryTime = 0;
+
+    ASF_TEST_CHECK(index.FindSeekPoint(TEST_AUDIO_STREAM, -1, 0x200000000ULL, TEST_PACKET_SIZE, &cbOffset, &cbNextOffset, &hnsEntryTime) == S_OK);
+    ASF_TEST_CHECK(cbOffset == 0);
+    ASF_TEST_CHECK(hnsEntryTime == 10000000);
+
+    ASF_TEST_CHECK(index.FindSeekPoint(TEST_AUDIO_STREAM, 45000000, 0x200000000ULL, 0, &cbOffset, &cbNextOffset, &hnsEntryTime) == S_OK);
+    ASF_TEST_CHECK(cbOffset == 3000);
+    ASF_TEST_CHECK(cbNextOffset == 5000);
+    ASF_TEST_CHECK(hnsEntryTime == 30000000);
+
+    //Offsets aligned down to the packet; past the data is invalid
+    ASF_TEST_CHECK(index.FindSeekPoint(TEST_AUDIO_STREAM, 0x7FFFFFFFFFFFFFFFLL, 0x200000000ULL, 4096, &cbOffset, NULL, NULL) == S_OK);
+    ASF_TEST_CHECK(cbOffset == 0x100000000ULL);
+
+    ASF_TEST_CHECK(index.FindSeekPoint(TEST_AUDIO_STREAM, 0x7FFFFFFFFFFFFFFFLL, 0x100000000ULL, 0, &cbOffset, NULL, NULL) == MF_E_ASF_INVALIDDATA);
+}
+
+//Simple Index Objects go to the video streams in order
+static void TestSimpleIndex()
+{
+    const DWORD rgdwPackets[] = { 0, 0, 4, 4, 9 };
+    const DWORD rgdwOther[] = { 2, 7 };
+
+    CASFTestWriter file;
+    CASFIndexReader index;
+
+    WriteSimpleIndex(file, rgdwPackets, 5);
+    WriteSimpleIndex(file, rgdwOther, 2);
+
+    ASF_TEST_CHECK(index.Parse(file.GetData(), file.GetSize(), TEST_PACKET_SIZE, s_rgwVideoStreams, 2) == S_OK);
+
+    CheckLookup(index, TEST_VIDEO_STREAM, 0, 0, 4 * TEST_PACKET_SIZE, 0);
+    CheckLookup(index, TEST_VIDEO_STREAM, 3500, 4 * TEST_PACKET_SIZE, 9 * TEST_PACKET_SIZE, 2000);
+    CheckLookup(index, TEST_VIDEO_STREAM, 100000, 9 * TEST_PACKET_SIZE, ASF_INDEX_NO_OFFSET, 4000);
+
+    CheckLookup(index, TEST_SECOND_VIDEO, 999, 2 * TEST_PACKET_SIZE, 7 * TEST_PACKET_SIZE, 0);
+    CheckLookup(index, TEST_SECOND_VIDEO, 1000, 7 * TEST_PACKET_SIZE, ASF_INDEX_NO_OFFSET, 1000);
+
+    //Without a packet size, or without video streams, they are ignored
+    ASF_TEST_CHECK(index.Parse(file.GetData(), file.GetSize(), 0, s_rgwVideoStreams, 2) == S_OK);
+    ASF_TEST_CHECK(index.IsEmpty());
+
+    ASF_TEST_CHECK(index.Parse(file.GetData(), file.GetSize(), TEST_PACKET_SIZE, s_rgwVideoStreams, 1) == S_OK);
+    ASF_TEST_CHECK(index.HasIndex(TEST_VIDEO_STREAM));
+    ASF_TEST_CHECK(!index.HasIndex(TEST_SECOND_VIDEO));
+}
+
+//The most precise index type wins; between equal types, the Index
+//Object wins over the Simple Index in either order
+static void TestPrecedence()
+{
+    const DWORD rgdwPackets[] = { 1, 2, 3 };
+    const DWORD rgdwOffsets[] = { 100, 200, 300 };
+    const TEST_INDEX_BLOCK block = { 0, rgdwOffsets, 3 };
+
+    CASFIndexReader index;
+    QWORD cbOffset = 0;
+
+    {
+        CASFTestWriter file;
+
+        WriteSimpleIndex(file, rgdwPackets, 3);
+        WriteIndex(file, TEST_VIDEO_STREAM, ASF_INDEX_NEAREST_PAST_CLEANPOINT, &block, 1);
+
+        ASF_TEST_CHECK(index.Parse(file.GetData(), file.GetSize(), TEST_PACKET_SIZE, s_rgwVideoStreams, 1) == S_OK);
+        ASF_TEST_CHECK(index.Lookup(TEST_VIDEO_STREAM, 0, &cbOffset, NULL, NULL) == S_OK);
+        ASF_TEST_CHECK(cbOffset == 100);
+    }
+
+    {
+        CASFTestWriter file;
+
+        WriteIndex(file, TEST_VIDEO_STREAM, ASF_INDEX_NEAREST_PAST_CLEANPOINT, &block, 1);
+        WriteSimpleIndex(file, rgdwPackets, 3);
+
+        ASF_TEST_CHECK(index.Parse(file.GetData(), file.GetSize(), TEST_PACKET_SIZE, s_rgwVideoStreams, 1) == S_OK);
+        ASF_TEST_CHECK(index.Lookup(TEST_VIDEO_STREAM, 0, &cbOffset, NULL, NULL) == S_OK);
+        ASF_TEST_CHECK(cbOffset == 100);
+    }
+
+    {
+        //A data packet index is less precise than the Simple Index
+        CASFTestWriter file;
+        const ASF_STREAM_INDEX* pStreamIndex = NULL;
+
+        WriteIndex(file, TEST_VIDEO_STREAM, ASF_INDEX_NEAREST_PAST_DATA_PACKET, &block, 1);
+        WriteSimpleIndex(file, rgdwPackets, 3);
+        WriteIndex(file, TEST_VIDEO_STREAM, ASF_INDEX_NEAREST_PAST_MEDIA_OBJECT, &block, 1);
+
+        ASF_TEST_CHECK(index.Parse(file.GetData(), file.GetSize(), TEST_PACKET_SIZE, s_rgwVideoStreams, 1) == S_OK);
+        ASF_TEST_CHECK(index.Lookup(TEST_VIDEO_STREAM, 0, &cbOffset, NULL, NULL) == S_OK);
+        ASF_TEST_CHECK(cbOffset == TEST_PACKET_SIZE);
+
+        ASF_TEST_CHECK(index.GetStreamIndex(TEST_VIDEO_STREAM, &pStreamIndex) == S_OK);
+        ASF_TEST_CHECK(pStreamIndex && (pStreamIndex->wIndexType == ASF_INDEX_NEAREST_PAST_CLEANPOINT));
+    }
+
+    {
+        //Invalid stream numbers and index types are skipped
+        CASFTestWriter file;
+
+        WriteIndex(file, 0, ASF_INDEX_NEAREST_PAST_CLEANPOINT, &block, 1);
+        WriteIndex(file, ASF_MAX_STREAMS, ASF_INDEX_NEAREST_PAST_CLEANPOINT, &block, 1);
+        WriteIndex(file, TEST_AUDIO_STREAM, 4, &block, 1);
+
+        ASF_TEST_CHECK(index.Parse(file.GetData(), file.GetSize(), TEST_PACKET_SIZE, NULL, 0) == S_OK);
+        ASF_TEST_CHECK(index.IsEmpty());
+    }
+}
+
+//An object cut off by the end of the file ends the parse and keeps the
+//indexes before it; an object whose counts run past its own size fails
+//the whole parse
+static void TestTruncated()
+{
+    const DWORD rgdwPackets[] = { 1, 2, 3 };
+    const DWORD rgdwOffsets[] = { 100, 200, 300 };
+    const TEST_INDEX_BLOCK block = { 0, rgdwOffsets, 3 };
+
+    CASFIndexReader index;
+
+    {
+        CASFTestWriter file;
+
+        WriteSimpleIndex(file, rgdwPackets, 3);
+        WriteIndex(file, TEST_AUDIO_STREAM, ASF_INDEX_NEAREST_PAST_CLEANPOINT, &block, 1);
+
+        ASF_TEST_CHECK(index.Parse(file.GetData(), file.GetSize() - 1, TEST_PACKET_SIZE, s_rgwVideoStreams, 1) == S_OK);
+        ASF_TEST_CHECK(index.HasIndex(TEST_VIDEO_STREAM));
+        ASF_TEST_CHECK(!index.HasIndex(TEST_AUDIO_STREAM));
+
+        //Less than an object header
+        ASF_TEST_CHECK(index.Parse(file.GetData(), ASF_OBJECT_HEADER_SIZE - 1, TEST_PACKET_SIZE, s_rgwVideoStreams, 1) == S_OK);
+        ASF_TEST_CHECK(index.IsEmpty());
+    }
+
+    {
+        //A Simple Index with more entries than it holds
+        CASFTestWriter file;
+
+        WriteIndex(file, TEST_AUDIO_STREAM, ASF_INDEX_NEAREST_PAST_CLEANPOINT, &block, 1);
+        size_t cbSimple = file.GetSize();
+        WriteSimpleIndex(file, rgdwPackets, 3);
+        file.PatchDWord(cbSimple + 52, 4);
+
+        ASF_TEST_CHECK(index.Parse(file.GetData(), file.GetSize(), TEST_PACKET_SIZE, s_rgwVideoStreams, 1) == MF_E_ASF_INVALIDDATA);
+        ASF_TEST_CHECK(index.IsEmpty());
+    }
+
+    {
+        //An Index Object block with more entries than it holds
+        CASFTestWriter file;
+
+        WriteIndex(file, TEST_AUDIO_STREAM, ASF_INDEX_NEAREST_PAST_CLEANPOINT, &block, 1);
+        file.PatchDWord(ASF_INDEX_HEADER_SIZE + ASF_INDEX_SPECIFIER_SIZE, 4);
+
+        ASF_TEST_CHECK(index.Parse(file.GetData(), file.GetSize(), TEST_PACKET_SIZE, NULL, 0) == MF_E_ASF_INVALIDDATA);
+        ASF_TEST_CHECK(index.IsEmpty());
+
+        //More blocks than it holds
+        file.PatchDWord(ASF_INDEX_HEADER_SIZE + ASF_INDEX_SPECIFIER_SIZE, 3);
+        file.PatchDWord(30, 2);
+
+        ASF_TEST_CHECK(index.Parse(file.GetData(), file.GetSize(), TEST_PACKET_SIZE, NULL, 0) == MF_E_ASF_INVALIDDATA);
+        ASF_TEST_CHECK(index.IsEmpty());
+    }
+
+    ASF_TEST_CHECK(index.Parse(NULL, 0, TEST_PACKET_SIZE, NULL, 0) == S_OK);
+    ASF_TEST_CHECK(index.Parse(NULL, 1, TEST_PACKET_SIZE, NULL, 0) == E_POINTER);
+}
+
+int main()
+{
+    TestIndexBlocks();
+    TestSimpleIndex();
+    TestPrecedence();
+    TestTruncated();
+
+    return ASF_TEST_RESULT();
+}
@@ -0,0 +1,343 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// LargeFileTest.cpp : Seeks and reads past 4 GB in a sparse ASF file.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "ASFReader.h"
+#include "ASFTestData.h"
+
+//80 packets of 64 MB make a Data Object of 5 GB. Only the packet
+//headers and payloads are written; the padding is left as holes.
+#define TEST_PACKET_SIZE        0x04000000
+#define TEST_PACKET_COUNT       80
+#define TEST_PREROLL            3000        // Milliseconds
+#define TEST_OBJECT_INTERVAL    1000        // Milliseconds between objects of a stream
+
+#define TEST_VIDEO_STREAM       1
+#define TEST_AUDIO_STREAM       2
+
+//First packet past 4 GB
+#define TEST_FIRST_HIGH_PACKET  64
+
+//Replicated data BYTE, offset DWORD, object number BYTE, stream number BYTE
+#define TEST_PROPERTY_FLAGS     0x5D
+
+//Offset of the padding length in a packet: 3 bytes of error correction
+//data, the flags and the property flags
+#define TEST_PADDING_FIELD      5
+
+#ifdef _WIN32
+static const ASF_PATH_CHAR s_szTestFile[] = L"LargeFileTest.asf";
+#else
+static const ASF_PATH_CHAR s_szTestFile[] = "LargeFileTest.asf";
+#endif
+
+static FILE* OpenTestFile()
+{
+#ifdef _WIN32
+    FILE* pFile = NULL;
+    return (_wfopen_s(&pFile, s_szTestFile, L"wb") == 0) ? pFile : NULL;
+#else
+    return fopen(s_szTestFile, "wb");
+#endif
+}
+
+static BOOL WriteAt(FILE* pFile, QWORD cbOffset, const CASFTestWriter& data)
+{
+#ifdef _WIN32
+    if (_fseeki64(pFile, (__int64)cbOffset, SEEK_SET) != 0)
+#else
+    if (fseeko(pFile, (off_t)cbOffset, SEEK_SET) != 0)
+#endif
+    {
+        return FALSE;
+    }
+
+    return (fwrite(data.GetData(), 1, data.GetSize(), pFile) == data.GetSize());
+}
+
+//Object i of both streams is in packet i, which is sent at the time of
+//the object without the preroll. The data of each object holds the
+//packet number.
+static void WriteTestPacketAt(CASFTestWriter& packet, DWORD iPacket)
+{
+    const DWORD dwSendTime = iPacket * TEST_OBJECT_INTERVAL;
+
+    BYTE rgbData[8];
+
+    for (DWORD i = 0; i < sizeof(rgbData); i++)
+    {
+        rgbData[i] = (BYTE)(iPacket + i);
+    }
+
+    ASF_TEST_PAYLOAD rgPayloads[] =
+    {
+        {
+            ASF_PAYLOAD_KEY_FRAME | TEST_VIDEO_STREAM, iPacket, 0, 8, sizeof(rgbData),
+            TEST_PREROLL + dwSendTime, rgbData, sizeof(rgbData)
+        },
+        {
+            TEST_AUDIO_STREAM, iPacket, 0, 8, sizeof(rgbData),
+            TEST_PREROLL + dwSendTime + TEST_OBJECT_INTERVAL / 2, rgbData, sizeof(rgbData)
+        },
+    };
+
+    //Padding DWORD, payload lengths WORD
+    ASF_TEST_PACKET header =
+    {
+        2, ASF_PACKET_MULTIPLE_PAYLOADS | (3 << ASF_PADDING_LENGTH_TYPE_SHIFT), TEST_PROPERTY_FLAGS, 2,
+        0, 0, dwSendTime, TEST_OBJECT_INTERVAL
+    };
+
+    packet.Clear();
+    WriteTestPacket(packet, header, rgPayloads, 2);
+
+    //The rest of the packet is padding
+    packet.PatchLengthType(TEST_PADDING_FIELD, 3, TEST_PACKET_SIZE - (DWORD)packet.GetSize());
+}
+
+//Simple Index Object with one entry per second for the video stream
+static void WriteTestSimpleIndex(CASFTestWriter& file)
+{
+    CASFTestWriter body;
+
+    body.WriteGUID(ASF_TEST_FILE_ID);
+    body.WriteQWord((QWORD)TEST_OBJECT_INTERVAL * 10000);
+    body.WriteDWord(1);                         // Maximum Packet Count
+    body.WriteDWord(TEST_PACKET_COUNT);
+
+    for (DWORD i = 0; i < TEST_PACKET_COUNT; i++)
+    {
+        body.WriteDWord(i);
+        body.WriteWord(1);
+    }
+
+    file.WriteObject(ASF_Simple_Index_Object, body);
+}
+
+static BOOL WriteLargeFile(QWORD* pcbDataOffset)
+{
+    CASFTestWriter children, file, packet, index;
+
+    WriteTestFileProperties(children, TEST_PACKET_SIZE, TEST_PACKET_COUNT, (QWORD)TEST_PACKET_COUNT * TEST_OBJECT_INTERVAL * 10000, TEST_PREROLL);
+    WriteTestStreamProperties(children, TEST_VIDEO_STREAM, ASF_Video_Media, 40);
+    WriteTestStreamProperties(children, TEST_AUDIO_STREAM, ASF_Audio_Media, 18);
+
+    WriteTestHeaderObject(file, children, 3);
+    WriteTestDataObjectHeader(file, TEST_PACKET_SIZE, TEST_PACKET_COUNT);
+
+    const QWORD cbDataOffset = file.GetSize();
+
+    WriteTestSimpleIndex(index);
+
+    FILE* pFile = OpenTestFile();
+
+    if (!pFile)
+    {
+        return FALSE;
+    }
+
+    BOOL fWritten = WriteAt(pFile, 0, file);
+
+    for (DWORD i = 0; fWritten && (i < TEST_PACKET_COUNT); i++)
+    {
+        WriteTestPacketAt(packet, i);
+        fWritten = WriteAt(pFile, cbDataOffset + (QWORD)i * TEST_PACKET_SIZE, packet);
+    }
+
+    if (fWritten)
+    {
+        fWritten = WriteAt(pFile, cbDataOffset + (QWORD)TEST_PACKET_COUNT * TEST_PACKET_SIZE, index);
+    }
+
+    fWritten = (fclose(pFile) == 0) && fWritten;
+
+    *pcbDataOffset = cbDataOffset;
+
+    return fWritten;
+}
+
+
+//Checks every sample of a generation against the packet it comes from
+class CTestCallback : public IASFReaderCallback
+{
+public:
+
+    CTestCallback(QWORD cbDataOffset, DWORD iFirstPacket)
+    :   m_cbDataOffset (cbDataOffset),
+        m_iNextPacket (iFirstPacket)
+    {
+    }
+
+    HRESULT OnSample(const ASF_READER_SAMPLE& sample)
+    {
+        const DWORD iPacket = m_iNextPacket++;
+
+        ASF_TEST_CHECK(sample.wStreamNumber == TEST_VIDEO_STREAM);
+        ASF_TEST_CHECK(sample.dwMediaObjectNumber == (iPacket & 0xFF));
+        ASF_TEST_CHECK(sample.hnsTime == (MFTIME)iPacket * TEST_OBJECT_INTERVAL * 10000);
+        ASF_TEST_CHECK(sample.cbPacketOffset == m_cbDataOffset + (QWORD)iPacket * TEST_PACKET_SIZE);
+        ASF_TEST_CHECK(sample.cbData == 8);
+        ASF_TEST_CHECK((sample.cbData == 8) && (sample.pData[0] == (BYTE)iPacket) && (sample.pData[7] == (BYTE)(iPacket + 7)));
+
+        return S_OK;
+    }
+
+    DWORD GetNextPacket() const
+    {
+        return m_iNextPacket;
+    }
+
+private:
+
+    QWORD   m_cbDataOffset;
+    DWORD   m_iNextPacket;
+};
+
+//The Simple Index maps packet numbers to offsets past 4 GB
+static void TestIndexedSeek(CASFReader& reader)
+{
+    QWORD cbOffset = 0;
+    MFTIME hnsApprox = 0;
+
+    for (DWORD iPacket = TEST_FIRST_HIGH_PACKET - 2; iPacket < TEST_PACKET_COUNT; iPacket++)
+    {
+        MFTIME hnsTime = (MFTIME)iPacket * TEST_OBJECT_INTERVAL * 10000 + 5000000;
+
+        ASF_TEST_CHECK(reader.Seek(TEST_VIDEO_STREAM, hnsTime, &cbOffset, &hnsApprox) == S_OK);
+        ASF_TEST_CHECK(cbOffset == (QWORD)iPacket * TEST_PACKET_SIZE);
+        ASF_TEST_CHECK(hnsApprox == (MFTIME)iPacket * TEST_OBJECT_INTERVAL * 10000);
+    }
+
+    ASF_TEST_CHECK(cbOffset > 0xFFFFFFFFULL);
+}
+
+//The index reader on its own, on the index object in the mapping
+static void TestIndexReader(const BYTE* pIndex, QWORD cbIndex)
+{
+    CASFIndexReader index;
+    const WORD wVideoStream = TEST_VIDEO_STREAM;
+
+    QWORD cbOffset = 0, cbNextOffset = 0;
+    DWORD dwEntryTime = 0;
+
+    ASF_TEST_CHECK(index.Parse(pIndex, cbIndex, TEST_PACKET_SIZE, &wVideoStream, 1) == S_OK);
+    ASF_TEST_CHECK(index.HasIndex(TEST_VIDEO_STREAM));
+
+    ASF_TEST_CHECK(index.Lookup(TEST_VIDEO_STREAM, 75 * TEST_OBJECT_INTERVAL, &cbOffset, &cbNextOffset, &dwEntryTime) == S_OK);
+    ASF_TEST_CHECK(cbOffset == 75ULL * TEST_PACKET_SIZE);
+    ASF_TEST_CHECK(cbNextOffset == 76ULL * TEST_PACKET_SIZE);
+    ASF_TEST_CHECK(dwEntryTime == 75 * TEST_OBJECT_INTERVAL);
+
+    ASF_TEST_CHECK(index.Lookup(TEST_VIDEO_STREAM, MAXDWORD, &cbOffset, &cbNextOffset, &dwEntryTime) == S_OK);
+    ASF_TEST_CHECK(cbOffset == (QWORD)(TEST_PACKET_COUNT - 1) * TEST_PACKET_SIZE);
+    ASF_TEST_CHECK(cbNextOffset == ASF_INDEX_NO_OFFSET);
+}
+
+//The exact packet search, through the reader and on its own
+static void TestExactSeek(CASFReader& reader, const BYTE* pPackets)
+{
+    CASFSeekEngine engine;
+    QWORD iPacket = 0, iSendBoundary = 0;
+    QWORD cbOffset = 0;
+
+    //The audio stream has no index
+    for (DWORD i = TEST_FIRST_HIGH_PACKET - 2; i < TEST_PACKET_COUNT; i++)
+    {
+        MFTIME hnsTime = (MFTIME)i * TEST_OBJECT_INTERVAL * 10000 + 5000000;
+
+        ASF_TEST_CHECK(reader.Seek(TEST_AUDIO_STREAM, hnsTime, &cbOffset, NULL) == S_OK);
+        ASF_TEST_CHECK(cbOffset == (QWORD)i * TEST_PACKET_SIZE);
+    }
+
+    ASF_TEST_CHECK(engine.Initialize(pPackets, TEST_PACKET_COUNT, TEST_PACKET_SIZE, TEST_PREROLL) == S_OK);
+
+    ASF_TEST_CHECK(engine.FindPacket(TEST_PREROLL + 70 * TEST_OBJECT_INTERVAL, TEST_VIDEO_STREAM, &iPacket, &iSendBoundary) == S_OK);
+    ASF_TEST_CHECK(iPacket == 70);
+    ASF_TEST_CHECK(iSendBoundary == 74);
+    ASF_TEST_CHECK(iPacket * TEST_PACKET_SIZE > 0xFFFFFFFFULL);
+
+    ASF_TEST_CHECK(engine.FindSendBoundary(MAXDWORD, &iSendBoundary) == S_OK);
+    ASF_TEST_CHECK(iSendBoundary == TEST_PACKET_COUNT);
+}
+
+//Demuxing from a seek past 4 GB to the end of the Data Object, in
+//reads of one packet each
+static void TestGenerate(CASFReader& reader, QWORD cbDataOffset)
+{
+    const DWORD iFirstPacket = 70;
+
+    CTestCallback callback(cbDataOffset, iFirstPacket);
+    ASF_GENERATE_PROGRESS progress;
+
+    ASF_TEST_CHECK(reader.GenerateSamples(
+        TEST_VIDEO_STREAM,
+        (MFTIME)iFirstPacket * TEST_OBJECT_INTERVAL * 10000,
+        0,
+        0,
+        &callback
+        ) == S_OK);
+
+    ASF_TEST_CHECK(callback.GetNextPacket() == TEST_PACKET_COUNT);
+
+    reader.GetGenerateProgress(&progress);
+    ASF_TEST_CHECK(progress.cSamples == TEST_PACKET_COUNT - iFirstPacket);
+    ASF_TEST_CHECK(progress.cbRead == (QWORD)(TEST_PACKET_COUNT - iFirstPacket) * TEST_PACKET_SIZE);
+}
+
+int main()
+{
+    //A 5 GB mapping needs a 64-bit address space
+    if (sizeof(void*) < 8)
+    {
+        printf("skipped: needs a 64-bit build\n");
+        return 0;
+    }
+
+    QWORD cbDataOffset = 0;
+
+    if (!WriteLargeFile(&cbDataOffset))
+    {
+        DeleteTestFile(s_szTestFile);
+        printf("skipped: cannot write the test file\n");
+        return 0;
+    }
+
+    CASFReader reader;
+    CMappedFile file;
+    FILE_PROPERTIES_OBJECT fileInfo;
+
+    const QWORD cbData = (QWORD)TEST_PACKET_COUNT * TEST_PACKET_SIZE;
+
+    ASF_TEST_CHECK(reader.Open(s_szTestFile) == S_OK);
+    ASF_TEST_CHECK(reader.GetFileProperties(&fileInfo) == S_OK);
+    ASF_TEST_CHECK(fileInfo.cbMaxPacketSize == TEST_PACKET_SIZE);
+
+    ASF_TEST_CHECK(file.Open(s_szTestFile) == S_OK);
+    ASF_TEST_CHECK(file.GetSize() > cbDataOffset + cbData);
+
+    if (file.IsMapped() && (file.GetSize() > cbDataOffset + cbData))
+    {
+        TestIndexedSeek(reader);
+        TestIndexReader(file.GetData() + cbDataOffset + cbData, file.GetSize() - cbDataOffset - cbData);
+        TestExactSeek(reader, file.GetData() + cbDataOffset);
+        TestGenerate(reader, cbDataOffset);
+    }
+
+    file.Close();
+    reader.Close();
+
+    DeleteTestFile(s_szTestFile);
+
+    return ASF_TEST_RESULT();
+}
@@ -0,0 +1,192 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// MetadataCacheTest.cpp : CASFMetadataCache store and lookup tests.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "ASFMetadataCache.h"
+#include "ASFTestData.h"
+
+#define TEST_PACKET_SIZE    512
+#define TEST_PACKET_COUNT   4
+#define TEST_INDEX_SIZE     100
+
+#ifdef _WIN32
+static const ASF_PATH_CHAR s_szCacheFile[] = L"MetadataCacheTest.cache";
+static const ASF_PATH_CHAR s_szTempFile[] = L"MetadataCacheTest.cache.tmp";
+static const ASF_PATH_CHAR s_szMediaFileA[] = L"MetadataCacheTestA.asf";
+static const ASF_PATH_CHAR s_szMediaFileB[] = L"MetadataCacheTestB.asf";
+#else
+static const ASF_PATH_CHAR s_szCacheFile[] = "MetadataCacheTest.cache";
+static const ASF_PATH_CHAR s_szTempFile[] = "MetadataCacheTest.cache.tmp";
+static const ASF_PATH_CHAR s_szMediaFileA[] = "MetadataCacheTestA.asf";
+static const ASF_PATH_CHAR s_szMediaFileB[] = "MetadataCacheTestB.asf";
+#endif
+
+//Header, packets left as zeros and an index area of TEST_INDEX_SIZE
+//bytes. The streams depend on cStreams.
+static void BuildTestFile(CASFTestWriter& file, DWORD cStreams)
+{
+    CASFTestWriter children;
+
+    WriteTestFileProperties(children, TEST_PACKET_SIZE, TEST_PACKET_COUNT, 40000000, 3000);
+
+    for (DWORD i = 0; i < cStreams; i++)
+    {
+        WriteTestStreamProperties(children, (WORD)(i + 1), (i == 0) ? ASF_Video_Media : ASF_Audio_Media, 18);
+    }
+
+    WriteTestHeaderObject(file, children, 1 + cStreams);
+    WriteTestDataObjectHeader(file, TEST_PACKET_SIZE, TEST_PACKET_COUNT);
+
+    for (DWORD i = 0; i < TEST_PACKET_COUNT * TEST_PACKET_SIZE + TEST_INDEX_SIZE; i++)
+    {
+        file.WriteByte(0);
+    }
+}
+
+static BOOL GetTestMetadata(const CASFTestWriter& file, ASF_FILE_METADATA* pMetadata)
+{
+    CASFHeaderParser parser;
+
+    if (FAILED(parser.Parse(file.GetData(), file.GetSize())))
+    {
+        return FALSE;
+    }
+
+    return SUCCEEDED(CASFMetadataCache::GetHeaderMetadata(parser, file.GetSize(), pMetadata));
+}
+
+static void CheckMetadata(const ASF_FILE_METADATA& metadata, const ASF_FILE_METADATA& expected)
+{
+    ASF_TEST_CHECK(metadata.fileInfo.guidFileID == expected.fileInfo.guidFileID);
+    ASF_TEST_CHECK(metadata.fileInfo.cbMaxPacketSize == expected.fileInfo.cbMaxPacketSize);
+    ASF_TEST_CHECK(metadata.fileInfo.hnspreroll == expected.fileInfo.hnspreroll);
+    ASF_TEST_CHECK(metadata.fileInfo.hnsPlayDuration == expected.fileInfo.hnsPlayDuration);
+    ASF_TEST_CHECK(metadata.cbDataOffset == expected.cbDataOffset);
+    ASF_TEST_CHECK(metadata.cbDataLength == expected.cbDataLength);
+    ASF_TEST_CHECK(metadata.cbIndexOffset == expected.cbIndexOffset);
+    ASF_TEST_CHECK(metadata.cbIndexLength == expected.cbIndexLength);
+    ASF_TEST_CHECK(metadata.cStreams == expected.cStreams);
+
+    for (DWORD i = 0; (i < metadata.cStreams) && (i < expected.cStreams); i++)
+    {
+        ASF_TEST_CHECK(metadata.streams[i].wStreamNumber == expected.streams[i].wStreamNumber);
+        ASF_TEST_CHECK(metadata.streams[i].guidStreamType == expected.streams[i].guidStreamType);
+        ASF_TEST_CHECK(metadata.streams[i].guidMajorType == expected.streams[i].guidMajorType);
+    }
+}
+
+//The metadata of the test files themselves
+static void TestHeaderMetadata(const ASF_FILE_METADATA& metadata, DWORD cStreams)
+{
+    ASF_TEST_CHECK(metadata.fileInfo.cbMaxPacketSize == TEST_PACKET_SIZE);
+    ASF_TEST_CHECK(metadata.cbDataLength == TEST_PACKET_COUNT * TEST_PACKET_SIZE);
+    ASF_TEST_CHECK(metadata.cbIndexOffset == metadata.cbDataOffset + metadata.cbDataLength);
+    ASF_TEST_CHECK(metadata.cbIndexLength == TEST_INDEX_SIZE);
+    ASF_TEST_CHECK(metadata.cStreams == cStreams);
+}
+
+int main()
+{
+    CASFTestWriter fileA, fileB;
+    ASF_FILE_METADATA metadataA, metadataB, metadata;
+
+    DeleteTestFile(s_szCacheFile);
+    DeleteTestFile(s_szTempFile);
+
+    BuildTestFile(fileA, 2);
+    BuildTestFile(fileB, 1);
+
+    if (!WriteTestFile(s_szMediaFileA, fileA) || !WriteTestFile(s_szMediaFileB, fileB))
+    {
+        DeleteTestFile(s_szMediaFileA);
+        DeleteTestFile(s_szMediaFileB);
+        printf("skipped: cannot write the test files\n");
+        return 0;
+    }
+
+    ASF_TEST_CHECK(GetTestMetadata(fileA, &metadataA));
+    ASF_TEST_CHECK(GetTestMetadata(fileB, &metadataB));
+    TestHeaderMetadata(metadataA, 2);
+    TestHeaderMetadata(metadataB, 1);
+
+    metadataA.streams[0].guidMajorType = ASF_Video_Media;
+
+    {
+        CASFMetadataCache cache;
+
+        ASF_TEST_CHECK(cache.Store(s_szMediaFileA, metadataA) == MF_E_NOT_INITIALIZED);
+
+        //A missing cache is empty and has no mapping
+        ASF_TEST_CHECK(cache.Open(s_szCacheFile) == S_OK);
+        ASF_TEST_CHECK(cache.Lookup(s_szMediaFileA, &metadata) == MF_E_NOT_FOUND);
+
+        ASF_TEST_CHECK(cache.Store(s_szMediaFileA, metadataA) == S_OK);
+        ASF_TEST_CHECK(cache.Lookup(s_szMediaFileA, &metadata) == S_OK);
+        CheckMetadata(metadata, metadataA);
+
+        ASF_TEST_CHECK(cache.Store(s_szMediaFileB, metadataB) == S_OK);
+        ASF_TEST_CHECK(cache.Lookup(s_szMediaFileB, &metadata) == S_OK);
+        CheckMetadata(metadata, metadataB);
+
+        //Storing a file again replaces its record
+        metadataA.streams[1].guidMajorType = ASF_Audio_Media;
+
+        ASF_TEST_CHECK(cache.Store(s_szMediaFileA, metadataA) == S_OK);
+        ASF_TEST_CHECK(cache.Lookup(s_szMediaFileA, &metadata) == S_OK);
+        CheckMetadata(metadata, metadataA);
+    }
+
+    {
+        //The records are read back from the cache file
+        CASFMetadataCache cache;
+
+        ASF_TEST_CHECK(cache.Open(s_szCacheFile) == S_OK);
+
+        ASF_TEST_CHECK(cache.Lookup(s_szMediaFileA, &metadata) == S_OK);
+        CheckMetadata(metadata, metadataA);
+
+        ASF_TEST_CHECK(cache.Lookup(s_szMediaFileB, &metadata) == S_OK);
+        CheckMetadata(metadata, metadataB);
+
+        //A file that changed size no longer matches its record
+        fileB.WriteByte(0);
+        ASF_TEST_CHECK(WriteTestFile(s_szMediaFileB, fileB));
+        ASF_TEST_CHECK(cache.Lookup(s_szMediaFileB, &metadata) == MF_E_NOT_FOUND);
+
+        ASF_TEST_CHECK(cache.Lookup(s_szMediaFileA, &metadata) == S_OK);
+    }
+
+    {
+        //A cache file that is not a cache is empty and is replaced
+        CASFTestWriter junk;
+
+        junk.WriteDWord(0x12345678);
+        ASF_TEST_CHECK(WriteTestFile(s_szCacheFile, junk));
+
+        CASFMetadataCache cache;
+
+        ASF_TEST_CHECK(cache.Open(s_szCacheFile) == S_OK);
+        ASF_TEST_CHECK(cache.Lookup(s_szMediaFileA, &metadata) == MF_E_NOT_FOUND);
+
+        ASF_TEST_CHECK(cache.Store(s_szMediaFileA, metadataA) == S_OK);
+        ASF_TEST_CHECK(cache.Lookup(s_szMediaFileA, &metadata) == S_OK);
+        CheckMetadata(metadata, metadataA);
+    }
+
+    DeleteTestFile(s_szCacheFile);
+    DeleteTestFile(s_szMediaFileA);
+    DeleteTestFile(s_szMediaFileB);
+
+    return ASF_TEST_RESULT();
+}
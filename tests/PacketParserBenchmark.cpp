@@ -0,0 +1,132 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// PacketParserBenchmark.cpp : Packet parsing rate of the generic and the
+// specialized parser paths.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include "ASFPacketParser.h"
+#include "ASFThread.h"
+#include "ASFTestData.h"
+
+#define BENCH_PACKET_SIZE       3200
+#define BENCH_PACKETS           1024
+#define BENCH_DEFAULT_ROUNDS    200
+
+//Replicated data BYTE, offset DWORD, object number BYTE, stream number BYTE
+#define BENCH_PROPERTY_FLAGS    0x5D
+
+//Packets of one layout, back to back
+static void WritePackets(CASFTestWriter& packets, BYTE bFlags, DWORD cPayloadsPerPacket)
+{
+    static const BYTE rgbData[BENCH_PACKET_SIZE] = { 0 };
+
+    ASF_TEST_PAYLOAD rgPayloads[16];
+
+    //Payload headers are 15 bytes, plus a WORD length with multiple payloads
+    const DWORD cbPayload = (BENCH_PACKET_SIZE - 64) / cPayloadsPerPacket - 17;
+
+    for (DWORD i = 0; i < BENCH_PACKETS; i++)
+    {
+        for (DWORD j = 0; j < cPayloadsPerPacket; j++)
+        {
+            ASF_TEST_PAYLOAD payload = { (BYTE)(1 + j % 2), i * cPayloadsPerPacket + j, 0, 8, cbPayload, i * 40, rgbData, cbPayload };
+            rgPayloads[j] = payload;
+        }
+
+        ASF_TEST_PACKET header = { 2, bFlags, BENCH_PROPERTY_FLAGS, 2, BENCH_PACKET_SIZE, 0, i * 40, 40 };
+
+        WriteTestPacket(packets, header, rgPayloads, cPayloadsPerPacket);
+    }
+}
+
+//Returns the time per packet in nanoseconds
+static double ParsePackets(const CASFTestWriter& packets, BOOL fSpecialized, DWORD cRounds, QWORD* pcPayloads)
+{
+    CASFPacketParser parser;
+    ASF_PAYLOAD_INFO payload;
+
+    (void)parser.Initialize(BENCH_PACKET_SIZE);
+    parser.UseSpecializedPaths(fSpecialized);
+
+    QWORD cPayloads = 0;
+    LONGLONG llStart = CASFThread::GetTimestamp();
+
+    for (DWORD iRound = 0; iRound < cRounds; iRound++)
+    {
+        for (DWORD i = 0; i < BENCH_PACKETS; i++)
+        {
+            if (FAILED(parser.ParsePacket(packets.GetData() + i * BENCH_PACKET_SIZE, BENCH_PACKET_SIZE, NULL)))
+            {
+                continue;
+            }
+
+            while (parser.GetNextPayload(&payload) == S_OK)
+            {
+                cPayloads++;
+            }
+        }
+    }
+
+    LONGLONG hnsElapsed = CASFThread::GetTimestamp() - llStart;
+
+    *pcPayloads = cPayloads;
+
+    return (double)hnsElapsed * 100.0 / ((double)cRounds * BENCH_PACKETS);
+}
+
+static void RunLayout(const char* szName, BYTE bFlags, DWORD cPayloadsPerPacket, DWORD cRounds)
+{
+    CASFTestWriter packets;
+    WritePackets(packets, bFlags, cPayloadsPerPacket);
+
+    QWORD cGeneric = 0, cSpecialized = 0;
+
+    //Warm up both paths once
+    (void)ParsePackets(packets, FALSE, 1, &cGeneric);
+    (void)ParsePackets(packets, TRUE, 1, &cSpecialized);
+
+    double nsGeneric = ParsePackets(packets, FALSE, cRounds, &cGeneric);
+    double nsSpecialized = ParsePackets(packets, TRUE, cRounds, &cSpecialized);
+
+    printf("%-22s generic %7.1f ns/packet, specialized %7.1f ns/packet, %.2fx\n",
+        szName,
+        nsGeneric,
+        nsSpecialized,
+        (nsSpecialized > 0) ? nsGeneric / nsSpecialized : 0.0);
+
+    //Both paths must have seen every payload
+    QWORD cExpected = (QWORD)cRounds * BENCH_PACKETS * cPayloadsPerPacket;
+
+    ASF_TEST_CHECK(cGeneric == cExpected);
+    ASF_TEST_CHECK(cSpecialized == cExpected);
+}
+
+//Usage: PacketParserBenchmark [rounds]
+//Timings are only meaningful in an optimized build, for example with
+//-DCMAKE_BUILD_TYPE=Release.
+int main(int argc, char* argv[])
+{
+    DWORD cRounds = (argc > 1) ? (DWORD)atoi(argv[1]) : BENCH_DEFAULT_ROUNDS;
+
+    if (cRounds == 0)
+    {
+        cRounds = 1;
+    }
+
+    const BYTE bPaddingWord = 2 << ASF_PADDING_LENGTH_TYPE_SHIFT;
+
+    RunLayout("single payload", bPaddingWord, 1, cRounds);
+    RunLayout("multiple payloads x4", ASF_PACKET_MULTIPLE_PAYLOADS | bPaddingWord, 4, cRounds);
+    RunLayout("multiple payloads x12", ASF_PACKET_MULTIPLE_PAYLOADS | bPaddingWord, 12, cRounds);
+
+    return ASF_TEST_RESULT();
+}
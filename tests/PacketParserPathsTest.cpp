@@ -0,0 +1,210 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// PacketParserPathsTest.cpp : Checks that the specialized packet and
+// payload parsers give the results of the generic ones.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "ASFPacketParser.h"
+#include "ASFTestData.h"
+
+//Largest number of payloads compared per packet
+#define TEST_MAX_PAYLOADS   8
+
+//Everything one path reports for a packet
+struct PARSE_RESULT
+{
+    HRESULT             hrPacket;
+    ASF_PACKET_INFO     info;
+    DWORD               cPayloads;
+    HRESULT             rghrPayload[TEST_MAX_PAYLOADS];
+    ASF_PAYLOAD_INFO    rgPayloads[TEST_MAX_PAYLOADS];
+    DWORD               cbParsed;
+};
+
+static void ParseAll(BOOL fSpecialized, const BYTE* pPacket, DWORD cbPacket, DWORD cbFixedPacket, PARSE_RESULT* pResult)
+{
+    CASFPacketParser parser;
+
+    (void)parser.Initialize(cbFixedPacket);
+    parser.UseSpecializedPaths(fSpecialized);
+
+    pResult->info = ASF_PACKET_INFO();
+    pResult->hrPacket = parser.ParsePacket(pPacket, cbPacket, &pResult->info);
+    pResult->cPayloads = 0;
+
+    if (SUCCEEDED(pResult->hrPacket))
+    {
+        while (pResult->cPayloads < TEST_MAX_PAYLOADS)
+        {
+            DWORD i = pResult->cPayloads++;
+
+            pResult->rgPayloads[i] = ASF_PAYLOAD_INFO();
+            pResult->rghrPayload[i] = parser.GetNextPayload(&pResult->rgPayloads[i]);
+
+            if (pResult->rghrPayload[i] != S_OK)
+            {
+                break;
+            }
+        }
+    }
+
+    pResult->cbParsed = parser.GetParseOffset();
+}
+
+static BOOL EqualPacketInfo(const ASF_PACKET_INFO& a, const ASF_PACKET_INFO& b)
+{
+    return (a.cbErrorCorrection == b.cbErrorCorrection) &&
+        (a.bLengthTypeFlags == b.bLengthTypeFlags) &&
+        (a.bPropertyFlags == b.bPropertyFlags) &&
+        (a.cbPacketLength == b.cbPacketLength) &&
+        (a.dwSequence == b.dwSequence) &&
+        (a.cbPadding == b.cbPadding) &&
+        (a.dwSendTime == b.dwSendTime) &&
+        (a.wDuration == b.wDuration) &&
+        (a.fMultiplePayloads == b.fMultiplePayloads) &&
+        (a.cPayloads == b.cPayloads);
+}
+
+static BOOL EqualPayloadInfo(const ASF_PAYLOAD_INFO& a, const ASF_PAYLOAD_INFO& b)
+{
+    return (a.bStreamNumber == b.bStreamNumber) &&
+        (a.fKeyFrame == b.fKeyFrame) &&
+        (a.fCompressed == b.fCompressed) &&
+        (a.dwMediaObjectNumber == b.dwMediaObjectNumber) &&
+        (a.dwOffsetIntoMediaObject == b.dwOffsetIntoMediaObject) &&
+        (a.cbMediaObjectSize == b.cbMediaObjectSize) &&
+        (a.dwPresentationTime == b.dwPresentationTime) &&
+        (a.pReplicatedData == b.pReplicatedData) &&
+        (a.cbReplicatedData == b.cbReplicatedData) &&
+        (a.pData == b.pData) &&
+        (a.cbData == b.cbData);
+}
+
+//Parses the packet, and every truncation of it, through both paths
+static void ComparePaths(const CASFTestWriter& packet, DWORD* pcCompared)
+{
+    const DWORD cbPacket = (DWORD)packet.GetSize();
+
+    PARSE_RESULT generic, specialized;
+
+    for (DWORD cbValid = cbPacket; cbValid + 64 > cbPacket; cbValid--)
+    {
+        ParseAll(FALSE, packet.GetData(), cbValid, cbPacket, &generic);
+        ParseAll(TRUE, packet.GetData(), cbValid, cbPacket, &specialized);
+
+        ASF_TEST_CHECK(generic.hrPacket == specialized.hrPacket);
+        ASF_TEST_CHECK(generic.cbParsed == specialized.cbParsed);
+
+        if (FAILED(generic.hrPacket) || (generic.hrPacket != specialized.hrPacket))
+        {
+            (*pcCompared)++;
+
+            if (cbValid == 0)
+            {
+                break;
+            }
+
+            continue;
+        }
+
+        ASF_TEST_CHECK(EqualPacketInfo(generic.info, specialized.info));
+        ASF_TEST_CHECK(generic.cPayloads == specialized.cPayloads);
+
+        for (DWORD i = 0; (i < generic.cPayloads) && (i < specialized.cPayloads); i++)
+        {
+            ASF_TEST_CHECK(generic.rghrPayload[i] == specialized.rghrPayload[i]);
+
+            if (generic.rghrPayload[i] == S_OK)
+            {
+                ASF_TEST_CHECK(EqualPayloadInfo(generic.rgPayloads[i], specialized.rgPayloads[i]));
+            }
+        }
+
+        (*pcCompared)++;
+
+        if (cbValid == 0)
+        {
+            break;
+        }
+    }
+}
+
+int main()
+{
+    //Two compressed sub-payloads
+    static const BYTE rgbCompressed[] = { 3, 'a', 'b', 'c', 2, 'd', 'e' };
+    static const BYTE rgbData[40] = { 0 };
+
+    DWORD cCompared = 0;
+    DWORD rgcPacketFlags[ASF_PACKET_FLAGS_COUNT] = { 0 };
+    DWORD rgcPayloadFlags[ASF_PAYLOAD_FLAGS_COUNT] = { 0 };
+
+    for (DWORD dwFlags = 0; dwFlags < ASF_PACKET_FLAGS_COUNT; dwFlags++)
+    {
+        const BOOL fMultiplePayloads = (dwFlags & ASF_PACKET_MULTIPLE_PAYLOADS) ? TRUE : FALSE;
+
+        for (DWORD dwProperty = 0; dwProperty <= ASF_PAYLOAD_FLAGS_MASK; dwProperty++)
+        {
+            //Zero with multiple payloads is only valid for a packet without payloads
+            for (DWORD dwPayloadLengthType = 0; dwPayloadLengthType <= (fMultiplePayloads ? 3u : 0u); dwPayloadLengthType++)
+            {
+                const BOOL fReplicated = ASF_LENGTH_TYPE(dwProperty, ASF_REPLICATED_LENGTH_TYPE_SHIFT) ? TRUE : FALSE;
+                const DWORD cPayloads = !fMultiplePayloads ? 1 : ((dwPayloadLengthType == 0) ? 0 : 3);
+
+                ASF_TEST_PAYLOAD rgPayloads[] =
+                {
+                    { 0x81, 0x01020304, 0x05060708, fReplicated ? 8u : 0u, 500, 9000, rgbData, 40 },
+                    { 0x02, 0x0A0B0C0D, 9100, fReplicated ? 1u : 0u, 0, 25, rgbCompressed, sizeof(rgbCompressed) },
+                    { 0x03, 0x11223344, 0x0000FFFF, fReplicated ? 12u : 0u, 7, 9200, rgbData, 7 },
+                };
+
+                ASF_TEST_PACKET header =
+                {
+                    2,
+                    (BYTE)dwFlags,
+                    (BYTE)(dwProperty | (1 << ASF_STREAM_NUMBER_LENGTH_TYPE_SHIFT)),
+                    dwPayloadLengthType,
+                    250,
+                    0x8899AABB,
+                    0x01020304,
+                    0x0506
+                };
+
+                CASFTestWriter packet;
+                WriteTestPacket(packet, header, rgPayloads, cPayloads);
+
+                ComparePaths(packet, &cCompared);
+
+                rgcPacketFlags[dwFlags]++;
+
+                if (cPayloads > 0)
+                {
+                    rgcPayloadFlags[dwProperty | (dwPayloadLengthType << ASF_PAYLOAD_FLAGS_LENGTH_TYPE_SHIFT)]++;
+                }
+            }
+        }
+    }
+
+    //Every specialization was compared
+    for (DWORD i = 0; i < ASF_PACKET_FLAGS_COUNT; i++)
+    {
+        ASF_TEST_CHECK(rgcPacketFlags[i] > 0);
+    }
+
+    for (DWORD i = 0; i < ASF_PAYLOAD_FLAGS_COUNT; i++)
+    {
+        ASF_TEST_CHECK(rgcPayloadFlags[i] > 0);
+    }
+
+    printf("%u packets compared\n", (unsigned)cCompared);
+
+    return ASF_TEST_RESULT();
+}
@@ -0,0 +1,467 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// PacketParserTest.cpp : CASFPacketParser tests on hand-built packets.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "ASFPacketParser.h"
+#include "ASFTestData.h"
+
+//Replicated data BYTE, offset DWORD, object number BYTE, stream number BYTE
+#define TEST_PROPERTY_FLAGS     0x5D
+
+//Padding length WORD
+#define TEST_PADDING_WORD       (2 << ASF_PADDING_LENGTH_TYPE_SHIFT)
+
+static const BYTE s_rgbData[] =
+{
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F,
+    0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F,
+    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F
+};
+
+//Value of a field as written with the length type
+static DWORD CutToLengthType(DWORD dwLengthType, DWORD dwValue)
+{
+    switch (dwLengthType)
+    {
+    case 1:
+        return dwValue & 0xFF;
+    case 2:
+        return dwValue & 0xFFFF;
+    case 3:
+        return dwValue;
+    }
+
+    return 0;
+}
+
+static ASF_TEST_PAYLOAD MakePayload(
+    BYTE bStreamNumber,
+    DWORD dwObjectNumber,
+    DWORD dwOffset,
+    DWORD cbReplicated,
+    DWORD cbObjectSize,
+    DWORD dwTime,
+    const BYTE* pData,
+    DWORD cbData
+    )
+{
+    ASF_TEST_PAYLOAD payload = { bStreamNumber, dwObjectNumber, dwOffset, cbReplicated, cbObjectSize, dwTime, pData, cbData };
+    return payload;
+}
+
+static ASF_TEST_PACKET MakePacket(DWORD cbErrorCorrectionData, BYTE bFlags, BYTE bPropertyFlags, DWORD dwPayloadLengthType, DWORD cbPacket)
+{
+    ASF_TEST_PACKET header = { cbErrorCorrectionData, bFlags, bPropertyFlags, dwPayloadLengthType, cbPacket, 0, 123456, 40 };
+    return header;
+}
+
+//Checks a parsed payload against the payload it was built from
+static void CheckPayload(const ASF_PAYLOAD_INFO& info, const ASF_TEST_PAYLOAD& payload, DWORD bPropertyFlags)
+{
+    const DWORD dwObjectNumberType = ASF_LENGTH_TYPE(bPropertyFlags, ASF_OBJECT_NUMBER_LENGTH_TYPE_SHIFT);
+    const DWORD dwOffsetType = ASF_LENGTH_TYPE(bPropertyFlags, ASF_OFFSET_LENGTH_TYPE_SHIFT);
+    const BOOL fFullReplicated = (payload.cbReplicated >= ASF_REPLICATED_DATA_MIN_SIZE);
+
+    ASF_TEST_CHECK(info.bStreamNumber == (payload.bStreamNumber & ASF_PAYLOAD_STREAM_NUMBER_MASK));
+    ASF_TEST_CHECK(info.fKeyFrame == ((payload.bStreamNumber & ASF_PAYLOAD_KEY_FRAME) ? TRUE : FALSE));
+    ASF_TEST_CHECK(!info.fCompressed);
+    ASF_TEST_CHECK(info.dwMediaObjectNumber == CutToLengthType(dwObjectNumberType, payload.dwMediaObjectNumber));
+    ASF_TEST_CHECK(info.dwOffsetIntoMediaObject == CutToLengthType(dwOffsetType, payload.dwOffset));
+    ASF_TEST_CHECK(info.cbReplicatedData == payload.cbReplicated);
+    ASF_TEST_CHECK(info.cbMediaObjectSize == (fFullReplicated ? payload.cbMediaObjectSize : 0));
+    ASF_TEST_CHECK(info.dwPresentationTime == (fFullReplicated ? payload.dwPresentationTime : 0));
+    ASF_TEST_CHECK(info.cbData == payload.cbData);
+    ASF_TEST_CHECK((info.cbData == 0) || (memcmp(info.pData, payload.pData, info.cbData) == 0));
+}
+
+static void TestSinglePayload()
+{
+    CASFTestWriter packet;
+    ASF_TEST_PACKET header = MakePacket(2, TEST_PADDING_WORD, TEST_PROPERTY_FLAGS, 0, 200);
+    ASF_TEST_PAYLOAD payload = MakePayload(ASF_PAYLOAD_KEY_FRAME | 2, 7, 0, 8, 50, 3500, s_rgbData, 50);
+
+    WriteTestPacket(packet, header, &payload, 1);
+    ASF_TEST_CHECK(packet.GetSize() == 200);
+
+    CASFPacketParser parser;
+    ASF_PACKET_INFO info;
+    ASF_PAYLOAD_INFO payloadInfo;
+
+    ASF_TEST_CHECK(parser.ParsePacket(packet.GetData(), 200, &info) == MF_E_NOT_INITIALIZED);
+    ASF_TEST_CHECK(parser.Initialize(200) == S_OK);
+    ASF_TEST_CHECK(parser.ParsePacket(packet.GetData(), 200, &info) == S_OK);
+
+    //EC flags + 2 bytes, flags, padding WORD, send time, duration; then
+    //stream, object number, offset, replicated length and data
+    const DWORD cbUsed = 3 + 2 + 2 + 6 + (1 + 1 + 4 + 1 + 8) + 50;
+
+    ASF_TEST_CHECK(info.cbErrorCorrection == 3);
+    ASF_TEST_CHECK(info.bLengthTypeFlags == TEST_PADDING_WORD);
+    ASF_TEST_CHECK(info.bPropertyFlags == TEST_PROPERTY_FLAGS);
+    ASF_TEST_CHECK(info.cbPacketLength == 200);
+    ASF_TEST_CHECK(info.cbPadding == 200 - cbUsed);
+    ASF_TEST_CHECK(info.dwSendTime == 123456);
+    ASF_TEST_CHECK(info.wDuration == 40);
+    ASF_TEST_CHECK(!info.fMultiplePayloads);
+    ASF_TEST_CHECK(info.cPayloads == 1);
+    ASF_TEST_CHECK(parser.GetPayloadsLeft() == 1);
+
+    ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_OK);
+    CheckPayload(payloadInfo, payload, TEST_PROPERTY_FLAGS);
+    ASF_TEST_CHECK(payloadInfo.pData == packet.GetData() + cbUsed - 50);
+
+    ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_FALSE);
+    ASF_TEST_CHECK(parser.GetPayloadsLeft() == 0);
+    ASF_TEST_CHECK(parser.GetParseOffset() == cbUsed);
+
+    //The packet header alone, without the info
+    ASF_TEST_CHECK(parser.ParsePacket(packet.GetData(), 200, NULL) == S_OK);
+    ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_OK);
+}
+
+static void TestMultiplePayloads()
+{
+    ASF_TEST_PAYLOAD rgPayloads[] =
+    {
+        MakePayload(ASF_PAYLOAD_KEY_FRAME | 1, 10, 0, 8, 20, 1000, s_rgbData, 20),
+        MakePayload(2, 3, 300, 8, 400, 1010, s_rgbData + 20, 17),
+        MakePayload(1, 11, 0, 8, 9, 1040, s_rgbData + 37, 9),
+    };
+
+    CASFTestWriter packet;
+    ASF_TEST_PACKET header = MakePacket(2, ASF_PACKET_MULTIPLE_PAYLOADS | TEST_PADDING_WORD, TEST_PROPERTY_FLAGS, 2, 256);
+
+    WriteTestPacket(packet, header, rgPayloads, 3);
+
+    CASFPacketParser parser;
+    ASF_PACKET_INFO info;
+    ASF_PAYLOAD_INFO payloadInfo;
+
+    ASF_TEST_CHECK(parser.Initialize(256) == S_OK);
+    ASF_TEST_CHECK(parser.ParsePacket(packet.GetData(), 256, &info) == S_OK);
+    ASF_TEST_CHECK(info.fMultiplePayloads);
+    ASF_TEST_CHECK(info.cPayloads == 3);
+
+    for (DWORD i = 0; i < 3; i++)
+    {
+        ASF_TEST_CHECK(parser.GetPayloadsLeft() == 3 - i);
+        ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_OK);
+        CheckPayload(payloadInfo, rgPayloads[i], TEST_PROPERTY_FLAGS);
+    }
+
+    ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_FALSE);
+
+    //The next packet starts over
+    ASF_TEST_CHECK(parser.ParsePacket(packet.GetData(), 256, &info) == S_OK);
+    ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_OK);
+    CheckPayload(payloadInfo, rgPayloads[0], TEST_PROPERTY_FLAGS);
+}
+
+//Every length type of every packet header and payload field
+static void TestLengthTypes()
+{
+    const DWORD dwSequence = 0x89ABCDEF;
+
+    CASFPacketParser parser;
+
+    for (DWORD dwFlags = 0; dwFlags < ASF_PACKET_FLAGS_COUNT; dwFlags++)
+    {
+        const BOOL fMultiplePayloads = (dwFlags & ASF_PACKET_MULTIPLE_PAYLOADS) ? TRUE : FALSE;
+
+        for (DWORD dwProperty = 0; dwProperty <= ASF_PAYLOAD_FLAGS_MASK; dwProperty++)
+        {
+            const DWORD cbReplicated = ASF_LENGTH_TYPE(dwProperty, ASF_REPLICATED_LENGTH_TYPE_SHIFT) ? 8 : 0;
+            const BYTE bPropertyFlags = (BYTE)(dwProperty | (1 << ASF_STREAM_NUMBER_LENGTH_TYPE_SHIFT));
+
+            ASF_TEST_PAYLOAD rgPayloads[] =
+            {
+                MakePayload(ASF_PAYLOAD_KEY_FRAME | 5, 0x12345678, 0x0F0E0D0C, cbReplicated, 0x11111, 0x22222, s_rgbData, 20),
+                MakePayload(6, 0x12345679, 0x0B0A0908, cbReplicated, 0x33333, 0x44444, s_rgbData + 20, 30),
+            };
+
+            for (DWORD dwPayloadLengthType = fMultiplePayloads ? 1 : 0; dwPayloadLengthType <= (fMultiplePayloads ? 3u : 0u); dwPayloadLengthType++)
+            {
+                const DWORD cPayloads = fMultiplePayloads ? 2 : 1;
+
+                CASFTestWriter packet;
+                ASF_TEST_PACKET header = MakePacket(2, (BYTE)dwFlags, bPropertyFlags, dwPayloadLengthType, 240);
+                header.dwSequence = dwSequence;
+
+                WriteTestPacket(packet, header, rgPayloads, cPayloads);
+
+                const DWORD cbPacket = (DWORD)packet.GetSize();
+                const DWORD dwPaddingType = ASF_LENGTH_TYPE(dwFlags, ASF_PADDING_LENGTH_TYPE_SHIFT);
+
+                ASF_PACKET_INFO info;
+                ASF_PAYLOAD_INFO payloadInfo;
+
+                ASF_TEST_CHECK(parser.Initialize(cbPacket) == S_OK);
+                ASF_TEST_CHECK(parser.ParsePacket(packet.GetData(), cbPacket, &info) == S_OK);
+
+                ASF_TEST_CHECK(info.cbPacketLength == cbPacket);
+                ASF_TEST_CHECK(info.dwSequence == CutToLengthType(ASF_LENGTH_TYPE(dwFlags, ASF_SEQUENCE_TYPE_SHIFT), dwSequence));
+                ASF_TEST_CHECK((dwPaddingType != 0) ? (info.cbPadding > 0) : (info.cbPadding == 0));
+                ASF_TEST_CHECK(info.fMultiplePayloads == fMultiplePayloads);
+                ASF_TEST_CHECK(info.cPayloads == cPayloads);
+
+                for (DWORD i = 0; i < cPayloads; i++)
+                {
+                    ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_OK);
+                    CheckPayload(payloadInfo, rgPayloads[i], bPropertyFlags);
+                }
+
+                ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_FALSE);
+                ASF_TEST_CHECK(parser.GetParseOffset() == cbPacket - info.cbPadding);
+            }
+        }
+    }
+}
+
+//Replicated data with and without the media object size
+static void TestReplicatedData()
+{
+    const DWORD rgcbReplicated[] = { 0, 4, 7, 8, 13 };
+
+    CASFPacketParser parser;
+
+    for (DWORD i = 0; i < sizeof(rgcbReplicated) / sizeof(rgcbReplicated[0]); i++)
+    {
+        CASFTestWriter packet;
+        ASF_TEST_PACKET header = MakePacket(2, TEST_PADDING_WORD, TEST_PROPERTY_FLAGS, 0, 128);
+        ASF_TEST_PAYLOAD payload = MakePayload(3, 1, 0, rgcbReplicated[i], 64, 5000, s_rgbData, 32);
+
+        WriteTestPacket(packet, header, &payload, 1);
+
+        ASF_PAYLOAD_INFO payloadInfo;
+
+        ASF_TEST_CHECK(parser.Initialize(128) == S_OK);
+        ASF_TEST_CHECK(parser.ParsePacket(packet.GetData(), 128, NULL) == S_OK);
+        ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_OK);
+        CheckPayload(payloadInfo, payload, TEST_PROPERTY_FLAGS);
+
+        if (rgcbReplicated[i] >= ASF_REPLICATED_DATA_MIN_SIZE)
+        {
+            ASF_TEST_CHECK(payloadInfo.cbMediaObjectSize == 64);
+            ASF_TEST_CHECK(payloadInfo.dwPresentationTime == 5000);
+            ASF_TEST_CHECK(ASFReadDWord(payloadInfo.pReplicatedData) == 64);
+        }
+    }
+}
+
+static void TestCompressedPayloads()
+{
+    //Sub-payloads of 3 and 5 bytes
+    const BYTE rgbCompressed[] = { 3, 'a', 'b', 'c', 5, 'd', 'e', 'f', 'g', 'h' };
+
+    ASF_TEST_PAYLOAD rgPayloads[] =
+    {
+        MakePayload(ASF_PAYLOAD_KEY_FRAME | 2, 20, 1000, 1, 0, 40, rgbCompressed, sizeof(rgbCompressed)),
+        MakePayload(2, 30, 0, 1, 0, 40, NULL, 0),
+        MakePayload(1, 4, 0, 8, 10, 1100, s_rgbData, 10),
+    };
+
+    CASFTestWriter packet;
+    ASF_TEST_PACKET header = MakePacket(2, ASF_PACKET_MULTIPLE_PAYLOADS | TEST_PADDING_WORD, TEST_PROPERTY_FLAGS, 1, 128);
+
+    WriteTestPacket(packet, header, rgPayloads, 3);
+
+    CASFPacketParser parser;
+    ASF_PAYLOAD_INFO payloadInfo;
+
+    ASF_TEST_CHECK(parser.Initialize(128) == S_OK);
+    ASF_TEST_CHECK(parser.ParsePacket(packet.GetData(), 128, NULL) == S_OK);
+
+    //Each sub-payload is a whole media object
+    ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_OK);
+    ASF_TEST_CHECK(payloadInfo.fCompressed);
+    ASF_TEST_CHECK(payloadInfo.fKeyFrame);
+    ASF_TEST_CHECK(payloadInfo.bStreamNumber == 2);
+    ASF_TEST_CHECK(payloadInfo.dwMediaObjectNumber == 20);
+    ASF_TEST_CHECK(payloadInfo.dwPresentationTime == 1000);
+    ASF_TEST_CHECK(payloadInfo.dwOffsetIntoMediaObject == 0);
+    ASF_TEST_CHECK(payloadInfo.cbData == 3);
+    ASF_TEST_CHECK(payloadInfo.cbMediaObjectSize == 3);
+    ASF_TEST_CHECK(memcmp(payloadInfo.pData, "abc", 3) == 0);
+
+    ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_OK);
+    ASF_TEST_CHECK(payloadInfo.fCompressed);
+    ASF_TEST_CHECK(payloadInfo.dwMediaObjectNumber == 21);
+    ASF_TEST_CHECK(payloadInfo.dwPresentationTime == 1040);
+    ASF_TEST_CHECK(payloadInfo.cbData == 5);
+    ASF_TEST_CHECK(memcmp(payloadInfo.pData, "defgh", 5) == 0);
+
+    //The empty compressed payload yields nothing
+    ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_OK);
+    CheckPayload(payloadInfo, rgPayloads[2], TEST_PROPERTY_FLAGS);
+
+    ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_FALSE);
+
+    //A single compressed payload whose last sub-payload overruns it
+    const BYTE rgbOverrun[] = { 2, 'a', 'b', 9, 'c' };
+
+    CASFTestWriter packet2;
+    ASF_TEST_PACKET header2 = MakePacket(0, 0, TEST_PROPERTY_FLAGS, 0, 0);
+    ASF_TEST_PAYLOAD payload = MakePayload(2, 5, 2000, 1, 0, 10, rgbOverrun, sizeof(rgbOverrun));
+
+    WriteTestPacket(packet2, header2, &payload, 1);
+
+    ASF_TEST_CHECK(parser.Initialize((DWORD)packet2.GetSize()) == S_OK);
+    ASF_TEST_CHECK(parser.ParsePacket(packet2.GetData(), (DWORD)packet2.GetSize(), NULL) == S_OK);
+    ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_OK);
+    ASF_TEST_CHECK(payloadInfo.cbData == 2);
+    ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == MF_E_ASF_INVALIDDATA);
+    ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_FALSE);
+}
+
+//An explicit packet length overrides the fixed packet size, and the
+//padding is not payload data
+static void TestExplicitLengthAndPadding()
+{
+    const BYTE bFlags = (2 << ASF_PACKET_LENGTH_TYPE_SHIFT) | (1 << ASF_PADDING_LENGTH_TYPE_SHIFT);
+
+    CASFTestWriter packet;
+    ASF_TEST_PACKET header = MakePacket(2, bFlags, TEST_PROPERTY_FLAGS, 0, 180);
+    ASF_TEST_PAYLOAD payload = MakePayload(4, 1, 0, 8, 40, 100, s_rgbData, 40);
+
+    WriteTestPacket(packet, header, &payload, 1);
+
+    //Bytes of the next packet follow in the buffer
+    packet.WriteFill(0xCC, 50);
+
+    CASFPacketParser parser;
+    ASF_PACKET_INFO info;
+    ASF_PAYLOAD_INFO payloadInfo;
+
+    ASF_TEST_CHECK(parser.Initialize(4000) == S_OK);
+    ASF_TEST_CHECK(parser.ParsePacket(packet.GetData(), (DWORD)packet.GetSize(), &info) == S_OK);
+    ASF_TEST_CHECK(info.cbPacketLength == 180);
+    ASF_TEST_CHECK(info.cbPadding == 180 - (3 + 2 + 2 + 1 + 6 + 15 + 40));
+
+    ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_OK);
+    CheckPayload(payloadInfo, payload, TEST_PROPERTY_FLAGS);
+    ASF_TEST_CHECK(payloadInfo.pData + payloadInfo.cbData == packet.GetData() + 180 - info.cbPadding);
+}
+
+static void TestInvalidPackets()
+{
+    CASFPacketParser parser;
+    ASF_PAYLOAD_INFO payloadInfo;
+
+    ASF_TEST_CHECK(parser.Initialize(100) == S_OK);
+
+    //Empty, and error correction with a length type
+    const BYTE rgbBadEC[] = { ASF_EC_PRESENT | 0x20 | 2, 0, 0, 0, 0 };
+
+    ASF_TEST_CHECK(parser.ParsePacket(rgbBadEC, 0, NULL) == MF_E_ASF_INVALIDDATA);
+    ASF_TEST_CHECK(parser.ParsePacket(rgbBadEC, sizeof(rgbBadEC), NULL) == MF_E_ASF_INVALIDDATA);
+
+    ASF_TEST_PAYLOAD payload = MakePayload(1, 1, 0, 8, 30, 100, s_rgbData, 30);
+
+    //Truncated header, and a buffer shorter than the packet
+    {
+        CASFTestWriter packet;
+        WriteTestPacket(packet, MakePacket(2, TEST_PADDING_WORD, TEST_PROPERTY_FLAGS, 0, 100), &payload, 1);
+
+        ASF_TEST_CHECK(parser.ParsePacket(packet.GetData(), 8, NULL) == MF_E_ASF_INVALIDDATA);
+        ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_FALSE);
+        ASF_TEST_CHECK(parser.ParsePacket(packet.GetData(), 99, NULL) == MF_E_ASF_INVALIDDATA);
+    }
+
+    //Explicit packet length beyond the buffer
+    {
+        CASFTestWriter packet;
+        WriteTestPacket(packet, MakePacket(0, 2 << ASF_PACKET_LENGTH_TYPE_SHIFT, TEST_PROPERTY_FLAGS, 0, 0), &payload, 1);
+
+        packet.PatchWord(2, (WORD)(packet.GetSize() + 1));
+        ASF_TEST_CHECK(parser.ParsePacket(packet.GetData(), (DWORD)packet.GetSize(), NULL) == MF_E_ASF_INVALIDDATA);
+    }
+
+    //Padding longer than the packet
+    {
+        CASFTestWriter packet;
+        WriteTestPacket(packet, MakePacket(0, 1 << ASF_PADDING_LENGTH_TYPE_SHIFT, TEST_PROPERTY_FLAGS, 0, 100), &payload, 1);
+
+        packet.GetData()[2] = 200;
+        ASF_TEST_CHECK(parser.ParsePacket(packet.GetData(), 100, NULL) == MF_E_ASF_INVALIDDATA);
+    }
+
+    //Multiple payloads without a payload length type
+    {
+        CASFTestWriter packet;
+        WriteTestPacket(packet, MakePacket(0, ASF_PACKET_MULTIPLE_PAYLOADS, TEST_PROPERTY_FLAGS, 0, 0), &payload, 1);
+
+        ASF_TEST_CHECK(parser.Initialize((DWORD)packet.GetSize()) == S_OK);
+        ASF_TEST_CHECK(parser.ParsePacket(packet.GetData(), (DWORD)packet.GetSize(), NULL) == MF_E_ASF_INVALIDDATA);
+    }
+
+    //Flags, property flags, send time, duration, payload flags; then the
+    //stream number, object number, offset and replicated data before
+    //the payload length
+    const size_t cbFirstPayload = 2 + 6 + 1;
+    const size_t cbPayloadLength = cbFirstPayload + 1 + 1 + 4 + 1 + 8;
+
+    //Payload length beyond the packet
+    {
+        CASFTestWriter packet;
+        WriteTestPacket(packet, MakePacket(0, ASF_PACKET_MULTIPLE_PAYLOADS, TEST_PROPERTY_FLAGS, 2, 0), &payload, 1);
+
+        packet.PatchWord(cbPayloadLength, 31);
+
+        ASF_TEST_CHECK(parser.Initialize((DWORD)packet.GetSize()) == S_OK);
+        ASF_TEST_CHECK(parser.ParsePacket(packet.GetData(), (DWORD)packet.GetSize(), NULL) == S_OK);
+        ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == MF_E_ASF_INVALIDDATA);
+        ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_FALSE);
+    }
+
+    //Replicated data beyond the packet
+    {
+        CASFTestWriter packet;
+        WriteTestPacket(packet, MakePacket(0, ASF_PACKET_MULTIPLE_PAYLOADS, TEST_PROPERTY_FLAGS, 2, 0), &payload, 1);
+
+        packet.GetData()[cbFirstPayload + 1 + 1 + 4] = 250;
+
+        ASF_TEST_CHECK(parser.Initialize((DWORD)packet.GetSize()) == S_OK);
+        ASF_TEST_CHECK(parser.ParsePacket(packet.GetData(), (DWORD)packet.GetSize(), NULL) == S_OK);
+        ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == MF_E_ASF_INVALIDDATA);
+    }
+
+    //More payloads counted than the packet holds
+    {
+        CASFTestWriter packet;
+        ASF_TEST_PAYLOAD rgPayloads[] = { payload, payload };
+
+        WriteTestPacket(packet, MakePacket(2, ASF_PACKET_MULTIPLE_PAYLOADS | TEST_PADDING_WORD, TEST_PROPERTY_FLAGS, 2, 150), rgPayloads, 2);
+
+        packet.GetData()[3 + 2 + 2 + 6] = (BYTE)(3 | (2 << ASF_PAYLOAD_LENGTH_TYPE_SHIFT));
+
+        ASF_TEST_CHECK(parser.Initialize(150) == S_OK);
+        ASF_TEST_CHECK(parser.ParsePacket(packet.GetData(), 150, NULL) == S_OK);
+        ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_OK);
+        ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == S_OK);
+        ASF_TEST_CHECK(parser.GetNextPayload(&payloadInfo) == MF_E_ASF_INVALIDDATA);
+    }
+}
+
+int main()
+{
+    TestSinglePayload();
+    TestMultiplePayloads();
+    TestLengthTypes();
+    TestReplicatedData();
+    TestCompressedPayloads();
+    TestExplicitLengthAndPadding();
+    TestInvalidPackets();
+
+    return ASF_TEST_RESULT();
+}
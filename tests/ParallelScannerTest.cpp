@@ -0,0 +1,162 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ParallelScannerTest.cpp : CASFParallelScanner tests against a single
+//                           threaded scan.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include "ASFParallelScanner.h"
+#include "ASFTestData.h"
+
+#define TEST_PACKET_SIZE    512
+#define TEST_VIDEO_SIZE     300
+#define TEST_AUDIO_SIZE     60
+#define TEST_FIRST_PACKET   5000
+
+//Not a multiple of any range count the scanner picks below
+#define TEST_PACKET_COUNT   37
+
+//An even packet, so a video object start is lost with it
+#define TEST_DAMAGED_PACKET 10
+
+//Offset of the padding length in a media test packet: error correction
+//flags and data, length type flags, property flags
+#define TEST_PADDING_OFFSET 5
+
+//Every stream of the scan matches the reference scan
+static void CheckSamples(const CASFParallelScanner& scanner, const CASFParallelScanner& reference)
+{
+    for (WORD s = 0; s < ASF_MAX_STREAMS; s++)
+    {
+        const ASF_SAMPLE_DESCRIPTOR* pSamples = NULL;
+        const ASF_SAMPLE_DESCRIPTOR* pExpected = NULL;
+        DWORD cSamples = 0, cExpected = 0;
+
+        ASF_TEST_CHECK(scanner.GetSamples(s, &pSamples, &cSamples) == S_OK);
+        ASF_TEST_CHECK(reference.GetSamples(s, &pExpected, &cExpected) == S_OK);
+        ASF_TEST_CHECK(cSamples == cExpected);
+
+        //Field by field; the descriptors have padding
+        for (DWORD i = 0; (i < cSamples) && (i < cExpected); i++)
+        {
+            ASF_TEST_CHECK(pSamples[i].cbPacketOffset == pExpected[i].cbPacketOffset);
+            ASF_TEST_CHECK(pSamples[i].dwPresentationTime == pExpected[i].dwPresentationTime);
+            ASF_TEST_CHECK(pSamples[i].cbMediaObjectSize == pExpected[i].cbMediaObjectSize);
+            ASF_TEST_CHECK(pSamples[i].dwMediaObjectNumber == pExpected[i].dwMediaObjectNumber);
+            ASF_TEST_CHECK(pSamples[i].bStreamNumber == pExpected[i].bStreamNumber);
+            ASF_TEST_CHECK(pSamples[i].fKeyFrame == pExpected[i].fKeyFrame);
+        }
+    }
+
+    ASF_TEST_CHECK(scanner.GetPacketCount() == reference.GetPacketCount());
+    ASF_TEST_CHECK(scanner.GetCorruptPacketCount() == reference.GetCorruptPacketCount());
+}
+
+//The single threaded scan finds every object of the test packets
+static void CheckReference(const CASFParallelScanner& scanner, BOOL fDamaged)
+{
+    const ASF_SAMPLE_DESCRIPTOR* pSamples = NULL;
+    DWORD cSamples = 0;
+
+    //Video objects start in the even packets
+    ASF_TEST_CHECK(scanner.GetSamples(ASF_TEST_VIDEO_STREAM, &pSamples, &cSamples) == S_OK);
+    ASF_TEST_CHECK(cSamples == (TEST_PACKET_COUNT + 1) / 2 - (fDamaged ? 1 : 0));
+
+    for (DWORD i = 0, k = 0; pSamples && (i < cSamples); i++, k++)
+    {
+        if (fDamaged && (k == TEST_DAMAGED_PACKET / 2))
+        {
+            k++;
+        }
+
+        ASF_TEST_CHECK(pSamples[i].dwMediaObjectNumber == k);
+        ASF_TEST_CHECK(pSamples[i].cbPacketOffset == TEST_FIRST_PACKET + (QWORD)2 * k * TEST_PACKET_SIZE);
+        ASF_TEST_CHECK(pSamples[i].dwPresentationTime == ASF_TEST_PREROLL + 2 * k * ASF_TEST_PACKET_MS);
+        ASF_TEST_CHECK(pSamples[i].cbMediaObjectSize == TEST_VIDEO_SIZE);
+        ASF_TEST_CHECK(pSamples[i].fKeyFrame == ((k % ASF_TEST_KEY_FRAME_INTERVAL == 0) ? 1 : 0));
+    }
+
+    ASF_TEST_CHECK(scanner.GetSamples(ASF_TEST_AUDIO_STREAM, &pSamples, &cSamples) == S_OK);
+    ASF_TEST_CHECK(cSamples == TEST_PACKET_COUNT - (fDamaged ? 1 : 0));
+
+    for (DWORD i = 0, k = 0; pSamples && (i < cSamples); i++, k++)
+    {
+        if (fDamaged && (k == TEST_DAMAGED_PACKET))
+        {
+            k++;
+        }
+
+        ASF_TEST_CHECK(pSamples[i].dwMediaObjectNumber == k);
+        ASF_TEST_CHECK(pSamples[i].cbPacketOffset == TEST_FIRST_PACKET + (QWORD)k * TEST_PACKET_SIZE);
+        ASF_TEST_CHECK(pSamples[i].fKeyFrame == 1);
+    }
+
+    ASF_TEST_CHECK(scanner.GetPacketCount() == TEST_PACKET_COUNT);
+    ASF_TEST_CHECK(scanner.GetCorruptPacketCount() == (fDamaged ? 1U : 0U));
+}
+
+//Scans with 1, 2, 3 and 8 threads, one per processor and more threads
+//than packets
+static void TestThreadCounts(const CASFTestWriter& packets, BOOL fDamaged)
+{
+    const DWORD rgcThreads[] = { 2, 3, 8, 0, ASF_SCAN_MAX_THREADS };
+
+    CASFParallelScanner reference;
+
+    ASF_TEST_CHECK(reference.Scan(packets.GetData(), TEST_PACKET_COUNT, TEST_PACKET_SIZE, TEST_FIRST_PACKET, 1) == S_OK);
+
+    CheckReference(reference, fDamaged);
+
+    for (DWORD i = 0; i < sizeof(rgcThreads) / sizeof(rgcThreads[0]); i++)
+    {
+        CASFParallelScanner scanner;
+
+        ASF_TEST_CHECK(scanner.Scan(packets.GetData(), TEST_PACKET_COUNT, TEST_PACKET_SIZE, TEST_FIRST_PACKET, rgcThreads[i]) == S_OK);
+
+        CheckSamples(scanner, reference);
+    }
+}
+
+int main()
+{
+    CASFTestWriter packets;
+
+    for (DWORD i = 0; i < TEST_PACKET_COUNT; i++)
+    {
+        WriteTestMediaPacket(packets, TEST_PACKET_SIZE, i, TEST_VIDEO_SIZE, TEST_AUDIO_SIZE);
+    }
+
+    ASF_TEST_CHECK(packets.GetSize() == (size_t)TEST_PACKET_COUNT * TEST_PACKET_SIZE);
+
+    TestThreadCounts(packets, FALSE);
+
+    //Padding past the end of the packet
+    packets.PatchDWord(TEST_DAMAGED_PACKET * TEST_PACKET_SIZE + TEST_PADDING_OFFSET, 2 * TEST_PACKET_SIZE);
+
+    TestThreadCounts(packets, TRUE);
+
+    //A rescan drops the previous results
+    CASFParallelScanner scanner;
+    const ASF_SAMPLE_DESCRIPTOR* pSamples = NULL;
+    DWORD cSamples = 0;
+
+    ASF_TEST_CHECK(scanner.Scan(packets.GetData(), TEST_PACKET_COUNT, TEST_PACKET_SIZE, 0, 2) == S_OK);
+    ASF_TEST_CHECK(scanner.Scan(packets.GetData(), 0, TEST_PACKET_SIZE, 0, 2) == S_OK);
+    ASF_TEST_CHECK(scanner.GetSamples(ASF_TEST_AUDIO_STREAM, &pSamples, &cSamples) == S_OK);
+    ASF_TEST_CHECK(cSamples == 0);
+    ASF_TEST_CHECK(scanner.GetCorruptPacketCount() == 0);
+
+    ASF_TEST_CHECK(scanner.Scan(NULL, 1, TEST_PACKET_SIZE, 0, 1) == E_INVALIDARG);
+    ASF_TEST_CHECK(scanner.Scan(packets.GetData(), 1, 0, 0, 1) == E_INVALIDARG);
+    ASF_TEST_CHECK(scanner.GetSamples(ASF_MAX_STREAMS, &pSamples, &cSamples) == MF_E_INVALIDSTREAMNUMBER);
+
+    return ASF_TEST_RESULT();
+}
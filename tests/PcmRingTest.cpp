@@ -0,0 +1,346 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// PcmRingTest.cpp : CASFPcmRing single and two thread tests.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "ASFPcmRing.h"
+#include "ASFThread.h"
+#include "ASFTestData.h"
+
+//24-bit stereo, so the ring size is not a power of two
+#define TEST_BLOCK_ALIGN    6
+#define TEST_RING_SIZE      6000
+#define TEST_STREAM_SIZE    (4 * 1024 * 1024 * TEST_BLOCK_ALIGN)
+#define TEST_MAX_BLOCKS     300
+
+//The byte at each position of the written stream; the period is not a
+//multiple of any ring size, so data read at a wrong offset shows
+static BYTE GetStreamByte(DWORD cbPosition)
+{
+    return (BYTE)(cbPosition % 251);
+}
+
+static void FillStream(BYTE* pData, DWORD cbData, DWORD cbPosition)
+{
+    for (DWORD i = 0; i < cbData; i++)
+    {
+        pData[i] = GetStreamByte(cbPosition + i);
+    }
+}
+
+static BOOL IsStream(const BYTE* pData, DWORD cbData, DWORD cbPosition)
+{
+    for (DWORD i = 0; i < cbData; i++)
+    {
+        if (pData[i] != GetStreamByte(cbPosition + i))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static void TestInitialize()
+{
+    CASFPcmRing ring;
+    BYTE* pWrite = NULL;
+    const BYTE* pRead = NULL;
+    DWORD cbContiguous = 0;
+    BYTE rgbData[8] = { 0 };
+
+    ASF_TEST_CHECK(ring.BeginWrite(4, &pWrite, &cbContiguous) == MF_E_NOT_INITIALIZED);
+    ASF_TEST_CHECK(ring.Write(rgbData, sizeof(rgbData)) == MF_E_NOT_INITIALIZED);
+    ASF_TEST_CHECK(ring.GetReadRegion(0, &pRead, &cbContiguous) == MF_E_NOT_INITIALIZED);
+    ASF_TEST_CHECK(ring.CommitRead(0) == MF_E_NOT_INITIALIZED);
+    ASF_TEST_CHECK(ring.GetWritable() == 0);
+    ASF_TEST_CHECK(ring.GetCapacity() == 0);
+
+    ASF_TEST_CHECK(ring.Initialize(0, 4) == E_INVALIDARG);
+    ASF_TEST_CHECK(ring.Initialize(16, 0) == E_INVALIDARG);
+    ASF_TEST_CHECK(ring.Initialize(ASF_PCM_RING_MAX_SIZE + 1, 4) == E_INVALIDARG);
+
+    //Rounded up to whole blocks
+    ASF_TEST_CHECK(ring.Initialize(10, 4) == S_OK);
+    ASF_TEST_CHECK(ring.GetCapacity() == 12);
+    ASF_TEST_CHECK(ring.GetBlockAlign() == 4);
+    ASF_TEST_CHECK(ring.GetWritable() == 12);
+    ASF_TEST_CHECK(ring.GetReadable() == 0);
+
+    ASF_TEST_CHECK(ring.Initialize(TEST_RING_SIZE + 1, TEST_BLOCK_ALIGN) == S_OK);
+    ASF_TEST_CHECK(ring.GetCapacity() == TEST_RING_SIZE + TEST_BLOCK_ALIGN);
+
+    ASF_TEST_CHECK(ring.BeginWrite(4, NULL, &cbContiguous) == E_POINTER);
+    ASF_TEST_CHECK(ring.BeginWrite(4, &pWrite, NULL) == E_POINTER);
+    ASF_TEST_CHECK(ring.GetReadRegion(0, NULL, &cbContiguous) == E_POINTER);
+    ASF_TEST_CHECK(ring.Write(NULL, 4) == E_INVALIDARG);
+
+    //Nothing to read in an empty ring
+    ASF_TEST_CHECK(ring.GetReadRegion(0, &pRead, &cbContiguous) == S_FALSE);
+    ASF_TEST_CHECK(!pRead && (cbContiguous == 0));
+}
+
+//Contiguous regions stop at the wrap-around point, Write copies across
+//it and everything stays in whole blocks
+static void TestWrapAndAlignment()
+{
+    CASFPcmRing ring;
+    BYTE* pWrite = NULL;
+    const BYTE* pRead = NULL;
+    DWORD cbContiguous = 0;
+    BYTE rgbData[16];
+
+    //Twelve bytes usable in a sixteen byte ring
+    ASF_TEST_CHECK(ring.Initialize(12, 4) == S_OK);
+
+    ASF_TEST_CHECK(ring.BeginWrite(4, &pWrite, &cbContiguous) == S_OK);
+    ASF_TEST_CHECK(pWrite && (cbContiguous == 12));
+
+    FillStream(pWrite, 8, 0);
+
+    ASF_TEST_CHECK(ring.CommitWrite(6) == E_INVALIDARG);
+    ASF_TEST_CHECK(ring.CommitWrite(16) == E_INVALIDARG);
+    ASF_TEST_CHECK(ring.CommitWrite(8) == S_OK);
+    ASF_TEST_CHECK(ring.GetReadable() == 8);
+    ASF_TEST_CHECK(ring.GetWritable() == 4);
+
+    //An offset skips data a reader already has in flight
+    ASF_TEST_CHECK(ring.GetReadRegion(4, &pRead, &cbContiguous) == S_OK);
+    ASF_TEST_CHECK((cbContiguous == 4) && IsStream(pRead, 4, 4));
+    ASF_TEST_CHECK(ring.GetReadRegion(8, &pRead, &cbContiguous) == S_FALSE);
+
+    ASF_TEST_CHECK(ring.GetReadRegion(0, &pRead, &cbContiguous) == S_OK);
+    ASF_TEST_CHECK((cbContiguous == 8) && IsStream(pRead, 8, 0));
+    ASF_TEST_CHECK(ring.CommitRead(2) == E_INVALIDARG);
+    ASF_TEST_CHECK(ring.CommitRead(12) == E_INVALIDARG);
+    ASF_TEST_CHECK(ring.CommitRead(8) == S_OK);
+    ASF_TEST_CHECK(ring.GetReadable() == 0);
+    ASF_TEST_CHECK(ring.GetWritable() == 12);
+
+    //Twelve bytes are free but only eight of them before the wrap
+    ASF_TEST_CHECK(ring.BeginWrite(12, &pWrite, &cbContiguous) == S_FALSE);
+    ASF_TEST_CHECK(!pWrite && (cbContiguous == 0));
+    ASF_TEST_CHECK(ring.BeginWrite(8, &pWrite, &cbContiguous) == S_OK);
+    ASF_TEST_CHECK(cbContiguous == 8);
+
+    //So the writer decodes elsewhere and copies across the wrap
+    FillStream(rgbData, 12, 8);
+
+    ASF_TEST_CHECK(ring.Write(rgbData, 12) == S_OK);
+    ASF_TEST_CHECK(ring.GetReadable() == 12);
+    ASF_TEST_CHECK(ring.GetWritable() == 0);
+    ASF_TEST_CHECK(ring.BeginWrite(0, &pWrite, &cbContiguous) == S_FALSE);
+
+    //A full ring drops and counts the data
+    ASF_TEST_CHECK(ring.Write(rgbData, 4) == S_FALSE);
+    ASF_TEST_CHECK(ring.GetDroppedBytes() == 4);
+
+    //The data comes back in two pieces
+    ASF_TEST_CHECK(ring.GetReadRegion(0, &pRead, &cbContiguous) == S_OK);
+    ASF_TEST_CHECK((cbContiguous == 8) && IsStream(pRead, 8, 8));
+    ASF_TEST_CHECK(ring.GetReadRegion(8, &pRead, &cbContiguous) == S_OK);
+    ASF_TEST_CHECK((cbContiguous == 4) && IsStream(pRead, 4, 16));
+    ASF_TEST_CHECK(ring.CommitRead(12) == S_OK);
+    ASF_TEST_CHECK(ring.GetReadable() == 0);
+
+    //Partial blocks are dropped
+    ASF_TEST_CHECK(ring.Write(rgbData, 6) == S_FALSE);
+    ASF_TEST_CHECK(ring.GetReadable() == 4);
+    ASF_TEST_CHECK(ring.GetDroppedBytes() == 6);
+
+    //Rewind brings back data from the start of the memory
+    ASF_TEST_CHECK(ring.Rewind(6) == E_INVALIDARG);
+    ASF_TEST_CHECK(ring.Rewind(16) == E_INVALIDARG);
+    ASF_TEST_CHECK(ring.Rewind(12) == S_OK);
+    ASF_TEST_CHECK(ring.GetReadRegion(0, &pRead, &cbContiguous) == S_OK);
+    ASF_TEST_CHECK((cbContiguous == 12) && IsStream(pRead, 4, 16) && IsStream(pRead + 4, 4, 8));
+
+    ring.Reset();
+
+    ASF_TEST_CHECK(ring.GetReadable() == 0);
+    ASF_TEST_CHECK(ring.GetDroppedBytes() == 0);
+
+    //Blocks of one, two and three leave the positions at every block
+    //of a ring that is not a power of two
+    ASF_TEST_CHECK(ring.Initialize(TEST_BLOCK_ALIGN * 7, TEST_BLOCK_ALIGN) == S_OK);
+
+    DWORD cbWritten = 0, cbRead = 0;
+    BYTE rgbBlocks[TEST_BLOCK_ALIGN * 3];
+
+    for (DWORD i = 0; i < 1000; i++)
+    {
+        DWORD cbChunk = (i % 3 + 1) * TEST_BLOCK_ALIGN;
+
+        if (ring.BeginWrite(cbChunk, &pWrite, &cbContiguous) == S_OK)
+        {
+            ASF_TEST_CHECK(cbContiguous % TEST_BLOCK_ALIGN == 0);
+
+            FillStream(pWrite, cbChunk, cbWritten);
+
+            ASF_TEST_CHECK(ring.CommitWrite(cbChunk) == S_OK);
+        }
+        else
+        {
+            FillStream(rgbBlocks, cbChunk, cbWritten);
+
+            ASF_TEST_CHECK(ring.Write(rgbBlocks, cbChunk) == S_OK);
+        }
+
+        cbWritten += cbChunk;
+
+        //Read back all but the newest block
+        while (ring.GetReadable() > TEST_BLOCK_ALIGN)
+        {
+            ASF_TEST_CHECK(ring.GetReadRegion(0, &pRead, &cbContiguous) == S_OK);
+            ASF_TEST_CHECK(cbContiguous % TEST_BLOCK_ALIGN == 0);
+
+            if (cbContiguous > ring.GetReadable() - TEST_BLOCK_ALIGN)
+            {
+                cbContiguous = ring.GetReadable() - TEST_BLOCK_ALIGN;
+            }
+
+            ASF_TEST_CHECK(IsStream(pRead, cbContiguous, cbRead));
+            ASF_TEST_CHECK(ring.CommitRead(cbContiguous) == S_OK);
+
+            cbRead += cbContiguous;
+        }
+    }
+
+    ASF_TEST_CHECK(cbRead + TEST_BLOCK_ALIGN == cbWritten);
+    ASF_TEST_CHECK(ring.GetDroppedBytes() == 0);
+}
+
+
+struct TEST_WRITER
+{
+    CASFPcmRing*    pRing;
+    DWORD           cbTotal;
+    DWORD           cFallbacks;
+    HRESULT         hrLast;
+};
+
+//Writes the stream in chunks of varying size, waiting for space like
+//the decode thread does, so nothing is dropped
+static void WriterProc(void* pContext)
+{
+    TEST_WRITER* pWriter = (TEST_WRITER*)pContext;
+    CASFPcmRing* pRing = pWriter->pRing;
+    BYTE rgbChunk[TEST_MAX_BLOCKS * TEST_BLOCK_ALIGN];
+    DWORD cbWritten = 0;
+
+    pWriter->hrLast = S_OK;
+
+    for (DWORD i = 0; cbWritten < pWriter->cbTotal; i++)
+    {
+        DWORD cbChunk = ((i * 37) % TEST_MAX_BLOCKS + 1) * TEST_BLOCK_ALIGN;
+
+        if (cbChunk > pWriter->cbTotal - cbWritten)
+        {
+            cbChunk = pWriter->cbTotal - cbWritten;
+        }
+
+        while (pRing->GetWritable() < cbChunk)
+        {
+            CASFThread::YieldThread();
+        }
+
+        BYTE* pData = NULL;
+        DWORD cbContiguous = 0;
+
+        if (pRing->BeginWrite(cbChunk, &pData, &cbContiguous) == S_OK)
+        {
+            FillStream(pData, cbChunk, cbWritten);
+
+            pWriter->hrLast = pRing->CommitWrite(cbChunk);
+        }
+        else
+        {
+            FillStream(rgbChunk, cbChunk, cbWritten);
+
+            pWriter->hrLast = pRing->Write(rgbChunk, cbChunk);
+            pWriter->cFallbacks++;
+        }
+
+        if (pWriter->hrLast != S_OK)
+        {
+            break;
+        }
+
+        cbWritten += cbChunk;
+    }
+}
+
+//The reader sees the stream in write order while both positions wrap
+//many times
+static void TestTwoThreads()
+{
+    CASFPcmRing ring;
+    CASFThread thread;
+
+    ASF_TEST_CHECK(ring.Initialize(TEST_RING_SIZE, TEST_BLOCK_ALIGN) == S_OK);
+
+    TEST_WRITER writer = { &ring, TEST_STREAM_SIZE, 0, E_FAIL };
+
+    ASF_TEST_CHECK(thread.Start(WriterProc, &writer) == S_OK);
+
+    DWORD cbRead = 0;
+    DWORD cbMismatch = 0;
+
+    for (DWORD i = 0; cbRead < TEST_STREAM_SIZE; i++)
+    {
+        const BYTE* pData = NULL;
+        DWORD cbContiguous = 0;
+
+        if (ring.GetReadRegion(0, &pData, &cbContiguous) != S_OK)
+        {
+            CASFThread::YieldThread();
+            continue;
+        }
+
+        //Consume less than is there now and then, like a sink with a
+        //short buffer
+        DWORD cbMax = ((i * 53) % TEST_MAX_BLOCKS + 1) * TEST_BLOCK_ALIGN;
+
+        if (cbContiguous > cbMax)
+        {
+            cbContiguous = cbMax;
+        }
+
+        if (!IsStream(pData, cbContiguous, cbRead))
+        {
+            cbMismatch++;
+        }
+
+        ASF_TEST_CHECK(ring.CommitRead(cbContiguous) == S_OK);
+
+        cbRead += cbContiguous;
+    }
+
+    thread.Join();
+
+    ASF_TEST_CHECK(writer.hrLast == S_OK);
+    ASF_TEST_CHECK(cbMismatch == 0);
+    ASF_TEST_CHECK(cbRead == TEST_STREAM_SIZE);
+    ASF_TEST_CHECK(ring.GetReadable() == 0);
+    ASF_TEST_CHECK(ring.GetDroppedBytes() == 0);
+
+    //The chunk sizes do not divide the ring, so some land on the wrap
+    ASF_TEST_CHECK(writer.cFallbacks > 0);
+}
+
+int main()
+{
+    TestInitialize();
+    TestWrapAndAlignment();
+    TestTwoThreads();
+
+    return ASF_TEST_RESULT();
+}
@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ReadPlannerTest.cpp : CReadPlanner read size tests.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "ReadPlanner.h"
+#include "ASFTestData.h"
+
+//Reads grow from the minimum to the maximum size in whole packets
+static void TestGrowth(DWORD cbPacket)
+{
+    CReadPlanner planner;
+
+    ASF_TEST_CHECK(planner.Initialize(cbPacket, cbPacket) == S_OK);
+    ASF_TEST_CHECK(planner.GetPacketSize() == cbPacket);
+
+    DWORD cbFirst = planner.GetNextReadSize((QWORD)-1);
+    DWORD cbRead = cbFirst;
+
+    ASF_TEST_CHECK(cbFirst >= cbPacket);
+    ASF_TEST_CHECK(cbFirst % cbPacket == 0);
+
+    for (DWORD i = 0; i < 20; i++)
+    {
+        planner.OnReadComplete(cbRead);
+
+        DWORD cbNext = planner.GetNextReadSize((QWORD)-1);
+
+        ASF_TEST_CHECK(cbNext % cbPacket == 0);
+        ASF_TEST_CHECK(cbNext >= cbRead);
+
+        cbRead = cbNext;
+    }
+
+    //Packets up to the maximum read size are batched; larger ones are
+    //read one at a time
+    if (cbPacket <= READ_PLANNER_MAX_READ_SIZE)
+    {
+        ASF_TEST_CHECK(cbRead <= READ_PLANNER_MAX_READ_SIZE);
+        ASF_TEST_CHECK(cbRead > READ_PLANNER_MAX_READ_SIZE - cbPacket);
+    }
+    else
+    {
+        ASF_TEST_CHECK(cbFirst == cbPacket);
+        ASF_TEST_CHECK(cbRead == cbPacket);
+    }
+
+    //The tail of a scan is read as it is
+    ASF_TEST_CHECK(planner.GetNextReadSize(cbPacket / 2) == cbPacket / 2);
+
+    planner.OnSeek();
+    ASF_TEST_CHECK(planner.GetNextReadSize((QWORD)-1) == cbFirst);
+}
+
+static void TestVariablePackets()
+{
+    CReadPlanner planner;
+
+    ASF_TEST_CHECK(planner.Initialize(100, 200) == S_OK);
+    ASF_TEST_CHECK(planner.GetPacketSize() == 1);
+    ASF_TEST_CHECK(planner.GetNextReadSize((QWORD)-1) == READ_PLANNER_MIN_READ_SIZE);
+}
+
+int main()
+{
+    TestGrowth(1);
+    TestGrowth(3200);
+    TestGrowth(READ_PLANNER_MIN_READ_SIZE + 1);
+    TestGrowth(READ_PLANNER_MAX_READ_SIZE);
+    TestGrowth(READ_PLANNER_MAX_READ_SIZE + 1);
+    TestGrowth(0xFFFFFFF0);
+    TestVariablePackets();
+
+    return ASF_TEST_RESULT();
+}
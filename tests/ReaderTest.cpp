@@ -0,0 +1,371 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ReaderTest.cpp : CASFReader seek, generation and key frame tests.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "ASFReader.h"
+#include "ASFTestData.h"
+
+#define TEST_PACKET_SIZE    512
+#define TEST_PACKET_COUNT   40
+#define TEST_VIDEO_SIZE     300     // Two payloads per object
+#define TEST_AUDIO_SIZE     60      // One payload per object
+
+#define TEST_VIDEO_OBJECTS  (TEST_PACKET_COUNT / 2)
+#define TEST_VIDEO_MS       (2 * ASF_TEST_PACKET_MS)
+
+#ifdef _WIN32
+static const ASF_PATH_CHAR s_szMediaFile[] = L"ReaderTest.asf";
+#else
+static const ASF_PATH_CHAR s_szMediaFile[] = "ReaderTest.asf";
+#endif
+
+//Counts the objects the reader assembles from several payloads
+class CTestAllocator : public IASFObjectAllocator
+{
+public:
+
+    CTestAllocator()
+    :   m_cObjects(0)
+    {
+    }
+
+    virtual HRESULT GetObjectBuffer(DWORD cbObject, BYTE** ppBuffer)
+    {
+        m_cObjects++;
+        m_Buffer.resize(cbObject);
+        *ppBuffer = &m_Buffer[0];
+        return S_OK;
+    }
+
+    DWORD               m_cObjects;
+    std::vector<BYTE>   m_Buffer;
+};
+
+//Keeps what the reader hands out; the data is only valid in OnSample
+class CTestCallback : public IASFReaderCallback
+{
+public:
+
+    CTestCallback(DWORD cStopAfter = 0)
+    :   m_cStopAfter(cStopAfter)
+    {
+    }
+
+    virtual HRESULT OnSample(const ASF_READER_SAMPLE& sample)
+    {
+        BOOL fMatches = TRUE;
+
+        for (DWORD i = 0; i < sample.cbData; i++)
+        {
+            if (sample.pData[i] != GetTestObjectByte(sample.wStreamNumber, sample.dwMediaObjectNumber, i))
+            {
+                fMatches = FALSE;
+                break;
+            }
+        }
+
+        m_Samples.push_back(sample);
+        m_Matches.push_back(fMatches);
+
+        return (m_cStopAfter > 0) && (m_Samples.size() >= m_cStopAfter) ? S_FALSE : S_OK;
+    }
+
+    DWORD                           m_cStopAfter;
+    std::vector<ASF_READER_SAMPLE>  m_Samples;
+    std::vector<BOOL>               m_Matches;
+};
+
+//Checks the video objects first..first + cObjects - 1 were handed out
+//whole, in order and at the packets they start in
+static void CheckVideoSamples(const CTestCallback& callback, QWORD cbDataOffset, DWORD dwFirst, DWORD cObjects)
+{
+    ASF_TEST_CHECK(callback.m_Samples.size() == cObjects);
+
+    for (DWORD i = 0; (i < callback.m_Samples.size()) && (i < cObjects); i++)
+    {
+        const ASF_READER_SAMPLE& sample = callback.m_Samples[i];
+        const DWORD k = dwFirst + i;
+
+        ASF_TEST_CHECK(sample.wStreamNumber == ASF_TEST_VIDEO_STREAM);
+        ASF_TEST_CHECK(sample.dwMediaObjectNumber == k);
+        ASF_TEST_CHECK(sample.hnsTime == (MFTIME)k * TEST_VIDEO_MS * 10000);
+        ASF_TEST_CHECK(sample.fKeyFrame == (k % ASF_TEST_KEY_FRAME_INTERVAL == 0));
+        ASF_TEST_CHECK(sample.cbPacketOffset == cbDataOffset + (QWORD)2 * k * TEST_PACKET_SIZE);
+        ASF_TEST_CHECK(sample.cbData == TEST_VIDEO_SIZE);
+        ASF_TEST_CHECK(callback.m_Matches[i]);
+    }
+}
+
+//The payload bookkeeping the reader and the manager share
+static void TestObjectAssembler()
+{
+    CASFObjectAssembler assembler;
+    ASF_PAYLOAD_INFO payload;
+    BOOL fStart = FALSE, fComplete = FALSE;
+
+    memset(&payload, 0, sizeof(payload));
+    payload.dwMediaObjectNumber = 3;
+    payload.cbMediaObjectSize = 100;
+    payload.dwOffsetIntoMediaObject = 40;
+    payload.cbData = 60;
+
+    //The start was not seen
+    ASF_TEST_CHECK(assembler.AddPayload(payload, &fStart, &fComplete) == S_FALSE);
+    ASF_TEST_CHECK(!fStart && !fComplete);
+
+    payload.dwOffsetIntoMediaObject = 0;
+    payload.cbData = 40;
+
+    ASF_TEST_CHECK(assembler.AddPayload(payload, &fStart, &fComplete) == S_OK);
+    ASF_TEST_CHECK(fStart && !fComplete && assembler.IsPending());
+    ASF_TEST_CHECK(assembler.GetObjectSize() == 100);
+    ASF_TEST_CHECK(assembler.GetPayloadOffset() == 0);
+
+    payload.dwOffsetIntoMediaObject = 40;
+    payload.cbData = 60;
+
+    ASF_TEST_CHECK(assembler.AddPayload(payload, &fStart, &fComplete) == S_OK);
+    ASF_TEST_CHECK(!fStart && fComplete && !assembler.IsPending());
+    ASF_TEST_CHECK(assembler.GetPayloadOffset() == 40);
+
+    //A payload that runs past the end of its object
+    payload.dwOffsetIntoMediaObject = 0;
+    payload.cbData = 40;
+    ASF_TEST_CHECK(assembler.AddPayload(payload, &fStart, &fComplete) == S_OK);
+
+    payload.dwOffsetIntoMediaObject = 40;
+    payload.cbData = 61;
+    ASF_TEST_CHECK(assembler.AddPayload(payload, &fStart, &fComplete) == MF_E_ASF_INVALIDDATA);
+    ASF_TEST_CHECK(!assembler.IsPending());
+
+    //A payload of another object
+    payload.dwOffsetIntoMediaObject = 0;
+    payload.cbData = 40;
+    ASF_TEST_CHECK(assembler.AddPayload(payload, &fStart, &fComplete) == S_OK);
+
+    payload.dwMediaObjectNumber = 4;
+    payload.dwOffsetIntoMediaObject = 40;
+    ASF_TEST_CHECK(assembler.AddPayload(payload, &fStart, &fComplete) == S_FALSE);
+
+    //Objects without a size are single payloads
+    payload.dwOffsetIntoMediaObject = 0;
+    payload.cbMediaObjectSize = 0;
+    ASF_TEST_CHECK(assembler.AddPayload(payload, &fStart, &fComplete) == S_OK);
+    ASF_TEST_CHECK(fStart && fComplete);
+
+    KEY_FRAME_FILTER_STATS stats;
+    memset(&stats, 0, sizeof(stats));
+
+    CASFObjectAssembler::SkipPayload(payload, &stats);
+    payload.dwOffsetIntoMediaObject = 40;
+    CASFObjectAssembler::SkipPayload(payload, &stats);
+
+    ASF_TEST_CHECK(stats.cObjectsSkipped == 1);
+    ASF_TEST_CHECK(stats.cbSkipped == 80);
+}
+
+//Without an index, seeks use the exact packet search
+static void TestExactSeek(CASFReader& reader)
+{
+    QWORD cbOffset = 0;
+    MFTIME hnsApprox = 0;
+
+    //Video object 5 is presented at 5000 ms and starts in packet 10
+    ASF_TEST_CHECK(reader.Seek(ASF_TEST_VIDEO_STREAM, 55000000, &cbOffset, &hnsApprox) == S_OK);
+    ASF_TEST_CHECK(cbOffset == 10 * TEST_PACKET_SIZE);
+    ASF_TEST_CHECK(hnsApprox == 55000000);
+    ASF_TEST_CHECK(reader.GetSeekPacketReads() > 0);
+
+    //Audio object 11 is presented at 5500 ms, in packet 11
+    ASF_TEST_CHECK(reader.Seek(ASF_TEST_AUDIO_STREAM, 55000000, &cbOffset, NULL) == S_OK);
+    ASF_TEST_CHECK(cbOffset == 11 * TEST_PACKET_SIZE);
+
+    ASF_TEST_CHECK(reader.Seek(ASF_TEST_VIDEO_STREAM, -10000, &cbOffset, &hnsApprox) == S_OK);
+    ASF_TEST_CHECK(cbOffset == 0);
+    ASF_TEST_CHECK(hnsApprox == 0);
+
+    ASF_TEST_CHECK(reader.Seek(ASF_TEST_VIDEO_STREAM, 0, NULL, NULL) == E_POINTER);
+}
+
+//Generations from a start time, up to an end time and stopped by the
+//callback
+static void TestGenerate(CASFReader& reader, QWORD cbDataOffset)
+{
+    {
+        CTestCallback callback;
+
+        ASF_TEST_CHECK(reader.GenerateSamples(ASF_TEST_VIDEO_STREAM, 0, 0, 0, &callback) == S_OK);
+        CheckVideoSamples(callback, cbDataOffset, 0, TEST_VIDEO_OBJECTS);
+    }
+
+    {
+        //Audio objects are single payloads, handed out in the mapping
+        CTestCallback callback;
+
+        ASF_TEST_CHECK(reader.GenerateSamples(ASF_TEST_AUDIO_STREAM, 0, 0, 0, &callback) == S_OK);
+        ASF_TEST_CHECK(callback.m_Samples.size() == TEST_PACKET_COUNT);
+
+        for (DWORD i = 0; (i < callback.m_Samples.size()) && (i < TEST_PACKET_COUNT); i++)
+        {
+            ASF_TEST_CHECK(callback.m_Samples[i].dwMediaObjectNumber == i);
+            ASF_TEST_CHECK(callback.m_Samples[i].hnsTime == (MFTIME)i * ASF_TEST_PACKET_MS * 10000);
+            ASF_TEST_CHECK(callback.m_Samples[i].cbData == TEST_AUDIO_SIZE);
+            ASF_TEST_CHECK(callback.m_Matches[i]);
+        }
+    }
+
+    {
+        //5000 ms to 9000 ms: video objects 5 to 8
+        CTestCallback callback;
+
+        ASF_TEST_CHECK(reader.GenerateSamples(ASF_TEST_VIDEO_STREAM, 50000000, 40000000, 0, &callback) == S_OK);
+        CheckVideoSamples(callback, cbDataOffset, 5, 4);
+    }
+
+    {
+        //The callback ends the generation after three objects
+        CTestCallback callback(3);
+        ASF_GENERATE_PROGRESS progress;
+
+        ASF_TEST_CHECK(reader.GenerateSamples(ASF_TEST_VIDEO_STREAM, 20000000, 0, 0, &callback) == S_OK);
+        CheckVideoSamples(callback, cbDataOffset, 2, 3);
+
+        reader.GetGenerateProgress(&progress);
+        ASF_TEST_CHECK(progress.cSamples == 3);
+        ASF_TEST_CHECK(progress.cbTotal == (QWORD)(TEST_PACKET_COUNT - 4) * TEST_PACKET_SIZE);
+    }
+
+    ASF_TEST_CHECK(reader.GenerateSamples(3, 0, 0, 0, NULL) == MF_E_INVALIDSTREAMNUMBER);
+}
+
+//Key frames only: video objects 0, 4, 8, ... The payloads of the other
+//objects are dropped on their headers and never assembled.
+static void TestKeyFramesOnly(CASFReader& reader)
+{
+    const DWORD cKeyFrames = TEST_VIDEO_OBJECTS / ASF_TEST_KEY_FRAME_INTERVAL;
+
+    CTestCallback callback;
+    CTestAllocator allocator;
+    KEY_FRAME_FILTER_STATS stats;
+
+    reader.SetObjectAllocator(&allocator);
+
+    ASF_TEST_CHECK(reader.GenerateSamples(ASF_TEST_VIDEO_STREAM, 0, 0, ASF_READER_KEY_FRAMES_ONLY, &callback) == S_OK);
+    ASF_TEST_CHECK(callback.m_Samples.size() == cKeyFrames);
+
+    for (DWORD i = 0; i < callback.m_Samples.size(); i++)
+    {
+        ASF_TEST_CHECK(callback.m_Samples[i].dwMediaObjectNumber == i * ASF_TEST_KEY_FRAME_INTERVAL);
+        ASF_TEST_CHECK(callback.m_Samples[i].fKeyFrame);
+        ASF_TEST_CHECK(callback.m_Samples[i].cbData == TEST_VIDEO_SIZE);
+        ASF_TEST_CHECK(callback.m_Matches[i]);
+    }
+
+    ASF_TEST_CHECK(allocator.m_cObjects == cKeyFrames);
+
+    reader.GetKeyFrameFilterStats(&stats);
+    ASF_TEST_CHECK(stats.cObjectsDelivered == cKeyFrames);
+    ASF_TEST_CHECK(stats.cbDelivered == (QWORD)cKeyFrames * TEST_VIDEO_SIZE);
+    ASF_TEST_CHECK(stats.cObjectsSkipped == TEST_VIDEO_OBJECTS - cKeyFrames);
+    ASF_TEST_CHECK(stats.cbSkipped == (QWORD)(TEST_VIDEO_OBJECTS - cKeyFrames) * TEST_VIDEO_SIZE);
+
+    //Without the flag every object is assembled and nothing is skipped
+    CTestCallback all;
+
+    allocator.m_cObjects = 0;
+
+    ASF_TEST_CHECK(reader.GenerateSamples(ASF_TEST_VIDEO_STREAM, 0, 0, 0, &all) == S_OK);
+    ASF_TEST_CHECK(all.m_Samples.size() == TEST_VIDEO_OBJECTS);
+    ASF_TEST_CHECK(allocator.m_cObjects == TEST_VIDEO_OBJECTS);
+
+    reader.GetKeyFrameFilterStats(&stats);
+    ASF_TEST_CHECK(stats.cObjectsDelivered == TEST_VIDEO_OBJECTS);
+    ASF_TEST_CHECK(stats.cObjectsSkipped == 0);
+    ASF_TEST_CHECK(stats.cbSkipped == 0);
+
+    //Audio objects are all key frames and single payloads
+    CTestCallback audio;
+
+    allocator.m_cObjects = 0;
+
+    ASF_TEST_CHECK(reader.GenerateSamples(ASF_TEST_AUDIO_STREAM, 0, 0, ASF_READER_KEY_FRAMES_ONLY, &audio) == S_OK);
+    ASF_TEST_CHECK(audio.m_Samples.size() == TEST_PACKET_COUNT);
+    ASF_TEST_CHECK(allocator.m_cObjects == 0);
+
+    reader.GetKeyFrameFilterStats(&stats);
+    ASF_TEST_CHECK(stats.cObjectsSkipped == 0);
+
+    reader.SetObjectAllocator(NULL);
+}
+
+//With an index built in memory, seeks go to the last key frame entry
+//at or before the seek time
+static void TestIndexedSeek(CASFReader& reader, QWORD cbDataOffset)
+{
+    QWORD cbOffset = 0;
+    MFTIME hnsApprox = 0;
+
+    ASF_TEST_CHECK(SUCCEEDED(reader.LoadOrBuildIndex(NULL)));
+
+    ASF_TEST_CHECK(reader.Seek(ASF_TEST_VIDEO_STREAM, 55000000, &cbOffset, &hnsApprox) == S_OK);
+    ASF_TEST_CHECK(cbOffset == 8 * TEST_PACKET_SIZE);
+    ASF_TEST_CHECK(hnsApprox == 40000000);
+
+    //Generations start at the key frame as well
+    CTestCallback callback;
+
+    ASF_TEST_CHECK(reader.GenerateSamples(ASF_TEST_VIDEO_STREAM, 55000000, 30000000, 0, &callback) == S_OK);
+    CheckVideoSamples(callback, cbDataOffset, 4, 5);
+}
+
+int main()
+{
+    CASFTestWriter file;
+    CASFHeaderParser header;
+
+    TestObjectAssembler();
+
+    WriteTestMediaFile(file, TEST_PACKET_SIZE, TEST_PACKET_COUNT, TEST_VIDEO_SIZE, TEST_AUDIO_SIZE);
+
+    ASF_TEST_CHECK(header.Parse(file.GetData(), file.GetSize()) == S_OK);
+
+    if (!WriteTestFile(s_szMediaFile, file))
+    {
+        DeleteTestFile(s_szMediaFile);
+        printf("skipped: cannot write the test file\n");
+        return ASF_TEST_RESULT();
+    }
+
+    {
+        CASFReader reader;
+
+        ASF_TEST_CHECK(reader.Open(s_szMediaFile) == S_OK);
+        ASF_TEST_CHECK(reader.GetStreamCount() == 2);
+
+        TestExactSeek(reader);
+        TestGenerate(reader, header.GetDataOffset());
+        TestKeyFramesOnly(reader);
+        TestIndexedSeek(reader, header.GetDataOffset());
+
+        reader.Close();
+
+        ASF_TEST_CHECK(reader.Seek(ASF_TEST_VIDEO_STREAM, 0, NULL, NULL) == E_POINTER);
+        ASF_TEST_CHECK(reader.GenerateSamples(ASF_TEST_VIDEO_STREAM, 0, 0, 0, NULL) == MF_E_NOT_INITIALIZED);
+    }
+
+    DeleteTestFile(s_szMediaFile);
+
+    return ASF_TEST_RESULT();
+}
@@ -0,0 +1,220 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// SampleBatchTest.cpp : CASFSampleBatcher column block tests.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "ASFSampleBatch.h"
+#include "ASFTestData.h"
+
+//Checks each block against the samples added, by their index in the
+//generation
+class CTestBatchCallback : public IASFSampleBatchCallback
+{
+public:
+
+    CTestBatchCallback()
+    :   m_cBatches (0),
+        m_cSamples (0),
+        m_hrReturn (S_OK)
+    {
+    }
+
+    HRESULT OnSampleBatch(const ASF_SAMPLE_BATCH& batch)
+    {
+        ASF_TEST_CHECK(batch.iFirstSample == m_cSamples);
+
+        for (DWORD i = 0; i < batch.cSamples; i++)
+        {
+            DWORD iSample = (DWORD)batch.iFirstSample + i;
+
+            ASF_TEST_CHECK(batch.pwStreamNumbers[i] == GetStreamNumber(iSample));
+            ASF_TEST_CHECK(batch.phnsTimes[i] == GetTime(iSample));
+            ASF_TEST_CHECK(batch.pcbLengths[i] == 100 + iSample);
+            ASF_TEST_CHECK(batch.pcBuffers[i] == 1 + iSample % 3);
+            ASF_TEST_CHECK(batch.pfKeyFrames[i] == (IsKeyFrame(iSample) ? 1 : 0));
+            ASF_TEST_CHECK(batch.pfSeekedKeyFrames[i] == (IsSeekedKeyFrame(iSample) ? 1 : 0));
+        }
+
+        m_cBatches++;
+        m_cSamples += batch.cSamples;
+
+        return m_hrReturn;
+    }
+
+    static WORD GetStreamNumber(DWORD iSample)
+    {
+        return (WORD)(1 + iSample % 2);
+    }
+
+    static MFTIME GetTime(DWORD iSample)
+    {
+        return (MFTIME)iSample * 400000;
+    }
+
+    static BOOL IsKeyFrame(DWORD iSample)
+    {
+        return (iSample % 5 == 0) || IsSeekedKeyFrame(iSample);
+    }
+
+    //Only the first key frame, the one decoded for the seek
+    static BOOL IsSeekedKeyFrame(DWORD iSample)
+    {
+        return (iSample == 0);
+    }
+
+    static HRESULT AddSample(CASFSampleBatcher& batcher, DWORD iSample)
+    {
+        return batcher.Add(
+            GetStreamNumber(iSample),
+            GetTime(iSample),
+            100 + iSample,
+            1 + iSample % 3,
+            IsKeyFrame(iSample),
+            IsSeekedKeyFrame(iSample)
+            );
+    }
+
+    DWORD       m_cBatches;
+    DWORD       m_cSamples;
+    HRESULT     m_hrReturn;
+};
+
+static void TestInitialize()
+{
+    CASFSampleBatcher batcher;
+    CTestBatchCallback callback;
+
+    ASF_TEST_CHECK(!batcher.IsInitialized());
+    ASF_TEST_CHECK(batcher.Initialize(4, NULL) == E_POINTER);
+    ASF_TEST_CHECK(batcher.Initialize(ASF_SAMPLE_BATCH_MAX_SIZE + 1, &callback) == E_INVALIDARG);
+
+    ASF_TEST_CHECK(batcher.Initialize(0, &callback) == S_OK);
+    ASF_TEST_CHECK(batcher.IsInitialized());
+    ASF_TEST_CHECK(batcher.GetBatchSize() == ASF_SAMPLE_BATCH_DEFAULT_SIZE);
+
+    //Nothing to hand over
+    ASF_TEST_CHECK(batcher.Flush() == S_OK);
+    ASF_TEST_CHECK(callback.m_cBatches == 0);
+}
+
+//Full blocks go out as they fill; Flush hands over the rest
+static void TestBlocks()
+{
+    CASFSampleBatcher batcher;
+    CTestBatchCallback callback;
+
+    ASF_TEST_CHECK(batcher.Initialize(7, &callback) == S_OK);
+
+    for (DWORD i = 0; i < 30; i++)
+    {
+        ASF_TEST_CHECK(CTestBatchCallback::AddSample(batcher, i) == S_OK);
+        ASF_TEST_CHECK(callback.m_cSamples == (i + 1) / 7 * 7);
+    }
+
+    ASF_TEST_CHECK(batcher.GetBatchCount() == 4);
+    ASF_TEST_CHECK(batcher.Flush() == S_OK);
+    ASF_TEST_CHECK(batcher.GetBatchCount() == 5);
+    ASF_TEST_CHECK(callback.m_cSamples == 30);
+
+    //Reset drops the pending samples and restarts the index
+    CTestBatchCallback callback2;
+
+    ASF_TEST_CHECK(batcher.Initialize(7, &callback2) == S_OK);
+
+    for (DWORD i = 0; i < 3; i++)
+    {
+        ASF_TEST_CHECK(CTestBatchCallback::AddSample(batcher, i) == S_OK);
+    }
+
+    batcher.Reset();
+
+    ASF_TEST_CHECK(CTestBatchCallback::AddSample(batcher, 0) == S_OK);
+    ASF_TEST_CHECK(batcher.Flush() == S_OK);
+    ASF_TEST_CHECK(callback2.m_cBatches == 1);
+    ASF_TEST_CHECK(callback2.m_cSamples == 1);
+}
+
+//The callback result comes back from the Add that filled the block
+static void TestCallbackResult()
+{
+    CASFSampleBatcher batcher;
+    CTestBatchCallback callback;
+
+    callback.m_hrReturn = S_FALSE;
+
+    ASF_TEST_CHECK(batcher.Initialize(2, &callback) == S_OK);
+    ASF_TEST_CHECK(CTestBatchCallback::AddSample(batcher, 0) == S_OK);
+    ASF_TEST_CHECK(CTestBatchCallback::AddSample(batcher, 1) == S_FALSE);
+
+    callback.m_hrReturn = E_FAIL;
+
+    ASF_TEST_CHECK(CTestBatchCallback::AddSample(batcher, 2) == S_OK);
+    ASF_TEST_CHECK(batcher.Flush() == E_FAIL);
+}
+
+//Keeps the flags of the last sample handed over
+class CFlagsCallback : public IASFSampleBatchCallback
+{
+public:
+
+    CFlagsCallback()
+    :   m_fKeyFrame (0),
+        m_fSeekedKeyFrame (0)
+    {
+    }
+
+    HRESULT OnSampleBatch(const ASF_SAMPLE_BATCH& batch)
+    {
+        m_fKeyFrame = batch.pfKeyFrames[batch.cSamples - 1];
+        m_fSeekedKeyFrame = batch.pfSeekedKeyFrames[batch.cSamples - 1];
+        return S_OK;
+    }
+
+    BYTE    m_fKeyFrame;
+    BYTE    m_fSeekedKeyFrame;
+};
+
+//Key frames of the native reader are never marked as seeked
+static void TestReaderSamples()
+{
+    CASFSampleBatcher batcher;
+    CFlagsCallback callback;
+
+    ASF_TEST_CHECK(batcher.Initialize(1, &callback) == S_OK);
+
+    ASF_READER_SAMPLE sample = ASF_READER_SAMPLE();
+
+    sample.wStreamNumber = 1;
+    sample.fKeyFrame = TRUE;
+    sample.cbData = 100;
+
+    ASF_TEST_CHECK(batcher.OnSample(sample) == S_OK);
+    ASF_TEST_CHECK(callback.m_fKeyFrame == 1);
+    ASF_TEST_CHECK(callback.m_fSeekedKeyFrame == 0);
+
+    //Only a sample added with the flag is marked
+    ASF_TEST_CHECK(batcher.Add(1, 0, 100, 1, TRUE, TRUE) == S_OK);
+    ASF_TEST_CHECK(callback.m_fSeekedKeyFrame == 1);
+
+    ASF_TEST_CHECK(batcher.Add(1, 0, 100, 1, TRUE, FALSE) == S_OK);
+    ASF_TEST_CHECK(callback.m_fKeyFrame == 1);
+    ASF_TEST_CHECK(callback.m_fSeekedKeyFrame == 0);
+}
+
+int main()
+{
+    TestInitialize();
+    TestBlocks();
+    TestCallbackResult();
+    TestReaderSamples();
+
+    return ASF_TEST_RESULT();
+}
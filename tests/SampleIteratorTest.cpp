@@ -0,0 +1,326 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// SampleIteratorTest.cpp : CASFSampleIterator and CASFSample tests.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include "ASFSampleIterator.h"
+#include "ASFTestData.h"
+
+#define TEST_PACKET_SIZE    512
+#define TEST_PACKET_COUNT   140
+#define TEST_VIDEO_SIZE     300     // Two payloads per object, assembled in a slot
+#define TEST_AUDIO_SIZE     60      // One payload per object, in the mapping
+
+//More video objects than the iterator can hold
+#define TEST_VIDEO_OBJECTS  (TEST_PACKET_COUNT / 2)
+
+#ifdef _WIN32
+static const ASF_PATH_CHAR s_szMediaFile[] = L"SampleIteratorTest.asf";
+#else
+static const ASF_PATH_CHAR s_szMediaFile[] = "SampleIteratorTest.asf";
+#endif
+
+//The sample holds the bytes of its media object
+static BOOL CheckSampleData(const CASFSample& sample)
+{
+    const DWORD cbExpected = (sample.GetStreamNumber() == ASF_TEST_VIDEO_STREAM) ? TEST_VIDEO_SIZE : TEST_AUDIO_SIZE;
+
+    if (sample.IsEmpty() || !sample.GetData() || (sample.GetSize() != cbExpected))
+    {
+        return FALSE;
+    }
+
+    for (DWORD i = 0; i < sample.GetSize(); i++)
+    {
+        if (sample.GetData()[i] != GetTestObjectByte(sample.GetStreamNumber(), sample.GetInfo().dwMediaObjectNumber, i))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+//Releases a handle on a thread of its own
+static void ReleaseProc(void* pContext)
+{
+    ((CASFSample*)pContext)->Release();
+}
+
+//Audio objects point into the mapping, one packet apart, and take no
+//slot, so all of them can be held
+static void TestMappedSamples(CASFReader& reader)
+{
+    CASFSampleIterator iterator;
+    CASFSample rgSamples[TEST_PACKET_COUNT];
+    CASFSample extra;
+
+    ASF_TEST_CHECK(iterator.Begin(&reader, ASF_TEST_AUDIO_STREAM, 0, 0, 0) == S_OK);
+
+    for (DWORD i = 0; i < TEST_PACKET_COUNT; i++)
+    {
+        ASF_TEST_CHECK(iterator.Next(&rgSamples[i]) == S_OK);
+        ASF_TEST_CHECK(rgSamples[i].GetInfo().dwMediaObjectNumber == i);
+        ASF_TEST_CHECK(rgSamples[i].GetTime() == (MFTIME)i * ASF_TEST_PACKET_MS * 10000);
+        ASF_TEST_CHECK(rgSamples[i].IsKeyFrame());
+
+        if (i > 0)
+        {
+            ASF_TEST_CHECK(rgSamples[i].GetData() == rgSamples[i - 1].GetData() + TEST_PACKET_SIZE);
+        }
+    }
+
+    ASF_TEST_CHECK(iterator.Next(&extra) == S_FALSE);
+    ASF_TEST_CHECK(extra.IsEmpty());
+
+    for (DWORD i = 0; i < TEST_PACKET_COUNT; i++)
+    {
+        ASF_TEST_CHECK(CheckSampleData(rgSamples[i]));
+    }
+
+    iterator.End();
+}
+
+//Video objects are assembled in slots. One handle reused for every
+//Next recycles one slot; a second handle uses a second slot, and the
+//sample of each stays intact while the other is pulled.
+static void TestSlotSamples(CASFReader& reader)
+{
+    CASFSampleIterator iterator;
+    CASFSample sample;
+    CASFSample rgPair[2];
+
+    const BYTE* pSlot = NULL;
+    DWORD cSamples = 0;
+
+    ASF_TEST_CHECK(iterator.Begin(&reader, ASF_TEST_VIDEO_STREAM, 0, 0, 0) == S_OK);
+    ASF_TEST_CHECK(iterator.Begin(&reader, ASF_TEST_VIDEO_STREAM, 0, 0, 0) == MF_E_INVALIDREQUEST);
+
+    while (iterator.Next(&sample) == S_OK)
+    {
+        ASF_TEST_CHECK(CheckSampleData(sample));
+        ASF_TEST_CHECK(sample.GetInfo().dwMediaObjectNumber == cSamples);
+        ASF_TEST_CHECK(!sample.IsKeyFrame() == !(cSamples % ASF_TEST_KEY_FRAME_INTERVAL == 0));
+
+        if (cSamples == 0)
+        {
+            pSlot = sample.GetData();
+        }
+
+        ASF_TEST_CHECK(sample.GetData() == pSlot);
+        cSamples++;
+    }
+
+    ASF_TEST_CHECK(cSamples == TEST_VIDEO_OBJECTS);
+    ASF_TEST_CHECK(sample.IsEmpty());
+
+    iterator.End();
+
+    ASF_TEST_CHECK(iterator.Begin(&reader, ASF_TEST_VIDEO_STREAM, 0, 0, 0) == S_OK);
+
+    ASF_TEST_CHECK(iterator.Next(&rgPair[0]) == S_OK);
+
+    for (DWORD i = 1; i < TEST_VIDEO_OBJECTS; i++)
+    {
+        CASFSample& next = rgPair[i % 2];
+        CASFSample& held = rgPair[1 - i % 2];
+
+        ASF_TEST_CHECK(iterator.Next(&next) == S_OK);
+        ASF_TEST_CHECK(next.GetData() != held.GetData());
+        ASF_TEST_CHECK(CheckSampleData(next));
+        ASF_TEST_CHECK(CheckSampleData(held));
+    }
+
+    iterator.End();
+}
+
+//MoveTo hands the sample and its slot over without copying the data
+static void TestMoveTo(CASFReader& reader)
+{
+    CASFSampleIterator iterator;
+    CASFSample sample, target, other;
+    CASFThread thread;
+
+    ASF_TEST_CHECK(iterator.Begin(&reader, ASF_TEST_VIDEO_STREAM, 0, 0, 0) == S_OK);
+    ASF_TEST_CHECK(iterator.Next(&sample) == S_OK);
+
+    const BYTE* pFirst = sample.GetData();
+
+    sample.MoveTo(&sample);
+    ASF_TEST_CHECK(sample.GetData() == pFirst);
+
+    sample.MoveTo(&target);
+    ASF_TEST_CHECK(sample.IsEmpty());
+    ASF_TEST_CHECK(!sample.GetData());
+    ASF_TEST_CHECK(target.GetData() == pFirst);
+    ASF_TEST_CHECK(target.GetInfo().dwMediaObjectNumber == 0);
+    ASF_TEST_CHECK(CheckSampleData(target));
+
+    //The target keeps the slot, so the next object goes elsewhere
+    ASF_TEST_CHECK(iterator.Next(&sample) == S_OK);
+
+    const BYTE* pSecond = sample.GetData();
+
+    ASF_TEST_CHECK(pSecond != pFirst);
+    ASF_TEST_CHECK(CheckSampleData(target));
+
+    //Moving onto a held sample releases it
+    sample.MoveTo(&target);
+    ASF_TEST_CHECK(target.GetData() == pSecond);
+    ASF_TEST_CHECK(target.GetInfo().dwMediaObjectNumber == 1);
+
+    ASF_TEST_CHECK(iterator.Next(&sample) == S_OK);
+    ASF_TEST_CHECK(sample.GetData() == pFirst);
+
+    //Released on another thread, e.g. by a consumer
+    target.MoveTo(&other);
+    ASF_TEST_CHECK(thread.Start(ReleaseProc, &other) == S_OK);
+    thread.Join();
+    ASF_TEST_CHECK(other.IsEmpty());
+
+    ASF_TEST_CHECK(iterator.Next(&target) == S_OK);
+    ASF_TEST_CHECK(target.GetData() == pSecond);
+
+    iterator.End();
+}
+
+//Every slot held: the next assembled sample fails until one is released
+static void TestMaxHeld(CASFReader& reader)
+{
+    CASFSampleIterator iterator;
+    CASFSample rgSamples[ASF_SAMPLE_ITERATOR_MAX_HELD];
+    CASFSample extra;
+
+    ASF_TEST_CHECK(iterator.Begin(&reader, ASF_TEST_VIDEO_STREAM, 0, 0, 0) == S_OK);
+
+    for (DWORD i = 0; i < ASF_SAMPLE_ITERATOR_MAX_HELD; i++)
+    {
+        ASF_TEST_CHECK(iterator.Next(&rgSamples[i]) == S_OK);
+
+        for (DWORD j = 0; j < i; j++)
+        {
+            ASF_TEST_CHECK(rgSamples[i].GetData() != rgSamples[j].GetData());
+        }
+    }
+
+    ASF_TEST_CHECK(iterator.Next(&extra) == E_OUTOFMEMORY);
+    ASF_TEST_CHECK(extra.IsEmpty());
+
+    for (DWORD i = 0; i < ASF_SAMPLE_ITERATOR_MAX_HELD; i++)
+    {
+        ASF_TEST_CHECK(CheckSampleData(rgSamples[i]));
+    }
+
+    //The object that failed is dropped; later ones use the freed slot
+    const BYTE* pFreed = rgSamples[5].GetData();
+
+    rgSamples[5].Release();
+
+    ASF_TEST_CHECK(iterator.Next(&extra) == S_OK);
+    ASF_TEST_CHECK(extra.GetData() == pFreed);
+    ASF_TEST_CHECK(extra.GetInfo().dwMediaObjectNumber > ASF_SAMPLE_ITERATOR_MAX_HELD);
+    ASF_TEST_CHECK(CheckSampleData(extra));
+
+    iterator.End();
+}
+
+//End while handles are held: the samples stay valid, and the iterator
+//can begin again before they are released
+static void TestEarlyEnd(CASFReader& reader)
+{
+    CASFSampleIterator iterator;
+    CASFSample rgVideo[3];
+    CASFSample audio, next;
+
+    ASF_TEST_CHECK(iterator.Next(&next) == MF_E_INVALIDREQUEST);
+
+    ASF_TEST_CHECK(iterator.Begin(&reader, ASF_TEST_VIDEO_STREAM, 0, 0, 0) == S_OK);
+
+    for (DWORD i = 0; i < 3; i++)
+    {
+        ASF_TEST_CHECK(iterator.Next(&rgVideo[i]) == S_OK);
+    }
+
+    iterator.End();
+    iterator.End();
+
+    ASF_TEST_CHECK(iterator.Next(&next) == MF_E_INVALIDREQUEST);
+    ASF_TEST_CHECK(next.IsEmpty());
+
+    for (DWORD i = 0; i < 3; i++)
+    {
+        ASF_TEST_CHECK(CheckSampleData(rgVideo[i]));
+    }
+
+    //The reader is free for a generation of its own
+    ASF_TEST_CHECK(reader.GenerateSamples(ASF_TEST_AUDIO_STREAM, 0, 0, 0, NULL) == E_INVALIDARG);
+
+    //A second pass from 10 seconds does not touch the held slots
+    ASF_TEST_CHECK(iterator.Begin(&reader, ASF_TEST_VIDEO_STREAM, 100000000, 0, 0) == S_OK);
+
+    for (DWORD i = 0; i < 4; i++)
+    {
+        ASF_TEST_CHECK(iterator.Next(&next) == S_OK);
+        ASF_TEST_CHECK(CheckSampleData(next));
+        ASF_TEST_CHECK(next.GetTime() >= 80000000);
+
+        for (DWORD j = 0; j < 3; j++)
+        {
+            ASF_TEST_CHECK(next.GetData() != rgVideo[j].GetData());
+            ASF_TEST_CHECK(CheckSampleData(rgVideo[j]));
+        }
+    }
+
+    iterator.End();
+
+    ASF_TEST_CHECK(iterator.Begin(&reader, ASF_TEST_AUDIO_STREAM, 0, 0, 0) == S_OK);
+    ASF_TEST_CHECK(iterator.Next(&audio) == S_OK);
+
+    iterator.End();
+
+    ASF_TEST_CHECK(CheckSampleData(audio));
+
+    ASF_TEST_CHECK(iterator.Begin(NULL, ASF_TEST_AUDIO_STREAM, 0, 0, 0) == E_POINTER);
+    ASF_TEST_CHECK(iterator.Next(NULL) == E_POINTER);
+}
+
+int main()
+{
+    CASFTestWriter file;
+
+    WriteTestMediaFile(file, TEST_PACKET_SIZE, TEST_PACKET_COUNT, TEST_VIDEO_SIZE, TEST_AUDIO_SIZE);
+
+    if (!WriteTestFile(s_szMediaFile, file))
+    {
+        DeleteTestFile(s_szMediaFile);
+        printf("skipped: cannot write the test file\n");
+        return ASF_TEST_RESULT();
+    }
+
+    {
+        CASFReader reader;
+
+        ASF_TEST_CHECK(reader.Open(s_szMediaFile) == S_OK);
+
+        TestMappedSamples(reader);
+        TestSlotSamples(reader);
+        TestMoveTo(reader);
+        TestMaxHeld(reader);
+        TestEarlyEnd(reader);
+
+        reader.Close();
+    }
+
+    DeleteTestFile(s_szMediaFile);
+
+    return ASF_TEST_RESULT();
+}
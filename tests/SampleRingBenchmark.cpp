@@ -0,0 +1,173 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// SampleRingBenchmark.cpp : Throughput of a simulated demux and decode,
+// run serially and pipelined through CASFSampleRing.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ASFSampleRing.h"
+#include "ASFThread.h"
+#include "ASFTestData.h"
+
+#define BENCH_SAMPLES_PER_ROUND     20000
+#define BENCH_DEFAULT_ROUNDS        10
+
+//Work per sample, in iterations of SimulateWork. Decoding costs more
+//than demuxing, as with compressed video.
+#define BENCH_DEMUX_WORK            200
+#define BENCH_DECODE_WORK           300
+
+//Stands in for parsing or decoding one sample. The result depends on
+//every iteration, so the loop cannot be optimized away.
+static DWORD SimulateWork(DWORD dwValue, DWORD cIterations)
+{
+    for (DWORD i = 0; i < cIterations; i++)
+    {
+        dwValue ^= dwValue << 13;
+        dwValue ^= dwValue >> 17;
+        dwValue ^= dwValue << 5;
+    }
+
+    return dwValue;
+}
+
+static DWORD Demux(DWORD iSample)
+{
+    return SimulateWork(iSample + 1, BENCH_DEMUX_WORK);
+}
+
+static DWORD Decode(DWORD dwSample)
+{
+    return SimulateWork(dwSample, BENCH_DECODE_WORK);
+}
+
+//Demux and decode on one thread, one sample after the other
+static double RunSerial(DWORD cSamples, DWORD* pdwChecksum)
+{
+    DWORD dwChecksum = 0;
+    LONGLONG llStart = CASFThread::GetTimestamp();
+
+    for (DWORD i = 0; i < cSamples; i++)
+    {
+        dwChecksum += Decode(Demux(i));
+    }
+
+    LONGLONG hnsElapsed = CASFThread::GetTimestamp() - llStart;
+
+    *pdwChecksum = dwChecksum;
+
+    return (double)hnsElapsed / 10000.0;
+}
+
+
+struct BENCH_DEMUX
+{
+    CASFSampleRing* pRing;
+    DWORD           cSamples;
+};
+
+static void DemuxProc(void* pContext)
+{
+    BENCH_DEMUX* pDemux = (BENCH_DEMUX*)pContext;
+
+    for (DWORD i = 0; i < pDemux->cSamples; i++)
+    {
+        ASF_SAMPLE_RING_ENTRY entry = { (void*)(size_t)Demux(i), 1 };
+
+        if (pDemux->pRing->Push(entry) != S_OK)
+        {
+            break;
+        }
+    }
+
+    pDemux->pRing->Close();
+}
+
+//Demux on a second thread, decode on this one, through the ring
+static double RunPipelined(DWORD cSamples, DWORD cDepth, DWORD* pdwChecksum, ASF_SAMPLE_RING_STATS* pStats)
+{
+    CASFSampleRing ring;
+    CASFThread thread;
+    ASF_SAMPLE_RING_ENTRY entry;
+
+    DWORD dwChecksum = 0;
+
+    ASF_TEST_CHECK(ring.Initialize(cDepth) == S_OK);
+
+    BENCH_DEMUX demux = { &ring, cSamples };
+
+    LONGLONG llStart = CASFThread::GetTimestamp();
+
+    ASF_TEST_CHECK(thread.Start(DemuxProc, &demux) == S_OK);
+
+    while (ring.Pop(&entry) == S_OK)
+    {
+        dwChecksum += Decode((DWORD)(size_t)entry.pSample);
+    }
+
+    thread.Join();
+
+    LONGLONG hnsElapsed = CASFThread::GetTimestamp() - llStart;
+
+    ring.GetStats(pStats);
+    *pdwChecksum = dwChecksum;
+
+    return (double)hnsElapsed / 10000.0;
+}
+
+//Usage: SampleRingBenchmark [rounds]
+//Timings are only meaningful in an optimized build, for example with
+//-DCMAKE_BUILD_TYPE=Release, on a machine with at least two cores.
+int main(int argc, char* argv[])
+{
+    DWORD cRounds = (argc > 1) ? (DWORD)atoi(argv[1]) : BENCH_DEFAULT_ROUNDS;
+
+    if (cRounds == 0)
+    {
+        cRounds = 1;
+    }
+
+    const DWORD cSamples = cRounds * BENCH_SAMPLES_PER_ROUND;
+    const DWORD rgcDepths[] = { 1, 8, ASF_SAMPLE_RING_DEFAULT_SIZE };
+
+    DWORD dwSerialChecksum = 0;
+
+    printf("%u samples, %u processors\n", cSamples, CASFThread::GetProcessorCount());
+
+    double msSerial = RunSerial(cSamples, &dwSerialChecksum);
+
+    printf("serial               %8.1f ms, %10.0f samples/s\n",
+        msSerial,
+        (msSerial > 0) ? cSamples * 1000.0 / msSerial : 0.0);
+
+    for (DWORD i = 0; i < sizeof(rgcDepths) / sizeof(rgcDepths[0]); i++)
+    {
+        ASF_SAMPLE_RING_STATS stats;
+        DWORD dwChecksum = 0;
+
+        double msPipelined = RunPipelined(cSamples, rgcDepths[i], &dwChecksum, &stats);
+
+        printf("pipelined, depth %-3u %8.1f ms, %10.0f samples/s, %.2fx, %llu producer waits, %llu consumer waits\n",
+            rgcDepths[i],
+            msPipelined,
+            (msPipelined > 0) ? cSamples * 1000.0 / msPipelined : 0.0,
+            (msPipelined > 0) ? msSerial / msPipelined : 0.0,
+            (unsigned long long)stats.cProducerWaits,
+            (unsigned long long)stats.cConsumerWaits);
+
+        //Both runs must have decoded the same samples
+        ASF_TEST_CHECK(dwChecksum == dwSerialChecksum);
+        ASF_TEST_CHECK(stats.cPushed == cSamples);
+    }
+
+    return ASF_TEST_RESULT();
+}
@@ -0,0 +1,259 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// SampleRingTest.cpp : CASFSampleRing single and two thread tests.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "ASFSampleRing.h"
+#include "ASFThread.h"
+#include "ASFTestData.h"
+
+#define TEST_SAMPLE_COUNT   200000
+
+static ASF_SAMPLE_RING_ENTRY MakeEntry(DWORD i)
+{
+    ASF_SAMPLE_RING_ENTRY entry = { (void*)(size_t)(i + 1), (WORD)(i & 0x7F) };
+    return entry;
+}
+
+static BOOL IsEntry(const ASF_SAMPLE_RING_ENTRY& entry, DWORD i)
+{
+    return (entry.pSample == (void*)(size_t)(i + 1)) && (entry.wStreamNumber == (WORD)(i & 0x7F));
+}
+
+static void TestInitialize()
+{
+    CASFSampleRing ring;
+    ASF_SAMPLE_RING_ENTRY entry;
+
+    ASF_TEST_CHECK(ring.Push(MakeEntry(0)) == MF_E_NOT_INITIALIZED);
+    ASF_TEST_CHECK(ring.Pop(&entry) == MF_E_NOT_INITIALIZED);
+    ASF_TEST_CHECK(!ring.TryPop(&entry));
+
+    ASF_TEST_CHECK(ring.Initialize(ASF_SAMPLE_RING_MAX_SIZE + 1) == E_INVALIDARG);
+
+    ASF_TEST_CHECK(ring.Initialize(0) == S_OK);
+    ASF_TEST_CHECK(ring.GetCapacity() == ASF_SAMPLE_RING_DEFAULT_SIZE);
+
+    ASF_TEST_CHECK(ring.Initialize(5) == S_OK);
+    ASF_TEST_CHECK(ring.GetCapacity() == 8);
+
+    ASF_TEST_CHECK(ring.Initialize(1) == S_OK);
+    ASF_TEST_CHECK(ring.GetCapacity() == 1);
+
+    ASF_TEST_CHECK(ring.Pop(NULL) == E_POINTER);
+}
+
+//Entries come out in push order while the indexes wrap many times
+static void TestOrderAndWrap()
+{
+    CASFSampleRing ring;
+    ASF_SAMPLE_RING_ENTRY entry;
+    ASF_SAMPLE_RING_STATS stats;
+
+    ASF_TEST_CHECK(ring.Initialize(8) == S_OK);
+
+    DWORD iPush = 0, iPop = 0;
+
+    //Batches of 3 and 5 leave the ring at every offset
+    for (DWORD iBatch = 0; iBatch < 100; iBatch++)
+    {
+        DWORD cBatch = (iBatch % 2) ? 5 : 3;
+
+        for (DWORD i = 0; i < cBatch; i++)
+        {
+            ASF_TEST_CHECK(ring.Push(MakeEntry(iPush++)) == S_OK);
+        }
+
+        for (DWORD i = 0; i < cBatch; i++)
+        {
+            ASF_TEST_CHECK(ring.TryPop(&entry));
+            ASF_TEST_CHECK(IsEntry(entry, iPop++));
+        }
+
+        ASF_TEST_CHECK(!ring.TryPop(&entry));
+    }
+
+    //A full ring, across the wrap
+    for (DWORD i = 0; i < 8; i++)
+    {
+        ASF_TEST_CHECK(ring.Push(MakeEntry(iPush++)) == S_OK);
+    }
+
+    for (DWORD i = 0; i < 8; i++)
+    {
+        ASF_TEST_CHECK(ring.Pop(&entry) == S_OK);
+        ASF_TEST_CHECK(IsEntry(entry, iPop++));
+    }
+
+    ring.GetStats(&stats);
+    ASF_TEST_CHECK(stats.cPushed == iPush);
+    ASF_TEST_CHECK(stats.cMaxOccupancy == 8);
+    ASF_TEST_CHECK(stats.cProducerWaits == 0);
+}
+
+//Close lets the consumer drain what is left, then ends the stream
+static void TestCloseDrains()
+{
+    CASFSampleRing ring;
+    ASF_SAMPLE_RING_ENTRY entry;
+
+    ASF_TEST_CHECK(ring.Initialize(4) == S_OK);
+
+    for (DWORD i = 0; i < 4; i++)
+    {
+        ASF_TEST_CHECK(ring.Push(MakeEntry(i)) == S_OK);
+    }
+
+    ring.Close();
+
+    for (DWORD i = 0; i < 4; i++)
+    {
+        ASF_TEST_CHECK(ring.Pop(&entry) == S_OK);
+        ASF_TEST_CHECK(IsEntry(entry, i));
+    }
+
+    ASF_TEST_CHECK(ring.Pop(&entry) == S_FALSE);
+    ASF_TEST_CHECK(ring.Pop(&entry) == S_FALSE);
+
+    //Reset opens the ring again
+    ring.Reset();
+
+    ASF_TEST_CHECK(ring.Push(MakeEntry(7)) == S_OK);
+    ASF_TEST_CHECK(ring.Pop(&entry) == S_OK);
+    ASF_TEST_CHECK(IsEntry(entry, 7));
+}
+
+
+struct TEST_PRODUCER
+{
+    CASFSampleRing* pRing;
+    DWORD           cEntries;
+    volatile LONG   cPushed;
+    HRESULT         hrLast;
+};
+
+static void ProducerProc(void* pContext)
+{
+    TEST_PRODUCER* pProducer = (TEST_PRODUCER*)pContext;
+
+    for (DWORD i = 0; i < pProducer->cEntries; i++)
+    {
+        pProducer->hrLast = pProducer->pRing->Push(MakeEntry(i));
+
+        if (pProducer->hrLast != S_OK)
+        {
+            break;
+        }
+
+        ASFStoreRelease(&pProducer->cPushed, i + 1);
+    }
+
+    pProducer->pRing->Close();
+}
+
+//Stop releases a producer that waits on a full ring
+static void TestStopReleasesProducer()
+{
+    CASFSampleRing ring;
+    ASF_SAMPLE_RING_ENTRY entry;
+    ASF_SAMPLE_RING_STATS stats;
+    CASFThread thread;
+
+    ASF_TEST_CHECK(ring.Initialize(4) == S_OK);
+
+    TEST_PRODUCER producer = { &ring, 100, 0, E_FAIL };
+
+    ASF_TEST_CHECK(thread.Start(ProducerProc, &producer) == S_OK);
+
+    while (ASFLoadAcquire(&producer.cPushed) < 4)
+    {
+        CASFThread::YieldThread();
+    }
+
+    //Give the producer time to block on the fifth entry
+    CASFThread::SleepThread(20);
+    ASF_TEST_CHECK(ASFLoadAcquire(&producer.cPushed) == 4);
+
+    ring.Stop();
+    thread.Join();
+
+    ASF_TEST_CHECK(ring.IsStopped());
+    ASF_TEST_CHECK(producer.hrLast == S_FALSE);
+    ASF_TEST_CHECK(producer.cPushed == 4);
+
+    ring.GetStats(&stats);
+    ASF_TEST_CHECK(stats.cPushed == 4);
+    ASF_TEST_CHECK(stats.cProducerWaits == 1);
+
+    //The queued entries stay for the consumer to release
+    for (DWORD i = 0; i < 4; i++)
+    {
+        ASF_TEST_CHECK(ring.TryPop(&entry));
+        ASF_TEST_CHECK(IsEntry(entry, i));
+    }
+
+    ASF_TEST_CHECK(!ring.TryPop(&entry));
+
+    //Pushes after Stop are refused
+    ASF_TEST_CHECK(ring.Push(MakeEntry(0)) == S_FALSE);
+}
+
+//Every entry arrives once and in order across two threads
+static void TestTwoThreads(DWORD cCapacity)
+{
+    CASFSampleRing ring;
+    ASF_SAMPLE_RING_ENTRY entry;
+    ASF_SAMPLE_RING_STATS stats;
+    CASFThread thread;
+
+    ASF_TEST_CHECK(ring.Initialize(cCapacity) == S_OK);
+
+    TEST_PRODUCER producer = { &ring, TEST_SAMPLE_COUNT, 0, E_FAIL };
+
+    ASF_TEST_CHECK(thread.Start(ProducerProc, &producer) == S_OK);
+
+    DWORD cPopped = 0;
+    DWORD cOutOfOrder = 0;
+    HRESULT hr = S_OK;
+
+    while ((hr = ring.Pop(&entry)) == S_OK)
+    {
+        if (!IsEntry(entry, cPopped))
+        {
+            cOutOfOrder++;
+        }
+
+        cPopped++;
+    }
+
+    thread.Join();
+
+    ASF_TEST_CHECK(hr == S_FALSE);
+    ASF_TEST_CHECK(producer.hrLast == S_OK);
+    ASF_TEST_CHECK(cPopped == TEST_SAMPLE_COUNT);
+    ASF_TEST_CHECK(cOutOfOrder == 0);
+
+    ring.GetStats(&stats);
+    ASF_TEST_CHECK(stats.cPushed == TEST_SAMPLE_COUNT);
+    ASF_TEST_CHECK(stats.cMaxOccupancy <= ring.GetCapacity());
+}
+
+int main()
+{
+    TestInitialize();
+    TestOrderAndWrap();
+    TestCloseDrains();
+    TestStopReleasesProducer();
+    TestTwoThreads(1);
+    TestTwoThreads(ASF_SAMPLE_RING_DEFAULT_SIZE);
+
+    return ASF_TEST_RESULT();
+}
@@ -0,0 +1,182 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// SeekEngineTest.cpp : CASFSeekEngine tests on hand-built packets.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "ASFSeekEngine.h"
+#include "ASFTestData.h"
+
+//Replicated data BYTE, offset DWORD, object number BYTE, stream number BYTE
+#define TEST_PROPERTY_FLAGS     0x5D
+
+#define TEST_PACKET_SIZE        128
+#define TEST_PACKET_COUNT       1000
+#define TEST_SEND_INTERVAL      100     // Milliseconds between packets
+#define TEST_PRESENT_DELAY      50      // From send to presentation
+
+//Stream 1 has an object in every packet. Stream 2 starts late, in
+//packet 900. Stream 3 has two objects, in packets 100 and 150.
+static BOOL HasObject(WORD wStreamNumber, DWORD iPacket)
+{
+    switch (wStreamNumber)
+    {
+    case 1:
+        return TRUE;
+    case 2:
+        return (iPacket == 900);
+    case 3:
+        return (iPacket == 100) || (iPacket == 150);
+    }
+
+    return FALSE;
+}
+
+static void WriteTestPackets(CASFTestWriter& packets)
+{
+    static const BYTE rgbData[8] = { 0 };
+
+    for (DWORD i = 0; i < TEST_PACKET_COUNT; i++)
+    {
+        const DWORD dwSendTime = i * TEST_SEND_INTERVAL;
+
+        ASF_TEST_PACKET header =
+        {
+            0, ASF_PACKET_MULTIPLE_PAYLOADS | (2 << ASF_PADDING_LENGTH_TYPE_SHIFT), TEST_PROPERTY_FLAGS, 2,
+            TEST_PACKET_SIZE, 0, dwSendTime, TEST_SEND_INTERVAL
+        };
+
+        ASF_TEST_PAYLOAD rgPayloads[3];
+        DWORD cPayloads = 0;
+
+        for (WORD wStream = 1; wStream <= 3; wStream++)
+        {
+            if (HasObject(wStream, i))
+            {
+                ASF_TEST_PAYLOAD payload =
+                {
+                    (BYTE)wStream, i, 0, 8, sizeof(rgbData), dwSendTime + TEST_PRESENT_DELAY, rgbData, sizeof(rgbData)
+                };
+
+                rgPayloads[cPayloads++] = payload;
+            }
+        }
+
+        WriteTestPacket(packets, header, rgPayloads, cPayloads);
+    }
+}
+
+static void CheckFind(
+    CASFSeekEngine& engine,
+    DWORD dwTime,
+    WORD wStreamNumber,
+    QWORD iExpected,
+    BOOL fCapped
+    )
+{
+    QWORD iPacket = 0;
+
+    ASF_TEST_CHECK(engine.FindPacket(dwTime, wStreamNumber, &iPacket, NULL) == S_OK);
+    ASF_TEST_CHECK(iPacket == iExpected);
+    ASF_TEST_CHECK(engine.IsSearchCapped() == fCapped);
+}
+
+//Searches that find the object within the window
+static void TestFindObject(const CASFTestWriter& packets)
+{
+    CASFSeekEngine engine;
+    QWORD iPacket = 0, iSendBoundary = 0;
+
+    ASF_TEST_CHECK(engine.FindPacket(0, 1, &iPacket, NULL) == MF_E_NOT_INITIALIZED);
+    ASF_TEST_CHECK(engine.Initialize(packets.GetData(), TEST_PACKET_COUNT, TEST_PACKET_SIZE, 0) == S_OK);
+
+    ASF_TEST_CHECK(engine.FindPacket(50050, 1, &iPacket, &iSendBoundary) == S_OK);
+    ASF_TEST_CHECK(iPacket == 500);
+    ASF_TEST_CHECK(iSendBoundary == 501);
+    ASF_TEST_CHECK(!engine.IsSearchCapped());
+    ASF_TEST_CHECK(engine.GetPacketReadCount() < 40);
+
+    //Just before the object is presented
+    CheckFind(engine, 50049, 1, 499, FALSE);
+
+    //Before the first object of a stream
+    CheckFind(engine, 10, 1, 0, FALSE);
+
+    //The late stream, after its start and within the window
+    CheckFind(engine, 95000, 2, 900, FALSE);
+
+    //The sparse stream, from its last object within the window
+    CheckFind(engine, 24000, 3, 150, FALSE);
+}
+
+//Searches that stop at the window instead of reading back to the
+//first packet
+static void TestBoundedWalk(const CASFTestWriter& packets)
+{
+    CASFSeekEngine engine;
+    QWORD iPacket = 0, iSendBoundary = 0;
+
+    const DWORD cWindowPackets = ASF_SEEK_MAX_OBJECT_SPACING / TEST_SEND_INTERVAL;
+
+    ASF_TEST_CHECK(engine.Initialize(packets.GetData(), TEST_PACKET_COUNT, TEST_PACKET_SIZE, 0) == S_OK);
+
+    //The late stream before its start seeks to the send boundary
+    ASF_TEST_CHECK(engine.FindPacket(50000, 2, &iPacket, &iSendBoundary) == S_OK);
+    ASF_TEST_CHECK(iSendBoundary == 501);
+    ASF_TEST_CHECK(iPacket == iSendBoundary);
+    ASF_TEST_CHECK(engine.IsSearchCapped());
+
+    DWORD cReads = engine.GetPacketReadCount();
+
+    ASF_TEST_CHECK(engine.FindSendBoundary(50000, &iSendBoundary) == S_OK);
+    ASF_TEST_CHECK(cReads - engine.GetPacketReadCount() == cWindowPackets + 2);
+
+    //The sparse stream after its last object left the window
+    CheckFind(engine, 26000, 3, 261, TRUE);
+
+    //A stream that is not in the file, after the last packet, seeks to
+    //where the walk stopped
+    CheckFind(engine, 200000, 4, TEST_PACKET_COUNT - 1, TRUE);
+    CheckFind(engine, 104900, 4, 948, TRUE);
+
+    //No object before the window start, but the walk reached packet 0
+    CheckFind(engine, 5000, 2, 51, FALSE);
+}
+
+//The preroll widens the window
+static void TestPrerollWindow(const CASFTestWriter& packets)
+{
+    CASFSeekEngine engine;
+
+    ASF_TEST_CHECK(engine.Initialize(packets.GetData(), TEST_PACKET_COUNT, TEST_PACKET_SIZE, 15000) == S_OK);
+
+    CheckFind(engine, 26000, 3, 150, FALSE);
+    CheckFind(engine, 50000, 2, 501, TRUE);
+
+    DWORD cReads = engine.GetPacketReadCount();
+    QWORD iSendBoundary = 0;
+
+    ASF_TEST_CHECK(engine.FindSendBoundary(50000, &iSendBoundary) == S_OK);
+    ASF_TEST_CHECK(cReads - engine.GetPacketReadCount() == (ASF_SEEK_MAX_OBJECT_SPACING + 15000) / TEST_SEND_INTERVAL + 2);
+}
+
+int main()
+{
+    CASFTestWriter packets;
+
+    WriteTestPackets(packets);
+    ASF_TEST_CHECK(packets.GetSize() == (size_t)TEST_PACKET_COUNT * TEST_PACKET_SIZE);
+
+    TestFindObject(packets);
+    TestBoundedWalk(packets);
+    TestPrerollWindow(packets);
+
+    return ASF_TEST_RESULT();
+}
@@ -0,0 +1,170 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// SparseScannerTest.cpp : CASFSparseScanner tests against a full scan.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "ASFSparseScanner.h"
+#include "ASFReader.h"
+#include "ASFTestData.h"
+
+//Packets above ASF_SPARSE_MIN_STRIDE, read as prefixes. The video
+//payload is large enough to push the audio payload header past the
+//prefix, so every packet needs more reads.
+#define TEST_LARGE_PACKET_SIZE  8192
+#define TEST_LARGE_VIDEO_SIZE   6000
+
+//Packets below ASF_SPARSE_MIN_STRIDE, read whole
+#define TEST_SMALL_PACKET_SIZE  512
+#define TEST_SMALL_VIDEO_SIZE   300
+
+#define TEST_AUDIO_SIZE         60
+#define TEST_PACKET_COUNT       40
+
+#ifdef _WIN32
+static const ASF_PATH_CHAR s_szMediaFile[] = L"SparseScannerTest.asf";
+#else
+static const ASF_PATH_CHAR s_szMediaFile[] = "SparseScannerTest.asf";
+#endif
+
+//The sparse scan and the full scan of the reader agree on every sample
+static void CheckTimelines(const CASFSparseScanner& scanner, const CASFReader& reader)
+{
+    const WORD rgwStreams[] = { ASF_TEST_VIDEO_STREAM, ASF_TEST_AUDIO_STREAM };
+
+    for (DWORD s = 0; s < 2; s++)
+    {
+        const CASFTimeline* pSparse = NULL;
+        const CASFTimeline* pFull = NULL;
+
+        ASF_TEST_CHECK(scanner.GetTimeline(rgwStreams[s], &pSparse) == S_OK);
+        ASF_TEST_CHECK(reader.GetTimeline(rgwStreams[s], &pFull) == S_OK);
+
+        if (!pSparse || !pFull)
+        {
+            continue;
+        }
+
+        ASF_TEST_CHECK(pSparse->GetCount() > 0);
+        ASF_TEST_CHECK(pSparse->GetCount() == pFull->GetCount());
+
+        for (DWORD i = 0; (i < pSparse->GetCount()) && (i < pFull->GetCount()); i++)
+        {
+            ASF_TIMELINE_ENTRY sparse, full;
+
+            ASF_TEST_CHECK(pSparse->GetEntry(i, &sparse) == S_OK);
+            ASF_TEST_CHECK(pFull->GetEntry(i, &full) == S_OK);
+
+            ASF_TEST_CHECK(sparse.hnsTime == full.hnsTime);
+            ASF_TEST_CHECK(sparse.cbPacketOffset == full.cbPacketOffset);
+            ASF_TEST_CHECK(sparse.cbSize == full.cbSize);
+            ASF_TEST_CHECK(!sparse.fKeyFrame == !full.fKeyFrame);
+        }
+    }
+
+    const CASFTimeline* pNone = NULL;
+    ASF_TEST_CHECK(scanner.GetTimeline(3, &pNone) == reader.GetTimeline(3, &pNone));
+}
+
+//Payload bytes per second of send time: two packets per bucket
+static void CheckProfiles(const CASFSparseScanner& scanner, DWORD cbVideoObject)
+{
+    const QWORD* pcbBuckets = NULL;
+    DWORD cBuckets = 0;
+
+    const DWORD cPacketsPerBucket = ASF_SPARSE_BUCKET_MS / ASF_TEST_PACKET_MS;
+
+    ASF_TEST_CHECK(scanner.GetBucketDuration() == ASF_SPARSE_BUCKET_MS);
+
+    ASF_TEST_CHECK(scanner.GetBitrateProfile(ASF_TEST_VIDEO_STREAM, &pcbBuckets, &cBuckets) == S_OK);
+    ASF_TEST_CHECK(cBuckets == TEST_PACKET_COUNT / cPacketsPerBucket);
+
+    for (DWORD i = 0; pcbBuckets && (i < cBuckets); i++)
+    {
+        ASF_TEST_CHECK(pcbBuckets[i] == cbVideoObject * cPacketsPerBucket / 2);
+    }
+
+    ASF_TEST_CHECK(scanner.GetBitrateProfile(ASF_TEST_AUDIO_STREAM, &pcbBuckets, &cBuckets) == S_OK);
+    ASF_TEST_CHECK(cBuckets == TEST_PACKET_COUNT / cPacketsPerBucket);
+
+    for (DWORD i = 0; pcbBuckets && (i < cBuckets); i++)
+    {
+        ASF_TEST_CHECK(pcbBuckets[i] == TEST_AUDIO_SIZE * cPacketsPerBucket);
+    }
+}
+
+//Writes a media test file and scans it both ways
+static BOOL ScanTestFile(DWORD cbPacket, DWORD cbVideoObject, CASFSparseScanner& scanner, ASF_SPARSE_SCAN_STATS* pStats)
+{
+    CASFTestWriter file;
+    CASFReader reader;
+
+    WriteTestMediaFile(file, cbPacket, TEST_PACKET_COUNT, cbVideoObject, TEST_AUDIO_SIZE);
+
+    if (!WriteTestFile(s_szMediaFile, file))
+    {
+        return FALSE;
+    }
+
+    ASF_TEST_CHECK(scanner.Scan(s_szMediaFile, 0, 0) == S_OK);
+    scanner.GetStats(pStats);
+
+    ASF_TEST_CHECK(pStats->cbFile == file.GetSize());
+    ASF_TEST_CHECK(pStats->cPackets == TEST_PACKET_COUNT);
+    ASF_TEST_CHECK(pStats->cPayloads == 2 * TEST_PACKET_COUNT);
+    ASF_TEST_CHECK(pStats->cCorruptPackets == 0);
+
+    ASF_TEST_CHECK(reader.Open(s_szMediaFile) == S_OK);
+    ASF_TEST_CHECK(reader.BuildTimelines(1) == S_OK);
+
+    CheckTimelines(scanner, reader);
+    CheckProfiles(scanner, cbVideoObject);
+
+    reader.Close();
+
+    return TRUE;
+}
+
+int main()
+{
+    CASFSparseScanner scanner;
+    ASF_SPARSE_SCAN_STATS stats;
+
+    //Large packets: a prefix and one payload header read per packet
+    if (!ScanTestFile(TEST_LARGE_PACKET_SIZE, TEST_LARGE_VIDEO_SIZE, scanner, &stats))
+    {
+        DeleteTestFile(s_szMediaFile);
+        printf("skipped: cannot write the test file\n");
+        return ASF_TEST_RESULT();
+    }
+
+    ASF_TEST_CHECK(stats.cHeaderReads >= TEST_PACKET_COUNT);
+    ASF_TEST_CHECK(stats.cbRead < stats.cbFile / 20);
+
+    //Small packets are read whole, the batch in one read, without
+    //payload header reads
+    ASF_TEST_CHECK(ScanTestFile(TEST_SMALL_PACKET_SIZE, TEST_SMALL_VIDEO_SIZE, scanner, &stats));
+    ASF_TEST_CHECK(stats.cHeaderReads == 0);
+    ASF_TEST_CHECK(stats.cbRead >= (QWORD)TEST_PACKET_COUNT * TEST_SMALL_PACKET_SIZE);
+    ASF_TEST_CHECK(stats.cReads < TEST_PACKET_COUNT);
+
+    //A file that is not there leaves nothing behind
+    DeleteTestFile(s_szMediaFile);
+
+    const CASFTimeline* pTimeline = NULL;
+
+    ASF_TEST_CHECK(FAILED(scanner.Scan(s_szMediaFile, 0, 0)));
+    ASF_TEST_CHECK(scanner.GetTimeline(ASF_TEST_VIDEO_STREAM, &pTimeline) == S_OK);
+    ASF_TEST_CHECK(pTimeline && (pTimeline->GetCount() == 0));
+
+    return ASF_TEST_RESULT();
+}
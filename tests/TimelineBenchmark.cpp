@@ -0,0 +1,140 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// TimelineBenchmark.cpp : Measures CASFTimeline build time, memory per
+//                         sample and time searches.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "ASFTimeline.h"
+#include "ASFThread.h"
+#include "ASFTestData.h"
+
+#define BENCH_SAMPLES_PER_ROUND     100000
+#define BENCH_DEFAULT_ROUNDS        10
+#define BENCH_BUILDS                10
+#define BENCH_SEARCHES              100000
+
+#define BENCH_PACKET_SIZE           8000
+#define BENCH_FIRST_PACKET          5000
+#define BENCH_PREROLL               3000        // Milliseconds
+#define BENCH_FRAME_MS              33
+
+//Video at 30 frames per second with B-frames, a key frame every second
+//and a few objects too large for the size field
+static void MakeSamples(DWORD cSamples, std::vector<ASF_SAMPLE_DESCRIPTOR>& samples)
+{
+    DWORD dwState = 1;
+    QWORD iPacket = 0;
+
+    samples.resize(cSamples);
+
+    for (DWORD i = 0; i < cSamples; i++)
+    {
+        ASF_SAMPLE_DESCRIPTOR& sample = samples[i];
+
+        dwState = dwState * 1664525 + 1013904223;
+
+        memset(&sample, 0, sizeof(sample));
+        sample.dwPresentationTime = BENCH_PREROLL + i * BENCH_FRAME_MS - ((i % 3 == 1) ? 2 * BENCH_FRAME_MS : 0);
+        sample.cbMediaObjectSize = (i % 30 == 0) ? 60000 : 5000 + (dwState >> 20);
+        sample.dwMediaObjectNumber = i;
+        sample.bStreamNumber = 1;
+        sample.fKeyFrame = (i % 30 == 0) ? 1 : 0;
+
+        if (i % 10000 == 0)
+        {
+            sample.cbMediaObjectSize = 0x400000;
+        }
+
+        iPacket += sample.cbMediaObjectSize / BENCH_PACKET_SIZE;
+        sample.cbPacketOffset = BENCH_FIRST_PACKET + iPacket * BENCH_PACKET_SIZE;
+    }
+}
+
+//Usage: TimelineBenchmark [rounds]
+//Timings are only meaningful in an optimized build, for example with
+//-DCMAKE_BUILD_TYPE=Release.
+int main(int argc, char* argv[])
+{
+    DWORD cRounds = (argc > 1) ? (DWORD)atoi(argv[1]) : BENCH_DEFAULT_ROUNDS;
+
+    if (cRounds == 0)
+    {
+        cRounds = 1;
+    }
+
+    const DWORD cSamples = cRounds * BENCH_SAMPLES_PER_ROUND;
+
+    std::vector<ASF_SAMPLE_DESCRIPTOR> samples;
+    CASFTimeline timeline;
+
+    MakeSamples(cSamples, samples);
+
+    printf("%u samples\n", cSamples);
+
+    LONGLONG llStart = CASFThread::GetTimestamp();
+
+    for (DWORD i = 0; i < BENCH_BUILDS; i++)
+    {
+        ASF_TEST_CHECK(timeline.Build(&samples[0], cSamples, BENCH_FIRST_PACKET, BENCH_PACKET_SIZE, (QWORD)BENCH_PREROLL * 10000) == S_OK);
+    }
+
+    double msBuild = (double)(CASFThread::GetTimestamp() - llStart) / 10000.0 / BENCH_BUILDS;
+
+    printf("build                %8.2f ms, %10.0f samples/s\n",
+        msBuild,
+        (msBuild > 0) ? cSamples * 1000.0 / msBuild : 0.0);
+
+    printf("memory               %8.2f bytes per sample, %.2f for the descriptors\n",
+        (double)timeline.GetMemorySize() / cSamples,
+        (double)sizeof(ASF_SAMPLE_DESCRIPTOR));
+
+    ASF_TEST_CHECK(timeline.GetCount() == cSamples);
+    ASF_TEST_CHECK(timeline.GetMemorySize() < (QWORD)cSamples * sizeof(ASF_SAMPLE_DESCRIPTOR));
+
+    //Searches spread over the whole stream, for any sample and for key frames
+    const MFTIME hnsDuration = (MFTIME)cSamples * BENCH_FRAME_MS * 10000;
+
+    for (int iKey = 0; iKey < 2; iKey++)
+    {
+        DWORD dwChecksum = 0;
+        DWORD dwIndex = 0;
+
+        llStart = CASFThread::GetTimestamp();
+
+        for (DWORD i = 0; i < BENCH_SEARCHES; i++)
+        {
+            MFTIME hnsTime = (MFTIME)((QWORD)hnsDuration * i / BENCH_SEARCHES);
+
+            if (timeline.FindByTime(hnsTime, (BOOL)iKey, &dwIndex) == S_OK)
+            {
+                dwChecksum += dwIndex;
+            }
+        }
+
+        double msSearch = (double)(CASFThread::GetTimestamp() - llStart) / 10000.0;
+
+        printf("%-20s %8.2f ms, %10.0f searches/s (checksum %u)\n",
+            iKey ? "search, key frames" : "search",
+            msSearch,
+            (msSearch > 0) ? BENCH_SEARCHES * 1000.0 / msSearch : 0.0,
+            dwChecksum);
+
+        //The first sample at the start of the stream
+        ASF_TEST_CHECK(timeline.FindByTime(0, (BOOL)iKey, &dwIndex) == S_OK);
+        ASF_TEST_CHECK(dwIndex == 0);
+    }
+
+    return ASF_TEST_RESULT();
+}
@@ -0,0 +1,293 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// TimelineTest.cpp : CASFTimeline packing and search tests.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "ASFTimeline.h"
+#include "ASFTestData.h"
+
+#define TEST_PACKET_SIZE        1000
+#define TEST_FIRST_PACKET       5000        // File offset of the first data packet
+#define TEST_PREROLL            3000        // Milliseconds
+#define TEST_SAMPLE_COUNT       1000
+
+//Memory of a timeline, as the class comment gives it
+#define TEST_ENTRY_BYTES        8
+#define TEST_BLOCK_BYTES        24
+#define TEST_LARGE_SIZE_BYTES   8
+
+//Largest field values that stay in an entry
+#define TEST_TIME_RANGE         (1 << (ASF_TIMELINE_TIME_BITS - 1))
+#define TEST_PACKET_RANGE       ((1 << ASF_TIMELINE_PACKET_BITS) - 1)
+#define TEST_SIZE_RANGE         ((1 << ASF_TIMELINE_SIZE_BITS) - 1)
+
+//Repeatable pseudo-random numbers
+static DWORD NextRandom(DWORD* pdwState)
+{
+    *pdwState = *pdwState * 1664525 + 1013904223;
+    return *pdwState >> 8;
+}
+
+static ASF_SAMPLE_DESCRIPTOR MakeSample(DWORD dwTime, QWORD iPacket, DWORD cbSize, BOOL fKeyFrame)
+{
+    ASF_SAMPLE_DESCRIPTOR sample;
+
+    memset(&sample, 0, sizeof(sample));
+    sample.cbPacketOffset = TEST_FIRST_PACKET + iPacket * TEST_PACKET_SIZE;
+    sample.dwPresentationTime = dwTime;
+    sample.cbMediaObjectSize = cbSize;
+    sample.bStreamNumber = 1;
+    sample.fKeyFrame = fKeyFrame ? 1 : 0;
+
+    return sample;
+}
+
+//Video with B-frames: times go back by up to two frames between
+//samples, some samples are presented inside the preroll, and several
+//samples share a packet
+static void MakeVideoSamples(std::vector<ASF_SAMPLE_DESCRIPTOR>& samples)
+{
+    DWORD dwState = 1;
+    QWORD iPacket = 0;
+
+    for (DWORD i = 0; i < TEST_SAMPLE_COUNT; i++)
+    {
+        DWORD dwTime = TEST_PREROLL - 200 + i * 40;
+
+        if ((i % 3 == 1) && (i > 2))
+        {
+            dwTime -= 80;
+        }
+
+        iPacket += NextRandom(&dwState) % 3;
+
+        samples.push_back(MakeSample(dwTime, iPacket, NextRandom(&dwState) % 50000, i % 12 == 0));
+    }
+}
+
+//Every sample decodes to what it was built from
+static void CheckRoundTrip(const CASFTimeline& timeline, const std::vector<ASF_SAMPLE_DESCRIPTOR>& samples)
+{
+    ASF_TEST_CHECK(timeline.GetCount() == samples.size());
+
+    for (DWORD i = 0; (i < timeline.GetCount()) && (i < samples.size()); i++)
+    {
+        ASF_TIMELINE_ENTRY entry;
+        MFTIME hnsTime = (MFTIME)samples[i].dwPresentationTime * 10000 - (MFTIME)TEST_PREROLL * 10000;
+
+        ASF_TEST_CHECK(timeline.GetEntry(i, &entry) == S_OK);
+        ASF_TEST_CHECK(entry.hnsTime == ((hnsTime > 0) ? hnsTime : 0));
+        ASF_TEST_CHECK(entry.cbPacketOffset == samples[i].cbPacketOffset);
+        ASF_TEST_CHECK(entry.cbSize == samples[i].cbMediaObjectSize);
+        ASF_TEST_CHECK(!entry.fKeyFrame == !samples[i].fKeyFrame);
+    }
+}
+
+static void TestRoundTrip()
+{
+    std::vector<ASF_SAMPLE_DESCRIPTOR> samples;
+    CASFTimeline timeline;
+    ASF_TIMELINE_ENTRY entry;
+
+    MakeVideoSamples(samples);
+
+    ASF_TEST_CHECK(timeline.Build(&samples[0], (DWORD)samples.size(), TEST_FIRST_PACKET, TEST_PACKET_SIZE, (QWORD)TEST_PREROLL * 10000) == S_OK);
+    CheckRoundTrip(timeline, samples);
+
+    //Only the block size limit splits these blocks
+    const DWORD cBlocks = (TEST_SAMPLE_COUNT + ASF_TIMELINE_BLOCK_SIZE - 1) / ASF_TIMELINE_BLOCK_SIZE;
+
+    ASF_TEST_CHECK(timeline.GetMemorySize() == (QWORD)TEST_SAMPLE_COUNT * TEST_ENTRY_BYTES + cBlocks * TEST_BLOCK_BYTES);
+
+    ASF_TEST_CHECK(timeline.GetEntry(TEST_SAMPLE_COUNT, &entry) == E_INVALIDARG);
+    ASF_TEST_CHECK(timeline.GetEntry(0, NULL) == E_POINTER);
+
+    //Building again replaces the table
+    ASF_TEST_CHECK(timeline.Build(&samples[0], 10, TEST_FIRST_PACKET, TEST_PACKET_SIZE, (QWORD)TEST_PREROLL * 10000) == S_OK);
+    ASF_TEST_CHECK(timeline.GetCount() == 10);
+
+    ASF_TEST_CHECK(timeline.Build(NULL, 0, TEST_FIRST_PACKET, TEST_PACKET_SIZE, 0) == S_OK);
+    ASF_TEST_CHECK(timeline.GetCount() == 0);
+    ASF_TEST_CHECK(timeline.GetMemorySize() == 0);
+
+    ASF_TEST_CHECK(timeline.Build(NULL, 1, TEST_FIRST_PACKET, TEST_PACKET_SIZE, 0) == E_POINTER);
+    ASF_TEST_CHECK(timeline.Build(&samples[0], 1, TEST_FIRST_PACKET, 0, 0) == E_INVALIDARG);
+
+    //A packet before the first data packet
+    ASF_TEST_CHECK(timeline.Build(&samples[0], 1, TEST_FIRST_PACKET + TEST_PACKET_SIZE, TEST_PACKET_SIZE, 0) == MF_E_ASF_INVALIDDATA);
+}
+
+//A block ends when a time or a packet no longer fits an entry
+static void TestBlockSplits()
+{
+    std::vector<ASF_SAMPLE_DESCRIPTOR> samples;
+    CASFTimeline timeline;
+
+    const DWORD dwBase = 1000;
+    const DWORD dwSecondBase = dwBase + TEST_TIME_RANGE;
+
+    //Block 1: the last time that fits after the base
+    samples.push_back(MakeSample(dwBase, 0, 100, TRUE));
+    samples.push_back(MakeSample(dwBase + TEST_TIME_RANGE - 1, 1, 100, FALSE));
+
+    //Block 2: one ms later, then back to the earliest time that fits
+    samples.push_back(MakeSample(dwSecondBase, 1, 100, FALSE));
+    samples.push_back(MakeSample(dwSecondBase - TEST_TIME_RANGE, 2, 100, FALSE));
+
+    //Block 3: one ms earlier, then the furthest packet that fits
+    samples.push_back(MakeSample(dwSecondBase - TEST_TIME_RANGE - 1, 2, 100, TRUE));
+    samples.push_back(MakeSample(dwBase, 2 + TEST_PACKET_RANGE, 100, FALSE));
+
+    //Block 4: one packet further
+    samples.push_back(MakeSample(dwBase, 3 + TEST_PACKET_RANGE, 100, FALSE));
+
+    ASF_TEST_CHECK(timeline.Build(&samples[0], (DWORD)samples.size(), TEST_FIRST_PACKET, TEST_PACKET_SIZE, (QWORD)TEST_PREROLL * 10000) == S_OK);
+    CheckRoundTrip(timeline, samples);
+
+    ASF_TEST_CHECK(timeline.GetMemorySize() == samples.size() * TEST_ENTRY_BYTES + 4 * TEST_BLOCK_BYTES);
+
+    //Later blocks start before the running maximum of the first one
+    DWORD dwIndex = 0;
+    MFTIME hnsLast = (MFTIME)(dwBase + TEST_TIME_RANGE - 1 - TEST_PREROLL) * 10000;
+
+    ASF_TEST_CHECK(timeline.FindByTime(hnsLast, FALSE, &dwIndex) == S_OK);
+    ASF_TEST_CHECK(dwIndex == 1);
+
+    ASF_TEST_CHECK(timeline.FindByTime(hnsLast + 1, FALSE, &dwIndex) == S_OK);
+    ASF_TEST_CHECK(dwIndex == 2);
+
+    ASF_TEST_CHECK(timeline.FindByTime(hnsLast + 1, TRUE, &dwIndex) == S_FALSE);
+    ASF_TEST_CHECK(dwIndex == samples.size());
+}
+
+//Sizes that do not fit the size field are kept in the side table
+static void TestLargeSizes()
+{
+    const DWORD rgcbSizes[] =
+    {
+        0,
+        TEST_SIZE_RANGE - 1,
+        TEST_SIZE_RANGE,            // Just under 2 MB, the escape value itself
+        0x200000,                   // 2 MB
+        12345,
+        0x04000000,                 // 64 MB
+        0xFFFFFFFF,
+    };
+
+    const DWORD cSizes = sizeof(rgcbSizes) / sizeof(rgcbSizes[0]);
+
+    std::vector<ASF_SAMPLE_DESCRIPTOR> samples;
+    CASFTimeline timeline;
+
+    for (DWORD i = 0; i < 3 * ASF_TIMELINE_BLOCK_SIZE; i++)
+    {
+        samples.push_back(MakeSample(TEST_PREROLL + i * 33, i, rgcbSizes[i % cSizes], i % 5 == 0));
+    }
+
+    ASF_TEST_CHECK(timeline.Build(&samples[0], (DWORD)samples.size(), TEST_FIRST_PACKET, TEST_PACKET_SIZE, (QWORD)TEST_PREROLL * 10000) == S_OK);
+    CheckRoundTrip(timeline, samples);
+
+    DWORD cLargeSizes = 0;
+
+    for (DWORD i = 0; i < samples.size(); i++)
+    {
+        if (samples[i].cbMediaObjectSize >= TEST_SIZE_RANGE)
+        {
+            cLargeSizes++;
+        }
+    }
+
+    ASF_TEST_CHECK(cLargeSizes > 0);
+    ASF_TEST_CHECK(timeline.GetMemorySize() ==
+        samples.size() * TEST_ENTRY_BYTES + 3 * TEST_BLOCK_BYTES + cLargeSizes * TEST_LARGE_SIZE_BYTES);
+}
+
+//Index of the first sample in file order presented at or after hnsTime,
+//or samples.size()
+static DWORD FindByScan(const std::vector<ASF_SAMPLE_DESCRIPTOR>& samples, MFTIME hnsTime, BOOL fKeyFrame)
+{
+    for (DWORD i = 0; i < samples.size(); i++)
+    {
+        MFTIME hnsSample = (MFTIME)samples[i].dwPresentationTime * 10000 - (MFTIME)TEST_PREROLL * 10000;
+
+        if (fKeyFrame && !samples[i].fKeyFrame)
+        {
+            continue;
+        }
+
+        if (((hnsSample > 0) ? hnsSample : 0) >= hnsTime)
+        {
+            return i;
+        }
+    }
+
+    return (DWORD)samples.size();
+}
+
+static void TestFindByTime()
+{
+    std::vector<ASF_SAMPLE_DESCRIPTOR> samples;
+    CASFTimeline timeline;
+    DWORD dwIndex = 0;
+
+    MakeVideoSamples(samples);
+
+    ASF_TEST_CHECK(timeline.Build(&samples[0], (DWORD)samples.size(), TEST_FIRST_PACKET, TEST_PACKET_SIZE, (QWORD)TEST_PREROLL * 10000) == S_OK);
+
+    const MFTIME hnsEnd = (MFTIME)TEST_SAMPLE_COUNT * 40 * 10000;
+    DWORD dwState = 7;
+
+    for (MFTIME hnsTime = -20000; hnsTime < hnsEnd + 1000000; hnsTime += 100000 + NextRandom(&dwState) % 50000)
+    {
+        for (int iKey = 0; iKey < 2; iKey++)
+        {
+            DWORD dwExpected = FindByScan(samples, hnsTime, (BOOL)iKey);
+            HRESULT hr = timeline.FindByTime(hnsTime, (BOOL)iKey, &dwIndex);
+
+            ASF_TEST_CHECK(hr == ((dwExpected < samples.size()) ? S_OK : S_FALSE));
+            ASF_TEST_CHECK(dwIndex == dwExpected);
+        }
+    }
+
+    //Times between milliseconds, and at each sample time
+    for (DWORD i = 0; i < samples.size(); i += 7)
+    {
+        MFTIME hnsSample = (MFTIME)samples[i].dwPresentationTime * 10000 - (MFTIME)TEST_PREROLL * 10000;
+        const MFTIME rghnsTimes[] = { hnsSample - 1, hnsSample, hnsSample + 1 };
+
+        for (DWORD j = 0; j < 3; j++)
+        {
+            ASF_TEST_CHECK(SUCCEEDED(timeline.FindByTime(rghnsTimes[j], FALSE, &dwIndex)));
+            ASF_TEST_CHECK(dwIndex == FindByScan(samples, rghnsTimes[j], FALSE));
+        }
+    }
+
+    ASF_TEST_CHECK(timeline.FindByTime(0x7FFFFFFFFFFFFFFFLL, FALSE, &dwIndex) == S_FALSE);
+    ASF_TEST_CHECK(timeline.FindByTime(0, FALSE, NULL) == E_POINTER);
+
+    CASFTimeline empty;
+
+    ASF_TEST_CHECK(empty.FindByTime(0, FALSE, &dwIndex) == S_FALSE);
+    ASF_TEST_CHECK(dwIndex == 0);
+}
+
+int main()
+{
+    TestRoundTrip();
+    TestBlockSplits();
+    TestLargeSizes();
+    TestFindByTime();
+
+    return ASF_TEST_RESULT();
+}
@@ -157,6 +157,116 @@ void DisplaySampleInfo(SAMPLE_INFO *sampleinfo)
     ZeroMemory((void*)sampleinfo, sizeof(SAMPLE_INFO));
 }
 
+//////////////////////////////////////////////////////////////////////////
+//  Name: CSampleInfoPane
+//  Description: Displays blocks of sample attributes on the Information
+//  pane. The list box is redrawn once per block instead of per line.
+/////////////////////////////////////////////////////////////////////////
+
+class CSampleInfoPane : public IASFSampleBatchCallback
+{
+public:
+
+    HRESULT OnSampleBatch(const ASF_SAMPLE_BATCH& batch)
+    {
+        HRESULT hr = S_OK;
+
+        HWND hInfo = GetDlgItem(g_hWnd, IDC_INFO);
+
+        WCHAR szMessage [MAX_STRING_SIZE], szTemp [MAX_STRING_SIZE];
+
+        SendMessage(hInfo, WM_SETREDRAW, FALSE, 0);
+
+        for (DWORD i = 0; i < batch.cSamples; i++)
+        {
+            SendMessage(hInfo, LB_ADDSTRING, 0, (LPARAM)L"");
+
+            if (batch.pfSeekedKeyFrames[i])
+            {
+                SendMessage(hInfo, LB_ADDSTRING, 0, (LPARAM)L"Seeked Key Frame");
+            }
+
+            StringCchPrintf(szMessage, MAX_STRING_SIZE, L"Stream number: %d", batch.pwStreamNumbers[i]);
+            SendMessage(hInfo, LB_ADDSTRING, 0, (LPARAM)szMessage);
+
+            StringCchPrintf(szMessage, MAX_STRING_SIZE, L"Buffer count: %d", batch.pcBuffers[i]);
+            SendMessage(hInfo, LB_ADDSTRING, 0, (LPARAM)szMessage);
+
+            StringCchPrintf(szMessage, MAX_STRING_SIZE, L"Total length: %d", batch.pcbLengths[i]);
+            SendMessage(hInfo, LB_ADDSTRING, 0, (LPARAM)szMessage);
+
+            //Block times are without the preroll, unlike DisplaySampleInfo
+            FormatTimeString(batch.phnsTimes[i], szMessage, MAX_STRING_SIZE, hr);
+            StringCchPrintf(szTemp, MAX_STRING_SIZE, L"Sample time (excluding preroll): %s (%I64d hns)", szMessage, batch.phnsTimes[i]);
+            SendMessage(hInfo, LB_ADDSTRING, 0, (LPARAM)szTemp);
+        }
+
+        SendMessage(hInfo, WM_SETREDRAW, TRUE, 0);
+        InvalidateRect(hInfo, NULL, TRUE);
+
+        return S_OK;
+    }
+};
+
+CSampleInfoPane g_SampleInfoPane;   //Receives the sample attributes of GenerateSamples.
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: DisplayReadStats
+//  Description: Displays the read counters of the last parse.
+//
+/////////////////////////////////////////////////////////////////////////
+
+void DisplayReadStats(const READ_PLANNER_STATS& stats)
+{
+    WCHAR szMessage [MAX_STRING_SIZE];
+    StringCchPrintf(szMessage, MAX_STRING_SIZE, L"");
+
+    SendMessage(GetDlgItem(g_hWnd, IDC_INFO), LB_ADDSTRING, 0, (LPARAM)szMessage);
+
+    StringCchPrintf(szMessage, MAX_STRING_SIZE, L"Reads: %I64u (%I64u bytes)", stats.cReads, stats.cbRead);
+    SendMessage(GetDlgItem(g_hWnd, IDC_INFO), LB_ADDSTRING, 0, (LPARAM)szMessage);
+
+    StringCchPrintf(szMessage, MAX_STRING_SIZE, L"Largest read: %d bytes", stats.cbLargestRead);
+    SendMessage(GetDlgItem(g_hWnd, IDC_INFO), LB_ADDSTRING, 0, (LPARAM)szMessage);
+
+    StringCchPrintf(szMessage, MAX_STRING_SIZE, L"Read throughput: %I64u KB/s", stats.cbPerSecond / 1024);
+    SendMessage(GetDlgItem(g_hWnd, IDC_INFO), LB_ADDSTRING, 0, (LPARAM)szMessage);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: DisplayKeyFrameFilterStats
+//  Description: Displays how much of the stream the key frame filter skipped.
+//
+/////////////////////////////////////////////////////////////////////////
+
+void DisplayKeyFrameFilterStats(const KEY_FRAME_FILTER_STATS& stats)
+{
+    WCHAR szMessage [MAX_STRING_SIZE];
+
+    StringCchPrintf(szMessage, MAX_STRING_SIZE, L"Key frames delivered: %I64u (%I64u bytes)", stats.cObjectsDelivered, stats.cbDelivered);
+    SendMessage(GetDlgItem(g_hWnd, IDC_INFO), LB_ADDSTRING, 0, (LPARAM)szMessage);
+
+    StringCchPrintf(szMessage, MAX_STRING_SIZE, L"Other frames skipped: %I64u (%I64u bytes)", stats.cObjectsSkipped, stats.cbSkipped);
+    SendMessage(GetDlgItem(g_hWnd, IDC_INFO), LB_ADDSTRING, 0, (LPARAM)szMessage);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//  Name: DisplayAudioStats
+//  Description: Displays how the test audio was queued on the audio sink.
+//
+/////////////////////////////////////////////////////////////////////////
+
+void DisplayAudioStats(const ASF_AUDIO_STREAM_STATS& stats)
+{
+    WCHAR szMessage [MAX_STRING_SIZE];
+
+    StringCchPrintf(szMessage, MAX_STRING_SIZE, L"Audio buffers played: %I64u (%I64u bytes)", stats.cBuffers, stats.cbSubmitted);
+    SendMessage(GetDlgItem(g_hWnd, IDC_INFO), LB_ADDSTRING, 0, (LPARAM)szMessage);
+
+    StringCchPrintf(szMessage, MAX_STRING_SIZE, L"Playback started after: %I64d ms", stats.hnsFirstBufferLatency / 10000);
+    SendMessage(GetDlgItem(g_hWnd, IDC_INFO), LB_ADDSTRING, 0, (LPARAM)szMessage);
+}
+
 //////////////////////////////////////////////////////////////////////////
 //  Name: DisplayFilePropertiesObject
 //  Description: Displays File Properties Object Header about the currently open ASF file.
@@ -458,7 +568,7 @@ void OnOpen(HWND hWnd)
                 goto done;
             }
 
-            hr = g_pASFManager->SetFilePropertiesObject(&g_fileinfo);
+            hr = g_pASFManager->GetFileProperties(&g_fileinfo);
             if (FAILED(hr))
             {
                 goto done;
@@ -549,12 +659,37 @@ void OnParse(HWND hWnd)
         dwFlags |= MFASF_SPLITTER_REVERSE;
     }
 
+    //Only the key frame of a video stream is decoded, so the demux can
+    //skip the other frames
+    g_pASFManager->SetKeyFramesOnly(g_guidMediaType == MFMediaType_Video);
+
     //Get the data offset based on seektime
     hr = g_pASFManager->GenerateSamples(g_seektime, dwFlags, &sampleinfo, &DisplaySampleInfo);
 
 
     if (SUCCEEDED(hr))
     {
+        READ_PLANNER_STATS stats;
+        g_pASFManager->GetReadStats(&stats);
+
+        DisplayReadStats(stats);
+
+        if (g_guidMediaType == MFMediaType_Video)
+        {
+            KEY_FRAME_FILTER_STATS filterstats;
+            g_pASFManager->GetKeyFrameFilterStats(&filterstats);
+
+            DisplayKeyFrameFilterStats(filterstats);
+        }
+
+        if ((g_guidMediaType == MFMediaType_Audio) && g_pMediaController)
+        {
+            ASF_AUDIO_STREAM_STATS audiostats;
+            g_pMediaController->GetAudioStats(&audiostats);
+
+            DisplayAudioStats(audiostats);
+        }
+
         //If the Media Controller collected any test content
         if (g_pMediaController && g_pMediaController->HasTestMedia())
         {
@@ -580,7 +715,8 @@ void OnParse(HWND hWnd)
 
 //////////////////////////////////////////////////////////////////////////
 //  Name: OnPlayTestAudio
-//  Description: Play the test audio clip.
+//  Description: Play the test audio clip again. It is played the first
+//               time while it is decoded.
 //  Parameter: Handle to the main Window.
 /////////////////////////////////////////////////////////////////////////
 
@@ -831,9 +967,45 @@ int APIENTRY _tWinMain(HINSTANCE hInstance,
 {
     g_hInst = hInstance;
 
+    //Load the GDI+ platform, this will be used for displaying the bitmap
+    ULONG_PTR gdiplusToken = 0;
+    GdiplusStartupInput gdiplusStartupInput;
+
+    if (GdiplusStartup(&gdiplusToken, &gdiplusStartupInput, NULL) != Ok)
+    {
+        NotifyError(L"GDI+ could not be started", E_FAIL, NULL);
+        return 0;
+    }
+
     //Initialize CASFManager object as a global instance
     HRESULT hr = CASFManager::CreateInstance(&g_pASFManager);
 
+    //Read and demux on a worker thread while the samples are decoded
+    if (SUCCEEDED(hr))
+    {
+        hr = g_pASFManager->SetPipelineDepth(ASF_SAMPLE_RING_DEFAULT_SIZE);
+    }
+
+    //Fill the Information pane a block of samples at a time
+    if (SUCCEEDED(hr))
+    {
+        hr = g_pASFManager->SetSampleBatching(ASF_SAMPLE_BATCH_DEFAULT_SIZE, &g_SampleInfoPane);
+    }
+
+    //Files opened before skip the index search; without a cache every
+    //file is opened in full
+    if (SUCCEEDED(hr))
+    {
+        WCHAR szCache[MAX_PATH];
+        DWORD cchTemp = GetTempPathW(MAX_PATH, szCache);
+
+        if ((cchTemp > 0) && (cchTemp < MAX_PATH) &&
+            SUCCEEDED(StringCchCatW(szCache, MAX_PATH, L"MF_ASFParser.cache")))
+        {
+            (void)g_pASFManager->OpenMetadataCache(szCache);
+        }
+    }
+
     if (SUCCEEDED(hr))
     {
         DialogBox( hInstance, (LPCTSTR)IDD_MAIN, NULL, UIMain );
@@ -844,5 +1016,8 @@ int APIENTRY _tWinMain(HINSTANCE hInstance,
     }
 
     SafeRelease(&g_pASFManager); //This also releases the Media Controller.
+
+    //The bitmap of the media controller is gone with it
+    GdiplusShutdown(gdiplusToken);
     return 0;
 }